@@ -1338,6 +1338,8 @@ typedef struct {
 
 typedef struct {
 	slurmdb_rollup_stats_t *dbd_rollup_stats;
+	uint32_t query_cache_hits;      /* requests served from the cache */
+	uint32_t query_cache_misses;    /* cacheable requests not cached */
 	List rollup_stats;              /* List of Clusters rollup stats */
 	List rpc_list;                  /* list of RPCs sent to the dbd. */
 	time_t time_start;              /* When we started collecting data */
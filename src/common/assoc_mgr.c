@@ -43,6 +43,7 @@
 #include <fcntl.h>
 #include <stdlib.h>
 #include <ctype.h>
+#include <sched.h>
 
 #include "src/common/uid.h"
 #include "src/common/xstring.h"
@@ -51,7 +52,7 @@
 #include "src/slurmdbd/read_config.h"
 
 #define ASSOC_HASH_SIZE 1000
-#define ASSOC_HASH_ID_INX(_assoc_id)	(_assoc_id % ASSOC_HASH_SIZE)
+#define ASSOC_HASH_ID_INX(_assoc_id)	(_assoc_id % assoc_hash_size)
 
 slurmdb_assoc_rec_t *assoc_mgr_root_assoc = NULL;
 uint32_t g_qos_max_priority = 0;
@@ -76,8 +77,78 @@ static pthread_mutex_t assoc_lock_init = PTHREAD_MUTEX_INITIALIZER;
 static assoc_init_args_t init_setup;
 static slurmdb_assoc_rec_t **assoc_hash_id = NULL;
 static slurmdb_assoc_rec_t **assoc_hash = NULL;
+static int assoc_hash_size = ASSOC_HASH_SIZE;
 static int *assoc_mgr_tres_old_pos = NULL;
 
+/*
+ * Secondary indexes of records kept in the assoc_mgr lists, hashed on a
+ * uid or on _get_str_inx() of a name. Entries with the same key stay in
+ * the order they were added, so a lookup finds the same record a walk of
+ * the list would have.
+ */
+typedef struct rec_index_ent {
+	uint32_t key;
+	struct rec_index_ent *next;
+	void *rec;
+} rec_index_ent_t;
+
+typedef struct {
+	uint32_t cnt;
+	uint32_t size;
+	rec_index_ent_t **table;
+} rec_index_t;
+
+static rec_index_t assoc_uid_index;	/* assoc_mgr_assoc_list by uid */
+static rec_index_t user_name_index;	/* assoc_mgr_user_list by name */
+static rec_index_t user_uid_index;	/* assoc_mgr_user_list by uid */
+
+/*
+ * Read-mostly views of the associations, QOS and TRES. A view holds copies
+ * of the records and is never modified once built. Writers changing this
+ * data build a new view before releasing their write lock and swap it in,
+ * retiring the previous one. Readers never lock: a thread pins the current
+ * view with a reference and keeps it until it finds a newer one has been
+ * published, so lookups through a view never wait behind a writer. Lookups
+ * which don't need a pointer to a live record and are made without the
+ * assoc_mgr locks read through the views, the pointers they hand out then
+ * point into the copies pinned by the calling thread.
+ *
+ * A reader announces itself in view_readers[] for the few instructions
+ * between loading the view pointer and taking its reference. A writer
+ * swaps the pointer, then waits for each of the two counters to drain in
+ * turn, steering new readers to the other one, before dropping the
+ * reference of the old view. Any reader which could still see the old view
+ * has taken its reference by then.
+ */
+typedef enum {
+	VIEW_ASSOC,
+	VIEW_QOS,
+	VIEW_TRES,
+	VIEW_CNT
+} view_type_t;
+
+typedef struct {
+	uint32_t assoc_cnt;
+	slurmdb_assoc_rec_t **assocs;	/* sorted by id */
+	int assoc_hash_size;
+	slurmdb_assoc_rec_t **assoc_hash; /* chained on assoc_next */
+	uint32_t qos_cnt;		/* g_qos_count at build time */
+	uint32_t qos_list_cnt;
+	slurmdb_qos_rec_t **qos;	/* indexed by QOS id */
+	uint32_t tres_cnt;
+	slurmdb_tres_rec_t **tres;	/* in assoc_mgr_tres_array order */
+	char **tres_names;
+	int refcnt;
+} assoc_mgr_view_t;
+
+static pthread_mutex_t view_mutex = PTHREAD_MUTEX_INITIALIZER;
+static assoc_mgr_view_t *views[VIEW_CNT];
+static uint32_t view_epoch = 0;
+static uint32_t view_readers[2];
+static __thread assoc_mgr_view_t *view_pinned[VIEW_CNT];
+static pthread_key_t view_key;
+static pthread_once_t view_key_once = PTHREAD_ONCE_INIT;
+
 static bool _running_cache(void)
 {
 	if (init_setup.running_cache &&
@@ -100,7 +171,7 @@ static int _get_str_inx(char *name)
 	return index;
 }
 
-static int _assoc_hash_index(slurmdb_assoc_rec_t *assoc)
+static int _assoc_hash_index_size(slurmdb_assoc_rec_t *assoc, int hash_size)
 {
 	int index;
 
@@ -122,23 +193,428 @@ static int _assoc_hash_index(slurmdb_assoc_rec_t *assoc)
 	if (assoc->partition)
 		index += _get_str_inx(assoc->partition);
 
-	index %= ASSOC_HASH_SIZE;
+	index %= hash_size;
 	if (index < 0)
-		index += ASSOC_HASH_SIZE;
+		index += hash_size;
 
 	return index;
 
 }
 
+static int _assoc_hash_index(slurmdb_assoc_rec_t *assoc)
+{
+	return _assoc_hash_index_size(assoc, assoc_hash_size);
+}
+
+static void _index_clear(rec_index_t *index)
+{
+	rec_index_ent_t *ent, *next;
+
+	for (int i = 0; i < index->size; i++) {
+		for (ent = index->table[i]; ent; ent = next) {
+			next = ent->next;
+			xfree(ent);
+		}
+	}
+	xfree(index->table);
+	index->cnt = 0;
+	index->size = 0;
+}
+
+/* Size the index for cnt records, dropping anything in it */
+static void _index_init(rec_index_t *index, int cnt)
+{
+	_index_clear(index);
+	index->size = MAX(cnt, ASSOC_HASH_SIZE);
+	index->table = xcalloc(index->size, sizeof(rec_index_ent_t *));
+}
+
+static void _index_link(rec_index_t *index, rec_index_ent_t *ent)
+{
+	rec_index_ent_t **ent_pptr = &index->table[ent->key % index->size];
+
+	while (*ent_pptr)
+		ent_pptr = &(*ent_pptr)->next;
+	ent->next = NULL;
+	*ent_pptr = ent;
+}
+
+/* Double the table, keeping the order of entries with the same key */
+static void _index_grow(rec_index_t *index)
+{
+	rec_index_ent_t **old_table = index->table, *ent, *next;
+	uint32_t old_size = index->size;
+
+	index->size *= 2;
+	index->table = xcalloc(index->size, sizeof(rec_index_ent_t *));
+	for (int i = 0; i < old_size; i++) {
+		for (ent = old_table[i]; ent; ent = next) {
+			next = ent->next;
+			_index_link(index, ent);
+		}
+	}
+	xfree(old_table);
+}
+
+static void _index_add(rec_index_t *index, uint32_t key, void *rec)
+{
+	rec_index_ent_t *ent = xmalloc(sizeof(*ent));
+
+	if (!index->table)
+		_index_init(index, 0);
+	else if (index->cnt >= (index->size * 2))
+		_index_grow(index);
+
+	ent->key = key;
+	ent->rec = rec;
+	_index_link(index, ent);
+	index->cnt++;
+}
+
+static void _index_remove(rec_index_t *index, uint32_t key, void *rec)
+{
+	rec_index_ent_t **ent_pptr, *ent;
+
+	if (!index->table)
+		return;
+
+	ent_pptr = &index->table[key % index->size];
+	while ((ent = *ent_pptr)) {
+		if (ent->rec == rec) {
+			*ent_pptr = ent->next;
+			xfree(ent);
+			index->cnt--;
+			return;
+		}
+		ent_pptr = &ent->next;
+	}
+}
+
+/* Return the first entry for key, walk on with _index_next() */
+static rec_index_ent_t *_index_first(rec_index_t *index, uint32_t key)
+{
+	rec_index_ent_t *ent;
+
+	if (!index->table)
+		return NULL;
+
+	for (ent = index->table[key % index->size]; ent; ent = ent->next)
+		if (ent->key == key)
+			return ent;
+
+	return NULL;
+}
+
+static rec_index_ent_t *_index_next(rec_index_ent_t *ent)
+{
+	uint32_t key = ent->key;
+
+	for (ent = ent->next; ent; ent = ent->next)
+		if (ent->key == key)
+			return ent;
+
+	return NULL;
+}
+
+static uint32_t _name_key(char *name)
+{
+	return (uint32_t) _get_str_inx(name);
+}
+
+/* Index user by uid and name, USER write lock must be held */
+static void _add_user_index(slurmdb_user_rec_t *user)
+{
+	_index_add(&user_uid_index, user->uid, user);
+	_index_add(&user_name_index, _name_key(user->name), user);
+}
+
+static void _delete_user_index(slurmdb_user_rec_t *user)
+{
+	_index_remove(&user_uid_index, user->uid, user);
+	_index_remove(&user_name_index, _name_key(user->name), user);
+}
+
+/* Rebuild the user indexes after assoc_mgr_user_list is replaced */
+static void _index_user_list(void)
+{
+	slurmdb_user_rec_t *user;
+	ListIterator itr;
+	int cnt = assoc_mgr_user_list ? list_count(assoc_mgr_user_list) : 0;
+
+	_index_init(&user_uid_index, cnt);
+	_index_init(&user_name_index, cnt);
+	if (!cnt)
+		return;
+
+	itr = list_iterator_create(assoc_mgr_user_list);
+	while ((user = list_next(itr)))
+		_add_user_index(user);
+	list_iterator_destroy(itr);
+}
+
+static slurmdb_user_rec_t *_find_user_uid(uint32_t uid)
+{
+	rec_index_ent_t *ent = _index_first(&user_uid_index, uid);
+
+	return ent ? ent->rec : NULL;
+}
+
+static slurmdb_user_rec_t *_find_user_name(char *name)
+{
+	rec_index_ent_t *ent;
+	slurmdb_user_rec_t *user;
+
+	for (ent = _index_first(&user_name_index, _name_key(name)); ent;
+	     ent = _index_next(ent)) {
+		user = ent->rec;
+		if (!xstrcasecmp(name, user->name))
+			return user;
+	}
+
+	return NULL;
+}
+
+static void _view_free(assoc_mgr_view_t *v)
+{
+	int i;
+
+	for (i = 0; i < v->assoc_cnt; i++)
+		slurmdb_destroy_assoc_rec(v->assocs[i]);
+	xfree(v->assocs);
+	xfree(v->assoc_hash);
+	for (i = 0; i < v->qos_cnt; i++)
+		slurmdb_destroy_qos_rec(v->qos[i]);
+	xfree(v->qos);
+	for (i = 0; i < v->tres_cnt; i++) {
+		slurmdb_destroy_tres_rec(v->tres[i]);
+		xfree(v->tres_names[i]);
+	}
+	xfree(v->tres);
+	xfree(v->tres_names);
+	xfree(v);
+}
+
+static void _view_unref(assoc_mgr_view_t *v)
+{
+	if (v && !__atomic_sub_fetch(&v->refcnt, 1, __ATOMIC_ACQ_REL))
+		_view_free(v);
+}
+
+/* Drop the views pinned by this thread */
+static void _view_unpin(void *arg)
+{
+	int i;
+
+	for (i = 0; i < VIEW_CNT; i++) {
+		_view_unref(view_pinned[i]);
+		view_pinned[i] = NULL;
+	}
+}
+
+static void _view_key_init(void)
+{
+	if (pthread_key_create(&view_key, _view_unpin))
+		fatal("%s: pthread_key_create: %m", __func__);
+}
+
+/*
+ * Return the current view of the given type, NULL if none was published.
+ * The view stays pinned by this thread, and so valid, until the thread
+ * looks up a view of this type again after a newer one was published.
+ */
+static assoc_mgr_view_t *_view_get(view_type_t type)
+{
+	assoc_mgr_view_t *v;
+	uint32_t epoch;
+
+	/* Our reference keeps the pinned view from being freed and reused */
+	v = __atomic_load_n(&views[type], __ATOMIC_SEQ_CST);
+	if (v == view_pinned[type])
+		return v;
+
+	epoch = __atomic_load_n(&view_epoch, __ATOMIC_SEQ_CST) & 1;
+	__atomic_add_fetch(&view_readers[epoch], 1, __ATOMIC_SEQ_CST);
+	if ((v = __atomic_load_n(&views[type], __ATOMIC_SEQ_CST)))
+		__atomic_add_fetch(&v->refcnt, 1, __ATOMIC_SEQ_CST);
+	__atomic_sub_fetch(&view_readers[epoch], 1, __ATOMIC_SEQ_CST);
+
+	if (!view_pinned[type] && v) {
+		pthread_once(&view_key_once, _view_key_init);
+		pthread_setspecific(view_key, view_pinned);
+	}
+	_view_unref(view_pinned[type]);
+	view_pinned[type] = v;
+
+	return v;
+}
+
+/* Replace the view of the given type with v, which may be NULL */
+static void _view_set(view_type_t type, assoc_mgr_view_t *v)
+{
+	assoc_mgr_view_t *old;
+	uint32_t epoch;
+	int i;
+
+	if (v)
+		v->refcnt = 1;
+
+	slurm_mutex_lock(&view_mutex);
+	old = __atomic_exchange_n(&views[type], v, __ATOMIC_SEQ_CST);
+	for (i = 0; i < 2; i++) {
+		epoch = __atomic_fetch_add(&view_epoch, 1, __ATOMIC_SEQ_CST) & 1;
+		while (__atomic_load_n(&view_readers[epoch], __ATOMIC_SEQ_CST))
+			sched_yield();
+	}
+	slurm_mutex_unlock(&view_mutex);
+
+	_view_unref(old);
+}
+
+static int _cmp_view_assoc_id(const void *a, const void *b)
+{
+	uint32_t id_a = (*(slurmdb_assoc_rec_t **) a)->id;
+	uint32_t id_b = (*(slurmdb_assoc_rec_t **) b)->id;
+
+	if (id_a < id_b)
+		return -1;
+	return (id_a > id_b);
+}
+
+/* Copy the parts of an association assoc_mgr_fill_in_assoc() hands out */
+static slurmdb_assoc_rec_t *_view_copy_assoc(slurmdb_assoc_rec_t *assoc)
+{
+	slurmdb_assoc_rec_t *copy = xmalloc(sizeof(*copy));
+
+	slurmdb_init_assoc_rec(copy, false);
+	slurmdb_copy_assoc_rec_limits(copy, assoc);
+	copy->acct = xstrdup(assoc->acct);
+	copy->cluster = xstrdup(assoc->cluster);
+	copy->def_qos_id = assoc->def_qos_id;
+	copy->id = assoc->id;
+	copy->is_def = assoc->is_def;
+	copy->lft = assoc->lft;
+	copy->parent_acct = xstrdup(assoc->parent_acct);
+	copy->parent_id = assoc->parent_id;
+	copy->partition = xstrdup(assoc->partition);
+	copy->rgt = assoc->rgt;
+	copy->shares_raw = assoc->shares_raw;
+	copy->uid = assoc->uid;
+	copy->user = xstrdup(assoc->user);
+
+	return copy;
+}
+
+/* Copy the parts of a QOS assoc_mgr_fill_in_qos() hands out */
+static slurmdb_qos_rec_t *_view_copy_qos(slurmdb_qos_rec_t *qos)
+{
+	slurmdb_qos_rec_t *copy = xmalloc(sizeof(*copy));
+
+	slurmdb_init_qos_rec(copy, false, NO_VAL);
+	slurmdb_copy_qos_rec_limits(copy, qos);
+	copy->description = xstrdup(qos->description);
+	copy->id = qos->id;
+	copy->max_jobs_accrue_pa = qos->max_jobs_accrue_pa;
+	copy->max_jobs_accrue_pu = qos->max_jobs_accrue_pu;
+	copy->min_prio_thresh = qos->min_prio_thresh;
+	copy->name = xstrdup(qos->name);
+	if (qos->preempt_bitstr)
+		copy->preempt_bitstr = bit_copy(qos->preempt_bitstr);
+
+	return copy;
+}
+
+/*
+ * Publish a new view of assoc_mgr_assoc_list, call with it write locked
+ * once every association in the list is hashed.
+ */
+static void _publish_assoc_view(void)
+{
+	assoc_mgr_view_t *v = xmalloc(sizeof(*v));
+	slurmdb_assoc_rec_t *assoc, *copy;
+	int inx;
+
+	xassert(verify_assoc_lock(ASSOC_LOCK, WRITE_LOCK));
+
+	if (assoc_hash) {
+		/* Keep the copies chained in the order the live hash has */
+		v->assoc_hash_size = assoc_hash_size;
+		v->assoc_hash = xcalloc(v->assoc_hash_size,
+					sizeof(slurmdb_assoc_rec_t *));
+		v->assocs = xcalloc(list_count(assoc_mgr_assoc_list) + 1,
+				    sizeof(slurmdb_assoc_rec_t *));
+		for (inx = 0; inx < v->assoc_hash_size; inx++) {
+			slurmdb_assoc_rec_t **tail = &v->assoc_hash[inx];
+
+			for (assoc = assoc_hash[inx]; assoc;
+			     assoc = assoc->assoc_next) {
+				xassert(v->assoc_cnt <
+					list_count(assoc_mgr_assoc_list));
+				copy = _view_copy_assoc(assoc);
+				v->assocs[v->assoc_cnt++] = copy;
+				*tail = copy;
+				tail = &copy->assoc_next;
+			}
+		}
+		qsort(v->assocs, v->assoc_cnt, sizeof(slurmdb_assoc_rec_t *),
+		      _cmp_view_assoc_id);
+	}
+
+	_view_set(VIEW_ASSOC, v);
+}
+
+/*
+ * Publish a new view of qos_list, which is or is about to become
+ * assoc_mgr_qos_list. Call with the QOS write lock held.
+ */
+static void _publish_qos_view(List qos_list)
+{
+	assoc_mgr_view_t *v = xmalloc(sizeof(*v));
+	slurmdb_qos_rec_t *qos;
+	ListIterator itr;
+
+	xassert(verify_assoc_lock(QOS_LOCK, WRITE_LOCK));
+
+	if (qos_list) {
+		v->qos_cnt = g_qos_count;
+		v->qos = xcalloc(v->qos_cnt + 1, sizeof(slurmdb_qos_rec_t *));
+		itr = list_iterator_create(qos_list);
+		while ((qos = list_next(itr))) {
+			if ((qos->id >= v->qos_cnt) || v->qos[qos->id])
+				continue;
+			v->qos[qos->id] = _view_copy_qos(qos);
+			v->qos_list_cnt++;
+		}
+		list_iterator_destroy(itr);
+	}
+
+	_view_set(VIEW_QOS, v);
+}
+
+/* Publish a new view of assoc_mgr_tres_array, call once it is replaced */
+static void _publish_tres_view(void)
+{
+	assoc_mgr_view_t *v = xmalloc(sizeof(*v));
+	int i;
+
+	v->tres_cnt = g_tres_count;
+	v->tres = xcalloc(v->tres_cnt + 1, sizeof(slurmdb_tres_rec_t *));
+	v->tres_names = xcalloc(v->tres_cnt + 1, sizeof(char *));
+	for (i = 0; i < v->tres_cnt; i++) {
+		v->tres[i] = slurmdb_copy_tres_rec(assoc_mgr_tres_array[i]);
+		v->tres_names[i] = xstrdup(assoc_mgr_tres_name_array[i]);
+	}
+
+	_view_set(VIEW_TRES, v);
+}
 static void _add_assoc_hash(slurmdb_assoc_rec_t *assoc)
 {
 	int inx = ASSOC_HASH_ID_INX(assoc->id);
 
 	if (!assoc_hash_id)
-		assoc_hash_id = xcalloc(ASSOC_HASH_SIZE,
+		assoc_hash_id = xcalloc(assoc_hash_size,
 					sizeof(slurmdb_assoc_rec_t *));
 	if (!assoc_hash)
-		assoc_hash = xcalloc(ASSOC_HASH_SIZE,
+		assoc_hash = xcalloc(assoc_hash_size,
 				     sizeof(slurmdb_assoc_rec_t *));
 
 	assoc->assoc_next_id = assoc_hash_id[inx];
@@ -147,6 +623,41 @@ static void _add_assoc_hash(slurmdb_assoc_rec_t *assoc)
 	inx = _assoc_hash_index(assoc);
 	assoc->assoc_next = assoc_hash[inx];
 	assoc_hash[inx] = assoc;
+
+	_index_add(&assoc_uid_index, assoc->uid, assoc);
+}
+
+/*
+ * Grow the association hash tables once associations added by updates
+ * outnumber them, so chains stay short between full reloads.
+ * Every association in assoc_mgr_assoc_list must already be hashed.
+ */
+static void _grow_assoc_hash(void)
+{
+	slurmdb_assoc_rec_t *assoc;
+	ListIterator itr;
+	int inx, cnt = list_count(assoc_mgr_assoc_list);
+
+	if (cnt <= (assoc_hash_size * 2))
+		return;
+
+	xfree(assoc_hash_id);
+	xfree(assoc_hash);
+	assoc_hash_size = cnt;
+	assoc_hash_id = xcalloc(assoc_hash_size, sizeof(slurmdb_assoc_rec_t *));
+	assoc_hash = xcalloc(assoc_hash_size, sizeof(slurmdb_assoc_rec_t *));
+
+	itr = list_iterator_create(assoc_mgr_assoc_list);
+	while ((assoc = list_next(itr))) {
+		inx = ASSOC_HASH_ID_INX(assoc->id);
+		assoc->assoc_next_id = assoc_hash_id[inx];
+		assoc_hash_id[inx] = assoc;
+
+		inx = _assoc_hash_index(assoc);
+		assoc->assoc_next = assoc_hash[inx];
+		assoc_hash[inx] = assoc;
+	}
+	list_iterator_destroy(itr);
 }
 
 static bool _remove_from_assoc_list(slurmdb_assoc_rec_t *assoc)
@@ -192,24 +703,12 @@ static slurmdb_assoc_rec_t *_find_assoc_rec_id(uint32_t assoc_id)
  * IN assoc - requested association info
  * RET pointer to the assoc_ptr's record, NULL on error
  */
-static slurmdb_assoc_rec_t *_find_assoc_rec(
-	slurmdb_assoc_rec_t *assoc)
+static slurmdb_assoc_rec_t *_find_assoc_hash(
+	slurmdb_assoc_rec_t **hash, int hash_size, slurmdb_assoc_rec_t *assoc)
 {
 	slurmdb_assoc_rec_t *assoc_ptr;
-	int inx;
-
-	/* We can only use _find_assoc_rec_id if we are not on the slurmdbd */
-	if (assoc->id && !slurmdbd_conf)
-		return _find_assoc_rec_id(assoc->id);
-
-	if (!assoc_hash) {
-		debug2("%s: no associations added yet", __func__);
-		return NULL;
-	}
 
-
-	inx = _assoc_hash_index(assoc);
-	assoc_ptr = assoc_hash[inx];
+	assoc_ptr = hash[_assoc_hash_index_size(assoc, hash_size)];
 
 	while (assoc_ptr) {
 		if ((!assoc->user && (assoc->uid == NO_VAL))
@@ -271,6 +770,51 @@ static slurmdb_assoc_rec_t *_find_assoc_rec(
 	return assoc_ptr;
 }
 
+static slurmdb_assoc_rec_t *_find_assoc_rec(
+	slurmdb_assoc_rec_t *assoc)
+{
+	/* We can only use _find_assoc_rec_id if we are not on the slurmdbd */
+	if (assoc->id && !slurmdbd_conf)
+		return _find_assoc_rec_id(assoc->id);
+
+	if (!assoc_hash) {
+		debug2("%s: no associations added yet", __func__);
+		return NULL;
+	}
+
+	return _find_assoc_hash(assoc_hash, assoc_hash_size, assoc);
+}
+
+/* As _find_assoc_rec(), in the copies held by view v */
+static slurmdb_assoc_rec_t *_find_view_assoc(assoc_mgr_view_t *v,
+					     slurmdb_assoc_rec_t *assoc)
+{
+	slurmdb_assoc_rec_t **found, key = { .id = assoc->id }, *key_ptr = &key;
+
+	if (assoc->id && !slurmdbd_conf) {
+		found = bsearch(&key_ptr, v->assocs, v->assoc_cnt,
+				sizeof(slurmdb_assoc_rec_t *),
+				_cmp_view_assoc_id);
+		return found ? *found : NULL;
+	}
+
+	if (!v->assoc_hash)
+		return NULL;
+
+	return _find_assoc_hash(v->assoc_hash, v->assoc_hash_size, assoc);
+}
+
+/* Look in view v if use_view is set, else in the live records */
+static slurmdb_assoc_rec_t *_find_assoc_in(assoc_mgr_view_t *v, bool use_view,
+					   slurmdb_assoc_rec_t *assoc)
+{
+	if (!use_view)
+		return _find_assoc_rec(assoc);
+	if (!v)
+		return NULL;
+	return _find_view_assoc(v, assoc);
+}
+
 /*
  * _list_delete_assoc - delete a assoc record
  * IN assoc_entry - pointer to assoc_record to delete
@@ -314,6 +858,8 @@ static void _delete_assoc_hash(slurmdb_assoc_rec_t *assoc)
 		return;	/* Fix CLANG false positive error */
 	} else
 		*assoc_pptr = assoc_ptr->assoc_next;
+
+	_index_remove(&assoc_uid_index, assoc->uid, assoc);
 }
 
 
@@ -559,6 +1105,7 @@ static int _change_user_name(slurmdb_user_rec_t *user)
 			}
 		}
 		list_iterator_destroy(itr);
+		_publish_assoc_view();
 	}
 
 	if (assoc_mgr_wckey_list) {
@@ -667,16 +1214,6 @@ static int _local_update_assoc_qos_list(slurmdb_assoc_rec_t *assoc,
 	return SLURM_SUCCESS;
 }
 
-static int _list_find_uid(void *x, void *key)
-{
-	slurmdb_user_rec_t *user = (slurmdb_user_rec_t *) x;
-	uint32_t uid = *(uint32_t *) key;
-
-	if (user->uid == uid)
-		return 1;
-	return 0;
-}
-
 /* locks should be put in place before calling this function USER_WRITE */
 static void _set_user_default_acct(slurmdb_assoc_rec_t *assoc)
 {
@@ -686,8 +1223,7 @@ static void _set_user_default_acct(slurmdb_assoc_rec_t *assoc)
 
 	/* set up the default if this is it */
 	if ((assoc->is_def == 1) && (assoc->uid != NO_VAL)) {
-		slurmdb_user_rec_t *user = list_find_first(
-			assoc_mgr_user_list, _list_find_uid, &assoc->uid);
+		slurmdb_user_rec_t *user = _find_user_uid(assoc->uid);
 
 		if (!user)
 			return;
@@ -713,8 +1249,7 @@ static void _set_user_default_wckey(slurmdb_wckey_rec_t *wckey)
 
 	/* set up the default if this is it */
 	if ((wckey->is_def == 1) && (wckey->uid != NO_VAL)) {
-		slurmdb_user_rec_t *user = list_find_first(
-			assoc_mgr_user_list, _list_find_uid, &wckey->uid);
+		slurmdb_user_rec_t *user = _find_user_uid(wckey->uid);
 
 		if (!user)
 			return;
@@ -1017,6 +1552,9 @@ static int _post_assoc_list(void)
 
 	xfree(assoc_hash_id);
 	xfree(assoc_hash);
+	assoc_hash_size = MAX(list_count(assoc_mgr_assoc_list),
+			      ASSOC_HASH_SIZE);
+	_index_init(&assoc_uid_index, assoc_hash_size);
 
 	itr = list_iterator_create(assoc_mgr_assoc_list);
 
@@ -1051,6 +1589,7 @@ static int _post_assoc_list(void)
 	_calculate_assoc_norm_priorities(true);
 
 	slurmdb_sort_hierarchical_assoc_list(assoc_mgr_assoc_list, true);
+	_publish_assoc_view();
 
 	//END_TIMER2("load_associations");
 	return SLURM_SUCCESS;
@@ -1144,6 +1683,7 @@ static int _post_qos_list(List qos_list)
 			_set_qos_norm_priority(qos);
 	}
 	list_iterator_destroy(itr);
+	_publish_qos_view(qos_list);
 
 	return SLURM_SUCCESS;
 }
@@ -1309,6 +1849,7 @@ extern int assoc_mgr_post_tres_list(List new_list)
 	new_list = NULL;
 
 	g_tres_count = new_cnt;
+	_publish_tres_view();
 
 	if ((changed_size || changed_pos) &&
 	    assoc_mgr_assoc_list && assoc_mgr_qos_list) {
@@ -1663,6 +2204,7 @@ static int _get_assoc_mgr_user_list(void *db_conn, int enforce)
 	assoc_mgr_user_list = acct_storage_g_get_users(db_conn, uid, &user_q);
 
 	if (!assoc_mgr_user_list) {
+		_index_user_list();
 		assoc_mgr_unlock(&locks);
 		if (enforce & ACCOUNTING_ENFORCE_ASSOCS) {
 			error("%s: no list was made.", __func__);
@@ -1673,6 +2215,7 @@ static int _get_assoc_mgr_user_list(void *db_conn, int enforce)
 	}
 
 	_post_user_list(assoc_mgr_user_list);
+	_index_user_list();
 
 	assoc_mgr_unlock(&locks);
 	return SLURM_SUCCESS;
@@ -1929,6 +2472,7 @@ static int _refresh_assoc_mgr_user_list(void *db_conn, int enforce)
 	FREE_NULL_LIST(assoc_mgr_user_list);
 
 	assoc_mgr_user_list = current_users;
+	_index_user_list();
 
 	assoc_mgr_unlock(&locks);
 
@@ -2087,6 +2631,10 @@ extern int assoc_mgr_fini(bool save_state)
 	assoc_mgr_qos_list = NULL;
 	assoc_mgr_user_list = NULL;
 	assoc_mgr_wckey_list = NULL;
+	_view_set(VIEW_ASSOC, NULL);
+	_view_set(VIEW_QOS, NULL);
+	_view_set(VIEW_TRES, NULL);
+	_view_unpin(NULL);
 
 	assoc_mgr_root_assoc = NULL;
 
@@ -2095,6 +2643,9 @@ extern int assoc_mgr_fini(bool save_state)
 
 	xfree(assoc_hash_id);
 	xfree(assoc_hash);
+	_index_clear(&assoc_uid_index);
+	_index_clear(&user_name_index);
+	_index_clear(&user_uid_index);
 
 	assoc_mgr_unlock(&locks);
 
@@ -2239,7 +2790,7 @@ extern int assoc_mgr_get_user_assocs(void *db_conn,
 				     int enforce,
 				     List assoc_list)
 {
-	ListIterator itr = NULL;
+	rec_index_ent_t *ent;
 	slurmdb_assoc_rec_t *found_assoc = NULL;
 	int set = 0;
 
@@ -2257,18 +2808,12 @@ extern int assoc_mgr_get_user_assocs(void *db_conn,
 
 	xassert(assoc_mgr_assoc_list);
 
-	itr = list_iterator_create(assoc_mgr_assoc_list);
-	while ((found_assoc = list_next(itr))) {
-		if (assoc->uid != found_assoc->uid) {
-			debug4("not the right user %u != %u",
-			       assoc->uid, found_assoc->uid);
-			continue;
-		}
-
+	for (ent = _index_first(&assoc_uid_index, assoc->uid); ent;
+	     ent = _index_next(ent)) {
+		found_assoc = ent->rec;
 		list_append(assoc_list, found_assoc);
 		set = 1;
 	}
-	list_iterator_destroy(itr);
 
 	if (!set) {
 		debug("UID %u has no associations", assoc->uid);
@@ -2393,6 +2938,8 @@ extern int assoc_mgr_fill_in_assoc(void *db_conn,
 {
 	slurmdb_assoc_rec_t * ret_assoc = NULL;
 	assoc_mgr_lock_t locks = { .assoc = READ_LOCK };
+	assoc_mgr_view_t *v = NULL;
+	bool use_view = false;
 
 	if (assoc_pptr)
 		*assoc_pptr = NULL;
@@ -2469,25 +3016,33 @@ extern int assoc_mgr_fill_in_assoc(void *db_conn,
 	debug5("%s: looking for assoc of user=%s(%u), acct=%s, cluster=%s, partition=%s",
 	       __func__, assoc->user, assoc->uid, assoc->acct, assoc->cluster,
 	       assoc->partition);
-	if (!locked)
-		assoc_mgr_lock(&locks);
-
-	xassert(verify_assoc_lock(ASSOC_LOCK, READ_LOCK));
 
+	/*
+	 * A caller which keeps no live record and holds no locks is served
+	 * from the copies in the association view.
+	 */
+	if (!assoc_pptr && !locked) {
+		use_view = true;
+		v = _view_get(VIEW_ASSOC);
+	} else {
+		if (!locked)
+			assoc_mgr_lock(&locks);
+		xassert(verify_assoc_lock(ASSOC_LOCK, READ_LOCK));
+	}
 
 	/* First look for the assoc with a partition and then check
 	 * for the non-partition association if we don't find one.
 	 */
-	ret_assoc = _find_assoc_rec(assoc);
+	ret_assoc = _find_assoc_in(v, use_view, assoc);
 	if (!ret_assoc && assoc->partition) {
 		char *part_holder = assoc->partition;
 		assoc->partition = NULL;
-		ret_assoc = _find_assoc_rec(assoc);
+		ret_assoc = _find_assoc_in(v, use_view, assoc);
 		assoc->partition = part_holder;
 	}
 
 	if (!ret_assoc) {
-		if (!locked)
+		if (!locked && !use_view)
 			assoc_mgr_unlock(&locks);
 		if (enforce & ACCOUNTING_ENFORCE_ASSOCS)
 			return SLURM_ERROR;
@@ -2588,7 +3143,7 @@ extern int assoc_mgr_fill_in_assoc(void *db_conn,
 
 	if (!assoc->user)
 		assoc->user = ret_assoc->user;
-	if (!locked)
+	if (!locked && !use_view)
 		assoc_mgr_unlock(&locks);
 
 	return SLURM_SUCCESS;
@@ -2599,7 +3154,6 @@ extern int assoc_mgr_fill_in_user(void *db_conn, slurmdb_user_rec_t *user,
 				  slurmdb_user_rec_t **user_pptr,
 				  bool locked)
 {
-	ListIterator itr = NULL;
 	slurmdb_user_rec_t * found_user = NULL;
 	assoc_mgr_lock_t locks = { .user = READ_LOCK };
 
@@ -2621,16 +3175,10 @@ extern int assoc_mgr_fill_in_user(void *db_conn, slurmdb_user_rec_t *user,
 		return SLURM_SUCCESS;
 	}
 
-	itr = list_iterator_create(assoc_mgr_user_list);
-	while ((found_user = list_next(itr))) {
-		if (user->uid != NO_VAL) {
-			if (user->uid == found_user->uid)
-				break;
-		} else if (user->name
-			   && !xstrcasecmp(user->name, found_user->name))
-			break;
-	}
-	list_iterator_destroy(itr);
+	if (user->uid != NO_VAL)
+		found_user = _find_user_uid(user->uid);
+	else if (user->name)
+		found_user = _find_user_name(user->name);
 
 	if (!found_user) {
 		if (!locked)
@@ -2679,21 +3227,32 @@ extern int assoc_mgr_fill_in_qos(void *db_conn, slurmdb_qos_rec_t *qos,
 	ListIterator itr = NULL;
 	slurmdb_qos_rec_t * found_qos = NULL;
 	assoc_mgr_lock_t locks = { .qos = READ_LOCK };
+	assoc_mgr_view_t *v = NULL;
+	bool use_view = false;
+	int i;
 
 	if (qos_pptr)
 		*qos_pptr = NULL;
 
-	if (!locked)
-		assoc_mgr_lock(&locks);
-
-	xassert(verify_assoc_lock(QOS_LOCK, READ_LOCK));
+	/*
+	 * A caller which keeps no live record and holds no locks is served
+	 * from the copies in the QOS view.
+	 */
+	if (!qos_pptr && !locked) {
+		use_view = true;
+		v = _view_get(VIEW_QOS);
+	} else {
+		if (!locked)
+			assoc_mgr_lock(&locks);
+		xassert(verify_assoc_lock(QOS_LOCK, READ_LOCK));
+	}
 
 	/* Since we might be locked we can't come in here and try to
 	 * get the list since we would need the WRITE_LOCK to do that,
 	 * so just return as this would only happen on a system not
 	 * talking to the database.
 	 */
-	if (!assoc_mgr_qos_list) {
+	if (use_view ? !v : !assoc_mgr_qos_list) {
 		int rc = SLURM_SUCCESS;
 
 		if (enforce & ACCOUNTING_ENFORCE_QOS) {
@@ -2701,27 +3260,39 @@ extern int assoc_mgr_fill_in_qos(void *db_conn, slurmdb_qos_rec_t *qos,
 			      "this should never happen");
 			rc = SLURM_ERROR;
 		}
-		if (!locked)
+		if (!locked && !use_view)
 			assoc_mgr_unlock(&locks);
 		return rc;
-	} else if (!list_count(assoc_mgr_qos_list)
+	} else if ((use_view ? !v->qos_list_cnt :
+		    !list_count(assoc_mgr_qos_list))
 		   && !(enforce & ACCOUNTING_ENFORCE_QOS)) {
-		if (!locked)
+		if (!locked && !use_view)
 			assoc_mgr_unlock(&locks);
 		return SLURM_SUCCESS;
 	}
 
-	itr = list_iterator_create(assoc_mgr_qos_list);
-	while ((found_qos = list_next(itr))) {
-		if (qos->id == found_qos->id)
-			break;
-		else if (qos->name && !xstrcasecmp(qos->name, found_qos->name))
-			break;
+	if (use_view) {
+		if (qos->id < v->qos_cnt)
+			found_qos = v->qos[qos->id];
+		for (i = 0; !found_qos && qos->name && (i < v->qos_cnt); i++) {
+			if (v->qos[i] &&
+			    !xstrcasecmp(qos->name, v->qos[i]->name))
+				found_qos = v->qos[i];
+		}
+	} else {
+		itr = list_iterator_create(assoc_mgr_qos_list);
+		while ((found_qos = list_next(itr))) {
+			if (qos->id == found_qos->id)
+				break;
+			else if (qos->name &&
+				 !xstrcasecmp(qos->name, found_qos->name))
+				break;
+		}
+		list_iterator_destroy(itr);
 	}
-	list_iterator_destroy(itr);
 
 	if (!found_qos) {
-		if (!locked)
+		if (!locked && !use_view)
 			assoc_mgr_unlock(&locks);
 		if (enforce & ACCOUNTING_ENFORCE_QOS)
 			return SLURM_ERROR;
@@ -2815,7 +3386,7 @@ extern int assoc_mgr_fill_in_qos(void *db_conn, slurmdb_qos_rec_t *qos,
 	qos->usage_factor = found_qos->usage_factor;
 	qos->limit_factor = found_qos->limit_factor;
 
-	if (!locked)
+	if (!locked && !use_view)
 		assoc_mgr_unlock(&locks);
 	return SLURM_SUCCESS;
 }
@@ -3007,7 +3578,7 @@ extern slurmdb_admin_level_t assoc_mgr_get_admin_level(void *db_conn,
 		return SLURMDB_ADMIN_NOTSET;
 	}
 
-	found_user = list_find_first(assoc_mgr_user_list, _list_find_uid, &uid);
+	found_user = _find_user_uid(uid);
 
 	if (found_user)
 		level = found_user->admin_level;
@@ -3039,8 +3610,7 @@ extern bool assoc_mgr_is_user_acct_coord(void *db_conn,
 		return false;
 	}
 
-	found_user = list_find_first(assoc_mgr_user_list, _list_find_uid,
-				     &uid);
+	found_user = _find_user_uid(uid);
 
 	if (!found_user || !found_user->coord_accts) {
 		assoc_mgr_unlock(&locks);
@@ -3624,6 +4194,10 @@ extern int assoc_mgr_update(List update_list, bool locked)
 		}
 	}
 	list_iterator_destroy(itr);
+
+	if (init_setup.update_notify)
+		init_setup.update_notify();
+
 	return rc;
 }
 
@@ -4053,6 +4627,7 @@ extern int assoc_mgr_update_assocs(slurmdb_update_object_t *update, bool locked)
 				_add_assoc_hash(object);
 			reset = 0;
 		}
+		_grow_assoc_hash();
 		/* Now that we have set up the parents correctly we
 		   can update the used limits
 		*/
@@ -4097,6 +4672,8 @@ extern int assoc_mgr_update_assocs(slurmdb_update_object_t *update, bool locked)
 		slurmdb_sort_hierarchical_assoc_list(
 			assoc_mgr_assoc_list, true);
 
+	_publish_assoc_view();
+
 	if (!locked)
 		assoc_mgr_unlock(&locks);
 
@@ -4250,7 +4827,6 @@ extern int assoc_mgr_update_users(slurmdb_update_object_t *update, bool locked)
 	slurmdb_user_rec_t * rec = NULL;
 	slurmdb_user_rec_t * object = NULL;
 
-	ListIterator itr = NULL;
 	int rc = SLURM_SUCCESS;
 	uid_t pw_uid;
 	assoc_mgr_lock_t locks = { .assoc = WRITE_LOCK, .user = WRITE_LOCK,
@@ -4264,18 +4840,14 @@ extern int assoc_mgr_update_users(slurmdb_update_object_t *update, bool locked)
 		return SLURM_SUCCESS;
 	}
 
-	itr = list_iterator_create(assoc_mgr_user_list);
 	while ((object = list_pop(update->objects))) {
-		list_iterator_reset(itr);
-		while ((rec = list_next(itr))) {
-			char *name;
-			if (object->old_name)
-				name = object->old_name;
-			else
-				name = object->name;
-			if (!xstrcasecmp(name, rec->name))
-				break;
-		}
+		char *name;
+
+		if (object->old_name)
+			name = object->old_name;
+		else
+			name = object->name;
+		rec = name ? _find_user_name(name) : NULL;
 
 		//info("%d user %s", update->type, object->name);
 		switch(update->type) {
@@ -4295,11 +4867,13 @@ extern int assoc_mgr_update_users(slurmdb_update_object_t *update, bool locked)
 					      rec->name);
 					break;
 				}
+				_delete_user_index(rec);
 				xfree(rec->old_name);
 				rec->old_name = rec->name;
 				rec->name = object->name;
 				object->name = NULL;
 				rc = _change_user_name(rec);
+				_add_user_index(rec);
 			}
 
 			if (object->default_acct) {
@@ -4330,6 +4904,7 @@ extern int assoc_mgr_update_users(slurmdb_update_object_t *update, bool locked)
 			} else
 				object->uid = pw_uid;
 			list_append(assoc_mgr_user_list, object);
+			_add_user_index(object);
 			object = NULL;
 			break;
 		case SLURMDB_REMOVE_USER:
@@ -4337,7 +4912,8 @@ extern int assoc_mgr_update_users(slurmdb_update_object_t *update, bool locked)
 				//rc = SLURM_ERROR;
 				break;
 			}
-			list_delete_item(itr);
+			_delete_user_index(rec);
+			list_delete_ptr(assoc_mgr_user_list, rec);
 			break;
 		case SLURMDB_ADD_COORD:
 			/* same as SLURMDB_REMOVE_COORD */
@@ -4362,7 +4938,6 @@ extern int assoc_mgr_update_users(slurmdb_update_object_t *update, bool locked)
 
 		slurmdb_destroy_user_rec(object);
 	}
-	list_iterator_destroy(itr);
 	if (!locked)
 		assoc_mgr_unlock(&locks);
 
@@ -4378,7 +4953,7 @@ extern int assoc_mgr_update_qos(slurmdb_update_object_t *update, bool locked)
 
 	slurmdb_assoc_rec_t *assoc = NULL;
 	int rc = SLURM_SUCCESS;
-	bool resize_qos_bitstr = 0;
+	bool resize_qos_bitstr = 0, assocs_changed = false;
 	int redo_priority = 0;
 	List remove_list = NULL;
 	List update_list = NULL;
@@ -4740,6 +5315,7 @@ extern int assoc_mgr_update_qos(slurmdb_update_object_t *update, bool locked)
 						  object->id);
 			}
 			list_iterator_destroy(assoc_itr);
+			assocs_changed = true;
 
 			break;
 		case SLURMDB_REMOVE_QOS_USAGE:
@@ -4790,6 +5366,10 @@ extern int assoc_mgr_update_qos(slurmdb_update_object_t *update, bool locked)
 
 	list_iterator_destroy(itr);
 
+	_publish_qos_view(assoc_mgr_qos_list);
+	if (assocs_changed)
+		_publish_assoc_view();
+
 	if (!locked)
 		assoc_mgr_unlock(&locks);
 
@@ -5044,8 +5624,9 @@ extern int assoc_mgr_validate_assoc_id(void *db_conn,
 				       uint32_t assoc_id,
 				       int enforce)
 {
-	slurmdb_assoc_rec_t * found_assoc = NULL;
-	assoc_mgr_lock_t locks = { .assoc = READ_LOCK };
+	assoc_mgr_view_t *v;
+	slurmdb_assoc_rec_t key = { .id = assoc_id }, *key_ptr = &key;
+	bool found = false;
 
 	/* Call assoc_mgr_refresh_lists instead of just getting the
 	   association list because we need qos and user lists before
@@ -5055,23 +5636,30 @@ extern int assoc_mgr_validate_assoc_id(void *db_conn,
 		if (assoc_mgr_refresh_lists(db_conn, 0) == SLURM_ERROR)
 			return SLURM_ERROR;
 
-	assoc_mgr_lock(&locks);
-	if ((!assoc_mgr_assoc_list
-	     || !list_count(assoc_mgr_assoc_list))
-	    && !(enforce & ACCOUNTING_ENFORCE_ASSOCS)) {
-		assoc_mgr_unlock(&locks);
+	v = _view_get(VIEW_ASSOC);
+	if ((!v || !v->assoc_cnt) && !(enforce & ACCOUNTING_ENFORCE_ASSOCS))
 		return SLURM_SUCCESS;
-	}
 
-	found_assoc = _find_assoc_rec_id(assoc_id);
-	assoc_mgr_unlock(&locks);
+	if (v && bsearch(&key_ptr, v->assocs, v->assoc_cnt,
+			 sizeof(slurmdb_assoc_rec_t *), _cmp_view_assoc_id))
+		found = true;
 
-	if (found_assoc || !(enforce & ACCOUNTING_ENFORCE_ASSOCS))
+	if (found || !(enforce & ACCOUNTING_ENFORCE_ASSOCS))
 		return SLURM_SUCCESS;
 
 	return SLURM_ERROR;
 }
 
+extern char *assoc_mgr_get_qos_name(uint32_t qos_id)
+{
+	assoc_mgr_view_t *v = _view_get(VIEW_QOS);
+
+	if (v && (qos_id < v->qos_cnt) && v->qos[qos_id])
+		return xstrdup(v->qos[qos_id]->name);
+
+	return NULL;
+}
+
 extern void assoc_mgr_clear_used_info(void)
 {
 	ListIterator itr = NULL;
@@ -5947,6 +6535,7 @@ extern int load_assoc_mgr_state(bool only_tres)
 			FREE_NULL_LIST(assoc_mgr_user_list);
 			assoc_mgr_user_list = msg->my_list;
 			_post_user_list(assoc_mgr_user_list);
+			_index_user_list();
 			debug("Recovered %u users",
 			      list_count(assoc_mgr_user_list));
 			msg->my_list = NULL;
@@ -6115,6 +6704,7 @@ extern int assoc_mgr_set_missing_uids()
 			}
 		}
 		list_iterator_destroy(itr);
+		_publish_assoc_view();
 	}
 
 	if (assoc_mgr_wckey_list) {
@@ -6146,7 +6736,9 @@ extern int assoc_mgr_set_missing_uids()
 				} else {
 					debug5("%s: found uid %u for user %s",
 					       __func__, pw_uid, object->name);
+					_delete_user_index(object);
 					object->uid = pw_uid;
+					_add_user_index(object);
 				}
 			}
 		}
@@ -6180,35 +6772,39 @@ extern void assoc_mgr_normalize_assoc_shares(slurmdb_assoc_rec_t *assoc)
 extern int assoc_mgr_find_tres_pos(slurmdb_tres_rec_t *tres_rec, bool locked)
 {
 	int i, tres_pos = -1;
-	assoc_mgr_lock_t locks = { .tres = READ_LOCK };
+	assoc_mgr_view_t *v;
+	slurmdb_tres_rec_t **tres_array = assoc_mgr_tres_array;
+	int cnt = g_tres_count;
 
 	if (!tres_rec->id && !tres_rec->type)
 		return tres_pos;
 
-	if (!locked)
-		assoc_mgr_lock(&locks);
+	if (!locked) {
+		/* Read the copies in the TRES view */
+		if (!(v = _view_get(VIEW_TRES)))
+			return tres_pos;
+		tres_array = v->tres;
+		cnt = v->tres_cnt;
+	}
 
-	xassert(assoc_mgr_tres_array);
-	xassert(g_tres_count);
-	xassert(assoc_mgr_tres_array[g_tres_count - 1]);
+	xassert(tres_array);
+	xassert(cnt);
+	xassert(tres_array[cnt - 1]);
 
-	for (i = 0; i < g_tres_count; i++) {
+	for (i = 0; i < cnt; i++) {
 		if (tres_rec->id &&
-		    assoc_mgr_tres_array[i]->id == tres_rec->id) {
+		    tres_array[i]->id == tres_rec->id) {
 			tres_pos = i;
 			break;
-		} else if (!xstrcasecmp(assoc_mgr_tres_array[i]->type,
+		} else if (!xstrcasecmp(tres_array[i]->type,
 					tres_rec->type) &&
-			  !xstrcasecmp(assoc_mgr_tres_array[i]->name,
+			  !xstrcasecmp(tres_array[i]->name,
 				       tres_rec->name)) {
 			tres_pos = i;
 			break;
 		}
 	}
 
-	if (!locked)
-		assoc_mgr_unlock(&locks);
-
 	return tres_pos;
 }
 
@@ -6221,33 +6817,37 @@ extern int assoc_mgr_find_tres_pos(slurmdb_tres_rec_t *tres_rec, bool locked)
 extern int assoc_mgr_find_tres_pos2(slurmdb_tres_rec_t *tres_rec, bool locked)
 {
 	int i, len, tres_pos = -1;
-	assoc_mgr_lock_t locks = { .tres = READ_LOCK };
+	assoc_mgr_view_t *v;
+	slurmdb_tres_rec_t **tres_array = assoc_mgr_tres_array;
+	int cnt = g_tres_count;
 
 	if (!tres_rec->type)
 		return tres_pos;
 
-	if (!locked)
-		assoc_mgr_lock(&locks);
+	if (!locked) {
+		/* Read the copies in the TRES view */
+		if (!(v = _view_get(VIEW_TRES)))
+			return tres_pos;
+		tres_array = v->tres;
+		cnt = v->tres_cnt;
+	}
 
-	xassert(assoc_mgr_tres_array);
-	xassert(g_tres_count);
-	xassert(assoc_mgr_tres_array[g_tres_count - 1]);
+	xassert(tres_array);
+	xassert(cnt);
+	xassert(tres_array[cnt - 1]);
 
 	len = strlen(tres_rec->name);
-	for (i = 0; i < g_tres_count; i++) {
-		if (xstrcasecmp(assoc_mgr_tres_array[i]->type, tres_rec->type))
+	for (i = 0; i < cnt; i++) {
+		if (xstrcasecmp(tres_array[i]->type, tres_rec->type))
 			continue;
-		if (xstrncasecmp(assoc_mgr_tres_array[i]->name, tres_rec->name,
+		if (xstrncasecmp(tres_array[i]->name, tres_rec->name,
 				 len) ||
-		    (assoc_mgr_tres_array[i]->name[len] != ':'))
+		    (tres_array[i]->name[len] != ':'))
 			continue;
 		tres_pos = i;
 		break;
 	}
 
-	if (!locked)
-		assoc_mgr_unlock(&locks);
-
 	return tres_pos;
 }
 
@@ -6400,17 +7000,26 @@ extern char *assoc_mgr_make_tres_str_from_array(
 {
 	int i;
 	char *tres_str = NULL;
-	assoc_mgr_lock_t locks = { .tres = READ_LOCK };
+	assoc_mgr_view_t *v;
+	slurmdb_tres_rec_t **tres_array = assoc_mgr_tres_array;
+	char **name_array = assoc_mgr_tres_name_array;
+	int cnt = g_tres_count;
 	uint64_t count;
 
 	if (!tres_cnt)
 		return NULL;
 
-	if (!locked)
-		assoc_mgr_lock(&locks);
+	if (!locked) {
+		/* Read the copies in the TRES view */
+		if (!(v = _view_get(VIEW_TRES)))
+			return NULL;
+		tres_array = v->tres;
+		name_array = v->tres_names;
+		cnt = v->tres_cnt;
+	}
 
-	for (i = 0; i < g_tres_count; i++) {
-		if (!assoc_mgr_tres_array[i])
+	for (i = 0; i < cnt; i++) {
+		if (!tres_array[i])
 			continue;
 
 		if (flags & TRES_STR_FLAG_ALLOW_REAL) {
@@ -6429,15 +7038,15 @@ extern char *assoc_mgr_make_tres_str_from_array(
 		if (flags & TRES_STR_FLAG_SIMPLE) {
 			xstrfmtcat(tres_str, "%s%u=%"PRIu64,
 				   tres_str ? "," : "",
-				   assoc_mgr_tres_array[i]->id, count);
+				   tres_array[i]->id, count);
 		} else {
 			/* Always skip these when printing out named TRES */
 			if ((count == NO_VAL64) ||
 			    (count == INFINITE64))
 				continue;
 			if ((flags & TRES_STR_CONVERT_UNITS) &&
-			    ((assoc_mgr_tres_array[i]->id == TRES_MEM) ||
-			     !xstrcasecmp(assoc_mgr_tres_array[i]->type,"bb"))){
+			    ((tres_array[i]->id == TRES_MEM) ||
+			     !xstrcasecmp(tres_array[i]->type,"bb"))){
 				char outbuf[32];
 				convert_num_unit((double)count, outbuf,
 						 sizeof(outbuf), UNIT_MEGA,
@@ -6445,11 +7054,11 @@ extern char *assoc_mgr_make_tres_str_from_array(
 						 CONVERT_NUM_UNIT_EXACT);
 				xstrfmtcat(tres_str, "%s%s=%s",
 					   tres_str ? "," : "",
-					   assoc_mgr_tres_name_array[i],
+					   name_array[i],
 					   outbuf);
-			} else if (!xstrcasecmp(assoc_mgr_tres_array[i]->type,
+			} else if (!xstrcasecmp(tres_array[i]->type,
 						"fs") ||
-				   !xstrcasecmp(assoc_mgr_tres_array[i]->type,
+				   !xstrcasecmp(tres_array[i]->type,
 						"ic")) {
 				char outbuf[32];
 				convert_num_unit((double)count, outbuf,
@@ -6458,20 +7067,17 @@ extern char *assoc_mgr_make_tres_str_from_array(
 						 CONVERT_NUM_UNIT_EXACT);
 				xstrfmtcat(tres_str, "%s%s=%s",
 					   tres_str ? "," : "",
-					   assoc_mgr_tres_name_array[i],
+					   name_array[i],
 					   outbuf);
 			} else {
 				xstrfmtcat(tres_str, "%s%s=%"PRIu64,
 					   tres_str ? "," : "",
-					   assoc_mgr_tres_name_array[i],
+					   name_array[i],
 					   count);
 			}
 		}
 	}
 
-	if (!locked)
-		assoc_mgr_unlock(&locks);
-
 	return tres_str;
 }
 
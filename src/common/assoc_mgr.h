@@ -103,6 +103,7 @@ typedef struct {
 	void (*update_assoc_notify) (slurmdb_assoc_rec_t *rec);
 	void (*update_cluster_tres) (void);
 	void (*update_license_notify) (slurmdb_res_rec_t *rec);
+	void (*update_notify) (void);
 	void (*update_qos_notify) (slurmdb_qos_rec_t *rec);
 	void (*update_resvs) ();
 } assoc_init_args_t;
@@ -196,7 +197,9 @@ extern int assoc_mgr_fill_in_tres(void *db_conn,
  *              you need to have an assoc_mgr_lock_t READ_LOCK for
  *              associations and users while you use it before and after the
  *              return.  This is not required if using the assoc for
- *              non-pointer portions.
+ *              non-pointer portions. Without assoc_pptr and unlocked the
+ *              pointer portions are copies, valid until this thread's next
+ *              unlocked lookup.
  * RET: SLURM_SUCCESS on success, else SLURM_ERROR
  */
 extern int assoc_mgr_fill_in_assoc(void *db_conn,
@@ -234,7 +237,9 @@ extern int assoc_mgr_fill_in_user(void *db_conn, slurmdb_user_rec_t *user,
  *              this function you need to have an assoc_mgr_lock_t
  *              READ_LOCK for QOS while you use it before and after the
  *              return.  This is not required if using the assoc for
- *              non-pointer portions.
+ *              non-pointer portions. Without qos_pptr and unlocked the
+ *              pointer portions are copies, valid until this thread's next
+ *              unlocked lookup.
  * RET: SLURM_SUCCESS on success SLURM_ERROR else
  */
 extern int assoc_mgr_fill_in_qos(void *db_conn, slurmdb_qos_rec_t *qos,
@@ -386,6 +391,13 @@ extern int assoc_mgr_validate_assoc_id(void *db_conn,
 				       uint32_t assoc_id,
 				       int enforce);
 
+/*
+ * get the name of a QOS without taking the assoc_mgr locks
+ * IN:  qos_id - id of the QOS
+ * RET: xstrdup'ed name of the QOS, NULL if not found, must be xfree'd
+ */
+extern char *assoc_mgr_get_qos_name(uint32_t qos_id);
+
 /*
  * clear the used_* fields from every association,
  *	used on reconfiguration
@@ -81,7 +81,8 @@
 #define _assert_bitstr_valid(name) do { \
 	xassert((name) != NULL); \
 	xassert(_bitstr_magic(name) == BITSTR_MAGIC \
-			    || _bitstr_magic(name) == BITSTR_MAGIC_STACK); \
+			    || _bitstr_magic(name) == BITSTR_MAGIC_STACK \
+			    || _bitstr_magic(name) == BITSTR_MAGIC_RLE); \
 } while (0)
 
 /* check bit position */
@@ -97,6 +98,197 @@
 	xassert((bit) <= 0x40000000); 	\
 } while (0)
 
+/*
+ * Run-length compressed bitstrings, made by bit_compact(). The data words are
+ * replaced by a sorted list of runs of set bits, so a bitmap of a huge
+ * cluster with a few bits set takes a few dozen bytes. The magic cookie and
+ * bit count stay in the first two words, and every bit_*() function accepts
+ * either form. Operations without a run based implementation work on an
+ * expanded copy.
+ */
+typedef struct {
+	bitstr_t magic;		/* BITSTR_MAGIC_RLE */
+	bitstr_t nbits;
+	bitoff_t *runs;		/* first and last bit of each run, ascending */
+	int32_t run_cnt;
+	int32_t run_alloc;
+} bit_rle_t;
+
+#define _bit_is_rle(name)	(_bitstr_magic(name) == BITSTR_MAGIC_RLE)
+#define _bit_rle(name)		((bit_rle_t *) (name))
+#define _rle_first(r, i)	((r)->runs[2 * (i)])
+#define _rle_last(r, i)		((r)->runs[2 * (i) + 1])
+
+static bitstr_t *_rle_alloc(bitoff_t nbits)
+{
+	bit_rle_t *r = xmalloc(sizeof(*r));
+
+	r->magic = BITSTR_MAGIC_RLE;
+	r->nbits = nbits;
+	return (bitstr_t *) r;
+}
+
+/* Return the index of the first run ending at or after bit */
+static int32_t _rle_search(bit_rle_t *r, bitoff_t bit)
+{
+	int32_t lo = 0, hi = r->run_cnt, mid;
+
+	while (lo < hi) {
+		mid = (lo + hi) / 2;
+		if (_rle_last(r, mid) < bit)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	return lo;
+}
+
+/* Replace runs i ... j-1 with the new_cnt runs in new_runs */
+static void _rle_replace(bit_rle_t *r, int32_t i, int32_t j,
+			 bitoff_t *new_runs, int32_t new_cnt)
+{
+	int32_t cnt = r->run_cnt - (j - i) + new_cnt;
+
+	if (cnt > r->run_alloc) {
+		r->run_alloc = MAX(cnt, r->run_alloc * 2);
+		xrealloc(r->runs, r->run_alloc * 2 * sizeof(bitoff_t));
+	}
+	if (j != (i + new_cnt))
+		memmove(&_rle_first(r, i + new_cnt), &_rle_first(r, j),
+			(r->run_cnt - j) * 2 * sizeof(bitoff_t));
+	if (new_cnt)
+		memcpy(&_rle_first(r, i), new_runs,
+		       new_cnt * 2 * sizeof(bitoff_t));
+	r->run_cnt = cnt;
+}
+
+static int _rle_test(bit_rle_t *r, bitoff_t bit)
+{
+	int32_t i = _rle_search(r, bit);
+
+	return ((i < r->run_cnt) && (_rle_first(r, i) <= bit)) ? 1 : 0;
+}
+
+static void _rle_nset(bit_rle_t *r, bitoff_t start, bitoff_t stop)
+{
+	bitoff_t run[2] = { start, stop };
+	int32_t i = _rle_search(r, start - 1), j = i;
+
+	/* Merge with every run overlapping or adjacent to the range */
+	while ((j < r->run_cnt) && (_rle_first(r, j) <= (stop + 1)))
+		j++;
+	if (j > i) {
+		run[0] = MIN(start, _rle_first(r, i));
+		run[1] = MAX(stop, _rle_last(r, j - 1));
+	}
+	_rle_replace(r, i, j, run, 1);
+}
+
+static void _rle_nclear(bit_rle_t *r, bitoff_t start, bitoff_t stop)
+{
+	bitoff_t run[4];
+	int32_t i = _rle_search(r, start), j = i, cnt = 0;
+
+	while ((j < r->run_cnt) && (_rle_first(r, j) <= stop))
+		j++;
+	if (i == j)
+		return;
+
+	/* Keep the parts of the end runs outside of the range */
+	if (_rle_first(r, i) < start) {
+		run[2 * cnt] = _rle_first(r, i);
+		run[2 * cnt++ + 1] = start - 1;
+	}
+	if (_rle_last(r, j - 1) > stop) {
+		run[2 * cnt] = stop + 1;
+		run[2 * cnt++ + 1] = _rle_last(r, j - 1);
+	}
+	_rle_replace(r, i, j, run, cnt);
+}
+
+/* Count bits set in start ... end-1 */
+static int32_t _rle_count_range(bit_rle_t *r, bitoff_t start, bitoff_t end)
+{
+	int32_t count = 0;
+
+	for (int32_t i = _rle_search(r, start);
+	     (i < r->run_cnt) && (_rle_first(r, i) < end); i++)
+		count += MIN(_rle_last(r, i), end - 1) -
+			 MAX(_rle_first(r, i), start) + 1;
+
+	return count;
+}
+
+/* Return the first bit at or after bit with the given value in dense b */
+static bitoff_t _dense_find(bitstr_t *b, bitoff_t bit, int value)
+{
+	bitoff_t nbits = _bitstr_bits(b);
+	bitstr_t word;
+
+	while (bit < nbits) {
+		word = value ? b[_bit_word(bit)] : ~b[_bit_word(bit)];
+		if (!(bit & BITSTR_MAXPOS) && !word) {
+			bit += sizeof(bitstr_t) * 8;
+			continue;
+		}
+		if (bit_test(b, bit) == value)
+			return bit;
+		bit++;
+	}
+
+	return nbits;
+}
+
+/*
+ * Append the runs of dense bitmap b to r, or only count them if r is NULL.
+ * RETURN number of runs
+ */
+static int32_t _rle_encode(bit_rle_t *r, bitstr_t *b)
+{
+	bitoff_t run[2], nbits = _bitstr_bits(b), bit = 0;
+	int32_t cnt = 0;
+
+	while ((bit = _dense_find(b, bit, 1)) < nbits) {
+		run[0] = bit;
+		bit = _dense_find(b, bit, 0);
+		run[1] = bit - 1;
+		if (r)
+			_rle_replace(r, r->run_cnt, r->run_cnt, run, 1);
+		cnt++;
+	}
+
+	return cnt;
+}
+
+/*
+ * Return a dense copy of b if it is compressed, otherwise NULL. Operations
+ * without a run based implementation apply themselves to the copy.
+ */
+static bitstr_t *_bit_inflate(bitstr_t *b)
+{
+	bit_rle_t *r;
+	bitstr_t *d;
+
+	if (!_bit_is_rle(b))
+		return NULL;
+
+	r = _bit_rle(b);
+	d = bit_alloc(r->nbits);
+	for (int32_t i = 0; i < r->run_cnt; i++)
+		bit_nset(d, _rle_first(r, i), _rle_last(r, i));
+
+	return d;
+}
+
+/* Replace the runs of compressed b with the contents of d, freeing d */
+static void _bit_deflate(bitstr_t *b, bitstr_t *d)
+{
+	_bit_rle(b)->run_cnt = 0;
+	_rle_encode(_bit_rle(b), d);
+	bit_free(d);
+}
+
 /*
  * Define slurm-specific aliases for use by plugins, see slurm_xlator.h
  * for details.
@@ -113,8 +305,10 @@ strong_alias(bit_ffc,		slurm_bit_ffc);
 strong_alias(bit_ffs,		slurm_bit_ffs);
 strong_alias(bit_free,		slurm_bit_free);
 strong_alias(bit_realloc,	slurm_bit_realloc);
+strong_alias(bit_compact,	slurm_bit_compact);
 strong_alias(bit_size,		slurm_bit_size);
 strong_alias(bit_and,		slurm_bit_and);
+strong_alias(bit_and_count,	slurm_bit_and_count);
 strong_alias(bit_not,		slurm_bit_not);
 strong_alias(bit_or,		slurm_bit_or);
 strong_alias(bit_set_count,	slurm_bit_set_count);
@@ -147,6 +341,7 @@ strong_alias(bit_nffs,		slurm_bit_nffs);
 strong_alias(bit_copybits,	slurm_bit_copybits);
 strong_alias(bit_get_bit_num,	slurm_bit_get_bit_num);
 strong_alias(bit_get_pos_num,	slurm_bit_get_pos_num);
+strong_alias(bit_simd_name,	slurm_bit_simd_name);
 
 /*
  * Allocate a bitstring.
@@ -177,6 +372,14 @@ bitstr_t *bit_realloc(bitstr_t *b, bitoff_t nbits)
 
 	_assert_bitstr_valid(b);
 	_assert_valid_size(nbits);
+	if (_bit_is_rle(b)) {
+		bit_rle_t *r = _bit_rle(b);
+
+		if (nbits < r->nbits)
+			_rle_nclear(r, nbits, r->nbits - 1);
+		r->nbits = nbits;
+		return b;
+	}
 	new = xrealloc(b, _bitstr_words(nbits) * sizeof(bitstr_t));
 
 	_assert_bitstr_valid(new);
@@ -185,6 +388,34 @@ bitstr_t *bit_realloc(bitstr_t *b, bitoff_t nbits)
 	return new;
 }
 
+/*
+ * Compress a bitstring if that saves at least half of its memory. Use for
+ * large, sparse bitmaps kept for a long time. The result works with every
+ * bit_*() function, but changes to it are slower.
+ *   b (IN)		bitstring to compress, freed if a copy is returned
+ *   RETURN		compressed copy of b, or b itself
+ */
+bitstr_t *bit_compact(bitstr_t *b)
+{
+	bitstr_t *new;
+	size_t dense_size, rle_size;
+	int32_t run_cnt;
+
+	_assert_bitstr_valid(b);
+	if (_bit_is_rle(b) || (_bitstr_magic(b) != BITSTR_MAGIC))
+		return b;
+
+	run_cnt = _rle_encode(NULL, b);
+	dense_size = _bitstr_words(_bitstr_bits(b)) * sizeof(bitstr_t);
+	rle_size = sizeof(bit_rle_t) + (run_cnt * 2 * sizeof(bitoff_t));
+	if ((rle_size * 2) > dense_size)
+		return b;
+
+	new = _rle_alloc(_bitstr_bits(b));
+	_bit_deflate(new, b);
+	return new;
+}
+
 /*
  * Free a bitstr.
  *   b (IN/OUT)	bitstr to be freed
@@ -193,7 +424,10 @@ void
 bit_free(bitstr_t *b)
 {
 	xassert(b);
-	xassert(_bitstr_magic(b) == BITSTR_MAGIC);
+	if (_bit_is_rle(b))
+		xfree(_bit_rle(b)->runs);
+	else
+		xassert(_bitstr_magic(b) == BITSTR_MAGIC);
 	_bitstr_magic(b) = 0;
 	xfree(b);
 }
@@ -221,6 +455,8 @@ bit_test(bitstr_t *b, bitoff_t bit)
 {
 	_assert_bitstr_valid(b);
 	_assert_bit_valid(b, bit);
+	if (_bit_is_rle(b))
+		return _rle_test(_bit_rle(b), bit);
 	return ((b[_bit_word(bit)] & _bit_mask(bit)) ? 1 : 0);
 }
 
@@ -234,6 +470,10 @@ bit_set(bitstr_t *b, bitoff_t bit)
 {
 	_assert_bitstr_valid(b);
 	_assert_bit_valid(b, bit);
+	if (_bit_is_rle(b)) {
+		_rle_nset(_bit_rle(b), bit, bit);
+		return;
+	}
 	b[_bit_word(bit)] |= _bit_mask(bit);
 }
 
@@ -247,6 +487,10 @@ bit_clear(bitstr_t *b, bitoff_t bit)
 {
 	_assert_bitstr_valid(b);
 	_assert_bit_valid(b, bit);
+	if (_bit_is_rle(b)) {
+		_rle_nclear(_bit_rle(b), bit, bit);
+		return;
+	}
 	b[_bit_word(bit)] &= ~_bit_mask(bit);
 }
 
@@ -262,6 +506,11 @@ bit_nset(bitstr_t *b, bitoff_t start, bitoff_t stop)
 	_assert_bitstr_valid(b);
 	_assert_bit_valid(b, start);
 	_assert_bit_valid(b, stop);
+	if (_bit_is_rle(b)) {
+		if (start <= stop)
+			_rle_nset(_bit_rle(b), start, stop);
+		return;
+	}
 
 	while (start <= stop && start % 8 > 0) 	     /* partial first byte? */
 		bit_set(b, start++);
@@ -285,6 +534,11 @@ bit_nclear(bitstr_t *b, bitoff_t start, bitoff_t stop)
 	_assert_bitstr_valid(b);
 	_assert_bit_valid(b, start);
 	_assert_bit_valid(b, stop);
+	if (_bit_is_rle(b)) {
+		if (start <= stop)
+			_rle_nclear(_bit_rle(b), start, stop);
+		return;
+	}
 
 	while (start <= stop && start % 8 > 0) 	/* partial first byte? */
 		bit_clear(b, start++);
@@ -328,6 +582,13 @@ bit_ffc(bitstr_t *b)
 	bitoff_t bit = 0, value = -1;
 
 	_assert_bitstr_valid(b);
+	if (_bit_is_rle(b)) {
+		bit_rle_t *r = _bit_rle(b);
+
+		if (r->run_cnt && !_rle_first(r, 0))
+			bit = _rle_last(r, 0) + 1;
+		return (bit < r->nbits) ? bit : -1;
+	}
 
 	while (bit < _bitstr_bits(b) && value == -1) {
 		int32_t word = _bit_word(bit);
@@ -467,6 +728,8 @@ bit_ffs(bitstr_t *b)
 	bitoff_t bit = 0, value = -1;
 
 	_assert_bitstr_valid(b);
+	if (_bit_is_rle(b))
+		return _bit_rle(b)->run_cnt ? _rle_first(_bit_rle(b), 0) : -1;
 
 	while (bit < _bitstr_bits(b) && value == -1) {
 		int32_t word = _bit_word(bit);
@@ -507,6 +770,11 @@ bit_fls(bitstr_t *b)
 	int32_t word;
 
 	_assert_bitstr_valid(b);
+	if (_bit_is_rle(b)) {
+		bit_rle_t *r = _bit_rle(b);
+
+		return r->run_cnt ? _rle_last(r, r->run_cnt - 1) : -1;
+	}
 
 	if (_bitstr_bits(b) == 0)	/* empty bitstring */
 		return -1;
@@ -577,6 +845,20 @@ bit_super_set(bitstr_t *b1, bitstr_t *b2)
 	_assert_bitstr_valid(b2);
 	xassert(_bitstr_bits(b1) == _bitstr_bits(b2));
 
+	if (_bit_is_rle(b1)) {
+		bit_rle_t *r = _bit_rle(b1);
+
+		for (int32_t i = 0; i < r->run_cnt; i++) {
+			if (bit_set_count_range(b2, _rle_first(r, i),
+						_rle_last(r, i) + 1) !=
+			    (_rle_last(r, i) - _rle_first(r, i) + 1))
+				return 0;
+		}
+		return 1;
+	}
+	if (_bit_is_rle(b2))
+		return (bit_overlap(b1, b2) == bit_set_count(b1));
+
 	for (bit = 0; bit < _bitstr_bits(b1); bit += sizeof(bitstr_t)*8) {
 		if (b1[_bit_word(bit)] != (b1[_bit_word(bit)] &
 		                           b2[_bit_word(bit)]))
@@ -593,6 +875,7 @@ extern int
 bit_equal(bitstr_t *b1, bitstr_t *b2)
 {
 	bitoff_t bit;
+	int32_t count;
 
 	_assert_bitstr_valid(b1);
 	_assert_bitstr_valid(b2);
@@ -600,6 +883,19 @@ bit_equal(bitstr_t *b1, bitstr_t *b2)
 	if (_bitstr_bits(b1) != _bitstr_bits(b2))
 		return 0;
 
+	if (_bit_is_rle(b1) && _bit_is_rle(b2)) {
+		bit_rle_t *r1 = _bit_rle(b1), *r2 = _bit_rle(b2);
+
+		return ((r1->run_cnt == r2->run_cnt) &&
+			!memcmp(r1->runs, r2->runs,
+				r1->run_cnt * 2 * sizeof(bitoff_t)));
+	}
+	if (_bit_is_rle(b1) || _bit_is_rle(b2)) {
+		count = bit_set_count(b1);
+		return ((count == bit_set_count(b2)) &&
+			(count == bit_overlap(b1, b2)));
+	}
+
 	for (bit = 0; bit < _bitstr_bits(b1); bit += sizeof(bitstr_t)*8) {
 		if (b1[_bit_word(bit)] != b2[_bit_word(bit)])
 			return 0;
@@ -608,7 +904,493 @@ bit_equal(bitstr_t *b1, bitstr_t *b2)
 	return 1;
 }
 
+#ifdef HAVE___BUILTIN_POPCOUNTLL
+#define hweight __builtin_popcountll
+#else
+/*
+ * Returns the hamming weight (i.e. the number of bits set) in a word.
+ * NOTE: This routine borrowed from Linux 4.9 <tools/lib/hweight.c>.
+ */
+static uint64_t
+hweight(uint64_t w)
+{
+        w -= (w >> 1) & 0x5555555555555555ul;
+        w =  (w & 0x3333333333333333ul) + ((w >> 2) & 0x3333333333333333ul);
+        w =  (w + (w >> 4)) & 0x0f0f0f0f0f0f0f0ful;
+        return (w * 0x0101010101010101ul) >> 56;
+}
+#endif
+
+/*
+ * Word kernels behind the bitwise operations and counts below. The select
+ * plugins and backfill apply these to core bitmaps of 100k+ bits many times
+ * per scheduling cycle, so on x86_64 AVX2 and AVX-512 versions are picked at
+ * first use based upon what the CPU supports. Setting SLURM_BITSTR_SIMD to
+ * "generic" or "avx2" in the environment caps the selection, which is used
+ * for benchmarking.
+ *
+ * All kernels work on nwords whole words starting at the first data word.
+ */
+typedef struct {
+	const char *name;
+	void (*and_words)(bitstr_t *w1, const bitstr_t *w2, int64_t nwords);
+	void (*and_not_words)(bitstr_t *w1, const bitstr_t *w2, int64_t nwords);
+	void (*or_words)(bitstr_t *w1, const bitstr_t *w2, int64_t nwords);
+	int64_t (*count)(const bitstr_t *w, int64_t nwords);
+	/* popcount(w1 & w2) */
+	int64_t (*and_count)(const bitstr_t *w1, const bitstr_t *w2,
+			     int64_t nwords);
+	/* w1 &= w2, then popcount(w1) */
+	int64_t (*and_store_count)(bitstr_t *w1, const bitstr_t *w2,
+				   int64_t nwords);
+	/* (w1 & w2) != 0 */
+	bool (*and_any)(const bitstr_t *w1, const bitstr_t *w2,
+			int64_t nwords);
+} bit_kernels_t;
+
+static void _and_generic(bitstr_t *w1, const bitstr_t *w2, int64_t nwords)
+{
+	for (int64_t i = 0; i < nwords; i++)
+		w1[i] &= w2[i];
+}
+
+static void _and_not_generic(bitstr_t *w1, const bitstr_t *w2,
+			     int64_t nwords)
+{
+	for (int64_t i = 0; i < nwords; i++)
+		w1[i] &= ~w2[i];
+}
+
+static void _or_generic(bitstr_t *w1, const bitstr_t *w2, int64_t nwords)
+{
+	for (int64_t i = 0; i < nwords; i++)
+		w1[i] |= w2[i];
+}
+
+static int64_t _count_generic(const bitstr_t *w, int64_t nwords)
+{
+	int64_t count = 0;
+
+	for (int64_t i = 0; i < nwords; i++)
+		count += hweight(w[i]);
+
+	return count;
+}
+
+static int64_t _and_count_generic(const bitstr_t *w1, const bitstr_t *w2,
+				  int64_t nwords)
+{
+	int64_t count = 0;
+
+	for (int64_t i = 0; i < nwords; i++)
+		count += hweight(w1[i] & w2[i]);
+
+	return count;
+}
+
+static int64_t _and_store_count_generic(bitstr_t *w1, const bitstr_t *w2,
+					int64_t nwords)
+{
+	int64_t count = 0;
+
+	for (int64_t i = 0; i < nwords; i++) {
+		w1[i] &= w2[i];
+		count += hweight(w1[i]);
+	}
+
+	return count;
+}
+
+static bool _and_any_generic(const bitstr_t *w1, const bitstr_t *w2,
+			     int64_t nwords)
+{
+	for (int64_t i = 0; i < nwords; i++) {
+		if (w1[i] & w2[i])
+			return true;
+	}
+
+	return false;
+}
+
+static const bit_kernels_t bit_kernels_generic = {
+	.name = "generic",
+	.and_words = _and_generic,
+	.and_not_words = _and_not_generic,
+	.or_words = _or_generic,
+	.count = _count_generic,
+	.and_count = _and_count_generic,
+	.and_store_count = _and_store_count_generic,
+	.and_any = _and_any_generic,
+};
+
+#if defined(__x86_64__) && \
+    ((defined(__clang__) && (__clang_major__ >= 6)) || \
+     (!defined(__clang__) && defined(__GNUC__) && (__GNUC__ >= 8)))
+#define BIT_SIMD_X86 1
+#include <immintrin.h>
+
+#define AVX2 __attribute__((target("avx2,popcnt")))
+#define AVX512 __attribute__((target("avx512f,avx512bw,avx512vpopcntdq")))
+
+/*
+ * AVX2 has no vector popcount, so count nibbles with a shuffle lookup and
+ * sum the bytes of each 64-bit lane (Mula's method).
+ */
+AVX2 static inline __m256i _popcnt256(__m256i v)
+{
+	const __m256i lookup = _mm256_setr_epi8(
+		0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+		0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+	const __m256i low_mask = _mm256_set1_epi8(0x0f);
+	__m256i lo = _mm256_and_si256(v, low_mask);
+	__m256i hi = _mm256_and_si256(_mm256_srli_epi16(v, 4), low_mask);
+	__m256i cnt = _mm256_add_epi8(_mm256_shuffle_epi8(lookup, lo),
+				      _mm256_shuffle_epi8(lookup, hi));
+
+	return _mm256_sad_epu8(cnt, _mm256_setzero_si256());
+}
+
+AVX2 static inline int64_t _sum256(__m256i v)
+{
+	return _mm256_extract_epi64(v, 0) + _mm256_extract_epi64(v, 1) +
+	       _mm256_extract_epi64(v, 2) + _mm256_extract_epi64(v, 3);
+}
+
+#define LOAD256(p) _mm256_loadu_si256((const __m256i *) (p))
+#define STORE256(p, v) _mm256_storeu_si256((__m256i *) (p), (v))
+
+AVX2 static void _and_avx2(bitstr_t *w1, const bitstr_t *w2, int64_t nwords)
+{
+	int64_t i;
+
+	for (i = 0; (i + 4) <= nwords; i += 4)
+		STORE256(w1 + i, _mm256_and_si256(LOAD256(w1 + i),
+						  LOAD256(w2 + i)));
+	for ( ; i < nwords; i++)
+		w1[i] &= w2[i];
+}
+
+AVX2 static void _and_not_avx2(bitstr_t *w1, const bitstr_t *w2,
+			       int64_t nwords)
+{
+	int64_t i;
+
+	for (i = 0; (i + 4) <= nwords; i += 4)
+		STORE256(w1 + i, _mm256_andnot_si256(LOAD256(w2 + i),
+						     LOAD256(w1 + i)));
+	for ( ; i < nwords; i++)
+		w1[i] &= ~w2[i];
+}
+
+AVX2 static void _or_avx2(bitstr_t *w1, const bitstr_t *w2, int64_t nwords)
+{
+	int64_t i;
+
+	for (i = 0; (i + 4) <= nwords; i += 4)
+		STORE256(w1 + i, _mm256_or_si256(LOAD256(w1 + i),
+						 LOAD256(w2 + i)));
+	for ( ; i < nwords; i++)
+		w1[i] |= w2[i];
+}
+
+AVX2 static int64_t _count_avx2(const bitstr_t *w, int64_t nwords)
+{
+	__m256i acc = _mm256_setzero_si256();
+	int64_t i;
+
+	for (i = 0; (i + 4) <= nwords; i += 4)
+		acc = _mm256_add_epi64(acc, _popcnt256(LOAD256(w + i)));
+
+	return _sum256(acc) + _count_generic(w + i, nwords - i);
+}
+
+AVX2 static int64_t _and_count_avx2(const bitstr_t *w1, const bitstr_t *w2,
+				    int64_t nwords)
+{
+	__m256i acc = _mm256_setzero_si256();
+	int64_t i;
+
+	for (i = 0; (i + 4) <= nwords; i += 4)
+		acc = _mm256_add_epi64(acc, _popcnt256(_mm256_and_si256(
+			LOAD256(w1 + i), LOAD256(w2 + i))));
+
+	return _sum256(acc) + _and_count_generic(w1 + i, w2 + i, nwords - i);
+}
 
+AVX2 static int64_t _and_store_count_avx2(bitstr_t *w1, const bitstr_t *w2,
+					  int64_t nwords)
+{
+	__m256i acc = _mm256_setzero_si256();
+	int64_t i;
+
+	for (i = 0; (i + 4) <= nwords; i += 4) {
+		__m256i v = _mm256_and_si256(LOAD256(w1 + i), LOAD256(w2 + i));
+		STORE256(w1 + i, v);
+		acc = _mm256_add_epi64(acc, _popcnt256(v));
+	}
+
+	return _sum256(acc) +
+	       _and_store_count_generic(w1 + i, w2 + i, nwords - i);
+}
+
+AVX2 static bool _and_any_avx2(const bitstr_t *w1, const bitstr_t *w2,
+			       int64_t nwords)
+{
+	int64_t i;
+
+	for (i = 0; (i + 4) <= nwords; i += 4) {
+		if (!_mm256_testz_si256(LOAD256(w1 + i), LOAD256(w2 + i)))
+			return true;
+	}
+
+	return _and_any_generic(w1 + i, w2 + i, nwords - i);
+}
+
+static const bit_kernels_t bit_kernels_avx2 = {
+	.name = "avx2",
+	.and_words = _and_avx2,
+	.and_not_words = _and_not_avx2,
+	.or_words = _or_avx2,
+	.count = _count_avx2,
+	.and_count = _and_count_avx2,
+	.and_store_count = _and_store_count_avx2,
+	.and_any = _and_any_avx2,
+};
+
+/*
+ * The AVX-512 kernels handle the trailing partial vector with masked loads
+ * and stores rather than a scalar loop.
+ */
+#define TAIL_MASK512(n) ((__mmask8) ((1U << (n)) - 1))
+
+AVX512 static void _and_avx512(bitstr_t *w1, const bitstr_t *w2,
+			       int64_t nwords)
+{
+	int64_t i;
+	__mmask8 m;
+
+	for (i = 0; (i + 8) <= nwords; i += 8)
+		_mm512_storeu_si512(w1 + i,
+				    _mm512_and_si512(_mm512_loadu_si512(w1 + i),
+						     _mm512_loadu_si512(w2 + i)));
+	if ((m = TAIL_MASK512(nwords - i)))
+		_mm512_mask_storeu_epi64(w1 + i, m, _mm512_and_si512(
+			_mm512_maskz_loadu_epi64(m, w1 + i),
+			_mm512_maskz_loadu_epi64(m, w2 + i)));
+}
+
+AVX512 static void _and_not_avx512(bitstr_t *w1, const bitstr_t *w2,
+				   int64_t nwords)
+{
+	int64_t i;
+	__mmask8 m;
+
+	for (i = 0; (i + 8) <= nwords; i += 8)
+		_mm512_storeu_si512(w1 + i, _mm512_andnot_si512(
+			_mm512_loadu_si512(w2 + i),
+			_mm512_loadu_si512(w1 + i)));
+	if ((m = TAIL_MASK512(nwords - i)))
+		_mm512_mask_storeu_epi64(w1 + i, m, _mm512_andnot_si512(
+			_mm512_maskz_loadu_epi64(m, w2 + i),
+			_mm512_maskz_loadu_epi64(m, w1 + i)));
+}
+
+AVX512 static void _or_avx512(bitstr_t *w1, const bitstr_t *w2,
+			      int64_t nwords)
+{
+	int64_t i;
+	__mmask8 m;
+
+	for (i = 0; (i + 8) <= nwords; i += 8)
+		_mm512_storeu_si512(w1 + i,
+				    _mm512_or_si512(_mm512_loadu_si512(w1 + i),
+						    _mm512_loadu_si512(w2 + i)));
+	if ((m = TAIL_MASK512(nwords - i)))
+		_mm512_mask_storeu_epi64(w1 + i, m, _mm512_or_si512(
+			_mm512_maskz_loadu_epi64(m, w1 + i),
+			_mm512_maskz_loadu_epi64(m, w2 + i)));
+}
+
+AVX512 static int64_t _count_avx512(const bitstr_t *w, int64_t nwords)
+{
+	__m512i acc = _mm512_setzero_si512();
+	int64_t i;
+	__mmask8 m;
+
+	for (i = 0; (i + 8) <= nwords; i += 8)
+		acc = _mm512_add_epi64(acc, _mm512_popcnt_epi64(
+			_mm512_loadu_si512(w + i)));
+	if ((m = TAIL_MASK512(nwords - i)))
+		acc = _mm512_add_epi64(acc, _mm512_popcnt_epi64(
+			_mm512_maskz_loadu_epi64(m, w + i)));
+
+	return _mm512_reduce_add_epi64(acc);
+}
+
+AVX512 static int64_t _and_count_avx512(const bitstr_t *w1,
+					const bitstr_t *w2, int64_t nwords)
+{
+	__m512i acc = _mm512_setzero_si512();
+	int64_t i;
+	__mmask8 m;
+
+	for (i = 0; (i + 8) <= nwords; i += 8)
+		acc = _mm512_add_epi64(acc, _mm512_popcnt_epi64(
+			_mm512_and_si512(_mm512_loadu_si512(w1 + i),
+					 _mm512_loadu_si512(w2 + i))));
+	if ((m = TAIL_MASK512(nwords - i)))
+		acc = _mm512_add_epi64(acc, _mm512_popcnt_epi64(
+			_mm512_and_si512(_mm512_maskz_loadu_epi64(m, w1 + i),
+					 _mm512_maskz_loadu_epi64(m, w2 + i))));
+
+	return _mm512_reduce_add_epi64(acc);
+}
+
+AVX512 static int64_t _and_store_count_avx512(bitstr_t *w1,
+					      const bitstr_t *w2,
+					      int64_t nwords)
+{
+	__m512i acc = _mm512_setzero_si512(), v;
+	int64_t i;
+	__mmask8 m;
+
+	for (i = 0; (i + 8) <= nwords; i += 8) {
+		v = _mm512_and_si512(_mm512_loadu_si512(w1 + i),
+				     _mm512_loadu_si512(w2 + i));
+		_mm512_storeu_si512(w1 + i, v);
+		acc = _mm512_add_epi64(acc, _mm512_popcnt_epi64(v));
+	}
+	if ((m = TAIL_MASK512(nwords - i))) {
+		v = _mm512_and_si512(_mm512_maskz_loadu_epi64(m, w1 + i),
+				     _mm512_maskz_loadu_epi64(m, w2 + i));
+		_mm512_mask_storeu_epi64(w1 + i, m, v);
+		acc = _mm512_add_epi64(acc, _mm512_popcnt_epi64(v));
+	}
+
+	return _mm512_reduce_add_epi64(acc);
+}
+
+AVX512 static bool _and_any_avx512(const bitstr_t *w1, const bitstr_t *w2,
+				   int64_t nwords)
+{
+	int64_t i;
+	__mmask8 m;
+
+	for (i = 0; (i + 8) <= nwords; i += 8) {
+		if (_mm512_test_epi64_mask(_mm512_loadu_si512(w1 + i),
+					   _mm512_loadu_si512(w2 + i)))
+			return true;
+	}
+	if ((m = TAIL_MASK512(nwords - i)))
+		return _mm512_mask_test_epi64_mask(
+			m, _mm512_maskz_loadu_epi64(m, w1 + i),
+			_mm512_maskz_loadu_epi64(m, w2 + i));
+
+	return false;
+}
+
+static const bit_kernels_t bit_kernels_avx512 = {
+	.name = "avx512",
+	.and_words = _and_avx512,
+	.and_not_words = _and_not_avx512,
+	.or_words = _or_avx512,
+	.count = _count_avx512,
+	.and_count = _and_count_avx512,
+	.and_store_count = _and_store_count_avx512,
+	.and_any = _and_any_avx512,
+};
+#endif
+
+static const bit_kernels_t *bit_kernels = NULL;
+
+static const bit_kernels_t *_bit_kernels_select(void)
+{
+	const bit_kernels_t *kernels = &bit_kernels_generic;
+#ifdef BIT_SIMD_X86
+	char *cap = getenv("SLURM_BITSTR_SIMD");
+
+	if (cap && !xstrcasecmp(cap, "generic"))
+		return kernels;
+
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("popcnt"))
+		kernels = &bit_kernels_avx2;
+	if (cap && !xstrcasecmp(cap, "avx2"))
+		return kernels;
+	if (__builtin_cpu_supports("avx512f") &&
+	    __builtin_cpu_supports("avx512bw") &&
+	    __builtin_cpu_supports("avx512vpopcntdq"))
+		kernels = &bit_kernels_avx512;
+#endif
+	return kernels;
+}
+
+/*
+ * Selection is idempotent, so threads racing here on first use all store the
+ * same pointer.
+ */
+static inline const bit_kernels_t *_kernels(void)
+{
+	if (!bit_kernels)
+		bit_kernels = _bit_kernels_select();
+	return bit_kernels;
+}
+
+/* number of data words holding bits, including a trailing partial word */
+#define _bitstr_data_words(name) \
+	(_bitstr_words(_bitstr_bits(name)) - BITSTR_OVERHEAD)
+
+/* number of data words all of whose bits are valid */
+#define _bitstr_full_words(name) (_bitstr_bits(name) >> BITSTR_SHIFT)
+
+/*
+ * Return the name of the word kernels in use: "generic", "avx2" or "avx512"
+ */
+extern const char *bit_simd_name(void)
+{
+	return _kernels()->name;
+}
+
+/*
+ * Set or clear the bits of b1 that are in the runs of compressed b2, or in
+ * the gaps between them.
+ */
+static void _bit_apply_runs(bitstr_t *b1, bitstr_t *b2, bool gaps, bool set)
+{
+	bit_rle_t *r = _bit_rle(b2);
+	bitoff_t start = 0, stop;
+
+	for (int32_t i = 0; i <= r->run_cnt; i++) {
+		if (gaps) {
+			stop = (i < r->run_cnt) ? (_rle_first(r, i) - 1) :
+						  (r->nbits - 1);
+		} else if (i < r->run_cnt) {
+			start = _rle_first(r, i);
+			stop = _rle_last(r, i);
+		} else
+			break;
+		if (start <= stop) {
+			if (set)
+				bit_nset(b1, start, stop);
+			else
+				bit_nclear(b1, start, stop);
+		}
+		if (gaps && (i < r->run_cnt))
+			start = _rle_last(r, i) + 1;
+	}
+}
+
+/*
+ * Apply a binary operation to compressed b1 through a dense copy.
+ */
+static void _bit_rle_op(void (*op)(bitstr_t *, bitstr_t *), bitstr_t *b1,
+			bitstr_t *b2)
+{
+	bitstr_t *d = _bit_inflate(b1);
+
+	op(d, b2);
+	_bit_deflate(b1, d);
+}
 
 /*
  * b1 &= b2
@@ -618,14 +1400,54 @@ bit_equal(bitstr_t *b1, bitstr_t *b2)
 void
 bit_and(bitstr_t *b1, bitstr_t *b2)
 {
-	bitoff_t bit;
+	_assert_bitstr_valid(b1);
+	_assert_bitstr_valid(b2);
+	xassert(_bitstr_bits(b1) == _bitstr_bits(b2));
+
+	if (_bit_is_rle(b2))
+		_bit_apply_runs(b1, b2, true, false);
+	else if (_bit_is_rle(b1))
+		_bit_rle_op(bit_and, b1, b2);
+	else
+		_kernels()->and_words(b1 + BITSTR_OVERHEAD,
+				      b2 + BITSTR_OVERHEAD,
+				      _bitstr_data_words(b1));
+}
+
+/*
+ * b1 &= b2, returning the number of bits set in the result
+ *   b1 (IN/OUT)	first string
+ *   b2 (IN)		second bitstring
+ *   RETURN		count of set bits in b1
+ */
+int32_t
+bit_and_count(bitstr_t *b1, bitstr_t *b2)
+{
+	int32_t count;
+	bitoff_t bit, bit_cnt;
 
 	_assert_bitstr_valid(b1);
 	_assert_bitstr_valid(b2);
 	xassert(_bitstr_bits(b1) == _bitstr_bits(b2));
 
-	for (bit = 0; bit < _bitstr_bits(b1); bit += sizeof(bitstr_t)*8)
+	if (_bit_is_rle(b1) || _bit_is_rle(b2)) {
+		bit_and(b1, b2);
+		return bit_set_count(b1);
+	}
+
+	bit_cnt = _bitstr_bits(b1);
+	count = _kernels()->and_store_count(b1 + BITSTR_OVERHEAD,
+					    b2 + BITSTR_OVERHEAD,
+					    _bitstr_full_words(b1));
+	bit = _bitstr_full_words(b1) << BITSTR_SHIFT;
+	if (bit < bit_cnt)
 		b1[_bit_word(bit)] &= b2[_bit_word(bit)];
+	for ( ; bit < bit_cnt; bit++) {
+		if (bit_test(b1, bit))
+			count++;
+	}
+
+	return count;
 }
 
 /*
@@ -635,14 +1457,18 @@ bit_and(bitstr_t *b1, bitstr_t *b2)
  */
 void bit_and_not(bitstr_t *b1, bitstr_t *b2)
 {
-	bitoff_t bit;
-
 	_assert_bitstr_valid(b1);
 	_assert_bitstr_valid(b2);
 	xassert(_bitstr_bits(b1) == _bitstr_bits(b2));
 
-	for (bit = 0; bit < _bitstr_bits(b1); bit += sizeof(bitstr_t)*8)
-		b1[_bit_word(bit)] &= ~b2[_bit_word(bit)];
+	if (_bit_is_rle(b2))
+		_bit_apply_runs(b1, b2, false, false);
+	else if (_bit_is_rle(b1))
+		_bit_rle_op(bit_and_not, b1, b2);
+	else
+		_kernels()->and_not_words(b1 + BITSTR_OVERHEAD,
+					  b2 + BITSTR_OVERHEAD,
+					  _bitstr_data_words(b1));
 }
 
 /*
@@ -656,6 +1482,15 @@ bit_not(bitstr_t *b)
 
 	_assert_bitstr_valid(b);
 
+	if (_bit_is_rle(b)) {
+		bitstr_t *old = bit_copy(b);
+
+		bit_set_all(b);
+		_bit_apply_runs(b, old, false, false);
+		bit_free(old);
+		return;
+	}
+
 	for (bit = 0; bit < _bitstr_bits(b); bit += sizeof(bitstr_t)*8)
 		b[_bit_word(bit)] = ~b[_bit_word(bit)];
 }
@@ -668,14 +1503,18 @@ bit_not(bitstr_t *b)
 void
 bit_or(bitstr_t *b1, bitstr_t *b2)
 {
-	bitoff_t bit;
-
 	_assert_bitstr_valid(b1);
 	_assert_bitstr_valid(b2);
 	xassert(_bitstr_bits(b1) == _bitstr_bits(b2));
 
-	for (bit = 0; bit < _bitstr_bits(b1); bit += sizeof(bitstr_t)*8)
-		b1[_bit_word(bit)] |= b2[_bit_word(bit)];
+	if (_bit_is_rle(b2))
+		_bit_apply_runs(b1, b2, false, true);
+	else if (_bit_is_rle(b1))
+		_bit_rle_op(bit_or, b1, b2);
+	else
+		_kernels()->or_words(b1 + BITSTR_OVERHEAD,
+				     b2 + BITSTR_OVERHEAD,
+				     _bitstr_data_words(b1));
 }
 
 /*
@@ -691,6 +1530,15 @@ void bit_or_not(bitstr_t *b1, bitstr_t *b2)
 	_assert_bitstr_valid(b2);
 	xassert(_bitstr_bits(b1) == _bitstr_bits(b2));
 
+	if (_bit_is_rle(b2)) {
+		_bit_apply_runs(b1, b2, true, true);
+		return;
+	}
+	if (_bit_is_rle(b1)) {
+		_bit_rle_op(bit_or_not, b1, b2);
+		return;
+	}
+
 	for (bit = 0; bit < _bitstr_bits(b1); bit += sizeof(bitstr_t)*8)
 		b1[_bit_word(bit)] |= ~b2[_bit_word(bit)];
 }
@@ -707,6 +1555,14 @@ bit_copy(bitstr_t *b)
 
 	_assert_bitstr_valid(b);
 
+	if (_bit_is_rle(b)) {
+		bit_rle_t *r = _bit_rle(b);
+
+		new = _rle_alloc(r->nbits);
+		_rle_replace(_bit_rle(new), 0, 0, r->runs, r->run_cnt);
+		return new;
+	}
+
 	newsize_bits  = bit_size(b);
 	len = (_bitstr_words(newsize_bits) - BITSTR_OVERHEAD)*sizeof(bitstr_t);
 	new = bit_alloc(newsize_bits);
@@ -725,27 +1581,24 @@ bit_copybits(bitstr_t *dest, bitstr_t *src)
 	_assert_bitstr_valid(src);
 	xassert(bit_size(src) == bit_size(dest));
 
+	if (_bit_is_rle(dest)) {
+		_bit_rle(dest)->run_cnt = 0;
+		if (_bit_is_rle(src))
+			bit_or(dest, src);
+		else
+			_rle_encode(_bit_rle(dest), src);
+		return;
+	}
+	if (_bit_is_rle(src)) {
+		bit_clear_all(dest);
+		_bit_apply_runs(dest, src, false, true);
+		return;
+	}
+
 	len = (_bitstr_words(bit_size(src)) - BITSTR_OVERHEAD)*sizeof(bitstr_t);
 	memcpy(&dest[BITSTR_OVERHEAD], &src[BITSTR_OVERHEAD], len);
 }
 
-#ifdef HAVE___BUILTIN_POPCOUNTLL
-#define hweight __builtin_popcountll
-#else
-/*
- * Returns the hamming weight (i.e. the number of bits set) in a word.
- * NOTE: This routine borrowed from Linux 4.9 <tools/lib/hweight.c>.
- */
-static uint64_t
-hweight(uint64_t w)
-{
-        w -= (w >> 1) & 0x5555555555555555ul;
-        w =  (w & 0x3333333333333333ul) + ((w >> 2) & 0x3333333333333333ul);
-        w =  (w + (w >> 4)) & 0x0f0f0f0f0f0f0f0ful;
-        return (w * 0x0101010101010101ul) >> 56;
-}
-#endif
-
 /*
  * Count the number of bits set in bitstring.
  *   b (IN)		bitstring to check
@@ -754,17 +1607,16 @@ hweight(uint64_t w)
 int32_t
 bit_set_count(bitstr_t *b)
 {
-	int32_t count = 0;
+	int32_t count;
 	bitoff_t bit, bit_cnt;
-	int32_t word_size = sizeof(bitstr_t) * 8;
 
 	_assert_bitstr_valid(b);
+	if (_bit_is_rle(b))
+		return _rle_count_range(_bit_rle(b), 0, _bitstr_bits(b));
 
 	bit_cnt = _bitstr_bits(b);
-	for (bit = 0; (bit + word_size) <= bit_cnt; bit += word_size) {
-		count += hweight(b[_bit_word(bit)]);
-	}
-	for ( ; bit < bit_cnt; bit++) {
+	count = _kernels()->count(b + BITSTR_OVERHEAD, _bitstr_full_words(b));
+	for (bit = _bitstr_full_words(b) << BITSTR_SHIFT; bit < bit_cnt; bit++) {
 		if (bit_test(b, bit))
 			count++;
 	}
@@ -789,13 +1641,18 @@ bit_set_count_range(bitstr_t *b, int32_t start, int32_t end)
 	_assert_bit_valid(b,start);
 
 	end = MIN(end, _bitstr_bits(b));
+	if (_bit_is_rle(b))
+		return _rle_count_range(_bit_rle(b), start, end);
 	eow = ((start+word_size-1)/word_size) * word_size;  /* end of word */
 	for ( bit = start; bit < end && bit < eow; bit++) {
 		if (bit_test(b, bit))
 			count++;
 	}
-	for (; (bit + word_size) <= end ; bit += word_size) {
-		count += hweight(b[_bit_word(bit)]);
+	if (bit < end) {
+		bitoff_t nwords = (end - bit) / word_size;
+
+		count += _kernels()->count(b + _bit_word(bit), nwords);
+		bit += nwords * word_size;
 	}
 	for ( ; bit < end; bit++) {
 		if (bit_test(b, bit))
@@ -808,25 +1665,36 @@ bit_set_count_range(bitstr_t *b, int32_t start, int32_t end)
 static int32_t _bit_overlap_internal(bitstr_t *b1, bitstr_t *b2, bool count_it)
 {
 	int32_t count = 0;
-	int64_t anded;
-	bitoff_t bit, bit_cnt;
-	int32_t word_size = sizeof(bitstr_t) * 8;
+	bitoff_t bit, bit_cnt, nwords;
 
 	_assert_bitstr_valid(b1);
 	_assert_bitstr_valid(b2);
 	xassert(_bitstr_bits(b1) == _bitstr_bits(b2));
 
-	bit_cnt = _bitstr_bits(b1);
-	for (bit = 0; bit < bit_cnt; bit += word_size) {
-		if ((bit + word_size - 1) >= bit_cnt)
-			break;
-		anded = b1[_bit_word(bit)] & b2[_bit_word(bit)];
-		if (count_it)
-			count += hweight(anded);
-		else if (anded)
-			return 1;
+	if (_bit_is_rle(b2) && !_bit_is_rle(b1))
+		return _bit_overlap_internal(b2, b1, count_it);
+	if (_bit_is_rle(b1)) {
+		bit_rle_t *r = _bit_rle(b1);
+
+		for (int32_t i = 0; i < r->run_cnt; i++) {
+			int32_t cnt = bit_set_count_range(b2, _rle_first(r, i),
+							  _rle_last(r, i) + 1);
+			if (cnt && !count_it)
+				return 1;
+			count += cnt;
+		}
+		return count;
 	}
-	for ( ; bit < bit_cnt; bit++) {
+
+	bit_cnt = _bitstr_bits(b1);
+	nwords = _bitstr_full_words(b1);
+	if (count_it)
+		count = _kernels()->and_count(b1 + BITSTR_OVERHEAD,
+					      b2 + BITSTR_OVERHEAD, nwords);
+	else if (_kernels()->and_any(b1 + BITSTR_OVERHEAD,
+				     b2 + BITSTR_OVERHEAD, nwords))
+		return 1;
+	for (bit = nwords << BITSTR_SHIFT; bit < bit_cnt; bit++) {
 		if (bit_test(b1, bit) && bit_test(b2, bit)) {
 			if (count_it)
 				count++;
@@ -995,7 +1863,7 @@ bitstr_t *
 bit_pick_cnt(bitstr_t *b, bitoff_t nbits)
 {
 	bitoff_t bit = 0, new_bits, count = 0;
-	bitstr_t *new;
+	bitstr_t *new, *d;
 	int32_t word_size = sizeof(bitstr_t) * 8;
 
 	_assert_bitstr_valid(b);
@@ -1003,6 +1871,12 @@ bit_pick_cnt(bitstr_t *b, bitoff_t nbits)
 	if (_bitstr_bits(b) < nbits)
 		return NULL;
 
+	if ((d = _bit_inflate(b))) {
+		new = bit_pick_cnt(d, nbits);
+		bit_free(d);
+		return new;
+	}
+
 	new = bit_alloc(bit_size(b));
 	if (new == NULL)
 		return NULL;
@@ -1046,9 +1920,15 @@ char *bit_fmt(char *str, int32_t len, bitstr_t *b)
 {
 	int32_t count = 0, word;
 	bitoff_t bit;
+	bitstr_t *d;
 
 	_assert_bitstr_valid(b);
 	xassert(len > 0);
+	if ((d = _bit_inflate(b))) {
+		bit_fmt(str, len, d);
+		bit_free(d);
+		return str;
+	}
 	*str = '\0';
 	for (bit = 0; bit < _bitstr_bits(b); ) {
 		word = _bit_word(bit);
@@ -1096,8 +1976,15 @@ char *bit_fmt_full(bitstr_t *b)
 	int32_t count = 0, word;
 	bitoff_t start, bit;
 	char *str = NULL, *comma = "";
+	bitstr_t *d;
 	_assert_bitstr_valid(b);
 
+	if ((d = _bit_inflate(b))) {
+		str = bit_fmt_full(d);
+		bit_free(d);
+		return str;
+	}
+
 	for (bit = 0; bit < _bitstr_bits(b); ) {
 		word = _bit_word(bit);
 		if (b[word] == 0) {
@@ -1137,8 +2024,15 @@ char *bit_fmt_range(bitstr_t *b, int offset, int len)
 	int32_t count = 0, word;
 	bitoff_t start, fini_bit, bit;
 	char *str = NULL, *comma = "";
+	bitstr_t *d;
 	_assert_bitstr_valid(b);
 
+	if ((d = _bit_inflate(b))) {
+		str = bit_fmt_range(d, offset, len);
+		bit_free(d);
+		return str;
+	}
+
 	fini_bit = MIN(_bitstr_bits(b), offset + len);
 	for (bit = offset; bit < fini_bit; ) {
 		word = _bit_word(bit);
@@ -1326,6 +2220,16 @@ int32_t *bitstr2inx(bitstr_t *b)
 		return bit_inx;
 	}
 
+	if (_bit_is_rle(b)) {
+		bit_rle_t *r = _bit_rle(b);
+
+		bit_inx = xmalloc_nz(sizeof(int32_t) * (r->run_cnt * 2 + 1));
+		for (int32_t i = 0; i < (r->run_cnt * 2); i++)
+			bit_inx[i] = r->runs[i];
+		bit_inx[r->run_cnt * 2] = -1;
+		return bit_inx;
+	}
+
 	/* worst case: every other bit set, resulting in an array of length
 	 * bitstr_bits(b) + 1 (if an odd number of elements)
 	 * + 1 (for trailing -1) */
@@ -87,6 +87,7 @@ typedef bitstr_t bitoff_t;
 /* bitstr_t signature in first word */
 #define BITSTR_MAGIC 		0x42434445
 #define BITSTR_MAGIC_STACK	0x42434446 /* signature if on stack */
+#define BITSTR_MAGIC_RLE	0x42434447 /* signature if run-length compressed */
 
 /* max bit position in word */
 #define BITSTR_MAXPOS		(sizeof(bitstr_t)*8 - 1)
@@ -111,8 +112,10 @@ bitoff_t bit_nffc(bitstr_t *b, int32_t n);
 bitoff_t bit_noc(bitstr_t *b, int32_t n, int32_t seed);
 void	bit_free(bitstr_t *b);
 bitstr_t *bit_realloc(bitstr_t *b, bitoff_t nbits);
+bitstr_t *bit_compact(bitstr_t *b);
 bitoff_t bit_size(bitstr_t *b);
 void	bit_and(bitstr_t *b1, bitstr_t *b2);
+int32_t	bit_and_count(bitstr_t *b1, bitstr_t *b2);
 void	bit_and_not(bitstr_t *b1, bitstr_t *b2);
 void	bit_not(bitstr_t *b);
 void	bit_or(bitstr_t *b1, bitstr_t *b2);
@@ -148,6 +151,7 @@ bitstr_t *bit_copy(bitstr_t *b);
 bitstr_t *bit_pick_cnt(bitstr_t *b, bitoff_t nbits);
 bitoff_t bit_get_bit_num(bitstr_t *b, int32_t pos);
 int32_t	bit_get_pos_num(bitstr_t *b, bitoff_t pos);
+const char *bit_simd_name(void);
 
 #define FREE_NULL_BITMAP(_X)		\
 	do {				\
@@ -52,6 +52,7 @@
 #include "src/common/slurm_route.h"
 #include "src/common/read_config.h"
 #include "src/common/slurm_protocol_interface.h"
+#include "src/common/timers.h"
 #include "src/common/xmalloc.h"
 #include "src/common/xstring.h"
 
@@ -106,6 +107,7 @@ void *_forward_thread(void *arg)
 	char *buf = NULL;
 	int steps = 0;
 	int start_timeout = fwd_msg->timeout;
+	struct timeval start;
 
 	/* repeat until we are sure the message was sent */
 	while ((name = hostlist_shift(hl))) {
@@ -123,8 +125,10 @@ void *_forward_thread(void *arg)
 			}
 			goto cleanup;
 		}
+		gettimeofday(&start, NULL);
 		if ((fd = slurm_open_msg_conn(&addr)) < 0) {
 			error("forward_thread to %s: %m", name);
+			route_stats_record(name, 0, true);
 
 			slurm_mutex_lock(&fwd_struct->forward_mutex);
 			mark_as_failed_forward(
@@ -183,6 +187,7 @@ void *_forward_thread(void *arg)
 				     get_buf_data(buffer),
 				     get_buf_offset(buffer)) < 0) {
 			error("forward_thread: slurm_msg_sendto: %m");
+			route_stats_record(name, 0, true);
 
 			slurm_mutex_lock(&fwd_struct->forward_mutex);
 			mark_as_failed_forward(&fwd_struct->ret_list, name,
@@ -248,7 +253,8 @@ void *_forward_thread(void *arg)
 		/*      fwd_msg->header.forward.cnt, list_count(ret_list)); */
 
 		if (!ret_list || (fwd_msg->header.forward.cnt != 0
-				  && list_count(ret_list) <= 1)) {
+				  && ret_list_node_count(ret_list) <= 1)) {
+			route_stats_record(name, 0, true);
 			slurm_mutex_lock(&fwd_struct->forward_mutex);
 			mark_as_failed_forward(&fwd_struct->ret_list, name,
 					       errno);
@@ -264,7 +270,7 @@ void *_forward_thread(void *arg)
 			}
 			goto cleanup;
 		} else if ((fwd_msg->header.forward.cnt+1)
-			  != list_count(ret_list)) {
+			  != ret_list_node_count(ret_list)) {
 			/* this should never be called since the above
 			   should catch the failed forwards and pipe
 			   them back down, but this is here so we
@@ -278,7 +284,7 @@ void *_forward_thread(void *arg)
 			error("We shouldn't be here.  We forwarded to %d "
 			      "but only got %d back",
 			      (fwd_msg->header.forward.cnt+1),
-			      list_count(ret_list));
+			      ret_list_node_count(ret_list));
 			while ((tmp = hostlist_next(host_itr))) {
 				int node_found = 0;
 				itr = list_iterator_create(ret_list);
@@ -313,6 +319,8 @@ void *_forward_thread(void *arg)
 		}
 		break;
 	}
+	route_stats_record_list(name, fwd_msg->header.forward.cnt,
+				slurm_delta_tv(&start), ret_list);
 	slurm_mutex_lock(&fwd_struct->forward_mutex);
 	if (ret_list) {
 		while ((ret_data_info = list_pop(ret_list)) != NULL) {
@@ -346,6 +354,7 @@ void *_fwd_tree_thread(void *arg)
 	char *name = NULL;
 	char *buf = NULL;
 	slurm_msg_t send_msg;
+	struct timeval start;
 
 	slurm_msg_t_init(&send_msg);
 	send_msg.msg_type = fwd_tree->orig_msg->msg_type;
@@ -383,13 +392,16 @@ void *_fwd_tree_thread(void *arg)
 		} else
 			debug3("Tree sending to %s", name);
 
+		gettimeofday(&start, NULL);
 		ret_list = slurm_send_addr_recv_msgs(&send_msg, name,
 						     fwd_tree->timeout);
+		route_stats_record_list(name, send_msg.forward.cnt,
+					slurm_delta_tv(&start), ret_list);
 
 		xfree(send_msg.forward.nodelist);
 
 		if (ret_list) {
-			int ret_cnt = list_count(ret_list);
+			int ret_cnt = ret_list_node_count(ret_list);
 			/* This is most common if a slurmd is running
 			   an older version of Slurm than the
 			   originator of the message.
@@ -408,7 +420,7 @@ void *_fwd_tree_thread(void *arg)
 						list_next(itr))) {
 						if (xstrcmp(ret_data_info->
 							    node_name, name))
-							hostlist_delete_host(
+							hostlist_delete(
 								fwd_tree->
 								tree_hl,
 								ret_data_info->
@@ -543,7 +555,8 @@ static void _forward_msg_internal(hostlist_t hl, hostlist_t* sp_hl,
 		       sizeof(slurm_addr_t));
 
 		fwd_msg->header.version = header->version;
-		fwd_msg->header.flags = header->flags;
+		/* Forwarded connections are never reused */
+		fwd_msg->header.flags = header->flags & ~SLURM_MSG_KEEP_ALIVE;
 		fwd_msg->header.msg_type = header->msg_type;
 		fwd_msg->header.body_length = header->body_length;
 		fwd_msg->header.ret_list = NULL;
@@ -669,11 +682,11 @@ extern List start_msg_tree(hostlist_t hl, slurm_msg_t *msg, int timeout)
 
 	slurm_mutex_lock(&tree_mutex);
 
-	count = list_count(ret_list);
+	count = ret_list_node_count(ret_list);
 	debug2("Tree head got back %d looking for %d", count, host_count);
 	while (thr_count > 0) {
 		slurm_cond_wait(&notify, &tree_mutex);
-		count = list_count(ret_list);
+		count = ret_list_node_count(ret_list);
 		debug2("Tree head got back %d", count);
 	}
 	xassert(count >= host_count);	/* Tree head did not get all responses,
@@ -711,6 +724,78 @@ extern void mark_as_failed_forward(List *ret_list, char *node_name, int err)
 	return;
 }
 
+/*
+ * Replace the successful RESPONSE_SLURM_RC replies in ret_list with one
+ * RESPONSE_FORWARD_AGGREGATE entry per return code, naming all of their
+ * nodes, so a large tree reports only the nodes with something to say.
+ */
+static void _aggregate_ret_list(List ret_list)
+{
+	ret_data_info_t *ret_data_info;
+	return_code_msg_t *rc_msg;
+	ListIterator itr;
+	hostlist_t hl = NULL;
+	int merged = 0;
+
+	itr = list_iterator_create(ret_list);
+	while ((ret_data_info = list_next(itr))) {
+		if (ret_data_info->err || !ret_data_info->node_name ||
+		    !ret_data_info->data ||
+		    ((ret_data_info->type != RESPONSE_SLURM_RC) &&
+		     (ret_data_info->type != RESPONSE_FORWARD_AGGREGATE)))
+			continue;
+		rc_msg = ret_data_info->data;
+		if (rc_msg->return_code != SLURM_SUCCESS)
+			continue;
+		if (!hl)
+			hl = hostlist_create(NULL);
+		hostlist_push(hl, ret_data_info->node_name);
+		list_delete_item(itr);
+		merged++;
+	}
+	list_iterator_destroy(itr);
+
+	if (!hl)
+		return;
+
+	rc_msg = xmalloc(sizeof(*rc_msg));
+	rc_msg->return_code = SLURM_SUCCESS;
+	ret_data_info = xmalloc(sizeof(*ret_data_info));
+	ret_data_info->type = RESPONSE_FORWARD_AGGREGATE;
+	ret_data_info->data = rc_msg;
+	ret_data_info->node_name = hostlist_ranged_string_xmalloc(hl);
+	list_append(ret_list, ret_data_info);
+	debug2("%s: merged %d replies for %d nodes", __func__, merged,
+	       hostlist_count(hl));
+	hostlist_destroy(hl);
+}
+
+extern int ret_list_node_count(List ret_list)
+{
+	ret_data_info_t *ret_data_info;
+	ListIterator itr;
+	hostlist_t hl;
+	int count = 0;
+
+	if (!ret_list)
+		return 0;
+
+	itr = list_iterator_create(ret_list);
+	while ((ret_data_info = list_next(itr))) {
+		if ((ret_data_info->type != RESPONSE_FORWARD_AGGREGATE) ||
+		    !ret_data_info->node_name) {
+			count++;
+			continue;
+		}
+		hl = hostlist_create(ret_data_info->node_name);
+		count += hostlist_count(hl);
+		hostlist_destroy(hl);
+	}
+	list_iterator_destroy(itr);
+
+	return count;
+}
+
 extern void forward_wait(slurm_msg_t * msg)
 {
 	int count = 0;
@@ -721,7 +806,7 @@ extern void forward_wait(slurm_msg_t * msg)
 		slurm_mutex_lock(&msg->forward_struct->forward_mutex);
 		count = 0;
 		if (msg->ret_list != NULL)
-			count = list_count(msg->ret_list);
+			count = ret_list_node_count(msg->ret_list);
 
 		debug2("Got back %d", count);
 		while ((count < msg->forward_struct->fwd_cnt)) {
@@ -729,11 +814,13 @@ extern void forward_wait(slurm_msg_t * msg)
 					&msg->forward_struct->forward_mutex);
 
 			if (msg->ret_list != NULL) {
-				count = list_count(msg->ret_list);
+				count = ret_list_node_count(msg->ret_list);
 			}
 			debug2("Got back %d", count);
 		}
 		debug2("Got them all");
+		if (msg->forward_struct->aggregate && msg->ret_list)
+			_aggregate_ret_list(msg->ret_list);
 		slurm_mutex_unlock(&msg->forward_struct->forward_mutex);
 		destroy_forward_struct(msg->forward_struct);
 		msg->forward_struct = NULL;
@@ -111,6 +111,17 @@ extern void mark_as_failed_forward(List *ret_list, char *node_name, int err);
 
 extern void forward_wait(slurm_msg_t *msg);
 
+/*
+ * ret_list_node_count - count the nodes which responded in "ret_list"
+ *
+ * An entry of type RESPONSE_FORWARD_AGGREGATE stands for every node of its
+ * node_name hostlist expression, other entries for a single node.
+ *
+ * IN: ret_list       - List     - List of ret_data_info_t
+ * RET: node count
+ */
+extern int ret_list_node_count(List ret_list);
+
 /*
  * no_resp_forward - Used to respond for nodes not able to respond since
  *                   the parent had failed in some way
@@ -41,10 +41,12 @@
 #include <ctype.h>
 #include <errno.h>
 #include <inttypes.h>
+#include <limits.h>
 #include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdarg.h>
+#include <stddef.h>
 #include <string.h>
 #include <sys/param.h>
 #include <unistd.h>
@@ -59,6 +61,7 @@
 #include "src/common/timers.h"
 #include "src/common/working_cluster.h"
 #include "src/common/xassert.h"
+#include "src/common/xhash.h"
 #include "src/common/xmalloc.h"
 #include "src/common/xstring.h"
 
@@ -164,7 +167,9 @@ typedef struct {
 
 /* hostrange type: A single prefix with `hi' and `lo' numeric suffix values */
 typedef struct {
-	char *prefix;        /* alphanumeric prefix: */
+	/* alphanumeric prefix: interned (see _prefix_intern()) unless
+	 * singlehost is set, in which case it is a private copy */
+	char *prefix;
 
 	/* beginning (lo) and end (hi) of suffix range */
 	unsigned long lo, hi;
@@ -198,6 +203,58 @@ struct hostlist {
 	/* list of iterators */
 	struct hostlist_iterator *ilist;
 
+	/* bumped by every LOCK_HOSTLIST(), i.e. every possible change */
+	unsigned long gen;
+
+	/* lookup index for nth/find, see _hostlist_index() */
+	struct hostlist_index *index;
+};
+
+/*
+ * Interned hostrange prefix. Ranges with equal prefixes share one
+ * reference counted copy, so copying a range does not allocate and
+ * prefixes can be compared by pointer first. refcnt is updated atomically,
+ * prefix_lock is only needed to look up a prefix or drop the last reference.
+ */
+typedef struct {
+	int refcnt;
+	uint32_t len;
+	char str[];
+} prefix_atom_t;
+
+/*
+ * Lookup index over hl->hr[], built once a hostlist has seen a few
+ * nth/find calls without being modified in between. Any LOCK_HOSTLIST()
+ * bumps hl->gen, which makes the index stale; read-only callers use
+ * LOCK_HOSTLIST_RO() to keep it.
+ */
+#define HOSTLIST_INDEX_MIN_RANGES	32
+#define HOSTLIST_INDEX_MIN_LOOKUPS	4
+
+typedef struct {
+	unsigned long lo, hi;
+	unsigned long maxhi;	/* max hi over this and all earlier entries */
+} index_range_t;
+
+typedef struct {
+	const char *prefix;
+	int cnt, alloc;
+	index_range_t *ranges;	/* sorted by lo, then ridx */
+	int *ridx;		/* index into hl->hr[] of each entry */
+} index_prefix_t;
+
+typedef struct {
+	const char *name;
+	int ridx;		/* first singlehost range with this name */
+} index_single_t;
+
+struct hostlist_index {
+	unsigned long gen;	/* hl->gen this index describes */
+	int lookups;		/* lookups made at this generation */
+	int *offset;		/* offset[i]: hosts in hr[0] .. hr[i - 1] */
+	xhash_t *prefixes;	/* prefix -> index_prefix_t */
+	xhash_t *singles;	/* hostname -> index_single_t */
+	int plen_min, plen_max;	/* prefix length bounds of ranged hosts */
 };
 
 
@@ -329,6 +386,7 @@ static hostlist_t _hostlist_create(const char *, char *, char *, int);
 static void        hostlist_shift_iterators(hostlist_t, int, int, int);
 static int        _attempt_range_join(hostlist_t, int);
 static int        _is_bracket_needed(hostlist_t, int);
+static void       _hostlist_index_free(hostlist_t hl);
 
 static hostlist_iterator_t hostlist_iterator_new(void);
 static void               _iterator_advance(hostlist_iterator_t);
@@ -339,6 +397,15 @@ static int hostset_find_host(hostset_t, const char *);
 /* ------[ macros ]------ */
 
 #define LOCK_HOSTLIST(_hl)				\
+	do {						\
+		xassert(_hl != NULL);			\
+		slurm_mutex_lock(&(_hl)->mutex);		\
+		xassert((_hl)->magic == HOSTLIST_MAGIC);	\
+		(_hl)->gen++;				\
+	} while (0)
+
+/* Lock for callers that do not modify any hostrange */
+#define LOCK_HOSTLIST_RO(_hl)				\
 	do {						\
 		xassert(_hl != NULL);			\
 		slurm_mutex_lock(&(_hl)->mutex);		\
@@ -591,6 +658,88 @@ static int hostname_suffix_width(hostname_t *hn)
 }
 
 
+/* ----[ interned prefix functions ]---- */
+
+static xhash_t *prefix_table = NULL;
+static pthread_mutex_t prefix_lock = PTHREAD_MUTEX_INITIALIZER;
+
+#define PREFIX_ATOM(_str) \
+	((prefix_atom_t *) ((_str) - offsetof(prefix_atom_t, str)))
+
+/*
+ * pthread_atfork handlers:
+ */
+static void _prefix_atfork_prep(void)   { slurm_mutex_lock(&prefix_lock); }
+static void _prefix_atfork_parent(void) { slurm_mutex_unlock(&prefix_lock); }
+static void _prefix_atfork_child(void)  { slurm_mutex_unlock(&prefix_lock); }
+
+static void _prefix_atom_id(void *item, const char **key, uint32_t *key_len)
+{
+	prefix_atom_t *atom = item;
+
+	*key = atom->str;
+	*key_len = atom->len;
+}
+
+/* Return a reference to the interned copy of prefix */
+static char *_prefix_intern(const char *prefix)
+{
+	prefix_atom_t *atom;
+	uint32_t len = strlen(prefix);
+
+	slurm_mutex_lock(&prefix_lock);
+	if (!prefix_table) {
+		prefix_table = xhash_init(_prefix_atom_id, NULL);
+		pthread_atfork(_prefix_atfork_prep, _prefix_atfork_parent,
+			       _prefix_atfork_child);
+	}
+	if (!(atom = xhash_get(prefix_table, prefix, len))) {
+		if (!(atom = malloc(sizeof(*atom) + len + 1)))
+			out_of_memory("prefix intern");
+		atom->refcnt = 0;
+		atom->len = len;
+		memcpy(atom->str, prefix, len + 1);
+		xhash_add(prefix_table, atom);
+	}
+	__atomic_add_fetch(&atom->refcnt, 1, __ATOMIC_RELAXED);
+	slurm_mutex_unlock(&prefix_lock);
+
+	return atom->str;
+}
+
+/* Take another reference to an interned prefix, the caller holds one */
+static char *_prefix_ref(char *prefix)
+{
+	__atomic_add_fetch(&PREFIX_ATOM(prefix)->refcnt, 1, __ATOMIC_RELAXED);
+
+	return prefix;
+}
+
+static void _prefix_release(char *prefix)
+{
+	prefix_atom_t *atom = PREFIX_ATOM(prefix);
+	int refcnt = __atomic_load_n(&atom->refcnt, __ATOMIC_RELAXED);
+
+	/*
+	 * Only the last reference is dropped under prefix_lock, so that
+	 * _prefix_intern() can not find the atom while it is being freed.
+	 */
+	while (refcnt > 1) {
+		if (__atomic_compare_exchange_n(&atom->refcnt, &refcnt,
+						refcnt - 1, false,
+						__ATOMIC_RELEASE,
+						__ATOMIC_RELAXED))
+			return;
+	}
+
+	slurm_mutex_lock(&prefix_lock);
+	if (__atomic_sub_fetch(&atom->refcnt, 1, __ATOMIC_ACQ_REL) == 0) {
+		xhash_pop(prefix_table, atom->str, atom->len);
+		free(atom);
+	}
+	slurm_mutex_unlock(&prefix_lock);
+}
+
 /* ----[ hostrange_t functions ]---- */
 
 /* allocate a new hostrange object
@@ -642,11 +791,9 @@ static hostrange_t *hostrange_create(char *prefix, unsigned long lo,
 	xassert(prefix);
 
 	if ((new = hostrange_new()) == NULL)
-		goto error1;
-
-	if ((new->prefix = strdup(prefix)) == NULL)
-		goto error2;
+		out_of_memory("hostrange create");
 
+	new->prefix = _prefix_intern(prefix);
 	new->lo = lo;
 	new->hi = hi;
 	new->width = width;
@@ -654,11 +801,6 @@ static hostrange_t *hostrange_create(char *prefix, unsigned long lo,
 	new->singlehost = 0;
 
 	return new;
-
-error2:
-	free(new);
-error1:
-	out_of_memory("hostrange create");
 }
 
 
@@ -677,13 +819,20 @@ static unsigned long hostrange_count(hostrange_t *hr)
  */
 static hostrange_t *hostrange_copy(hostrange_t *hr)
 {
+	hostrange_t *new;
+
 	xassert(hr);
 
 	if (hr->singlehost)
 		return hostrange_create_single(hr->prefix);
-	else
-		return hostrange_create(hr->prefix, hr->lo, hr->hi,
-					hr->width);
+
+	if ((new = hostrange_new()) == NULL)
+		out_of_memory("hostrange copy");
+
+	*new = *hr;
+	new->prefix = _prefix_ref(hr->prefix);
+
+	return new;
 }
 
 
@@ -693,8 +842,10 @@ static void hostrange_destroy(hostrange_t *hr)
 {
 	if (hr == NULL)
 		return;
-	if (hr->prefix)
+	if (hr->prefix && hr->singlehost)
 		free(hr->prefix);
+	else if (hr->prefix)
+		_prefix_release(hr->prefix);
 	free(hr);
 }
 
@@ -766,7 +917,10 @@ static int hostrange_prefix_cmp(hostrange_t *h1, hostrange_t *h2)
 	if (h2 == NULL)
 		return -1;
 
-	retval = strnatcmp(h1->prefix, h2->prefix);
+	if (h1->prefix == h2->prefix)
+		retval = 0;
+	else
+		retval = strnatcmp(h1->prefix, h2->prefix);
 	return retval == 0 ? h2->singlehost - h1->singlehost : retval;
 }
 
@@ -1216,6 +1370,8 @@ static hostlist_t hostlist_new(void)
 	new->nranges = 0;
 	new->nhosts = 0;
 	new->ilist = NULL;
+	new->gen = 0;
+	new->index = NULL;
 	return new;
 
 fail2:
@@ -1360,7 +1516,6 @@ static int hostlist_insert_range(hostlist_t hl, hostrange_t *hr, int n)
  */
 static void hostlist_delete_range(hostlist_t hl, int n)
 {
-	int i;
 	hostrange_t *old;
 
 	xassert(hl);
@@ -1368,8 +1523,8 @@ static void hostlist_delete_range(hostlist_t hl, int n)
 	xassert((n < hl->nranges) && (n >= 0));
 
 	old = hl->hr[n];
-	for (i = n; i < hl->nranges - 1; i++)
-		hl->hr[i] = hl->hr[i + 1];
+	memmove(&hl->hr[n], &hl->hr[n + 1],
+		(hl->nranges - n - 1) * sizeof(hostrange_t *));
 	hl->nranges--;
 	hl->hr[hl->nranges] = NULL;
 	hostlist_shift_iterators(hl, n, 0, 1);
@@ -1901,7 +2056,7 @@ hostlist_t hostlist_copy(const hostlist_t hl)
 	if (!hl)
 		return NULL;
 
-	LOCK_HOSTLIST(hl);
+	LOCK_HOSTLIST_RO(hl);
 	if (!(new = hostlist_new()))
 		goto done;
 
@@ -1929,6 +2084,7 @@ void hostlist_destroy(hostlist_t hl)
 	for (i = 0; i < hl->nranges; i++)
 		hostrange_destroy(hl->hr[i]);
 	free(hl->hr);
+	_hostlist_index_free(hl);
 	UNLOCK_HOSTLIST(hl);
 	slurm_mutex_destroy(&hl->mutex);
 	free(hl);
@@ -1985,6 +2141,15 @@ int hostlist_push_host(hostlist_t hl, const char *str)
 	return hostlist_push_host_dims(hl, str, dims);
 }
 
+int hostlist_push_range_values(hostlist_t hl, const char *prefix,
+			       unsigned long lo, unsigned long hi, int width)
+{
+	if (!hl || !prefix || (hi < lo))
+		return -1;
+
+	return hostlist_push_hr(hl, (char *) prefix, lo, hi, width);
+}
+
 int hostlist_push_list(hostlist_t h1, hostlist_t h2)
 {
 	int i, n = 0;
@@ -2156,6 +2321,31 @@ int hostlist_pop_range_values(
 	return 1;
 }
 
+char *hostlist_shift_range_values(hostlist_t hl, unsigned long *lo,
+				  unsigned long *hi, int *width)
+{
+	hostrange_t *head;
+	char *prefix = NULL;
+
+	if (!hl || !lo || !hi || !width)
+		return NULL;
+
+	LOCK_HOSTLIST(hl);
+	if (hl->nranges > 0) {
+		head = hl->hr[0];
+		if (!(prefix = strdup(head->prefix)))
+			out_of_memory("hostlist_shift_range_values");
+		*lo = head->lo;
+		*hi = head->hi;
+		*width = head->singlehost ? -1 : head->width;
+		hl->nhosts -= hostrange_count(head);
+		hostlist_delete_range(hl, 0);
+	}
+	UNLOCK_HOSTLIST(hl);
+
+	return prefix;
+}
+
 char *hostlist_shift_range(hostlist_t hl)
 {
 	int i;
@@ -2268,25 +2458,428 @@ static char *_hostrange_string(hostrange_t *hr, int depth)
 	return strdup(buf);
 }
 
-char * hostlist_nth(hostlist_t hl, int n)
+/* ----[ hostlist lookup index ]---- */
+
+static void _index_prefix_id(void *item, const char **key, uint32_t *key_len)
 {
-	char *host = NULL;
-	int   i, count;
+	index_prefix_t *p = item;
 
-	if (!hl)
+	*key = p->prefix;
+	*key_len = strlen(p->prefix);
+}
+
+static void _index_prefix_free(void *item)
+{
+	index_prefix_t *p = item;
+
+	xfree(p->ranges);
+	xfree(p->ridx);
+	xfree(p);
+}
+
+static void _index_single_id(void *item, const char **key, uint32_t *key_len)
+{
+	index_single_t *s = item;
+
+	*key = s->name;
+	*key_len = strlen(s->name);
+}
+
+static void _index_single_free(void *item)
+{
+	xfree(item);
+}
+
+/* Order entries i and j of p by lo, then by ridx */
+static int _index_entry_cmp(index_prefix_t *p, int i, int j)
+{
+	if (p->ranges[i].lo != p->ranges[j].lo)
+		return (p->ranges[i].lo < p->ranges[j].lo) ? -1 : 1;
+	return p->ridx[i] - p->ridx[j];
+}
+
+static void _index_entry_swap(index_prefix_t *p, int i, int j)
+{
+	index_range_t range = p->ranges[i];
+	int ridx = p->ridx[i];
+
+	p->ranges[i] = p->ranges[j];
+	p->ridx[i] = p->ridx[j];
+	p->ranges[j] = range;
+	p->ridx[j] = ridx;
+}
+
+static int _index_sort_cmp(const void *a, const void *b)
+{
+	const index_range_t *r1 = a, *r2 = b;
+
+	if (r1->lo != r2->lo)
+		return (r1->lo < r2->lo) ? -1 : 1;
+	/* maxhi holds ridx until sorted */
+	return (r1->maxhi < r2->maxhi) ? -1 : (r1->maxhi > r2->maxhi);
+}
+
+static void _index_prefix_sort(void *item, void *arg)
+{
+	index_prefix_t *p = item;
+	unsigned long maxhi = 0;
+	int i;
+
+	qsort(p->ranges, p->cnt, sizeof(*p->ranges), _index_sort_cmp);
+	for (i = 0; i < p->cnt; i++) {
+		p->ridx[i] = p->ranges[i].maxhi;
+		maxhi = MAX(maxhi, p->ranges[i].hi);
+		p->ranges[i].maxhi = maxhi;
+	}
+}
+
+/*
+ * Redo maxhi after entries first to last changed, stopping past them once
+ * nothing else does
+ */
+static void _index_prefix_update_maxhi(index_prefix_t *p, int first,
+				       int last)
+{
+	unsigned long maxhi = first ? p->ranges[first - 1].maxhi : 0;
+	int i;
+
+	for (i = first; i < p->cnt; i++) {
+		maxhi = MAX(maxhi, p->ranges[i].hi);
+		if ((i > last) && (p->ranges[i].maxhi == maxhi))
+			break;
+		p->ranges[i].maxhi = maxhi;
+	}
+}
+
+static void _hostlist_index_clear(struct hostlist_index *idx)
+{
+	xfree(idx->offset);
+	xhash_free_ptr(&idx->prefixes);
+	xhash_free_ptr(&idx->singles);
+}
+
+static void _hostlist_index_free(hostlist_t hl)
+{
+	if (!hl->index)
+		return;
+	_hostlist_index_clear(hl->index);
+	xfree(hl->index);
+}
+
+static void _hostlist_index_build_hash(hostlist_t hl,
+				       struct hostlist_index *idx)
+{
+	index_prefix_t *p;
+	index_single_t *single;
+	int i, len;
+
+	idx->prefixes = xhash_init(_index_prefix_id, _index_prefix_free);
+	idx->singles = xhash_init(_index_single_id, _index_single_free);
+	idx->plen_min = INT_MAX;
+	idx->plen_max = -1;
+
+	for (i = 0; i < hl->nranges; i++) {
+		hostrange_t *hr = hl->hr[i];
+
+		if (hr->singlehost) {
+			if (xhash_get_str(idx->singles, hr->prefix))
+				continue;
+			single = xmalloc(sizeof(*single));
+			single->name = hr->prefix;
+			single->ridx = i;
+			xhash_add(idx->singles, single);
+			continue;
+		}
+
+		len = strlen(hr->prefix);
+		if (!(p = xhash_get(idx->prefixes, hr->prefix, len))) {
+			p = xmalloc(sizeof(*p));
+			p->prefix = hr->prefix;
+			xhash_add(idx->prefixes, p);
+			idx->plen_min = MIN(idx->plen_min, len);
+			idx->plen_max = MAX(idx->plen_max, len);
+		}
+		if (p->cnt == p->alloc) {
+			p->alloc = p->alloc ? (p->alloc * 2) : 4;
+			xrecalloc(p->ranges, p->alloc, sizeof(*p->ranges));
+			xrecalloc(p->ridx, p->alloc, sizeof(*p->ridx));
+		}
+		p->ranges[p->cnt].lo = hr->lo;
+		p->ranges[p->cnt].hi = hr->hi;
+		p->ranges[p->cnt].maxhi = i;
+		p->cnt++;
+	}
+
+	xhash_walk(idx->prefixes, _index_prefix_sort, NULL);
+}
+
+/*
+ * Return the lookup index of hl, or NULL if hl is too small or has not
+ * seen enough lookups since it last changed to make building one pay
+ * off. The prefix hashes are only built if want_hash is set.
+ * hl must be locked.
+ */
+static struct hostlist_index *_hostlist_index(hostlist_t hl, bool want_hash)
+{
+	struct hostlist_index *idx = hl->index;
+	int i;
+
+	if (hl->nranges < HOSTLIST_INDEX_MIN_RANGES)
 		return NULL;
-	LOCK_HOSTLIST(hl);
-	count = 0;
+
+	if (!idx)
+		idx = hl->index = xmalloc(sizeof(*idx));
+	else if (idx->gen != hl->gen)
+		_hostlist_index_clear(idx);
+	else
+		goto built;
+
+	idx->gen = hl->gen;
+	idx->lookups = 0;
+
+built:
+	if (++idx->lookups < HOSTLIST_INDEX_MIN_LOOKUPS)
+		return NULL;
+
+	if (!idx->offset) {
+		idx->offset = xcalloc(hl->nranges + 1, sizeof(int));
+		for (i = 0; i < hl->nranges; i++)
+			idx->offset[i + 1] = idx->offset[i] +
+					     hostrange_count(hl->hr[i]);
+	}
+	if (want_hash && !idx->prefixes)
+		_hostlist_index_build_hash(hl, idx);
+
+	return idx;
+}
+
+/*
+ * Find the range holding the nth host of hl, setting *count to the
+ * number of hosts in the ranges before it. Returns -1 if there is none.
+ * hl must be locked.
+ */
+static int _hostlist_locate_nth(hostlist_t hl, int n, int *count)
+{
+	struct hostlist_index *idx;
+	int i, lo, hi;
+
+	if ((n >= 0) && (idx = _hostlist_index(hl, false))) {
+		if (n >= idx->offset[hl->nranges])
+			return -1;
+		/* last range starting at or before n */
+		lo = 0;
+		hi = hl->nranges - 1;
+		while (lo < hi) {
+			i = (lo + hi + 1) / 2;
+			if (idx->offset[i] <= n)
+				lo = i;
+			else
+				hi = i - 1;
+		}
+		*count = idx->offset[lo];
+		return lo;
+	}
+
+	*count = 0;
 	for (i = 0; i < hl->nranges; i++) {
 		int num_in_range = hostrange_count(hl->hr[i]);
 
-		if (n <= (num_in_range - 1 + count)) {
-			host = _hostrange_string(hl->hr[i], n - count);
+		if (n <= (num_in_range - 1 + *count))
+			return i;
+		*count += num_in_range;
+	}
+
+	return -1;
+}
+
+/*
+ * Indexed equivalent of scanning hl->hr[] with hostrange_hn_within().
+ * The scan may rewrite hn's prefix while looking for ranges with leading
+ * zeros moved into the prefix, which only happens for single dimension
+ * names compared against a range prefix of another length. Only handle
+ * the cases where that cannot happen, returning -2 otherwise.
+ */
+static int _hostlist_index_find(hostlist_t hl, struct hostlist_index *idx,
+				hostname_t *hn, int dims)
+{
+	index_single_t *single;
+	index_prefix_t *p;
+	int best = INT_MAX, last = -1, first, i, j;
+
+	if ((dims == 1) && hostname_suffix_is_valid(hn) &&
+	    (idx->plen_max >= 0)) {
+		int len = strlen(hn->prefix);
+		if ((idx->plen_min != len) || (idx->plen_max != len))
+			return -2;
+	}
+
+	if ((single = xhash_get_str(idx->singles, hn->hostname)))
+		best = single->ridx;
+
+	if (!hostname_suffix_is_valid(hn) ||
+	    !(p = xhash_get_str(idx->prefixes, hn->prefix)))
+		return (best == INT_MAX) ? -1 : best;
+
+	/* first entry with lo > num */
+	for (i = 0, j = p->cnt; i < j; ) {
+		int mid = (i + j) / 2;
+		if (p->ranges[mid].lo <= hn->num)
+			i = mid + 1;
+		else
+			j = mid;
+	}
+	first = i;
+
+	/*
+	 * Test the ranges holding num in hr[] order, as the linear scan
+	 * would, since hostrange_hn_within() may adjust their width.
+	 */
+	while (true) {
+		int next = best;
+
+		for (i = first - 1;
+		     (i >= 0) && (p->ranges[i].maxhi >= hn->num); i--) {
+			if ((p->ranges[i].hi >= hn->num) &&
+			    (p->ridx[i] > last) && (p->ridx[i] < next))
+				next = p->ridx[i];
+		}
+		if (next == best)
 			break;
-		} else
-			count += num_in_range;
+		if (hostrange_hn_within(hl->hr[next], hn, dims))
+			return next;
+		last = next;
+	}
+
+	return (best == INT_MAX) ? -1 : best;
+}
+
+/*
+ * Return the position of hn in hl, or -1 if not found. hl must be locked.
+ */
+static int _hostlist_find_locked(hostlist_t hl, hostname_t *hn, int dims)
+{
+	struct hostlist_index *idx;
+	int i, count = 0;
+
+	if ((idx = _hostlist_index(hl, true)) &&
+	    ((i = _hostlist_index_find(hl, idx, hn, dims)) != -2)) {
+		if (i < 0)
+			return -1;
+		count = idx->offset[i];
+		goto found;
+	}
+
+	for (i = 0; i < hl->nranges; i++) {
+		if (hostrange_hn_within(hl->hr[i], hn, dims))
+			goto found;
+		count += hostrange_count(hl->hr[i]);
+	}
+
+	return -1;
+
+found:
+	if (hostname_suffix_is_valid(hn))
+		return count + hn->num - hl->hr[i]->lo;
+	return count;
+}
+
+static void _index_prefix_shift(void *item, void *arg)
+{
+	index_prefix_t *p = item;
+	int i, removed = *(int *) arg;
+
+	for (i = 0; i < p->cnt; i++)
+		if (p->ridx[i] > removed)
+			p->ridx[i]--;
+}
+
+static void _index_single_shift(void *item, void *arg)
+{
+	index_single_t *single = item;
+
+	if (single->ridx > *(int *) arg)
+		single->ridx--;
+}
+
+/*
+ * Update the index of hl for hostlist_delete_nth() about to remove host
+ * num from hr[i]. This is only worth it when the index serves finds, as
+ * for hostlist_delete_host(). Returns false if the index is to be dropped
+ * instead, as is also done when a range gets split or a single host
+ * removed. hl must be locked.
+ */
+static bool _hostlist_index_delete(hostlist_t hl, int i, unsigned long num)
+{
+	struct hostlist_index *idx = hl->index;
+	hostrange_t *hr = hl->hr[i];
+	bool removed = (hr->lo == hr->hi);
+	index_prefix_t *p;
+	int k, pos, lo, hi;
+
+	if (!idx || (idx->gen != hl->gen) || !idx->prefixes ||
+	    hr->singlehost || ((num != hr->lo) && (num != hr->hi)))
+		return false;
+
+	p = xhash_get_str(idx->prefixes, hr->prefix);
+	for (lo = 0, hi = p->cnt - 1; lo < hi; ) {
+		k = (lo + hi) / 2;
+		if ((p->ranges[k].lo < hr->lo) ||
+		    ((p->ranges[k].lo == hr->lo) && (p->ridx[k] < i)))
+			lo = k + 1;
+		else
+			hi = k;
+	}
+	k = pos = lo;
+	xassert(p->ridx[k] == i);
+
+	if (removed) {
+		p->cnt--;
+		memmove(&p->ranges[k], &p->ranges[k + 1],
+			(p->cnt - k) * sizeof(*p->ranges));
+		memmove(&p->ridx[k], &p->ridx[k + 1],
+			(p->cnt - k) * sizeof(*p->ridx));
+	} else if (num == hr->lo) {
+		/* keep the entries sorted by lo */
+		p->ranges[k].lo++;
+		for (; (k + 1 < p->cnt) &&
+		       (_index_entry_cmp(p, k, k + 1) > 0); k++)
+			_index_entry_swap(p, k, k + 1);
+	} else
+		p->ranges[k].hi--;
+
+	/* the last reference to the key may be about to go away */
+	if (!p->cnt)
+		_index_prefix_free(xhash_pop_str(idx->prefixes, hr->prefix));
+	else
+		_index_prefix_update_maxhi(p, pos, k);
+
+	if (removed) {
+		xhash_walk(idx->prefixes, _index_prefix_shift, &i);
+		xhash_walk(idx->singles, _index_single_shift, &i);
+		memmove(&idx->offset[i + 1], &idx->offset[i + 2],
+			(hl->nranges - i - 1) * sizeof(int));
+		for (k = i + 1; k < hl->nranges; k++)
+			idx->offset[k]--;
+	} else {
+		for (k = i + 1; k <= hl->nranges; k++)
+			idx->offset[k]--;
 	}
 
+	return true;
+}
+
+char * hostlist_nth(hostlist_t hl, int n)
+{
+	char *host = NULL;
+	int   i, count;
+
+	if (!hl)
+		return NULL;
+	LOCK_HOSTLIST_RO(hl);
+
+	if ((i = _hostlist_locate_nth(hl, n, &count)) >= 0)
+		host = _hostrange_string(hl->hr[i], n - count);
+
 	UNLOCK_HOSTLIST(hl);
 
 	return host;
@@ -2299,34 +2892,28 @@ int hostlist_delete_nth(hostlist_t hl, int n)
 
 	if (!hl)
 		return -1;
-	LOCK_HOSTLIST(hl);
+	LOCK_HOSTLIST_RO(hl);
 	xassert(n >= 0 && n <= hl->nhosts);
 
-	count = 0;
-
-	for (i = 0; i < hl->nranges; i++) {
-		int num_in_range = hostrange_count(hl->hr[i]);
+	if ((i = _hostlist_locate_nth(hl, n, &count)) >= 0) {
 		hostrange_t *hr = hl->hr[i];
+		unsigned long num = hr->lo + n - count;
+		hostrange_t *new;
+		bool keep_index = _hostlist_index_delete(hl, i, num);
 
-		if (n <= (num_in_range - 1 + count)) {
-			unsigned long num = hr->lo + n - count;
-			hostrange_t *new;
-
-			if (hr->singlehost) { /* this wasn't a range */
-				hostlist_delete_range(hl, i);
-			} else if ((new = hostrange_delete_host(hr, num))) {
-				hostlist_insert_range(hl, new, i + 1);
-				hostrange_destroy(new);
-			} else if (hostrange_empty(hr))
-				hostlist_delete_range(hl, i);
-
-			goto done;
-		} else
-			count += num_in_range;
+		hl->gen++;
+		if (hr->singlehost) { /* this wasn't a range */
+			hostlist_delete_range(hl, i);
+		} else if ((new = hostrange_delete_host(hr, num))) {
+			hostlist_insert_range(hl, new, i + 1);
+			hostrange_destroy(new);
+		} else if (hostrange_empty(hr))
+			hostlist_delete_range(hl, i);
 
+		if (keep_index)
+			hl->index->gen = hl->gen;
 	}
 
-done:
 	UNLOCK_HOSTLIST(hl);
 	hl->nhosts--;
 	return 1;
@@ -2338,7 +2925,7 @@ int hostlist_count(hostlist_t hl)
 	if (!hl)
 		return -1;
 
-	LOCK_HOSTLIST(hl);
+	LOCK_HOSTLIST_RO(hl);
 	retval = hl->nhosts;
 	UNLOCK_HOSTLIST(hl);
 	return retval;
@@ -2346,7 +2933,7 @@ int hostlist_count(hostlist_t hl)
 
 int hostlist_find_dims(hostlist_t hl, const char *hostname, int dims)
 {
-	int i, count, ret = -1;
+	int ret;
 	hostname_t *hn;
 
 	if (!hostname || !hl)
@@ -2357,21 +2944,10 @@ int hostlist_find_dims(hostlist_t hl, const char *hostname, int dims)
 
 	hn = hostname_create_dims(hostname, dims);
 
-	LOCK_HOSTLIST(hl);
-
-	for (i = 0, count = 0; i < hl->nranges; i++) {
-		if (hostrange_hn_within(hl->hr[i], hn, dims)) {
-			if (hostname_suffix_is_valid(hn))
-				ret = count + hn->num - hl->hr[i]->lo;
-			else
-				ret = count;
-			goto done;
-		} else
-			count += hostrange_count(hl->hr[i]);
-	}
-
-done:
+	LOCK_HOSTLIST_RO(hl);
+	ret = _hostlist_find_locked(hl, hn, dims);
 	UNLOCK_HOSTLIST(hl);
+
 	hostname_destroy(hn);
 	return ret;
 }
@@ -2573,7 +3149,7 @@ ssize_t hostlist_deranged_string_dims(
 	int i;
 	int len = 0, ret;
 
-	LOCK_HOSTLIST(hl);
+	LOCK_HOSTLIST_RO(hl);
 	for (i = 0; i < hl->nranges && len < n; i++) {
 		if (i)
 			buf[len++] = ',';
@@ -3112,7 +3688,7 @@ ssize_t hostlist_ranged_string_dims(hostlist_t hl, size_t n,
 	hostlist_base = hostlist_get_base(dims);
 
 //	START_TIMER;
-	LOCK_HOSTLIST(hl);
+	LOCK_HOSTLIST_RO(hl);
 
 	if (dims > 1 && hl->nranges) {	/* logic for block node description */
 		slurm_mutex_lock(&multi_dim_lock);
@@ -3270,7 +3846,7 @@ hostlist_iterator_t hostlist_iterator_create(hostlist_t hl)
 	if (!(i = hostlist_iterator_new()))
 		out_of_memory("hostlist_iterator_create");
 
-	LOCK_HOSTLIST(hl);
+	LOCK_HOSTLIST_RO(hl);
 	i->hl = hl;
 	i->hr = hl->hr[0];
 	i->next = hl->ilist;
@@ -3301,7 +3877,7 @@ void hostlist_iterator_destroy(hostlist_iterator_t i)
 		return;
 	/* _hostlist_iterator_destroy free's 'i' so grab the hl now */
 	hl = i->hl;
-	LOCK_HOSTLIST(hl);
+	LOCK_HOSTLIST_RO(hl);
 	_hostlist_iterator_destroy(i);
 	UNLOCK_HOSTLIST(hl);
 }
@@ -3350,7 +3926,7 @@ char *hostlist_next_dims(hostlist_iterator_t i, int dims)
 
 	xassert(i);
 	xassert(i->magic == HOSTLIST_ITR_MAGIC);
-	LOCK_HOSTLIST(i->hl);
+	LOCK_HOSTLIST_RO(i->hl);
 	_iterator_advance(i);
 
 	if (!dims)
@@ -3401,7 +3977,7 @@ char *hostlist_next_range(hostlist_iterator_t i)
 
 	xassert(i);
 	xassert(i->magic == HOSTLIST_ITR_MAGIC);
-	LOCK_HOSTLIST(i->hl);
+	LOCK_HOSTLIST_RO(i->hl);
 
 	_iterator_advance_range(i);
 
@@ -3573,23 +4149,18 @@ int hostset_insert(hostset_t set, const char *hosts)
  * */
 static int hostset_find_host(hostset_t set, const char *host)
 {
-	int i;
-	int retval = 0;
+	int retval;
 	hostname_t *hn;
-	LOCK_HOSTLIST(set->hl);
+	/*
+	 * FIXME: THIS WILL NOT ALWAYS WORK CORRECTLY IF CALLED FROM A
+	 * LOCATION THAT COULD HAVE DIFFERENT DIMENSIONS
+	 * (i.e. slurmdbd).
+	 */
+	int dims = slurmdb_setup_cluster_name_dims();
+
+	LOCK_HOSTLIST_RO(set->hl);
 	hn = hostname_create(host);
-	for (i = 0; i < set->hl->nranges; i++) {
-		/*
-		 * FIXME: THIS WILL NOT ALWAYS WORK CORRECTLY IF CALLED FROM A
-		 * LOCATION THAT COULD HAVE DIFFERENT DIMENSIONS
-		 * (i.e. slurmdbd).
-		 */
-		if (hostrange_hn_within(set->hl->hr[i], hn, 0)) {
-			retval = 1;
-			goto done;
-		}
-	}
-done:
+	retval = (_hostlist_find_locked(set->hl, hn, dims) >= 0);
 	UNLOCK_HOSTLIST(set->hl);
 	hostname_destroy(hn);
 	return retval;
@@ -181,6 +181,19 @@ int hostlist_push_host_dims(hostlist_t hl, const char *str, int dims);
 int hostlist_push_host(hostlist_t hl, const char *host);
 
 
+/* hostlist_push_range_values():
+ *
+ * Push the hosts <prefix><lo> through <prefix><hi>, numbered with at least
+ * width digits, onto the end of hostlist hl. This gives the same hostlist
+ * as pushing each of these hosts with hostlist_push_host(), as long as
+ * their names are all of one width or none of them is zero padded.
+ *
+ * Returns the number of hosts in hl, or -1 on failure.
+ */
+int hostlist_push_range_values(hostlist_t hl, const char *prefix,
+			       unsigned long lo, unsigned long hi, int width);
+
+
 /* hostlist_push_list():
  *
  * Push a hostlist (hl2) onto another list (hl1)
@@ -244,6 +257,18 @@ char * hostlist_pop_range(hostlist_t hl);
 int hostlist_pop_range_values(
 	hostlist_t hl, unsigned long *lo, unsigned long *hi);
 
+/* hostlist_shift_range_values():
+ *
+ * Shift the first range of hosts off the hostlist hl, returning its prefix
+ * and filling in lo, hi and the width of its numbers. For a host without
+ * a numeric suffix the whole name is returned and width is set to -1.
+ * Returns NULL if hl is empty.
+ *
+ * Note: Caller is responsible for freeing the returned memory.
+ */
+char *hostlist_shift_range_values(hostlist_t hl, unsigned long *lo,
+				  unsigned long *hi, int *width);
+
 /* hostlist_shift_range():
  *
  * Shift the first bracketed hostlist (improperly: range) off the
@@ -240,6 +240,7 @@ extern int reset_node_bitmap(void *void_job_ptr)
 	} else if (job_resrcs_ptr->nodes == NULL) {
 		job_resrcs_ptr->node_bitmap = bit_alloc(node_record_count);
 	}
+	job_resrcs_ptr->node_bitmap = bit_compact(job_resrcs_ptr->node_bitmap);
 
 	i = bit_set_count(job_resrcs_ptr->node_bitmap);
 	if (job_resrcs_ptr->nhosts != i) {
@@ -543,7 +544,66 @@ extern void pack_job_resources(job_resources_t *job_resrcs_ptr, buf_t *buffer,
 	int i;
 	uint32_t core_cnt = 0, sock_recs = 0;
 
-	if (protocol_version >= SLURM_MIN_PROTOCOL_VERSION) {
+	if (protocol_version >= SLURM_21_08_1_PROTOCOL_VERSION) {
+		if (job_resrcs_ptr == NULL) {
+			uint32_t empty = NO_VAL;
+			pack32(empty, buffer);
+			return;
+		}
+
+		pack32(job_resrcs_ptr->nhosts, buffer);
+		packvar32(job_resrcs_ptr->ncpus, buffer);
+		packvar32(job_resrcs_ptr->node_req, buffer);
+		packstr(job_resrcs_ptr->nodes, buffer);
+		pack8(job_resrcs_ptr->whole_node, buffer);
+
+		/* Per node counts are small, so pack them compactly */
+		packvar32_array(job_resrcs_ptr->cpu_array_reps,
+				job_resrcs_ptr->cpu_array_reps ?
+				job_resrcs_ptr->cpu_array_cnt : 0, buffer);
+		packvar16_array(job_resrcs_ptr->cpu_array_value,
+				job_resrcs_ptr->cpu_array_value ?
+				job_resrcs_ptr->cpu_array_cnt : 0, buffer);
+		packvar16_array(job_resrcs_ptr->cpus,
+				job_resrcs_ptr->cpus ?
+				job_resrcs_ptr->nhosts : 0, buffer);
+		packvar16_array(job_resrcs_ptr->cpus_used,
+				job_resrcs_ptr->cpus_used ?
+				job_resrcs_ptr->nhosts : 0, buffer);
+		packvar64_array(job_resrcs_ptr->memory_allocated,
+				job_resrcs_ptr->memory_allocated ?
+				job_resrcs_ptr->nhosts : 0, buffer);
+		packvar64_array(job_resrcs_ptr->memory_used,
+				job_resrcs_ptr->memory_used ?
+				job_resrcs_ptr->nhosts : 0, buffer);
+
+		xassert(job_resrcs_ptr->cores_per_socket);
+		xassert(job_resrcs_ptr->sock_core_rep_count);
+		xassert(job_resrcs_ptr->sockets_per_node);
+
+		for (i=0; i < job_resrcs_ptr->nhosts; i++) {
+			core_cnt += job_resrcs_ptr->sockets_per_node[i]
+				* job_resrcs_ptr->cores_per_socket[i] *
+				job_resrcs_ptr->sock_core_rep_count[i];
+			sock_recs += job_resrcs_ptr->
+				     sock_core_rep_count[i];
+			if (sock_recs >= job_resrcs_ptr->nhosts)
+				break;
+		}
+		i++;
+		packvar16_array(job_resrcs_ptr->sockets_per_node,
+				(uint32_t) i, buffer);
+		packvar16_array(job_resrcs_ptr->cores_per_socket,
+				(uint32_t) i, buffer);
+		packvar32_array(job_resrcs_ptr->sock_core_rep_count,
+				(uint32_t) i, buffer);
+
+		xassert(job_resrcs_ptr->core_bitmap);
+		xassert(job_resrcs_ptr->core_bitmap_used);
+		pack_bit_str_hex(job_resrcs_ptr->core_bitmap, buffer);
+		pack_bit_str_hex(job_resrcs_ptr->core_bitmap_used,
+				 buffer);
+	} else if (protocol_version >= SLURM_MIN_PROTOCOL_VERSION) {
 		if (job_resrcs_ptr == NULL) {
 			uint32_t empty = NO_VAL;
 			pack32(empty, buffer);
@@ -631,10 +691,72 @@ extern int unpack_job_resources(job_resources_t **job_resrcs_pptr,
 {
 	char *bit_fmt = NULL;
 	uint32_t empty, tmp32;
-	job_resources_t *job_resrcs;
+	job_resources_t *job_resrcs = NULL;
 
 	xassert(job_resrcs_pptr);
-	if (protocol_version >= SLURM_MIN_PROTOCOL_VERSION) {
+	if (protocol_version >= SLURM_21_08_1_PROTOCOL_VERSION) {
+		safe_unpack32(&empty, buffer);
+		if (empty == NO_VAL) {
+			*job_resrcs_pptr = NULL;
+			return SLURM_SUCCESS;
+		}
+
+		job_resrcs = xmalloc(sizeof(struct job_resources));
+		job_resrcs->nhosts = empty;
+		safe_unpackvar32(&job_resrcs->ncpus, buffer);
+		safe_unpackvar32(&job_resrcs->node_req, buffer);
+		safe_unpackstr_xmalloc(&job_resrcs->nodes, &tmp32, buffer);
+		safe_unpack8(&job_resrcs->whole_node, buffer);
+
+		safe_unpackvar32_array(&job_resrcs->cpu_array_reps,
+				       &tmp32, buffer);
+		if (tmp32 == 0)
+			xfree(job_resrcs->cpu_array_reps);
+		job_resrcs->cpu_array_cnt = tmp32;
+
+		safe_unpackvar16_array(&job_resrcs->cpu_array_value,
+				       &tmp32, buffer);
+		if (tmp32 == 0)
+			xfree(job_resrcs->cpu_array_value);
+
+		if (tmp32 != job_resrcs->cpu_array_cnt)
+			goto unpack_error;
+
+		safe_unpackvar16_array(&job_resrcs->cpus, &tmp32, buffer);
+		if (tmp32 == 0)
+			xfree(job_resrcs->cpus);
+		if (tmp32 != job_resrcs->nhosts)
+			goto unpack_error;
+		safe_unpackvar16_array(&job_resrcs->cpus_used, &tmp32, buffer);
+		if (tmp32 == 0)
+			xfree(job_resrcs->cpus_used);
+
+		safe_unpackvar64_array(&job_resrcs->memory_allocated,
+				       &tmp32, buffer);
+		if (tmp32 == 0)
+			xfree(job_resrcs->memory_allocated);
+		safe_unpackvar64_array(&job_resrcs->memory_used, &tmp32,
+				       buffer);
+		if (tmp32 == 0)
+			xfree(job_resrcs->memory_used);
+
+		safe_unpackvar16_array(&job_resrcs->sockets_per_node,
+				       &tmp32, buffer);
+		if (tmp32 == 0)
+			xfree(job_resrcs->sockets_per_node);
+		safe_unpackvar16_array(&job_resrcs->cores_per_socket,
+				       &tmp32, buffer);
+		if (tmp32 == 0)
+			xfree(job_resrcs->cores_per_socket);
+		safe_unpackvar32_array(&job_resrcs->sock_core_rep_count,
+				       &tmp32, buffer);
+		if (tmp32 == 0)
+			xfree(job_resrcs->sock_core_rep_count);
+
+		unpack_bit_str_hex(&job_resrcs->core_bitmap, buffer);
+		unpack_bit_str_hex(&job_resrcs->core_bitmap_used,
+				   buffer);
+	} else if (protocol_version >= SLURM_MIN_PROTOCOL_VERSION) {
 		safe_unpack32(&empty, buffer);
 		if (empty == NO_VAL) {
 			*job_resrcs_pptr = NULL;
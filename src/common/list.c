@@ -91,10 +91,21 @@ strong_alias(list_delete_item,	slurm_list_delete_item);
 
 #define list_alloc() xmalloc(sizeof(struct xlist))
 #define list_free(_l) xfree(l)
+
+#ifdef MEMORY_LEAK_DEBUG
 #define list_node_alloc() xmalloc(sizeof(struct listNode))
 #define list_node_free(_p) xfree(_p)
 #define list_iterator_alloc() xmalloc(sizeof(struct listIterator))
 #define list_iterator_free(_i) xfree(_i)
+#else
+#define list_node_alloc() _list_obj_alloc(&node_pool, &node_cache)
+#define list_node_free(_p) _list_obj_free(&node_pool, &node_cache, _p)
+#define list_iterator_alloc() _list_obj_alloc(&itr_pool, &itr_cache)
+#define list_iterator_free(_i) _list_obj_free(&itr_pool, &itr_cache, _i)
+#endif
+
+/* Number of objects in a slab and in a batch traded with the shared pool */
+#define LIST_BATCH 64
 
 /****************
  *  Data Types  *
@@ -126,6 +137,46 @@ struct xlist {
 
 typedef struct listNode * ListNode;
 
+/*
+ * List nodes and iterators are kept in per-thread caches of free objects,
+ * carved from slabs which are never given back to xmalloc(). A thread
+ * with too many free objects gives a batch to the shared pool, and one
+ * without any takes a batch from it, so queues filled by one thread and
+ * drained by another do not grow a single cache without bound.
+ */
+typedef struct list_free {
+	struct list_free     *next;         /* next free object of batch         */
+	struct list_free     *next_batch;   /* next batch, first object only     */
+} list_free_t;
+
+typedef struct {
+	size_t                size;         /* object size                       */
+	pthread_mutex_t       mutex;        /* protects batches and stats        */
+	list_free_t          *batches;      /* batches of free objects           */
+	list_alloc_stats_t    stats;
+} list_pool_t;
+
+typedef struct {
+	list_free_t          *free;         /* free objects of this thread       */
+	int                   count;        /* number of free objects            */
+	uint64_t              alloc_cnt;    /* counts not yet added to pool      */
+	uint64_t              free_cnt;
+} list_cache_t;
+
+static list_pool_t node_pool = {
+	.size = sizeof(struct listNode),
+	.mutex = PTHREAD_MUTEX_INITIALIZER,
+};
+static list_pool_t itr_pool = {
+	.size = sizeof(struct listIterator),
+	.mutex = PTHREAD_MUTEX_INITIALIZER,
+};
+static __thread list_cache_t node_cache;
+static __thread list_cache_t itr_cache;
+static __thread bool cache_registered = false;
+static pthread_key_t cache_key;
+static pthread_once_t cache_key_once = PTHREAD_ONCE_INIT;
+
 
 /****************
  *  Prototypes  *
@@ -139,6 +190,10 @@ static void *_list_append_locked(List l, void *x);
 #ifndef NDEBUG
 static int _list_mutex_is_locked (pthread_mutex_t *mutex);
 #endif
+#ifndef MEMORY_LEAK_DEBUG
+static void *_list_obj_alloc(list_pool_t *pool, list_cache_t *cache);
+static void _list_obj_free(list_pool_t *pool, list_cache_t *cache, void *obj);
+#endif
 
 /***************
  *  Functions  *
@@ -1020,3 +1075,166 @@ _list_append_locked(List l, void *x)
 
 	return v;
 }
+
+/* Add the counts of this thread's cache to its pool, with pool locked */
+static void _list_cache_count(list_pool_t *pool, list_cache_t *cache)
+{
+	pool->stats.alloc_cnt += cache->alloc_cnt;
+	pool->stats.free_cnt += cache->free_cnt;
+	cache->alloc_cnt = cache->free_cnt = 0;
+}
+
+/* list_alloc_stats()
+ */
+void
+list_alloc_stats(list_alloc_stats_t *node_stats, list_alloc_stats_t *itr_stats)
+{
+	slurm_mutex_lock(&node_pool.mutex);
+	_list_cache_count(&node_pool, &node_cache);
+	if (node_stats)
+		*node_stats = node_pool.stats;
+	slurm_mutex_unlock(&node_pool.mutex);
+
+	slurm_mutex_lock(&itr_pool.mutex);
+	_list_cache_count(&itr_pool, &itr_cache);
+	if (itr_stats)
+		*itr_stats = itr_pool.stats;
+	slurm_mutex_unlock(&itr_pool.mutex);
+}
+
+#ifndef MEMORY_LEAK_DEBUG
+/*
+ * Give all but the first [keep] free objects of [cache] to [pool].
+ */
+static void _list_cache_flush(list_pool_t *pool, list_cache_t *cache,
+			      int keep)
+{
+	list_free_t *batch, *p;
+	int n;
+
+	if (keep) {
+		for (p = cache->free, n = 1; n < keep; n++)
+			p = p->next;
+		batch = p->next;
+		p->next = NULL;
+	} else {
+		batch = cache->free;
+		cache->free = NULL;
+	}
+	cache->count = keep;
+
+	slurm_mutex_lock(&pool->mutex);
+	if (batch) {
+		batch->next_batch = pool->batches;
+		pool->batches = batch;
+		pool->stats.batch_put_cnt++;
+	}
+	_list_cache_count(pool, cache);
+	slurm_mutex_unlock(&pool->mutex);
+}
+
+/*
+ * Fill the empty [cache] with a batch from [pool], or with a new slab.
+ */
+static void _list_cache_fill(list_pool_t *pool, list_cache_t *cache)
+{
+	list_free_t *p;
+	char *slab;
+	int n;
+
+	slurm_mutex_lock(&pool->mutex);
+	_list_cache_count(pool, cache);
+	if ((p = pool->batches)) {
+		pool->batches = p->next_batch;
+		pool->stats.batch_get_cnt++;
+		slurm_mutex_unlock(&pool->mutex);
+
+		cache->free = p;
+		for (n = 1; (p = p->next); n++)
+			;
+		cache->count = n;
+		return;
+	}
+	pool->stats.slab_cnt++;
+	slurm_mutex_unlock(&pool->mutex);
+
+	slab = xmalloc_nz(pool->size * LIST_BATCH);
+	for (n = 0; n < LIST_BATCH; n++) {
+		p = (list_free_t *) (slab + (n * pool->size));
+		p->next = (n < LIST_BATCH - 1) ?
+			  (list_free_t *) (slab + ((n + 1) * pool->size)) :
+			  NULL;
+	}
+	cache->free = (list_free_t *) slab;
+	cache->count = LIST_BATCH;
+}
+
+/* Give the caches of an exiting thread back to the shared pools */
+static void _list_cache_destroy(void *arg)
+{
+	cache_registered = false;
+	_list_cache_flush(&node_pool, &node_cache, 0);
+	_list_cache_flush(&itr_pool, &itr_cache, 0);
+}
+
+static void _list_atfork_prep(void)
+{
+	slurm_mutex_lock(&node_pool.mutex);
+	slurm_mutex_lock(&itr_pool.mutex);
+}
+
+static void _list_atfork_parent(void)
+{
+	slurm_mutex_unlock(&itr_pool.mutex);
+	slurm_mutex_unlock(&node_pool.mutex);
+}
+
+static void _list_cache_init(void)
+{
+	if (pthread_key_create(&cache_key, _list_cache_destroy))
+		fatal("%s: pthread_key_create: %m", __func__);
+	pthread_atfork(_list_atfork_prep, _list_atfork_parent,
+		       _list_atfork_parent);
+}
+
+/*
+ * Have the thread's caches given back when it exits.
+ */
+static void _list_cache_register(void)
+{
+	pthread_once(&cache_key_once, _list_cache_init);
+	pthread_setspecific(cache_key, &cache_registered);
+	cache_registered = true;
+}
+
+static void *_list_obj_alloc(list_pool_t *pool, list_cache_t *cache)
+{
+	list_free_t *p;
+
+	if (!cache_registered)
+		_list_cache_register();
+	if (!cache->free)
+		_list_cache_fill(pool, cache);
+
+	p = cache->free;
+	cache->free = p->next;
+	cache->count--;
+	cache->alloc_cnt++;
+
+	return p;
+}
+
+static void _list_obj_free(list_pool_t *pool, list_cache_t *cache, void *obj)
+{
+	list_free_t *p = obj;
+
+	if (!cache_registered)
+		_list_cache_register();
+
+	p->next = cache->free;
+	cache->free = p;
+	cache->free_cnt++;
+	if (++cache->count >= (2 * LIST_BATCH))
+		_list_cache_flush(pool, cache, LIST_BATCH);
+}
+#endif
@@ -36,6 +36,8 @@
 #ifndef LSD_LIST_H
 #define LSD_LIST_H
 
+#include <inttypes.h>
+
 #define FREE_NULL_LIST(_X)			\
 	do {					\
 		if (_X) list_destroy (_X);	\
@@ -130,6 +132,26 @@ int list_count(List l);
  */
 List list_shallow_copy(List l);
 
+/*
+ *  Allocation counts for list nodes or list iterators.
+ */
+typedef struct {
+	uint64_t alloc_cnt;	/* objects allocated */
+	uint64_t free_cnt;	/* objects freed */
+	uint64_t slab_cnt;	/* slabs of objects taken from xmalloc() */
+	uint64_t batch_get_cnt;	/* batches taken from the shared pool */
+	uint64_t batch_put_cnt;	/* batches given back to the shared pool */
+} list_alloc_stats_t;
+
+/*
+ *  Fills in [node_stats] and [itr_stats] (either may be NULL) with the
+ *    allocation counts of list nodes and list iterators.
+ *  Note: Counts of other running threads are only added when they next
+ *    take or give back a batch of free objects, or exit.
+ */
+void list_alloc_stats(list_alloc_stats_t *node_stats,
+		      list_alloc_stats_t *itr_stats);
+
 /***************************
  *  List Access Functions  *
  ***************************/
@@ -0,0 +1,357 @@
+/*****************************************************************************\
+ *  msg_compress.c - compression of message bodies
+ *****************************************************************************
+ *  This file is part of Slurm, a resource management program.
+ *  For details, see <https://slurm.schedmd.com/>.
+ *  Please also read the included file: DISCLAIMER.
+ *
+ *  Slurm is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 2 of the License, or (at your option)
+ *  any later version.
+ *
+ *  In addition, as a special exception, the copyright holders give permission
+ *  to link the code of portions of this program with the OpenSSL library under
+ *  certain conditions as described in each individual source file, and
+ *  distribute linked combinations including the two. You must obey the GNU
+ *  General Public License in all respects for all of the code used other than
+ *  OpenSSL. If you modify file(s) with this exception, you may extend this
+ *  exception to your version of the file(s), but you are not obligated to do
+ *  so. If you do not wish to do so, delete this exception statement from your
+ *  version.  If you delete this exception statement from all source files in
+ *  the program, then also delete it here.
+ *
+ *  Slurm is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with Slurm; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA.
+\*****************************************************************************/
+
+#include "config.h"
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#if HAVE_LIBZ
+# include <zlib.h>
+#endif
+
+#if HAVE_LZ4
+# include <lz4.h>
+#endif
+
+#include "slurm/slurm_errno.h"
+#include "src/common/log.h"
+#include "src/common/macros.h"
+#include "src/common/msg_compress.h"
+#include "src/common/read_config.h"
+#include "src/common/slurm_protocol_common.h"
+#include "src/common/slurm_protocol_defs.h"
+#include "src/common/xmalloc.h"
+#include "src/common/xstring.h"
+
+/* Codec and original length in front of a compressed body */
+#define COMPRESS_HDR_LEN	5
+#define COMPRESS_MIN_DEFAULT	(16 * 1024)
+/*
+ * Largest body decompressed, and so compressed. Larger bodies are sent as
+ * they are, up to MAX_MSG_SIZE in slurm_protocol_socket.c.
+ */
+#define DECOMPRESS_MAX_LEN	(256 * 1024 * 1024)
+/* Largest ratio of original to compressed length each codec can reach */
+#define LZ4_MAX_RATIO		255
+#define ZLIB_MAX_RATIO		1032
+
+static pthread_mutex_t stats_mutex = PTHREAD_MUTEX_INITIALIZER;
+static msg_compress_stats_t stats;
+
+static uint64_t _cpu_usec(void)
+{
+	struct timespec ts;
+
+	if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts))
+		return 0;
+	return ((uint64_t) ts.tv_sec * 1000000) + (ts.tv_nsec / 1000);
+}
+
+static uint16_t _accept_flag(uint8_t type)
+{
+	if (type == COMPRESS_LZ4)
+		return SLURM_MSG_ACCEPT_LZ4;
+	if (type == COMPRESS_ZLIB)
+		return SLURM_MSG_ACCEPT_ZLIB;
+	return 0;
+}
+
+/*
+ * Return the codec set by CommunicationParameters=compress=, lz4 by
+ * default, or COMPRESS_OFF if it is not built in
+ */
+static uint8_t _compress_type(void)
+{
+	uint8_t type = COMPRESS_LZ4;
+	char *tmp_ptr;
+
+	if ((tmp_ptr = xstrcasestr(slurm_conf.comm_params, "compress="))) {
+		tmp_ptr += 9;
+		if (!xstrncasecmp(tmp_ptr, "lz4", 3))
+			type = COMPRESS_LZ4;
+		else if (!xstrncasecmp(tmp_ptr, "zlib", 4))
+			type = COMPRESS_ZLIB;
+		else
+			type = COMPRESS_OFF;
+	}
+	if (!(_accept_flag(type) & msg_compress_accept()))
+		return COMPRESS_OFF;
+	return type;
+}
+
+/* Return the smallest body to compress */
+static uint32_t _compress_min(void)
+{
+	char *tmp_ptr;
+
+	if ((tmp_ptr = xstrcasestr(slurm_conf.comm_params, "compress_min=")))
+		return MAX(strtoul(tmp_ptr + 13, NULL, 10),
+			   COMPRESS_HDR_LEN + 1);
+	return COMPRESS_MIN_DEFAULT;
+}
+
+static uint32_t _compress_lz4(char *in, uint32_t in_len, char *out,
+			      uint32_t out_len)
+{
+#if HAVE_LZ4
+	int rc = LZ4_compress_default(in, out, in_len, out_len);
+
+	return (rc > 0) ? rc : 0;
+#else
+	return 0;
+#endif
+}
+
+static uint32_t _compress_zlib(char *in, uint32_t in_len, char *out,
+			       uint32_t out_len)
+{
+#if HAVE_LIBZ
+	uLongf len = out_len;
+
+	if (compress2((Bytef *) out, &len, (Bytef *) in, in_len,
+		      Z_BEST_SPEED) != Z_OK)
+		return 0;
+	return len;
+#else
+	return 0;
+#endif
+}
+
+static int _decompress_lz4(char *in, uint32_t in_len, char *out,
+			   uint32_t out_len)
+{
+#if HAVE_LZ4
+	if (LZ4_decompress_safe(in, out, in_len, out_len) == out_len)
+		return SLURM_SUCCESS;
+#endif
+	return SLURM_ERROR;
+}
+
+static int _decompress_zlib(char *in, uint32_t in_len, char *out,
+			    uint32_t out_len)
+{
+#if HAVE_LIBZ
+	uLongf len = out_len;
+
+	if ((uncompress((Bytef *) out, &len, (Bytef *) in, in_len) == Z_OK) &&
+	    (len == out_len))
+		return SLURM_SUCCESS;
+#endif
+	return SLURM_ERROR;
+}
+
+/* Return the largest output of compressing in_len bytes with codec */
+static uint32_t _compress_bound(uint8_t codec, uint32_t in_len)
+{
+#if HAVE_LZ4
+	if (codec == COMPRESS_LZ4)
+		return LZ4_compressBound(in_len);
+#endif
+#if HAVE_LIBZ
+	if (codec == COMPRESS_ZLIB)
+		return compressBound(in_len);
+#endif
+	return 0;
+}
+
+/* Return the largest original length of in_len bytes compressed by codec */
+static uint64_t _decompress_bound(uint8_t codec, uint32_t in_len)
+{
+	if (codec == COMPRESS_LZ4)
+		return (uint64_t) in_len * LZ4_MAX_RATIO;
+	if (codec == COMPRESS_ZLIB)
+		return (uint64_t) in_len * ZLIB_MAX_RATIO;
+	return 0;
+}
+
+extern uint16_t msg_compress_accept(void)
+{
+	uint16_t flags = 0;
+
+#if HAVE_LZ4
+	flags |= SLURM_MSG_ACCEPT_LZ4;
+#endif
+#if HAVE_LIBZ
+	flags |= SLURM_MSG_ACCEPT_ZLIB;
+#endif
+	return flags;
+}
+
+extern buf_t *msg_compress(char *body, uint32_t body_len, uint16_t peer_flags)
+{
+	uint32_t bound, out_len;
+	uint64_t start;
+	uint8_t codec = _compress_type();
+	buf_t *buffer;
+
+	if (!(_accept_flag(codec) & peer_flags) ||
+	    (body_len < _compress_min()) || (body_len > DECOMPRESS_MAX_LEN))
+		return NULL;
+	if (!(bound = _compress_bound(codec, body_len)) ||
+	    (bound > (MAX_BUF_SIZE - COMPRESS_HDR_LEN)))
+		return NULL;
+
+	start = _cpu_usec();
+	buffer = init_buf(bound + COMPRESS_HDR_LEN);
+	pack8(codec, buffer);
+	pack32(body_len, buffer);
+	if (codec == COMPRESS_LZ4)
+		out_len = _compress_lz4(body, body_len,
+					get_buf_data(buffer) + COMPRESS_HDR_LEN,
+					bound);
+	else
+		out_len = _compress_zlib(body, body_len,
+					 get_buf_data(buffer) + COMPRESS_HDR_LEN,
+					 bound);
+	out_len += COMPRESS_HDR_LEN;
+
+	slurm_mutex_lock(&stats_mutex);
+	stats.compress_usec += _cpu_usec() - start;
+	if ((out_len == COMPRESS_HDR_LEN) || (out_len >= body_len)) {
+		stats.compress_skip_cnt++;
+		FREE_NULL_BUFFER(buffer);
+	} else {
+		stats.compress_cnt++;
+		stats.compress_in += body_len;
+		stats.compress_out += out_len;
+		set_buf_offset(buffer, out_len);
+	}
+	slurm_mutex_unlock(&stats_mutex);
+
+	return buffer;
+}
+
+extern bool msg_compress_usable(buf_t *compressed, uint16_t peer_flags)
+{
+	if (!compressed || (get_buf_offset(compressed) < COMPRESS_HDR_LEN))
+		return false;
+	return (_accept_flag(get_buf_data(compressed)[0]) & peer_flags);
+}
+
+extern int msg_decompress(buf_t *buffer, uint32_t *body_len)
+{
+	uint32_t offset = get_buf_offset(buffer), orig_len;
+	uint64_t start;
+	uint8_t codec;
+	char *head, *in;
+	int rc;
+
+	xassert(!buffer->mmaped);
+
+	if ((*body_len > remaining_buf(buffer)) ||
+	    (*body_len < COMPRESS_HDR_LEN))
+		return SLURM_ERROR;
+	safe_unpack8(&codec, buffer);
+	safe_unpack32(&orig_len, buffer);
+	set_buf_offset(buffer, offset);
+	if ((codec != COMPRESS_LZ4) && (codec != COMPRESS_ZLIB)) {
+		error("%s: unknown compression type %u", __func__, codec);
+		return SLURM_ERROR;
+	}
+	/*
+	 * Check the length claimed by the sender before allocating it, so a
+	 * short body can not make us allocate much more than it could hold
+	 */
+	if ((orig_len > DECOMPRESS_MAX_LEN) ||
+	    (orig_len > _decompress_bound(codec,
+					  *body_len - COMPRESS_HDR_LEN))) {
+		error("%s: body of %u bytes compressed to %u is too large",
+		      __func__, orig_len, *body_len - COMPRESS_HDR_LEN);
+		return SLURM_ERROR;
+	}
+
+	start = _cpu_usec();
+	head = xmalloc_nz(offset + orig_len);
+	memcpy(head, get_buf_data(buffer), offset);
+	in = get_buf_data(buffer) + offset + COMPRESS_HDR_LEN;
+	if (codec == COMPRESS_LZ4)
+		rc = _decompress_lz4(in, *body_len - COMPRESS_HDR_LEN,
+				     head + offset, orig_len);
+	else
+		rc = _decompress_zlib(in, *body_len - COMPRESS_HDR_LEN,
+				      head + offset, orig_len);
+	if (rc != SLURM_SUCCESS) {
+		xfree(head);
+		return rc;
+	}
+
+	xfree(buffer->head);
+	buffer->head = head;
+	buffer->size = offset + orig_len;
+	*body_len = orig_len;
+
+	slurm_mutex_lock(&stats_mutex);
+	stats.decompress_cnt++;
+	stats.decompress_usec += _cpu_usec() - start;
+	slurm_mutex_unlock(&stats_mutex);
+
+	return SLURM_SUCCESS;
+
+unpack_error:
+	set_buf_offset(buffer, offset);
+	return SLURM_ERROR;
+}
+
+extern void msg_compress_get_stats(msg_compress_stats_t *stats_ptr)
+{
+	slurm_mutex_lock(&stats_mutex);
+	*stats_ptr = stats;
+	slurm_mutex_unlock(&stats_mutex);
+}
+
+extern void msg_compress_pack_stats(buf_t *buffer)
+{
+	uint8_t type = _compress_type();
+
+	slurm_mutex_lock(&stats_mutex);
+	pack16(type, buffer);
+	pack32((type == COMPRESS_OFF) ? 0 : _compress_min(), buffer);
+	pack32(stats.compress_cnt, buffer);
+	pack32(stats.compress_skip_cnt, buffer);
+	pack64(stats.compress_in, buffer);
+	pack64(stats.compress_out, buffer);
+	pack64(stats.compress_usec, buffer);
+	pack32(stats.decompress_cnt, buffer);
+	pack64(stats.decompress_usec, buffer);
+	slurm_mutex_unlock(&stats_mutex);
+}
+
+extern void msg_compress_reset_stats(void)
+{
+	slurm_mutex_lock(&stats_mutex);
+	memset(&stats, 0, sizeof(stats));
+	slurm_mutex_unlock(&stats_mutex);
+}
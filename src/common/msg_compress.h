@@ -0,0 +1,106 @@
+/*****************************************************************************\
+ *  msg_compress.h - compression of message bodies
+ *****************************************************************************
+ *  This file is part of Slurm, a resource management program.
+ *  For details, see <https://slurm.schedmd.com/>.
+ *  Please also read the included file: DISCLAIMER.
+ *
+ *  Slurm is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 2 of the License, or (at your option)
+ *  any later version.
+ *
+ *  In addition, as a special exception, the copyright holders give permission
+ *  to link the code of portions of this program with the OpenSSL library under
+ *  certain conditions as described in each individual source file, and
+ *  distribute linked combinations including the two. You must obey the GNU
+ *  General Public License in all respects for all of the code used other than
+ *  OpenSSL. If you modify file(s) with this exception, you may extend this
+ *  exception to your version of the file(s), but you are not obligated to do
+ *  so. If you do not wish to do so, delete this exception statement from your
+ *  version.  If you delete this exception statement from all source files in
+ *  the program, then also delete it here.
+ *
+ *  Slurm is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with Slurm; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA.
+\*****************************************************************************/
+
+#ifndef _MSG_COMPRESS_H
+#define _MSG_COMPRESS_H
+
+#include "src/common/pack.h"
+
+/*
+ * Peers negotiate compression of message bodies through header flags. Each
+ * message sent at SLURM_21_08_1_PROTOCOL_VERSION or later carries the
+ * SLURM_MSG_ACCEPT_* flags of the codecs its sender can decompress, and a
+ * reply copies the flags of the request it answers. A body which is at least
+ * CommunicationParameters=compress_min= bytes long (16 KiB by default) is then
+ * compressed with the codec set by CommunicationParameters=compress= (lz4 by
+ * default) if the peer accepts it, and flagged SLURM_MSG_COMPRESSED, unless
+ * it is larger than the receiver agrees to decompress (256 MiB). A
+ * compressed body starts with its codec (enum compress_type) as 8 bits and
+ * its original length as 32 bits.
+ */
+
+typedef struct {
+	uint32_t compress_cnt;		/* bodies sent compressed */
+	uint32_t compress_skip_cnt;	/* bodies which did not shrink */
+	uint64_t compress_in;		/* bytes before compression */
+	uint64_t compress_out;		/* bytes after compression */
+	uint64_t compress_usec;		/* CPU time spent compressing */
+	uint32_t decompress_cnt;	/* bodies received compressed */
+	uint64_t decompress_usec;	/* CPU time spent decompressing */
+} msg_compress_stats_t;
+
+/*
+ * Return the SLURM_MSG_ACCEPT_* flags of the codecs built in.
+ */
+extern uint16_t msg_compress_accept(void);
+
+/*
+ * Compress the message body of [body_len] bytes at [body] for a peer which
+ * sent [peer_flags], if it is large enough and the peer accepts our codec.
+ * RET a buffer holding the compressed body up to its offset, to send in
+ *	place of [body], or NULL to send [body] as it is
+ */
+extern buf_t *msg_compress(char *body, uint32_t body_len, uint16_t peer_flags);
+
+/*
+ * Return true if [compressed], returned by msg_compress(), may be sent to a
+ * peer which sent [peer_flags]. A body compressed once may so be sent to
+ * several peers.
+ */
+extern bool msg_compress_usable(buf_t *compressed, uint16_t peer_flags);
+
+/*
+ * Replace the compressed message body of [*body_len] bytes at the offset of
+ * [buffer] by the original body, and set [*body_len] to its length. The
+ * bytes before the body are kept, so offsets into [buffer] remain valid.
+ * The original length is checked against the largest ratio of the codec
+ * before any memory is allocated for it.
+ * RET SLURM_SUCCESS or SLURM_ERROR if the body could not be decompressed
+ */
+extern int msg_decompress(buf_t *buffer, uint32_t *body_len);
+
+/*
+ * Copy the compression statistics of this process into [stats].
+ */
+extern void msg_compress_get_stats(msg_compress_stats_t *stats);
+
+/*
+ * Pack the codec used, the smallest body compressed, 0 if compression is
+ * off, and the compression statistics of this process into [buffer], as
+ * sdiag reads them.
+ */
+extern void msg_compress_pack_stats(buf_t *buffer);
+
+extern void msg_compress_reset_stats(void);
+
+#endif
@@ -68,6 +68,7 @@
 #include "src/common/slurm_acct_gather_energy.h"
 #include "src/common/slurm_ext_sensors.h"
 #include "src/common/slurm_topology.h"
+#include "src/common/working_cluster.h"
 #include "src/common/xassert.h"
 #include "src/common/xmalloc.h"
 #include "src/common/xstring.h"
@@ -89,6 +90,43 @@ int node_record_count = 0;		/* count in node_record_table_ptr */
 uint16_t *cr_node_num_cores = NULL;
 uint32_t *cr_node_cores_offset = NULL;
 
+/*
+ * Node names split into prefix and number the way hostlists split them, so
+ * that bitmap2hostlist() and node_name2bitmap() can work on whole ranges of
+ * nodes rather than one name at a time. Built on first use and dropped
+ * whenever the node table changes. Users hold a reference for as long as they
+ * use it, since the node table may be changed by a thread holding a different
+ * lock than theirs.
+ */
+typedef struct {
+	char *prefix;
+	unsigned long min_num;
+	unsigned long max_num;
+	int node_cnt;
+	int width;		/* width of the first number seen */
+	int *node_inx;		/* node index by number - min_num, -1 if none */
+	bool padded;		/* some number is zero padded */
+	bool same_width;	/* all numbers have the same width */
+	bool sparse;		/* too few nodes for node_inx */
+} name_prefix_t;
+
+typedef struct {
+	name_prefix_t *prefix;	/* NULL if the name has no numeric suffix */
+	unsigned long num;
+	int width;
+} name_part_t;
+
+typedef struct {
+	name_part_t *parts;	/* indexed like node_record_table_ptr */
+	xhash_t *prefixes;	/* name_prefix_t by prefix */
+	node_record_t *table;	/* node_record_table_ptr when built */
+	int node_cnt;		/* node_record_count when built */
+	int refcnt;		/* protected by name_parts_lock */
+} name_parts_t;
+
+static pthread_mutex_t name_parts_lock = PTHREAD_MUTEX_INITIALIZER;
+static name_parts_t *name_parts = NULL;
+
 /* Local function definitions */
 static int	_delete_config_record (void);
 #if _DEBUG
@@ -174,6 +212,164 @@ static void _node_record_hash_identity (void* item, const char** key,
 	*key_len = strlen(node_ptr->name);
 }
 
+static void _name_prefix_identity(void *item, const char **key,
+				  uint32_t *key_len)
+{
+	name_prefix_t *np = item;
+	*key = np->prefix;
+	*key_len = strlen(np->prefix);
+}
+
+static void _name_prefix_free(void *item)
+{
+	name_prefix_t *np = item;
+	xfree(np->prefix);
+	xfree(np->node_inx);
+	xfree(np);
+}
+
+static int _num_width(unsigned long num)
+{
+	int width = 1;
+
+	while (num >= 10) {
+		num /= 10;
+		width++;
+	}
+	return width;
+}
+
+/* name_parts_lock must be locked before calling this */
+static void _unref_name_parts(name_parts_t *np)
+{
+	if (!np || --np->refcnt)
+		return;
+	xfree(np->parts);
+	xhash_free(np->prefixes);
+	xfree(np);
+}
+
+/* Release a reference from _get_name_parts() */
+static void _release_name_parts(name_parts_t *np)
+{
+	slurm_mutex_lock(&name_parts_lock);
+	_unref_name_parts(np);
+	slurm_mutex_unlock(&name_parts_lock);
+}
+
+static void _free_name_parts(void)
+{
+	slurm_mutex_lock(&name_parts_lock);
+	_unref_name_parts(name_parts);
+	name_parts = NULL;
+	slurm_mutex_unlock(&name_parts_lock);
+}
+
+/* Split every node name using the same rules as hostlist_push_host() */
+static name_parts_t *_build_name_parts(void)
+{
+	name_parts_t *cache = xmalloc(sizeof(*cache));
+	hostlist_t hl = hostlist_create(NULL);
+	name_prefix_t *np;
+	name_part_t *part;
+	unsigned long lo, hi;
+	char *prefix;
+	int i, width;
+
+	cache->parts = xcalloc(node_record_count, sizeof(name_part_t));
+	cache->prefixes = xhash_init(_name_prefix_identity, _name_prefix_free);
+
+	for (i = 0, part = cache->parts; i < node_record_count;
+	     i++, part++) {
+		char *name = node_record_table_ptr[i].name;
+
+		if (!name || !name[0] || !hostlist_push_host(hl, name))
+			continue;
+		if (!(prefix = hostlist_shift_range_values(hl, &lo, &hi,
+							   &width)))
+			continue;
+		if (width < 0) {
+			free(prefix);
+			continue;
+		}
+		if (!(np = xhash_get_str(cache->prefixes, prefix))) {
+			np = xmalloc(sizeof(name_prefix_t));
+			np->prefix = xstrdup(prefix);
+			np->min_num = np->max_num = lo;
+			np->width = width;
+			np->same_width = true;
+			xhash_add(cache->prefixes, np);
+		} else if (width != np->width)
+			np->same_width = false;
+		free(prefix);
+
+		np->node_cnt++;
+		np->min_num = MIN(np->min_num, lo);
+		np->max_num = MAX(np->max_num, lo);
+		if (width > _num_width(lo))
+			np->padded = true;
+		part->prefix = np;
+		part->num = lo;
+		part->width = width;
+	}
+	hostlist_destroy(hl);
+
+	for (i = 0, part = cache->parts; i < node_record_count;
+	     i++, part++) {
+		int *inx;
+
+		if (!(np = part->prefix) || np->sparse)
+			continue;
+		if (!np->node_inx) {
+			unsigned long span = np->max_num - np->min_num;
+
+			if (span >= (4UL * np->node_cnt) + 1024) {
+				np->sparse = true;
+				continue;
+			}
+			np->node_inx = xcalloc(span + 1, sizeof(int));
+			memset(np->node_inx, 0xff, (span + 1) * sizeof(int));
+		}
+		/*
+		 * Keep the first of names differing only in zero padding, the
+		 * others are found by name.
+		 */
+		inx = &np->node_inx[part->num - np->min_num];
+		if (*inx == -1)
+			*inx = i;
+	}
+
+	cache->table = node_record_table_ptr;
+	cache->node_cnt = node_record_count;
+	cache->refcnt = 1;
+
+	return cache;
+}
+
+/*
+ * Return a reference to name parts describing the current node table, NULL
+ * if they can not be used. Release it with _release_name_parts().
+ */
+static name_parts_t *_get_name_parts(void)
+{
+	name_parts_t *cache;
+
+	if (!node_record_count || (slurmdb_setup_cluster_name_dims() != 1))
+		return NULL;
+
+	slurm_mutex_lock(&name_parts_lock);
+	if (!name_parts || (name_parts->table != node_record_table_ptr) ||
+	    (name_parts->node_cnt != node_record_count)) {
+		_unref_name_parts(name_parts);
+		name_parts = _build_name_parts();
+	}
+	cache = name_parts;
+	cache->refcnt++;
+	slurm_mutex_unlock(&name_parts_lock);
+
+	return cache;
+}
+
 /*
  * bitmap2hostlist - given a bitmap, build a hostlist
  * IN bitmap - bitmap pointer
@@ -183,6 +379,8 @@ static void _node_record_hash_identity (void* item, const char** key,
  */
 hostlist_t bitmap2hostlist (bitstr_t *bitmap)
 {
+	name_parts_t *cache;
+	name_part_t *parts;
 	int i, first, last;
 	hostlist_t hl;
 
@@ -195,11 +393,38 @@ hostlist_t bitmap2hostlist (bitstr_t *bitmap)
 
 	last  = bit_fls(bitmap);
 	hl = hostlist_create(NULL);
+	if (!(cache = _get_name_parts())) {
+		for (i = first; i <= last; i++) {
+			if (bit_test(bitmap, i) == 0)
+				continue;
+			hostlist_push_host(hl, node_record_table_ptr[i].name);
+		}
+		return hl;
+	}
+
+	parts = cache->parts;
 	for (i = first; i <= last; i++) {
+		name_part_t *part = &parts[i];
+		name_prefix_t *np = part->prefix;
+		int j;
+
 		if (bit_test(bitmap, i) == 0)
 			continue;
-		hostlist_push_host(hl, node_record_table_ptr[i].name);
+		if (!np || (np->padded && !np->same_width)) {
+			hostlist_push_host(hl, node_record_table_ptr[i].name);
+			continue;
+		}
+		/* Push a run of consecutively numbered nodes as one range */
+		for (j = i; (j < last) && bit_test(bitmap, j + 1) &&
+			     (parts[j + 1].prefix == np) &&
+			     (parts[j + 1].num == parts[j].num + 1);
+		     j++)
+			;
+		hostlist_push_range_values(hl, np->prefix, part->num,
+					   parts[j].num, part->width);
+		i = j;
 	}
+	_release_name_parts(cache);
 	return hl;
 
 }
@@ -666,6 +891,7 @@ extern node_record_t *create_node_record(config_record_t *config_ptr,
 	if (!node_hash_table)
 		node_hash_table = xhash_init(_node_record_hash_identity, NULL);
 	xhash_add(node_hash_table, node_ptr);
+	_free_name_parts();
 
 	node_ptr->config_ptr = config_ptr;
 	/* these values will be overwritten when the node actually registers */
@@ -800,6 +1026,7 @@ extern int init_node_conf (void)
 	node_record_count = 0;
 	xfree(node_record_table_ptr);
 	xhash_free(node_hash_table);
+	_free_name_parts();
 
 	if (config_list)	/* delete defunct configuration entries */
 		(void) _delete_config_record ();
@@ -830,9 +1057,63 @@ extern void node_fini2 (void)
 
 	xfree(node_record_table_ptr);
 	node_record_count = 0;
+	_free_name_parts();
 }
 
 
+/* Set the bit of node name, return EINVAL if invalid and not best_effort */
+static int _name2bitmap(char *name, bool best_effort, bitstr_t *bitmap)
+{
+	node_record_t *node_ptr;
+
+	if ((node_ptr = _find_node_record(name, best_effort, true))) {
+		bit_set(bitmap, (bitoff_t) (node_ptr - node_record_table_ptr));
+		return SLURM_SUCCESS;
+	}
+
+	error("node_name2bitmap: invalid node specified %s", name);
+	return best_effort ? SLURM_SUCCESS : EINVAL;
+}
+
+/*
+ * Set the bits of the nodes <prefix><lo> through <prefix><hi>, as split by
+ * hostlist_shift_range_values(). Names not found through name_parts are
+ * looked up one at a time.
+ */
+static int _range2bitmap(name_parts_t *cache, char *prefix,
+			 unsigned long lo, unsigned long hi, int width,
+			 bool best_effort, bitstr_t *bitmap)
+{
+	name_prefix_t *np = NULL;
+	unsigned long num;
+	char *name;
+	int rc = SLURM_SUCCESS;
+
+	if (width < 0)
+		return _name2bitmap(prefix, best_effort, bitmap);
+
+	if ((np = xhash_get_str(cache->prefixes, prefix)) && !np->node_inx)
+		np = NULL;
+	for (num = lo; num <= hi; num++) {
+		if (np && (num >= np->min_num) && (num <= np->max_num)) {
+			int inx = np->node_inx[num - np->min_num];
+
+			if ((inx != -1) &&
+			    (cache->parts[inx].width ==
+			     MAX(width, _num_width(num)))) {
+				bit_set(bitmap, inx);
+				continue;
+			}
+		}
+		name = xstrdup_printf("%s%0*lu", prefix, width, num);
+		if (_name2bitmap(name, best_effort, bitmap))
+			rc = EINVAL;
+		xfree(name);
+	}
+
+	return rc;
+}
+
 /*
  * node_name2bitmap - given a node name regular expression, build a bitmap
  *	representation
@@ -846,9 +1127,10 @@ extern int node_name2bitmap (char *node_names, bool best_effort,
 			     bitstr_t **bitmap)
 {
 	int rc = SLURM_SUCCESS;
-	char *this_node_name;
+	char *this_node_name, *prefix;
 	bitstr_t *my_bitmap;
 	hostlist_t host_list;
+	name_parts_t *cache;
 
 	my_bitmap = (bitstr_t *) bit_alloc (node_record_count);
 	*bitmap = my_bitmap;
@@ -866,18 +1148,25 @@ extern int node_name2bitmap (char *node_names, bool best_effort,
 		return rc;
 	}
 
-	while ( (this_node_name = hostlist_shift (host_list)) ) {
-		node_record_t *node_ptr;
-		node_ptr = _find_node_record(this_node_name, best_effort, true);
-		if (node_ptr) {
-			bit_set (my_bitmap, (bitoff_t) (node_ptr -
-							node_record_table_ptr));
-		} else {
-			error ("node_name2bitmap: invalid node specified %s",
-			       this_node_name);
-			if (!best_effort)
+	if ((cache = _get_name_parts())) {
+		unsigned long lo, hi;
+		int width;
+
+		while ((prefix = hostlist_shift_range_values(host_list, &lo,
+							     &hi, &width))) {
+			if (_range2bitmap(cache, prefix, lo, hi, width,
+					  best_effort, my_bitmap))
 				rc = EINVAL;
+			free(prefix);
 		}
+		_release_name_parts(cache);
+		hostlist_destroy(host_list);
+		return rc;
+	}
+
+	while ( (this_node_name = hostlist_shift (host_list)) ) {
+		if (_name2bitmap(this_node_name, best_effort, my_bitmap))
+			rc = EINVAL;
 		free (this_node_name);
 	}
 	hostlist_destroy (host_list);
@@ -962,6 +1251,7 @@ extern void rehash_node (void)
 
 	xhash_free (node_hash_table);
 	node_hash_table = xhash_init(_node_record_hash_identity, NULL);
+	_free_name_parts();
 	for (i = 0; i < node_record_count; i++, node_ptr++) {
 		if ((node_ptr->name == NULL) ||
 		    (node_ptr->name[0] == '\0'))
@@ -60,6 +60,7 @@
 #include "src/common/pack.h"
 #include "src/common/xmalloc.h"
 #include "src/common/xassert.h"
+#include "src/common/xstring.h"
 #include "src/slurmdbd/read_config.h"
 
 #define MAX_ARRAY_LEN_SMALL	10000
@@ -493,20 +494,205 @@ int unpack32(uint32_t *valp, buf_t *buffer)
 	return SLURM_SUCCESS;
 }
 
+/*
+ * Byte order kernels behind the integer array functions below. Packing and
+ * unpacking both swap each value between host and network byte order, so
+ * one kernel does either, copying cnt values from src to dst, neither of
+ * which need be aligned. On x86_64 AVX2 versions are picked at first use
+ * when the CPU supports them. Setting SLURM_PACK_SIMD to "generic" in the
+ * environment disables them, which is used for benchmarking.
+ */
+typedef struct {
+	const char *name;
+	void (*swap16)(void *dst, const void *src, uint32_t cnt);
+	void (*swap32)(void *dst, const void *src, uint32_t cnt);
+	void (*swap64)(void *dst, const void *src, uint32_t cnt);
+} pack_kernels_t;
+
+static void _swap16_generic(void *dst, const void *src, uint32_t cnt)
+{
+	uint16_t val;
+
+	for (uint32_t i = 0; i < cnt; i++) {
+		memcpy(&val, (char *) src + (i * sizeof(val)), sizeof(val));
+		val = htons(val);
+		memcpy((char *) dst + (i * sizeof(val)), &val, sizeof(val));
+	}
+}
+
+static void _swap32_generic(void *dst, const void *src, uint32_t cnt)
+{
+	uint32_t val;
+
+	for (uint32_t i = 0; i < cnt; i++) {
+		memcpy(&val, (char *) src + (i * sizeof(val)), sizeof(val));
+		val = htonl(val);
+		memcpy((char *) dst + (i * sizeof(val)), &val, sizeof(val));
+	}
+}
+
+static void _swap64_generic(void *dst, const void *src, uint32_t cnt)
+{
+	uint64_t val;
+
+	for (uint32_t i = 0; i < cnt; i++) {
+		memcpy(&val, (char *) src + (i * sizeof(val)), sizeof(val));
+		val = HTON_uint64(val);
+		memcpy((char *) dst + (i * sizeof(val)), &val, sizeof(val));
+	}
+}
+
+static const pack_kernels_t pack_kernels_generic = {
+	.name = "generic",
+	.swap16 = _swap16_generic,
+	.swap32 = _swap32_generic,
+	.swap64 = _swap64_generic,
+};
+
+#if defined(__x86_64__) && \
+    ((defined(__clang__) && (__clang_major__ >= 6)) || \
+     (!defined(__clang__) && defined(__GNUC__) && (__GNUC__ >= 8)))
+#define PACK_SIMD_X86 1
+#include <immintrin.h>
+
+#define AVX2 __attribute__((target("avx2")))
+
+/* Reverse the bytes of each value of width w in a 32 byte vector */
+#define SWAP_MASK(w) _mm256_setr_epi8(					\
+	SWAP_LANE(w, 0), SWAP_LANE(w, 1), SWAP_LANE(w, 2), SWAP_LANE(w, 3), \
+	SWAP_LANE(w, 4), SWAP_LANE(w, 5), SWAP_LANE(w, 6), SWAP_LANE(w, 7), \
+	SWAP_LANE(w, 8), SWAP_LANE(w, 9), SWAP_LANE(w, 10), SWAP_LANE(w, 11), \
+	SWAP_LANE(w, 12), SWAP_LANE(w, 13), SWAP_LANE(w, 14), SWAP_LANE(w, 15), \
+	SWAP_LANE(w, 0), SWAP_LANE(w, 1), SWAP_LANE(w, 2), SWAP_LANE(w, 3), \
+	SWAP_LANE(w, 4), SWAP_LANE(w, 5), SWAP_LANE(w, 6), SWAP_LANE(w, 7), \
+	SWAP_LANE(w, 8), SWAP_LANE(w, 9), SWAP_LANE(w, 10), SWAP_LANE(w, 11), \
+	SWAP_LANE(w, 12), SWAP_LANE(w, 13), SWAP_LANE(w, 14), SWAP_LANE(w, 15))
+#define SWAP_LANE(w, i) (((i) / (w)) * (w) + ((w) - 1) - ((i) % (w)))
+
+AVX2 static void _swap_avx2(void *dst, const void *src, uint32_t bytes,
+			    __m256i mask)
+{
+	__m256i v;
+
+	for (uint32_t i = 0; i < bytes; i += sizeof(v)) {
+		v = _mm256_loadu_si256((const __m256i *) ((char *) src + i));
+		_mm256_storeu_si256((__m256i *) ((char *) dst + i),
+				    _mm256_shuffle_epi8(v, mask));
+	}
+}
+
+AVX2 static void _swap16_avx2(void *dst, const void *src, uint32_t cnt)
+{
+	uint32_t vec_cnt = cnt & ~15;
+
+	_swap_avx2(dst, src, vec_cnt * sizeof(uint16_t), SWAP_MASK(2));
+	_swap16_generic((char *) dst + (vec_cnt * sizeof(uint16_t)),
+			(char *) src + (vec_cnt * sizeof(uint16_t)),
+			cnt - vec_cnt);
+}
+
+AVX2 static void _swap32_avx2(void *dst, const void *src, uint32_t cnt)
+{
+	uint32_t vec_cnt = cnt & ~7;
+
+	_swap_avx2(dst, src, vec_cnt * sizeof(uint32_t), SWAP_MASK(4));
+	_swap32_generic((char *) dst + (vec_cnt * sizeof(uint32_t)),
+			(char *) src + (vec_cnt * sizeof(uint32_t)),
+			cnt - vec_cnt);
+}
+
+AVX2 static void _swap64_avx2(void *dst, const void *src, uint32_t cnt)
+{
+	uint32_t vec_cnt = cnt & ~3;
+
+	_swap_avx2(dst, src, vec_cnt * sizeof(uint64_t), SWAP_MASK(8));
+	_swap64_generic((char *) dst + (vec_cnt * sizeof(uint64_t)),
+			(char *) src + (vec_cnt * sizeof(uint64_t)),
+			cnt - vec_cnt);
+}
+
+static const pack_kernels_t pack_kernels_avx2 = {
+	.name = "avx2",
+	.swap16 = _swap16_avx2,
+	.swap32 = _swap32_avx2,
+	.swap64 = _swap64_avx2,
+};
+#endif
+
+static const pack_kernels_t *pack_kernels = NULL;
+
+static const pack_kernels_t *_pack_kernels_select(void)
+{
+	const pack_kernels_t *kernels = &pack_kernels_generic;
+#ifdef PACK_SIMD_X86
+	char *cap = getenv("SLURM_PACK_SIMD");
+
+	if (cap && !xstrcasecmp(cap, "generic"))
+		return kernels;
+
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2"))
+		kernels = &pack_kernels_avx2;
+#endif
+	return kernels;
+}
+
+/*
+ * Selection is idempotent, so threads racing here on first use all store the
+ * same pointer.
+ */
+static inline const pack_kernels_t *_kernels(void)
+{
+	if (!pack_kernels)
+		pack_kernels = _pack_kernels_select();
+	return pack_kernels;
+}
+
+/*
+ * Return the name of the byte order kernels in use: "generic" or "avx2"
+ */
+extern const char *pack_simd_name(void)
+{
+	return _kernels()->name;
+}
+
+/*
+ * Make room for size more bytes in the buffer, growing it by at least
+ * BUF_SIZE. Return false if that would exceed MAX_BUF_SIZE.
+ */
+static bool _grow_for(buf_t *buffer, uint64_t size, const char *caller)
+{
+	uint64_t new_size;
+
+	if (remaining_buf(buffer) >= size)
+		return true;
+
+	new_size = buffer->size + MAX(size - remaining_buf(buffer), BUF_SIZE);
+	if (new_size > MAX_BUF_SIZE) {
+		error("%s: Buffer size limit exceeded (%"PRIu64" > %u)",
+		      caller, new_size, MAX_BUF_SIZE);
+		return false;
+	}
+	buffer->size = new_size;
+	xrealloc_nz(buffer->head, buffer->size);
+	return true;
+}
+
 /*
  * Given a *uint16_t, it will pack an array of size_val
  */
 void pack16_array(uint16_t *valp, uint32_t size_val, buf_t *buffer)
 {
-	uint32_t i = 0;
+	uint64_t size = (uint64_t) size_val * sizeof(uint16_t);
 
 	xassert(valp || !size_val);
 
 	pack32(size_val, buffer);
+	if (!_grow_for(buffer, size, __func__))
+		return;
 
-	for (i = 0; i < size_val; i++) {
-		pack16(*(valp + i), buffer);
-	}
+	_kernels()->swap16(&buffer->head[buffer->processed], valp, size_val);
+	buffer->processed += size;
 }
 
 /*
@@ -514,18 +700,19 @@ void pack16_array(uint16_t *valp, uint32_t size_val, buf_t *buffer)
  */
 int unpack16_array(uint16_t **valp, uint32_t *size_val, buf_t *buffer)
 {
-	uint32_t i = 0;
+	uint64_t size;
 
 	if (unpack32(size_val, buffer))
 		return SLURM_ERROR;
 	if ((*size_val) > MAX_ARRAY_LEN_MEDIUM)
 		return SLURM_ERROR;
+	size = (uint64_t) (*size_val) * sizeof(uint16_t);
+	if (remaining_buf(buffer) < size)
+		return SLURM_ERROR;
 
-	*valp = xmalloc_nz((*size_val) * sizeof(uint16_t));
-	for (i = 0; i < *size_val; i++) {
-		if (unpack16((*valp) + i, buffer))
-			return SLURM_ERROR;
-	}
+	*valp = xmalloc_nz(size);
+	_kernels()->swap16(*valp, &buffer->head[buffer->processed], *size_val);
+	buffer->processed += size;
 	return SLURM_SUCCESS;
 }
 
@@ -534,15 +721,16 @@ int unpack16_array(uint16_t **valp, uint32_t *size_val, buf_t *buffer)
  */
 void pack32_array(uint32_t *valp, uint32_t size_val, buf_t *buffer)
 {
-	uint32_t i = 0;
+	uint64_t size = (uint64_t) size_val * sizeof(uint32_t);
 
 	xassert(valp || !size_val);
 
 	pack32(size_val, buffer);
+	if (!_grow_for(buffer, size, __func__))
+		return;
 
-	for (i = 0; i < size_val; i++) {
-		pack32(*(valp + i), buffer);
-	}
+	_kernels()->swap32(&buffer->head[buffer->processed], valp, size_val);
+	buffer->processed += size;
 }
 
 /*
@@ -550,18 +738,19 @@ void pack32_array(uint32_t *valp, uint32_t size_val, buf_t *buffer)
  */
 int unpack32_array(uint32_t **valp, uint32_t *size_val, buf_t *buffer)
 {
-	uint32_t i = 0;
+	uint64_t size;
 
 	if (unpack32(size_val, buffer))
 		return SLURM_ERROR;
 	if ((*size_val) > MAX_ARRAY_LEN_LARGE)
 		return SLURM_ERROR;
+	size = (uint64_t) (*size_val) * sizeof(uint32_t);
+	if (remaining_buf(buffer) < size)
+		return SLURM_ERROR;
 
-	*valp = xmalloc_nz((*size_val) * sizeof(uint32_t));
-	for (i = 0; i < *size_val; i++) {
-		if (unpack32((*valp) + i, buffer))
-			return SLURM_ERROR;
-	}
+	*valp = xmalloc_nz(size);
+	_kernels()->swap32(*valp, &buffer->head[buffer->processed], *size_val);
+	buffer->processed += size;
 	return SLURM_SUCCESS;
 }
 
@@ -570,36 +759,245 @@ int unpack32_array(uint32_t **valp, uint32_t *size_val, buf_t *buffer)
  */
 void pack64_array(uint64_t *valp, uint32_t size_val, buf_t *buffer)
 {
-	uint32_t i = 0;
+	uint64_t size = (uint64_t) size_val * sizeof(uint64_t);
 
 	xassert(valp || !size_val);
 
 	pack32(size_val, buffer);
+	if (!_grow_for(buffer, size, __func__))
+		return;
 
-	for (i = 0; i < size_val; i++) {
-		pack64(*(valp + i), buffer);
-	}
+	_kernels()->swap64(&buffer->head[buffer->processed], valp, size_val);
+	buffer->processed += size;
 }
 
 /* Given a int ptr, it will unpack an array of size_val
  */
 int unpack64_array(uint64_t **valp, uint32_t *size_val, buf_t *buffer)
 {
-	uint32_t i = 0;
+	uint64_t size;
 
 	if (unpack32(size_val, buffer))
 		return SLURM_ERROR;
 	if ((*size_val) > MAX_ARRAY_LEN_MEDIUM)
 		return SLURM_ERROR;
+	size = (uint64_t) (*size_val) * sizeof(uint64_t);
+	if (remaining_buf(buffer) < size)
+		return SLURM_ERROR;
 
-	*valp = xmalloc_nz((*size_val) * sizeof(uint64_t));
-	for (i = 0; i < *size_val; i++) {
-		if (unpack64((*valp) + i, buffer))
-			return SLURM_ERROR;
+	*valp = xmalloc_nz(size);
+	_kernels()->swap64(*valp, &buffer->head[buffer->processed], *size_val);
+	buffer->processed += size;
+	return SLURM_SUCCESS;
+}
+
+/*
+ * Variable length integers, used by the compact encoding of protocol
+ * versions from SLURM_21_08_1_PROTOCOL_VERSION on: seven bits per byte, least
+ * significant first, with the high bit set on all but the last byte. Values
+ * below 128 take one byte, NO_VAL takes five and a uint64_t at most ten.
+ */
+#define VAR_MAX_LEN 10
+#define VAR_LEN(width) ((((width) * 8) + 6) / 7)	/* longest for width */
+
+static inline uint32_t _var_encode(uint64_t val, uint8_t *p)
+{
+	uint32_t len = 0;
+
+	while (val >= 0x80) {
+		p[len++] = (uint8_t) val | 0x80;
+		val >>= 7;
+	}
+	p[len++] = (uint8_t) val;
+	return len;
+}
+
+/*
+ * Decode a value from at most avail bytes at p. Return the number of bytes
+ * used, or 0 if the value is cut short or does not fit in 64 bits.
+ */
+static inline uint32_t _var_decode(const uint8_t *p, uint32_t avail,
+				   uint64_t *valp)
+{
+	uint64_t val = 0;
+	uint32_t i, max = MIN(avail, VAR_MAX_LEN);
+
+	for (i = 0; i < max; i++) {
+		val |= (uint64_t) (p[i] & 0x7f) << (7 * i);
+		if (!(p[i] & 0x80)) {
+			if ((i == (VAR_MAX_LEN - 1)) && (p[i] > 1))
+				return 0;
+			*valp = val;
+			return i + 1;
+		}
+	}
+	return 0;
+}
+
+/*
+ * Given a 64-bit integer in host byte order, store it in the buffer as a
+ * variable length integer, and adjust buffer counters.
+ */
+void packvar64(uint64_t val, buf_t *buffer)
+{
+	if (!_grow_for(buffer, VAR_MAX_LEN, __func__))
+		return;
+
+	buffer->processed += _var_encode(
+		val, (uint8_t *) &buffer->head[buffer->processed]);
+}
+
+/*
+ * Given a buffer containing a variable length integer, store a host integer
+ * at 'valp', and adjust buffer counters.
+ */
+int unpackvar64(uint64_t *valp, buf_t *buffer)
+{
+	uint32_t len = _var_decode(
+		(uint8_t *) &buffer->head[buffer->processed],
+		remaining_buf(buffer), valp);
+
+	if (!len)
+		return SLURM_ERROR;
+	buffer->processed += len;
+	return SLURM_SUCCESS;
+}
+
+void packvar32(uint32_t val, buf_t *buffer)
+{
+	packvar64(val, buffer);
+}
+
+int unpackvar32(uint32_t *valp, buf_t *buffer)
+{
+	uint32_t processed = buffer->processed;
+	uint64_t val;
+
+	if (unpackvar64(&val, buffer))
+		return SLURM_ERROR;
+	if (val > UINT32_MAX) {
+		buffer->processed = processed;
+		return SLURM_ERROR;
 	}
+	*valp = val;
 	return SLURM_SUCCESS;
 }
 
+/*
+ * Pack an array of size_val values of uint16_t, uint32_t or uint64_t, as
+ * given by width, all as variable length integers after the size.
+ */
+static void _packvar_array(void *valp, int width, uint32_t size_val,
+			   buf_t *buffer, const char *caller)
+{
+	uint8_t *p;
+
+	xassert(valp || !size_val);
+
+	packvar32(size_val, buffer);
+	if (!_grow_for(buffer, (uint64_t) size_val * VAR_LEN(width), caller))
+		return;
+
+	p = (uint8_t *) &buffer->head[buffer->processed];
+	if (width == sizeof(uint16_t)) {
+		for (uint32_t i = 0; i < size_val; i++)
+			p += _var_encode(((uint16_t *) valp)[i], p);
+	} else if (width == sizeof(uint32_t)) {
+		for (uint32_t i = 0; i < size_val; i++)
+			p += _var_encode(((uint32_t *) valp)[i], p);
+	} else {
+		for (uint32_t i = 0; i < size_val; i++)
+			p += _var_encode(((uint64_t *) valp)[i], p);
+	}
+	buffer->processed = p - (uint8_t *) buffer->head;
+}
+
+/*
+ * Unpack an array packed by _packvar_array() into xmalloc()'d memory,
+ * failing on any value over max. On failure *valp is left NULL.
+ */
+static int _unpackvar_array(void **valp, int width, uint64_t max,
+			    uint32_t max_len, uint32_t *size_val,
+			    buf_t *buffer)
+{
+	uint32_t processed = buffer->processed, cnt, len;
+	uint8_t *p, *end;
+	uint64_t val;
+	void *vals;
+
+	*valp = NULL;
+	if (unpackvar32(&cnt, buffer))
+		return SLURM_ERROR;
+	/* Every value takes at least one byte */
+	if ((cnt > max_len) || (cnt > remaining_buf(buffer))) {
+		buffer->processed = processed;
+		return SLURM_ERROR;
+	}
+
+	vals = xmalloc_nz((uint64_t) cnt * width);
+	p = (uint8_t *) &buffer->head[buffer->processed];
+	end = (uint8_t *) &buffer->head[buffer->size];
+	for (uint32_t i = 0; i < cnt; i++) {
+		/* Most values fit in one byte */
+		if ((p < end) && !(*p & 0x80))
+			val = *p++;
+		else if ((len = _var_decode(p, end - p, &val)))
+			p += len;
+		else
+			goto error;
+		if (val > max)
+			goto error;
+		if (width == sizeof(uint16_t))
+			((uint16_t *) vals)[i] = val;
+		else if (width == sizeof(uint32_t))
+			((uint32_t *) vals)[i] = val;
+		else
+			((uint64_t *) vals)[i] = val;
+	}
+	buffer->processed = p - (uint8_t *) buffer->head;
+	*valp = vals;
+	*size_val = cnt;
+	return SLURM_SUCCESS;
+
+error:
+	xfree(vals);
+	buffer->processed = processed;
+	return SLURM_ERROR;
+}
+
+void packvar16_array(uint16_t *valp, uint32_t size_val, buf_t *buffer)
+{
+	_packvar_array(valp, sizeof(uint16_t), size_val, buffer, __func__);
+}
+
+int unpackvar16_array(uint16_t **valp, uint32_t *size_val, buf_t *buffer)
+{
+	return _unpackvar_array((void **) valp, sizeof(uint16_t), UINT16_MAX,
+				MAX_ARRAY_LEN_MEDIUM, size_val, buffer);
+}
+
+void packvar32_array(uint32_t *valp, uint32_t size_val, buf_t *buffer)
+{
+	_packvar_array(valp, sizeof(uint32_t), size_val, buffer, __func__);
+}
+
+int unpackvar32_array(uint32_t **valp, uint32_t *size_val, buf_t *buffer)
+{
+	return _unpackvar_array((void **) valp, sizeof(uint32_t), UINT32_MAX,
+				MAX_ARRAY_LEN_LARGE, size_val, buffer);
+}
+
+void packvar64_array(uint64_t *valp, uint32_t size_val, buf_t *buffer)
+{
+	_packvar_array(valp, sizeof(uint64_t), size_val, buffer, __func__);
+}
+
+int unpackvar64_array(uint64_t **valp, uint32_t *size_val, buf_t *buffer)
+{
+	return _unpackvar_array((void **) valp, sizeof(uint64_t), UINT64_MAX,
+				MAX_ARRAY_LEN_MEDIUM, size_val, buffer);
+}
+
 void packdouble_array(double *valp, uint32_t size_val, buf_t *buffer)
 {
 	uint32_t i = 0;
@@ -117,6 +117,32 @@ extern int unpack32_array(uint32_t **valp, uint32_t *size_val, buf_t *buffer);
 extern void pack64_array(uint64_t *valp, uint32_t size_val, buf_t *buffer);
 extern int unpack64_array(uint64_t **valp, uint32_t *size_val, buf_t *buffer);
 
+/*
+ * Variable length integers and arrays of them, for the compact encoding of
+ * protocol versions from SLURM_21_08_1_PROTOCOL_VERSION on. Small values take
+ * a single byte.
+ */
+extern void packvar32(uint32_t val, buf_t *buffer);
+extern int unpackvar32(uint32_t *valp, buf_t *buffer);
+
+extern void packvar64(uint64_t val, buf_t *buffer);
+extern int unpackvar64(uint64_t *valp, buf_t *buffer);
+
+extern void packvar16_array(uint16_t *valp, uint32_t size_val, buf_t *buffer);
+extern int unpackvar16_array(uint16_t **valp, uint32_t *size_val,
+			     buf_t *buffer);
+
+extern void packvar32_array(uint32_t *valp, uint32_t size_val, buf_t *buffer);
+extern int unpackvar32_array(uint32_t **valp, uint32_t *size_val,
+			     buf_t *buffer);
+
+extern void packvar64_array(uint64_t *valp, uint32_t size_val, buf_t *buffer);
+extern int unpackvar64_array(uint64_t **valp, uint32_t *size_val,
+			     buf_t *buffer);
+
+/* Return the name of the byte order kernels used for integer arrays */
+extern const char *pack_simd_name(void);
+
 extern void packdouble_array(double *valp, uint32_t size_val, buf_t *buffer);
 extern int unpackdouble_array(double **valp, uint32_t *size_val, buf_t *buffer);
 
@@ -225,6 +251,41 @@ extern int unpackmem_array(char *valp, uint32_t size_valp, buf_t *buffer);
 		goto unpack_error;			\
 } while (0)
 
+#define safe_unpackvar32(valp,buf) do {			\
+	xassert(sizeof(*valp) == sizeof(uint32_t));	\
+	xassert(buf->magic == BUF_MAGIC);		\
+	if (unpackvar32(valp,buf))			\
+		goto unpack_error;			\
+} while (0)
+
+#define safe_unpackvar64(valp,buf) do {			\
+	xassert(sizeof(*valp) == sizeof(uint64_t));	\
+	xassert(buf->magic == BUF_MAGIC);		\
+	if (unpackvar64(valp,buf))			\
+		goto unpack_error;			\
+} while (0)
+
+#define safe_unpackvar16_array(valp,size_valp,buf) do {	\
+	xassert(sizeof(*size_valp) == sizeof(uint32_t));\
+	xassert(buf->magic == BUF_MAGIC);		\
+	if (unpackvar16_array(valp,size_valp,buf))	\
+		goto unpack_error;			\
+} while (0)
+
+#define safe_unpackvar32_array(valp,size_valp,buf) do {	\
+	xassert(sizeof(*size_valp) == sizeof(uint32_t));\
+	xassert(buf->magic == BUF_MAGIC);		\
+	if (unpackvar32_array(valp,size_valp,buf))	\
+		goto unpack_error;			\
+} while (0)
+
+#define safe_unpackvar64_array(valp,size_valp,buf) do {	\
+	xassert(sizeof(*size_valp) == sizeof(uint32_t));\
+	xassert(buf->magic == BUF_MAGIC);		\
+	if (unpackvar64_array(valp,size_valp,buf))	\
+		goto unpack_error;			\
+} while (0)
+
 #define safe_unpackdouble_array(valp,size_valp,buf) do {	\
 	xassert(sizeof(*size_valp) == sizeof(uint32_t));\
 	xassert(buf->magic == BUF_MAGIC);		\
@@ -0,0 +1,190 @@
+/*****************************************************************************\
+ *  sha256.c - SHA-256 and HMAC-SHA256 (FIPS 180-4, RFC 2104)
+ *****************************************************************************
+ *  This file is part of Slurm, a resource management program.
+ *  For details, see <https://slurm.schedmd.com/>.
+ *  Please also read the included file: DISCLAIMER.
+ *
+ *  Slurm is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 2 of the License, or (at your option)
+ *  any later version.
+ *
+ *  In addition, as a special exception, the copyright holders give permission
+ *  to link the code of portions of this program with the OpenSSL library under
+ *  certain conditions as described in each individual source file, and
+ *  distribute linked combinations including the two. You must obey the GNU
+ *  General Public License in all respects for all of the code used other than
+ *  OpenSSL. If you modify file(s) with this exception, you may extend this
+ *  exception to your version of the file(s), but you are not obligated to do
+ *  so. If you do not wish to do so, delete this exception statement from your
+ *  version.  If you delete this exception statement from all source files in
+ *  the program, then also delete it here.
+ *
+ *  Slurm is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with Slurm; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA.
+\*****************************************************************************/
+
+#include <string.h>
+
+#include "src/common/sha256.h"
+
+#define ROTR(_x, _n)	(((_x) >> (_n)) | ((_x) << (32 - (_n))))
+
+static const uint32_t k[64] = {
+	0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5,
+	0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+	0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3,
+	0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+	0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc,
+	0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+	0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7,
+	0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+	0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13,
+	0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+	0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3,
+	0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+	0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5,
+	0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+	0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208,
+	0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+static void _transform(sha256_ctx_t *ctx, const unsigned char *block)
+{
+	uint32_t w[64], s[8], s0, s1, t1, t2;
+	int i;
+
+	for (i = 0; i < 16; i++) {
+		w[i] = ((uint32_t) block[i * 4] << 24) |
+		       ((uint32_t) block[i * 4 + 1] << 16) |
+		       ((uint32_t) block[i * 4 + 2] << 8) |
+		       ((uint32_t) block[i * 4 + 3]);
+	}
+	for (i = 16; i < 64; i++) {
+		s0 = ROTR(w[i - 15], 7) ^ ROTR(w[i - 15], 18) ^
+		     (w[i - 15] >> 3);
+		s1 = ROTR(w[i - 2], 17) ^ ROTR(w[i - 2], 19) ^
+		     (w[i - 2] >> 10);
+		w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+	}
+
+	memcpy(s, ctx->state, sizeof(s));
+	for (i = 0; i < 64; i++) {
+		s1 = ROTR(s[4], 6) ^ ROTR(s[4], 11) ^ ROTR(s[4], 25);
+		t1 = s[7] + s1 + ((s[4] & s[5]) ^ (~s[4] & s[6])) + k[i] + w[i];
+		s0 = ROTR(s[0], 2) ^ ROTR(s[0], 13) ^ ROTR(s[0], 22);
+		t2 = s0 + ((s[0] & s[1]) ^ (s[0] & s[2]) ^ (s[1] & s[2]));
+		memmove(&s[1], &s[0], 7 * sizeof(uint32_t));
+		s[4] += t1;
+		s[0] = t1 + t2;
+	}
+	for (i = 0; i < 8; i++)
+		ctx->state[i] += s[i];
+}
+
+extern void sha256_init(sha256_ctx_t *ctx)
+{
+	static const uint32_t h[8] = {
+		0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+		0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+	};
+
+	memcpy(ctx->state, h, sizeof(h));
+	ctx->length = 0;
+	ctx->block_len = 0;
+}
+
+extern void sha256_update(sha256_ctx_t *ctx, const void *data, size_t len)
+{
+	const unsigned char *p = data;
+	size_t n;
+
+	ctx->length += len;
+	while (len) {
+		n = SHA256_BLOCK_SIZE - ctx->block_len;
+		if (n > len)
+			n = len;
+		memcpy(ctx->block + ctx->block_len, p, n);
+		ctx->block_len += n;
+		p += n;
+		len -= n;
+		if (ctx->block_len == SHA256_BLOCK_SIZE) {
+			_transform(ctx, ctx->block);
+			ctx->block_len = 0;
+		}
+	}
+}
+
+extern void sha256_final(sha256_ctx_t *ctx,
+			 unsigned char digest[SHA256_DIGEST_SIZE])
+{
+	uint64_t bits = ctx->length * 8;
+	int i;
+
+	/* Pad with 0x80, zeros and the message length in bits */
+	ctx->block[ctx->block_len++] = 0x80;
+	if (ctx->block_len > (SHA256_BLOCK_SIZE - 8)) {
+		memset(ctx->block + ctx->block_len, 0,
+		       SHA256_BLOCK_SIZE - ctx->block_len);
+		_transform(ctx, ctx->block);
+		ctx->block_len = 0;
+	}
+	memset(ctx->block + ctx->block_len, 0,
+	       SHA256_BLOCK_SIZE - 8 - ctx->block_len);
+	for (i = 0; i < 8; i++)
+		ctx->block[SHA256_BLOCK_SIZE - 1 - i] = bits >> (i * 8);
+	_transform(ctx, ctx->block);
+
+	for (i = 0; i < 8; i++) {
+		digest[i * 4] = ctx->state[i] >> 24;
+		digest[i * 4 + 1] = ctx->state[i] >> 16;
+		digest[i * 4 + 2] = ctx->state[i] >> 8;
+		digest[i * 4 + 3] = ctx->state[i];
+	}
+	memset(ctx, 0, sizeof(*ctx));
+}
+
+extern void hmac_sha256(const void *key, size_t key_len,
+			const void *data, size_t data_len,
+			unsigned char digest[SHA256_DIGEST_SIZE])
+{
+	unsigned char pad[SHA256_BLOCK_SIZE];
+	unsigned char hash[SHA256_DIGEST_SIZE];
+	sha256_ctx_t ctx;
+	int i;
+
+	/* Keys longer than a block are hashed first */
+	memset(pad, 0, sizeof(pad));
+	if (key_len > SHA256_BLOCK_SIZE) {
+		sha256_init(&ctx);
+		sha256_update(&ctx, key, key_len);
+		sha256_final(&ctx, pad);
+	} else {
+		memcpy(pad, key, key_len);
+	}
+
+	for (i = 0; i < SHA256_BLOCK_SIZE; i++)
+		pad[i] ^= 0x36;
+	sha256_init(&ctx);
+	sha256_update(&ctx, pad, sizeof(pad));
+	sha256_update(&ctx, data, data_len);
+	sha256_final(&ctx, hash);
+
+	/* 0x36 ^ 0x5c turns the inner pad into the outer one */
+	for (i = 0; i < SHA256_BLOCK_SIZE; i++)
+		pad[i] ^= 0x36 ^ 0x5c;
+	sha256_init(&ctx);
+	sha256_update(&ctx, pad, sizeof(pad));
+	sha256_update(&ctx, hash, sizeof(hash));
+	sha256_final(&ctx, digest);
+
+	memset(pad, 0, sizeof(pad));
+	memset(hash, 0, sizeof(hash));
+}
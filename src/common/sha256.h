@@ -0,0 +1,63 @@
+/*****************************************************************************\
+ *  sha256.h - SHA-256 and HMAC-SHA256 (FIPS 180-4, RFC 2104)
+ *****************************************************************************
+ *  This file is part of Slurm, a resource management program.
+ *  For details, see <https://slurm.schedmd.com/>.
+ *  Please also read the included file: DISCLAIMER.
+ *
+ *  Slurm is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 2 of the License, or (at your option)
+ *  any later version.
+ *
+ *  In addition, as a special exception, the copyright holders give permission
+ *  to link the code of portions of this program with the OpenSSL library under
+ *  certain conditions as described in each individual source file, and
+ *  distribute linked combinations including the two. You must obey the GNU
+ *  General Public License in all respects for all of the code used other than
+ *  OpenSSL. If you modify file(s) with this exception, you may extend this
+ *  exception to your version of the file(s), but you are not obligated to do
+ *  so. If you do not wish to do so, delete this exception statement from your
+ *  version.  If you delete this exception statement from all source files in
+ *  the program, then also delete it here.
+ *
+ *  Slurm is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with Slurm; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA.
+\*****************************************************************************/
+
+#ifndef _SHA256_H
+#define _SHA256_H
+
+#include <inttypes.h>
+#include <stddef.h>
+
+#define SHA256_DIGEST_SIZE	32
+#define SHA256_BLOCK_SIZE	64
+
+typedef struct {
+	uint32_t state[8];
+	uint64_t length;			/* bytes hashed so far */
+	uint32_t block_len;			/* bytes waiting in block */
+	unsigned char block[SHA256_BLOCK_SIZE];
+} sha256_ctx_t;
+
+extern void sha256_init(sha256_ctx_t *ctx);
+extern void sha256_update(sha256_ctx_t *ctx, const void *data, size_t len);
+extern void sha256_final(sha256_ctx_t *ctx,
+			 unsigned char digest[SHA256_DIGEST_SIZE]);
+
+/*
+ * Compute the HMAC-SHA256 of [data_len] bytes at [data] with a key of
+ * [key_len] bytes at [key] into [digest].
+ */
+extern void hmac_sha256(const void *key, size_t key_len,
+			const void *data, size_t data_len,
+			unsigned char digest[SHA256_DIGEST_SIZE]);
+
+#endif
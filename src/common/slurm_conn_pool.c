@@ -0,0 +1,237 @@
+/*****************************************************************************\
+ *  slurm_conn_pool.c - pool of idle connections for reuse
+ *****************************************************************************
+ *  This file is part of Slurm, a resource management program.
+ *  For details, see <https://slurm.schedmd.com/>.
+ *  Please also read the included file: DISCLAIMER.
+ *
+ *  Slurm is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 2 of the License, or (at your option)
+ *  any later version.
+ *
+ *  In addition, as a special exception, the copyright holders give permission
+ *  to link the code of portions of this program with the OpenSSL library under
+ *  certain conditions as described in each individual source file, and
+ *  distribute linked combinations including the two. You must obey the GNU
+ *  General Public License in all respects for all of the code used other than
+ *  OpenSSL. If you modify file(s) with this exception, you may extend this
+ *  exception to your version of the file(s), but you are not obligated to do
+ *  so. If you do not wish to do so, delete this exception statement from your
+ *  version.  If you delete this exception statement from all source files in
+ *  the program, then also delete it here.
+ *
+ *  Slurm is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with Slurm; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA.
+\*****************************************************************************/
+
+#include <poll.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "src/common/log.h"
+#include "src/common/macros.h"
+#include "src/common/read_config.h"
+#include "src/common/slurm_conn_pool.h"
+#include "src/common/xhash.h"
+#include "src/common/xmalloc.h"
+
+/* family, port and IPv6 address */
+#define ADDR_KEY_SIZE (1 + 2 + 16)
+
+typedef struct {
+	char key[sizeof(slurm_addr_t)];
+	uint32_t key_len;
+	int cnt;		/* idle connections in fds */
+	int max;		/* size of fds and last_used */
+	int *fds;		/* oldest first */
+	time_t *last_used;
+} pool_addr_t;
+
+static pthread_mutex_t pool_mutex = PTHREAD_MUTEX_INITIALIZER;
+static xhash_t *pool = NULL;
+static int pool_idle_timeout = 0;
+static int pool_max_per_addr = 0;
+static uint32_t pool_hits = 0, pool_misses = 0;
+
+static void _addr_key(slurm_addr_t *addr, char *key, uint32_t *key_len)
+{
+	if (addr->ss_family == AF_INET) {
+		struct sockaddr_in *in = (struct sockaddr_in *) addr;
+		key[0] = AF_INET;
+		memcpy(key + 1, &in->sin_port, 2);
+		memcpy(key + 3, &in->sin_addr, 4);
+		*key_len = 1 + 2 + 4;
+	} else if (addr->ss_family == AF_INET6) {
+		struct sockaddr_in6 *in6 = (struct sockaddr_in6 *) addr;
+		key[0] = AF_INET6;
+		memcpy(key + 1, &in6->sin6_port, 2);
+		memcpy(key + 3, &in6->sin6_addr, 16);
+		*key_len = ADDR_KEY_SIZE;
+	} else {
+		memcpy(key, addr, sizeof(*addr));
+		*key_len = sizeof(*addr);
+	}
+}
+
+static void _pool_addr_id(void *item, const char **key, uint32_t *key_len)
+{
+	pool_addr_t *entry = item;
+
+	*key = entry->key;
+	*key_len = entry->key_len;
+}
+
+static void _pool_addr_free(void *item)
+{
+	pool_addr_t *entry = item;
+
+	for (int i = 0; i < entry->cnt; i++)
+		(void) close(entry->fds[i]);
+	xfree(entry->fds);
+	xfree(entry->last_used);
+	xfree(entry);
+}
+
+/* Close the oldest connections which have been idle too long */
+static void _purge_addr(void *item, void *arg)
+{
+	pool_addr_t *entry = item;
+	time_t *now = arg;
+	int i;
+
+	for (i = 0; i < entry->cnt; i++) {
+		if ((*now - entry->last_used[i]) < pool_idle_timeout)
+			break;
+		(void) close(entry->fds[i]);
+	}
+	if (!i)
+		return;
+
+	entry->cnt -= i;
+	memmove(entry->fds, entry->fds + i, entry->cnt * sizeof(int));
+	memmove(entry->last_used, entry->last_used + i,
+		entry->cnt * sizeof(time_t));
+}
+
+/* Connections the peer closed, or sent unexpected data on, are unusable */
+static bool _conn_idle(int fd)
+{
+	struct pollfd pfd = { .fd = fd, .events = POLLIN };
+
+	return (poll(&pfd, 1, 0) == 0);
+}
+
+extern void slurm_conn_pool_init(int idle_timeout, int max_per_addr)
+{
+	slurm_mutex_lock(&pool_mutex);
+	if (!pool)
+		pool = xhash_init(_pool_addr_id, _pool_addr_free);
+	pool_idle_timeout = idle_timeout;
+	pool_max_per_addr = max_per_addr;
+	slurm_mutex_unlock(&pool_mutex);
+}
+
+extern void slurm_conn_pool_fini(void)
+{
+	slurm_mutex_lock(&pool_mutex);
+	xhash_free(pool);
+	pool = NULL;
+	slurm_mutex_unlock(&pool_mutex);
+}
+
+extern int slurm_conn_pool_get(slurm_addr_t *addr)
+{
+	char key[sizeof(slurm_addr_t)];
+	uint32_t key_len;
+	pool_addr_t *entry;
+	time_t now;
+	int fd = -1;
+
+	slurm_mutex_lock(&pool_mutex);
+	if (!pool) {
+		slurm_mutex_unlock(&pool_mutex);
+		return -1;
+	}
+
+	_addr_key(addr, key, &key_len);
+	now = time(NULL);
+	if ((entry = xhash_get(pool, key, key_len))) {
+		/* Most recently used first, it is the least likely to be stale */
+		while (entry->cnt) {
+			entry->cnt--;
+			fd = entry->fds[entry->cnt];
+			if (((now - entry->last_used[entry->cnt]) <
+			     pool_idle_timeout) && _conn_idle(fd))
+				break;
+			(void) close(fd);
+			fd = -1;
+		}
+	}
+
+	if (fd >= 0)
+		pool_hits++;
+	else
+		pool_misses++;
+	slurm_mutex_unlock(&pool_mutex);
+
+	return fd;
+}
+
+extern void slurm_conn_pool_put(slurm_addr_t *addr, int fd)
+{
+	char key[sizeof(slurm_addr_t)];
+	uint32_t key_len;
+	pool_addr_t *entry;
+
+	slurm_mutex_lock(&pool_mutex);
+	if (!pool) {
+		slurm_mutex_unlock(&pool_mutex);
+		(void) close(fd);
+		return;
+	}
+
+	_addr_key(addr, key, &key_len);
+	if (!(entry = xhash_get(pool, key, key_len))) {
+		entry = xmalloc(sizeof(*entry));
+		memcpy(entry->key, key, key_len);
+		entry->key_len = key_len;
+		xhash_add(pool, entry);
+	}
+	if (entry->max < pool_max_per_addr) {
+		entry->max = pool_max_per_addr;
+		xrecalloc(entry->fds, entry->max, sizeof(int));
+		xrecalloc(entry->last_used, entry->max, sizeof(time_t));
+	}
+
+	if (entry->cnt < pool_max_per_addr) {
+		entry->fds[entry->cnt] = fd;
+		entry->last_used[entry->cnt] = time(NULL);
+		entry->cnt++;
+		fd = -1;
+	}
+	slurm_mutex_unlock(&pool_mutex);
+
+	if (fd >= 0)
+		(void) close(fd);
+}
+
+extern void slurm_conn_pool_purge(void)
+{
+	time_t now = time(NULL);
+
+	slurm_mutex_lock(&pool_mutex);
+	if (pool) {
+		xhash_walk(pool, _purge_addr, &now);
+		log_flag(NET, "%s: connections reused:%u opened:%u",
+			 __func__, pool_hits, pool_misses);
+		pool_hits = pool_misses = 0;
+	}
+	slurm_mutex_unlock(&pool_mutex);
+}
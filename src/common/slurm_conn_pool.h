@@ -0,0 +1,66 @@
+/*****************************************************************************\
+ *  slurm_conn_pool.h - pool of idle connections for reuse
+ *****************************************************************************
+ *  This file is part of Slurm, a resource management program.
+ *  For details, see <https://slurm.schedmd.com/>.
+ *  Please also read the included file: DISCLAIMER.
+ *
+ *  Slurm is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 2 of the License, or (at your option)
+ *  any later version.
+ *
+ *  In addition, as a special exception, the copyright holders give permission
+ *  to link the code of portions of this program with the OpenSSL library under
+ *  certain conditions as described in each individual source file, and
+ *  distribute linked combinations including the two. You must obey the GNU
+ *  General Public License in all respects for all of the code used other than
+ *  OpenSSL. If you modify file(s) with this exception, you may extend this
+ *  exception to your version of the file(s), but you are not obligated to do
+ *  so. If you do not wish to do so, delete this exception statement from your
+ *  version.  If you delete this exception statement from all source files in
+ *  the program, then also delete it here.
+ *
+ *  Slurm is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with Slurm; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA.
+\*****************************************************************************/
+
+#ifndef _SLURM_CONN_POOL_H
+#define _SLURM_CONN_POOL_H
+
+#include "src/common/slurm_protocol_defs.h"
+
+/*
+ * Enable the pool. Until this is called slurm_conn_pool_get() never returns
+ * a connection and slurm_conn_pool_put() closes what it is given.
+ * IN idle_timeout - seconds an unused connection is kept open
+ * IN max_per_addr - idle connections kept for any one address
+ */
+extern void slurm_conn_pool_init(int idle_timeout, int max_per_addr);
+
+/* Close all pooled connections and disable the pool */
+extern void slurm_conn_pool_fini(void);
+
+/*
+ * Take an idle connection to addr out of the pool. Connections closed by the
+ * peer while idle are discarded.
+ * RET open file descriptor or -1 if none is available
+ */
+extern int slurm_conn_pool_get(slurm_addr_t *addr);
+
+/*
+ * Return a connection to addr to the pool after a complete exchange of
+ * messages. It is closed if the pool is disabled or full for this address.
+ */
+extern void slurm_conn_pool_put(slurm_addr_t *addr, int fd);
+
+/* Close connections idle for longer than the idle timeout */
+extern void slurm_conn_pool_purge(void);
+
+#endif
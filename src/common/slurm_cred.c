@@ -57,11 +57,13 @@
 #include "src/common/macros.h"
 #include "src/common/plugin.h"
 #include "src/common/plugrack.h"
+#include "src/common/sha256.h"
 #include "src/common/slurm_cred.h"
 #include "src/common/slurm_protocol_api.h"
 #include "src/common/slurm_time.h"
 #include "src/common/uid.h"
 #include "src/common/xassert.h"
+#include "src/common/xhash.h"
 #include "src/common/xmalloc.h"
 #include "src/common/xstring.h"
 
@@ -84,6 +86,18 @@ typedef struct sbcast_cred sbcast_cred_t;		/* opaque data type */
 
 #define MAX_TIME 0x7fffffff
 
+/* Length of a cred_state_t hash key, the step id and ctime */
+#define CRED_STATE_KEY_LEN (sizeof(slurm_step_id_t) + sizeof(int64_t))
+
+/* Length of the key of a job signature */
+#define JOB_SIG_KEY_LEN 32
+
+/* Most seconds the same job signature is handed out for */
+#define JOB_SIG_REUSE 60
+
+/* Length of a credential signature made with a job key, in hex with a NUL */
+#define JOB_SIG_MAC_LEN (SHA256_DIGEST_SIZE * 2 + 1)
+
 /*
  * slurm job credential state
  *
@@ -92,6 +106,7 @@ typedef struct {
 	time_t   ctime;		/* Time that the cred was created	*/
 	time_t   expiration;    /* Time at which cred is no longer good	*/
 	slurm_step_id_t step_id; /* Slurm step id for this credential	*/
+	char     key[CRED_STATE_KEY_LEN]; /* step_id and ctime		*/
 } cred_state_t;
 
 /*
@@ -106,6 +121,45 @@ typedef struct {
 	time_t   revoked;       /* Time at which credentials were revoked   */
 } job_state_t;
 
+/*
+ * Expiration queue, a binary min-heap of the keys in a state table ordered
+ * by expiration time. Records are not removed when a state changes or goes
+ * away, they are checked against the table when they come due.
+ *
+ */
+typedef struct {
+	time_t   expiration;	/* Time at which the state may be purged */
+	uint32_t key_len;	/* length of key in bytes		*/
+	char     key[CRED_STATE_KEY_LEN]; /* state table key		*/
+} expire_rec_t;
+
+typedef struct {
+	expire_rec_t *recs;	/* heap ordered records			*/
+	uint32_t cnt;		/* records in use			*/
+	uint32_t size;		/* records allocated			*/
+} expire_queue_t;
+
+/*
+ * Job signature: a random key for the credentials of one job, signed by the
+ * cred plugin such that only SlurmUser and root can get the key back from it.
+ * A credential created at SLURM_21_08_1_PROTOCOL_VERSION or later carries the
+ * signature of its job and, in place of its own plugin signature, the
+ * HMAC-SHA256 of the credential made with the key. The creator hands out the
+ * same job signature for up to JOB_SIG_REUSE seconds, so the verifier only
+ * has the cred plugin (munge) check the first credential of a job it sees
+ * in that time.
+ *
+ */
+typedef struct {
+	uint32_t jobid;		/* Slurm job id of the signature	*/
+	uint32_t uid;		/* user of the job			*/
+	time_t   ctime;		/* Time that the signature was created	*/
+	time_t   expiration;	/* Time at which the entry is purged	*/
+	unsigned char key[JOB_SIG_KEY_LEN]; /* credential signing key	*/
+	char    *signature;	/* job signature			*/
+	uint32_t siglen;	/* signature length in bytes		*/
+} job_sig_t;
+
 
 /*
  * Completion of slurm credential context
@@ -146,8 +200,13 @@ struct slurm_cred_context {
 	pthread_mutex_t mutex;
 	enum ctx_type type;	/* context type (creator or verifier)	*/
 	void *key;		/* private or public key		*/
-	List job_list;		/* List of used jobids (for verifier)	*/
-	List state_list;	/* List of cred states (for verifier)	*/
+	xhash_t *job_hash;	/* job_state_t by jobid (for verifier)	*/
+	expire_queue_t job_expire; /* revoked job_hash entries		*/
+	xhash_t *state_hash;	/* cred_state_t by key (for verifier)	*/
+	expire_queue_t state_expire; /* state_hash entries		*/
+	xhash_t *job_sigs;	/* job_sig_t by jobid (for creator) or
+				 * by signature (for verifier)		*/
+	List job_sig_list;	/* job_sigs entries, oldest first	*/
 
 	int expiry_window;	/* expiration window for cached creds	*/
 
@@ -201,6 +260,8 @@ struct slurm_job_credential {
 
 	char     *signature; 	/* credential signature			*/
 	uint32_t siglen;	/* signature length in bytes		*/
+	char     *job_sig;	/* job signature, if signed with its key */
+	uint32_t job_siglen;	/* job signature length in bytes	*/
 };
 
 typedef struct {
@@ -214,6 +275,12 @@ typedef struct {
 					 uint32_t buf_size,
 					 char *signature,
 					 uint32_t sig_size);
+	int   (*cred_seal)		(void *key, char *buffer,
+					 int buf_size, char **sig_pp,
+					 uint32_t *sig_size_p);
+	int   (*cred_unseal)		(void *key, char *signature,
+					 uint32_t sig_size, char **buf_pp,
+					 uint32_t *buf_size_p);
 	const char *(*cred_str_error)	(int);
 } slurm_cred_ops_t;
 
@@ -227,6 +294,8 @@ static const char *syms[] = {
 	"cred_p_destroy_key",
 	"cred_p_sign",
 	"cred_p_verify_sign",
+	"cred_p_seal",
+	"cred_p_unseal",
 	"cred_p_str_error",
 };
 
@@ -258,16 +327,25 @@ static bool _exkey_is_valid(slurm_cred_ctx_t ctx);
 
 static cred_state_t * _cred_state_create(slurm_cred_ctx_t ctx, slurm_cred_t *c);
 static job_state_t  * _job_state_create(uint32_t jobid);
-static void           _job_state_destroy(job_state_t   *js);
+static void           _job_state_destroy(void *x);
+static void           _job_state_expire(slurm_cred_ctx_t ctx, job_state_t *j);
 
 static job_state_t  * _find_job_state(slurm_cred_ctx_t ctx, uint32_t jobid);
 static job_state_t  * _insert_job_state(slurm_cred_ctx_t ctx,  uint32_t jobid);
-static int _list_find_cred_state(void *x, void *key);
+static void _cred_state_key(slurm_step_id_t *step_id, time_t ctime,
+			    char *key);
+static void _cred_state_id(void *item, const char **key, uint32_t *key_len);
+static void _job_state_id(void *item, const char **key, uint32_t *key_len);
+static void _expire_queue_free(expire_queue_t *q);
 
 static void _insert_cred_state(slurm_cred_ctx_t ctx, slurm_cred_t *cred);
 static void _clear_expired_job_states(slurm_cred_ctx_t ctx);
 static void _clear_expired_credential_states(slurm_cred_ctx_t ctx);
 static void _verifier_ctx_init(slurm_cred_ctx_t ctx);
+static void _job_sig_jobid(void *item, const char **key, uint32_t *key_len);
+static void _job_sig_id(void *item, const char **key, uint32_t *key_len);
+static void _job_sig_destroy(void *item);
+static void _clear_job_sigs(slurm_cred_ctx_t ctx, bool all);
 
 static bool _credential_replayed(slurm_cred_ctx_t ctx, slurm_cred_t *cred);
 static bool _credential_revoked(slurm_cred_ctx_t ctx, slurm_cred_t *cred);
@@ -391,6 +469,9 @@ slurm_cred_creator_ctx_create(const char *path)
 	if (!ctx->key)
  		goto fail;
 
+	ctx->job_sigs     = xhash_init(_job_sig_jobid, _job_sig_destroy);
+	ctx->job_sig_list = list_create(NULL);
+
 	slurm_mutex_unlock(&ctx->mutex);
 	return ctx;
 
@@ -447,8 +528,12 @@ slurm_cred_ctx_destroy(slurm_cred_ctx_t ctx)
 		(*(ops.cred_destroy_key))(ctx->exkey);
 	if (ctx->key)
 		(*(ops.cred_destroy_key))(ctx->key);
-	FREE_NULL_LIST(ctx->job_list);
-	FREE_NULL_LIST(ctx->state_list);
+	xhash_free(ctx->job_hash);
+	_expire_queue_free(&ctx->job_expire);
+	xhash_free(ctx->state_hash);
+	_expire_queue_free(&ctx->state_expire);
+	FREE_NULL_LIST(ctx->job_sig_list);
+	xhash_free(ctx->job_sigs);
 
 	ctx->magic = ~CRED_CTX_MAGIC;
 	slurm_mutex_unlock(&ctx->mutex);
@@ -698,6 +783,11 @@ slurm_cred_copy(slurm_cred_t *cred)
 	rcred->siglen = cred->siglen;
 	/* Assumes signature is a string, otherwise use xmalloc and memcpy */
 	rcred->signature = xstrdup(cred->signature);
+	if (cred->job_siglen) {
+		rcred->job_siglen = cred->job_siglen;
+		rcred->job_sig = xmalloc(cred->job_siglen);
+		memcpy(rcred->job_sig, cred->job_sig, cred->job_siglen);
+	}
 
 	slurm_mutex_unlock(&cred->mutex);
 	slurm_mutex_unlock(&rcred->mutex);
@@ -970,6 +1060,7 @@ slurm_cred_destroy(slurm_cred_t *cred)
 	FREE_NULL_LIST(cred->step_gres_list);
 	xfree(cred->step_hostlist);
 	xfree(cred->signature);
+	xfree(cred->job_sig);
 
 	cred->magic = ~CRED_MAGIC;
 	slurm_mutex_unlock(&cred->mutex);
@@ -1022,7 +1113,8 @@ slurm_cred_insert_jobid(slurm_cred_ctx_t ctx, uint32_t jobid)
 int
 slurm_cred_rewind(slurm_cred_ctx_t ctx, slurm_cred_t *cred)
 {
-	int rc = 0;
+	char key[CRED_STATE_KEY_LEN];
+	int rc = SLURM_ERROR;
 
 	xassert(ctx != NULL);
 
@@ -1031,11 +1123,15 @@ slurm_cred_rewind(slurm_cred_ctx_t ctx, slurm_cred_t *cred)
 	xassert(ctx->magic == CRED_CTX_MAGIC);
 	xassert(ctx->type  == SLURM_CRED_VERIFIER);
 
-	rc = list_delete_all(ctx->state_list, _list_find_cred_state, cred);
+	_cred_state_key(&cred->step_id, cred->ctime, key);
+	if (xhash_get(ctx->state_hash, key, CRED_STATE_KEY_LEN)) {
+		xhash_delete(ctx->state_hash, key, CRED_STATE_KEY_LEN);
+		rc = SLURM_SUCCESS;
+	}
 
 	slurm_mutex_unlock(&ctx->mutex);
 
-	return (rc > 0 ? SLURM_SUCCESS : SLURM_ERROR);
+	return rc;
 }
 
 int
@@ -1072,6 +1168,7 @@ slurm_cred_revoke(slurm_cred_ctx_t ctx, uint32_t jobid, time_t time,
 	}
 
 	j->revoked = time;
+	_job_state_expire(ctx, j);
 
 	slurm_mutex_unlock(&ctx->mutex);
 	return SLURM_SUCCESS;
@@ -1106,6 +1203,7 @@ slurm_cred_begin_expiration(slurm_cred_ctx_t ctx, uint32_t jobid)
 	}
 
 	j->expiration  = time(NULL) + ctx->expiry_window;
+	_job_state_expire(ctx, j);
 	debug2("set revoke expiration for jobid %u to %ld UTS",
 	       j->jobid, j->expiration);
 	slurm_mutex_unlock(&ctx->mutex);
@@ -1307,6 +1405,8 @@ void slurm_cred_pack(slurm_cred_t *cred, buf_t *buffer,
 	slurm_mutex_lock(&cred->mutex);
 
 	_pack_cred(cred, buffer, protocol_version);
+	if (protocol_version >= SLURM_21_08_1_PROTOCOL_VERSION)
+		packmem(cred->job_sig, cred->job_siglen, buffer);
 	xassert(cred->siglen > 0);
 	packmem(cred->signature, cred->siglen, buffer);
 
@@ -1385,6 +1485,10 @@ slurm_cred_t *slurm_cred_unpack(buf_t *buffer, uint16_t protocol_version)
 		}
 		safe_unpack32(&cred->job_nhosts, buffer);
 		safe_unpackstr_xmalloc(&cred->job_hostlist, &len, buffer);
+		if (protocol_version >= SLURM_21_08_1_PROTOCOL_VERSION) {
+			safe_unpackmem_xmalloc(&cred->job_sig, &len, buffer);
+			cred->job_siglen = len;
+		}
 
 		/* "sigp" must be last */
 		sigp = (char **) &cred->signature;
@@ -1489,7 +1593,7 @@ int slurm_cred_ctx_unpack(slurm_cred_ctx_t ctx, buf_t *buffer)
 
 	/*
 	 * Unpack job state list and cred state list from buffer
-	 * appening them onto ctx->state_list and ctx->job_list.
+	 * adding them to ctx->job_hash and ctx->state_hash.
 	 */
 	_job_state_unpack(ctx, buffer);
 	_cred_state_unpack(ctx, buffer);
@@ -1534,6 +1638,7 @@ slurm_cred_print(slurm_cred_t *cred)
 	info("Cred: Step hostlist     %s",  cred->step_hostlist );
 	info("Cred: ctime             %s",  slurm_ctime2(&cred->ctime) );
 	info("Cred: siglen            %u",  cred->siglen        );
+	info("Cred: job_siglen        %u",  cred->job_siglen    );
 	info("Cred: job_core_bitmap   %s",
 	     bit_fmt(str, sizeof(str), cred->job_core_bitmap));
 	info("Cred: step_core_bitmap  %s",
@@ -1559,8 +1664,10 @@ _verifier_ctx_init(slurm_cred_ctx_t ctx)
 	xassert(ctx->magic == CRED_CTX_MAGIC);
 	xassert(ctx->type == SLURM_CRED_VERIFIER);
 
-	ctx->job_list   = list_create((ListDelF) _job_state_destroy);
-	ctx->state_list = list_create(xfree_ptr);
+	ctx->job_hash   = xhash_init(_job_state_id, _job_state_destroy);
+	ctx->state_hash = xhash_init(_cred_state_id, xfree_ptr);
+	ctx->job_sigs     = xhash_init(_job_sig_id, _job_sig_destroy);
+	ctx->job_sig_list = list_create(NULL);
 
 	return;
 }
@@ -1586,6 +1693,9 @@ _ctx_update_private_key(slurm_cred_ctx_t ctx, const char *path)
 	tmpk = ctx->key;
 	ctx->key = pk;
 
+	/* Sign job keys with the new key from now on */
+	_clear_job_sigs(ctx, true);
+
 	slurm_mutex_unlock(&ctx->mutex);
 
 	(*(ops.cred_destroy_key))(tmpk);
@@ -1615,6 +1725,9 @@ _ctx_update_public_key(slurm_cred_ctx_t ctx, const char *path)
 	ctx->exkey = ctx->key;
 	ctx->key   = pk;
 
+	/* Check job signatures again with the new key */
+	_clear_job_sigs(ctx, true);
+
 	/*
 	 * exkey expires in expiry_window seconds plus one minute.
 	 * This should be long enough to capture any keys in-flight.
@@ -1673,14 +1786,251 @@ _slurm_cred_alloc(void)
 	return cred;
 }
 
+static void _job_sig_jobid(void *item, const char **key, uint32_t *key_len)
+{
+	job_sig_t *s = item;
+
+	*key = (char *) &s->jobid;
+	*key_len = sizeof(s->jobid);
+}
+
+static void _job_sig_id(void *item, const char **key, uint32_t *key_len)
+{
+	job_sig_t *s = item;
+
+	*key = s->signature;
+	*key_len = s->siglen;
+}
+
+static void _job_sig_destroy(void *item)
+{
+	job_sig_t *s = item;
+
+	memset(s->key, 0, sizeof(s->key));
+	xfree(s->signature);
+	xfree(s);
+}
+
+/* Remove a job signature from ctx->job_sigs. Call with ctx->mutex held */
+static void _job_sig_delete(slurm_cred_ctx_t ctx, job_sig_t *s)
+{
+	if (ctx->type == SLURM_CRED_CREATOR)
+		xhash_delete(ctx->job_sigs, (char *) &s->jobid,
+			     sizeof(s->jobid));
+	else
+		xhash_delete(ctx->job_sigs, s->signature, s->siglen);
+}
+
+/*
+ * Purge expired job signatures, or all of them. Entries are appended as
+ * they are created, so the oldest are at the front of job_sig_list.
+ * Call with ctx->mutex held.
+ */
+static void _clear_job_sigs(slurm_cred_ctx_t ctx, bool all)
+{
+	time_t now = time(NULL);
+	job_sig_t *s;
+
+	if (!ctx->job_sig_list)
+		return;
+
+	while ((s = list_peek(ctx->job_sig_list)) &&
+	       (all || (now >= s->expiration))) {
+		(void) list_pop(ctx->job_sig_list);
+		_job_sig_delete(ctx, s);
+	}
+}
+
+/*
+ * Seconds the creator hands out a job signature for. The last credential
+ * signed with its key is checked up to expiry_window seconds later, which the
+ * job signature must outlive both in the verifier and in the cred plugin.
+ */
+static int _job_sig_reuse(slurm_cred_ctx_t ctx)
+{
+	int reuse = MIN(JOB_SIG_REUSE, ctx->expiry_window / 2);
+	int auth_ttl = slurm_get_auth_ttl();
+
+	if (auth_ttl)
+		reuse = MIN(reuse, auth_ttl / 2);
+	return reuse;
+}
+
+/*
+ * Return the job signature to sign the credential with, creating it if
+ * there is none for the job yet or it has been handed out for long enough.
+ * RET NULL if the job key could not be created or signed.
+ * Call with ctx->mutex held.
+ */
+static job_sig_t *_job_sig_get(slurm_cred_ctx_t ctx, slurm_cred_t *cred)
+{
+	int reuse = _job_sig_reuse(ctx);
+	job_sig_t *s;
+	buf_t *buffer;
+	ssize_t len = -1;
+	int fd, rc;
+
+	if (reuse <= 0)
+		return NULL;
+
+	_clear_job_sigs(ctx, false);
+	if ((s = xhash_get(ctx->job_sigs, (char *) &cred->step_id.job_id,
+			   sizeof(cred->step_id.job_id))))
+		return s;
+
+	s = xmalloc(sizeof(*s));
+	s->jobid = cred->step_id.job_id;
+	s->uid = cred->uid;
+	s->ctime = time(NULL);
+	s->expiration = s->ctime + reuse;
+
+	if ((fd = open("/dev/urandom", O_RDONLY)) >= 0) {
+		len = read(fd, s->key, sizeof(s->key));
+		(void) close(fd);
+	}
+	if (len != sizeof(s->key)) {
+		error("%s: reading job key from /dev/urandom: %m", __func__);
+		_job_sig_destroy(s);
+		return NULL;
+	}
+
+	buffer = init_buf(128);
+	pack16(SLURM_PROTOCOL_VERSION, buffer);
+	pack32(s->jobid, buffer);
+	pack32(s->uid, buffer);
+	pack_time(s->ctime, buffer);
+	packmem((char *) s->key, sizeof(s->key), buffer);
+	rc = (*(ops.cred_seal))(ctx->key,
+				get_buf_data(buffer),
+				get_buf_offset(buffer),
+				&s->signature,
+				&s->siglen);
+	memset(get_buf_data(buffer), 0, get_buf_offset(buffer));
+	free_buf(buffer);
+
+	if (rc) {
+		error("Job signature sign: %s", (*(ops.cred_str_error))(rc));
+		_job_sig_destroy(s);
+		return NULL;
+	}
+
+	xhash_add(ctx->job_sigs, s);
+	list_append(ctx->job_sig_list, s);
+
+	return s;
+}
+
+/*
+ * Return the job signature the credential came with, having the cred plugin
+ * check it unless it has been seen before.
+ * RET NULL if the job signature is not valid.
+ * Call with ctx->mutex held.
+ */
+static job_sig_t *_job_sig_find(slurm_cred_ctx_t ctx, slurm_cred_t *cred)
+{
+	job_sig_t *s;
+	buf_t *buffer;
+	char *data = NULL, *key_ptr;
+	uint32_t data_len = 0, len;
+	uint16_t version;
+	int rc;
+
+	_clear_job_sigs(ctx, false);
+	if ((s = xhash_get(ctx->job_sigs, cred->job_sig, cred->job_siglen)))
+		return s;
+
+	rc = (*(ops.cred_unseal))(ctx->key,
+				  cred->job_sig,
+				  cred->job_siglen,
+				  &data,
+				  &data_len);
+	if (rc && _exkey_is_valid(ctx)) {
+		rc = (*(ops.cred_unseal))(ctx->exkey,
+					  cred->job_sig,
+					  cred->job_siglen,
+					  &data,
+					  &data_len);
+	}
+	if (rc) {
+		error("Job signature check: %s", (*(ops.cred_str_error))(rc));
+		return NULL;
+	}
+
+	s = xmalloc(sizeof(*s));
+	buffer = create_buf(data, data_len);
+	safe_unpack16(&version, buffer);
+	if (version < SLURM_21_08_1_PROTOCOL_VERSION)
+		goto unpack_error;
+	safe_unpack32(&s->jobid, buffer);
+	safe_unpack32(&s->uid, buffer);
+	safe_unpack_time(&s->ctime, buffer);
+	safe_unpackmem_ptr(&key_ptr, &len, buffer);
+	if (len != sizeof(s->key))
+		goto unpack_error;
+	memcpy(s->key, key_ptr, sizeof(s->key));
+	memset(get_buf_data(buffer), 0, size_buf(buffer));
+	free_buf(buffer);
+
+	/*
+	 * The credentials signed with its key are handed out for up to half
+	 * the expiry window and each is good for the window, keep the job
+	 * signature until all of them have expired.
+	 */
+	s->expiration = time(NULL) + (2 * ctx->expiry_window);
+	s->siglen = cred->job_siglen;
+	s->signature = xmalloc(s->siglen);
+	memcpy(s->signature, cred->job_sig, s->siglen);
+	debug2("Checked job signature of JobId=%u", s->jobid);
+
+	xhash_add(ctx->job_sigs, s);
+	list_append(ctx->job_sig_list, s);
+
+	return s;
+
+unpack_error:
+	error("Job signature check: malformed job signature");
+	memset(get_buf_data(buffer), 0, size_buf(buffer));
+	free_buf(buffer);
+	_job_sig_destroy(s);
+	return NULL;
+}
+
+/* Set mac to the HMAC-SHA256 in hex of the credential packed in buffer */
+static void _job_sig_mac(job_sig_t *s, buf_t *buffer,
+			 char mac[JOB_SIG_MAC_LEN])
+{
+	unsigned char digest[SHA256_DIGEST_SIZE];
+	int i;
+
+	hmac_sha256(s->key, sizeof(s->key),
+		    get_buf_data(buffer), get_buf_offset(buffer), digest);
+	for (i = 0; i < SHA256_DIGEST_SIZE; i++)
+		snprintf(mac + (i * 2), 3, "%02x", digest[i]);
+}
+
 static int
 _slurm_cred_sign(slurm_cred_ctx_t ctx, slurm_cred_t *cred,
 		 uint16_t protocol_version)
 {
 	int           rc;
+	job_sig_t    *s = NULL;
 	buf_t *buffer = init_buf(4096);
 
 	_pack_cred(cred, buffer, protocol_version);
+
+	if (protocol_version >= SLURM_21_08_1_PROTOCOL_VERSION)
+		s = _job_sig_get(ctx, cred);
+	if (s) {
+		cred->job_siglen = s->siglen;
+		cred->job_sig = xmalloc(s->siglen);
+		memcpy(cred->job_sig, s->signature, s->siglen);
+		cred->siglen = JOB_SIG_MAC_LEN;
+		cred->signature = xmalloc(cred->siglen);
+		_job_sig_mac(s, buffer, cred->signature);
+		free_buf(buffer);
+		return SLURM_SUCCESS;
+	}
+
 	rc = (*(ops.cred_sign))(ctx->key,
 				get_buf_data(buffer),
 				get_buf_offset(buffer),
@@ -1696,6 +2046,46 @@ _slurm_cred_sign(slurm_cred_ctx_t ctx, slurm_cred_t *cred,
 	return SLURM_SUCCESS;
 }
 
+/*
+ * Check the signature of a credential made with the key of its job
+ * signature, the credential being packed in buffer.
+ * Call with ctx->mutex held.
+ */
+static int _verify_job_sig(slurm_cred_ctx_t ctx, slurm_cred_t *cred,
+			   buf_t *buffer)
+{
+	char mac[JOB_SIG_MAC_LEN];
+	unsigned char diff = 0;
+	job_sig_t *s;
+	int i;
+
+	if (!(s = _job_sig_find(ctx, cred)))
+		return SLURM_ERROR;
+
+	if ((s->jobid != cred->step_id.job_id) || (s->uid != cred->uid)) {
+		error("Credential for JobId=%u UID=%u has the job signature of JobId=%u UID=%u",
+		      cred->step_id.job_id, (uint32_t) cred->uid,
+		      s->jobid, s->uid);
+		return SLURM_ERROR;
+	}
+
+	if (cred->siglen != JOB_SIG_MAC_LEN) {
+		error("Credential signature check: %s",
+		      "Credential data size mismatch");
+		return SLURM_ERROR;
+	}
+	_job_sig_mac(s, buffer, mac);
+	for (i = 0; i < JOB_SIG_MAC_LEN; i++)
+		diff |= mac[i] ^ cred->signature[i];
+	if (diff) {
+		error("Credential signature check: %s",
+		      "Credential data mismatch");
+		return SLURM_ERROR;
+	}
+
+	return SLURM_SUCCESS;
+}
+
 static int
 _slurm_cred_verify_signature(slurm_cred_ctx_t ctx, slurm_cred_t *cred,
 			     uint16_t protocol_version)
@@ -1706,6 +2096,12 @@ _slurm_cred_verify_signature(slurm_cred_ctx_t ctx, slurm_cred_t *cred,
 	debug("Checking credential with %u bytes of sig data", cred->siglen);
 	_pack_cred(cred, buffer, protocol_version);
 
+	if (cred->job_siglen) {
+		rc = _verify_job_sig(ctx, cred, buffer);
+		free_buf(buffer);
+		return rc;
+	}
+
 	rc = (*(ops.cred_verify_sign))(ctx->key,
 				       get_buf_data(buffer),
 				       get_buf_offset(buffer),
@@ -1829,32 +2225,106 @@ static void _pack_cred(slurm_cred_t *cred, buf_t *buffer,
 	}
 }
 
-static int _list_find_cred_state(void *x, void *key)
+static void _cred_state_key(slurm_step_id_t *step_id, time_t ctime,
+			    char *key)
+{
+	int64_t ctime64 = ctime;
+
+	memcpy(key, step_id, sizeof(*step_id));
+	memcpy(key + sizeof(*step_id), &ctime64, sizeof(ctime64));
+}
+
+static void _cred_state_id(void *item, const char **key, uint32_t *key_len)
+{
+	cred_state_t *s = item;
+
+	*key = s->key;
+	*key_len = CRED_STATE_KEY_LEN;
+}
+
+static void _job_state_id(void *item, const char **key, uint32_t *key_len)
+{
+	job_state_t *j = item;
+
+	*key = (char *) &j->jobid;
+	*key_len = sizeof(j->jobid);
+}
+
+static void _expire_queue_push(expire_queue_t *q, time_t expiration,
+			       const char *key, uint32_t key_len)
+{
+	expire_rec_t rec;
+	uint32_t i;
+
+	xassert(key_len <= sizeof(rec.key));
+
+	if (q->cnt == q->size) {
+		q->size = q->size ? (q->size * 2) : 64;
+		xrecalloc(q->recs, q->size, sizeof(expire_rec_t));
+	}
+
+	rec.expiration = expiration;
+	rec.key_len = key_len;
+	memcpy(rec.key, key, key_len);
+
+	for (i = q->cnt++; i > 0; i = (i - 1) / 2) {
+		expire_rec_t *parent = &q->recs[(i - 1) / 2];
+		if (parent->expiration <= expiration)
+			break;
+		q->recs[i] = *parent;
+	}
+	q->recs[i] = rec;
+}
+
+/*
+ * Pop the record expiring first if it expired before now.
+ * RET true if a record was returned in rec
+ */
+static bool _expire_queue_pop(expire_queue_t *q, time_t now,
+			      expire_rec_t *rec)
 {
-	cred_state_t *s = (cred_state_t *) x;
-	slurm_cred_t *cred = (slurm_cred_t *) key;
+	expire_rec_t last;
+	uint32_t i = 0, child;
 
-	if (!memcmp(&s->step_id, &cred->step_id, sizeof(s->step_id)) &&
-	    (s->ctime == cred->ctime))
-		return 1;
+	if (!q->cnt || (now <= q->recs[0].expiration))
+		return false;
+
+	*rec = q->recs[0];
+	last = q->recs[--q->cnt];
+	while ((child = (2 * i) + 1) < q->cnt) {
+		if (((child + 1) < q->cnt) &&
+		    (q->recs[child + 1].expiration <
+		     q->recs[child].expiration))
+			child++;
+		if (last.expiration <= q->recs[child].expiration)
+			break;
+		q->recs[i] = q->recs[child];
+		i = child;
+	}
+	q->recs[i] = last;
 
-	return 0;
+	return true;
 }
 
+static void _expire_queue_free(expire_queue_t *q)
+{
+	xfree(q->recs);
+	q->cnt = q->size = 0;
+}
 
 static bool
 _credential_replayed(slurm_cred_ctx_t ctx, slurm_cred_t *cred)
 {
-	cred_state_t *s = NULL;
+	char key[CRED_STATE_KEY_LEN];
 
 	_clear_expired_credential_states(ctx);
 
-	s = list_find_first(ctx->state_list, _list_find_cred_state, cred);
+	_cred_state_key(&cred->step_id, cred->ctime, key);
 
 	/*
 	 * If we found a match, this credential is being replayed.
 	 */
-	if (s)
+	if (xhash_get(ctx->state_hash, key, CRED_STATE_KEY_LEN))
 		return true;
 
 	/*
@@ -1880,11 +2350,8 @@ slurm_cred_handle_reissue(slurm_cred_ctx_t ctx, slurm_cred_t *cred, bool locked)
 		 * credential to any ensuing commands. */
 		info("reissued job credential for job %u", j->jobid);
 
-		/* Setting j->expiration to zero will make
-		 * _clear_expired_job_states() remove this
-		 * job credential from the cred context. */
-		j->expiration = 0;
-		_clear_expired_job_states(ctx);
+		xhash_delete(ctx->job_hash, (char *) &cred->step_id.job_id,
+			     sizeof(cred->step_id.job_id));
 	}
 	if (!locked)
 		slurm_mutex_unlock(&ctx->mutex);
@@ -1929,31 +2396,19 @@ _credential_revoked(slurm_cred_ctx_t ctx, slurm_cred_t *cred)
 	return false;
 }
 
-static int _list_find_job_state(void *x, void *key)
-{
-	job_state_t *j = (job_state_t *) x;
-	uint32_t jobid = *(uint32_t *) key;
-	if (j->jobid == jobid)
-		return 1;
-	return 0;
-}
-
 static job_state_t *
 _find_job_state(slurm_cred_ctx_t ctx, uint32_t jobid)
 {
-	job_state_t *j =
-		list_find_first(ctx->job_list, _list_find_job_state, &jobid);
-	return j;
+	return xhash_get(ctx->job_hash, (char *) &jobid, sizeof(jobid));
 }
 
 static job_state_t *
 _insert_job_state(slurm_cred_ctx_t ctx, uint32_t jobid)
 {
-	job_state_t *j = list_find_first(
-		ctx->job_list, _list_find_job_state, &jobid);;
+	job_state_t *j = _find_job_state(ctx, jobid);
 	if (!j) {
 		j = _job_state_create(jobid);
-		list_append(ctx->job_list, j);
+		xhash_add(ctx->job_hash, j);
 	} else
 		debug2("%s: we already have a job state for job %u.  No big deal, just an FYI.",
 		       __func__, jobid);
@@ -1975,66 +2430,77 @@ _job_state_create(uint32_t jobid)
 }
 
 static void
-_job_state_destroy(job_state_t *j)
+_job_state_destroy(void *x)
 {
+	job_state_t *j = x;
+
 	debug3 ("destroying job %u state", j->jobid);
 	xfree(j);
 }
 
+/* Queue a revoked job state for purging once its expiration is set */
+static void
+_job_state_expire(slurm_cred_ctx_t ctx, job_state_t *j)
+{
+	if (j->revoked && (j->expiration < (time_t) MAX_TIME))
+		_expire_queue_push(&ctx->job_expire, j->expiration,
+				   (char *) &j->jobid, sizeof(j->jobid));
+}
+
 
 static void
 _clear_expired_job_states(slurm_cred_ctx_t ctx)
 {
-	static time_t last_scan = 0;
 	time_t        now = time(NULL);
-	ListIterator  i   = NULL;
+	expire_rec_t  rec;
 	job_state_t  *j   = NULL;
 
-	if ((now - last_scan) < 2)	/* Reduces slurmd overhead */
-		return;
-	last_scan = now;
-
-	i = list_iterator_create(ctx->job_list);
-	while ((j = list_next(i))) {
+	while (_expire_queue_pop(&ctx->job_expire, now, &rec)) {
+		/* The state may be gone, or requeued since it was queued */
+		if (!(j = xhash_get(ctx->job_hash, rec.key, rec.key_len)) ||
+		    !j->revoked || (now <= j->expiration))
+			continue;
 		debug3("state for jobid %u: ctime:%ld revoked:%ld expires:%ld",
 		       j->jobid, j->ctime, j->revoked, j->expiration);
-		if (j->revoked && (now > j->expiration)) {
-			list_delete_item(i);
-		}
+		xhash_delete(ctx->job_hash, rec.key, rec.key_len);
 	}
-
-	list_iterator_destroy(i);
 }
 
-static int _list_find_expired(void *x, void *key)
+static void
+_clear_expired_credential_states(slurm_cred_ctx_t ctx)
 {
-	cred_state_t *s = (cred_state_t *)x;
-	time_t curr_time = *(time_t *)key;
+	time_t        now = time(NULL);
+	expire_rec_t  rec;
+	cred_state_t *s   = NULL;
 
-	if (curr_time > s->expiration)
-		return 1;
-	return 0;
+	while (_expire_queue_pop(&ctx->state_expire, now, &rec)) {
+		/* The state may have been removed by slurm_cred_rewind() */
+		if (!(s = xhash_get(ctx->state_hash, rec.key, rec.key_len)) ||
+		    (now <= s->expiration))
+			continue;
+		xhash_delete(ctx->state_hash, rec.key, rec.key_len);
+	}
 }
 
+
 static void
-_clear_expired_credential_states(slurm_cred_ctx_t ctx)
+_add_cred_state(slurm_cred_ctx_t ctx, cred_state_t *s)
 {
-	static time_t last_scan = 0;
-	time_t        now = time(NULL);
-
-	if ((now - last_scan) < 2)	/* Reduces slurmd overhead */
+	if (xhash_get(ctx->state_hash, s->key, CRED_STATE_KEY_LEN)) {
+		xfree(s);
 		return;
-	last_scan = now;
+	}
 
-	list_delete_all(ctx->state_list, _list_find_expired, &now);
+	xhash_add(ctx->state_hash, s);
+	_expire_queue_push(&ctx->state_expire, s->expiration, s->key,
+			   CRED_STATE_KEY_LEN);
 }
 
 
 static void
 _insert_cred_state(slurm_cred_ctx_t ctx, slurm_cred_t *cred)
 {
-	cred_state_t *s = _cred_state_create(ctx, cred);
-	list_append(ctx->state_list, s);
+	_add_cred_state(ctx, _cred_state_create(ctx, cred));
 }
 
 
@@ -2046,6 +2512,7 @@ _cred_state_create(slurm_cred_ctx_t ctx, slurm_cred_t *cred)
 	memcpy(&s->step_id, &cred->step_id, sizeof(s->step_id));
 	s->ctime      = cred->ctime;
 	s->expiration = cred->ctime + ctx->expiry_window;
+	_cred_state_key(&s->step_id, s->ctime, s->key);
 
 	return s;
 }
@@ -2067,6 +2534,7 @@ static cred_state_t *_cred_state_unpack_one(buf_t *buffer)
 		goto unpack_error;
 	safe_unpack_time(&s->ctime, buffer);
 	safe_unpack_time(&s->expiration, buffer);
+	_cred_state_key(&s->step_id, s->ctime, s->key);
 	return s;
 
 unpack_error:
@@ -2110,17 +2578,15 @@ unpack_error:
 }
 
 
-static void _cred_state_pack(slurm_cred_ctx_t ctx, buf_t *buffer)
+static void _pack_state_walk(void *item, void *arg)
 {
-	ListIterator  i = NULL;
-	cred_state_t *s = NULL;
-
-	pack32(list_count(ctx->state_list), buffer);
+	_cred_state_pack_one(item, arg);
+}
 
-	i = list_iterator_create(ctx->state_list);
-	while ((s = list_next(i)))
-		_cred_state_pack_one(s, buffer);
-	list_iterator_destroy(i);
+static void _cred_state_pack(slurm_cred_ctx_t ctx, buf_t *buffer)
+{
+	pack32(xhash_count(ctx->state_hash), buffer);
+	xhash_walk(ctx->state_hash, _pack_state_walk, buffer);
 }
 
 
@@ -2139,7 +2605,7 @@ static void _cred_state_unpack(slurm_cred_ctx_t ctx, buf_t *buffer)
 			goto unpack_error;
 
 		if (now < s->expiration)
-			list_append(ctx->state_list, s);
+			_add_cred_state(ctx, s);
 		else
 			xfree(s);
 	}
@@ -2152,18 +2618,15 @@ unpack_error:
 }
 
 
-static void _job_state_pack(slurm_cred_ctx_t ctx, buf_t *buffer)
+static void _pack_job_walk(void *item, void *arg)
 {
-	ListIterator  i = NULL;
-	job_state_t  *j = NULL;
-
-	pack32((uint32_t) list_count(ctx->job_list), buffer);
-
+	_job_state_pack_one(item, arg);
+}
 
-	i = list_iterator_create(ctx->job_list);
-	while ((j = list_next(i)))
-		_job_state_pack_one(j, buffer);
-	list_iterator_destroy(i);
+static void _job_state_pack(slurm_cred_ctx_t ctx, buf_t *buffer)
+{
+	pack32(xhash_count(ctx->job_hash), buffer);
+	xhash_walk(ctx->job_hash, _pack_job_walk, buffer);
 }
 
 
@@ -2181,9 +2644,13 @@ static void _job_state_unpack(slurm_cred_ctx_t ctx, buf_t *buffer)
 		if (!(j = _job_state_unpack_one(buffer)))
 			goto unpack_error;
 
-		if (!j->revoked || (j->revoked && (now < j->expiration)))
-			list_append(ctx->job_list, j);
-		else {
+		if (_find_job_state(ctx, j->jobid)) {
+			debug3("not adding duplicate job %u state", j->jobid);
+			_job_state_destroy(j);
+		} else if (!j->revoked || (j->revoked && (now < j->expiration))) {
+			xhash_add(ctx->job_hash, j);
+			_job_state_expire(ctx, j);
+		} else {
 			debug3 ("not appending expired job %u state",
 			        j->jobid);
 			_job_state_destroy(j);
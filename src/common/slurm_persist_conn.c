@@ -220,114 +220,203 @@ static void _persist_free_msg_members(slurm_persist_conn_t *persist_conn,
 		slurm_free_msg_data(persist_msg->msg_type, persist_msg->data);
 }
 
-static int _process_service_connection(
-	slurm_persist_conn_t *persist_conn, void *arg)
+/*
+ * Read as much of the next message as has arrived on a nonblocking fd,
+ * keeping it in persist_conn->read_buf: the length header, then the body
+ * appended once the header gives its size.
+ * RET SLURM_SUCCESS once read_buf holds the whole message, EAGAIN if more
+ *     has yet to arrive, SLURM_ERROR on EOF or error
+ */
+static int _read_msg_nonblock(slurm_persist_conn_t *persist_conn,
+			      uint32_t uid)
 {
-	uint32_t nw_size = 0, msg_size = 0, uid = NO_VAL;
+	buf_t *buf;
+	uint32_t nw_size, msg_size;
+	ssize_t msg_read;
+
+	if (!persist_conn->read_buf)
+		persist_conn->read_buf = init_buf(sizeof(nw_size));
+	buf = persist_conn->read_buf;
+
+	while (1) {
+		if (buf->processed == buf->size) {
+			if (buf->size > sizeof(nw_size))
+				return SLURM_SUCCESS;
+
+			memcpy(&nw_size, buf->head, sizeof(nw_size));
+			msg_size = ntohl(nw_size);
+			if ((msg_size < 2) || (msg_size > MAX_MSG_SIZE)) {
+				error("Invalid msg_size (%u) from connection %d(%s) uid(%d)",
+				      msg_size, persist_conn->fd,
+				      persist_conn->rem_host, uid);
+				return SLURM_ERROR;
+			}
+			grow_buf(buf, msg_size);
+		}
+
+		msg_read = read(persist_conn->fd, buf->head + buf->processed,
+				buf->size - buf->processed);
+		if (msg_read > 0) {
+			buf->processed += msg_read;
+			continue;
+		}
+		if (!msg_read) {
+			/* EOF, an error only in the middle of a message */
+			if (buf->processed)
+				error("Connection %d(%s) uid(%d) closed with %u of %u bytes of a message read",
+				      persist_conn->fd, persist_conn->rem_host,
+				      uid, buf->processed, buf->size);
+			return SLURM_ERROR;
+		}
+		if (errno == EINTR)
+			continue;
+		if ((errno == EAGAIN) || (errno == EWOULDBLOCK))
+			return EAGAIN;
+		error("read(%d): %m", persist_conn->fd);
+		return SLURM_ERROR;
+	}
+}
+
+extern int slurm_persist_conn_process_service_msg(
+	slurm_persist_conn_t *persist_conn, void *arg, bool *first,
+	uint32_t *uid)
+{
+	uint32_t nw_size = 0, msg_size = 0;
 	char *msg_char = NULL;
 	ssize_t msg_read = 0, offset = 0;
-	bool first = true, fini = false;
+	bool fini = false;
 	buf_t *buffer = NULL;
 	int rc = SLURM_SUCCESS;
 
 	xassert(persist_conn->callback_proc);
 	xassert(persist_conn->shutdown);
 
-	log_flag(NET, "%s: Opened connection %d from %s",
-		 __func__, persist_conn->fd, persist_conn->rem_host);
+	if (persist_conn->flags & PERSIST_FLAG_NONBLOCK) {
+		rc = _read_msg_nonblock(persist_conn, *uid);
+		if (rc == EAGAIN)
+			return SLURM_SUCCESS;	/* the rest comes later */
+		if (rc != SLURM_SUCCESS)
+			return SLURM_ERROR;
+		/*
+		 * Handlers report failures through errno, so do not let the
+		 * EAGAIN of an earlier partial read reach them.
+		 */
+		errno = 0;
+		msg_size = persist_conn->read_buf->size - sizeof(nw_size);
+		msg_char = persist_conn->read_buf->head + sizeof(nw_size);
+		offset = msg_size;
+		goto process;
+	}
 
-	if (persist_conn->flags & PERSIST_FLAG_ALREADY_INITED)
-		first = false;
+	if (!_conn_readable(persist_conn))
+		return SLURM_ERROR;	/* problem with this socket */
+	msg_read = read(persist_conn->fd, &nw_size, sizeof(nw_size));
+	if (msg_read == 0)	/* EOF */
+		return SLURM_ERROR;
+	if (msg_read != sizeof(nw_size)) {
+		error("Could not read msg_size from "
+		      "connection %d(%s) uid(%d)",
+		      persist_conn->fd, persist_conn->rem_host, *uid);
+		return SLURM_ERROR;
+	}
+	msg_size = ntohl(nw_size);
+	if ((msg_size < 2) || (msg_size > MAX_MSG_SIZE)) {
+		error("Invalid msg_size (%u) from "
+		      "connection %d(%s) uid(%d)",
+		      msg_size, persist_conn->fd,
+		      persist_conn->rem_host, *uid);
+		return SLURM_ERROR;
+	}
 
-	while (!(*persist_conn->shutdown) && !fini) {
+	msg_char = xmalloc(msg_size);
+	offset = 0;
+	while (msg_size > offset) {
 		if (!_conn_readable(persist_conn))
 			break;		/* problem with this socket */
-		msg_read = read(persist_conn->fd, &nw_size, sizeof(nw_size));
-		if (msg_read == 0)	/* EOF */
-			break;
-		if (msg_read != sizeof(nw_size)) {
-			error("Could not read msg_size from "
-			      "connection %d(%s) uid(%d)",
-			      persist_conn->fd, persist_conn->rem_host, uid);
-			break;
-		}
-		msg_size = ntohl(nw_size);
-		if ((msg_size < 2) || (msg_size > MAX_MSG_SIZE)) {
-			error("Invalid msg_size (%u) from "
-			      "connection %d(%s) uid(%d)",
-			      msg_size, persist_conn->fd,
-			      persist_conn->rem_host, uid);
+		msg_read = read(persist_conn->fd, (msg_char + offset),
+				(msg_size - offset));
+		if (msg_read <= 0) {
+			error("read(%d): %m", persist_conn->fd);
 			break;
 		}
+		offset += msg_read;
+	}
+process:
+	if (msg_size == offset) {
+		persist_msg_t msg;
 
-		msg_char = xmalloc(msg_size);
-		offset = 0;
-		while (msg_size > offset) {
-			if (!_conn_readable(persist_conn))
-				break;		/* problem with this socket */
-			msg_read = read(persist_conn->fd, (msg_char + offset),
-					(msg_size - offset));
-			if (msg_read <= 0) {
-				error("read(%d): %m", persist_conn->fd);
-				break;
+		rc = slurm_persist_conn_process_msg(
+			persist_conn, &msg,
+			msg_char, msg_size,
+			&buffer, *first);
+
+		if (rc == SLURM_SUCCESS) {
+			rc = (persist_conn->callback_proc)(
+				arg, &msg, &buffer, uid);
+			_persist_free_msg_members(persist_conn, &msg);
+			if (rc != SLURM_SUCCESS &&
+			    rc != ACCOUNTING_FIRST_REG &&
+			    rc != ACCOUNTING_TRES_CHANGE_DB &&
+			    rc != ACCOUNTING_NODES_CHANGE_DB) {
+				error("Processing last message from "
+				      "connection %d(%s) uid(%d)",
+				      persist_conn->fd,
+				      persist_conn->rem_host, *uid);
+				if (rc == ESLURM_ACCESS_DENIED ||
+				    rc == SLURM_PROTOCOL_VERSION_ERROR)
+					fini = true;
 			}
-			offset += msg_read;
-		}
-		if (msg_size == offset) {
-			persist_msg_t msg;
-
-			rc = slurm_persist_conn_process_msg(
-				persist_conn, &msg,
-				msg_char, msg_size,
-				&buffer, first);
-
-			if (rc == SLURM_SUCCESS) {
-				rc = (persist_conn->callback_proc)(
-					arg, &msg, &buffer, &uid);
-				_persist_free_msg_members(persist_conn, &msg);
-				if (rc != SLURM_SUCCESS &&
-				    rc != ACCOUNTING_FIRST_REG &&
-				    rc != ACCOUNTING_TRES_CHANGE_DB &&
-				    rc != ACCOUNTING_NODES_CHANGE_DB) {
-					error("Processing last message from "
-					      "connection %d(%s) uid(%d)",
-					      persist_conn->fd,
-					      persist_conn->rem_host, uid);
-					if (rc == ESLURM_ACCESS_DENIED ||
-					    rc == SLURM_PROTOCOL_VERSION_ERROR)
-						fini = true;
-				}
-			}
-			first = false;
-		} else {
-			buffer = slurm_persist_make_rc_msg(
-				persist_conn, SLURM_ERROR, "Bad offset", 0);
-			fini = true;
 		}
+		*first = false;
+	} else {
+		buffer = slurm_persist_make_rc_msg(
+			persist_conn, SLURM_ERROR, "Bad offset", 0);
+		fini = true;
+	}
 
+	if (persist_conn->read_buf)
+		FREE_NULL_BUFFER(persist_conn->read_buf);
+	else
 		xfree(msg_char);
-		if (buffer) {
-			if (slurm_persist_send_msg(persist_conn, buffer)
-			    != SLURM_SUCCESS) {
-				/* This is only an issue on persistent
-				 * connections, and really isn't that big of a
-				 * deal as the slurmctld will just send the
-				 * message again. */
-				if (persist_conn->rem_port)
-					log_flag(NET, "%s: Problem sending response to connection host:%s fd:%d uid:%d",
-						 __func__,
-						 persist_conn->rem_host,
-						 persist_conn->fd, uid);
-				fini = true;
-			}
-			free_buf(buffer);
+	if (buffer) {
+		if (slurm_persist_send_msg(persist_conn, buffer)
+		    != SLURM_SUCCESS) {
+			/* This is only an issue on persistent
+			 * connections, and really isn't that big of a
+			 * deal as the slurmctld will just send the
+			 * message again. */
+			if (persist_conn->rem_port)
+				log_flag(NET, "%s: Problem sending response to connection host:%s fd:%d uid:%d",
+					 __func__,
+					 persist_conn->rem_host,
+					 persist_conn->fd, *uid);
+			fini = true;
 		}
+		free_buf(buffer);
 	}
 
+	return fini ? SLURM_ERROR : SLURM_SUCCESS;
+}
+
+static void _process_service_connection(
+	slurm_persist_conn_t *persist_conn, void *arg)
+{
+	uint32_t uid = NO_VAL;
+	bool first = true;
+
+	log_flag(NET, "%s: Opened connection %d from %s",
+		 __func__, persist_conn->fd, persist_conn->rem_host);
+
+	if (persist_conn->flags & PERSIST_FLAG_ALREADY_INITED)
+		first = false;
+
+	while (!(*persist_conn->shutdown) &&
+	       (slurm_persist_conn_process_service_msg(
+		       persist_conn, arg, &first, &uid) == SLURM_SUCCESS))
+		;
+
 	log_flag(NET, "%s: Closed connection host:%s fd:%d uid:%d",
 		 __func__, persist_conn->rem_host, persist_conn->fd, uid);
-
-	return rc;
 }
 
 static void *_service_connection(void *arg)
@@ -711,6 +800,7 @@ extern void slurm_persist_conn_members_destroy(
 	}
 	xfree(persist_conn->cluster_name);
 	xfree(persist_conn->rem_host);
+	FREE_NULL_BUFFER(persist_conn->read_buf);
 }
 
 /* Close the persistent connection */
@@ -47,6 +47,8 @@
 #define PERSIST_FLAG_P_USER_CASE    0x0008
 #define PERSIST_FLAG_SUPPRESS_ERR   0x0010
 #define PERSIST_FLAG_EXT_DBD        0x0020
+#define PERSIST_FLAG_NONBLOCK       0x0040 /* read messages as they arrive
+						* on a nonblocking fd */
 
 typedef enum {
 	PERSIST_TYPE_NONE = 0,
@@ -74,6 +76,7 @@ typedef struct {
 	int fd;
 	uint16_t flags;
 	bool inited;
+	buf_t *read_buf;	/* message partly read, PERSIST_FLAG_NONBLOCK */
 	persist_conn_type_t persist_type;
 	char *rem_host;
 	uint16_t rem_port;
@@ -130,6 +133,22 @@ extern int slurm_persist_conn_wait_for_thread_loc(void);
 /* Free the index given from slurm_persist_conn_wait_for_thread_loc */
 extern void slurm_persist_conn_free_thread_loc(int thread_loc);
 
+/* Read and process a single message on a connection being serviced, sending
+ * any response back. This is what the thread created by
+ * slurm_persist_conn_recv_thread_init() does in a loop, for callers that
+ * manage their own threads. With PERSIST_FLAG_NONBLOCK set, only what has
+ * arrived is read and SLURM_SUCCESS returned, the message being completed
+ * and processed by later calls once the fd is readable again.
+ * IN - persist_conn - persistent connection readable for a message.
+ * IN - arg - arbitrary argument that will be sent to the callback.
+ * IN/OUT - first - set if the next message is the first on the connection.
+ * IN/OUT - uid - user ID who initiated the RPC.
+ * RET SLURM_SUCCESS if the connection should be kept open, error otherwise.
+ */
+extern int slurm_persist_conn_process_service_msg(
+	slurm_persist_conn_t *persist_conn, void *arg, bool *first,
+	uint32_t *uid);
+
 
 /* Open a persistent socket connection
  * IN/OUT - persistent connection needing host and port filled in.  Returned
@@ -62,10 +62,12 @@
 #include "src/common/forward.h"
 #include "src/common/log.h"
 #include "src/common/macros.h"
+#include "src/common/msg_compress.h"
 #include "src/common/pack.h"
 #include "src/common/read_config.h"
 #include "src/common/slurm_accounting_storage.h"
 #include "src/common/slurm_auth.h"
+#include "src/common/slurm_conn_pool.h"
 #include "src/common/slurm_protocol_interface.h"
 #include "src/common/slurm_protocol_api.h"
 #include "src/common/slurm_protocol_common.h"
@@ -908,6 +910,24 @@ fini:	_slurm_api_free_comm_config(proto_conf);
 	return rc;
 }
 
+/*
+ * Replace a compressed message body by the original one, once the sender
+ * has been authenticated
+ */
+static int _decompress_body(header_t *header, buf_t *buffer)
+{
+	if (!(header->flags & SLURM_MSG_COMPRESSED))
+		return SLURM_SUCCESS;
+
+	if (msg_decompress(buffer, &header->body_length) != SLURM_SUCCESS) {
+		error("%s: %s body could not be decompressed",
+		      __func__, rpc_num2string(header->msg_type));
+		return ESLURM_PROTOCOL_INCOMPLETE_PACKET;
+	}
+	header->flags &= ~SLURM_MSG_COMPRESSED;
+	return SLURM_SUCCESS;
+}
+
 extern int slurm_unpack_received_msg(slurm_msg_t *msg, int fd, buf_t *buffer)
 {
 	header_t header;
@@ -975,6 +995,11 @@ extern int slurm_unpack_received_msg(slurm_msg_t *msg, int fd, buf_t *buffer)
 	msg->auth_uid = auth_g_get_uid(auth_cred);
 	msg->auth_uid_set = true;
 
+	if ((rc = _decompress_body(&header, buffer)) != SLURM_SUCCESS) {
+		(void) auth_g_destroy(auth_cred);
+		goto total_return;
+	}
+
 	/*
 	 * Unpack message body
 	 */
@@ -1120,20 +1145,11 @@ List slurm_receive_msgs(int fd, int steps, int timeout)
 {
 	char *buf = NULL;
 	size_t buflen = 0;
-	header_t header;
 	int rc;
-	void *auth_cred = NULL;
-	slurm_msg_t msg;
-	buf_t *buffer;
-	ret_data_info_t *ret_data_info = NULL;
-	List ret_list = NULL;
 	int orig_timeout = timeout;
 
 	xassert(fd >= 0);
 
-	slurm_msg_t_init(&msg);
-	msg.conn_fd = fd;
-
 	if (timeout <= 0) {
 		/* convert secs to msec */
 		timeout = slurm_conf.msg_timeout * 1000;
@@ -1168,13 +1184,29 @@ List slurm_receive_msgs(int fd, int steps, int timeout)
 	 *  the message.
 	 */
 	if (slurm_msg_recvfrom_timeout(fd, &buf, &buflen, 0, timeout) < 0) {
-		forward_init(&header.forward);
 		rc = errno;
-		goto total_return;
+		error("slurm_receive_msgs: %s", slurm_strerror(rc));
+		usleep(10000);	/* Discourage brute force attack */
+		errno = rc;
+		return NULL;
 	}
 
 	log_flag_hex(NET_RAW, buf, buflen, "%s: read", __func__);
-	buffer = create_buf(buf, buflen);
+
+	return slurm_unpack_received_msgs(fd, create_buf(buf, buflen));
+}
+
+extern List slurm_unpack_received_msgs(int fd, buf_t *buffer)
+{
+	header_t header;
+	int rc;
+	void *auth_cred = NULL;
+	slurm_msg_t msg;
+	ret_data_info_t *ret_data_info = NULL;
+	List ret_list = NULL;
+
+	slurm_msg_t_init(&msg);
+	msg.conn_fd = fd;
 
 	if (unpack_header(&header, buffer) == SLURM_ERROR) {
 		free_buf(buffer);
@@ -1239,6 +1271,12 @@ List slurm_receive_msgs(int fd, int steps, int timeout)
 	msg.auth_uid = auth_g_get_uid(auth_cred);
 	msg.auth_uid_set = true;
 
+	if ((rc = _decompress_body(&header, buffer)) != SLURM_SUCCESS) {
+		(void) auth_g_destroy(auth_cred);
+		free_buf(buffer);
+		goto total_return;
+	}
+
 	/*
 	 * Unpack message body
 	 */
@@ -1421,6 +1459,8 @@ int slurm_receive_msg_and_forward(int fd, slurm_addr_t *orig_addr,
 		if (!msg->forward_struct->timeout)
 			msg->forward_struct->timeout = message_timeout;
 		msg->forward_struct->fwd_cnt = header.forward.cnt;
+		msg->forward_struct->aggregate =
+			(header.flags & SLURM_MSG_AGGREGATE);
 
 		log_flag(NET, "%s: forwarding messages to %u nodes with timeout of %d",
 			 __func__, msg->forward_struct->fwd_cnt,
@@ -1457,6 +1497,12 @@ int slurm_receive_msg_and_forward(int fd, slurm_addr_t *orig_addr,
 	msg->auth_uid = auth_g_get_uid(auth_cred);
 	msg->auth_uid_set = true;
 
+	if ((rc = _decompress_body(&header, buffer)) != SLURM_SUCCESS) {
+		(void) auth_g_destroy(auth_cred);
+		free_buf(buffer);
+		goto total_return;
+	}
+
 	/*
 	 * Unpack message body
 	 */
@@ -1498,6 +1544,36 @@ total_return:
  * send message functions
 \**********************************************************************/
 
+/*
+ * Compress the packed body of msg if the peer it answers accepts a codec,
+ * see msg_compress.h
+ * RET the compressed body to send instead, or NULL. It is msg's
+ *	data_compressed, not to be freed, if that was set and is usable.
+ */
+static buf_t *_compress_body(slurm_msg_t *msg, header_t *hdr, char *body,
+			     uint32_t body_len)
+{
+	buf_t *compressed;
+
+	if (hdr->version < SLURM_21_08_1_PROTOCOL_VERSION)
+		return NULL;
+	if (msg_compress_usable(msg->data_compressed, msg->flags)) {
+		hdr->flags |= SLURM_MSG_COMPRESSED;
+		log_flag(NET, "%s: %s body of %u bytes sent as compressed earlier to %u bytes",
+			 __func__, rpc_num2string(msg->msg_type), body_len,
+			 get_buf_offset(msg->data_compressed));
+		return msg->data_compressed;
+	}
+	if (!(compressed = msg_compress(body, body_len, msg->flags)))
+		return NULL;
+
+	hdr->flags |= SLURM_MSG_COMPRESSED;
+	log_flag(NET, "%s: %s body compressed from %u to %u bytes",
+		 __func__, rpc_num2string(msg->msg_type), body_len,
+		 get_buf_offset(compressed));
+	return compressed;
+}
+
 /*
  *  Do the wonderful stuff that needs be done to pack msg
  *  and hdr into buffer
@@ -1505,11 +1581,23 @@ total_return:
 static void _pack_msg(slurm_msg_t *msg, header_t *hdr, buf_t *buffer)
 {
 	unsigned int tmplen, msglen;
+	buf_t *compressed;
 
 	tmplen = get_buf_offset(buffer);
 	pack_msg(msg, buffer);
 	msglen = get_buf_offset(buffer) - tmplen;
 
+	if ((compressed = _compress_body(msg, hdr,
+					 get_buf_data(buffer) + tmplen,
+					 msglen))) {
+		set_buf_offset(buffer, tmplen);
+		packmem_array(get_buf_data(compressed),
+			      get_buf_offset(compressed), buffer);
+		msglen = get_buf_offset(compressed);
+		if (compressed != msg->data_compressed)
+			free_buf(compressed);
+	}
+
 	/* update header with correct cred and msg lengths */
 	update_header(hdr, msglen);
 
@@ -1520,6 +1608,80 @@ static void _pack_msg(slurm_msg_t *msg, header_t *hdr, buf_t *buffer)
 	set_buf_offset(buffer, tmplen);
 }
 
+/*
+ * Pack the header and auth credential of msg into a new buffer, the
+ * credential is consumed.
+ * RET the buffer or NULL on failure with errno set
+ */
+static buf_t *_pack_header_auth(slurm_msg_t *msg, header_t *header,
+				void *auth_cred)
+{
+	buf_t *buffer;
+	int rc;
+
+	/* Advertise our codecs in place of any the peer sent us */
+	init_header(header, msg, msg->flags & ~SLURM_MSG_COMPRESS_FLAGS);
+	if (header->version >= SLURM_21_08_1_PROTOCOL_VERSION)
+		header->flags |= msg_compress_accept();
+
+	/*
+	 * Pack header into buffer for transmission
+	 */
+	buffer = init_buf(BUF_SIZE);
+	pack_header(header, buffer);
+
+	/*
+	 * Pack auth credential
+	 */
+	rc = auth_g_pack(auth_cred, buffer, header->version);
+	(void) auth_g_destroy(auth_cred);
+	if (rc) {
+		error("%s: auth_g_pack: %s has  authentication error: %m",
+		      __func__, rpc_num2string(header->msg_type));
+		free_buf(buffer);
+		slurm_seterrno(SLURM_PROTOCOL_AUTHENTICATION_ERROR);
+		return NULL;
+	}
+
+	return buffer;
+}
+
+extern buf_t *slurm_pack_node_msg(slurm_msg_t *msg)
+{
+	header_t header;
+	buf_t *buffer;
+	void *auth_cred;
+
+	if (msg->flags & SLURM_GLOBAL_AUTH_KEY) {
+		auth_cred = auth_g_create(msg->auth_index, _global_auth_key());
+	} else {
+		auth_cred = auth_g_create(msg->auth_index, slurm_conf.authinfo);
+	}
+	if (auth_cred == NULL) {
+		error("%s: auth_g_create: %s has authentication error: %m",
+		      __func__, rpc_num2string(msg->msg_type));
+		slurm_seterrno(SLURM_PROTOCOL_AUTHENTICATION_ERROR);
+		return NULL;
+	}
+
+	if (msg->forward.init != FORWARD_INIT) {
+		forward_init(&msg->forward);
+		msg->ret_list = NULL;
+	}
+
+	if (!msg->forward.tree_width)
+		msg->forward.tree_width = slurm_conf.tree_width;
+
+	if (!(buffer = _pack_header_auth(msg, &header, auth_cred)))
+		return NULL;
+
+	_pack_msg(msg, &header, buffer);
+	log_flag_hex(NET_RAW, get_buf_data(buffer), get_buf_offset(buffer),
+		     "%s: packed", __func__);
+
+	return buffer;
+}
+
 /*
  *  Send a slurm message over an open file descriptor `fd'
  *    Returns the size of the message sent in bytes, or -1 on failure.
@@ -1602,38 +1764,59 @@ int slurm_send_node_msg(int fd, slurm_msg_t * msg)
 		slurm_seterrno_ret(SLURM_PROTOCOL_AUTHENTICATION_ERROR);
 	}
 
-	init_header(&header, msg, msg->flags);
-
-	/*
-	 * Pack header into buffer for transmission
-	 */
-	buffer = init_buf(BUF_SIZE);
-	pack_header(&header, buffer);
+	if (!(buffer = _pack_header_auth(msg, &header, auth_cred)))
+		return SLURM_ERROR;
 
-	/*
-	 * Pack auth credential
-	 */
-	rc = auth_g_pack(auth_cred, buffer, header.version);
-	(void) auth_g_destroy(auth_cred);
-	if (rc) {
-		error("%s: auth_g_pack: %s has  authentication error: %m",
-		      __func__, rpc_num2string(header.msg_type));
-		free_buf(buffer);
-		slurm_seterrno_ret(SLURM_PROTOCOL_AUTHENTICATION_ERROR);
-	}
+	if (pack_msg_is_prepacked(msg->msg_type) &&
+	    (msg->protocol_version >= SLURM_MIN_PROTOCOL_VERSION)) {
+		struct iovec iov[2];
+		uint32_t tmplen;
+		buf_t *compressed;
 
-	/*
-	 * Pack message into buffer
-	 */
-	_pack_msg(msg, &header, buffer);
-	log_flag_hex(NET_RAW, get_buf_data(buffer), get_buf_offset(buffer),
-		     "%s: packed", __func__);
+		/*
+		 * The body was packed by the caller, send it from there
+		 * rather than copying it after the header and credential.
+		 */
+		compressed = _compress_body(msg, &header, msg->data,
+					    msg->data_size);
+		update_header(&header, compressed ? get_buf_offset(compressed) :
+						    msg->data_size);
+		tmplen = get_buf_offset(buffer);
+		set_buf_offset(buffer, 0);
+		pack_header(&header, buffer);
+		set_buf_offset(buffer, tmplen);
+		log_flag_hex(NET_RAW, get_buf_data(buffer),
+			     get_buf_offset(buffer), "%s: packed header",
+			     __func__);
+		log_flag_hex(NET_RAW, msg->data, msg->data_size,
+			     "%s: prepacked body", __func__);
+
+		iov[0].iov_base = get_buf_data(buffer);
+		iov[0].iov_len = get_buf_offset(buffer);
+		if (compressed) {
+			iov[1].iov_base = get_buf_data(compressed);
+			iov[1].iov_len = get_buf_offset(compressed);
+		} else {
+			iov[1].iov_base = msg->data;
+			iov[1].iov_len = msg->data_size;
+		}
+		rc = slurm_msg_sendv(fd, iov, 2);
+		if (compressed != msg->data_compressed)
+			FREE_NULL_BUFFER(compressed);
+	} else {
+		/*
+		 * Pack message into buffer
+		 */
+		_pack_msg(msg, &header, buffer);
+		log_flag_hex(NET_RAW, get_buf_data(buffer),
+			     get_buf_offset(buffer), "%s: packed", __func__);
 
-	/*
-	 * Send message
-	 */
-	rc = slurm_msg_sendto(fd, get_buf_data(buffer),
-			      get_buf_offset(buffer));
+		/*
+		 * Send message
+		 */
+		rc = slurm_msg_sendto(fd, get_buf_data(buffer),
+				      get_buf_offset(buffer));
+	}
 
 	if ((rc < 0) && (errno == ENOTCONN)) {
 		log_flag(NET, "%s: peer has disappeared for msg_type=%u",
@@ -2051,12 +2234,13 @@ _send_and_recv_msg(int fd, slurm_msg_t *req,
  * IN fd	- file descriptor to receive msg on
  * IN req	- a slurm_msg struct to be sent by the function
  * IN timeout	- how long to wait in milliseconds
+ * OUT sent	- set if the request was sent, even if no response came back
  * RET List	- List containing the responses of the children (if any) we
  *		  forwarded the message to. List containing type
  *		  (ret_data_info_t).
  */
 static List
-_send_and_recv_msgs(int fd, slurm_msg_t *req, int timeout)
+_send_and_recv_msgs(int fd, slurm_msg_t *req, int timeout, bool *sent)
 {
 	List ret_list = NULL;
 	int steps = 0;
@@ -2066,7 +2250,9 @@ _send_and_recv_msgs(int fd, slurm_msg_t *req, int timeout)
 			timeout = slurm_conf.msg_timeout * 1000;
 		req->forward.timeout = timeout;
 	}
+	*sent = false;
 	if (slurm_send_node_msg(fd, req) >= 0) {
+		*sent = true;
 		if (req->forward.cnt > 0) {
 			/* figure out where we are in the tree and set
 			 * the timeout for to wait for our children
@@ -2090,7 +2276,14 @@ _send_and_recv_msgs(int fd, slurm_msg_t *req, int timeout)
 		ret_list = slurm_receive_msgs(fd, steps, timeout);
 	}
 
-	(void) close(fd);
+	/*
+	 * A connection which completed an exchange may be reused if the
+	 * receiver was asked to keep it open.
+	 */
+	if (ret_list && (req->flags & SLURM_MSG_KEEP_ALIVE))
+		slurm_conn_pool_put(&req->address, fd);
+	else
+		(void) close(fd);
 
 	return ret_list;
 }
@@ -2437,6 +2630,7 @@ List slurm_send_addr_recv_msgs(slurm_msg_t *msg, char *name, int timeout)
 	static uint16_t conn_timeout = NO_VAL16, tcp_timeout = 2;
 	List ret_list = NULL;
 	int fd = -1;
+	bool pooled = false, sent;
 	ret_data_info_t *ret_data_info = NULL;
 	ListIterator itr;
 	int i;
@@ -2449,9 +2643,15 @@ List slurm_send_addr_recv_msgs(slurm_msg_t *msg, char *name, int timeout)
 	}
 	slurm_mutex_unlock(&conn_lock);
 
+	if (msg->flags & SLURM_MSG_KEEP_ALIVE) {
+		fd = slurm_conn_pool_get(&msg->address);
+		pooled = (fd >= 0);
+	}
+
+connect:
 	/* This connect retry logic permits Slurm hierarchical communications
 	 * to better survive slurmd restarts */
-	for (i = 0; i <= conn_timeout; i++) {
+	for (i = 0; (fd < 0) && (i <= conn_timeout); i++) {
 		fd = slurm_open_msg_conn(&msg->address);
 		if ((fd >= 0) || (errno != ECONNREFUSED && errno != ETIMEDOUT))
 			break;
@@ -2477,7 +2677,21 @@ List slurm_send_addr_recv_msgs(slurm_msg_t *msg, char *name, int timeout)
 
 	msg->ret_list = NULL;
 	msg->forward_struct = NULL;
-	if (!(ret_list = _send_and_recv_msgs(fd, msg, timeout))) {
+	if (!(ret_list = _send_and_recv_msgs(fd, msg, timeout, &sent))) {
+		/*
+		 * The peer may have dropped an idle connection in a way the
+		 * pool could not see. _send_and_recv_msgs() closed it rather
+		 * than returning it to the pool, so try once more on a new one.
+		 * Once the request went out the peer may have acted on it, so
+		 * only a failed send is safe to repeat.
+		 */
+		if (pooled && !sent) {
+			log_flag(NET, "Pooled connection to %pA failed, retrying on a new connection",
+				 &msg->address);
+			pooled = false;
+			fd = -1;
+			goto connect;
+		}
 		mark_as_failed_forward(&ret_list, name, errno);
 		errno = SLURM_COMMUNICATIONS_CONNECTION_ERROR;
 		return ret_list;
@@ -287,6 +287,18 @@ int slurm_receive_msg(int fd, slurm_msg_t *msg, int timeout);
  */
 List slurm_receive_msgs(int fd, int steps, int timeout);
 
+/*
+ * Unpack a complete received response which may carry the responses of the
+ *    nodes it was forwarded to, as read by slurm_receive_msgs(). The buffer
+ *    is freed.
+ *
+ * IN fd	- file descriptor the message came from
+ * IN buffer	- the message without its length
+ * RET List	- List containing type (ret_data_info_t) or NULL on failure
+ *                with errno set
+ */
+extern List slurm_unpack_received_msgs(int fd, buf_t *buffer);
+
 /*
  *  Receive a slurm message on the open slurm descriptor "fd". This will also
  *  forward the message to the nodes contained in the forward_t structure
@@ -315,6 +327,16 @@ int slurm_receive_msg_and_forward(int fd, slurm_addr_t *orig_addr,
  */
 int slurm_send_node_msg(int open_fd, slurm_msg_t *msg);
 
+/*
+ * Pack a message as slurm_send_node_msg() would send it, without the
+ * leading message length. Prepacked and persistent connection messages are
+ * not supported.
+ *
+ * IN msg		- a slurm msg struct to be packed
+ * RET buf_t *		- the packed message or NULL on failure with errno set
+ */
+extern buf_t *slurm_pack_node_msg(slurm_msg_t *msg);
+
 /**********************************************************************\
  * msg connection establishment functions used by msg clients
 \**********************************************************************/
@@ -66,11 +66,19 @@
  * done here with them since we have to support old version of archive
  * files since they don't update once they are created.
  */
+/*
+ * 21.08 with the compact job_resources encoding, compressed message bodies,
+ * aggregated forwarding replies, the extended slurmctld statistics (RPC
+ * latency, workers, batching, compression and allocation profile) and the
+ * slurmdbd query cache statistics. Peers at SLURM_21_08_PROTOCOL_VERSION are
+ * still accepted and sent the formats they know.
+ */
+#define SLURM_21_08_1_PROTOCOL_VERSION ((37 << 8) | 1)
 #define SLURM_21_08_PROTOCOL_VERSION ((37 << 8) | 0)
 #define SLURM_20_11_PROTOCOL_VERSION ((36 << 8) | 0)
 #define SLURM_20_02_PROTOCOL_VERSION ((35 << 8) | 0)
 
-#define SLURM_PROTOCOL_VERSION SLURM_21_08_PROTOCOL_VERSION
+#define SLURM_PROTOCOL_VERSION SLURM_21_08_1_PROTOCOL_VERSION
 #define SLURM_ONE_BACK_PROTOCOL_VERSION SLURM_20_11_PROTOCOL_VERSION
 #define SLURM_MIN_PROTOCOL_VERSION SLURM_20_02_PROTOCOL_VERSION
 
@@ -105,5 +113,13 @@
 #define SLURM_DROP_PRIV		0x0008
 #define USE_BCAST_NETWORK	0x0010
 #define CTLD_QUEUE_PROCESSING	0x0020
+#define SLURM_MSG_KEEP_ALIVE	0x0040	/* sender reuses the connection */
+#define SLURM_MSG_AGGREGATE	0x0080	/* merge identical forwarded replies */
+#define SLURM_MSG_COMPRESSED	0x0100	/* body compressed, see msg_compress.h */
+#define SLURM_MSG_ACCEPT_LZ4	0x0200	/* sender decompresses lz4 bodies */
+#define SLURM_MSG_ACCEPT_ZLIB	0x0400	/* sender decompresses zlib bodies */
+#define SLURM_MSG_COMPRESS_FLAGS (SLURM_MSG_COMPRESSED |	\
+				  SLURM_MSG_ACCEPT_LZ4 |	\
+				  SLURM_MSG_ACCEPT_ZLIB)
 
 #endif
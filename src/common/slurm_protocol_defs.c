@@ -1745,6 +1745,8 @@ extern void slurm_free_stats_response_msg(stats_info_response_msg_t *msg)
 		xfree(msg->rpc_type_id);
 		xfree(msg->rpc_type_cnt);
 		xfree(msg->rpc_type_time);
+		xfree(msg->rpc_hist_bound);
+		xfree(msg->rpc_type_hist);
 		xfree(msg->rpc_user_id);
 		xfree(msg->rpc_user_cnt);
 		xfree(msg->rpc_user_time);
@@ -1755,6 +1757,18 @@ extern void slurm_free_stats_response_msg(stats_info_response_msg_t *msg)
 			xfree(msg->rpc_dump_hostlist[i]);
 		}
 		xfree(msg->rpc_dump_hostlist);
+		xfree(msg->rpc_pending_hist);
+		xfree(msg->rpc_batch_type_id);
+		xfree(msg->rpc_batch_rpc_cnt);
+		xfree(msg->rpc_batch_lock_cnt);
+		xfree(msg->rpc_batch_depth);
+		for (i = 0; msg->xmalloc_site &&
+			    (i < msg->xmalloc_site_count); i++)
+			xfree(msg->xmalloc_site[i]);
+		xfree(msg->xmalloc_site);
+		xfree(msg->xmalloc_site_cnt);
+		xfree(msg->xmalloc_site_bytes);
+		xfree(msg->xmalloc_site_live);
 		xfree(msg);
 	}
 }
@@ -5069,6 +5083,7 @@ extern int slurm_free_msg_data(slurm_msg_type_t type, void *data)
 		slurm_free_file_bcast_msg(data);
 		break;
 	case RESPONSE_SLURM_RC:
+	case RESPONSE_FORWARD_AGGREGATE:
 		slurm_free_return_code_msg(data);
 		break;
 	case REQUEST_SET_DEBUG_FLAGS:
@@ -5249,6 +5264,7 @@ extern uint32_t slurm_get_return_code(slurm_msg_type_t type, void *data)
 		rc = ((job_id_response_msg_t *)data)->return_code;
 		break;
 	case RESPONSE_SLURM_RC:
+	case RESPONSE_FORWARD_AGGREGATE:
 		rc = ((return_code_msg_t *)data)->return_code;
 		break;
 	case RESPONSE_PING_SLURMD:
@@ -5710,6 +5726,8 @@ rpc_num2string(uint16_t opcode)
 
 	case RESPONSE_FORWARD_FAILED:				/* 9001 */
 		return "RESPONSE_FORWARD_FAILED";
+	case RESPONSE_FORWARD_AGGREGATE:
+		return "RESPONSE_FORWARD_AGGREGATE";
 
 	case ACCOUNTING_UPDATE_MSG:				/* 10001 */
 		return "ACCOUNTING_UPDATE_MSG";
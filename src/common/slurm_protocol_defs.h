@@ -440,6 +440,7 @@ typedef enum {
 	RESPONSE_SLURM_REROUTE_MSG,
 
 	RESPONSE_FORWARD_FAILED = 9001,
+	RESPONSE_FORWARD_AGGREGATE,
 
 	ACCOUNTING_UPDATE_MSG = 10001,
 	ACCOUNTING_FIRST_REG,
@@ -482,6 +483,8 @@ typedef struct forward_struct {
 	pthread_cond_t notify;
 	List ret_list;
 	uint32_t timeout;
+	bool aggregate;		/* merge identical replies, see
+				 * SLURM_MSG_AGGREGATE */
 } forward_struct_t;
 
 typedef struct forward_message {
@@ -530,6 +533,10 @@ typedef struct slurm_msg {
 		      * connection. */
 	void *data;
 	uint32_t data_size;
+	buf_t *data_compressed;	/* DON'T PACK OR FREE! prepacked data as
+				 * compressed by msg_compress() for an
+				 * earlier peer, reused if this one
+				 * accepts its codec. */
 	uint16_t flags;
 	uint16_t msg_index;
 	uint16_t msg_type; /* really a slurm_msg_type_t but needs to be
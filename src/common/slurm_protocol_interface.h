@@ -48,6 +48,7 @@
 #include <sys/socket.h>
 #include <sys/time.h>
 #include <sys/types.h>
+#include <sys/uio.h>
 #include <unistd.h>
 
 #include "src/common/macros.h"
@@ -95,6 +96,23 @@ extern ssize_t slurm_msg_sendto_timeout(int open_fd,
 					size_t size,
 					int timeout);
 
+/* Most buffers accepted by slurm_msg_sendv() */
+#define SLURM_MSG_IOV_MAX 4
+
+/* slurm_msg_sendv
+ * Send one message made of several buffers without first copying them
+ * together, default timeout value
+ * IN open_fd - an open file descriptor
+ * IN iov - buffers to transmit in order, at most SLURM_MSG_IOV_MAX
+ * IN iovcnt - number of buffers in iov
+ * RET number of bytes written
+ */
+extern ssize_t slurm_msg_sendv(int open_fd, struct iovec *iov, int iovcnt);
+/* slurm_msg_sendv_timeout is identical to slurm_msg_sendv except
+ * IN timeout - maximum time to wait for a message in milliseconds */
+extern ssize_t slurm_msg_sendv_timeout(int open_fd, struct iovec *iov,
+				       int iovcnt, int timeout);
+
 /********************/
 /* stream functions */
 /********************/
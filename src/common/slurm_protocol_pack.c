@@ -10565,7 +10565,141 @@ static int  _unpack_stats_response_msg(stats_info_response_msg_t **msg_ptr,
 	msg = xmalloc ( sizeof (stats_info_response_msg_t) );
 	*msg_ptr = msg ;
 
-	if (protocol_version >= SLURM_MIN_PROTOCOL_VERSION) {
+	if (protocol_version >= SLURM_21_08_1_PROTOCOL_VERSION) {
+		safe_unpack32(&msg->parts_packed,	buffer);
+		if (msg->parts_packed) {
+			safe_unpack_time(&msg->req_time,	buffer);
+			safe_unpack_time(&msg->req_time_start,	buffer);
+			safe_unpack32(&msg->server_thread_count,buffer);
+			safe_unpack32(&msg->agent_queue_size,	buffer);
+			safe_unpack32(&msg->agent_count,	buffer);
+			safe_unpack32(&msg->agent_thread_count,	buffer);
+			safe_unpack32(&msg->dbd_agent_queue_size, buffer);
+			safe_unpack32(&msg->gettimeofday_latency, buffer);
+			safe_unpack32(&msg->jobs_submitted,	buffer);
+			safe_unpack32(&msg->jobs_started,	buffer);
+			safe_unpack32(&msg->jobs_completed,	buffer);
+			safe_unpack32(&msg->jobs_canceled,	buffer);
+			safe_unpack32(&msg->jobs_failed,	buffer);
+
+			safe_unpack32(&msg->jobs_pending,	buffer);
+			safe_unpack32(&msg->jobs_running,	buffer);
+			safe_unpack_time(&msg->job_states_ts,	buffer);
+
+			safe_unpack32(&msg->schedule_cycle_max,	buffer);
+			safe_unpack32(&msg->schedule_cycle_last,buffer);
+			safe_unpack32(&msg->schedule_cycle_sum,	buffer);
+			safe_unpack32(&msg->schedule_cycle_counter, buffer);
+			safe_unpack32(&msg->schedule_cycle_depth, buffer);
+			safe_unpack32(&msg->schedule_queue_len,	buffer);
+
+			safe_unpack32(&msg->bf_backfilled_jobs,	buffer);
+			safe_unpack32(&msg->bf_last_backfilled_jobs, buffer);
+			safe_unpack32(&msg->bf_cycle_counter,	buffer);
+			safe_unpack64(&msg->bf_cycle_sum,	buffer);
+			safe_unpack32(&msg->bf_cycle_last,	buffer);
+			safe_unpack32(&msg->bf_last_depth,	buffer);
+			safe_unpack32(&msg->bf_last_depth_try,	buffer);
+
+			safe_unpack32(&msg->bf_queue_len,	buffer);
+			safe_unpack32(&msg->bf_cycle_max,	buffer);
+			safe_unpack_time(&msg->bf_when_last_cycle, buffer);
+			safe_unpack32(&msg->bf_depth_sum,	buffer);
+			safe_unpack32(&msg->bf_depth_try_sum,	buffer);
+			safe_unpack32(&msg->bf_queue_len_sum,	buffer);
+			safe_unpack32(&msg->bf_table_size,	buffer);
+			safe_unpack32(&msg->bf_table_size_sum,	buffer);
+
+			safe_unpack32(&msg->bf_active,		buffer);
+			safe_unpack32(&msg->bf_backfilled_het_jobs, buffer);
+		}
+
+		safe_unpack32(&msg->rpc_type_size,		buffer);
+		safe_unpack16_array(&msg->rpc_type_id,   &uint32_tmp, buffer);
+		safe_unpack32_array(&msg->rpc_type_cnt,  &uint32_tmp, buffer);
+		safe_unpack64_array(&msg->rpc_type_time, &uint32_tmp, buffer);
+		safe_unpack32_array(&msg->rpc_hist_bound, &msg->rpc_hist_size,
+				    buffer);
+		safe_unpack32_array(&msg->rpc_type_hist, &uint32_tmp, buffer);
+		if (uint32_tmp != (msg->rpc_type_size * msg->rpc_hist_size))
+			goto unpack_error;
+
+		safe_unpack32(&msg->rpc_user_size,		buffer);
+		safe_unpack32_array(&msg->rpc_user_id,   &uint32_tmp, buffer);
+		safe_unpack32_array(&msg->rpc_user_cnt,  &uint32_tmp, buffer);
+		safe_unpack64_array(&msg->rpc_user_time, &uint32_tmp, buffer);
+
+		safe_unpack32_array(&msg->rpc_queue_type_id,
+				    &msg->rpc_queue_type_count,
+				    buffer);
+		safe_unpack32_array(&msg->rpc_queue_count,
+				    &uint32_tmp, buffer);
+		if (uint32_tmp != msg->rpc_queue_type_count)
+			goto unpack_error;
+
+		safe_unpack32_array(&msg->rpc_dump_types,
+				    &msg->rpc_dump_count,
+				    buffer);
+		safe_unpackstr_array(&msg->rpc_dump_hostlist,
+				     &uint32_tmp,
+				     buffer);
+		if (uint32_tmp != msg->rpc_dump_count)
+			goto unpack_error;
+
+		safe_unpack32(&msg->rpc_conn_count, buffer);
+		safe_unpack32(&msg->rpc_worker_count, buffer);
+		safe_unpack32(&msg->rpc_pending_count, buffer);
+		safe_unpack32(&msg->rpc_pending_max, buffer);
+		safe_unpack32_array(&msg->rpc_pending_hist, &uint32_tmp,
+				    buffer);
+		if (uint32_tmp != msg->rpc_hist_size)
+			goto unpack_error;
+
+		safe_unpack32(&msg->rpc_batch_count, buffer);
+		safe_unpack16_array(&msg->rpc_batch_type_id, &uint32_tmp,
+				    buffer);
+		if (uint32_tmp != msg->rpc_batch_count)
+			goto unpack_error;
+		safe_unpack32_array(&msg->rpc_batch_rpc_cnt, &uint32_tmp,
+				    buffer);
+		if (uint32_tmp != msg->rpc_batch_count)
+			goto unpack_error;
+		safe_unpack32_array(&msg->rpc_batch_lock_cnt, &uint32_tmp,
+				    buffer);
+		if (uint32_tmp != msg->rpc_batch_count)
+			goto unpack_error;
+		safe_unpack32_array(&msg->rpc_batch_depth, &uint32_tmp,
+				    buffer);
+		if (uint32_tmp != msg->rpc_batch_count)
+			goto unpack_error;
+
+		safe_unpack16(&msg->rpc_compress_type, buffer);
+		safe_unpack32(&msg->rpc_compress_min, buffer);
+		safe_unpack32(&msg->rpc_compress_cnt, buffer);
+		safe_unpack32(&msg->rpc_compress_skip_cnt, buffer);
+		safe_unpack64(&msg->rpc_compress_in, buffer);
+		safe_unpack64(&msg->rpc_compress_out, buffer);
+		safe_unpack64(&msg->rpc_compress_usec, buffer);
+		safe_unpack32(&msg->rpc_decompress_cnt, buffer);
+		safe_unpack64(&msg->rpc_decompress_usec, buffer);
+
+		safe_unpack32(&msg->xmalloc_site_count, buffer);
+		safe_unpackstr_array(&msg->xmalloc_site, &uint32_tmp, buffer);
+		if (uint32_tmp != msg->xmalloc_site_count)
+			goto unpack_error;
+		safe_unpack64_array(&msg->xmalloc_site_cnt, &uint32_tmp,
+				    buffer);
+		if (uint32_tmp != msg->xmalloc_site_count)
+			goto unpack_error;
+		safe_unpack64_array(&msg->xmalloc_site_bytes, &uint32_tmp,
+				    buffer);
+		if (uint32_tmp != msg->xmalloc_site_count)
+			goto unpack_error;
+		safe_unpack64_array(&msg->xmalloc_site_live, &uint32_tmp,
+				    buffer);
+		if (uint32_tmp != msg->xmalloc_site_count)
+			goto unpack_error;
+	} else if (protocol_version >= SLURM_MIN_PROTOCOL_VERSION) {
 		safe_unpack32(&msg->parts_packed,	buffer);
 		if (msg->parts_packed) {
 			safe_unpack_time(&msg->req_time,	buffer);
@@ -11231,6 +11365,30 @@ unpack_error:
 	return SLURM_ERROR;
 }
 
+/* pack_msg_is_prepacked
+ * IN msg_type - message type
+ * RET true if the body of msg_type is a buffer packed by the sender, which
+ *	pack_msg() copies verbatim and which may be sent as is instead
+ */
+extern bool pack_msg_is_prepacked(uint16_t msg_type)
+{
+	switch (msg_type) {
+	case RESPONSE_ASSOC_MGR_INFO:
+	case RESPONSE_BURST_BUFFER_INFO:
+	case RESPONSE_FRONT_END_INFO:
+	case RESPONSE_JOB_INFO:
+	case RESPONSE_JOB_STEP_INFO:
+	case RESPONSE_LICENSE_INFO:
+	case RESPONSE_NODE_INFO:
+	case RESPONSE_PARTITION_INFO:
+	case RESPONSE_RESERVATION_INFO:
+	case RESPONSE_STATS_INFO:
+		return true;
+	default:
+		return false;
+	}
+}
+
 /* pack_msg
  * packs a generic slurm protocol message body
  * IN msg - the body structure to pack (note: includes message type)
@@ -11568,6 +11726,7 @@ pack_msg(slurm_msg_t const *msg, buf_t *buffer)
 	case RESPONSE_PROLOG_EXECUTING:
 	case RESPONSE_JOB_READY:
 	case RESPONSE_SLURM_RC:
+	case RESPONSE_FORWARD_AGGREGATE:
 		_pack_return_code_msg((return_code_msg_t *) msg->data,
 				      buffer,
 				      msg->protocol_version);
@@ -12231,6 +12390,7 @@ unpack_msg(slurm_msg_t * msg, buf_t *buffer)
 	case RESPONSE_PROLOG_EXECUTING:
 	case RESPONSE_JOB_READY:
 	case RESPONSE_SLURM_RC:
+	case RESPONSE_FORWARD_AGGREGATE:
 		rc = _unpack_return_code_msg((return_code_msg_t **)
 					     & (msg->data), buffer,
 					     msg->protocol_version);
@@ -71,6 +71,12 @@ extern int unpack_header(header_t *header, buf_t *buffer);
 /* generic case statement Pack / Unpack methods for slurm protocol bodies */
 /**************************************************************************/
 
+/*
+ * RET true if the body of msg_type is a buffer packed by the sender, which
+ *	pack_msg() copies verbatim and which may be sent as is instead
+ */
+extern bool pack_msg_is_prepacked(uint16_t msg_type);
+
 /*
  * packs a generic slurm protocol message body
  * IN msg - the body structure to pack (note: includes message type)
@@ -51,6 +51,7 @@
 #include <sys/socket.h>
 #include <sys/time.h>
 #include <sys/types.h>
+#include <sys/uio.h>
 #include <unistd.h>
 
 #include "slurm/slurm_errno.h"
@@ -82,6 +83,8 @@
 /* Static functions */
 static int _slurm_connect(int __fd, struct sockaddr const * __addr,
 			  socklen_t __len);
+static int _send_iov_timeout(int fd, struct iovec *iov, int iovcnt,
+			     uint32_t flags, int timeout);
 
 /****************************************************************
  * MIDDLE LAYER MSG FUNCTIONS
@@ -171,9 +174,36 @@ extern ssize_t slurm_msg_sendto(int fd, char *buffer, size_t size)
 ssize_t slurm_msg_sendto_timeout(int fd, char *buffer,
 				 size_t size, int timeout)
 {
-	int   len;
+	struct iovec iov = { .iov_base = buffer, .iov_len = size };
+
+	return slurm_msg_sendv_timeout(fd, &iov, 1, timeout);
+}
+
+extern ssize_t slurm_msg_sendv(int fd, struct iovec *iov, int iovcnt)
+{
+	return slurm_msg_sendv_timeout(fd, iov, iovcnt,
+				       (slurm_conf.msg_timeout * 1000));
+}
+
+extern ssize_t slurm_msg_sendv_timeout(int fd, struct iovec *iov, int iovcnt,
+				       int timeout)
+{
+	struct iovec vec[SLURM_MSG_IOV_MAX + 1];
+	size_t size = 0;
 	uint32_t usize;
 	SigFunc *ohandler;
+	int len;
+
+	xassert(iovcnt <= SLURM_MSG_IOV_MAX);
+
+	/* Length prefix and message go out in one sendmsg() where possible */
+	for (int i = 0; i < iovcnt; i++) {
+		vec[i + 1] = iov[i];
+		size += iov[i].iov_len;
+	}
+	usize = htonl(size);
+	vec[0].iov_base = &usize;
+	vec[0].iov_len = sizeof(usize);
 
 	/*
 	 *  Ignore SIGPIPE so that send can return a error code if the
@@ -181,18 +211,10 @@ ssize_t slurm_msg_sendto_timeout(int fd, char *buffer,
 	 */
 	ohandler = xsignal(SIGPIPE, SIG_IGN);
 
-	usize = htonl(size);
-
-	if ((len = slurm_send_timeout(
-				fd, (char *)&usize, sizeof(usize), 0,
-				timeout)) < 0)
-		goto done;
+	len = _send_iov_timeout(fd, vec, iovcnt + 1, 0, timeout);
+	if (len >= 0)
+		len -= sizeof(usize);
 
-	if ((len = slurm_send_timeout(fd, buffer, size, 0, timeout)) < 0)
-		goto done;
-
-
-     done:
 	xsignal(SIGPIPE, ohandler);
 	return len;
 }
@@ -201,14 +223,36 @@ ssize_t slurm_msg_sendto_timeout(int fd, char *buffer,
  * RET message size (as specified in argument) or SLURM_ERROR on error */
 extern int slurm_send_timeout(int fd, char *buf, size_t size,
 			      uint32_t flags, int timeout)
+{
+	struct iovec iov = { .iov_base = buf, .iov_len = size };
+
+	return _send_iov_timeout(fd, &iov, 1, flags, timeout);
+}
+
+/*
+ * Send all of the iovcnt buffers in iov with timeout. iov is consumed as the
+ * data is sent.
+ * RET bytes sent or SLURM_ERROR on error
+ */
+static int _send_iov_timeout(int fd, struct iovec *iov, int iovcnt,
+			     uint32_t flags, int timeout)
 {
 	int rc;
 	int sent = 0;
+	size_t size = 0;
 	int fd_flags;
 	struct pollfd ufds;
 	struct timeval tstart;
 	int timeleft = timeout;
 	char temp[2];
+	struct msghdr msg;
+
+	for (int i = 0; i < iovcnt; i++)
+		size += iov[i].iov_len;
+
+	memset(&msg, 0, sizeof(msg));
+	msg.msg_iov = iov;
+	msg.msg_iovlen = iovcnt;
 
 	ufds.fd     = fd;
 	ufds.events = POLLOUT;
@@ -266,7 +310,7 @@ extern int slurm_send_timeout(int fd, char *buf, size_t size,
 			      ufds.revents);
 		}
 
-		rc = send(fd, &buf[sent], (size - sent), flags);
+		rc = sendmsg(fd, &msg, flags);
 		if (rc < 0) {
  			if (errno == EINTR)
 				continue;
@@ -290,6 +334,18 @@ extern int slurm_send_timeout(int fd, char *buf, size_t size,
 		}
 
 		sent += rc;
+
+		/* Skip past whatever a short write has already sent */
+		while (msg.msg_iovlen && (rc >= msg.msg_iov->iov_len)) {
+			rc -= msg.msg_iov->iov_len;
+			msg.msg_iov++;
+			msg.msg_iovlen--;
+		}
+		if (msg.msg_iovlen) {
+			msg.msg_iov->iov_base =
+				(char *) msg.msg_iov->iov_base + rc;
+			msg.msg_iov->iov_len -= rc;
+		}
 	}
 
     done:
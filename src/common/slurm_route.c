@@ -53,11 +53,20 @@
 #include "src/common/slurm_protocol_api.h"
 #include "src/common/slurm_route.h"
 #include "src/common/timers.h"
+#include "src/common/xhash.h"
 #include "src/common/xmalloc.h"
 #include "src/common/xstring.h"
 
+/* A node which failed this recently is not used to relay messages */
+#define ROUTE_FAIL_WINDOW	300
+/* Lowest latency used to weigh branch widths, in usec */
+#define ROUTE_MIN_LATENCY	1000
+
 strong_alias(route_split_hostlist_treewidth,
 	     slurm_route_split_hostlist_treewidth);
+strong_alias(route_split_hostlist_adaptive,
+	     slurm_route_split_hostlist_adaptive);
+strong_alias(route_order_hostlist, slurm_route_order_hostlist);
 
 typedef struct slurm_route_ops {
 	int  (*split_hostlist)    (hostlist_t hl,
@@ -79,6 +88,26 @@ static plugin_context_t	*g_context = NULL;
 static pthread_mutex_t g_context_lock = PTHREAD_MUTEX_INITIALIZER;
 static bool init_run = false;
 
+/* Response history of the nodes this daemon sent messages to */
+typedef struct {
+	char *name;
+	uint32_t latency;	/* smoothed response time in usec */
+	uint32_t fail_cnt;	/* recent failures, halved by a response */
+	time_t last_fail;
+} route_stat_t;
+
+/* Node of a hostlist being split, with its history */
+typedef struct {
+	char *name;
+	uint32_t latency;
+	uint32_t fail_cnt;
+	int order;		/* position in the original hostlist */
+} route_node_t;
+
+static pthread_mutex_t stat_lock = PTHREAD_MUTEX_INITIALIZER;
+static xhash_t *route_stats = NULL;
+static int adaptive = -1;
+
 extern int route_init(void)
 {
 	int retval = SLURM_SUCCESS;
@@ -114,6 +143,11 @@ extern int route_fini(void)
 {
 	int rc;
 
+	slurm_mutex_lock(&stat_lock);
+	xhash_free(route_stats);
+	adaptive = -1;
+	slurm_mutex_unlock(&stat_lock);
+
 	if (!g_context)
 		return SLURM_SUCCESS;
 
@@ -192,6 +226,10 @@ extern int route_g_reconfigure(void)
 	if (route_init() != SLURM_SUCCESS)
 		return SLURM_ERROR;
 
+	slurm_mutex_lock(&stat_lock);
+	adaptive = -1;
+	slurm_mutex_unlock(&stat_lock);
+
 	return (*(ops.reconfigure))();
 }
 
@@ -255,3 +293,332 @@ extern int route_split_hostlist_treewidth(hostlist_t hl,
 
 	return SLURM_SUCCESS;
 }
+
+static void _stat_id(void *item, const char **key, uint32_t *key_len)
+{
+	route_stat_t *stat = item;
+
+	*key = stat->name;
+	*key_len = strlen(stat->name);
+}
+
+static void _stat_free(void *item)
+{
+	route_stat_t *stat = item;
+
+	xfree(stat->name);
+	xfree(stat);
+}
+
+/* Call with stat_lock held */
+static bool _adaptive(void)
+{
+	if (adaptive == -1)
+		adaptive = xstrcasestr(slurm_conf.topology_param,
+				       "RouteAdaptive") ? 1 : 0;
+	return adaptive;
+}
+
+/*
+ * route_stats_record - note the outcome of a message sent to a node
+ *
+ * IN: name      - char *       - node the message was sent to
+ * IN: usec      - long         - time the node took to respond, 0 if
+ *                                unknown
+ * IN: failed    - bool         - true if the node could not be reached
+ */
+extern void route_stats_record(const char *name, long usec, bool failed)
+{
+	route_stat_t *stat;
+
+	if (!name)
+		return;
+
+	slurm_mutex_lock(&stat_lock);
+	if (!_adaptive()) {
+		slurm_mutex_unlock(&stat_lock);
+		return;
+	}
+	if (!route_stats)
+		route_stats = xhash_init(_stat_id, _stat_free);
+	if (!(stat = xhash_get_str(route_stats, name))) {
+		stat = xmalloc(sizeof(*stat));
+		stat->name = xstrdup(name);
+		xhash_add(route_stats, stat);
+	}
+
+	if (failed) {
+		stat->fail_cnt++;
+		stat->last_fail = time(NULL);
+	} else {
+		usec = MIN(usec, INFINITE);
+		if (usec <= 0)
+			;	/* response time unknown */
+		else if (!stat->latency)
+			stat->latency = usec;
+		else
+			stat->latency = (3 * (uint64_t) stat->latency +
+					 usec) / 4;
+		stat->fail_cnt /= 2;
+	}
+	slurm_mutex_unlock(&stat_lock);
+}
+
+/*
+ * route_stats_record_list - note the responses to a message sent to a node
+ *
+ * Records the response time of the node the message was sent to and every
+ * node of ret_list, including those further down the tree, which could not
+ * be reached. A node forwarding the message only responds once its whole
+ * branch has, so its response time is only recorded when it had no nodes to
+ * forward to.
+ *
+ * IN: name      - char *       - node the message was sent to
+ * IN: fwd_cnt   - int          - nodes it forwarded the message to
+ * IN: usec      - long         - time the node took to respond
+ * IN: ret_list  - List         - responses of the node and its branch
+ */
+extern void route_stats_record_list(const char *name, int fwd_cnt,
+				    long usec, List ret_list)
+{
+	ret_data_info_t *ret_data_info;
+	ListIterator itr;
+	bool head_failed = false, enabled;
+
+	slurm_mutex_lock(&stat_lock);
+	enabled = _adaptive();
+	slurm_mutex_unlock(&stat_lock);
+	if (!ret_list || !enabled)
+		return;
+
+	itr = list_iterator_create(ret_list);
+	while ((ret_data_info = list_next(itr))) {
+		bool is_head = !ret_data_info->node_name ||
+			       !xstrcmp(ret_data_info->node_name, name);
+
+		if (ret_data_info->type != RESPONSE_FORWARD_FAILED)
+			continue;
+		if (is_head)
+			head_failed = true;
+		route_stats_record(is_head ? name : ret_data_info->node_name,
+				   0, true);
+	}
+	list_iterator_destroy(itr);
+
+	if (!head_failed)
+		route_stats_record(name, fwd_cnt ? 0 : usec, false);
+}
+
+/* Shift the nodes out of hl along with their response history */
+static route_node_t *_get_route_nodes(hostlist_t hl, int *node_cnt,
+				      int *known_cnt)
+{
+	route_node_t *nodes;
+	route_stat_t *stat;
+	uint64_t latency_sum = 0;
+	int i, cnt = hostlist_count(hl);
+	time_t now = time(NULL);
+
+	nodes = xcalloc(cnt, sizeof(*nodes));
+	*known_cnt = 0;
+	slurm_mutex_lock(&stat_lock);
+	for (i = 0; (i < cnt) && (nodes[i].name = hostlist_shift(hl)); i++) {
+		nodes[i].order = i;
+		if (!route_stats ||
+		    !(stat = xhash_get_str(route_stats, nodes[i].name)))
+			continue;
+		if (stat->fail_cnt &&
+		    (difftime(now, stat->last_fail) < ROUTE_FAIL_WINDOW))
+			nodes[i].fail_cnt = stat->fail_cnt;
+		if ((nodes[i].latency = stat->latency)) {
+			latency_sum += stat->latency;
+			(*known_cnt)++;
+		}
+	}
+	slurm_mutex_unlock(&stat_lock);
+	*node_cnt = i;
+
+	/* Nodes without history are expected to be as fast as the others */
+	if (*known_cnt) {
+		uint32_t latency = latency_sum / *known_cnt;
+		for (i = 0; i < *node_cnt; i++) {
+			if (!nodes[i].latency)
+				nodes[i].latency = latency;
+		}
+	}
+
+	return nodes;
+}
+
+/* Order nodes by failures, then latency, then original position */
+static int _cmp_route_node(const void *x, const void *y)
+{
+	const route_node_t *n1 = x, *n2 = y;
+
+	if (n1->fail_cnt != n2->fail_cnt)
+		return (n1->fail_cnt < n2->fail_cnt) ? -1 : 1;
+	if (n1->latency != n2->latency)
+		return (n1->latency < n2->latency) ? -1 : 1;
+	return n1->order - n2->order;
+}
+
+static void _free_route_nodes(route_node_t *nodes, int node_cnt)
+{
+	for (int i = 0; i < node_cnt; i++)
+		free(nodes[i].name);
+	xfree(nodes);
+}
+
+/*
+ * route_order_hostlist - sort a hostlist so the nodes most likely to respond
+ *	quickly come first, as the first node of a branch relays the message
+ *	to the others. Does nothing unless TopologyParam=RouteAdaptive is set.
+ *
+ * IN/OUT: hl    - hostlist_t   - the hostlist to sort
+ */
+extern void route_order_hostlist(hostlist_t hl)
+{
+	route_node_t *nodes;
+	int i, node_cnt, known_cnt;
+
+	slurm_mutex_lock(&stat_lock);
+	if (!_adaptive() || !route_stats) {
+		slurm_mutex_unlock(&stat_lock);
+		return;
+	}
+	slurm_mutex_unlock(&stat_lock);
+
+	nodes = _get_route_nodes(hl, &node_cnt, &known_cnt);
+	qsort(nodes, node_cnt, sizeof(*nodes), _cmp_route_node);
+	for (i = 0; i < node_cnt; i++)
+		hostlist_push_host(hl, nodes[i].name);
+	_free_route_nodes(nodes, node_cnt);
+}
+
+/*
+ * route_split_hostlist_adaptive - logic to split an input hostlist into
+ *	branches shaped by the response history of the nodes.
+ *
+ * The nodes which responded fastest head the branches and the slowest ones
+ * end up at the leaves. Branches headed by slower nodes get fewer nodes and
+ * nodes which recently failed are sent to directly, in their own branch,
+ * so they do not hold up the response of a whole branch. Falls back to
+ * route_split_hostlist_treewidth() unless TopologyParam=RouteAdaptive is
+ * set and some of the nodes have a history.
+ *
+ * IN: hl        - hostlist_t   - list of every node to send message to
+ *                                will be empty on return
+ * OUT: sp_hl    - hostlist_t** - the array of hostlists that will be malloced
+ * OUT: count    - int*         - the count of created hostlists
+ * IN: tree_width- int          - Max width of each branch on the tree.
+ * RET: SLURM_SUCCESS - int
+ *
+ * Note: created hostlist will have to be freed independently using
+ * Note: the hostlist_t array will have to be xfree.
+ */
+extern int route_split_hostlist_adaptive(hostlist_t hl,
+					 hostlist_t** sp_hl,
+					 int* count, uint16_t tree_width)
+{
+	route_node_t *nodes;
+	int node_cnt, known_cnt, fail_cnt = 0;
+	int isolate_cnt, head_cnt, rest_cnt, i, j;
+	int *cap, *fill;
+	double *weight, weight_sum = 0;
+	char *buf;
+
+	slurm_mutex_lock(&stat_lock);
+	if (!_adaptive() || !route_stats || !xhash_count(route_stats)) {
+		slurm_mutex_unlock(&stat_lock);
+		return route_split_hostlist_treewidth(hl, sp_hl, count,
+						      tree_width);
+	}
+	slurm_mutex_unlock(&stat_lock);
+
+	if (!tree_width)
+		tree_width = slurm_conf.tree_width;
+
+	nodes = _get_route_nodes(hl, &node_cnt, &known_cnt);
+	for (i = 0; i < node_cnt; i++) {
+		if (nodes[i].fail_cnt)
+			fail_cnt++;
+	}
+	if (!node_cnt || (!known_cnt && !fail_cnt)) {
+		/* No history for any of these nodes, keep the usual tree */
+		for (i = 0; i < node_cnt; i++)
+			hostlist_push_host(hl, nodes[i].name);
+		_free_route_nodes(nodes, node_cnt);
+		return route_split_hostlist_treewidth(hl, sp_hl, count,
+						      tree_width);
+	}
+	qsort(nodes, node_cnt, sizeof(*nodes), _cmp_route_node);
+
+	/*
+	 * Up to half of the branches go to failed nodes on their own, the
+	 * worst first. The others are headed by the fastest nodes.
+	 */
+	tree_width = MIN(tree_width, node_cnt);
+	isolate_cnt = MIN(fail_cnt, tree_width / 2);
+	head_cnt = MIN(tree_width - isolate_cnt, node_cnt - fail_cnt);
+	if (!head_cnt) {
+		isolate_cnt = MIN(fail_cnt, tree_width - 1);
+		head_cnt = 1;
+	}
+	rest_cnt = node_cnt - head_cnt - isolate_cnt;
+
+	/* Branch widths are inversely proportional to the head's latency */
+	cap = xcalloc(head_cnt, sizeof(int));
+	fill = xcalloc(head_cnt, sizeof(int));
+	weight = xcalloc(head_cnt, sizeof(double));
+	for (i = 0; i < head_cnt; i++) {
+		weight[i] = 1.0 / MAX(nodes[i].latency, ROUTE_MIN_LATENCY);
+		weight_sum += weight[i];
+	}
+	for (i = 0, j = rest_cnt; i < head_cnt; i++) {
+		cap[i] = rest_cnt * weight[i] / weight_sum;
+		j -= cap[i];
+	}
+	for (i = 0; j > 0; i = (i + 1) % head_cnt, j--)
+		cap[i]++;
+
+	*sp_hl = xcalloc(head_cnt + isolate_cnt, sizeof(hostlist_t));
+	for (i = 0; i < head_cnt; i++)
+		(*sp_hl)[i] = hostlist_create(nodes[i].name);
+
+	/*
+	 * Deal the other nodes out in order, so every branch lists its nodes
+	 * from fastest to slowest and the slow ones become leaves when the
+	 * branch is split again.
+	 */
+	for (i = head_cnt, j = 0; i < (head_cnt + rest_cnt); i++) {
+		while (fill[j] >= cap[j])
+			j = (j + 1) % head_cnt;
+		hostlist_push_host((*sp_hl)[j], nodes[i].name);
+		fill[j]++;
+		j = (j + 1) % head_cnt;
+	}
+
+	for (j = head_cnt; i < node_cnt; i++, j++)
+		(*sp_hl)[j] = hostlist_create(nodes[i].name);
+	*count = head_cnt + isolate_cnt;
+
+	if (slurm_conf.debug_flags & DEBUG_FLAG_ROUTE) {
+		info("ROUTE: adaptive split of %d nodes into %d branches, %d failed nodes isolated",
+		     node_cnt, *count, isolate_cnt);
+		for (i = 0; i < *count; i++) {
+			buf = hostlist_ranged_string_xmalloc((*sp_hl)[i]);
+			info("ROUTE: ... sublist[%d] head latency %uus%s width %d: %s",
+			     i, nodes[i < head_cnt ? i : rest_cnt + i].latency,
+			     (i < head_cnt) ? "" : " failed",
+			     hostlist_count((*sp_hl)[i]), buf);
+			xfree(buf);
+		}
+	}
+
+	xfree(cap);
+	xfree(fill);
+	xfree(weight);
+	_free_route_nodes(nodes, node_cnt);
+
+	return SLURM_SUCCESS;
+}
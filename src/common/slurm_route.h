@@ -39,6 +39,11 @@
 #ifndef __SLURM_ROUTE_PLUGIN_API_H__
 #define __SLURM_ROUTE_PLUGIN_API_H__
 
+#include <stdbool.h>
+
+#include "src/common/hostlist.h"
+#include "src/common/list.h"
+
 /*****************************************************************************\
  *  Functions required of all plugins
 \*****************************************************************************/
@@ -116,4 +121,63 @@ extern int route_split_hostlist_treewidth(hostlist_t hl,
 					  hostlist_t** sp_hl,
 					  int* count, uint16_t tree_width);
 
+/*
+ * route_split_hostlist_adaptive - logic to split an input hostlist into
+ *	branches shaped by the response history of the nodes.
+ *
+ * The nodes which responded fastest head the branches and the slowest ones
+ * end up at the leaves. Branches headed by slower nodes get fewer nodes and
+ * nodes which recently failed are sent to directly, in their own branch.
+ * Falls back to route_split_hostlist_treewidth() unless
+ * TopologyParam=RouteAdaptive is set and some of the nodes have a history.
+ *
+ * IN: hl        - hostlist_t   - list of every node to send message to
+ *                                will be empty on return
+ * OUT: sp_hl    - hostlist_t** - the array of hostlists that will be malloced
+ * OUT: count    - int*         - the count of created hostlists
+ * IN: tree_width- int          - Max width of each branch on the tree.
+ * RET: SLURM_SUCCESS - int
+ *
+ * Note: created hostlist will have to be freed independently using
+ * Note: the hostlist_t array will have to be xfree.
+ */
+extern int route_split_hostlist_adaptive(hostlist_t hl,
+					 hostlist_t** sp_hl,
+					 int* count, uint16_t tree_width);
+
+/*
+ * route_order_hostlist - sort a hostlist so the nodes most likely to respond
+ *	quickly come first. Does nothing unless TopologyParam=RouteAdaptive
+ *	is set.
+ *
+ * IN/OUT: hl    - hostlist_t   - the hostlist to sort
+ */
+extern void route_order_hostlist(hostlist_t hl);
+
+/*
+ * route_stats_record - note the outcome of a message sent to a node, used
+ *	by route_split_hostlist_adaptive(). Does nothing unless
+ *	TopologyParam=RouteAdaptive is set.
+ *
+ * IN: name      - char *       - node the message was sent to
+ * IN: usec      - long         - time the node took to respond, 0 if
+ *                                unknown
+ * IN: failed    - bool         - true if the node could not be reached
+ */
+extern void route_stats_record(const char *name, long usec, bool failed);
+
+/*
+ * route_stats_record_list - note the responses to a message sent to a node
+ *	and the nodes it forwarded the message to. Every node of ret_list
+ *	which could not be reached is recorded as failed. The response time
+ *	is only recorded for a node which forwarded the message to no other.
+ *
+ * IN: name      - char *       - node the message was sent to
+ * IN: fwd_cnt   - int          - nodes it forwarded the message to
+ * IN: usec      - long         - time the node took to respond
+ * IN: ret_list  - List         - responses of the node and its branch
+ */
+extern void route_stats_record_list(const char *name, int fwd_cnt,
+				    long usec, List ret_list);
+
 #endif /*___SLURM_ROUTE_PLUGIN_API_H__*/
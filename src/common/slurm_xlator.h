@@ -83,8 +83,10 @@
 #define	bit_ffs			slurm_bit_ffs
 #define	bit_free		slurm_bit_free
 #define	bit_realloc		slurm_bit_realloc
+#define	bit_compact		slurm_bit_compact
 #define	bit_size		slurm_bit_size
 #define	bit_and			slurm_bit_and
+#define	bit_and_count		slurm_bit_and_count
 #define	bit_not			slurm_bit_not
 #define	bit_or			slurm_bit_or
 #define	bit_set_count		slurm_bit_set_count
@@ -110,6 +112,7 @@
 #define bit_noc			slurm_bit_noc
 #define bit_nffs		slurm_bit_nffs
 #define bit_copybits		slurm_bit_copybits
+#define bit_simd_name		slurm_bit_simd_name
 
 /* fd.[ch] functions */
 #define fd_set_blocking		slurm_fd_set_blocking
@@ -429,6 +432,8 @@
 
 /* slurm_step_route.[ch] functions */
 #define route_split_hostlist_treewidth	slurm_route_split_hostlist_treewidth
+#define route_split_hostlist_adaptive	slurm_route_split_hostlist_adaptive
+#define route_order_hostlist		slurm_route_order_hostlist
 
 
 #define eio_handle_create		slurm_eio_handle_create
@@ -0,0 +1,245 @@
+/*****************************************************************************\
+ *  vector.c - growable array of pointers
+ *****************************************************************************
+ *  This file is part of Slurm, a resource management program.
+ *  For details, see <https://slurm.schedmd.com/>.
+ *  Please also read the included file: DISCLAIMER.
+ *
+ *  Slurm is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 2 of the License, or (at your option)
+ *  any later version.
+ *
+ *  In addition, as a special exception, the copyright holders give permission
+ *  to link the code of portions of this program with the OpenSSL library under
+ *  certain conditions as described in each individual source file, and
+ *  distribute linked combinations including the two. You must obey the GNU
+ *  General Public License in all respects for all of the code used other than
+ *  OpenSSL. If you modify file(s) with this exception, you may extend this
+ *  exception to your version of the file(s), but you are not obligated to do
+ *  so. If you do not wish to do so, delete this exception statement from your
+ *  version.  If you delete this exception statement from all source files in
+ *  the program, then also delete it here.
+ *
+ *  Slurm is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with Slurm; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA.
+\*****************************************************************************/
+
+#include "config.h"
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "src/common/macros.h"
+#include "src/common/vector.h"
+#include "src/common/xassert.h"
+#include "src/common/xmalloc.h"
+
+#define VECTOR_MAGIC 0xDEADBEF3
+#define VECTOR_MIN_SIZE 16
+
+typedef int (*ConstListCmpF) (const void *, const void *);
+
+struct xvector {
+	int magic;
+	void **items;		/* items[start] is the first item */
+	int start;
+	int count;		/* number of items */
+	int size;		/* slots allocated in items */
+	ListDelF del_f;
+	pthread_mutex_t mutex;
+};
+
+extern vector_t *vector_create(ListDelF f)
+{
+	vector_t *v = xmalloc(sizeof(*v));
+
+	v->magic = VECTOR_MAGIC;
+	v->del_f = f;
+	slurm_mutex_init(&v->mutex);
+
+	return v;
+}
+
+extern void vector_destroy(vector_t *v)
+{
+	int i;
+
+	xassert(v);
+	slurm_mutex_lock(&v->mutex);
+	xassert(v->magic == VECTOR_MAGIC);
+
+	if (v->del_f) {
+		for (i = v->start; i < (v->start + v->count); i++)
+			v->del_f(v->items[i]);
+	}
+	xfree(v->items);
+	v->magic = ~VECTOR_MAGIC;
+	slurm_mutex_unlock(&v->mutex);
+	slurm_mutex_destroy(&v->mutex);
+	xfree(v);
+}
+
+extern int vector_count(vector_t *v)
+{
+	int n;
+
+	if (!v)
+		return 0;
+
+	slurm_mutex_lock(&v->mutex);
+	xassert(v->magic == VECTOR_MAGIC);
+	n = v->count;
+	slurm_mutex_unlock(&v->mutex);
+
+	return n;
+}
+
+extern int vector_is_empty(vector_t *v)
+{
+	return (vector_count(v) == 0);
+}
+
+extern void *vector_append(vector_t *v, void *x)
+{
+	xassert(v);
+	xassert(x);
+	slurm_mutex_lock(&v->mutex);
+	xassert(v->magic == VECTOR_MAGIC);
+
+	if ((v->start + v->count) == v->size) {
+		if (v->start && (v->start >= (v->size / 2))) {
+			/* Reuse the slots freed by vector_pop() */
+			memmove(v->items, &v->items[v->start],
+				v->count * sizeof(void *));
+			v->start = 0;
+		} else {
+			v->size = MAX(VECTOR_MIN_SIZE, v->size * 2);
+			xrecalloc(v->items, v->size, sizeof(void *));
+		}
+	}
+	v->items[v->start + v->count++] = x;
+
+	slurm_mutex_unlock(&v->mutex);
+
+	return x;
+}
+
+extern void *vector_get(vector_t *v, int n)
+{
+	void *x = NULL;
+
+	xassert(v);
+	slurm_mutex_lock(&v->mutex);
+	xassert(v->magic == VECTOR_MAGIC);
+	if ((n >= 0) && (n < v->count))
+		x = v->items[v->start + n];
+	slurm_mutex_unlock(&v->mutex);
+
+	return x;
+}
+
+extern void *vector_pop(vector_t *v)
+{
+	void *x = NULL;
+
+	xassert(v);
+	slurm_mutex_lock(&v->mutex);
+	xassert(v->magic == VECTOR_MAGIC);
+	if (v->count) {
+		x = v->items[v->start];
+		if (--v->count)
+			v->start++;
+		else
+			v->start = 0;
+	}
+	slurm_mutex_unlock(&v->mutex);
+
+	return x;
+}
+
+extern void *vector_find_first(vector_t *v, ListFindF f, void *key)
+{
+	void *x = NULL;
+	int i;
+
+	xassert(v);
+	xassert(f);
+	slurm_mutex_lock(&v->mutex);
+	xassert(v->magic == VECTOR_MAGIC);
+	for (i = v->start; i < (v->start + v->count); i++) {
+		if (f(v->items[i], key)) {
+			x = v->items[i];
+			break;
+		}
+	}
+	slurm_mutex_unlock(&v->mutex);
+
+	return x;
+}
+
+extern int vector_delete_all(vector_t *v, ListFindF f, void *key)
+{
+	int i, j, end;
+
+	xassert(v);
+	xassert(f);
+	slurm_mutex_lock(&v->mutex);
+	xassert(v->magic == VECTOR_MAGIC);
+
+	end = v->start + v->count;
+	for (i = j = v->start; i < end; i++) {
+		if (f(v->items[i], key)) {
+			if (v->del_f)
+				v->del_f(v->items[i]);
+		} else {
+			v->items[j++] = v->items[i];
+		}
+	}
+	v->count = j - v->start;
+	if (!v->count)
+		v->start = 0;
+	slurm_mutex_unlock(&v->mutex);
+
+	return (end - j);
+}
+
+extern int vector_for_each(vector_t *v, ListForF f, void *arg)
+{
+	int i, n = 0;
+	bool failed = false;
+
+	xassert(v);
+	xassert(f);
+	slurm_mutex_lock(&v->mutex);
+	xassert(v->magic == VECTOR_MAGIC);
+	for (i = v->start; i < (v->start + v->count); i++) {
+		n++;
+		if (f(v->items[i], arg) < 0) {
+			failed = true;
+			break;
+		}
+	}
+	slurm_mutex_unlock(&v->mutex);
+
+	return failed ? -n : n;
+}
+
+extern void vector_sort(vector_t *v, ListCmpF f)
+{
+	xassert(v);
+	xassert(f);
+	slurm_mutex_lock(&v->mutex);
+	xassert(v->magic == VECTOR_MAGIC);
+	if (v->count > 1)
+		qsort(&v->items[v->start], v->count, sizeof(void *),
+		      (ConstListCmpF) f);
+	slurm_mutex_unlock(&v->mutex);
+}
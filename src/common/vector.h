@@ -0,0 +1,124 @@
+/*****************************************************************************\
+ *  vector.h - growable array of pointers
+ *****************************************************************************
+ *  This file is part of Slurm, a resource management program.
+ *  For details, see <https://slurm.schedmd.com/>.
+ *  Please also read the included file: DISCLAIMER.
+ *
+ *  Slurm is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 2 of the License, or (at your option)
+ *  any later version.
+ *
+ *  In addition, as a special exception, the copyright holders give permission
+ *  to link the code of portions of this program with the OpenSSL library under
+ *  certain conditions as described in each individual source file, and
+ *  distribute linked combinations including the two. You must obey the GNU
+ *  General Public License in all respects for all of the code used other than
+ *  OpenSSL. If you modify file(s) with this exception, you may extend this
+ *  exception to your version of the file(s), but you are not obligated to do
+ *  so. If you do not wish to do so, delete this exception statement from your
+ *  version.  If you delete this exception statement from all source files in
+ *  the program, then also delete it here.
+ *
+ *  Slurm is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with Slurm; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA.
+\*****************************************************************************/
+
+#ifndef _SLURM_VECTOR_H
+#define _SLURM_VECTOR_H
+
+#include "src/common/list.h"
+
+/*
+ * A vector holds its items in one array, so walking, sorting and popping
+ * items does not chase a pointer per item the way a List does. It suits
+ * collections which are appended to, walked or sorted, and then consumed
+ * from the front. Like a List, every operation takes the vector's mutex.
+ *
+ * The ListDelF, ListCmpF, ListFindF and ListForF functions of list.h are
+ * used the same way here.
+ */
+typedef struct xvector vector_t;
+
+#define FREE_NULL_VECTOR(_X)			\
+	do {					\
+		if (_X)				\
+			vector_destroy(_X);	\
+		_X = NULL;			\
+	} while (0)
+
+/*
+ * Create an empty vector. Items still in the vector when it is destroyed
+ * are freed with [f], unless it is NULL.
+ */
+extern vector_t *vector_create(ListDelF f);
+
+/*
+ * Destroy vector [v], freeing its remaining items as vector_create() said.
+ */
+extern void vector_destroy(vector_t *v);
+
+/*
+ * Return the number of items in vector [v], 0 if [v] is NULL.
+ */
+extern int vector_count(vector_t *v);
+
+/*
+ * Return non-zero if vector [v] is empty.
+ */
+extern int vector_is_empty(vector_t *v);
+
+/*
+ * Append item [x] to the end of vector [v].
+ * Returns [x].
+ */
+extern void *vector_append(vector_t *v, void *x);
+
+/*
+ * Return item [n] of vector [v], counting from its first item, or NULL if
+ * there is no such item.
+ */
+extern void *vector_get(vector_t *v, int n);
+
+/*
+ * Remove the first item of vector [v] and return it, or NULL if [v] is
+ * empty. The caller is responsible for freeing the item.
+ */
+extern void *vector_pop(vector_t *v);
+
+/*
+ * Return the first item of vector [v] for which [f] returns non-zero with
+ * [key], or NULL if there is none.
+ */
+extern void *vector_find_first(vector_t *v, ListFindF f, void *key);
+
+/*
+ * Remove every item of vector [v] for which [f] returns non-zero with
+ * [key], freeing them as vector_create() said.
+ * Returns the number of items removed.
+ */
+extern int vector_delete_all(vector_t *v, ListFindF f, void *key);
+
+/*
+ * Invoke [f] with [arg] on each item of vector [v] in order.
+ * Returns the number of items [f] was invoked on. If [f] returns <0 for
+ * an item, the walk stops and the negative of that item's position is
+ * returned, as with list_for_each().
+ * Note: [f] must not modify [v].
+ */
+extern int vector_for_each(vector_t *v, ListForF f, void *arg);
+
+/*
+ * Sort vector [v] with [f], which is given pointers to two items as with
+ * list_sort() and qsort().
+ */
+extern void vector_sort(vector_t *v, ListCmpF f);
+
+#endif
@@ -33,72 +33,144 @@
  *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA.
 \*****************************************************************************/
 
+
+#include <string.h>
+
 #include "src/common/xhash.h"
 #include "src/common/xmalloc.h"
 #include "src/common/xstring.h"
-#include "src/common/uthash/uthash.h"
-
-#if 0
-/* undefine default allocators */
-#undef uthash_malloc
-#undef uthash_free
-
-/* re-define them using slurm's ones */
-#define uthash_malloc(sz) xmalloc(sz)
-#define uthash_free(ptr, sz) xfree(ptr)
-#endif
 
 /*
- * FIXME:
- * A pre-malloced array of xhash_item_t could be associated to
- * the xhash_table in order to speed up the xhash_add function.
- * The default array size could be something like 10% of the
- * provided table_size (hash table are commonly defined larger
- * than necessary to avoid shared keys and usage of linked list)
+ * Open addressing with robin hood hashing: items live in one array of
+ * slots, each probed from the slot its hash points to. An item being added
+ * takes the slot of any item closer to its own home slot, which keeps
+ * probe sequences short, lets a lookup stop as soon as it reaches an item
+ * closer to home than the key would be, and lets removal shift the
+ * following items back instead of leaving tombstones.
  */
 
-typedef struct xhash_item_st {
-	void*		item;    /* user item                               */
-	UT_hash_handle	hh;      /* make this structure hashable by uthash  */
-} xhash_item_t;
+#define XHASH_MIN_SLOTS 16
+
+typedef struct xhash_slot_st {
+	void*		item;    /* user item, NULL if the slot is empty    */
+	const char*	key;     /* key given by identify() when added      */
+	uint32_t	key_len;
+	uint32_t	hash;
+} xhash_slot_t;
 
 struct xhash_st {
 	uint32_t		count;    /* user items count                */
+	uint32_t		mask;     /* slot count - 1, slot count is a
+					     power of 2                      */
+	xhash_slot_t*		slots;    /* NULL until the first item       */
 	xhash_freefunc_t	freefunc; /* function used to free items     */
-	xhash_item_t*		ht;       /* hash table                      */
 	xhash_idfunc_t		identify; /* function returning a unique str
 					     key */
 };
 
+static uint64_t _mix(uint64_t h)
+{
+	h ^= h >> 31;
+	h *= 0x7fb5d329728ea185ULL;
+	h ^= h >> 27;
+	h *= 0x81dadef4bc2dd44dULL;
+	h ^= h >> 33;
+	return h;
+}
+
+static uint32_t _hash(const char *key, uint32_t len)
+{
+	uint64_t h = 0x9e3779b97f4a7c15ULL ^ len, v;
+
+	for (; len >= 8; key += 8, len -= 8) {
+		memcpy(&v, key, 8);
+		h = _mix(h ^ v);
+	}
+	if (len) {
+		v = 0;
+		memcpy(&v, key, len);
+		h = _mix(h ^ v);
+	}
+	return (uint32_t) (h ^ (h >> 32));
+}
+
+/* Distance of the item in slot i from the slot its hash points to */
+static uint32_t _slot_dist(xhash_t *table, uint32_t i)
+{
+	return (i - table->slots[i].hash) & table->mask;
+}
+
+/* Place slot contents s, which must not be in the table yet */
+static void _slot_insert(xhash_t *table, xhash_slot_t s)
+{
+	uint32_t i = s.hash & table->mask, dist = 0, d;
+	xhash_slot_t tmp;
+
+	while (table->slots[i].item) {
+		if ((d = _slot_dist(table, i)) < dist) {
+			tmp = table->slots[i];
+			table->slots[i] = s;
+			s = tmp;
+			dist = d;
+		}
+		i = (i + 1) & table->mask;
+		dist++;
+	}
+	table->slots[i] = s;
+}
+
+static void _resize(xhash_t *table, uint32_t slot_cnt)
+{
+	xhash_slot_t *old_slots = table->slots;
+	uint32_t i, old_cnt = old_slots ? (table->mask + 1) : 0;
+
+	table->slots = xcalloc(slot_cnt, sizeof(xhash_slot_t));
+	table->mask = slot_cnt - 1;
+	for (i = 0; i < old_cnt; i++) {
+		if (old_slots[i].item)
+			_slot_insert(table, old_slots[i]);
+	}
+	xfree(old_slots);
+}
+
+/* Return the slot holding key, or -1 if not found */
+static int64_t _find_slot(xhash_t *table, const char *key, uint32_t len)
+{
+	uint32_t hash, i, dist;
+	xhash_slot_t *s;
+
+	if (!table || !key || !table->count)
+		return -1;
+
+	hash = _hash(key, len);
+	for (i = hash & table->mask, dist = 0; ; i = (i + 1) & table->mask,
+	     dist++) {
+		s = &table->slots[i];
+		if (!s->item || (_slot_dist(table, i) < dist))
+			return -1;
+		if ((s->hash == hash) && (s->key_len == len) &&
+		    !memcmp(s->key, key, len))
+			return i;
+	}
+}
+
 xhash_t *xhash_init(xhash_idfunc_t idfunc, xhash_freefunc_t freefunc)
 {
 	xhash_t* table = NULL;
 	if (!idfunc)
 		return NULL;
 	table = xmalloc(sizeof(xhash_t));
-	table->ht = NULL; /* required by uthash */
-	table->count = 0;
 	table->identify = idfunc;
 	table->freefunc = freefunc;
 	return table;
 }
 
-static xhash_item_t* xhash_find(xhash_t* table, const char* key, uint32_t len)
-{
-	xhash_item_t* hash_item = NULL;
-
-	if (!table || !key)
-		return NULL;
-	HASH_FIND(hh, table->ht, key, len, hash_item);
-	return hash_item;
-}
-
 void* xhash_get(xhash_t* table, const char* key, uint32_t key_len)
 {
-	xhash_item_t* item = xhash_find(table, key, key_len);
-	if (!item)
+	int64_t i = _find_slot(table, key, key_len);
+	if (i < 0)
 		return NULL;
-	return item->item;
+	return table->slots[i].item;
 }
 
 void* xhash_get_str(xhash_t* table, const char* key)
@@ -108,29 +180,42 @@ void* xhash_get_str(xhash_t* table, const char* key)
 
 void* xhash_add(xhash_t* table, void* item)
 {
-	xhash_item_t* hash_item = NULL;
-	const char *key = NULL;
-	uint32_t keylen = 0;
+	xhash_slot_t s;
 
 	if (!table || !item)
 		return NULL;
-	hash_item = xmalloc(sizeof(xhash_item_t));
-	hash_item->item    = item;
-	table->identify(item, &key, &keylen);
-	HASH_ADD_KEYPTR(hh, table->ht, key, keylen, hash_item);
+
+	/* Keep the table at most 7/8 full */
+	if (!table->slots)
+		_resize(table, XHASH_MIN_SLOTS);
+	else if ((table->count + 1) > ((table->mask + 1) / 8) * 7)
+		_resize(table, (table->mask + 1) * 2);
+
+	s.item = item;
+	table->identify(item, &s.key, &s.key_len);
+	s.hash = _hash(s.key, s.key_len);
+	_slot_insert(table, s);
 	++table->count;
-	return hash_item->item;
+	return item;
 }
 
 void* xhash_pop(xhash_t* table, const char* key, uint32_t len)
 {
 	void* item_item;
-	xhash_item_t* item = xhash_find(table, key, len);
-	if (!item)
+	int64_t found = _find_slot(table, key, len);
+	uint32_t i, next;
+
+	if (found < 0)
 		return NULL;
-	item_item = item->item;
-	HASH_DELETE(hh, table->ht, item);
-	xfree(item);
+	item_item = table->slots[found].item;
+
+	/* Shift back the following items displaced from their home slots */
+	for (i = found, next = (i + 1) & table->mask;
+	     table->slots[next].item && _slot_dist(table, next);
+	     i = next, next = (next + 1) & table->mask)
+		table->slots[i] = table->slots[next];
+	table->slots[i].item = NULL;
+
 	--table->count;
 	return item_item;
 }
@@ -165,29 +250,30 @@ void xhash_walk(xhash_t* table,
 		void (*callback)(void* item, void* arg),
 		void* arg)
 {
-	xhash_item_t* current_item = NULL;
-	xhash_item_t* tmp = NULL;
-	if (!table || !callback)
+	uint32_t i;
+
+	if (!table || !callback || !table->slots)
 		return;
-	HASH_ITER(hh, table->ht, current_item, tmp) {
-		  callback(current_item->item, arg);
+	for (i = 0; i <= table->mask; i++) {
+		if (table->slots[i].item)
+			callback(table->slots[i].item, arg);
 	}
 }
 
 void xhash_clear(xhash_t* table)
 {
-	xhash_item_t* current_item = NULL;
-	xhash_item_t* tmp = NULL;
+	uint32_t i;
 
 	if (!table)
 		return;
-	HASH_ITER(hh, table->ht, current_item, tmp) {
-		  HASH_DEL(table->ht, current_item);
-		  if (table->freefunc)
-			  table->freefunc(current_item->item);
-		  xfree(current_item);
+	if (table->slots && table->freefunc) {
+		for (i = 0; i <= table->mask; i++) {
+			if (table->slots[i].item)
+				table->freefunc(table->slots[i].item);
+		}
 	}
-
+	xfree(table->slots);
+	table->mask = 0;
 	table->count = 0;
 }
 
@@ -65,7 +65,7 @@ typedef void (*xhash_idfunc_t)(void* item, const char** key, uint32_t* key_len);
   *          the given id.
   */
 
-/* Currently not implementable with uthash */
+/* Currently unused, keys are hashed internally */
 typedef unsigned (*xhash_hashfunc_t)(unsigned hashes_count, const char* id);
 
 /** This type of function is used to free data inserted into xhash table */
@@ -131,7 +131,9 @@ void xhash_delete_str(xhash_t* table, const char* key);
 /** @returns the number of items stored in the hash table */
 uint32_t xhash_count(xhash_t* table);
 
-/** apply callback to each item contained in the hash table */
+/** apply callback to each item contained in the hash table. The callback
+ * must not add items to nor remove items from the table.
+ */
 void xhash_walk(xhash_t* table,
         void (*callback)(void* item, void* arg),
         void* arg);
@@ -47,6 +47,11 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif
+
+#include "slurm/slurm_errno.h"
 
 #include "src/common/log.h"
 #include "src/common/macros.h"
@@ -57,6 +62,109 @@ strong_alias(xfree_ptr, slurm_xfree_ptr);
 strong_alias(xsize, slurm_xsize);
 
 #define XMALLOC_MAGIC 0x42
+#define XMALLOC_MAGIC_MASK 0xff
+
+/*
+ * Allocation profiling. Each call site (file and line) seen while profiling
+ * is given a slot in an open addressed table, found again lock free. The
+ * slot index is kept above the magic cookie in the allocation header, so the
+ * free or realloc of the allocation can take its bytes out of the live bytes
+ * of its call site even after profiling is disabled. Sites are keyed by the
+ * file name rather than the __FILE__ pointer, which may belong to a plugin
+ * that is unloaded and whose address is later reused, so a claimed slot
+ * keeps its own copy of the name.
+ */
+#define XMALLOC_SITE_BITS 14
+#define XMALLOC_SITE_CNT (1 << XMALLOC_SITE_BITS)
+#define XMALLOC_SITE_SHIFT 8
+
+typedef struct {
+	char *file;		/* NULL until the slot is claimed */
+	int line;
+	uint64_t alloc_cnt;
+	uint64_t alloc_bytes;
+	uint64_t live_bytes;
+} site_rec_t;
+
+static bool profile_enabled = false;
+static site_rec_t site_table[XMALLOC_SITE_CNT];
+static pthread_mutex_t site_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/* Return the table index plus one of the call site, 0 if the table is full */
+static size_t _site_find(const char *file, int line)
+{
+	uint64_t key = 0xcbf29ce484222325ULL;
+	size_t i, inx, start;
+	const char *c;
+	char *slot_file, *copy;
+
+	for (c = file; *c; c++)
+		key = (key ^ (unsigned char) *c) * 0x100000001b3ULL;
+	key = (key ^ line) * 0x9e3779b97f4a7c15ULL;
+	start = key >> (64 - XMALLOC_SITE_BITS);
+	for (i = 0; i < XMALLOC_SITE_CNT; i++) {
+		inx = (start + i) & (XMALLOC_SITE_CNT - 1);
+		slot_file = __atomic_load_n(&site_table[inx].file,
+					    __ATOMIC_ACQUIRE);
+		if (!slot_file)
+			break;
+		if ((site_table[inx].line == line) && !strcmp(slot_file, file))
+			return inx + 1;
+	}
+	if (i == XMALLOC_SITE_CNT)
+		return 0;
+
+	/*
+	 * New call site, claim the first free slot from where it hashed.
+	 * Slots are never released, the copy lasts as long as the process.
+	 */
+	if (!(copy = strdup(file)))
+		return 0;
+	slurm_mutex_lock(&site_mutex);
+	for (i = 0; i < XMALLOC_SITE_CNT; i++) {
+		inx = (start + i) & (XMALLOC_SITE_CNT - 1);
+		slot_file = site_table[inx].file;
+		if (!slot_file) {
+			site_table[inx].line = line;
+			__atomic_store_n(&site_table[inx].file, copy,
+					 __ATOMIC_RELEASE);
+			copy = NULL;
+			break;
+		}
+		if ((site_table[inx].line == line) && !strcmp(slot_file, file))
+			break;
+	}
+	slurm_mutex_unlock(&site_mutex);
+	free(copy);
+	if (i == XMALLOC_SITE_CNT)
+		return 0;
+	return inx + 1;
+}
+
+/* Count an allocation, return the header word recording its call site */
+static size_t _site_alloc(size_t bytes, const char *file, int line)
+{
+	site_rec_t *site;
+	size_t site_id;
+
+	if (!(site_id = _site_find(file, line)))
+		return XMALLOC_MAGIC;
+	site = &site_table[site_id - 1];
+	__atomic_add_fetch(&site->alloc_cnt, 1, __ATOMIC_RELAXED);
+	__atomic_add_fetch(&site->alloc_bytes, bytes, __ATOMIC_RELAXED);
+	__atomic_add_fetch(&site->live_bytes, bytes, __ATOMIC_RELAXED);
+	return (site_id << XMALLOC_SITE_SHIFT) | XMALLOC_MAGIC;
+}
+
+/* Take a freed or reallocated allocation out of its call site */
+static void _site_free(size_t *p)
+{
+	size_t site_id = p[0] >> XMALLOC_SITE_SHIFT;
+
+	if (site_id)
+		__atomic_sub_fetch(&site_table[site_id - 1].live_bytes, p[1],
+				   __ATOMIC_RELAXED);
+}
 
 /*
  * "Safe" version of malloc().
@@ -107,6 +215,8 @@ void *slurm_xcalloc(size_t count, size_t size, bool clear, bool try,
 	}
 	p[0] = XMALLOC_MAGIC;	/* add "secret" magic cookie */
 	p[1] = count_size;	/* store size in buffer */
+	if (profile_enabled)
+		p[0] = _site_alloc(count_size, file, line);
 
 	return &p[2];
 }
@@ -151,19 +261,20 @@ extern void * slurm_xrecalloc(void **item, size_t count, size_t size,
 		p = (size_t *)*item - 2;
 
 		/* magic cookie still there? */
-		xassert(p[0] == XMALLOC_MAGIC);
+		xassert((p[0] & XMALLOC_MAGIC_MASK) == XMALLOC_MAGIC);
 		old_size = p[1];
 
 		p = realloc(p, total_size);
 		if (p == NULL)
 			goto error;
+		_site_free(p);
 
 		if (old_size < count_size) {
 			char *p_new = (char *)(&p[2]) + old_size;
 			if (clear)
 				memset(p_new, 0, (count_size - old_size));
 		}
-		xassert(p[0] == XMALLOC_MAGIC);
+		xassert((p[0] & XMALLOC_MAGIC_MASK) == XMALLOC_MAGIC);
 	} else {
 		/* Initalize new memory */
 		if (clear)
@@ -172,10 +283,12 @@ extern void * slurm_xrecalloc(void **item, size_t count, size_t size,
 			p = malloc(total_size);
 		if (p == NULL)
 			goto error;
-		p[0] = XMALLOC_MAGIC;
 	}
 
+	p[0] = XMALLOC_MAGIC;
 	p[1] = count_size;
+	if (profile_enabled)
+		p[0] = _site_alloc(count_size, file, line);
 	*item = &p[2];
 	return *item;
 
@@ -194,7 +307,8 @@ size_t xsize(void *item)
 {
 	size_t *p = (size_t *)item - 2;
 	xassert(item != NULL);
-	xassert(p[0] == XMALLOC_MAGIC); /* CLANG false positive here */
+	/* CLANG false positive here */
+	xassert((p[0] & XMALLOC_MAGIC_MASK) == XMALLOC_MAGIC);
 	return p[1];
 }
 
@@ -208,7 +322,8 @@ void slurm_xfree(void **item)
 	if (*item != NULL) {
 		size_t *p = (size_t *)*item - 2;
 		/* magic cookie still there? */
-		xassert(p[0] == XMALLOC_MAGIC);
+		xassert((p[0] & XMALLOC_MAGIC_MASK) == XMALLOC_MAGIC);
+		_site_free(p);
 		p[0] = 0;	/* make sure xfree isn't called twice */
 		free(p);
 		*item = NULL;
@@ -224,3 +339,126 @@ void xfree_ptr(void *ptr)
 {
 	slurm_xfree(&ptr);
 }
+
+/*
+ * Start or stop counting allocations by call site. Allocations made while
+ * stopped are not counted, but those counted before are still taken out of
+ * the live bytes of their call site when freed.
+ */
+void xmalloc_profile_set(bool enable)
+{
+	__atomic_store_n(&profile_enabled, enable, __ATOMIC_RELAXED);
+}
+
+/* Zero the allocation counts of every call site, but not the live bytes */
+void xmalloc_profile_reset(void)
+{
+	int i;
+
+	for (i = 0; i < XMALLOC_SITE_CNT; i++) {
+		__atomic_store_n(&site_table[i].alloc_cnt, 0, __ATOMIC_RELAXED);
+		__atomic_store_n(&site_table[i].alloc_bytes, 0,
+				 __ATOMIC_RELAXED);
+	}
+}
+
+/* Drop the build directory from __FILE__, keeping from "src/" on */
+static const char *_site_path(const char *file)
+{
+	const char *src = file, *next;
+
+	while ((next = strstr(src, "/src/")))
+		src = next + 1;
+	return src;
+}
+
+static int _site_cmp_name(const void *x, const void *y)
+{
+	const xmalloc_site_t *site1 = x, *site2 = y;
+	int rc;
+
+	if ((rc = strcmp(site1->file, site2->file)))
+		return rc;
+	return site1->line - site2->line;
+}
+
+static int _site_cmp_bytes(const void *x, const void *y)
+{
+	const xmalloc_site_t *site1 = x, *site2 = y;
+
+	if (site1->alloc_bytes > site2->alloc_bytes)
+		return -1;
+	if (site1->alloc_bytes < site2->alloc_bytes)
+		return 1;
+	return _site_cmp_name(x, y);
+}
+
+/*
+ * Return the call sites counted since profiling started, most bytes
+ * allocated first. A header included from several files may have been
+ * counted under each copy of its __FILE__, these are merged.
+ *   sites (OUT)	xmalloc'd array, to be freed with xfree()
+ *   RETURN	number of call sites in the array
+ */
+int xmalloc_profile_get(xmalloc_site_t **sites)
+{
+	xmalloc_site_t *site;
+	int i, cnt = 0, max_cnt = 64, merged = 0;
+
+	for (i = 0; i < XMALLOC_SITE_CNT; i++) {
+		if (__atomic_load_n(&site_table[i].file, __ATOMIC_ACQUIRE))
+			max_cnt++;
+	}
+	/* Leave room for call sites added meanwhile */
+	site = xcalloc(max_cnt, sizeof(*site));
+	for (i = 0; i < XMALLOC_SITE_CNT; i++) {
+		const char *file = __atomic_load_n(&site_table[i].file,
+						   __ATOMIC_ACQUIRE);
+		if (!file)
+			continue;
+		if (cnt == max_cnt)
+			break;
+		site[cnt].file = _site_path(file);
+		site[cnt].line = site_table[i].line;
+		site[cnt].alloc_cnt = __atomic_load_n(&site_table[i].alloc_cnt,
+						      __ATOMIC_RELAXED);
+		site[cnt].alloc_bytes =
+			__atomic_load_n(&site_table[i].alloc_bytes,
+					__ATOMIC_RELAXED);
+		site[cnt].live_bytes =
+			__atomic_load_n(&site_table[i].live_bytes,
+					__ATOMIC_RELAXED);
+		cnt++;
+	}
+
+	qsort(site, cnt, sizeof(*site), _site_cmp_name);
+	for (i = 0; i < cnt; i++) {
+		if (merged && !_site_cmp_name(&site[merged - 1], &site[i])) {
+			site[merged - 1].alloc_cnt += site[i].alloc_cnt;
+			site[merged - 1].alloc_bytes += site[i].alloc_bytes;
+			site[merged - 1].live_bytes += site[i].live_bytes;
+		} else {
+			site[merged++] = site[i];
+		}
+	}
+	qsort(site, merged, sizeof(*site), _site_cmp_bytes);
+
+	*sites = site;
+	return merged;
+}
+
+/*
+ * Set the most malloc arenas which threads are spread over. Each thread
+ * keeps to the arena it was given, so with at least as many arenas as
+ * threads allocating at once they no longer wait on each other's arena lock.
+ *   count (IN)	arena count, 0 to restore the malloc default
+ *   RETURN	SLURM_SUCCESS or SLURM_ERROR if not supported by this malloc
+ */
+int xmalloc_set_arenas(int count)
+{
+#ifdef M_ARENA_MAX
+	if (mallopt(M_ARENA_MAX, count) == 1)
+		return SLURM_SUCCESS;
+#endif
+	return SLURM_ERROR;
+}
@@ -63,12 +63,17 @@
  * p. The memory must have been allocated with [try_]xmalloc() or
  * [try_]xrealloc().
  *
+ * xmalloc_profile_set(true) starts counting the allocations and bytes
+ * allocated by each call site (file and line), and the bytes each still has
+ * allocated. xmalloc_profile_get() returns these counts.
+ *
 \*****************************************************************************/
 
 #ifndef _XMALLOC_H
 #define _XMALLOC_H
 
 #include <stdbool.h>
+#include <stdint.h>
 #include <sys/types.h>
 
 #define xcalloc(__cnt, __sz) \
@@ -111,4 +116,18 @@ size_t xsize(void *item);
 
 void xfree_ptr(void *);
 
+typedef struct {
+	const char *file;	/* source file of the call site */
+	int line;		/* source line of the call site */
+	uint64_t alloc_cnt;	/* allocations and reallocations */
+	uint64_t alloc_bytes;	/* bytes allocated or reallocated */
+	uint64_t live_bytes;	/* bytes allocated and not yet freed */
+} xmalloc_site_t;
+
+void xmalloc_profile_set(bool enable);
+void xmalloc_profile_reset(void);
+int xmalloc_profile_get(xmalloc_site_t **sites);
+
+int xmalloc_set_arenas(int count);
+
 #endif /* !_XMALLOC_H */
@@ -55,9 +55,19 @@ slurm_persist_conn_t *slurmdbd_conn = NULL;
 
 
 #define DBD_MAGIC		0xDEAD3219
+#define DBD_ACK_MAGIC		0xDEAD3220	/* spool acknowledgement */
 #define SLURMDBD_TIMEOUT	900	/* Seconds SlurmDBD for response */
 #define DEBUG_PRINT_MAX_MSG_TYPES 10
 #define MAX_DBD_DEFAULT_ACTION MAX_DBD_ACTION_DISCARD
+#define DBD_AGENT_BATCH_SIZE	1000	/* messages per DBD_SEND_MULT_MSG */
+#define DEFAULT_DBD_MSG_BATCHES	4	/* batches in flight */
+#define MAX_DBD_MSG_BATCHES	64
+
+typedef struct {
+	List bufs;	/* agent_list messages sent, not yet acknowledged */
+	uint32_t cnt;	/* messages originally in the batch */
+	bool mult;	/* sent as DBD_SEND_MULT_MSG */
+} dbd_batch_t;
 
 static pthread_mutex_t agent_lock = PTHREAD_MUTEX_INITIALIZER;
 static pthread_cond_t  agent_cond = PTHREAD_COND_INITIALIZER;
@@ -71,6 +81,26 @@ static pthread_mutex_t slurmdbd_lock = PTHREAD_MUTEX_INITIALIZER;
 static pthread_cond_t  slurmdbd_cond = PTHREAD_COND_INITIALIZER;
 
 static int max_dbd_msg_action = MAX_DBD_DEFAULT_ACTION;
+static int max_dbd_msg_batches = DEFAULT_DBD_MSG_BATCHES;
+
+/*
+ * Leading agent_list messages sent to the SlurmDBD but not yet acknowledged.
+ * Protected by agent_lock.
+ */
+static uint32_t agent_inflight = 0;
+
+/*
+ * State of the dbd.messages spool. Protected by agent_lock.
+ * spool_cnt   - leading agent_list messages already written to the spool
+ * spool_recs  - message records in the spool
+ * spool_acked - leading spool records processed by the SlurmDBD
+ */
+static int      spool_fd          = -1;
+static uint32_t spool_cnt         = 0;
+static uint32_t spool_recs        = 0;
+static uint32_t spool_acked       = 0;
+static uint32_t spool_acked_saved = 0;
+static bool     spool_rewrite     = false;
 
 static int _unpack_return_code(uint16_t rpc_version, buf_t *buffer)
 {
@@ -140,32 +170,76 @@ static int _unpack_return_code(uint16_t rpc_version, buf_t *buffer)
 	return rc;
 }
 
-static int _get_return_code(void)
+/*
+ * Return the msg_type of a packed message without touching the buffer's
+ * offset, which may be in use by a concurrent send.
+ */
+static uint16_t _get_msg_type(buf_t *buffer)
 {
-	int rc = SLURM_ERROR;
-	buf_t *buffer = slurm_persist_recv_msg(slurmdbd_conn);
-	if (buffer == NULL)
-		return rc;
+	uint16_t msg_type;
+
+	if (get_buf_offset(buffer) < sizeof(msg_type))
+		return 0;
+	memcpy(&msg_type, get_buf_data(buffer), sizeof(msg_type));
+
+	return ntohs(msg_type);
+}
 
-	rc = _unpack_return_code(slurmdbd_conn->version, buffer);
+/*
+ * Remove a message acknowledged by the SlurmDBD from agent_list and free it.
+ * Messages are normally acknowledged in order from the head of the list.
+ * agent_lock must be locked before calling this.
+ */
+static void _ack_dbd_msg(buf_t *buffer)
+{
+	ListIterator itr;
+	buf_t *next;
+	uint32_t pos = 0;
+
+	if (list_peek(agent_list) == buffer) {
+		(void) list_dequeue(agent_list);
+	} else {
+		itr = list_iterator_create(agent_list);
+		while ((next = list_next(itr))) {
+			if (next == buffer) {
+				(void) list_remove(itr);
+				break;
+			}
+			pos++;
+		}
+		list_iterator_destroy(itr);
+		if (!next) {
+			error("%s: acknowledged message not found in agent queue",
+			      __func__);
+			return;
+		}
+	}
+
+	if (agent_inflight)
+		agent_inflight--;
+
+	/* Registration messages are never written to the spool */
+	if (pos < spool_cnt) {
+		spool_cnt--;
+		if (_get_msg_type(buffer) != DBD_REGISTER_CTLD) {
+			if (pos == 0)
+				spool_acked++;
+			else
+				spool_rewrite = true;
+		}
+	}
 
 	free_buf(buffer);
-	return rc;
 }
 
-static int _handle_mult_rc_ret(void)
+static int _handle_mult_rc_ret(dbd_batch_t *batch, buf_t *buffer)
 {
-	buf_t *buffer;
 	uint16_t msg_type;
 	persist_rc_msg_t *msg = NULL;
 	dbd_list_msg_t *list_msg = NULL;
 	int rc = SLURM_ERROR;
 	buf_t *out_buf = NULL;
 
-	buffer = slurm_persist_recv_msg(slurmdbd_conn);
-	if (buffer == NULL)
-		return rc;
-
 	safe_unpack16(&msg_type, buffer);
 	switch (msg_type) {
 	case DBD_GOT_MULT_MSG:
@@ -188,8 +262,8 @@ static int _handle_mult_rc_ret(void)
 				    != SLURM_SUCCESS)
 					break;
 
-				if ((b = list_dequeue(agent_list))) {
-					free_buf(b);
+				if ((b = list_dequeue(batch->bufs))) {
+					_ack_dbd_msg(b);
 				} else {
 					error("DBD_GOT_MULT_MSG "
 					      "unpack message error");
@@ -237,14 +311,13 @@ static int _handle_mult_rc_ret(void)
 	}
 
 unpack_error:
-	free_buf(buffer);
 	return rc;
 }
 
 /****************************************************************************
  * Functions for agent to manage queue of pending message for the Slurm DBD
  ****************************************************************************/
-static buf_t *_load_dbd_rec(int fd)
+static buf_t *_load_dbd_rec(int fd, uint32_t *magic_out)
 {
 	ssize_t size, rd_size;
 	uint32_t msg_size, magic;
@@ -284,12 +357,19 @@ static buf_t *_load_dbd_rec(int fd)
 
 	size = sizeof(magic);
 	rd_size = read(fd, &magic, size);
-	if ((rd_size != size) || (magic != DBD_MAGIC)) {
+	if ((rd_size != size) ||
+	    ((magic != DBD_MAGIC) && (magic != DBD_ACK_MAGIC))) {
 		error("state recover error");
 		free_buf(buffer);
 		return NULL;
 	}
+	if ((magic == DBD_ACK_MAGIC) && (msg_size != sizeof(uint32_t))) {
+		error("state recover error, ack size=%u", msg_size);
+		free_buf(buffer);
+		return NULL;
+	}
 
+	*magic_out = magic;
 	return buffer;
 }
 
@@ -299,6 +379,12 @@ static void _load_dbd_state(void)
 	buf_t *buffer;
 	int fd, recovered = 0;
 	uint16_t rpc_version = 0;
+	uint32_t magic = DBD_MAGIC, acked = 0, skipped = 0;
+	List spool_list;
+
+	/* The spool already describes agent_list, do not queue it twice */
+	if (spool_fd >= 0)
+		return;
 
 	xstrfmtcat(dbd_fname, "%s/dbd.messages", slurm_conf.state_save_location);
 	fd = open(dbd_fname, O_RDONLY);
@@ -314,7 +400,8 @@ static void _load_dbd_state(void)
 		char *ver_str = NULL;
 		uint32_t ver_str_len;
 
-		buffer = _load_dbd_rec(fd);
+		spool_list = list_create(slurmdbd_free_buffer);
+		buffer = _load_dbd_rec(fd, &magic);
 		if (buffer == NULL)
 			goto end_it;
 		/* This is set to the end of the buffer for send so we
@@ -331,15 +418,29 @@ static void _load_dbd_state(void)
 			xfree(ver_str);
 		}
 
-		while (1) {
-			/* If the buffer was not the VER%d string it
-			   was an actual message so we don't want to
-			   skip it.
-			*/
-			if (!buffer)
-				buffer = _load_dbd_rec(fd);
-			if (buffer == NULL)
-				break;
+		/*
+		 * The spool is append-only: acknowledgements are recorded as
+		 * a cumulative count of leading messages already processed by
+		 * the SlurmDBD, so read everything before deciding what to
+		 * requeue.
+		 */
+		while ((buffer = _load_dbd_rec(fd, &magic))) {
+			if (magic == DBD_ACK_MAGIC) {
+				uint32_t cnt;
+				memcpy(&cnt, get_buf_data(buffer), sizeof(cnt));
+				acked = MAX(acked, cnt);
+				free_buf(buffer);
+				continue;
+			}
+			list_enqueue(spool_list, buffer);
+		}
+
+		while ((buffer = list_dequeue(spool_list))) {
+			if (skipped < acked) {
+				skipped++;
+				free_buf(buffer);
+				continue;
+			}
 			if (rpc_version != SLURM_PROTOCOL_VERSION) {
 				/* unpack and repack with new
 				 * PROTOCOL_VERSION just so we keep
@@ -364,114 +465,183 @@ static void _load_dbd_state(void)
 			if (!list_enqueue(agent_list, buffer))
 				fatal("list_enqueue, no memory");
 			recovered++;
-			buffer = NULL;
 		}
 
 	end_it:
+		FREE_NULL_LIST(spool_list);
 		verbose("recovered %d pending RPCs", recovered);
+		if (skipped)
+			debug("skipped %u already acknowledged RPCs", skipped);
 		(void) close(fd);
 	}
 	xfree(dbd_fname);
+
 }
 
-static int _save_dbd_rec(int fd, buf_t *buffer)
+/* Append one record to a buffer in the dbd.messages on-disk format */
+static void _pack_dbd_rec(buf_t *out, void *data, uint32_t size,
+			  uint32_t magic)
 {
-	ssize_t size, wrote;
-	uint32_t msg_size = get_buf_offset(buffer);
-	uint32_t magic = DBD_MAGIC;
-	char *msg = get_buf_data(buffer);
+	uint32_t need = sizeof(size) + size + sizeof(magic);
 
-	size = sizeof(msg_size);
-	wrote = write(fd, &msg_size, size);
-	if (wrote != size) {
-		error("state save error: %m");
-		return SLURM_ERROR;
+	if (remaining_buf(out) < need)
+		grow_buf(out, need);
+
+	memcpy(get_buf_data(out) + get_buf_offset(out), &size, sizeof(size));
+	memcpy(get_buf_data(out) + get_buf_offset(out) + sizeof(size),
+	       data, size);
+	memcpy(get_buf_data(out) + get_buf_offset(out) + sizeof(size) + size,
+	       &magic, sizeof(magic));
+	set_buf_offset(out, get_buf_offset(out) + need);
+}
+
+static void _pack_dbd_header(buf_t *out)
+{
+	char curr_ver_str[10];
+	buf_t *buffer;
+
+	snprintf(curr_ver_str, sizeof(curr_ver_str),
+		 "VER%d", SLURM_PROTOCOL_VERSION);
+	buffer = init_buf(strlen(curr_ver_str));
+	packstr(curr_ver_str, buffer);
+	_pack_dbd_rec(out, get_buf_data(buffer), get_buf_offset(buffer),
+		      DBD_MAGIC);
+	free_buf(buffer);
+}
+
+static void _spool_close(void)
+{
+	if (spool_fd >= 0) {
+		if (fsync_and_close(spool_fd, "dbd.messages"))
+			error("error from fsync_and_close");
+		spool_fd = -1;
 	}
+	spool_cnt = 0;
+	spool_recs = 0;
+	spool_acked = 0;
+	spool_acked_saved = 0;
+	spool_rewrite = false;
+}
 
-	wrote = 0;
-	while (wrote < msg_size) {
-		wrote = write(fd, msg, msg_size);
-		if (wrote > 0) {
-			msg += wrote;
-			msg_size -= wrote;
-		} else if ((wrote == -1) && (errno == EINTR))
-			continue;
-		else {
-			error("state save error: %m");
-			return SLURM_ERROR;
+/*
+ * Bring dbd.messages up to date with agent_list by appending what is new:
+ * an acknowledgement record for messages the SlurmDBD has processed and every
+ * queued message not yet written. The file is only rewritten from scratch
+ * when it has become fully acknowledged (truncate) or when agent_list was
+ * changed out of order (purges).
+ *
+ * agent_lock must be locked before calling this.
+ * RET number of messages written to the spool.
+ */
+static int _sync_dbd_spool(void)
+{
+	char *dbd_fname = NULL;
+	buf_t *out = NULL, *buffer;
+	ListIterator itr;
+	uint32_t pos = 0;
+	int wrote = 0;
+
+	if (!agent_list)
+		return 0;
+
+	if (spool_fd < 0) {
+		xstrfmtcat(dbd_fname, "%s/dbd.messages",
+			   slurm_conf.state_save_location);
+		spool_fd = open(dbd_fname, O_WRONLY | O_CREAT | O_APPEND |
+				O_CLOEXEC, 0600);
+		if (spool_fd < 0) {
+			error("Creating state save file %s: %m", dbd_fname);
+			xfree(dbd_fname);
+			return 0;
 		}
+		xfree(dbd_fname);
+		spool_rewrite = true;
 	}
 
-	size = sizeof(magic);
-	wrote = write(fd, &magic, size);
-	if (wrote != size) {
-		error("state save error: %m");
-		return SLURM_ERROR;
+	if (spool_rewrite || (spool_recs && (spool_acked >= spool_recs))) {
+		/* Start a new spool holding only what is still queued */
+		if (ftruncate(spool_fd, 0) < 0) {
+			error("Truncating dbd.messages: %m");
+			return 0;
+		}
+		if (spool_rewrite)
+			spool_cnt = 0;
+		spool_recs = 0;
+		spool_acked = 0;
+		spool_acked_saved = 0;
+		spool_rewrite = false;
 	}
 
-	return SLURM_SUCCESS;
+	if (spool_cnt >= list_count(agent_list) &&
+	    (spool_acked == spool_acked_saved))
+		return 0;
+
+	out = init_buf(BUF_SIZE);
+	if (spool_acked != spool_acked_saved) {
+		_pack_dbd_rec(out, &spool_acked, sizeof(spool_acked),
+			      DBD_ACK_MAGIC);
+		spool_acked_saved = spool_acked;
+	}
+
+	itr = list_iterator_create(agent_list);
+	while ((buffer = list_next(itr))) {
+		if (pos++ < spool_cnt)
+			continue;
+		spool_cnt++;
+		/*
+		 * We do not want to store registration messages. If an
+		 * admin puts in an incorrect cluster name we can get a
+		 * deadlock unless they add the bogus cluster name to
+		 * the accounting system.
+		 */
+		if (_get_msg_type(buffer) == DBD_REGISTER_CTLD)
+			continue;
+		if (!spool_recs && !wrote)
+			_pack_dbd_header(out);
+		_pack_dbd_rec(out, get_buf_data(buffer),
+			      get_buf_offset(buffer), DBD_MAGIC);
+		wrote++;
+	}
+	list_iterator_destroy(itr);
+
+	safe_write(spool_fd, get_buf_data(out), get_buf_offset(out));
+	spool_recs += wrote;
+	free_buf(out);
+
+	return wrote;
+
+rwfail:
+	error("state save error: %m");
+	free_buf(out);
+	/* The file no longer matches our counters, start it over */
+	spool_rewrite = true;
+	return 0;
 }
 
 static void _save_dbd_state(void)
 {
-	char *dbd_fname = NULL;
-	buf_t *buffer;
-	int fd, rc, wrote = 0;
-	uint16_t msg_type;
-	uint32_t offset;
+	int wrote;
 
-	xstrfmtcat(dbd_fname, "%s/dbd.messages", slurm_conf.state_save_location);
-	(void) unlink(dbd_fname);	/* clear save state */
-	fd = open(dbd_fname, O_WRONLY | O_CREAT | O_TRUNC, 0600);
-	if (fd < 0) {
-		error("Creating state save file %s", dbd_fname);
-	} else if (list_count(agent_list)) {
-		char curr_ver_str[10];
-		snprintf(curr_ver_str, sizeof(curr_ver_str),
-			 "VER%d", SLURM_PROTOCOL_VERSION);
-		buffer = init_buf(strlen(curr_ver_str));
-		packstr(curr_ver_str, buffer);
-		rc = _save_dbd_rec(fd, buffer);
-		free_buf(buffer);
-		if (rc != SLURM_SUCCESS)
-			goto end_it;
-
-		while ((buffer = list_dequeue(agent_list))) {
-			/*
-			 * We do not want to store registration messages. If an
-			 * admin puts in an incorrect cluster name we can get a
-			 * deadlock unless they add the bogus cluster name to
-			 * the accounting system.
-			 */
-			offset = get_buf_offset(buffer);
-			if (offset < 2) {
-				free_buf(buffer);
-				continue;
-			}
-			set_buf_offset(buffer, 0);
-			(void) unpack16(&msg_type, buffer);  /* checked by offset */
-			set_buf_offset(buffer, offset);
-			if (msg_type == DBD_REGISTER_CTLD) {
-				free_buf(buffer);
-				continue;
-			}
-
-			rc = _save_dbd_rec(fd, buffer);
-			free_buf(buffer);
-			if (rc != SLURM_SUCCESS)
-				break;
-			wrote++;
-		}
-	}
+	wrote = _sync_dbd_spool();
+	verbose("saved %d pending RPCs (%u total in spool)",
+		wrote, spool_recs - spool_acked);
+	_spool_close();
+}
 
-end_it:
-	if (fd >= 0) {
-		verbose("saved %d pending RPCs", wrote);
-		rc = fsync_and_close(fd, "dbd.messages");
-		if (rc)
-			error("error from fsync_and_close");
+/*
+ * Note a message about to be purged from agent_list.
+ * agent_lock must be locked before calling this.
+ * RET false if the message is in flight and must be kept.
+ */
+static bool _purge_dbd_msg_ok(uint32_t pos)
+{
+	if (pos < agent_inflight)
+		return false;
+	if (pos < spool_cnt) {
+		spool_cnt--;
+		spool_rewrite = true;
 	}
-	xfree(dbd_fname);
+	return true;
 }
 
 /* Purge queued step records from the agent queue
@@ -481,22 +651,20 @@ static int _purge_step_req(void)
 	int purged = 0;
 	ListIterator iter;
 	uint16_t msg_type;
-	uint32_t offset;
+	uint32_t pos = 0;
 	buf_t *buffer;
 
 	iter = list_iterator_create(agent_list);
 	while ((buffer = list_next(iter))) {
-		offset = get_buf_offset(buffer);
-		if (offset < 2)
-			continue;
-		set_buf_offset(buffer, 0);
-		(void) unpack16(&msg_type, buffer);	/* checked by offset */
-		set_buf_offset(buffer, offset);
-		if ((msg_type == DBD_STEP_START) ||
-		    (msg_type == DBD_STEP_COMPLETE)) {
-			list_remove(iter);
+		msg_type = _get_msg_type(buffer);
+		if (((msg_type == DBD_STEP_START) ||
+		     (msg_type == DBD_STEP_COMPLETE)) &&
+		    _purge_dbd_msg_ok(pos)) {
+			list_delete_item(iter);
 			purged++;
+			continue;
 		}
+		pos++;
 	}
 	list_iterator_destroy(iter);
 	info("purge %d step records", purged);
@@ -509,22 +677,18 @@ static int _purge_job_start_req(void)
 {
 	int purged = 0;
 	ListIterator iter;
-	uint16_t msg_type;
-	uint32_t offset;
+	uint32_t pos = 0;
 	buf_t *buffer;
 
 	iter = list_iterator_create(agent_list);
 	while ((buffer = list_next(iter))) {
-		offset = get_buf_offset(buffer);
-		if (offset < 2)
-			continue;
-		set_buf_offset(buffer, 0);
-		(void) unpack16(&msg_type, buffer);	/* checked by offset */
-		set_buf_offset(buffer, offset);
-		if (msg_type == DBD_JOB_START) {
-			list_remove(iter);
+		if ((_get_msg_type(buffer) == DBD_JOB_START) &&
+		    _purge_dbd_msg_ok(pos)) {
+			list_delete_item(iter);
 			purged++;
+			continue;
 		}
+		pos++;
 	}
 	list_iterator_destroy(iter);
 	info("purge %d job start records", purged);
@@ -557,17 +721,12 @@ static int _print_agent_list_msg_type(void *x, void *arg)
 {
 	buf_t *buffer = (buf_t *) x;
 	char *mlist = (char *) arg;
-	uint16_t msg_type;
-	uint32_t offset = get_buf_offset(buffer);
 
-	if (offset < 2)
+	if (get_buf_offset(buffer) < 2)
 		return SLURM_ERROR;
-	set_buf_offset(buffer, 0);
-	(void) unpack16(&msg_type, buffer);	/* checked by offset */
-	set_buf_offset(buffer, offset);
 
 	xstrfmtcat(mlist, "%s%s", (mlist[0] ? ", " : ""),
-		   slurmdbd_msg_type_2_str(msg_type, 1));
+		   slurmdbd_msg_type_2_str(_get_msg_type(buffer), 1));
 
 	return SLURM_SUCCESS;
 }
@@ -599,31 +758,203 @@ static void _print_agent_list_msg_types(void)
 	xfree(mlist);
 }
 
+static void _signal_assoc_cache(void)
+{
+	slurm_mutex_lock(&assoc_cache_mutex);
+	if (slurmdbd_conn->fd >= 0 &&
+	    (running_cache != RUNNING_CACHE_STATE_NOTRUNNING))
+		slurm_cond_signal(&assoc_cache_cond);
+	slurm_mutex_unlock(&assoc_cache_mutex);
+}
+
+/*
+ * Take the next messages not yet in flight from agent_list and pack them
+ * for sending. A lone message is sent as is, anything more is wrapped in a
+ * DBD_SEND_MULT_MSG of up to DBD_AGENT_BATCH_SIZE messages.
+ *
+ * agent_lock must be locked before calling this.
+ * RET buffer to send or NULL if nothing is left to send
+ */
+static buf_t *_build_batch(dbd_batch_t *batch)
+{
+	persist_msg_t list_req = {0};
+	dbd_list_msg_t list_msg = {0};
+	ListIterator itr;
+	buf_t *buffer;
+	uint32_t pos = 0;
+
+	if (!agent_list || (agent_inflight >= list_count(agent_list)))
+		return NULL;
+
+	batch->bufs = list_create(NULL);
+	itr = list_iterator_create(agent_list);
+	while ((buffer = list_next(itr))) {
+		if (pos++ < agent_inflight)
+			continue;
+		list_enqueue(batch->bufs, buffer);
+		if (list_count(batch->bufs) >= DBD_AGENT_BATCH_SIZE)
+			break;
+	}
+	list_iterator_destroy(itr);
+
+	batch->cnt = list_count(batch->bufs);
+	agent_inflight += batch->cnt;
+
+	if (batch->cnt == 1) {
+		batch->mult = false;
+		return list_peek(batch->bufs);
+	}
+
+	batch->mult = true;
+	list_req.msg_type = DBD_SEND_MULT_MSG;
+	list_req.conn = slurmdbd_conn;
+	list_req.data = &list_msg;
+	list_msg.my_list = batch->bufs;
+
+	return pack_slurmdbd_msg(&list_req, SLURM_PROTOCOL_VERSION);
+}
+
+/*
+ * Collect the reply for the oldest batch in flight, acknowledging the
+ * messages it reports as processed if ack is set. Otherwise the reply is
+ * only read to keep the connection in step.
+ * conn_lost is set if no reply could be read, in which case the connection
+ * may have been reopened and replies to later batches will never arrive.
+ */
+static int _recv_batch(dbd_batch_t *batch, bool ack, bool *conn_lost)
+{
+	buf_t *buffer, *b;
+	int rc;
+
+	if (!(buffer = slurm_persist_recv_msg(slurmdbd_conn))) {
+		*conn_lost = true;
+		return SLURM_ERROR;
+	}
+
+	if (!ack) {
+		rc = SLURM_SUCCESS;
+	} else if (batch->mult) {
+		rc = _handle_mult_rc_ret(batch, buffer);
+	} else {
+		rc = _unpack_return_code(slurmdbd_conn->version, buffer);
+		if (rc == SLURM_SUCCESS) {
+			slurm_mutex_lock(&agent_lock);
+			if ((b = list_dequeue(batch->bufs)))
+				_ack_dbd_msg(b);
+			slurm_mutex_unlock(&agent_lock);
+		} else if ((rc == EAGAIN) && !*slurmdbd_conn->shutdown) {
+			error("Failure with message need to resend: %d: %m",
+			      rc);
+		}
+	}
+	free_buf(buffer);
+
+	return rc;
+}
+
+/*
+ * Send queued messages to the SlurmDBD keeping up to max_dbd_msg_batches
+ * batches in flight. The SlurmDBD handles requests on a connection in order,
+ * so replies are matched to batches first in, first out and every successful
+ * reply acknowledges the oldest messages in agent_list.
+ *
+ * Once a batch fails nothing more is sent. Replies for batches already in
+ * flight are still read, but not acknowledged: their messages stay in
+ * agent_list behind the failed ones and are all sent again from the first
+ * failure on, so the SlurmDBD applies them in order and none are lost. If
+ * the connection itself fails those replies are lost and the unacknowledged
+ * messages are simply sent again later.
+ *
+ * slurmdbd_lock must be locked before calling this.
+ */
+static int _send_batches(void)
+{
+	int max_batches = max_dbd_msg_batches;
+	dbd_batch_t *batches = xcalloc(max_batches, sizeof(dbd_batch_t));
+	dbd_batch_t *batch;
+	buf_t *buffer;
+	int head = 0, inflight = 0, tmp_rc, rc = SLURM_SUCCESS;
+	bool conn_lost = false, ack = true;
+
+	while (1) {
+		while ((rc == SLURM_SUCCESS) &&
+		       (inflight < max_batches) &&
+		       !halt_agent && !*slurmdbd_conn->shutdown) {
+			batch = &batches[(head + inflight) % max_batches];
+			slurm_mutex_lock(&agent_lock);
+			buffer = _build_batch(batch);
+			slurm_mutex_unlock(&agent_lock);
+			if (!buffer)
+				break;
+
+			/*
+			 * NOTE: agent_lock is clear here, so we can add more
+			 * requests to the queue while this RPC is in flight.
+			 */
+			rc = slurm_persist_send_msg(slurmdbd_conn, buffer);
+			if (batch->mult)
+				free_buf(buffer);
+			if (rc != SLURM_SUCCESS) {
+				if (!*slurmdbd_conn->shutdown)
+					error("Failure sending message: %d: %m",
+					      rc);
+				FREE_NULL_LIST(batch->bufs);
+				/* A failed send may have reopened the conn */
+				if (inflight)
+					conn_lost = true;
+				break;
+			}
+			inflight++;
+		}
+
+		if (!inflight || conn_lost)
+			break;
+
+		batch = &batches[head];
+		tmp_rc = _recv_batch(batch, ack, &conn_lost);
+		if (tmp_rc != SLURM_SUCCESS) {
+			ack = false;
+			if (rc == SLURM_SUCCESS)
+				rc = tmp_rc;
+		}
+		FREE_NULL_LIST(batch->bufs);
+		head = (head + 1) % max_batches;
+		inflight--;
+
+		_signal_assoc_cache();
+	}
+
+	/* Anything not acknowledged by now will be sent again */
+	for (; inflight; inflight--) {
+		FREE_NULL_LIST(batches[head].bufs);
+		head = (head + 1) % max_batches;
+	}
+	slurm_mutex_lock(&agent_lock);
+	agent_inflight = 0;
+	slurm_mutex_unlock(&agent_lock);
+	xfree(batches);
+
+	return rc;
+}
+
 static void *_agent(void *x)
 {
 	int rc;
 	uint32_t cnt;
-	buf_t *buffer;
 	struct timespec abs_time;
 	static time_t fail_time = 0;
 	int sigarray[] = {SIGUSR1, 0};
-	persist_msg_t list_req = {0};
-	dbd_list_msg_t list_msg;
 	DEF_TIMERS;
 
-	list_req.msg_type = DBD_SEND_MULT_MSG;
-	list_req.conn = slurmdbd_conn;
-	list_req.data = &list_msg;
-	memset(&list_msg, 0, sizeof(dbd_list_msg_t));
-
 	/* Prepare to catch SIGUSR1 to interrupt pending
 	 * I/O and terminate in a timely fashion. */
 	xsignal(SIGUSR1, _sig_handler);
 	xsignal_unblock(sigarray);
 
-	log_flag(AGENT, "slurmdbd agent_count=%d with msg_type=%s",
+	log_flag(AGENT, "slurmdbd agent_count=%d with msg_type=%s batches=%d",
 		 list_count(agent_list),
-		 slurmdbd_msg_type_2_str(list_req.msg_type, 1));
+		 slurmdbd_msg_type_2_str(DBD_SEND_MULT_MSG, 1),
+		 max_dbd_msg_batches);
 
 	while (*slurmdbd_conn->shutdown == 0) {
 		slurm_mutex_lock(&slurmdbd_lock);
@@ -648,6 +979,7 @@ static void *_agent(void *x)
 		}
 
 		slurm_mutex_lock(&agent_lock);
+		(void) _sync_dbd_spool();
 		cnt = list_count(agent_list);
 		if ((cnt == 0) || (slurmdbd_conn->fd < 0) ||
 		    (fail_time && (difftime(time(NULL), fail_time) < 10))) {
@@ -665,102 +997,20 @@ static void *_agent(void *x)
 		} else if (((cnt > 0) && ((cnt % 100) == 0)) ||
 		           (slurm_conf.debug_flags & DEBUG_FLAG_AGENT))
 			info("agent_count:%d", cnt);
-		/* Leave item on the queue until processing complete */
-		if (agent_list) {
-			int handle_agent_count = 1000;
-			if (cnt > handle_agent_count) {
-				int agent_count = 0;
-				ListIterator agent_itr =
-					list_iterator_create(agent_list);
-				list_msg.my_list = list_create(NULL);
-				while ((buffer = list_next(agent_itr))) {
-					list_enqueue(list_msg.my_list, buffer);
-					agent_count++;
-					if (agent_count > handle_agent_count)
-						break;
-				}
-				list_iterator_destroy(agent_itr);
-				buffer = pack_slurmdbd_msg(
-					&list_req, SLURM_PROTOCOL_VERSION);
-			} else if (cnt > 1) {
-				list_msg.my_list = agent_list;
-				buffer = pack_slurmdbd_msg(
-					&list_req, SLURM_PROTOCOL_VERSION);
-			} else
-				buffer = list_peek(agent_list);
-		} else
-			buffer = NULL;
 		slurm_mutex_unlock(&agent_lock);
-		if (buffer == NULL) {
-			slurm_mutex_unlock(&slurmdbd_lock);
-
-			slurm_mutex_lock(&assoc_cache_mutex);
-			if (slurmdbd_conn->fd >= 0 &&
-			    (running_cache != RUNNING_CACHE_STATE_NOTRUNNING))
-				slurm_cond_signal(&assoc_cache_cond);
-			slurm_mutex_unlock(&assoc_cache_mutex);
 
-			END_TIMER2("slurmdbd agent: empty buffer");
-			continue;
-		}
-
-		/* NOTE: agent_lock is clear here, so we can add more
-		 * requests to the queue while waiting for this RPC to
-		 * complete. */
-		rc = slurm_persist_send_msg(slurmdbd_conn, buffer);
-		if (rc != SLURM_SUCCESS) {
-			if (*slurmdbd_conn->shutdown) {
-				slurm_mutex_unlock(&slurmdbd_lock);
-				END_TIMER2("slurmdbd agent: shutdown");
-				break;
-			}
-			error("Failure sending message: %d: %m", rc);
-		} else if (list_msg.my_list) {
-			rc = _handle_mult_rc_ret();
-		} else {
-			rc = _get_return_code();
-			if (rc == EAGAIN) {
-				if (*slurmdbd_conn->shutdown) {
-					slurm_mutex_unlock(&slurmdbd_lock);
-					END_TIMER2("slurmdbd agent: EAGAIN on shutdown");
-					break;
-				}
-				error("Failure with "
-				      "message need to resend: %d: %m", rc);
-			}
-		}
+		/* Leave items on the queue until acknowledged */
+		rc = _send_batches();
 		slurm_mutex_unlock(&slurmdbd_lock);
-		slurm_mutex_lock(&assoc_cache_mutex);
-		if (slurmdbd_conn->fd >= 0 &&
-		    (running_cache != RUNNING_CACHE_STATE_NOTRUNNING))
-			slurm_cond_signal(&assoc_cache_cond);
-		slurm_mutex_unlock(&assoc_cache_mutex);
+		if ((rc != SLURM_SUCCESS) && *slurmdbd_conn->shutdown) {
+			END_TIMER2("slurmdbd agent: shutdown");
+			break;
+		}
 
 		slurm_mutex_lock(&agent_lock);
 		if (agent_list && (rc == SLURM_SUCCESS)) {
-			/*
-			 * If we sent a mult_msg we just need to free buffer,
-			 * we don't need to requeue, just mark list_msg.my_list
-			 * as NULL as that is the sign we sent a mult_msg.
-			 */
-			if (list_msg.my_list) {
-				if (list_msg.my_list != agent_list)
-					FREE_NULL_LIST(list_msg.my_list);
-				list_msg.my_list = NULL;
-			} else
-				buffer = list_dequeue(agent_list);
-
-			free_buf(buffer);
 			fail_time = 0;
 		} else {
-			/* We need to free a mult_msg even on failure */
-			if (list_msg.my_list) {
-				if (list_msg.my_list != agent_list)
-					FREE_NULL_LIST(list_msg.my_list);
-				list_msg.my_list = NULL;
-				free_buf(buffer);
-			}
-
 			fail_time = time(NULL);
 
 			if (slurm_conf.debug_flags & DEBUG_FLAG_AGENT) {
@@ -1008,4 +1258,17 @@ extern void slurmdbd_agent_config_setup(void)
 		xfree(type);
 	} else
 		max_dbd_msg_action = MAX_DBD_DEFAULT_ACTION;
+
+	/*                          012345678901234567890 */
+	if ((tmp_ptr = xstrcasestr(slurm_conf.slurmctld_params,
+	                           "max_dbd_msg_batches="))) {
+		max_dbd_msg_batches = atoi(tmp_ptr + 20);
+		if ((max_dbd_msg_batches < 1) ||
+		    (max_dbd_msg_batches > MAX_DBD_MSG_BATCHES)) {
+			error("Invalid SlurmctldParameters max_dbd_msg_batches=%d, using %d",
+			      max_dbd_msg_batches, DEFAULT_DBD_MSG_BATCHES);
+			max_dbd_msg_batches = DEFAULT_DBD_MSG_BATCHES;
+		}
+	} else
+		max_dbd_msg_batches = DEFAULT_DBD_MSG_BATCHES;
 }
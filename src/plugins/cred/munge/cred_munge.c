@@ -289,3 +289,72 @@ end_it:
 		free(buf_out);
 	return rc;
 }
+
+/*
+ * Sign buffer so that cred_p_unseal() can get it back from the signature.
+ * A munge credential carries its payload, so this is just cred_p_sign().
+ */
+extern int cred_p_seal(void *key, char *buffer, int buf_size,
+		       char **sig_pp, uint32_t *sig_size_p)
+{
+	return cred_p_sign(key, buffer, buf_size, sig_pp, sig_size_p);
+}
+
+/*
+ * Verify a signature made by cred_p_seal() and return the data it was made
+ * over in buf_pp, which the caller must xfree(). A job signature comes with
+ * every credential of the job and slurmd forgets the ones it has checked
+ * when restarted, so a replayed signature is accepted here.
+ */
+extern int cred_p_unseal(void *key, char *signature, uint32_t sig_size,
+			 char **buf_pp, uint32_t *buf_size_p)
+{
+	int retry = RETRY_COUNT;
+	uid_t uid;
+	gid_t gid;
+	void *buf_out = NULL;
+	int buf_out_size;
+	int rc = SLURM_SUCCESS;
+	munge_err_t err;
+	munge_ctx_t ctx = (munge_ctx_t) key;
+
+	/* The signature comes from srun, make sure it is a string */
+	if (!sig_size || signature[sig_size - 1])
+		return ESIG_BUF_SIZE_MISMATCH;
+
+again:
+	err = munge_decode(signature, ctx, &buf_out, &buf_out_size,
+			   &uid, &gid);
+
+	if (err != EMUNGE_SUCCESS) {
+		if ((err == EMUNGE_SOCKET) && retry--) {
+			debug("Munge decode failed: %s (retrying ...)",
+			      munge_ctx_strerror(ctx));
+			usleep(RETRY_USEC);	/* Likely munged too busy */
+			goto again;
+		}
+		if (err == EMUNGE_SOCKET)
+			error("If munged is up, restart with --num-threads=10");
+
+		/* munge still returns the payload of a replayed credential */
+		if ((err != EMUNGE_CRED_REPLAYED) || !buf_out) {
+			rc = err;
+			goto end_it;
+		}
+	}
+
+	if ((uid != slurm_conf.slurm_user_id) && (uid != 0)) {
+		error("%s: Unexpected uid (%u) != Slurm uid (%u)",
+		      plugin_type, uid, slurm_conf.slurm_user_id);
+		rc = ESIG_BAD_USERID;
+	} else {
+		*buf_pp = xmalloc(buf_out_size);
+		memcpy(*buf_pp, buf_out, buf_out_size);
+		*buf_size_p = buf_out_size;
+	}
+
+end_it:
+	if (buf_out)
+		free(buf_out);
+	return rc;
+}
@@ -37,8 +37,10 @@
 #include <inttypes.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include "src/common/slurm_protocol_api.h"
+#include "src/common/xmalloc.h"
 #include "src/common/xstring.h"
 
 /*
@@ -136,3 +138,25 @@ extern int cred_p_verify_sign(void *key, char *buffer, uint32_t buf_size,
 		return ESIG_INVALID;
 	return SLURM_SUCCESS;
 }
+
+/* NOTE: Caller must xfree the signature returned by sig_pp */
+extern int cred_p_seal(void *key, char *buffer, int buf_size,
+		       char **sig_pp, uint32_t *sig_size_p)
+{
+	*sig_pp = xmalloc(buf_size);
+	memcpy(*sig_pp, buffer, buf_size);
+	*sig_size_p = buf_size;
+
+	return SLURM_SUCCESS;
+}
+
+/* NOTE: Caller must xfree the data returned by buf_pp */
+extern int cred_p_unseal(void *key, char *signature, uint32_t sig_size,
+			 char **buf_pp, uint32_t *buf_size_p)
+{
+	*buf_pp = xmalloc(sig_size);
+	memcpy(*buf_pp, signature, sig_size);
+	*buf_size_p = sig_size;
+
+	return SLURM_SUCCESS;
+}
@@ -144,11 +144,13 @@ static char *_get_default_account(uint32_t user_id)
 	}
 }
 
-/* Get the default QOS for an association (or NULL if not present) */
+/*
+ * Get the default QOS for an association (or NULL if not present)
+ * Returned value must be xfreed.
+ */
 static char *_get_default_qos(uint32_t user_id, char *account, char *partition)
 {
 	slurmdb_assoc_rec_t assoc;
-	slurmdb_qos_rec_t qos;
 	uint32_t qos_id = 0;
 
 	memset(&assoc, 0, sizeof(slurmdb_assoc_rec_t));
@@ -167,14 +169,7 @@ static char *_get_default_qos(uint32_t user_id, char *account, char *partition)
 	if (!qos_id)
 		return NULL;
 
-	memset(&qos, 0, sizeof(slurmdb_qos_rec_t));
-	qos.id = qos_id;
-	if (assoc_mgr_fill_in_qos(acct_db_conn, &qos, accounting_enforce,
-				  NULL, false) != SLURM_ERROR) {
-		return qos.name;
-	} else {
-		return NULL;
-	}
+	return assoc_mgr_get_qos_name(qos_id);
 }
 
 /* Get fields in an existing slurmctld job_record */
@@ -512,9 +507,11 @@ static int _get_job_req_field(const job_desc_msg_t *job_desc, const char *name)
 	} else if (!xstrcmp(name, "default_account")) {
 		lua_pushstring(L, _get_default_account(job_desc->user_id));
 	} else if (!xstrcmp(name, "default_qos")) {
-		lua_pushstring(L, _get_default_qos(job_desc->user_id,
-						   job_desc->account,
-						   job_desc->partition));
+		char *default_qos = _get_default_qos(job_desc->user_id,
+						     job_desc->account,
+						     job_desc->partition);
+		lua_pushstring(L, default_qos);
+		xfree(default_qos);
 	} else if (!xstrcmp(name, "delay_boot")) {
 		lua_pushnumber(L, job_desc->delay_boot);
 	} else if (!xstrcmp(name, "dependency")) {
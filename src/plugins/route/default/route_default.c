@@ -118,7 +118,7 @@ extern int route_p_split_hostlist(hostlist_t hl,
 				  hostlist_t** sp_hl,
 				  int* count, uint16_t tree_width)
 {
-	return route_split_hostlist_treewidth(hl, sp_hl, count, tree_width);
+	return route_split_hostlist_adaptive(hl, sp_hl, count, tree_width);
 }
 
 /*
@@ -212,14 +212,14 @@ extern int route_p_split_hostlist(hostlist_t hl,
 		}
 		FREE_NULL_BITMAP(nodes_bitmap);
 		xfree(*sp_hl);
-		return route_split_hostlist_treewidth(
+		return route_split_hostlist_adaptive(
 			hl, sp_hl, count, tree_width);
 	}
 	if (switch_record_table[j].level == 0) {
 		/* This is a leaf switch. Construct list based on TreeWidth */
 		FREE_NULL_BITMAP(nodes_bitmap);
 		xfree(*sp_hl);
-		return route_split_hostlist_treewidth(
+		return route_split_hostlist_adaptive(
 			hl, sp_hl, count, tree_width);
 	}
 	/* loop through children, construction a hostlist for each child switch
@@ -235,6 +235,8 @@ extern int route_p_split_hostlist(hostlist_t hl,
 			continue; /* no nodes on this switch in message list */
 		}
 		(*sp_hl)[hl_ndx] = bitmap2hostlist(fwd_bitmap);
+		/* Have the fastest node of the switch relay the message */
+		route_order_hostlist((*sp_hl)[hl_ndx]);
 		/* Now remove nodes from this switch from message list */
 		bit_and_not(nodes_bitmap, fwd_bitmap);
 		FREE_NULL_BITMAP(fwd_bitmap);
@@ -1558,7 +1558,7 @@ static bool _job_exceeds_max_bf_param(job_record_t *job_ptr,
 static int _attempt_backfill(void)
 {
 	DEF_TIMERS;
-	List job_queue;
+	vector_t *job_queue;
 	job_queue_rec_t *job_queue_rec;
 	int bb, i, j, node_space_recs, mcs_select = 0;
 	slurmdb_qos_rec_t *qos_ptr = NULL;
@@ -1618,13 +1618,13 @@ static int _attempt_backfill(void)
 	gettimeofday(&start_tv, NULL);
 
 	job_queue = build_job_queue(true, true);
-	job_test_count = list_count(job_queue);
+	job_test_count = vector_count(job_queue);
 	if (job_test_count == 0) {
 		if (slurm_conf.debug_flags & DEBUG_FLAG_BACKFILL)
 			info("no jobs to backfill");
 		else
 			debug("no jobs to backfill");
-		FREE_NULL_LIST(job_queue);
+		FREE_NULL_VECTOR(job_queue);
 		return 0;
 	} else
 		debug("%u jobs to backfill", job_test_count);
@@ -1696,7 +1696,7 @@ static int _attempt_backfill(void)
 			_restore_preempt_state(job_ptr, &tmp_preempt_start_time,
 			                       &tmp_preempt_in_progress);
 		}
-		job_queue_rec = (job_queue_rec_t *) list_pop(job_queue);
+		job_queue_rec = (job_queue_rec_t *) vector_pop(job_queue);
 		if (!job_queue_rec) {
 			log_flag(BACKFILL, "reached end of job queue");
 			break;
@@ -2764,7 +2764,7 @@ skip_start:
 			break;
 	}
 	xfree(node_space);
-	FREE_NULL_LIST(job_queue);
+	FREE_NULL_VECTOR(job_queue);
 
 	gettimeofday(&bf_time2, NULL);
 	_do_diag_stats(&bf_time1, &bf_time2, node_space_recs);
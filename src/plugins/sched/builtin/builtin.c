@@ -139,7 +139,7 @@ static void _load_config(void)
 static void _compute_start_times(void)
 {
 	int j, rc = SLURM_SUCCESS, job_cnt = 0;
-	List job_queue;
+	vector_t *job_queue;
 	job_queue_rec_t *job_queue_rec;
 	job_record_t *job_ptr;
 	part_record_t *part_ptr;
@@ -154,7 +154,7 @@ static void _compute_start_times(void)
 	alloc_bitmap = bit_alloc(node_record_count);
 	job_queue = build_job_queue(true, false);
 	sort_job_queue(job_queue);
-	while ((job_queue_rec = (job_queue_rec_t *) list_pop(job_queue))) {
+	while ((job_queue_rec = (job_queue_rec_t *) vector_pop(job_queue))) {
 		job_ptr  = job_queue_rec->job_ptr;
 		part_ptr = job_queue_rec->part_ptr;
 		xfree(job_queue_rec);
@@ -231,7 +231,7 @@ static void _compute_start_times(void)
 			break;
 		}
 	}
-	FREE_NULL_LIST(job_queue);
+	FREE_NULL_VECTOR(job_queue);
 	FREE_NULL_BITMAP(alloc_bitmap);
 }
 
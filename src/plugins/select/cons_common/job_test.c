@@ -1370,7 +1370,7 @@ alloc_job:
 	}
 
 	job_res                   = create_job_resources();
-	job_res->node_bitmap      = bit_copy(node_bitmap);
+	job_res->node_bitmap      = bit_compact(bit_copy(node_bitmap));
 	job_res->nodes            = bitmap2node_name(node_bitmap);
 	job_res->nhosts           = n;
 	job_res->ncpus            = job_res->nhosts;
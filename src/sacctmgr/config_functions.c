@@ -312,6 +312,11 @@ extern int sacctmgr_list_stats(int argc, char **argv)
 		list_sort(stats_rec->user_list, (ListCmpF)_sort_rpc_obj_by_cnt);
 	}
 
+	if (stats_rec->query_cache_hits || stats_rec->query_cache_misses)
+		printf("\nQuery cache hits: %u misses: %u\n",
+		       stats_rec->query_cache_hits,
+		       stats_rec->query_cache_misses);
+
 	printf("\nRemote Procedure Call statistics by message type\n");
 	type = 0;
 	list_for_each(stats_rec->rpc_list, _print_rpc_obj, &type);
@@ -58,6 +58,7 @@ struct sdiag_parameters params;
 stats_info_response_msg_t *buf;
 uint32_t *rpc_type_ave_time = NULL, *rpc_user_ave_time = NULL;
 
+static void _print_rpc_hist(char *name, uint32_t *hist);
 static int  _print_stats(void);
 static void _sort_rpc(void);
 
@@ -98,6 +99,14 @@ int main(int argc, char **argv)
 	exit(rc);
 }
 
+static void _print_rpc_hist(char *name, uint32_t *hist)
+{
+	printf("\t%-47s", name);
+	for (int i = 0; i < buf->rpc_hist_size; i++)
+		printf(" %10u", hist[i]);
+	printf("\n");
+}
+
 static int _print_stats(void)
 {
 	int i;
@@ -118,7 +127,11 @@ static int _print_stats(void)
 	printf("Agent queue size:     %d\n", buf->agent_queue_size);
 	printf("Agent count:          %d\n", buf->agent_count);
 	printf("Agent thread count:   %d\n", buf->agent_thread_count);
-	printf("DBD Agent queue size: %d\n\n", buf->dbd_agent_queue_size);
+	printf("DBD Agent queue size: %d\n", buf->dbd_agent_queue_size);
+	printf("RPC worker count:     %u\n", buf->rpc_worker_count);
+	printf("RPC queue size:       %u (max %u)\n",
+	       buf->rpc_pending_count, buf->rpc_pending_max);
+	printf("RPC reads pending:    %u\n\n", buf->rpc_conn_count);
 
 	printf("Jobs submitted: %d\n", buf->jobs_submitted);
 	printf("Jobs started:   %d\n", buf->jobs_started);
@@ -205,6 +218,73 @@ static int _print_stats(void)
 		       rpc_type_ave_time[i], buf->rpc_type_time[i]);
 	}
 
+	if (buf->rpc_hist_size) {
+		printf("\nRemote Procedure Call latency by message type (microseconds)\n");
+		printf("\t%-47s", "");
+		for (i = 0; i < buf->rpc_hist_size; i++) {
+			char label[32];
+			if (buf->rpc_hist_bound[i] != INFINITE)
+				snprintf(label, sizeof(label), "<%u",
+					 buf->rpc_hist_bound[i]);
+			else if (i)
+				snprintf(label, sizeof(label), ">=%u",
+					 buf->rpc_hist_bound[i - 1]);
+			else
+				snprintf(label, sizeof(label), "all");
+			printf(" %10s", label);
+		}
+		printf("\n");
+		_print_rpc_hist("RPC queue wait", buf->rpc_pending_hist);
+		for (i = 0; i < buf->rpc_type_size; i++) {
+			char *name = xstrdup_printf(
+				"%-40s(%5u)", rpc_num2string(buf->rpc_type_id[i]),
+				buf->rpc_type_id[i]);
+			_print_rpc_hist(name, buf->rpc_type_hist +
+					      (i * buf->rpc_hist_size));
+			xfree(name);
+		}
+	}
+
+	if (buf->rpc_batch_count) {
+		printf("\nRemote Procedure Call batching by message type\n");
+		for (i = 0; i < buf->rpc_batch_count; i++) {
+			uint32_t saved = 0;
+			if (buf->rpc_batch_rpc_cnt[i] >
+			    buf->rpc_batch_lock_cnt[i])
+				saved = buf->rpc_batch_rpc_cnt[i] -
+					buf->rpc_batch_lock_cnt[i];
+			printf("\t%-40s(%5u) count:%-6u lock_cycles:%-6u "
+			       "locks_saved:%-6u queued:%u\n",
+			       rpc_num2string(buf->rpc_batch_type_id[i]),
+			       buf->rpc_batch_type_id[i],
+			       buf->rpc_batch_rpc_cnt[i],
+			       buf->rpc_batch_lock_cnt[i], saved,
+			       buf->rpc_batch_depth[i]);
+		}
+	}
+
+	if (buf->rpc_compress_min) {
+		printf("\nRemote Procedure Call compression (%s, bodies of %u bytes or more)\n",
+		       (buf->rpc_compress_type == COMPRESS_LZ4) ? "lz4" : "zlib",
+		       buf->rpc_compress_min);
+	} else
+		printf("\nRemote Procedure Call compression (disabled)\n");
+	printf("\tCompressed messages: %u\n", buf->rpc_compress_cnt);
+	printf("\tIncompressible messages: %u\n", buf->rpc_compress_skip_cnt);
+	printf("\tBytes before compression: %"PRIu64"\n",
+	       buf->rpc_compress_in);
+	printf("\tBytes after compression: %"PRIu64"\n",
+	       buf->rpc_compress_out);
+	if (buf->rpc_compress_out) {
+		printf("\tCompression ratio: %.2f\n",
+		       (double) buf->rpc_compress_in / buf->rpc_compress_out);
+	}
+	printf("\tCompression CPU time: %"PRIu64" usec\n",
+	       buf->rpc_compress_usec);
+	printf("\tDecompressed messages: %u\n", buf->rpc_decompress_cnt);
+	printf("\tDecompression CPU time: %"PRIu64" usec\n",
+	       buf->rpc_decompress_usec);
+
 	printf("\nRemote Procedure Call statistics by user\n");
 	for (i = 0; i < buf->rpc_user_size; i++) {
 		char *user = uid_to_string_or_null(buf->rpc_user_id[i]);
@@ -240,9 +320,36 @@ static int _print_stats(void)
 		       buf->rpc_dump_hostlist[i]);
 	}
 
+	if (buf->xmalloc_site_count) {
+		printf("\nMemory allocation by call site\n");
+		for (i = 0; i < buf->xmalloc_site_count; i++) {
+			printf("\t%-44s count:%-10"PRIu64" "
+			       "bytes:%-14"PRIu64" live_bytes:%"PRIu64"\n",
+			       buf->xmalloc_site[i], buf->xmalloc_site_cnt[i],
+			       buf->xmalloc_site_bytes[i],
+			       buf->xmalloc_site_live[i]);
+		}
+	}
+
 	return 0;
 }
 
+static void _swap_rpc_type_hist(int i, int j)
+{
+	uint32_t *hist_i, *hist_j, tmp;
+
+	if (!buf->rpc_type_hist)
+		return;
+
+	hist_i = buf->rpc_type_hist + (i * buf->rpc_hist_size);
+	hist_j = buf->rpc_type_hist + (j * buf->rpc_hist_size);
+	for (int k = 0; k < buf->rpc_hist_size; k++) {
+		tmp = hist_i[k];
+		hist_i[k] = hist_j[k];
+		hist_j[k] = tmp;
+	}
+}
+
 static void _sort_rpc(void)
 {
 	int i, j;
@@ -267,6 +374,7 @@ static void _sort_rpc(void)
 				buf->rpc_type_id[j]   = type_id;
 				buf->rpc_type_cnt[j]  = type_cnt;
 				buf->rpc_type_time[j] = type_time;
+				_swap_rpc_type_hist(i, j);
 			}
 			if (buf->rpc_type_cnt[i]) {
 				rpc_type_ave_time[i] = buf->rpc_type_time[i] /
@@ -306,6 +414,7 @@ static void _sort_rpc(void)
 				buf->rpc_type_id[j]   = type_id;
 				buf->rpc_type_cnt[j]  = type_cnt;
 				buf->rpc_type_time[j] = type_time;
+				_swap_rpc_type_hist(i, j);
 			}
 			if (buf->rpc_type_cnt[i]) {
 				rpc_type_ave_time[i] = buf->rpc_type_time[i] /
@@ -354,6 +463,7 @@ static void _sort_rpc(void)
 				buf->rpc_type_id[j]   = type_id;
 				buf->rpc_type_cnt[j]  = type_cnt;
 				buf->rpc_type_time[j] = type_time;
+				_swap_rpc_type_hist(i, j);
 			}
 		}
 		for (i = 0; i < buf->rpc_user_size; i++) {
@@ -394,6 +504,7 @@ static void _sort_rpc(void)
 				buf->rpc_type_id[j]   = type_id;
 				buf->rpc_type_cnt[j]  = type_cnt;
 				buf->rpc_type_time[j] = type_time;
+				_swap_rpc_type_hist(i, j);
 			}
 			if (buf->rpc_type_cnt[i]) {
 				rpc_type_ave_time[i] = buf->rpc_type_time[i] /
@@ -84,6 +84,7 @@
 #include "src/common/macros.h"
 #include "src/common/node_select.h"
 #include "src/common/parse_time.h"
+#include "src/common/slurm_conn_pool.h"
 #include "src/common/slurm_protocol_api.h"
 #include "src/common/slurm_protocol_interface.h"
 #include "src/common/uid.h"
@@ -92,6 +93,7 @@
 #include "src/common/xmalloc.h"
 #include "src/common/xstring.h"
 #include "src/slurmctld/agent.h"
+#include "src/slurmctld/agent_loop.h"
 #include "src/slurmctld/front_end.h"
 #include "src/slurmctld/job_scheduler.h"
 #include "src/slurmctld/locks.h"
@@ -105,6 +107,9 @@
 #define RPC_PACK_MAX_AGE	30	/* Rebuild data over 30 seconds old */
 #define DUMP_RPC_COUNT 		25
 #define HOSTLIST_MAX_SIZE 	80
+#define CONN_POOL_IDLE		60	/* Default agent_conn_pool idle time */
+#define CONN_POOL_PER_NODE	4	/* Idle connections kept per slurmd */
+#define CONN_POOL_PURGE		10	/* Seconds between idle purges */
 
 typedef enum {
 	DSH_NEW,        /* Request not yet started */
@@ -147,6 +152,9 @@ typedef struct agent_info {
 	slurm_msg_type_t msg_type;	/* RPC to be issued */
 	void **msg_args_pptr;		/* RPC data to be used */
 	uint16_t protocol_version;	/* if set, use this version */
+	bool aggregate;			/* replies may be merged */
+	List done_list;			/* task_info_t answered through
+					 * the agent event loop */
 } agent_info_t;
 
 typedef struct task_info {
@@ -160,6 +168,8 @@ typedef struct task_info {
 	slurm_msg_type_t msg_type;	/* RPC to be issued */
 	void *msg_args_ptr;		/* ptr to RPC data to be used */
 	uint16_t protocol_version;	/* if set, use this version */
+	bool aggregate;			/* replies may be merged */
+	List done_list;			/* pointer to agent done_list */
 } task_info_t;
 
 typedef struct queued_request {
@@ -191,8 +201,13 @@ static void _queue_agent_retry(agent_info_t * agent_info_ptr, int count);
 static int  _setup_requeue(agent_arg_t *agent_arg_ptr, thd_t *thread_ptr,
 			   int *count, int *spot);
 static void _sig_handler(int dummy);
+static void  _send_loop_rpcs(agent_info_t *agent_info_ptr);
 static void *_thread_per_group_rpc(void *args);
 static int   _valid_agent_arg(agent_arg_t *agent_arg_ptr);
+static bool  _get_reply(slurm_msg_type_t msg_type);
+static bool  _aggregate_msg(task_info_t *task_ptr);
+static bool  _keep_alive_msg(slurm_msg_type_t msg_type);
+static void  _set_conn_pool(void);
 static void *_wdog(void *args);
 
 static mail_info_t *_mail_alloc(void);
@@ -224,6 +239,9 @@ static bool pending_mail = false;
 static bool pending_thread_running = false;
 
 static bool run_scheduler    = false;
+static bool conn_pool = false;
+static bool event_loop = false;
+static bool aggregate_resp = false;
 
 static uint32_t *rpc_stat_counts = NULL, *rpc_stat_types = NULL;
 static uint32_t stat_type_count = 0;
@@ -249,7 +267,7 @@ void *agent(void *args)
 	thd_t *thread_ptr;
 	task_info_t *task_specific_ptr;
 	time_t begin_time;
-	bool spawn_retry_agent = false;
+	bool spawn_retry_agent = false, use_loop;
 	int rpc_thread_cnt;
 	static time_t sched_update = 0;
 	static bool reboot_from_ctld = false;
@@ -276,10 +294,25 @@ void *agent(void *args)
 		                "reboot_from_controller"))
 			reboot_from_ctld = true;
 #endif
+		_set_conn_pool();
+		event_loop = (xstrcasestr(slurm_conf.slurmctld_params,
+					  "agent_event_loop") != NULL);
+		aggregate_resp = (xstrcasestr(slurm_conf.slurmctld_params,
+					      "agent_aggregate_resp") != NULL);
 		sched_update = slurm_conf.last_update;
 	}
 
-	rpc_thread_cnt = 2 + MIN(agent_arg_ptr->node_count, AGENT_THREAD_COUNT);
+	/*
+	 * With the event loop only this thread waits for the responses,
+	 * otherwise there is a watchdog and a thread per group of nodes.
+	 */
+	use_loop = event_loop && !agent_arg_ptr->addr &&
+		   _get_reply(agent_arg_ptr->msg_type);
+	if (use_loop)
+		rpc_thread_cnt = 1;
+	else
+		rpc_thread_cnt = 2 + MIN(agent_arg_ptr->node_count,
+					 AGENT_THREAD_COUNT);
 	while (1) {
 		if (slurmctld_config.shutdown_time ||
 		    ((agent_thread_cnt+rpc_thread_cnt) <= MAX_SERVER_THREADS)) {
@@ -310,7 +343,8 @@ void *agent(void *args)
 	thread_ptr = agent_info_ptr->thread_struct;
 
 	/* start the watchdog thread */
-	slurm_thread_create(&thread_wdog, _wdog, agent_info_ptr);
+	if (!use_loop)
+		slurm_thread_create(&thread_wdog, _wdog, agent_info_ptr);
 
 	log_flag(AGENT, "%s: New agent thread_count:%d threads_active:%d retry:%c get_reply:%c msg_type:%s protocol_version:%hu",
 		 __func__, agent_info_ptr->thread_count,
@@ -320,6 +354,11 @@ void *agent(void *args)
 		 rpc_num2string(agent_arg_ptr->msg_type),
 		 agent_info_ptr->protocol_version);
 
+	if (use_loop) {
+		_send_loop_rpcs(agent_info_ptr);
+		goto done;
+	}
+
 	/* start all the other threads (up to AGENT_THREAD_COUNT active) */
 	for (i = 0; i < agent_info_ptr->thread_count; i++) {
 		/* wait until "room" for another thread */
@@ -345,6 +384,7 @@ void *agent(void *args)
 
 	/* Wait for termination of remaining threads */
 	pthread_join(thread_wdog, NULL);
+done:
 	delay = (int) difftime(time(NULL), begin_time);
 	if (delay > (slurm_conf.msg_timeout * 2)) {
 		info("agent msg_type=%u ran for %d seconds",
@@ -418,6 +458,27 @@ static int _valid_agent_arg(agent_arg_t *agent_arg_ptr)
 	return SLURM_SUCCESS;
 }
 
+/*
+ * RET true if the RPC is fanned out through slurmd and responses are
+ * expected, false if it is sent directly to each node without waiting
+ */
+static bool _get_reply(slurm_msg_type_t msg_type)
+{
+	return ((msg_type != REQUEST_JOB_NOTIFY)		&&
+		(msg_type != REQUEST_REBOOT_NODES)		&&
+		(msg_type != REQUEST_RECONFIGURE)		&&
+		(msg_type != REQUEST_RECONFIGURE_WITH_CONFIG)	&&
+		(msg_type != REQUEST_SHUTDOWN)			&&
+		(msg_type != SRUN_EXEC)				&&
+		(msg_type != SRUN_TIMEOUT)			&&
+		(msg_type != SRUN_NODE_FAIL)			&&
+		(msg_type != SRUN_REQUEST_SUSPEND)		&&
+		(msg_type != SRUN_USER_MSG)			&&
+		(msg_type != SRUN_STEP_MISSING)			&&
+		(msg_type != SRUN_STEP_SIGNAL)			&&
+		(msg_type != SRUN_JOB_COMPLETE));
+}
+
 static agent_info_t *_make_agent_info(agent_arg_t *agent_arg_ptr)
 {
 	int i = 0, j = 0;
@@ -440,20 +501,9 @@ static agent_info_t *_make_agent_info(agent_arg_t *agent_arg_ptr)
 	agent_info_ptr->msg_type       = agent_arg_ptr->msg_type;
 	agent_info_ptr->msg_args_pptr  = &agent_arg_ptr->msg_args;
 	agent_info_ptr->protocol_version = agent_arg_ptr->protocol_version;
+	agent_info_ptr->aggregate      = agent_arg_ptr->aggregate;
 
-	if ((agent_arg_ptr->msg_type != REQUEST_JOB_NOTIFY)	&&
-	    (agent_arg_ptr->msg_type != REQUEST_REBOOT_NODES)	&&
-	    (agent_arg_ptr->msg_type != REQUEST_RECONFIGURE)	&&
-	    (agent_arg_ptr->msg_type != REQUEST_RECONFIGURE_WITH_CONFIG) &&
-	    (agent_arg_ptr->msg_type != REQUEST_SHUTDOWN)	&&
-	    (agent_arg_ptr->msg_type != SRUN_EXEC)		&&
-	    (agent_arg_ptr->msg_type != SRUN_TIMEOUT)		&&
-	    (agent_arg_ptr->msg_type != SRUN_NODE_FAIL)		&&
-	    (agent_arg_ptr->msg_type != SRUN_REQUEST_SUSPEND)	&&
-	    (agent_arg_ptr->msg_type != SRUN_USER_MSG)		&&
-	    (agent_arg_ptr->msg_type != SRUN_STEP_MISSING)	&&
-	    (agent_arg_ptr->msg_type != SRUN_STEP_SIGNAL)	&&
-	    (agent_arg_ptr->msg_type != SRUN_JOB_COMPLETE)) {
+	if (_get_reply(agent_arg_ptr->msg_type)) {
 #ifdef HAVE_FRONT_END
 		span = set_span(agent_arg_ptr->node_count,
 				agent_arg_ptr->node_count);
@@ -523,6 +573,8 @@ static task_info_t *_make_task_data(agent_info_t *agent_info_ptr, int inx)
 	task_info_ptr->msg_type          = agent_info_ptr->msg_type;
 	task_info_ptr->msg_args_ptr      = *agent_info_ptr->msg_args_pptr;
 	task_info_ptr->protocol_version  = agent_info_ptr->protocol_version;
+	task_info_ptr->aggregate         = agent_info_ptr->aggregate;
+	task_info_ptr->done_list         = agent_info_ptr->done_list;
 
 	return task_info_ptr;
 }
@@ -562,21 +614,50 @@ static void _update_wdog_state(thd_t *thread_ptr,
 }
 
 /*
- * _wdog - Watchdog thread. Send SIGUSR1 to threads which have been active
- *	for too long.
- * IN args - pointer to agent_info_t with info on threads to watch
- * Sleep between polls with exponential times (from 0.005 to 1.0 second)
+ * Tally the state of every RPC of an agent.
+ * Call with agent_ptr->thread_mutex locked.
  */
-static void *_wdog(void *args)
+static void _wdog_scan(agent_info_t *agent_ptr, thd_complete_t *thd_comp)
 {
-	bool srun_agent = false;
-	int i;
-	agent_info_t *agent_ptr = (agent_info_t *) args;
 	thd_t *thread_ptr = agent_ptr->thread_struct;
-	unsigned long usec = 5000;
 	ListIterator itr;
-	thd_complete_t thd_comp;
 	ret_data_info_t *ret_data_info = NULL;
+	int i;
+
+	thd_comp->work_done   = true;/* assume all threads complete */
+	thd_comp->fail_cnt    = 0;   /* assume no threads failures */
+	thd_comp->no_resp_cnt = 0;   /* assume all threads respond */
+	thd_comp->retry_cnt   = 0;   /* assume no required retries */
+	thd_comp->now         = time(NULL);
+
+	for (i = 0; i < agent_ptr->thread_count; i++) {
+		//info("thread name %s",thread_ptr[i].node_name);
+		if (!thread_ptr[i].ret_list) {
+			_update_wdog_state(&thread_ptr[i],
+					   &thread_ptr[i].state,
+					   thd_comp);
+		} else {
+			itr = list_iterator_create(thread_ptr[i].ret_list);
+			while ((ret_data_info = list_next(itr))) {
+				_update_wdog_state(&thread_ptr[i],
+						   &ret_data_info->err,
+						   thd_comp);
+			}
+			list_iterator_destroy(itr);
+		}
+	}
+}
+
+/*
+ * Report the outcome of an agent's RPCs once they are all complete, queuing
+ * retries for nodes which did not respond.
+ * Call with agent_ptr->thread_mutex locked.
+ */
+static void _wdog_notify(agent_info_t *agent_ptr, thd_complete_t *thd_comp)
+{
+	bool srun_agent = false;
+	thd_t *thread_ptr = agent_ptr->thread_struct;
+	int i;
 
 	if ( (agent_ptr->msg_type == SRUN_JOB_COMPLETE)			||
 	     (agent_ptr->msg_type == SRUN_REQUEST_SUSPEND)		||
@@ -591,58 +672,51 @@ static void *_wdog(void *args)
 	     (agent_ptr->msg_type == RESPONSE_HET_JOB_ALLOCATION) )
 		srun_agent = true;
 
+	if (srun_agent) {
+		_notify_slurmctld_jobs(agent_ptr);
+	} else {
+		_notify_slurmctld_nodes(agent_ptr,
+					thd_comp->no_resp_cnt,
+					thd_comp->retry_cnt);
+	}
+
+	for (i = 0; i < agent_ptr->thread_count; i++) {
+		FREE_NULL_LIST(thread_ptr[i].ret_list);
+		xfree(thread_ptr[i].nodelist);
+	}
+
+	if (thd_comp->max_delay)
+		log_flag(AGENT, "%s: agent maximum delay %d seconds",
+			 __func__, thd_comp->max_delay);
+}
+
+/*
+ * _wdog - Watchdog thread. Send SIGUSR1 to threads which have been active
+ *	for too long.
+ * IN args - pointer to agent_info_t with info on threads to watch
+ * Sleep between polls with exponential times (from 0.005 to 1.0 second)
+ */
+static void *_wdog(void *args)
+{
+	agent_info_t *agent_ptr = (agent_info_t *) args;
+	unsigned long usec = 5000;
+	thd_complete_t thd_comp;
+
 	thd_comp.max_delay = 0;
 
 	while (1) {
-		thd_comp.work_done   = true;/* assume all threads complete */
-		thd_comp.fail_cnt    = 0;   /* assume no threads failures */
-		thd_comp.no_resp_cnt = 0;   /* assume all threads respond */
-		thd_comp.retry_cnt   = 0;   /* assume no required retries */
-		thd_comp.now         = time(NULL);
-
 		usleep(usec);
 		usec = MIN((usec * 2), 1000000);
 
 		slurm_mutex_lock(&agent_ptr->thread_mutex);
-		for (i = 0; i < agent_ptr->thread_count; i++) {
-			//info("thread name %s",thread_ptr[i].node_name);
-			if (!thread_ptr[i].ret_list) {
-				_update_wdog_state(&thread_ptr[i],
-						   &thread_ptr[i].state,
-						   &thd_comp);
-			} else {
-				itr = list_iterator_create(
-					thread_ptr[i].ret_list);
-				while ((ret_data_info = list_next(itr))) {
-					_update_wdog_state(&thread_ptr[i],
-							   &ret_data_info->err,
-							   &thd_comp);
-				}
-				list_iterator_destroy(itr);
-			}
-		}
+		_wdog_scan(agent_ptr, &thd_comp);
 		if (thd_comp.work_done)
 			break;
 
 		slurm_mutex_unlock(&agent_ptr->thread_mutex);
 	}
 
-	if (srun_agent) {
-		_notify_slurmctld_jobs(agent_ptr);
-	} else {
-		_notify_slurmctld_nodes(agent_ptr,
-					thd_comp.no_resp_cnt,
-					thd_comp.retry_cnt);
-	}
-
-	for (i = 0; i < agent_ptr->thread_count; i++) {
-		FREE_NULL_LIST(thread_ptr[i].ret_list);
-		xfree(thread_ptr[i].nodelist);
-	}
-
-	if (thd_comp.max_delay)
-		log_flag(AGENT, "%s: agent maximum delay %d seconds",
-			 __func__, thd_comp.max_delay);
+	_wdog_notify(agent_ptr, &thd_comp);
 
 	slurm_mutex_unlock(&agent_ptr->thread_mutex);
 	return (void *) NULL;
@@ -786,7 +860,10 @@ static void _notify_slurmctld_nodes(agent_info_t *agent_ptr,
 				      node_names, down_msg);
 				break;
 			case DSH_DONE:
-				node_did_resp(node_names);
+				if (resp_type == RESPONSE_FORWARD_AGGREGATE)
+					nodes_did_resp(node_names);
+				else
+					node_did_resp(node_names);
 				break;
 			default:
 				error("unknown state returned for %s",
@@ -847,33 +924,35 @@ static int _wif_status(void)
 	return rc;
 }
 
+/* RET true if the RPC goes to srun rather than slurmd */
+static bool _is_srun_msg(slurm_msg_type_t msg_type)
+{
+	return ((msg_type == SRUN_PING)				||
+		(msg_type == SRUN_EXEC)				||
+		(msg_type == SRUN_JOB_COMPLETE)			||
+		(msg_type == SRUN_STEP_MISSING)			||
+		(msg_type == SRUN_STEP_SIGNAL)			||
+		(msg_type == SRUN_TIMEOUT)			||
+		(msg_type == SRUN_USER_MSG)			||
+		(msg_type == RESPONSE_RESOURCE_ALLOCATION)	||
+		(msg_type == SRUN_NODE_FAIL));
+}
+
 /*
- * _thread_per_group_rpc - thread to issue an RPC for a group of nodes
- *                         sending message out to one and forwarding it to
- *                         others if necessary.
- * IN/OUT args - pointer to task_info_t, xfree'd on completion
+ * Act on the responses to an RPC, e.g. record node load or requeue a batch
+ * job which could not be launched, and set the state of each response.
+ * IN task_ptr - RPC the responses are for
+ * IN ret_list - List of ret_data_info_t
+ * RET state of the last response
  */
-static void *_thread_per_group_rpc(void *args)
+static state_t _process_ret_list(task_info_t *task_ptr, List ret_list)
 {
-	int rc = SLURM_SUCCESS;
-	slurm_msg_t msg;
-	task_info_t *task_ptr = (task_info_t *) args;
-	/* we cache some pointers from task_info_t because we need
-	 * to xfree args before being finished with their use. xfree
-	 * is required for timely termination of this pthread because
-	 * xfree could lock it at the end, preventing a timely
-	 * thread_exit */
-	pthread_mutex_t *thread_mutex_ptr   = task_ptr->thread_mutex_ptr;
-	pthread_cond_t  *thread_cond_ptr    = task_ptr->thread_cond_ptr;
-	uint32_t        *threads_active_ptr = task_ptr->threads_active_ptr;
-	thd_t           *thread_ptr         = task_ptr->thread_struct_ptr;
+	int rc;
 	state_t thread_state = DSH_NO_RESP;
 	slurm_msg_type_t msg_type = task_ptr->msg_type;
 	bool is_kill_msg, srun_agent;
-	List ret_list = NULL;
 	ListIterator itr;
 	ret_data_info_t *ret_data_info = NULL;
-	int sig_array[2] = {SIGUSR1, 0};
 	/* Locks: Write job, write node */
 	slurmctld_lock_t job_write_lock = {
 		NO_LOCK, WRITE_LOCK, WRITE_LOCK, NO_LOCK, READ_LOCK };
@@ -885,100 +964,11 @@ static void *_thread_per_group_rpc(void *args)
 		NO_LOCK, NO_LOCK, WRITE_LOCK, NO_LOCK, NO_LOCK };
 	uint32_t job_id;
 
-	xassert(args != NULL);
-	xsignal(SIGUSR1, _sig_handler);
-	xsignal_unblock(sig_array);
 	is_kill_msg = (	(msg_type == REQUEST_KILL_TIMELIMIT)	||
 			(msg_type == REQUEST_KILL_PREEMPTED)	||
 			(msg_type == REQUEST_TERMINATE_JOB) );
-	srun_agent = (	(msg_type == SRUN_PING)			||
-			(msg_type == SRUN_EXEC)			||
-			(msg_type == SRUN_JOB_COMPLETE)		||
-			(msg_type == SRUN_STEP_MISSING)		||
-			(msg_type == SRUN_STEP_SIGNAL)		||
-			(msg_type == SRUN_TIMEOUT)		||
-			(msg_type == SRUN_USER_MSG)		||
-			(msg_type == RESPONSE_RESOURCE_ALLOCATION) ||
-			(msg_type == SRUN_NODE_FAIL) );
-
-	thread_ptr->start_time = time(NULL);
-
-	slurm_mutex_lock(thread_mutex_ptr);
-	thread_ptr->state = DSH_ACTIVE;
-	thread_ptr->end_time = thread_ptr->start_time + message_timeout;
-	slurm_mutex_unlock(thread_mutex_ptr);
+	srun_agent = _is_srun_msg(msg_type);
 
-	/* send request message */
-	slurm_msg_t_init(&msg);
-
-	if (task_ptr->protocol_version)
-		msg.protocol_version = task_ptr->protocol_version;
-
-	msg.msg_type = msg_type;
-	msg.data     = task_ptr->msg_args_ptr;
-
-	log_flag(AGENT, "%s: sending %s to %s",
-		 __func__, rpc_num2string(msg_type), thread_ptr->nodelist);
-
-	if (task_ptr->get_reply) {
-		if (thread_ptr->addr) {
-			msg.address = *thread_ptr->addr;
-
-			if (!(ret_list = slurm_send_addr_recv_msgs(
-				     &msg, thread_ptr->nodelist, 0))) {
-				error("%s: no ret_list given", __func__);
-				goto cleanup;
-			}
-		} else {
-			if (!(ret_list = slurm_send_recv_msgs(
-				     thread_ptr->nodelist, &msg, 0))) {
-				error("%s: no ret_list given", __func__);
-				goto cleanup;
-			}
-		}
-	} else {
-		if (thread_ptr->addr) {
-			//info("got the address");
-			msg.address = *thread_ptr->addr;
-		} else {
-			//info("no address given");
-			if (slurm_conf_get_addr(thread_ptr->nodelist,
-					        &msg.address, msg.flags)
-			    == SLURM_ERROR) {
-				error("%s: can't find address for host %s, check slurm.conf",
-				      __func__, thread_ptr->nodelist);
-				goto cleanup;
-			}
-		}
-		//info("sending %u to %s", msg_type, thread_ptr->nodelist);
-		if (msg_type == SRUN_JOB_COMPLETE) {
-			/*
-			 * The srun runs as a single thread, while the kernel
-			 * listen() may be queuing messages for further
-			 * processing. If we get our SYN in the listen queue
-			 * at the same time the last MESSAGE_TASK_EXIT is being
-			 * processed, srun may exit meaning this message is
-			 * never received, leading to a series of error
-			 * messages from slurm_send_only_node_msg().
-			 * So, we use this different function that blindly
-			 * flings the message out and disregards any
-			 * communication problems that may arise.
-			 */
-			slurm_send_msg_maybe(&msg);
-			thread_state = DSH_DONE;
-		} else if (slurm_send_only_node_msg(&msg) == SLURM_SUCCESS) {
-			thread_state = DSH_DONE;
-		} else {
-			if (!srun_agent) {
-				lock_slurmctld(node_read_lock);
-				_comm_err(thread_ptr->nodelist, msg_type);
-				unlock_slurmctld(node_read_lock);
-			}
-		}
-		goto cleanup;
-	}
-
-	//info("got %d messages back", list_count(ret_list));
 	itr = list_iterator_create(ret_list);
 	while ((ret_data_info = list_next(itr))) {
 		rc = slurm_get_return_code(ret_data_info->type,
@@ -1173,6 +1163,214 @@ static void *_thread_per_group_rpc(void *args)
 	}
 	list_iterator_destroy(itr);
 
+
+	return thread_state;
+}
+
+/* Called by the agent event loop with the responses for one group */
+static void _loop_rpc_done(List ret_list, void *arg)
+{
+	task_info_t *task_ptr = arg;
+
+	slurm_mutex_lock(task_ptr->thread_mutex_ptr);
+	task_ptr->thread_struct_ptr->ret_list = ret_list;
+	list_enqueue(task_ptr->done_list, task_ptr);
+	(*task_ptr->threads_active_ptr)--;
+	slurm_cond_signal(task_ptr->thread_cond_ptr);
+	slurm_mutex_unlock(task_ptr->thread_mutex_ptr);
+}
+
+/*
+ * Issue the RPC for every group of nodes through the agent event loop,
+ * process the responses as they arrive, then report the outcome the way
+ * _wdog() does.
+ */
+static void _send_loop_rpcs(agent_info_t *agent_info_ptr)
+{
+	thd_t *thread_ptr = agent_info_ptr->thread_struct;
+	task_info_t *task_ptr;
+	thd_complete_t thd_comp;
+	slurm_msg_t msg;
+	state_t thread_state;
+	int i, done_cnt = 0;
+
+	agent_info_ptr->done_list = list_create(NULL);
+
+	for (i = 0; i < agent_info_ptr->thread_count; i++) {
+		task_ptr = _make_task_data(agent_info_ptr, i);
+
+		slurm_msg_t_init(&msg);
+		if (task_ptr->protocol_version)
+			msg.protocol_version = task_ptr->protocol_version;
+		msg.msg_type = task_ptr->msg_type;
+		msg.data = task_ptr->msg_args_ptr;
+		if (conn_pool && _keep_alive_msg(msg.msg_type))
+			msg.flags |= SLURM_MSG_KEEP_ALIVE;
+		if (_aggregate_msg(task_ptr))
+			msg.flags |= SLURM_MSG_AGGREGATE;
+
+		log_flag(AGENT, "%s: sending %s to %s",
+			 __func__, rpc_num2string(msg.msg_type),
+			 thread_ptr[i].nodelist);
+
+		slurm_mutex_lock(&agent_info_ptr->thread_mutex);
+		thread_ptr[i].state = DSH_ACTIVE;
+		thread_ptr[i].start_time = time(NULL);
+		agent_info_ptr->threads_active++;
+		slurm_mutex_unlock(&agent_info_ptr->thread_mutex);
+
+		agent_loop_send(&msg, thread_ptr[i].nodelist, 0,
+				_loop_rpc_done, task_ptr);
+	}
+
+	slurm_mutex_lock(&agent_info_ptr->thread_mutex);
+	while (done_cnt < agent_info_ptr->thread_count) {
+		if (!(task_ptr = list_dequeue(agent_info_ptr->done_list))) {
+			slurm_cond_wait(&agent_info_ptr->thread_cond,
+					&agent_info_ptr->thread_mutex);
+			continue;
+		}
+		slurm_mutex_unlock(&agent_info_ptr->thread_mutex);
+
+		thread_state = _process_ret_list(
+			task_ptr, task_ptr->thread_struct_ptr->ret_list);
+
+		slurm_mutex_lock(&agent_info_ptr->thread_mutex);
+		task_ptr->thread_struct_ptr->state = thread_state;
+		task_ptr->thread_struct_ptr->end_time = (time_t) difftime(
+			time(NULL), task_ptr->thread_struct_ptr->start_time);
+		xfree(task_ptr);
+		done_cnt++;
+	}
+
+	thd_comp.max_delay = 0;
+	_wdog_scan(agent_info_ptr, &thd_comp);
+	_wdog_notify(agent_info_ptr, &thd_comp);
+	slurm_mutex_unlock(&agent_info_ptr->thread_mutex);
+
+	FREE_NULL_LIST(agent_info_ptr->done_list);
+}
+
+/*
+ * _thread_per_group_rpc - thread to issue an RPC for a group of nodes
+ *                         sending message out to one and forwarding it to
+ *                         others if necessary.
+ * IN/OUT args - pointer to task_info_t, xfree'd on completion
+ */
+static void *_thread_per_group_rpc(void *args)
+{
+	slurm_msg_t msg;
+	task_info_t *task_ptr = (task_info_t *) args;
+	/* we cache some pointers from task_info_t because we need
+	 * to xfree args before being finished with their use. xfree
+	 * is required for timely termination of this pthread because
+	 * xfree could lock it at the end, preventing a timely
+	 * thread_exit */
+	pthread_mutex_t *thread_mutex_ptr   = task_ptr->thread_mutex_ptr;
+	pthread_cond_t  *thread_cond_ptr    = task_ptr->thread_cond_ptr;
+	uint32_t        *threads_active_ptr = task_ptr->threads_active_ptr;
+	thd_t           *thread_ptr         = task_ptr->thread_struct_ptr;
+	state_t thread_state = DSH_NO_RESP;
+	slurm_msg_type_t msg_type = task_ptr->msg_type;
+	bool srun_agent;
+	List ret_list = NULL;
+	int sig_array[2] = {SIGUSR1, 0};
+	/* Locks: Write job, write node */
+	slurmctld_lock_t job_write_lock = {
+		NO_LOCK, WRITE_LOCK, WRITE_LOCK, NO_LOCK, READ_LOCK };
+	/* Lock: Read node */
+	slurmctld_lock_t node_read_lock = {
+		NO_LOCK, NO_LOCK, READ_LOCK, NO_LOCK, NO_LOCK };
+	uint32_t job_id;
+
+	xassert(args != NULL);
+	xsignal(SIGUSR1, _sig_handler);
+	xsignal_unblock(sig_array);
+	srun_agent = _is_srun_msg(msg_type);
+
+	thread_ptr->start_time = time(NULL);
+
+	slurm_mutex_lock(thread_mutex_ptr);
+	thread_ptr->state = DSH_ACTIVE;
+	thread_ptr->end_time = thread_ptr->start_time + message_timeout;
+	slurm_mutex_unlock(thread_mutex_ptr);
+
+	/* send request message */
+	slurm_msg_t_init(&msg);
+
+	if (task_ptr->protocol_version)
+		msg.protocol_version = task_ptr->protocol_version;
+
+	msg.msg_type = msg_type;
+	msg.data     = task_ptr->msg_args_ptr;
+	if (conn_pool && task_ptr->get_reply && _keep_alive_msg(msg_type))
+		msg.flags |= SLURM_MSG_KEEP_ALIVE;
+	if (task_ptr->get_reply && _aggregate_msg(task_ptr))
+		msg.flags |= SLURM_MSG_AGGREGATE;
+
+	log_flag(AGENT, "%s: sending %s to %s",
+		 __func__, rpc_num2string(msg_type), thread_ptr->nodelist);
+
+	if (task_ptr->get_reply) {
+		if (thread_ptr->addr) {
+			msg.address = *thread_ptr->addr;
+
+			if (!(ret_list = slurm_send_addr_recv_msgs(
+				     &msg, thread_ptr->nodelist, 0))) {
+				error("%s: no ret_list given", __func__);
+				goto cleanup;
+			}
+		} else {
+			if (!(ret_list = slurm_send_recv_msgs(
+				     thread_ptr->nodelist, &msg, 0))) {
+				error("%s: no ret_list given", __func__);
+				goto cleanup;
+			}
+		}
+	} else {
+		if (thread_ptr->addr) {
+			//info("got the address");
+			msg.address = *thread_ptr->addr;
+		} else {
+			//info("no address given");
+			if (slurm_conf_get_addr(thread_ptr->nodelist,
+					        &msg.address, msg.flags)
+			    == SLURM_ERROR) {
+				error("%s: can't find address for host %s, check slurm.conf",
+				      __func__, thread_ptr->nodelist);
+				goto cleanup;
+			}
+		}
+		//info("sending %u to %s", msg_type, thread_ptr->nodelist);
+		if (msg_type == SRUN_JOB_COMPLETE) {
+			/*
+			 * The srun runs as a single thread, while the kernel
+			 * listen() may be queuing messages for further
+			 * processing. If we get our SYN in the listen queue
+			 * at the same time the last MESSAGE_TASK_EXIT is being
+			 * processed, srun may exit meaning this message is
+			 * never received, leading to a series of error
+			 * messages from slurm_send_only_node_msg().
+			 * So, we use this different function that blindly
+			 * flings the message out and disregards any
+			 * communication problems that may arise.
+			 */
+			slurm_send_msg_maybe(&msg);
+			thread_state = DSH_DONE;
+		} else if (slurm_send_only_node_msg(&msg) == SLURM_SUCCESS) {
+			thread_state = DSH_DONE;
+		} else {
+			if (!srun_agent) {
+				lock_slurmctld(node_read_lock);
+				_comm_err(thread_ptr->nodelist, msg_type);
+				unlock_slurmctld(node_read_lock);
+			}
+		}
+		goto cleanup;
+	}
+
+	thread_state = _process_ret_list(task_ptr, ret_list);
+
 cleanup:
 	xfree(args);
 	if (!ret_list && (msg_type == REQUEST_SIGNAL_TASKS)) {
@@ -1361,6 +1559,75 @@ static void _list_delete_retry(void *retry_entry)
 	xfree(queued_req_ptr);
 }
 
+/*
+ * Enable or disable reuse of slurmd connections per
+ * SlurmctldParameters=agent_conn_pool[=<idle_seconds>]
+ */
+static void _set_conn_pool(void)
+{
+	char *tmp_ptr;
+	int idle = CONN_POOL_IDLE;
+
+	if (!(tmp_ptr = xstrcasestr(slurm_conf.slurmctld_params,
+				    "agent_conn_pool"))) {
+		if (conn_pool)
+			slurm_conn_pool_fini();
+		conn_pool = false;
+		return;
+	}
+
+	if (tmp_ptr[15] == '=') {
+		idle = atoi(tmp_ptr + 16);
+		if (idle < 1) {
+			error("Invalid SlurmctldParameters agent_conn_pool, using %d",
+			      CONN_POOL_IDLE);
+			idle = CONN_POOL_IDLE;
+		}
+	}
+	slurm_conn_pool_init(idle, CONN_POOL_PER_NODE);
+	conn_pool = true;
+}
+
+/*
+ * SlurmctldParameters=agent_aggregate_resp
+ * RET true if the slurmds may merge their replies to this RPC on the way up
+ * the tree, see SLURM_MSG_AGGREGATE. The sender of the request opts in through
+ * agent_arg_t.aggregate. Only slurmds from SLURM_21_08_1_PROTOCOL_VERSION on
+ * know how to, and the request carries the lowest protocol version of the
+ * nodes it is sent to (see ping_nodes()).
+ */
+static bool _aggregate_msg(task_info_t *task_ptr)
+{
+	return (aggregate_resp && task_ptr->aggregate &&
+		((task_ptr->msg_type == REQUEST_PING) ||
+		 (task_ptr->msg_type == REQUEST_NODE_REGISTRATION_STATUS)) &&
+		(task_ptr->protocol_version >=
+		 SLURM_21_08_1_PROTOCOL_VERSION));
+}
+
+/*
+ * Messages for which slurmd replies once and then either returns or hands the
+ * connection back (slurmd_release_conn()), so the connection can be reused.
+ */
+static bool _keep_alive_msg(slurm_msg_type_t msg_type)
+{
+	switch (msg_type) {
+	case REQUEST_ABORT_JOB:
+	case REQUEST_ACCT_GATHER_UPDATE:
+	case REQUEST_HEALTH_CHECK:
+	case REQUEST_KILL_PREEMPTED:
+	case REQUEST_KILL_TIMELIMIT:
+	case REQUEST_NODE_REGISTRATION_STATUS:
+	case REQUEST_PING:
+	case REQUEST_SIGNAL_TASKS:
+	case REQUEST_TERMINATE_JOB:
+	case REQUEST_TERMINATE_TASKS:
+		return true;
+	default:
+		return false;
+	}
+}
+
 /* Start a thread to manage queued agent requests */
 static void *_agent_init(void *arg)
 {
@@ -1368,6 +1635,7 @@ static void *_agent_init(void *arg)
 	bool mail_too;
 	struct timespec ts = {0, 0};
 	time_t last_defer_attempt = (time_t) 0;
+	time_t last_pool_purge = (time_t) 0;
 
 	while (true) {
 		slurm_mutex_lock(&pending_mutex);
@@ -1393,6 +1661,12 @@ static void *_agent_init(void *arg)
 		}
 
 		_agent_retry(min_wait, mail_too);
+
+		if (conn_pool &&
+		    ((last_pool_purge + CONN_POOL_PURGE) <= time(NULL))) {
+			last_pool_purge = time(NULL);
+			slurm_conn_pool_purge();
+		}
 	}
 
 	slurm_mutex_lock(&pending_mutex);
@@ -1744,6 +2018,15 @@ extern void agent_purge(void)
 		slurm_mutex_unlock(&mail_mutex);
 	}
 
+	if (conn_pool) {
+		slurm_conn_pool_fini();
+		conn_pool = false;
+	}
+
+	/* Stop the event loop once no agent is waiting on it */
+	if (!get_agent_count())
+		agent_loop_fini();
+
 	xfree(rpc_stat_counts);
 	xfree(rpc_stat_types);
 	xfree(rpc_type_list);
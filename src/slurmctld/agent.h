@@ -61,6 +61,8 @@ typedef struct agent_arg {
 	uint16_t        protocol_version; /* protocol version to use */
 	slurm_msg_type_t msg_type;	/* RPC to be issued */
 	void		*msg_args;	/* RPC data to be transmitted */
+	bool		aggregate;	/* replies may be merged, see
+					 * SLURM_MSG_AGGREGATE */
 } agent_arg_t;
 
 /* Start a thread to manage queued agent requests */
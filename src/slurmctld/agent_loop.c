@@ -0,0 +1,790 @@
+/*****************************************************************************\
+ *  agent_loop.c - event driven transmission of agent RPCs
+ *****************************************************************************
+ *  This file is part of Slurm, a resource management program.
+ *  For details, see <https://slurm.schedmd.com/>.
+ *  Please also read the included file: DISCLAIMER.
+ *
+ *  Slurm is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 2 of the License, or (at your option)
+ *  any later version.
+ *
+ *  In addition, as a special exception, the copyright holders give permission
+ *  to link the code of portions of this program with the OpenSSL library under
+ *  certain conditions as described in each individual source file, and
+ *  distribute linked combinations including the two. You must obey the GNU
+ *  General Public License in all respects for all of the code used other than
+ *  OpenSSL. If you modify file(s) with this exception, you may extend this
+ *  exception to your version of the file(s), but you are not obligated to do
+ *  so. If you do not wish to do so, delete this exception statement from your
+ *  version.  If you delete this exception statement from all source files in
+ *  the program, then also delete it here.
+ *
+ *  Slurm is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with Slurm; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA.
+\*****************************************************************************/
+
+#include "config.h"
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <time.h>
+#include <unistd.h>
+
+#if HAVE_SYS_PRCTL_H
+#include <sys/prctl.h>
+#endif
+
+#include "src/common/fd.h"
+#include "src/common/forward.h"
+#include "src/common/hostlist.h"
+#include "src/common/log.h"
+#include "src/common/macros.h"
+#include "src/common/read_config.h"
+#include "src/common/slurm_conn_pool.h"
+#include "src/common/slurm_protocol_api.h"
+#include "src/common/slurm_route.h"
+#include "src/common/xmalloc.h"
+#include "src/common/xstring.h"
+
+#include "src/slurmctld/agent_loop.h"
+
+/* Same limit as slurm_msg_recvfrom_timeout() */
+#define MAX_MSG_SIZE (1024 * 1024 * 1024)
+/* Wait before connecting again to a slurmd refusing connections, in msec */
+#define CONNECT_RETRY_WAIT 1000
+
+typedef enum {
+	CONN_WAIT,		/* waiting to connect */
+	CONN_CONNECT,		/* connect() in progress */
+	CONN_SEND,
+	CONN_RECV,
+	CONN_DONE,		/* to be freed */
+} conn_state_t;
+
+/* One agent_loop_send() call */
+typedef struct {
+	slurm_msg_type_t msg_type;
+	void *data;
+	uint16_t flags;
+	uint16_t protocol_version;
+	int timeout;		/* msec */
+	List ret_list;		/* ret_data_info_t of finished nodes */
+	int pending;		/* connections not finished */
+	agent_loop_done_t done;
+	void *arg;
+} loop_req_t;
+
+/* A connection to the head of one branch of the tree */
+typedef struct {
+	loop_req_t *req;
+	char *name;		/* node connected to */
+	hostlist_t fwd_hl;	/* nodes it forwards the message to */
+	int fwd_cnt;
+	slurm_addr_t addr;
+	int fd;
+	conn_state_t state;
+	int connect_secs;	/* time spent on failed connects */
+	uint64_t start;		/* usec, first connect attempt */
+	uint64_t deadline;	/* msec, see _now_msec() */
+	buf_t *out;		/* packed message */
+	uint32_t out_len;	/* message length in network order */
+	uint32_t sent;		/* bytes of out_len and out sent */
+	uint32_t msglen;	/* response length */
+	uint32_t hdr_read;	/* bytes of msglen read so far */
+	char *data;
+	uint32_t data_read;
+} loop_conn_t;
+
+static pthread_mutex_t loop_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_t loop_tid = 0;
+static List new_conns = NULL;		/* loop_conn_t to be started */
+static bool loop_shutdown = false;
+static int wake_fd[2] = { -1, -1 };
+
+/* Only used by the event loop thread */
+static List conn_list = NULL;		/* loop_conn_t in progress */
+static List spawn_list = NULL;		/* loop_conn_t added by conn_list */
+
+static uint64_t _now_usec(void)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	return ((uint64_t) now.tv_sec * 1000000) + (now.tv_nsec / 1000);
+}
+
+static uint64_t _now_msec(void)
+{
+	return _now_usec() / 1000;
+}
+
+static void _free_conn(void *x)
+{
+	loop_conn_t *conn = x;
+
+	if (!conn)
+		return;
+
+	if ((conn->fd >= 0) && (close(conn->fd) < 0))
+		error("close(%d): %m", conn->fd);
+	xfree(conn->name);
+	FREE_NULL_HOSTLIST(conn->fwd_hl);
+	FREE_NULL_BUFFER(conn->out);
+	xfree(conn->data);
+	xfree(conn);
+}
+
+static void _wake_loop(void)
+{
+	char c = 0;
+
+	if ((write(wake_fd[1], &c, 1) < 0) && (errno != EAGAIN))
+		error("%s: write: %m", __func__);
+}
+
+/* How long the head of a branch may take to answer for all of it */
+static int _recv_timeout(loop_conn_t *conn)
+{
+	int steps, timeout;
+
+	if (!conn->fwd_cnt)
+		return conn->req->timeout;
+
+	/* Same as _send_and_recv_msgs() */
+	steps = conn->fwd_cnt + 1;
+	if (slurm_conf.tree_width)
+		steps /= slurm_conf.tree_width;
+	timeout = slurm_conf.msg_timeout * 1000 * steps;
+	steps++;
+	timeout += conn->req->timeout * steps;
+
+	return timeout;
+}
+
+static buf_t *_pack_conn_msg(loop_conn_t *conn)
+{
+	loop_req_t *req = conn->req;
+	slurm_msg_t msg;
+	buf_t *buffer;
+
+	slurm_msg_t_init(&msg);
+	msg.msg_type = req->msg_type;
+	msg.data = req->data;
+	msg.flags = req->flags;
+	msg.protocol_version = req->protocol_version;
+	msg.forward.timeout = req->timeout;
+	if ((msg.forward.cnt = conn->fwd_cnt))
+		msg.forward.nodelist =
+			hostlist_ranged_string_xmalloc(conn->fwd_hl);
+
+	buffer = slurm_pack_node_msg(&msg);
+	xfree(msg.forward.nodelist);
+
+	return buffer;
+}
+
+/*
+ * Set up the connection to the first usable node of hl, which forwards the
+ * message to the rest of hl. Nodes without an address are marked as failed
+ * and skipped, like _fwd_tree_thread() does.
+ * IN req - request the nodes belong to
+ * IN hl - branch of the tree, consumed
+ * IN conns - list to add the new connection to
+ */
+static void _start_branch(loop_req_t *req, hostlist_t hl, List conns)
+{
+	loop_conn_t *conn;
+	char *name;
+
+	while ((name = hostlist_shift(hl))) {
+		conn = xmalloc(sizeof(*conn));
+		conn->req = req;
+		conn->fd = -1;
+		if (slurm_conf_get_addr(name, &conn->addr, req->flags) ==
+		    SLURM_ERROR) {
+			error("%s: can't find address for host %s, check slurm.conf",
+			      __func__, name);
+			mark_as_failed_forward(&req->ret_list, name,
+					       SLURM_UNKNOWN_FORWARD_ADDR);
+			free(name);
+			xfree(conn);
+			continue;
+		}
+
+		conn->name = xstrdup(name);
+		free(name);
+		conn->fwd_hl = hl;
+		conn->fwd_cnt = hostlist_count(hl);
+		if (!(conn->out = _pack_conn_msg(conn))) {
+			mark_as_failed_forward(&req->ret_list, conn->name,
+					       errno);
+			conn->fwd_hl = NULL;
+			_free_conn(conn);
+			continue;
+		}
+		conn->out_len = htonl(get_buf_offset(conn->out));
+		conn->state = CONN_WAIT;
+		conn->deadline = 0;
+		req->pending++;
+		list_append(conns, conn);
+		return;
+	}
+
+	hostlist_destroy(hl);
+}
+
+static void _req_done(loop_req_t *req)
+{
+	log_flag(AGENT, "%s: %s answered by %d nodes",
+		 __func__, rpc_num2string(req->msg_type),
+		 ret_list_node_count(req->ret_list));
+
+	(req->done)(req->ret_list, req->arg);
+	xfree(req);
+}
+
+/*
+ * Add the responses for a branch to its request. Nodes of the branch
+ * missing from ret_list are contacted directly, like _fwd_tree_thread()
+ * does, so a dead head does not cost every node below it a timeout.
+ */
+static void _conn_finish(loop_conn_t *conn, List ret_list)
+{
+	loop_req_t *req = conn->req;
+	ret_data_info_t *ret_data_info;
+	ListIterator itr;
+	int ret_cnt;
+	char *name;
+
+	if ((conn->fd >= 0) && (close(conn->fd) < 0))
+		error("close(%d): %m", conn->fd);
+	conn->fd = -1;
+	conn->state = CONN_DONE;
+
+	itr = list_iterator_create(ret_list);
+	while ((ret_data_info = list_next(itr))) {
+		if (!ret_data_info->node_name)
+			ret_data_info->node_name = xstrdup(conn->name);
+		else if (conn->fwd_cnt)
+			hostlist_delete(conn->fwd_hl, ret_data_info->node_name);
+	}
+	list_iterator_destroy(itr);
+
+	if (conn->start && !loop_shutdown)
+		route_stats_record_list(conn->name, conn->fwd_cnt,
+					_now_usec() - conn->start, ret_list);
+
+	ret_cnt = ret_list_node_count(ret_list);
+	list_transfer(req->ret_list, ret_list);
+	FREE_NULL_LIST(ret_list);
+
+	if (ret_cnt <= conn->fwd_cnt) {
+		while ((name = hostlist_shift(conn->fwd_hl))) {
+			if (loop_shutdown) {
+				mark_as_failed_forward(
+					&req->ret_list, name,
+					SLURM_COMMUNICATIONS_CONNECTION_ERROR);
+			} else {
+				_start_branch(req, hostlist_create(name),
+					      spawn_list);
+			}
+			free(name);
+		}
+	}
+
+	if (!--req->pending)
+		_req_done(req);
+}
+
+static void _conn_fail(loop_conn_t *conn, int err)
+{
+	List ret_list = NULL;
+
+	log_flag(NET, "%s: %s to %s failed: %s",
+		 __func__, rpc_num2string(conn->req->msg_type), conn->name,
+		 slurm_strerror(err));
+	mark_as_failed_forward(&ret_list, conn->name, err);
+	_conn_finish(conn, ret_list);
+}
+
+/*
+ * Write as much of the message as possible without blocking.
+ * RET 1 once the whole message is sent, 0 if more is to be sent or -1 on
+ * error
+ */
+static int _write_conn(loop_conn_t *conn)
+{
+	uint32_t len_size = sizeof(conn->out_len);
+	uint32_t total = len_size + get_buf_offset(conn->out);
+	struct msghdr mh;
+	struct iovec iov[2];
+	ssize_t rc;
+
+	while (conn->sent < total) {
+		memset(&mh, 0, sizeof(mh));
+		mh.msg_iov = iov;
+		if (conn->sent < len_size) {
+			iov[0].iov_base = ((char *) &conn->out_len) +
+					  conn->sent;
+			iov[0].iov_len = len_size - conn->sent;
+			iov[1].iov_base = get_buf_data(conn->out);
+			iov[1].iov_len = get_buf_offset(conn->out);
+			mh.msg_iovlen = 2;
+		} else {
+			iov[0].iov_base = get_buf_data(conn->out) +
+					  (conn->sent - len_size);
+			iov[0].iov_len = total - conn->sent;
+			mh.msg_iovlen = 1;
+		}
+
+		if ((rc = sendmsg(conn->fd, &mh, MSG_NOSIGNAL)) < 0) {
+			if (errno == EINTR)
+				continue;
+			if ((errno == EAGAIN) || (errno == EWOULDBLOCK))
+				return 0;
+			log_flag(NET, "%s: write to %s: %m",
+				 __func__, conn->name);
+			return -1;
+		}
+		conn->sent += rc;
+	}
+
+	return 1;
+}
+
+/*
+ * Read as much of the response as is available without blocking.
+ * RET 1 once the whole message is read, 0 if more is needed or -1 on error
+ */
+static int _read_conn(loop_conn_t *conn)
+{
+	char *ptr;
+	size_t len;
+	ssize_t rc;
+
+	while (conn->data_read < conn->msglen ||
+	       conn->hdr_read < sizeof(conn->msglen)) {
+		if (conn->hdr_read < sizeof(conn->msglen)) {
+			ptr = ((char *) &conn->msglen) + conn->hdr_read;
+			len = sizeof(conn->msglen) - conn->hdr_read;
+		} else {
+			ptr = conn->data + conn->data_read;
+			len = conn->msglen - conn->data_read;
+		}
+
+		if ((rc = read(conn->fd, ptr, len)) < 0) {
+			if (errno == EINTR)
+				continue;
+			if ((errno == EAGAIN) || (errno == EWOULDBLOCK))
+				return 0;
+			log_flag(NET, "%s: read from %s: %m",
+				 __func__, conn->name);
+			return -1;
+		} else if (!rc) {
+			log_flag(NET, "%s: connection to %s closed before the response was read",
+				 __func__, conn->name);
+			return -1;
+		}
+
+		if (conn->hdr_read < sizeof(conn->msglen)) {
+			conn->hdr_read += rc;
+			if (conn->hdr_read < sizeof(conn->msglen))
+				continue;
+			conn->msglen = ntohl(conn->msglen);
+			if (!conn->msglen || (conn->msglen > MAX_MSG_SIZE)) {
+				error("%s: %s from %s", __func__,
+				      slurm_strerror(
+					      SLURM_PROTOCOL_INSANE_MSG_LENGTH),
+				      conn->name);
+				return -1;
+			}
+			conn->data = xmalloc_nz(conn->msglen);
+		} else {
+			conn->data_read += rc;
+		}
+	}
+
+	return 1;
+}
+
+static void _conn_recv_done(loop_conn_t *conn)
+{
+	List ret_list;
+
+	log_flag_hex(NET_RAW, conn->data, conn->msglen, "%s: read", __func__);
+	ret_list = slurm_unpack_received_msgs(
+		conn->fd, create_buf(conn->data, conn->msglen));
+	conn->data = NULL;
+	if (!ret_list) {
+		_conn_fail(conn, errno);
+		return;
+	}
+
+	if (conn->req->flags & SLURM_MSG_KEEP_ALIVE) {
+		fd_set_blocking(conn->fd);
+		slurm_conn_pool_put(&conn->addr, conn->fd);
+		conn->fd = -1;
+	}
+	_conn_finish(conn, ret_list);
+}
+
+static void _conn_send(loop_conn_t *conn, uint64_t now)
+{
+	int rc;
+
+	conn->state = CONN_SEND;
+	conn->deadline = now + _recv_timeout(conn);
+
+	if ((rc = _write_conn(conn)) > 0) {
+		conn->state = CONN_RECV;
+		FREE_NULL_BUFFER(conn->out);
+	} else if (rc < 0) {
+		_conn_fail(conn, SLURM_COMMUNICATIONS_SEND_ERROR);
+	}
+}
+
+/*
+ * Like slurm_send_addr_recv_msgs(), keep trying to connect for a while so
+ * a restarting slurmd is not reported as not responding.
+ */
+static void _conn_connect_failed(loop_conn_t *conn, int err, uint64_t now)
+{
+	(void) close(conn->fd);
+	conn->fd = -1;
+
+	if (err == ECONNREFUSED) {
+		conn->connect_secs++;
+		conn->deadline = now + CONNECT_RETRY_WAIT;
+	} else if (err == ETIMEDOUT) {
+		conn->connect_secs += MAX(1, slurm_conf.tcp_timeout);
+		conn->deadline = now;
+	}
+
+	if (loop_shutdown ||
+	    ((err != ECONNREFUSED) && (err != ETIMEDOUT)) ||
+	    (conn->connect_secs > MIN(slurm_conf.msg_timeout, 10))) {
+		errno = err;
+		log_flag(NET, "%s: Failed to connect to %pA, %m",
+			 __func__, &conn->addr);
+		_conn_fail(conn, SLURM_COMMUNICATIONS_CONNECTION_ERROR);
+		return;
+	}
+
+	conn->state = CONN_WAIT;
+}
+
+static void _conn_connect(loop_conn_t *conn, uint64_t now)
+{
+	if (!conn->start)
+		conn->start = _now_usec();
+
+	if (!conn->connect_secs &&
+	    (conn->req->flags & SLURM_MSG_KEEP_ALIVE) &&
+	    ((conn->fd = slurm_conn_pool_get(&conn->addr)) >= 0)) {
+		fd_set_nonblocking(conn->fd);
+		_conn_send(conn, now);
+		return;
+	}
+
+	if ((conn->fd = socket(conn->addr.ss_family, SOCK_STREAM,
+			       IPPROTO_TCP)) < 0) {
+		error("%s: socket: %m", __func__);
+		_conn_fail(conn, SLURM_COMMUNICATIONS_CONNECTION_ERROR);
+		return;
+	}
+	fd_set_nonblocking(conn->fd);
+	fd_set_close_on_exec(conn->fd);
+
+	if (!connect(conn->fd, (struct sockaddr *) &conn->addr,
+		     sizeof(conn->addr))) {
+		_conn_send(conn, now);
+	} else if (errno == EINPROGRESS) {
+		conn->state = CONN_CONNECT;
+		conn->deadline = now + (slurm_conf.tcp_timeout * 1000);
+	} else {
+		_conn_connect_failed(conn, errno, now);
+	}
+}
+
+/* Handle a connection whose deadline has passed */
+static void _conn_timer(loop_conn_t *conn, uint64_t now)
+{
+	switch (conn->state) {
+	case CONN_WAIT:
+		_conn_connect(conn, now);
+		break;
+	case CONN_CONNECT:
+		_conn_connect_failed(conn, ETIMEDOUT, now);
+		break;
+	case CONN_SEND:
+	case CONN_RECV:
+		_conn_fail(conn, SLURM_PROTOCOL_SOCKET_IMPL_TIMEOUT);
+		break;
+	case CONN_DONE:
+		break;
+	}
+}
+
+/* Handle poll() events on a connection */
+static void _conn_event(loop_conn_t *conn, uint64_t now)
+{
+	socklen_t errlen = sizeof(int);
+	int err = 0, rc;
+
+	switch (conn->state) {
+	case CONN_CONNECT:
+		if (getsockopt(conn->fd, SOL_SOCKET, SO_ERROR, &err, &errlen))
+			err = errno;
+		if (err)
+			_conn_connect_failed(conn, err, now);
+		else
+			_conn_send(conn, now);
+		break;
+	case CONN_SEND:
+		if ((rc = _write_conn(conn)) > 0) {
+			conn->state = CONN_RECV;
+			FREE_NULL_BUFFER(conn->out);
+		} else if (rc < 0) {
+			_conn_fail(conn, SLURM_COMMUNICATIONS_SEND_ERROR);
+		}
+		break;
+	case CONN_RECV:
+		if ((rc = _read_conn(conn)) > 0)
+			_conn_recv_done(conn);
+		else if (rc < 0)
+			_conn_fail(conn, SLURM_COMMUNICATIONS_RECEIVE_ERROR);
+		break;
+	case CONN_WAIT:
+	case CONN_DONE:
+		break;
+	}
+}
+
+/* Report every node of an unfinished connection as failed */
+static int _abandon_conn(void *x, void *arg)
+{
+	loop_conn_t *conn = x;
+
+	if (conn->state != CONN_DONE)
+		_conn_fail(conn, SLURM_COMMUNICATIONS_CONNECTION_ERROR);
+
+	return 0;
+}
+
+static void *_agent_loop(void *arg)
+{
+	struct pollfd *pfds = NULL;
+	loop_conn_t **map = NULL;
+	loop_conn_t *conn;
+	ListIterator itr;
+	int i, max_fds = 0, nfds, timeout;
+	uint64_t now;
+	char buf[64];
+
+#if HAVE_SYS_PRCTL_H
+	if (prctl(PR_SET_NAME, "agent_loop", NULL, NULL, NULL) < 0) {
+		error("%s: cannot set my name to %s %m", __func__,
+		      "agent_loop");
+	}
+#endif
+
+	while (true) {
+		slurm_mutex_lock(&loop_mutex);
+		list_transfer(conn_list, new_conns);
+		if (loop_shutdown) {
+			slurm_mutex_unlock(&loop_mutex);
+			break;
+		}
+		slurm_mutex_unlock(&loop_mutex);
+
+		if (max_fds < (list_count(conn_list) + 1)) {
+			max_fds = list_count(conn_list) + 1;
+			xrecalloc(pfds, max_fds, sizeof(*pfds));
+			xrecalloc(map, max_fds, sizeof(*map));
+		}
+
+		/* Run expired timers and collect the descriptors to watch */
+		now = _now_msec();
+		timeout = -1;
+		nfds = 0;
+		pfds[nfds].fd = wake_fd[0];
+		pfds[nfds].events = POLLIN;
+		nfds++;
+		itr = list_iterator_create(conn_list);
+		while ((conn = list_next(itr))) {
+			if ((conn->state != CONN_DONE) &&
+			    (conn->deadline <= now))
+				_conn_timer(conn, now);
+			if (conn->state == CONN_DONE) {
+				list_delete_item(itr);
+				continue;
+			}
+
+			if (conn->deadline <= now)
+				timeout = 0;
+			else if ((timeout < 0) ||
+				 ((conn->deadline - now) < timeout))
+				timeout = conn->deadline - now;
+
+			if (conn->state == CONN_WAIT)
+				continue;
+			pfds[nfds].fd = conn->fd;
+			pfds[nfds].events = (conn->state == CONN_RECV) ?
+					    POLLIN : POLLOUT;
+			pfds[nfds].revents = 0;
+			map[nfds] = conn;
+			nfds++;
+		}
+		list_iterator_destroy(itr);
+		/* Connections to other nodes of a failed branch start now */
+		if (list_count(spawn_list)) {
+			list_transfer(conn_list, spawn_list);
+			timeout = 0;
+		}
+
+		if (poll(pfds, nfds, timeout) < 0) {
+			if (errno != EINTR)
+				error("%s: poll: %m", __func__);
+			continue;
+		}
+
+		if (pfds[0].revents & POLLIN) {
+			while (read(wake_fd[0], buf, sizeof(buf)) > 0)
+				;
+		}
+
+		now = _now_msec();
+		for (i = 1; i < nfds; i++) {
+			if (pfds[i].revents)
+				_conn_event(map[i], now);
+		}
+		list_transfer(conn_list, spawn_list);
+	}
+
+	/* Nothing new is started once loop_shutdown is set */
+	list_for_each(conn_list, _abandon_conn, NULL);
+	FREE_NULL_LIST(conn_list);
+	FREE_NULL_LIST(spawn_list);
+	xfree(pfds);
+	xfree(map);
+
+	return NULL;
+}
+
+/* Call with loop_mutex locked */
+static void _start_loop(void)
+{
+	if (pipe(wake_fd))
+		fatal("%s: pipe: %m", __func__);
+	fd_set_nonblocking(wake_fd[0]);
+	fd_set_nonblocking(wake_fd[1]);
+	fd_set_close_on_exec(wake_fd[0]);
+	fd_set_close_on_exec(wake_fd[1]);
+
+	new_conns = list_create(_free_conn);
+	conn_list = list_create(_free_conn);
+	spawn_list = list_create(_free_conn);
+	slurm_thread_create(&loop_tid, _agent_loop, NULL);
+}
+
+extern void agent_loop_send(slurm_msg_t *msg, const char *nodelist,
+			    int timeout, agent_loop_done_t done, void *arg)
+{
+	loop_req_t *req = xmalloc(sizeof(*req));
+	hostlist_t hl, *sp_hl = NULL;
+	List conns;
+	char *name;
+	int i, hl_count = 0;
+
+	req->msg_type = msg->msg_type;
+	req->data = msg->data;
+	req->flags = msg->flags;
+	req->protocol_version = msg->protocol_version;
+	req->timeout = timeout ? timeout : (slurm_conf.msg_timeout * 1000);
+	req->ret_list = list_create(destroy_data_info);
+	req->done = done;
+	req->arg = arg;
+
+	hl = hostlist_create(nodelist);
+	hostlist_uniq(hl);
+
+	slurm_mutex_lock(&loop_mutex);
+	if (loop_shutdown) {
+		slurm_mutex_unlock(&loop_mutex);
+		while ((name = hostlist_shift(hl))) {
+			mark_as_failed_forward(
+				&req->ret_list, name,
+				SLURM_COMMUNICATIONS_CONNECTION_ERROR);
+			free(name);
+		}
+		hostlist_destroy(hl);
+		_req_done(req);
+		return;
+	}
+	if (!loop_tid)
+		_start_loop();
+	slurm_mutex_unlock(&loop_mutex);
+
+	conns = list_create(_free_conn);
+	if (route_g_split_hostlist(hl, &sp_hl, &hl_count,
+				   msg->forward.tree_width)) {
+		error("%s: unable to split forward hostlist", __func__);
+		while ((name = hostlist_shift(hl))) {
+			mark_as_failed_forward(
+				&req->ret_list, name,
+				SLURM_COMMUNICATIONS_CONNECTION_ERROR);
+			free(name);
+		}
+	}
+	for (i = 0; i < hl_count; i++)
+		_start_branch(req, sp_hl[i], conns);
+	xfree(sp_hl);
+	hostlist_destroy(hl);
+
+	if (!req->pending) {
+		FREE_NULL_LIST(conns);
+		_req_done(req);
+		return;
+	}
+
+	slurm_mutex_lock(&loop_mutex);
+	list_transfer(new_conns, conns);
+	_wake_loop();
+	slurm_mutex_unlock(&loop_mutex);
+	FREE_NULL_LIST(conns);
+}
+
+extern void agent_loop_fini(void)
+{
+	slurm_mutex_lock(&loop_mutex);
+	loop_shutdown = true;
+	if (!loop_tid) {
+		slurm_mutex_unlock(&loop_mutex);
+		return;
+	}
+	_wake_loop();
+	slurm_mutex_unlock(&loop_mutex);
+
+	pthread_join(loop_tid, NULL);
+
+	slurm_mutex_lock(&loop_mutex);
+	loop_tid = 0;
+	FREE_NULL_LIST(new_conns);
+	close(wake_fd[0]);
+	close(wake_fd[1]);
+	wake_fd[0] = wake_fd[1] = -1;
+	slurm_mutex_unlock(&loop_mutex);
+}
@@ -0,0 +1,66 @@
+/*****************************************************************************\
+ *  agent_loop.h - event driven transmission of agent RPCs
+ *****************************************************************************
+ *  This file is part of Slurm, a resource management program.
+ *  For details, see <https://slurm.schedmd.com/>.
+ *  Please also read the included file: DISCLAIMER.
+ *
+ *  Slurm is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 2 of the License, or (at your option)
+ *  any later version.
+ *
+ *  In addition, as a special exception, the copyright holders give permission
+ *  to link the code of portions of this program with the OpenSSL library under
+ *  certain conditions as described in each individual source file, and
+ *  distribute linked combinations including the two. You must obey the GNU
+ *  General Public License in all respects for all of the code used other than
+ *  OpenSSL. If you modify file(s) with this exception, you may extend this
+ *  exception to your version of the file(s), but you are not obligated to do
+ *  so. If you do not wish to do so, delete this exception statement from your
+ *  version.  If you delete this exception statement from all source files in
+ *  the program, then also delete it here.
+ *
+ *  Slurm is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with Slurm; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA.
+\*****************************************************************************/
+
+#ifndef _AGENT_LOOP_H
+#define _AGENT_LOOP_H
+
+#include "src/common/list.h"
+#include "src/common/slurm_protocol_defs.h"
+
+/*
+ * Called from the event loop thread once every node of a request has
+ * answered, failed or timed out. It must not block.
+ * IN ret_list - List of ret_data_info_t, one per node, owned by the callee
+ * IN arg - as passed to agent_loop_send()
+ */
+typedef void (*agent_loop_done_t)(List ret_list, void *arg);
+
+/*
+ * Send a message to every node in nodelist and collect the responses
+ * without a thread per node. The message is fanned out like
+ * slurm_send_recv_msgs(): each head of the tree forwards it to its branch.
+ * Connections, timeouts and the fall back to contacting the nodes of a
+ * failed branch directly are all handled by one thread.
+ * IN msg - message to send, msg->data must stay valid until done is called
+ * IN nodelist - nodes to send the message to
+ * IN timeout - how long to wait in milliseconds, 0 for MessageTimeout
+ * IN done - called with the responses
+ * IN arg - passed to done
+ */
+extern void agent_loop_send(slurm_msg_t *msg, const char *nodelist,
+			    int timeout, agent_loop_done_t done, void *arg);
+
+/* Fail any outstanding requests and stop the event loop thread */
+extern void agent_loop_fini(void);
+
+#endif /* !_AGENT_LOOP_H */
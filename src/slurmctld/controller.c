@@ -91,6 +91,7 @@
 #include "src/common/track_script.h"
 #include "src/common/uid.h"
 #include "src/common/xcgroup_read_config.h"
+#include "src/common/xmalloc.h"
 #include "src/common/xsignal.h"
 #include "src/common/xstring.h"
 
@@ -112,6 +113,7 @@
 #include "src/slurmctld/proc_req.h"
 #include "src/slurmctld/read_config.h"
 #include "src/slurmctld/reservation.h"
+#include "src/slurmctld/rpc_mgr.h"
 #include "src/slurmctld/rpc_queue.h"
 #include "src/slurmctld/sched_plugin.h"
 #include "src/slurmctld/slurmctld.h"
@@ -243,7 +245,7 @@ static void *       _purge_files_thread(void *no_data);
 static void         _remove_assoc(slurmdb_assoc_rec_t *rec);
 static void         _remove_qos(slurmdb_qos_rec_t *rec);
 static void         _run_primary_prog(bool primary_on);
-static void *       _service_connection(void *arg);
+static void         _set_malloc_params(void);
 static void         _set_work_dir(void);
 static int          _shutdown_backup_controller(void);
 static void *       _slurmctld_background(void *no_data);
@@ -258,7 +260,6 @@ static void         _update_nice(void);
 static void         _update_qos(slurmdb_qos_rec_t *rec);
 inline static void  _usage(char *prog_name);
 static bool         _verify_clustername(void);
-static bool         _wait_for_server_thread(void);
 static void *       _wait_primary_prog(void *arg);
 
 /* main - slurmctld main function, start various threads and process RPCs */
@@ -416,6 +417,7 @@ int main(int argc, char **argv)
 
 	test_core_limit();
 	_test_thread_limit();
+	_set_malloc_params();
 
 	/*
 	 * This must happen before we spawn any threads
@@ -881,6 +883,7 @@ int main(int argc, char **argv)
 
 	/* Purge our local data structures */
 	configless_clear();
+	dump_cache_clear();
 	xcgroup_fini_slurm_cgroup_conf();
 	power_save_fini();
 	job_fini();
@@ -1114,14 +1117,13 @@ static void _sig_handler(int signal)
 }
 
 /*
- * _slurmctld_rpc_mgr - Read incoming RPCs and create pthread for each
+ * _slurmctld_rpc_mgr - Read incoming RPCs and hand them to the RPC workers
  */
 static void *_slurmctld_rpc_mgr(void *no_data)
 {
-	int *newsockfd;
 	struct pollfd *fds;
-	slurm_addr_t cli_addr, srv_addr;
-	int fd_next = 0, i, nports;
+	slurm_addr_t srv_addr;
+	int i, nports;
 	/* Locks: Read config */
 	slurmctld_lock_t config_read_lock = {
 		READ_LOCK, NO_LOCK, NO_LOCK, NO_LOCK, NO_LOCK };
@@ -1177,45 +1179,7 @@ static void *_slurmctld_rpc_mgr(void *no_data)
 	/*
 	 * Process incoming RPCs until told to shutdown
 	 */
-	while (_wait_for_server_thread()) {
-		if (poll(fds, nports, -1) == -1) {
-			if (errno != EINTR)
-				error("slurm_accept_msg_conn poll: %m");
-			server_thread_decr();
-			continue;
-		}
-
-		/* find one to process */
-		for (i = 0; i < nports; i++) {
-			if (fds[(fd_next + i) % nports].revents) {
-				i = (fd_next + i) % nports;
-				break;
-			}
-		}
-		fd_next = (i + 1) % nports;
-
-		newsockfd = xmalloc(sizeof(*newsockfd));
-		if ((*newsockfd = slurm_accept_msg_conn(fds[i].fd, &cli_addr))
-		    == SLURM_ERROR) {
-			if (errno != EINTR)
-				error("slurm_accept_msg_conn: %m");
-			server_thread_decr();
-			xfree(newsockfd);
-			continue;
-		}
-		fd_set_close_on_exec(*newsockfd);
-
-		log_flag(PROTOCOL, "%s: accept() connection from %pA",
-			 __func__, &cli_addr);
-
-		if (slurmctld_config.shutdown_time) {
-			slurmctld_diag_stats.proc_req_raw++;
-			_service_connection(newsockfd);
-		} else {
-			slurm_thread_create_detached(NULL, _service_connection,
-						     newsockfd);
-		}
-	}
+	rpc_mgr_run(fds, nports, max_server_threads);
 
 	debug3("%s shutting down", __func__);
 	for (i = 0; i < nports; i++)
@@ -1229,99 +1193,6 @@ static void *_slurmctld_rpc_mgr(void *no_data)
 	return NULL;
 }
 
-/*
- * _service_connection - service the RPC
- * IN/OUT arg - really just the connection's file descriptor, freed
- *	upon completion
- * RET - NULL
- */
-static void *_service_connection(void *arg)
-{
-	int fd = *((int *) arg);
-	slurm_msg_t *msg = xmalloc(sizeof *msg);
-	xfree(arg);
-
-#if HAVE_SYS_PRCTL_H
-	if (prctl(PR_SET_NAME, "srvcn", NULL, NULL, NULL) < 0) {
-		error("%s: cannot set my name to %s %m", __func__, "srvcn");
-	}
-#endif
-	slurm_msg_t_init(msg);
-	msg->flags |= SLURM_MSG_KEEP_BUFFER;
-	/*
-	 * slurm_receive_msg sets msg connection fd to accepted fd. This allows
-	 * possibility for slurmctld_req() to close accepted connection.
-	 */
-	if (slurm_receive_msg(fd, msg, 0)) {
-		slurm_addr_t cli_addr;
-		(void) slurm_get_peer_addr(fd, &cli_addr);
-		error("slurm_receive_msg [%pA]: %m", &cli_addr);
-		/* close the new socket */
-		close(fd);
-		goto cleanup;
-	}
-
-	if (rpc_enqueue(msg)) {
-		server_thread_decr();
-		return NULL;
-	}
-
-	/* process the request */
-	slurmctld_req(msg);
-
-	if ((msg->conn_fd >= 0) && (close(msg->conn_fd) < 0))
-		error("close(%d): %m", msg->conn_fd);
-
-cleanup:
-	slurm_free_msg(msg);
-	server_thread_decr();
-
-	return NULL;
-}
-
-/* Increment slurmctld_config.server_thread_count and don't return
- * until its value is no larger than MAX_SERVER_THREADS,
- * RET true unless shutdown in progress */
-static bool _wait_for_server_thread(void)
-{
-	bool print_it = true;
-	bool rc = true;
-
-	slurm_mutex_lock(&slurmctld_config.thread_count_lock);
-	while (1) {
-		if (slurmctld_config.shutdown_time) {
-			rc = false;
-			break;
-		}
-		if (slurmctld_config.server_thread_count < max_server_threads) {
-			slurmctld_config.server_thread_count++;
-			break;
-		} else {
-			/* wait for state change and retry,
-			 * just a delay and not an error.
-			 * This can happen when the epilog completes
-			 * on a bunch of nodes at the same time, which
-			 * can easily happen for highly parallel jobs. */
-			if (print_it) {
-				static time_t last_print_time = 0;
-				time_t now = time(NULL);
-				if (difftime(now, last_print_time) > 2) {
-					verbose("server_thread_count over "
-						"limit (%d), waiting",
-						slurmctld_config.
-						server_thread_count);
-					last_print_time = now;
-				}
-				print_it = false;
-			}
-			slurm_cond_wait(&slurmctld_config.thread_count_cond,
-					&slurmctld_config.thread_count_lock);
-		}
-	}
-	slurm_mutex_unlock(&slurmctld_config.thread_count_lock);
-	return rc;
-}
-
 /* Decrement slurmctld thread count (as applies to thread limit) */
 extern void server_thread_decr(void)
 {
@@ -3309,6 +3180,33 @@ static void _test_thread_limit(void)
 	return;
 }
 
+/*
+ * Apply the malloc_arenas and xmalloc_profile SlurmctldParameters. Called
+ * before any threads are started, so each RPC thread is given its own arena
+ * when there are enough.
+ */
+static void _set_malloc_params(void)
+{
+	char *tmp_ptr;
+	int arenas;
+
+	if ((tmp_ptr = xstrcasestr(slurm_conf.slurmctld_params,
+				   "malloc_arenas="))) {
+		arenas = atoi(tmp_ptr + 14);
+		if (arenas < 1)
+			error("Invalid SlurmctldParameters malloc_arenas, ignored");
+		else if (xmalloc_set_arenas(arenas))
+			error("SlurmctldParameters malloc_arenas is not supported by this malloc");
+		else
+			debug("%s: malloc_arenas=%d", __func__, arenas);
+	}
+
+	if (xstrcasestr(slurm_conf.slurmctld_params, "xmalloc_profile")) {
+		info("Profiling allocations by call site");
+		xmalloc_profile_set(true);
+	}
+}
+
 static void  _set_work_dir(void)
 {
 	bool success = false;
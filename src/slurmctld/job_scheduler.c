@@ -107,7 +107,7 @@ typedef struct wait_boot_arg {
 
 static batch_job_launch_msg_t *_build_launch_job_msg(job_record_t *job_ptr,
 						     uint16_t protocol_version);
-static void	_job_queue_append(List job_queue, job_record_t *job_ptr,
+static void	_job_queue_append(vector_t *job_queue, job_record_t *job_ptr,
 				  part_record_t *part_ptr, uint32_t priority);
 static bool	_job_runnable_test1(job_record_t *job_ptr, bool clear_start);
 static bool	_job_runnable_test2(job_record_t *job_ptr, bool check_min_time);
@@ -223,7 +223,7 @@ static int _queue_resv_list(void *x, void *key)
 	return 0;
 }
 
-static void _job_queue_append(List job_queue, job_record_t *job_ptr,
+static void _job_queue_append(vector_t *job_queue, job_record_t *job_ptr,
 			      part_record_t *part_ptr, uint32_t prio)
 {
 	job_queue_req_t job_queue_req = { .job_ptr = job_ptr,
@@ -431,12 +431,12 @@ extern void job_queue_rec_resv_list(job_queue_rec_t *job_queue_rec)
  *		    true when called from sched/backfill or sched/builtin
  * IN backfill - true if running backfill scheduler, enforce min time limit
  * RET the job queue
- * NOTE: the caller must call FREE_NULL_LIST() on RET value to free memory
+ * NOTE: the caller must call FREE_NULL_VECTOR() on RET value to free memory
  */
-extern List build_job_queue(bool clear_start, bool backfill)
+extern vector_t *build_job_queue(bool clear_start, bool backfill)
 {
 	static time_t last_log_time = 0;
-	List job_queue;
+	vector_t *job_queue;
 	ListIterator depend_iter, job_iterator, part_iterator;
 	job_record_t *job_ptr = NULL, *new_job_ptr;
 	part_record_t *part_ptr;
@@ -449,7 +449,7 @@ extern List build_job_queue(bool clear_start, bool backfill)
 
 	/* init the timer */
 	(void) slurm_delta_tv(&start_tv);
-	job_queue = list_create(xfree_ptr);
+	job_queue = vector_create(xfree_ptr);
 
 	/*
 	 * Create individual job records for job arrays that need burst buffer
@@ -1002,13 +1002,13 @@ extern void job_queue_append_internal(job_queue_req_t *job_queue_req)
 	job_queue_rec->part_ptr = job_queue_req->part_ptr;
 	job_queue_rec->priority = job_queue_req->prio;
 	job_queue_rec->resv_ptr = job_queue_req->resv_ptr;
-	list_append(job_queue_req->job_queue, job_queue_rec);
+	vector_append(job_queue_req->job_queue, job_queue_rec);
 }
 
 static int _schedule(bool full_queue)
 {
 	ListIterator job_iterator = NULL, part_iterator = NULL;
-	List job_queue = NULL;
+	vector_t *job_queue = NULL;
 	int failed_part_cnt = 0, failed_resv_cnt = 0, job_cnt = 0;
 	int error_code, i, j, part_cnt, time_limit, pend_time;
 	uint32_t job_depth = 0, array_task_id;
@@ -1381,7 +1381,7 @@ static int _schedule(bool full_queue)
 		job_iterator = list_iterator_create(job_list);
 	} else {
 		job_queue = build_job_queue(false, false);
-		slurmctld_diag_stats.schedule_queue_len = list_count(job_queue);
+		slurmctld_diag_stats.schedule_queue_len = vector_count(job_queue);
 		sort_job_queue(job_queue);
 	}
 
@@ -1440,7 +1440,7 @@ next_part:
 					continue;
 			}
 		} else {
-			job_queue_rec = list_pop(job_queue);
+			job_queue_rec = vector_pop(job_queue);
 			if (!job_queue_rec)
 				break;
 			array_task_id = job_queue_rec->array_task_id;
@@ -1954,7 +1954,7 @@ fail_this_part:	if (fail_by_part) {
 		if (part_iterator)
 			list_iterator_destroy(part_iterator);
 	} else if (job_queue) {
-		FREE_NULL_LIST(job_queue);
+		FREE_NULL_VECTOR(job_queue);
 	}
 	xfree(sched_part_ptr);
 	xfree(sched_part_jobs);
@@ -1984,9 +1984,9 @@ out:
  * sort_job_queue - sort job_queue in descending priority order
  * IN/OUT job_queue - sorted job queue
  */
-extern void sort_job_queue(List job_queue)
+extern void sort_job_queue(vector_t *job_queue)
 {
-	list_sort(job_queue, sort_job_queue2);
+	vector_sort(job_queue, sort_job_queue2);
 }
 
 /* Note this differs from the ListCmpF typedef since we want jobs sorted
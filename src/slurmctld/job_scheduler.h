@@ -89,9 +89,9 @@ extern void job_queue_rec_resv_list(job_queue_rec_t *job_queue_rec);
  * IN clear_start - if set then clear the start_time for pending jobs
  * IN backfill - true if running backfill scheduler, enforce min time limit
  * RET the job queue
- * NOTE: the caller must call list_destroy() on RET value to free memory
+ * NOTE: the caller must call FREE_NULL_VECTOR() on RET value to free memory
  */
-extern List build_job_queue(bool clear_start, bool backfill);
+extern vector_t *build_job_queue(bool clear_start, bool backfill);
 
 /* Given a scheduled job, return a pointer to it batch_job_launch_msg_t data */
 extern batch_job_launch_msg_t *build_launch_job_msg(job_record_t *job_ptr,
@@ -238,7 +238,7 @@ extern void set_job_elig_time(void);
  * sort_job_queue - sort job_queue in decending priority order
  * IN/OUT job_queue - sorted job queue previously made by build_job_queue()
  */
-extern void sort_job_queue(List job_queue);
+extern void sort_job_queue(vector_t *job_queue);
 
 /* Note this differs from the ListCmpF typedef since we want jobs sorted
  *	in order of decreasing priority */
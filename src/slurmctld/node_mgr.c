@@ -3321,6 +3321,42 @@ void node_did_resp (char *name)
 	debug2("node_did_resp %s",name);
 }
 
+extern void nodes_did_resp(char *node_names)
+{
+	hostlist_t hl = hostlist_create(node_names);
+	int node_cnt = hostlist_count(hl), changed = 0;
+	char *name;
+#ifndef HAVE_FRONT_END
+	node_record_t *node_ptr;
+	time_t now = time(NULL);
+#endif
+
+	xassert(verify_lock(NODE_LOCK, WRITE_LOCK));
+
+	while ((name = hostlist_shift(hl))) {
+#ifndef HAVE_FRONT_END
+		node_ptr = find_node_record(name);
+		if (node_ptr && !IS_NODE_NO_RESPOND(node_ptr) &&
+		    !IS_NODE_POWER_UP(node_ptr) && !IS_NODE_UNKNOWN(node_ptr) &&
+		    !IS_NODE_DOWN(node_ptr) &&
+		    !waiting_for_node_boot(node_ptr) &&
+		    !waiting_for_node_power_down(node_ptr)) {
+			/* all that _node_did_resp() would change */
+			node_ptr->last_response = now;
+			free(name);
+			continue;
+		}
+#endif
+		node_did_resp(name);
+		changed++;
+		free(name);
+	}
+	hostlist_destroy(hl);
+
+	log_flag(AGENT, "%s: %d of %d nodes changed: %s",
+		 __func__, changed, node_cnt, node_names);
+}
+
 /*
  * node_not_resp - record that the specified node is not responding
  * IN name - name of the node
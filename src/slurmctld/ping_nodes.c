@@ -61,6 +61,23 @@ static pthread_mutex_t lock_mutex = PTHREAD_MUTEX_INITIALIZER;
 static int ping_count = 0;
 static time_t ping_start = 0;
 
+#ifndef HAVE_FRONT_END
+/*
+ * Return true if slurmctld already holds all that a registration of this
+ * node would tell it: the node registered since slurmctld started, runs no
+ * jobs to reconcile and has no state a registration would clear. Such a node
+ * may then answer with a bare return code if nothing changed on its side
+ * either, see SLURM_MSG_AGGREGATE.
+ */
+static bool _reg_current(node_record_t *node_ptr)
+{
+	return (node_ptr->boot_time && !node_ptr->run_job_cnt &&
+		!node_ptr->comp_job_cnt && !IS_NODE_UNKNOWN(node_ptr) &&
+		!IS_NODE_DOWN(node_ptr) && !IS_NODE_NO_RESPOND(node_ptr) &&
+		!IS_NODE_REBOOT(node_ptr));
+}
+#endif
+
 /*
  * is_ping_done - test if the last node ping cycle has completed.
  *	Use this to avoid starting a new set of ping requests before the
@@ -146,6 +163,7 @@ void ping_nodes (void)
 #ifdef HAVE_FRONT_END
 	front_end_record_t *front_end_ptr = NULL;
 #else
+	agent_arg_t *refresh_agent_args = NULL, *node_reg_args;
 	node_record_t *node_ptr = NULL;
 	time_t old_cpu_load_time = now - slurm_conf.slurmd_timeout;
 	time_t old_free_mem_time = now - slurm_conf.slurmd_timeout;
@@ -156,6 +174,7 @@ void ping_nodes (void)
 	ping_agent_args->retry = 0;
 	ping_agent_args->protocol_version = SLURM_PROTOCOL_VERSION;
 	ping_agent_args->hostlist = hostlist_create(NULL);
+	ping_agent_args->aggregate = true;
 
 	reg_agent_args = xmalloc (sizeof (agent_arg_t));
 	reg_agent_args->msg_type = REQUEST_NODE_REGISTRATION_STATUS;
@@ -163,6 +182,16 @@ void ping_nodes (void)
 	reg_agent_args->protocol_version = SLURM_PROTOCOL_VERSION;
 	reg_agent_args->hostlist = hostlist_create(NULL);
 
+#ifndef HAVE_FRONT_END
+	/* Periodic registrations of nodes slurmctld is up to date on */
+	refresh_agent_args = xmalloc(sizeof(agent_arg_t));
+	refresh_agent_args->msg_type = REQUEST_NODE_REGISTRATION_STATUS;
+	refresh_agent_args->retry = 0;
+	refresh_agent_args->protocol_version = SLURM_PROTOCOL_VERSION;
+	refresh_agent_args->hostlist = hostlist_create(NULL);
+	refresh_agent_args->aggregate = true;
+#endif
+
 	/*
 	 * If there are a large number of down nodes, the node ping
 	 * can take a long time to complete:
@@ -299,13 +328,17 @@ void ping_nodes (void)
 		 * can generate a flood of incoming RPCs. */
 		if (IS_NODE_UNKNOWN(node_ptr) || (node_ptr->boot_time == 0) ||
 		    ((i >= offset) && (i < (offset + max_reg_threads)))) {
-			if (reg_agent_args->protocol_version >
+			if (_reg_current(node_ptr))
+				node_reg_args = refresh_agent_args;
+			else
+				node_reg_args = reg_agent_args;
+			if (node_reg_args->protocol_version >
 			    node_ptr->protocol_version)
-				reg_agent_args->protocol_version =
+				node_reg_args->protocol_version =
 					node_ptr->protocol_version;
-			hostlist_push_host(reg_agent_args->hostlist,
+			hostlist_push_host(node_reg_args->hostlist,
 					   node_ptr->name);
-			reg_agent_args->node_count++;
+			node_reg_args->node_count++;
 			continue;
 		}
 
@@ -357,6 +390,22 @@ void ping_nodes (void)
 		agent_queue_request(reg_agent_args);
 	}
 
+#ifndef HAVE_FRONT_END
+	if (refresh_agent_args->node_count == 0) {
+		hostlist_destroy(refresh_agent_args->hostlist);
+		xfree(refresh_agent_args);
+	} else {
+		hostlist_uniq(refresh_agent_args->hostlist);
+		host_str = hostlist_ranged_string_xmalloc(
+				refresh_agent_args->hostlist);
+		debug("Spawning registration refresh agent for %s %d hosts",
+		      host_str, refresh_agent_args->node_count);
+		xfree(host_str);
+		ping_begin();
+		agent_queue_request(refresh_agent_args);
+	}
+#endif
+
 	if (down_hostlist) {
 		hostlist_uniq(down_hostlist);
 		host_str = hostlist_ranged_string_xmalloc(down_hostlist);
@@ -64,6 +64,7 @@
 #include "src/common/hostlist.h"
 #include "src/common/log.h"
 #include "src/common/macros.h"
+#include "src/common/msg_compress.h"
 #include "src/common/node_features.h"
 #include "src/common/node_select.h"
 #include "src/common/pack.h"
@@ -82,6 +83,7 @@
 #include "src/common/switch.h"
 #include "src/common/uid.h"
 #include "src/common/xcgroup_read_config.h"
+#include "src/common/xmalloc.h"
 #include "src/common/xstring.h"
 
 #include "src/slurmctld/acct_policy.h"
@@ -97,6 +99,8 @@
 #include "src/slurmctld/proc_req.h"
 #include "src/slurmctld/read_config.h"
 #include "src/slurmctld/reservation.h"
+#include "src/slurmctld/rpc_mgr.h"
+#include "src/slurmctld/rpc_queue.h"
 #include "src/slurmctld/sched_plugin.h"
 #include "src/slurmctld/slurmctld.h"
 #include "src/slurmctld/slurmctld_plugstack.h"
@@ -104,11 +108,14 @@
 #include "src/slurmctld/state_save.h"
 #include "src/slurmctld/trigger_mgr.h"
 
+#define XMALLOC_SITE_REPORT 50	/* call sites with most bytes reported */
+
 static pthread_mutex_t rpc_mutex = PTHREAD_MUTEX_INITIALIZER;
 #define RPC_TYPE_SIZE 100
 static uint16_t rpc_type_id[RPC_TYPE_SIZE] = { 0 };
 static uint32_t rpc_type_cnt[RPC_TYPE_SIZE] = { 0 };
 static uint64_t rpc_type_time[RPC_TYPE_SIZE] = { 0 };
+static uint32_t rpc_type_hist[RPC_TYPE_SIZE][RPC_HIST_SIZE];
 #define RPC_USER_SIZE 200
 static uint32_t rpc_user_id[RPC_USER_SIZE] = { 0 };
 static uint32_t rpc_user_cnt[RPC_USER_SIZE] = { 0 };
@@ -117,6 +124,33 @@ static uint64_t rpc_user_time[RPC_USER_SIZE] = { 0 };
 static config_response_msg_t *config_for_slurmd = NULL;
 static config_response_msg_t *config_for_clients = NULL;
 
+/*
+ * Packed body of a job or node information response, with its compressed
+ * form, kept to answer the same request from the same user again within
+ * the same second and before anything it was packed from is updated.
+ * Polling clients of a large cluster otherwise have slurmctld pack and
+ * compress identical responses many times over.
+ */
+typedef struct {
+	char *dump;
+	int dump_size;
+	buf_t *compressed;
+	int ref_cnt;		/* the cache holds one reference */
+	/* what dump was packed from */
+	time_t pack_time;
+	time_t last_job_update;
+	time_t last_node_update;
+	time_t last_part_update;
+	time_t last_conf_update;
+	uid_t uid;
+	uint16_t show_flags;
+	uint16_t protocol_version;
+} dump_cache_t;
+
+static pthread_mutex_t dump_cache_mutex = PTHREAD_MUTEX_INITIALIZER;
+static dump_cache_t *job_dump_cache = NULL;
+static dump_cache_t *node_dump_cache = NULL;
+
 static pthread_mutex_t throttle_mutex = PTHREAD_MUTEX_INITIALIZER;
 static pthread_cond_t throttle_cond = PTHREAD_COND_INITIALIZER;
 static pthread_cond_t  reconfig_cond = PTHREAD_COND_INITIALIZER;
@@ -163,6 +197,7 @@ extern void record_rpc_stats(slurm_msg_t *msg, long delta)
 			continue;
 		rpc_type_cnt[i]++;
 		rpc_type_time[i] += delta;
+		rpc_type_hist[i][rpc_hist_bucket(delta)]++;
 		break;
 	}
 	for (int i = 0; i < RPC_USER_SIZE; i++) {
@@ -719,6 +754,106 @@ extern void configless_clear(void)
 	xfree(config_for_clients);
 }
 
+static void _dump_cache_unref(dump_cache_t *entry)
+{
+	xassert(entry->ref_cnt > 0);
+	if (--entry->ref_cnt)
+		return;
+	xfree(entry->dump);
+	FREE_NULL_BUFFER(entry->compressed);
+	xfree(entry);
+}
+
+/*
+ * Fill in the key of a dump_cache_t for the request msg, while holding the
+ * locks its response is packed with
+ */
+static void _dump_cache_key(dump_cache_t *key, slurm_msg_t *msg,
+			    uint16_t show_flags)
+{
+	memset(key, 0, sizeof(*key));
+	key->pack_time = time(NULL);
+	key->last_job_update = last_job_update;
+	key->last_node_update = last_node_update;
+	key->last_part_update = last_part_update;
+	key->last_conf_update = slurm_conf.last_update;
+	key->uid = msg->auth_uid;
+	key->show_flags = show_flags;
+	key->protocol_version = msg->protocol_version;
+}
+
+/*
+ * Return a reference to the cached response matching key, to release with
+ * _dump_cache_unref(), or NULL
+ */
+static dump_cache_t *_dump_cache_get(dump_cache_t *cache, dump_cache_t *key)
+{
+	dump_cache_t *entry = NULL;
+
+	slurm_mutex_lock(&dump_cache_mutex);
+	if (cache &&
+	    (cache->pack_time == key->pack_time) &&
+	    (cache->last_job_update == key->last_job_update) &&
+	    (cache->last_node_update == key->last_node_update) &&
+	    (cache->last_part_update == key->last_part_update) &&
+	    (cache->last_conf_update == key->last_conf_update) &&
+	    (cache->uid == key->uid) &&
+	    (cache->show_flags == key->show_flags) &&
+	    (cache->protocol_version == key->protocol_version)) {
+		entry = cache;
+		entry->ref_cnt++;
+	}
+	slurm_mutex_unlock(&dump_cache_mutex);
+
+	return entry;
+}
+
+/*
+ * Cache the response dump packed for the request msg in place of *cache,
+ * and compress it for the peer.
+ * RET a reference to the new entry, to release with _dump_cache_unref()
+ */
+static dump_cache_t *_dump_cache_add(dump_cache_t **cache, dump_cache_t *key,
+				     char *dump, int dump_size,
+				     slurm_msg_t *msg)
+{
+	dump_cache_t *entry = xmalloc(sizeof(*entry));
+
+	*entry = *key;
+	entry->dump = dump;
+	entry->dump_size = dump_size;
+	entry->ref_cnt = 2;
+	if (msg->protocol_version >= SLURM_21_08_1_PROTOCOL_VERSION)
+		entry->compressed = msg_compress(dump, dump_size, msg->flags);
+
+	slurm_mutex_lock(&dump_cache_mutex);
+	if (*cache)
+		_dump_cache_unref(*cache);
+	*cache = entry;
+	slurm_mutex_unlock(&dump_cache_mutex);
+
+	return entry;
+}
+
+static void _dump_cache_release(dump_cache_t *entry)
+{
+	slurm_mutex_lock(&dump_cache_mutex);
+	_dump_cache_unref(entry);
+	slurm_mutex_unlock(&dump_cache_mutex);
+}
+
+extern void dump_cache_clear(void)
+{
+	slurm_mutex_lock(&dump_cache_mutex);
+	if (job_dump_cache)
+		_dump_cache_unref(job_dump_cache);
+	job_dump_cache = NULL;
+	if (node_dump_cache)
+		_dump_cache_unref(node_dump_cache);
+	node_dump_cache = NULL;
+	slurm_mutex_unlock(&dump_cache_mutex);
+}
+
 /* _kill_job_on_msg_fail - The request to create a job record successed,
  *	but the reply message to srun failed. We kill the job to avoid
  *	leaving it orphaned */
@@ -1476,8 +1611,9 @@ static void _slurm_rpc_dump_conf(slurm_msg_t * msg)
 static void _slurm_rpc_dump_jobs(slurm_msg_t * msg)
 {
 	DEF_TIMERS;
-	char *dump;
-	int dump_size;
+	char *dump = NULL;
+	int dump_size = 0;
+	dump_cache_t key, *cache = NULL;
 	slurm_msg_t response_msg;
 	job_info_request_msg_t *job_info_request_msg =
 		(job_info_request_msg_t *) msg->data;
@@ -1502,10 +1638,13 @@ static void _slurm_rpc_dump_jobs(slurm_msg_t * msg)
 				       msg->auth_uid, NO_VAL,
 				       msg->protocol_version);
 		} else {
-			pack_all_jobs(&dump, &dump_size,
-				      job_info_request_msg->show_flags,
-				      msg->auth_uid, NO_VAL,
-				      msg->protocol_version);
+			_dump_cache_key(&key, msg,
+					job_info_request_msg->show_flags);
+			if (!(cache = _dump_cache_get(job_dump_cache, &key)))
+				pack_all_jobs(&dump, &dump_size,
+					      job_info_request_msg->show_flags,
+					      msg->auth_uid, NO_VAL,
+					      msg->protocol_version);
 		}
 		if (!(msg->flags & CTLD_QUEUE_PROCESSING))
 			unlock_slurmctld(job_read_lock);
@@ -1513,15 +1652,27 @@ static void _slurm_rpc_dump_jobs(slurm_msg_t * msg)
 #if 0
 		info("_slurm_rpc_dump_jobs, size=%d %s", dump_size, TIME_STR);
 #endif
+		if (!job_info_request_msg->job_ids && !cache)
+			cache = _dump_cache_add(&job_dump_cache, &key, dump,
+						dump_size, msg);
 
 		response_init(&response_msg, msg);
 		response_msg.msg_type = RESPONSE_JOB_INFO;
-		response_msg.data = dump;
-		response_msg.data_size = dump_size;
+		if (cache) {
+			response_msg.data = cache->dump;
+			response_msg.data_size = cache->dump_size;
+			response_msg.data_compressed = cache->compressed;
+		} else {
+			response_msg.data = dump;
+			response_msg.data_size = dump_size;
+		}
 
 		/* send message */
 		slurm_send_node_msg(msg->conn_fd, &response_msg);
-		xfree(dump);
+		if (cache)
+			_dump_cache_release(cache);
+		else
+			xfree(dump);
 	}
 }
 
@@ -1654,9 +1805,11 @@ static void _slurm_rpc_end_time(slurm_msg_t * msg)
 		NO_LOCK, READ_LOCK, NO_LOCK, NO_LOCK, NO_LOCK };
 
 	START_TIMER;
-	lock_slurmctld(job_read_lock);
+	if (!(msg->flags & CTLD_QUEUE_PROCESSING))
+		lock_slurmctld(job_read_lock);
 	rc = job_end_time(time_req_msg, &timeout_msg);
-	unlock_slurmctld(job_read_lock);
+	if (!(msg->flags & CTLD_QUEUE_PROCESSING))
+		unlock_slurmctld(job_read_lock);
 	END_TIMER2("_slurm_rpc_end_time");
 
 	if (rc != SLURM_SUCCESS) {
@@ -1740,8 +1893,9 @@ static void _slurm_rpc_dump_front_end(slurm_msg_t * msg)
 static void _slurm_rpc_dump_nodes(slurm_msg_t * msg)
 {
 	DEF_TIMERS;
-	char *dump;
-	int dump_size;
+	char *dump = NULL;
+	int dump_size = 0;
+	dump_cache_t key, *cache;
 	slurm_msg_t response_msg;
 	node_info_request_msg_t *node_req_msg =
 		(node_info_request_msg_t *) msg->data;
@@ -1770,23 +1924,30 @@ static void _slurm_rpc_dump_nodes(slurm_msg_t * msg)
 		debug3("_slurm_rpc_dump_nodes, no change");
 		slurm_send_rc_msg(msg, SLURM_NO_CHANGE_IN_DATA);
 	} else {
-		pack_all_node(&dump, &dump_size, node_req_msg->show_flags,
-			      msg->auth_uid, msg->protocol_version);
+		_dump_cache_key(&key, msg, node_req_msg->show_flags);
+		if (!(cache = _dump_cache_get(node_dump_cache, &key)))
+			pack_all_node(&dump, &dump_size,
+				      node_req_msg->show_flags,
+				      msg->auth_uid, msg->protocol_version);
 		if (!(msg->flags & CTLD_QUEUE_PROCESSING))
 			unlock_slurmctld(node_write_lock);
 		END_TIMER2("_slurm_rpc_dump_nodes");
 #if 0
 		info("_slurm_rpc_dump_nodes, size=%d %s", dump_size, TIME_STR);
 #endif
+		if (!cache)
+			cache = _dump_cache_add(&node_dump_cache, &key, dump,
+						dump_size, msg);
 
 		response_init(&response_msg, msg);
 		response_msg.msg_type = RESPONSE_NODE_INFO;
-		response_msg.data = dump;
-		response_msg.data_size = dump_size;
+		response_msg.data = cache->dump;
+		response_msg.data_size = cache->dump_size;
+		response_msg.data_compressed = cache->compressed;
 
 		/* send message */
 		slurm_send_node_msg(msg->conn_fd, &response_msg);
-		xfree(dump);
+		_dump_cache_release(cache);
 	}
 }
 
@@ -1812,7 +1973,8 @@ static void _slurm_rpc_dump_node_single(slurm_msg_t * msg)
 		return;
 	}
 
-	lock_slurmctld(node_write_lock);
+	if (!(msg->flags & CTLD_QUEUE_PROCESSING))
+		lock_slurmctld(node_write_lock);
 
 #if 0
 	/* This function updates each node's alloc_cpus count and too slow for
@@ -1822,7 +1984,8 @@ static void _slurm_rpc_dump_node_single(slurm_msg_t * msg)
 	pack_one_node(&dump, &dump_size, node_req_msg->show_flags,
 		      msg->auth_uid, node_req_msg->node_name,
 		      msg->protocol_version);
-	unlock_slurmctld(node_write_lock);
+	if (!(msg->flags & CTLD_QUEUE_PROCESSING))
+		unlock_slurmctld(node_write_lock);
 	END_TIMER2("_slurm_rpc_dump_node_single");
 #if 0
 	info("_slurm_rpc_dump_node_single, name=%s size=%d %s",
@@ -2474,10 +2637,12 @@ static void _slurm_rpc_job_step_get_info(slurm_msg_t * msg)
 		READ_LOCK, READ_LOCK, NO_LOCK, READ_LOCK, NO_LOCK };
 
 	START_TIMER;
-	lock_slurmctld(job_read_lock);
+	if (!(msg->flags & CTLD_QUEUE_PROCESSING))
+		lock_slurmctld(job_read_lock);
 
 	if ((request->last_update - 1) >= last_job_update) {
-		unlock_slurmctld(job_read_lock);
+		if (!(msg->flags & CTLD_QUEUE_PROCESSING))
+			unlock_slurmctld(job_read_lock);
 		log_flag(STEPS, "%s: no change", __func__);
 		error_code = SLURM_NO_CHANGE_IN_DATA;
 	} else {
@@ -2486,7 +2651,8 @@ static void _slurm_rpc_job_step_get_info(slurm_msg_t * msg)
 			request->step_id.job_id, request->step_id.step_id,
 			msg->auth_uid, request->show_flags, buffer,
 			msg->protocol_version);
-		unlock_slurmctld(job_read_lock);
+		if (!(msg->flags & CTLD_QUEUE_PROCESSING))
+			unlock_slurmctld(job_read_lock);
 		END_TIMER2("_slurm_rpc_job_step_get_info");
 		if (error_code) {
 			/* job_id:step_id not found or otherwise *\
@@ -2826,14 +2992,16 @@ static void _slurm_rpc_job_alloc_info(slurm_msg_t * msg)
 		READ_LOCK, READ_LOCK, READ_LOCK, NO_LOCK, NO_LOCK };
 
 	START_TIMER;
-	lock_slurmctld(job_read_lock);
+	if (!(msg->flags & CTLD_QUEUE_PROCESSING))
+		lock_slurmctld(job_read_lock);
 	error_code = job_alloc_info(msg->auth_uid, job_info_msg->job_id,
 				    &job_ptr);
 	END_TIMER2("_slurm_rpc_job_alloc_info");
 
 	/* return result */
 	if (error_code || (job_ptr == NULL) || (job_ptr->job_resrcs == NULL)) {
-		unlock_slurmctld(job_read_lock);
+		if (!(msg->flags & CTLD_QUEUE_PROCESSING))
+			unlock_slurmctld(job_read_lock);
 		debug2("%s: JobId=%u, uid=%u: %s",
 		       __func__, job_info_msg->job_id, msg->auth_uid,
 		      slurm_strerror(error_code));
@@ -2845,7 +3013,8 @@ static void _slurm_rpc_job_alloc_info(slurm_msg_t * msg)
 		job_info_resp_msg = build_job_info_resp(job_ptr);
 		set_remote_working_response(job_info_resp_msg, job_ptr,
 					    job_info_msg->req_cluster);
-		unlock_slurmctld(job_read_lock);
+		if (!(msg->flags & CTLD_QUEUE_PROCESSING))
+			unlock_slurmctld(job_read_lock);
 
 		response_init(&response_msg, msg);
 		response_msg.msg_type = RESPONSE_JOB_ALLOCATION_INFO;
@@ -5332,10 +5501,52 @@ static void _clear_rpc_stats(void)
 	memset(rpc_type_cnt, 0, sizeof(rpc_type_cnt));
 	memset(rpc_type_id, 0, sizeof(rpc_type_id));
 	memset(rpc_type_time, 0, sizeof(rpc_type_time));
+	memset(rpc_type_hist, 0, sizeof(rpc_type_hist));
 	memset(rpc_user_cnt, 0, sizeof(rpc_user_cnt));
 	memset(rpc_user_id, 0, sizeof(rpc_user_id));
 	memset(rpc_user_time, 0, sizeof(rpc_user_time));
 	slurm_mutex_unlock(&rpc_mutex);
+
+	rpc_mgr_reset_stats();
+	rpc_queue_reset_stats();
+	msg_compress_reset_stats();
+	xmalloc_profile_reset();
+}
+
+/* Pack the call sites which allocated the most, if profiling allocations */
+static void _pack_xmalloc_stats(buf_t *buffer)
+{
+	xmalloc_site_t *sites = NULL;
+	uint32_t i, cnt;
+	char **names;
+	uint64_t *alloc_cnt, *alloc_bytes, *live_bytes;
+
+	cnt = MIN(xmalloc_profile_get(&sites), XMALLOC_SITE_REPORT);
+	names = xcalloc(cnt + 1, sizeof(char *));
+	alloc_cnt = xcalloc(cnt + 1, sizeof(uint64_t));
+	alloc_bytes = xcalloc(cnt + 1, sizeof(uint64_t));
+	live_bytes = xcalloc(cnt + 1, sizeof(uint64_t));
+	for (i = 0; i < cnt; i++) {
+		names[i] = xstrdup_printf("%s:%d", sites[i].file,
+					  sites[i].line);
+		alloc_cnt[i] = sites[i].alloc_cnt;
+		alloc_bytes[i] = sites[i].alloc_bytes;
+		live_bytes[i] = sites[i].live_bytes;
+	}
+
+	pack32(cnt, buffer);
+	packstr_array(names, cnt, buffer);
+	pack64_array(alloc_cnt, cnt, buffer);
+	pack64_array(alloc_bytes, cnt, buffer);
+	pack64_array(live_bytes, cnt, buffer);
+
+	for (i = 0; i < cnt; i++)
+		xfree(names[i]);
+	xfree(names);
+	xfree(alloc_cnt);
+	xfree(alloc_bytes);
+	xfree(live_bytes);
+	xfree(sites);
 }
 
 static void _pack_rpc_stats(int resp, char **buffer_ptr, int *buffer_size,
@@ -5348,7 +5559,39 @@ static void _pack_rpc_stats(int resp, char **buffer_ptr, int *buffer_size,
 	buffer = create_buf(*buffer_ptr, *buffer_size);
 	set_buf_offset(buffer, *buffer_size);
 
-	if (protocol_version >= SLURM_MIN_PROTOCOL_VERSION) {
+	if (protocol_version >= SLURM_21_08_1_PROTOCOL_VERSION) {
+		for (i = 0; i < RPC_TYPE_SIZE; i++) {
+			if (rpc_type_id[i] == 0)
+				break;
+		}
+		pack32(i, buffer);
+		pack16_array(rpc_type_id,   i, buffer);
+		pack32_array(rpc_type_cnt,  i, buffer);
+		pack64_array(rpc_type_time, i, buffer);
+
+		pack32_array((uint32_t *) rpc_hist_bound, RPC_HIST_SIZE,
+			     buffer);
+		pack32_array(&rpc_type_hist[0][0], i * RPC_HIST_SIZE, buffer);
+
+		for (i = 1; i < RPC_USER_SIZE; i++) {
+			if (rpc_user_id[i] == 0)
+				break;
+		}
+		pack32(i, buffer);
+		pack32_array(rpc_user_id,   i, buffer);
+		pack32_array(rpc_user_cnt,  i, buffer);
+		pack64_array(rpc_user_time, i, buffer);
+
+		agent_pack_pending_rpc_stats(buffer);
+
+		rpc_mgr_pack_stats(buffer);
+
+		rpc_queue_pack_stats(buffer);
+
+		msg_compress_pack_stats(buffer);
+
+		_pack_xmalloc_stats(buffer);
+	} else if (protocol_version >= SLURM_MIN_PROTOCOL_VERSION) {
 		for (i = 0; i < RPC_TYPE_SIZE; i++) {
 			if (rpc_type_id[i] == 0)
 				break;
@@ -6132,6 +6375,10 @@ slurmctld_rpc_t slurmctld_rpcs[] =
 	},{
 		.msg_type = REQUEST_JOB_END_TIME,
 		.func = _slurm_rpc_end_time,
+		.queue_enabled = true,
+		.locks = {
+			.job = READ_LOCK,
+		},
 	},{
 		.msg_type = REQUEST_FED_INFO,
 		.func = _slurm_rpc_get_fed,
@@ -6154,6 +6401,12 @@ slurmctld_rpc_t slurmctld_rpcs[] =
 	},{
 		.msg_type = REQUEST_NODE_INFO_SINGLE,
 		.func = _slurm_rpc_dump_node_single,
+		.queue_enabled = true,
+		.locks = {
+			.conf = READ_LOCK,
+			.node = READ_LOCK,
+			.part = READ_LOCK,
+		},
 	},{
 		.msg_type = REQUEST_PARTITION_INFO,
 		.func = _slurm_rpc_dump_partitions,
@@ -6198,6 +6451,12 @@ slurmctld_rpc_t slurmctld_rpcs[] =
 	},{
 		.msg_type = REQUEST_JOB_STEP_INFO,
 		.func = _slurm_rpc_job_step_get_info,
+		.queue_enabled = true,
+		.locks = {
+			.conf = READ_LOCK,
+			.job = READ_LOCK,
+			.part = READ_LOCK,
+		},
 	},{
 		.msg_type = REQUEST_JOB_WILL_RUN,
 		.func = _slurm_rpc_job_will_run,
@@ -6223,6 +6482,12 @@ slurmctld_rpc_t slurmctld_rpcs[] =
 	},{
 		.msg_type = REQUEST_JOB_ALLOCATION_INFO,
 		.func = _slurm_rpc_job_alloc_info,
+		.queue_enabled = true,
+		.locks = {
+			.conf = READ_LOCK,
+			.job = READ_LOCK,
+			.node = READ_LOCK,
+		},
 	},{
 		.msg_type = REQUEST_HET_JOB_ALLOC_INFO,
 		.func = _slurm_rpc_het_job_alloc_info,
@@ -56,11 +56,23 @@ typedef struct {
 	bool queue_enabled;
 	bool shutdown;
 
-	pthread_t thread;
+	/*
+	 * Queue tunables, may be overridden through SlurmctldParameters.
+	 * Zero selects the default.
+	 */
+	uint16_t max_workers;	/* >1 only with a read-only lock set */
+	uint32_t max_per_cycle;	/* RPCs processed per lock acquisition */
+	uint32_t batch_window;	/* usec to let RPCs accumulate */
+
+	pthread_t *threads;
 	pthread_cond_t cond;
 	pthread_mutex_t mutex;
 
 	List work;
+
+	/* Queue statistics, protected by mutex */
+	uint32_t processed;	/* RPCs processed */
+	uint32_t lock_cycles;	/* slurmctld lock acquisitions */
 } slurmctld_rpc_t;
 
 extern slurmctld_rpc_t slurmctld_rpcs[];
@@ -0,0 +1,562 @@
+/*****************************************************************************\
+ *  rpc_mgr.c - event driven front end for incoming slurmctld RPCs
+ *****************************************************************************
+ *  This file is part of Slurm, a resource management program.
+ *  For details, see <https://slurm.schedmd.com/>.
+ *  Please also read the included file: DISCLAIMER.
+ *
+ *  Slurm is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 2 of the License, or (at your option)
+ *  any later version.
+ *
+ *  In addition, as a special exception, the copyright holders give permission
+ *  to link the code of portions of this program with the OpenSSL library under
+ *  certain conditions as described in each individual source file, and
+ *  distribute linked combinations including the two. You must obey the GNU
+ *  General Public License in all respects for all of the code used other than
+ *  OpenSSL. If you modify file(s) with this exception, you may extend this
+ *  exception to your version of the file(s), but you are not obligated to do
+ *  so. If you do not wish to do so, delete this exception statement from your
+ *  version.  If you delete this exception statement from all source files in
+ *  the program, then also delete it here.
+ *
+ *  Slurm is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with Slurm; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA.
+\*****************************************************************************/
+
+#include "config.h"
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <poll.h>
+#include <pthread.h>
+#include <signal.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#if HAVE_SYS_PRCTL_H
+#include <sys/prctl.h>
+#endif
+
+#include "src/common/fd.h"
+#include "src/common/list.h"
+#include "src/common/log.h"
+#include "src/common/macros.h"
+#include "src/common/read_config.h"
+#include "src/common/slurm_protocol_api.h"
+#include "src/common/xmalloc.h"
+#include "src/common/xsignal.h"
+#include "src/common/xstring.h"
+
+#include "src/slurmctld/slurmctld.h"
+#include "src/slurmctld/locks.h"
+#include "src/slurmctld/proc_req.h"
+#include "src/slurmctld/rpc_mgr.h"
+#include "src/slurmctld/rpc_queue.h"
+
+#define DEFAULT_RPC_WORKERS 64
+/* Same limit as slurm_msg_recvfrom_timeout() */
+#define MAX_MSG_SIZE (1024 * 1024 * 1024)
+/* How often to look for connections that stopped sending, in msec */
+#define POLL_TIMEOUT 1000
+
+const uint32_t rpc_hist_bound[RPC_HIST_SIZE] = {
+	100, 1000, 10000, 100000, 1000000, INFINITE
+};
+
+/* A connection whose RPC is still being read */
+typedef struct {
+	int fd;
+	slurm_addr_t addr;
+	time_t start;		/* when accepted */
+	uint32_t msglen;	/* message length from the header */
+	uint32_t hdr_read;	/* bytes of msglen read so far */
+	char *data;
+	uint32_t data_read;
+} rpc_conn_t;
+
+/* An RPC read in full, waiting for a worker */
+typedef struct {
+	int fd;
+	buf_t *buffer;
+	struct timeval queued;
+} rpc_work_t;
+
+static pthread_mutex_t work_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t work_cond = PTHREAD_COND_INITIALIZER;
+static List work_list = NULL;		/* rpc_work_t waiting for a worker */
+static bool work_shutdown = false;
+static bool accept_paused = false;	/* max_rpcs reached, wake when done */
+static pthread_t *worker_tids = NULL;
+static int worker_cnt = 0;
+static int wake_fd[2] = { -1, -1 };
+
+/* Statistics, protected by work_mutex */
+static uint32_t conn_cnt = 0;
+static uint32_t pending_max = 0;
+static uint32_t pending_hist[RPC_HIST_SIZE];
+
+extern int rpc_hist_bucket(uint64_t usec)
+{
+	int i;
+
+	for (i = 0; i < (RPC_HIST_SIZE - 1); i++) {
+		if (usec < rpc_hist_bound[i])
+			break;
+	}
+
+	return i;
+}
+
+static void _free_conn(void *x)
+{
+	rpc_conn_t *conn = x;
+
+	if (!conn)
+		return;
+
+	if ((conn->fd >= 0) && (close(conn->fd) < 0))
+		error("close(%d): %m", conn->fd);
+	xfree(conn->data);
+	xfree(conn);
+}
+
+/*
+ * Drop an RPC read but never processed, at shutdown. The client is told the
+ * controller is in standby mode so it retries, with the backup controller
+ * if there is one, rather than failing on a closed connection.
+ */
+static void _free_work(void *x)
+{
+	rpc_work_t *work = x;
+	slurm_msg_t msg;
+
+	if (!work)
+		return;
+
+	slurm_msg_t_init(&msg);
+	msg.conn_fd = work->fd;
+	if (!slurm_unpack_received_msg(&msg, work->fd, work->buffer))
+		(void) slurm_send_rc_msg(&msg, ESLURM_IN_STANDBY_MODE);
+	msg.buffer = work->buffer;
+	slurm_free_msg_members(&msg);
+
+	if (close(work->fd) < 0)
+		error("close(%d): %m", work->fd);
+	xfree(work);
+	server_thread_decr();
+}
+
+static void _wake_rpc_mgr(void)
+{
+	char c = 0;
+
+	if ((write(wake_fd[1], &c, 1) < 0) && (errno != EAGAIN))
+		error("%s: write: %m", __func__);
+}
+
+/*
+ * Read as much of the RPC as is available without blocking.
+ * RET 1 once the whole message is read, 0 if more is needed or -1 if the
+ * connection should be closed
+ */
+static int _read_conn(rpc_conn_t *conn)
+{
+	char *ptr;
+	size_t len;
+	ssize_t rc;
+
+	while (conn->data_read < conn->msglen ||
+	       conn->hdr_read < sizeof(conn->msglen)) {
+		if (conn->hdr_read < sizeof(conn->msglen)) {
+			ptr = ((char *) &conn->msglen) + conn->hdr_read;
+			len = sizeof(conn->msglen) - conn->hdr_read;
+		} else {
+			ptr = conn->data + conn->data_read;
+			len = conn->msglen - conn->data_read;
+		}
+
+		if ((rc = read(conn->fd, ptr, len)) < 0) {
+			if (errno == EINTR)
+				continue;
+			if ((errno == EAGAIN) || (errno == EWOULDBLOCK))
+				return 0;
+			error("%s: read from %pA: %m", __func__, &conn->addr);
+			return -1;
+		} else if (!rc) {
+			log_flag(NET, "%s: connection from %pA closed before the message was read",
+				 __func__, &conn->addr);
+			return -1;
+		}
+
+		if (conn->hdr_read < sizeof(conn->msglen)) {
+			conn->hdr_read += rc;
+			if (conn->hdr_read < sizeof(conn->msglen))
+				continue;
+			conn->msglen = ntohl(conn->msglen);
+			if (!conn->msglen || (conn->msglen > MAX_MSG_SIZE)) {
+				error("%s: %s from %pA", __func__,
+				      slurm_strerror(
+					      SLURM_PROTOCOL_INSANE_MSG_LENGTH),
+				      &conn->addr);
+				return -1;
+			}
+			conn->data = xmalloc_nz(conn->msglen);
+		} else {
+			conn->data_read += rc;
+		}
+	}
+
+	return 1;
+}
+
+/* Hand a fully read RPC over to the workers */
+static void _queue_work(rpc_conn_t *conn)
+{
+	rpc_work_t *work = xmalloc(sizeof(*work));
+
+	log_flag_hex(NET_RAW, conn->data, conn->msglen, "%s: read", __func__);
+
+	/* Replies are written by the worker */
+	fd_set_blocking(conn->fd);
+	work->fd = conn->fd;
+	work->buffer = create_buf(conn->data, conn->msglen);
+	gettimeofday(&work->queued, NULL);
+	conn->fd = -1;
+	conn->data = NULL;
+
+	server_thread_incr();
+
+	slurm_mutex_lock(&work_mutex);
+	list_enqueue(work_list, work);
+	if (list_count(work_list) > pending_max)
+		pending_max = list_count(work_list);
+	slurm_cond_signal(&work_cond);
+	slurm_mutex_unlock(&work_mutex);
+}
+
+static void _service_work(rpc_work_t *work)
+{
+	slurm_msg_t *msg = xmalloc(sizeof(*msg));
+
+	slurm_msg_t_init(msg);
+	/*
+	 * Set the msg connection fd to the accepted fd. This allows
+	 * possibility for slurmctld_req() to close accepted connection.
+	 */
+	msg->conn_fd = work->fd;
+	if (slurm_unpack_received_msg(msg, work->fd, work->buffer)) {
+		slurm_addr_t cli_addr;
+		(void) slurm_get_peer_addr(work->fd, &cli_addr);
+		error("slurm_receive_msg [%pA]: %m", &cli_addr);
+		if (close(work->fd) < 0)
+			error("close(%d): %m", work->fd);
+		free_buf(work->buffer);
+		slurm_free_msg(msg);
+		return;
+	}
+	msg->buffer = work->buffer;
+
+	if (rpc_enqueue(msg))
+		return;
+
+	/* process the request */
+	slurmctld_req(msg);
+
+	if ((msg->conn_fd >= 0) && (close(msg->conn_fd) < 0))
+		error("close(%d): %m", msg->conn_fd);
+
+	slurm_free_msg(msg);
+}
+
+static void *_rpc_worker(void *no_data)
+{
+	rpc_work_t *work;
+	struct timeval now;
+	uint64_t wait_usec;
+	int sigarray[] = {SIGUSR1, 0};
+
+#if HAVE_SYS_PRCTL_H
+	if (prctl(PR_SET_NAME, "rpcwrk", NULL, NULL, NULL) < 0) {
+		error("%s: cannot set my name to %s %m", __func__, "rpcwrk");
+	}
+#endif
+	/* SIGUSR1 only interrupts poll() in the rpc_mgr thread */
+	xsignal_block(sigarray);
+
+	while (true) {
+		slurm_mutex_lock(&work_mutex);
+		while (!work_shutdown && !list_count(work_list))
+			slurm_cond_wait(&work_cond, &work_mutex);
+		if (work_shutdown) {
+			slurm_mutex_unlock(&work_mutex);
+			break;
+		}
+		work = list_dequeue(work_list);
+		gettimeofday(&now, NULL);
+		wait_usec = (now.tv_sec - work->queued.tv_sec) * USEC_IN_SEC +
+			    (now.tv_usec - work->queued.tv_usec);
+		pending_hist[rpc_hist_bucket(wait_usec)]++;
+		slurm_mutex_unlock(&work_mutex);
+
+		_service_work(work);
+		xfree(work);
+		server_thread_decr();
+
+		slurm_mutex_lock(&work_mutex);
+		if (accept_paused) {
+			accept_paused = false;
+			_wake_rpc_mgr();
+		}
+		slurm_mutex_unlock(&work_mutex);
+	}
+
+	return NULL;
+}
+
+static void _start_workers(uint32_t max_rpcs)
+{
+	/* Locks: Read config */
+	slurmctld_lock_t config_read_lock = {
+		READ_LOCK, NO_LOCK, NO_LOCK, NO_LOCK, NO_LOCK };
+	char *tmp_ptr;
+	int i;
+
+	worker_cnt = DEFAULT_RPC_WORKERS;
+	lock_slurmctld(config_read_lock);
+	if ((tmp_ptr = xstrcasestr(slurm_conf.slurmctld_params,
+				   "rpc_workers="))) {
+		worker_cnt = atoi(tmp_ptr + 12);
+		if (worker_cnt < 1) {
+			error("Invalid SlurmctldParameters rpc_workers, using %d",
+			      DEFAULT_RPC_WORKERS);
+			worker_cnt = DEFAULT_RPC_WORKERS;
+		}
+	}
+	unlock_slurmctld(config_read_lock);
+	worker_cnt = MIN(worker_cnt, max_rpcs);
+	debug("%s: starting %d RPC worker threads", __func__, worker_cnt);
+
+	if (pipe(wake_fd))
+		fatal("%s: pipe: %m", __func__);
+	fd_set_nonblocking(wake_fd[0]);
+	fd_set_nonblocking(wake_fd[1]);
+	fd_set_close_on_exec(wake_fd[0]);
+	fd_set_close_on_exec(wake_fd[1]);
+
+	work_list = list_create(_free_work);
+	work_shutdown = false;
+	accept_paused = false;
+
+	worker_tids = xcalloc(worker_cnt, sizeof(pthread_t));
+	for (i = 0; i < worker_cnt; i++)
+		slurm_thread_create(&worker_tids[i], _rpc_worker, NULL);
+}
+
+static void _stop_workers(void)
+{
+	List tmp_list;
+	int i;
+
+	slurm_mutex_lock(&work_mutex);
+	work_shutdown = true;
+	slurm_cond_broadcast(&work_cond);
+	slurm_mutex_unlock(&work_mutex);
+
+	/* RPCs already being processed are finished, queued ones refused */
+	for (i = 0; i < worker_cnt; i++)
+		pthread_join(worker_tids[i], NULL);
+	xfree(worker_tids);
+
+	slurm_mutex_lock(&work_mutex);
+	tmp_list = work_list;
+	work_list = NULL;
+	worker_cnt = 0;
+	conn_cnt = 0;
+	slurm_mutex_unlock(&work_mutex);
+	FREE_NULL_LIST(tmp_list);
+
+	close(wake_fd[0]);
+	close(wake_fd[1]);
+	wake_fd[0] = wake_fd[1] = -1;
+}
+
+/* RET true if another connection may be accepted */
+static bool _can_accept(uint32_t max_rpcs)
+{
+	static time_t last_print_time = 0;
+	bool rc;
+
+	slurm_mutex_lock(&slurmctld_config.thread_count_lock);
+	rc = ((slurmctld_config.server_thread_count + conn_cnt) < max_rpcs);
+	slurm_mutex_unlock(&slurmctld_config.thread_count_lock);
+
+	if (!rc) {
+		/*
+		 * Just a delay and not an error. This can happen when the
+		 * epilog completes on a bunch of nodes at the same time,
+		 * which can easily happen for highly parallel jobs.
+		 */
+		time_t now = time(NULL);
+		if (difftime(now, last_print_time) > 2) {
+			verbose("server_thread_count over limit (%u), waiting",
+				max_rpcs);
+			last_print_time = now;
+		}
+	}
+
+	slurm_mutex_lock(&work_mutex);
+	accept_paused = !rc;
+	slurm_mutex_unlock(&work_mutex);
+
+	return rc;
+}
+
+static void _accept_conn(int listen_fd, List conn_list)
+{
+	rpc_conn_t *conn;
+	slurm_addr_t cli_addr;
+	int fd;
+
+	if ((fd = slurm_accept_msg_conn(listen_fd, &cli_addr)) ==
+	    SLURM_ERROR) {
+		if ((errno != EINTR) && (errno != EAGAIN) &&
+		    (errno != EWOULDBLOCK))
+			error("slurm_accept_msg_conn: %m");
+		return;
+	}
+	fd_set_close_on_exec(fd);
+	fd_set_nonblocking(fd);
+
+	log_flag(PROTOCOL, "%s: accept() connection from %pA",
+		 __func__, &cli_addr);
+
+	conn = xmalloc(sizeof(*conn));
+	conn->fd = fd;
+	conn->addr = cli_addr;
+	conn->start = time(NULL);
+	list_append(conn_list, conn);
+}
+
+static int _find_stale_conn(void *x, void *arg)
+{
+	rpc_conn_t *conn = x;
+	time_t *cutoff = arg;
+
+	if (conn->start >= *cutoff)
+		return 0;
+
+	error("%s: timed out reading message from %pA", __func__, &conn->addr);
+	return 1;
+}
+
+extern void rpc_mgr_run(struct pollfd *listen_fds, int nports,
+			uint32_t max_rpcs)
+{
+	List conn_list = list_create(_free_conn);
+	rpc_conn_t *conn, **poll_conns = NULL;
+	struct pollfd *ufds = NULL;
+	ListIterator itr;
+	int i, nfds, max_fds = 0, rc;
+	time_t cutoff;
+	bool accepting;
+	char buf[64];
+
+	_start_workers(max_rpcs);
+
+	/* Never block in accept() if the client already went away */
+	for (i = 0; i < nports; i++)
+		fd_set_nonblocking(listen_fds[i].fd);
+
+	while (!slurmctld_config.shutdown_time) {
+		accepting = _can_accept(max_rpcs);
+
+		nfds = 1 + nports + list_count(conn_list);
+		if (nfds > max_fds) {
+			max_fds = nfds * 2;
+			xrecalloc(ufds, max_fds, sizeof(*ufds));
+			xrecalloc(poll_conns, max_fds, sizeof(*poll_conns));
+		}
+
+		ufds[0].fd = wake_fd[0];
+		ufds[0].events = POLLIN;
+		for (i = 0; i < nports; i++) {
+			/* poll() ignores negative fds */
+			ufds[1 + i].fd = accepting ? listen_fds[i].fd : -1;
+			ufds[1 + i].events = POLLIN;
+		}
+		nfds = 1 + nports;
+		itr = list_iterator_create(conn_list);
+		while ((conn = list_next(itr))) {
+			ufds[nfds].fd = conn->fd;
+			ufds[nfds].events = POLLIN;
+			poll_conns[nfds++] = conn;
+		}
+		list_iterator_destroy(itr);
+
+		if (poll(ufds, nfds, POLL_TIMEOUT) == -1) {
+			if (errno != EINTR)
+				error("%s: poll: %m", __func__);
+			continue;
+		}
+
+		if (ufds[0].revents & POLLIN) {
+			while (read(wake_fd[0], buf, sizeof(buf)) > 0)
+				;
+		}
+
+		for (i = 1 + nports; i < nfds; i++) {
+			if (!ufds[i].revents)
+				continue;
+			conn = poll_conns[i];
+			if ((rc = _read_conn(conn)) > 0)
+				_queue_work(conn);
+			if (rc)
+				list_delete_ptr(conn_list, conn);
+		}
+
+		for (i = 0; i < nports; i++) {
+			if (ufds[1 + i].revents)
+				_accept_conn(listen_fds[i].fd, conn_list);
+		}
+
+		cutoff = time(NULL) - slurm_conf.msg_timeout;
+		list_delete_all(conn_list, _find_stale_conn, &cutoff);
+
+		slurm_mutex_lock(&work_mutex);
+		conn_cnt = list_count(conn_list);
+		slurm_mutex_unlock(&work_mutex);
+	}
+
+	FREE_NULL_LIST(conn_list);
+	xfree(ufds);
+	xfree(poll_conns);
+
+	_stop_workers();
+}
+
+extern void rpc_mgr_pack_stats(buf_t *buffer)
+{
+	slurm_mutex_lock(&work_mutex);
+	pack32(conn_cnt, buffer);
+	pack32(worker_cnt, buffer);
+	pack32(work_list ? list_count(work_list) : 0, buffer);
+	pack32(pending_max, buffer);
+	pack32_array(pending_hist, RPC_HIST_SIZE, buffer);
+	slurm_mutex_unlock(&work_mutex);
+}
+
+extern void rpc_mgr_reset_stats(void)
+{
+	slurm_mutex_lock(&work_mutex);
+	pending_max = 0;
+	memset(pending_hist, 0, sizeof(pending_hist));
+	slurm_mutex_unlock(&work_mutex);
+}
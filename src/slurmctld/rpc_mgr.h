@@ -0,0 +1,69 @@
+/*****************************************************************************\
+ *  rpc_mgr.h - event driven front end for incoming slurmctld RPCs
+ *****************************************************************************
+ *  This file is part of Slurm, a resource management program.
+ *  For details, see <https://slurm.schedmd.com/>.
+ *  Please also read the included file: DISCLAIMER.
+ *
+ *  Slurm is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 2 of the License, or (at your option)
+ *  any later version.
+ *
+ *  In addition, as a special exception, the copyright holders give permission
+ *  to link the code of portions of this program with the OpenSSL library under
+ *  certain conditions as described in each individual source file, and
+ *  distribute linked combinations including the two. You must obey the GNU
+ *  General Public License in all respects for all of the code used other than
+ *  OpenSSL. If you modify file(s) with this exception, you may extend this
+ *  exception to your version of the file(s), but you are not obligated to do
+ *  so. If you do not wish to do so, delete this exception statement from your
+ *  version.  If you delete this exception statement from all source files in
+ *  the program, then also delete it here.
+ *
+ *  Slurm is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with Slurm; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA.
+\*****************************************************************************/
+
+#ifndef _RPC_MGR_H_
+#define _RPC_MGR_H_
+
+#include <poll.h>
+
+#include "src/common/pack.h"
+
+/*
+ * Latency histogram buckets shared by the per message type statistics and
+ * the RPC queue wait statistics. Each bucket counts RPCs taking less than
+ * its bound in microseconds, the last bucket counts everything else.
+ */
+#define RPC_HIST_SIZE 6
+extern const uint32_t rpc_hist_bound[RPC_HIST_SIZE];
+
+/* Return the histogram bucket for a latency in microseconds */
+extern int rpc_hist_bucket(uint64_t usec);
+
+/*
+ * Accept connections on the listening sockets and read incoming RPCs
+ * without blocking, handing each fully read RPC to a pool of worker
+ * threads (SlurmctldParameters=rpc_workers). Returns on shutdown.
+ * IN listen_fds - listening sockets
+ * IN nports - count of listen_fds
+ * IN max_rpcs - maximum number of RPCs read or being processed at once
+ */
+extern void rpc_mgr_run(struct pollfd *listen_fds, int nports,
+			uint32_t max_rpcs);
+
+/* Pack the RPC queue statistics for sdiag */
+extern void rpc_mgr_pack_stats(buf_t *buffer);
+
+/* Reset the RPC queue statistics */
+extern void rpc_mgr_reset_stats(void);
+
+#endif
@@ -54,13 +54,22 @@
 #include "src/slurmctld/proc_req.h"
 #include "src/slurmctld/state_save.h"
 
+#define DEFAULT_BATCH_WINDOW 500	/* usec */
+
 bool enabled = true;
 
+static bool _read_only(slurmctld_lock_t locks)
+{
+	return ((locks.conf != WRITE_LOCK) && (locks.job != WRITE_LOCK) &&
+		(locks.node != WRITE_LOCK) && (locks.part != WRITE_LOCK) &&
+		(locks.fed != WRITE_LOCK));
+}
+
 static void *_rpc_queue_worker(void *arg)
 {
 	slurmctld_rpc_t *q = (slurmctld_rpc_t *) arg;
 	slurm_msg_t *msg;
-	int processed = 0;
+	uint32_t processed = 0;
 
 #if HAVE_SYS_PRCTL_H
 	char *name = xstrdup_printf("rpcq-%u", q->msg_type);
@@ -79,16 +88,19 @@ static void *_rpc_queue_worker(void *arg)
 	/*
 	 * Process as many queued messages as possible in one slurmctld_lock()
 	 * acquisition, then fall back to sleep until additional work is queued.
+	 * MaxPerCycle bounds the batch so queues holding write locks cannot
+	 * starve the other lock users.
 	 */
 	while (true) {
-		msg = list_dequeue(q->work);
+		msg = NULL;
+		if (!q->max_per_cycle || (processed < q->max_per_cycle))
+			msg = list_dequeue(q->work);
 
 		if (!msg) {
 			unlock_slurmctld(q->locks);
 
-			log_flag(PROTOCOL, "%s(%s): sleeping after processing %d",
+			log_flag(PROTOCOL, "%s(%s): sleeping after processing %u",
 				 __func__, q->msg_name, processed);
-			processed = 0;
 
 			/*
 			 * Rate limit RPC processing. Ensure that when we
@@ -101,11 +113,21 @@ static void *_rpc_queue_worker(void *arg)
 			 *
 			 * This extends the race described below, but this
 			 * is handled properly.
+			 *
+			 * Skip the delay if the batch was cut short by
+			 * max_per_cycle, there is already work waiting.
 			 */
-			usleep(500);
+			if (!q->max_per_cycle || (processed < q->max_per_cycle))
+				usleep(q->batch_window);
 
 			slurm_mutex_lock(&q->mutex);
 
+			if (processed) {
+				q->processed += processed;
+				q->lock_cycles++;
+				processed = 0;
+			}
+
 			if (q->shutdown) {
 				log_flag(PROTOCOL, "%s(%s): shutting down",
 					 __func__, q->msg_name);
@@ -144,6 +166,95 @@ static void *_rpc_queue_worker(void *arg)
 	return NULL;
 }
 
+static slurmctld_rpc_t *_find_queue(const char *name)
+{
+	for (slurmctld_rpc_t *q = slurmctld_rpcs; q->msg_type; q++) {
+		if (q->queue_enabled &&
+		    !xstrcasecmp(rpc_num2string(q->msg_type), name))
+			return q;
+	}
+
+	return NULL;
+}
+
+static void _set_tunable(slurmctld_rpc_t *q, const char *param,
+			 uint32_t value)
+{
+	if (!xstrcasecmp(param, "rpc_queue_window")) {
+		q->batch_window = value;
+	} else if (!xstrcasecmp(param, "rpc_queue_max_per_cycle")) {
+		q->max_per_cycle = value;
+	} else if (!_read_only(q->locks) && (value > 1)) {
+		error("%s: %s requires write locks, ignoring rpc_queue_workers=%u",
+		      __func__, rpc_num2string(q->msg_type), value);
+	} else {
+		q->max_workers = value;
+	}
+}
+
+/*
+ * Apply the rpc_queue_window, rpc_queue_max_per_cycle and rpc_queue_workers
+ * options from SlurmctldParameters. Each takes either a plain value which
+ * applies to every queue, or "<RPC>:<value>" which applies to one message
+ * type and takes precedence over the plain form.
+ */
+static void _parse_params(bool per_type)
+{
+	char *tmp, *tok, *save_ptr = NULL;
+
+	tmp = xstrdup(slurm_conf.slurmctld_params);
+	tok = strtok_r(tmp, ",", &save_ptr);
+	while (tok) {
+		char *val, *sep, *end = NULL;
+		slurmctld_rpc_t *q = NULL;
+		unsigned long value;
+
+		if (xstrncasecmp(tok, "rpc_queue_", 10) ||
+		    !(val = xstrchr(tok, '=')))
+			goto next;
+		*val++ = '\0';
+		if (xstrcasecmp(tok, "rpc_queue_window") &&
+		    xstrcasecmp(tok, "rpc_queue_max_per_cycle") &&
+		    xstrcasecmp(tok, "rpc_queue_workers"))
+			goto next;
+
+		if ((sep = xstrchr(val, ':'))) {
+			if (!per_type)
+				goto next;
+			*sep++ = '\0';
+			if (!(q = _find_queue(val))) {
+				error("%s: %s is not a queued RPC, ignoring %s",
+				      __func__, val, tok);
+				goto next;
+			}
+			val = sep;
+		} else if (per_type) {
+			goto next;
+		}
+
+		value = strtoul(val, &end, 10);
+		if (!val[0] || (end && end[0]) || (value > INFINITE - 1)) {
+			error("%s: invalid value for %s: %s",
+			      __func__, tok, val);
+			goto next;
+		}
+
+		if (q) {
+			_set_tunable(q, tok, value);
+			goto next;
+		}
+		for (q = slurmctld_rpcs; q->msg_type; q++) {
+			if (q->queue_enabled &&
+			    (xstrcasecmp(tok, "rpc_queue_workers") ||
+			     _read_only(q->locks)))
+				_set_tunable(q, tok, value);
+		}
+next:
+		tok = strtok_r(NULL, ",", &save_ptr);
+	}
+	xfree(tmp);
+}
+
 extern void rpc_queue_init(void)
 {
 	if (!xstrcasestr(slurm_conf.slurmctld_params, "enable_rpc_queue")) {
@@ -153,6 +264,15 @@ extern void rpc_queue_init(void)
 
 	error("enabled experimental rpc queuing system");
 
+	for (slurmctld_rpc_t *q = slurmctld_rpcs; q->msg_type; q++) {
+		if (!q->queue_enabled)
+			continue;
+		if (!q->batch_window)
+			q->batch_window = DEFAULT_BATCH_WINDOW;
+	}
+	_parse_params(false);
+	_parse_params(true);
+
 	for (slurmctld_rpc_t *q = slurmctld_rpcs; q->msg_type; q++) {
 		if (!q->queue_enabled)
 			continue;
@@ -162,10 +282,18 @@ extern void rpc_queue_init(void)
 		slurm_cond_init(&q->cond, NULL);
 		slurm_mutex_init(&q->mutex);
 		q->shutdown = false;
-
-		log_flag(PROTOCOL, "%s: starting queue for %s",
-			 __func__, q->msg_name);
-		slurm_thread_create(&q->thread, _rpc_queue_worker, q);
+		q->processed = 0;
+		q->lock_cycles = 0;
+		if (!q->max_workers)
+			q->max_workers = 1;
+
+		log_flag(PROTOCOL, "%s: starting %u worker(s) for %s window=%uus max_per_cycle=%u",
+			 __func__, q->max_workers, q->msg_name,
+			 q->batch_window, q->max_per_cycle);
+		q->threads = xcalloc(q->max_workers, sizeof(pthread_t));
+		for (int i = 0; i < q->max_workers; i++)
+			slurm_thread_create(&q->threads[i], _rpc_queue_worker,
+					    q);
 	}
 }
 
@@ -183,7 +311,7 @@ extern void rpc_queue_shutdown(void)
 
 		slurm_mutex_lock(&q->mutex);
 		q->shutdown = true;
-		slurm_cond_signal(&q->cond);
+		slurm_cond_broadcast(&q->cond);
 		slurm_mutex_unlock(&q->mutex);
 	}
 
@@ -192,7 +320,9 @@ extern void rpc_queue_shutdown(void)
 		if (!q->queue_enabled)
 			continue;
 
-		pthread_join(q->thread, NULL);
+		for (int i = 0; i < q->max_workers; i++)
+			pthread_join(q->threads[i], NULL);
+		xfree(q->threads);
 		FREE_NULL_LIST(q->work);
 	}
 }
@@ -218,3 +348,61 @@ extern bool rpc_enqueue(slurm_msg_t *msg)
 	/* RPC does not have a dedicated queue */
 	return false;
 }
+
+extern void rpc_queue_pack_stats(buf_t *buffer)
+{
+	uint32_t cnt = 0, i = 0;
+	uint16_t *type_id = NULL;
+	uint32_t *processed = NULL, *lock_cycles = NULL, *depth = NULL;
+
+	if (enabled) {
+		for (slurmctld_rpc_t *q = slurmctld_rpcs; q->msg_type; q++) {
+			if (q->queue_enabled)
+				cnt++;
+		}
+	}
+
+	if (cnt) {
+		type_id = xcalloc(cnt, sizeof(*type_id));
+		processed = xcalloc(cnt, sizeof(*processed));
+		lock_cycles = xcalloc(cnt, sizeof(*lock_cycles));
+		depth = xcalloc(cnt, sizeof(*depth));
+		for (slurmctld_rpc_t *q = slurmctld_rpcs; q->msg_type; q++) {
+			if (!q->queue_enabled)
+				continue;
+			slurm_mutex_lock(&q->mutex);
+			type_id[i] = q->msg_type;
+			processed[i] = q->processed;
+			lock_cycles[i] = q->lock_cycles;
+			depth[i] = list_count(q->work);
+			slurm_mutex_unlock(&q->mutex);
+			i++;
+		}
+	}
+
+	pack32(cnt, buffer);
+	pack16_array(type_id, cnt, buffer);
+	pack32_array(processed, cnt, buffer);
+	pack32_array(lock_cycles, cnt, buffer);
+	pack32_array(depth, cnt, buffer);
+
+	xfree(type_id);
+	xfree(processed);
+	xfree(lock_cycles);
+	xfree(depth);
+}
+
+extern void rpc_queue_reset_stats(void)
+{
+	if (!enabled)
+		return;
+
+	for (slurmctld_rpc_t *q = slurmctld_rpcs; q->msg_type; q++) {
+		if (!q->queue_enabled)
+			continue;
+		slurm_mutex_lock(&q->mutex);
+		q->processed = 0;
+		q->lock_cycles = 0;
+		slurm_mutex_unlock(&q->mutex);
+	}
+}
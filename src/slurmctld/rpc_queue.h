@@ -43,4 +43,10 @@ extern void rpc_queue_shutdown(void);
 
 extern bool rpc_enqueue(slurm_msg_t *msg);
 
+/* Pack the per-queue batching statistics for sdiag */
+extern void rpc_queue_pack_stats(buf_t *buffer);
+
+/* Reset the per-queue batching statistics */
+extern void rpc_queue_reset_stats(void);
+
 #endif
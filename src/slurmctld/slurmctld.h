@@ -66,6 +66,7 @@
 #include "src/common/slurm_protocol_defs.h"
 #include "src/common/switch.h"
 #include "src/common/timers.h"
+#include "src/common/vector.h"
 #include "src/common/xmalloc.h"
 
 /*****************************************************************************\
@@ -1001,7 +1002,7 @@ typedef struct {
 
 typedef struct {
 	job_record_t *job_ptr;
-	List job_queue;
+	vector_t *job_queue;
 	part_record_t *part_ptr;
 	uint32_t prio;
 	slurmctld_resv_t *resv_ptr;
@@ -1909,6 +1910,15 @@ extern void node_fini (void);
  * IN name - name of the node */
 extern void node_did_resp (char *name);
 
+/*
+ * nodes_did_resp - record that the nodes of a merged reply are responding
+ *	(see SLURM_MSG_AGGREGATE). Their state is unchanged, so only the nodes
+ *	that slurmctld itself has marked otherwise (e.g. not responding) go
+ *	through node_did_resp().
+ * IN node_names - hostlist expression of the nodes
+ */
+extern void nodes_did_resp(char *node_names);
+
 /*
  * node_not_resp - record that the specified node is not responding
  * IN name - name of the node
@@ -2629,6 +2639,9 @@ extern void configless_setup(void);
 /* Free cached values to avoid memory leak. */
 extern void configless_clear(void);
 
+/* Free the cached job and node information responses */
+extern void dump_cache_clear(void);
+
 /*
  */
 int
@@ -99,6 +99,7 @@
 
 #include "src/slurmd/slurmd/get_mach_stat.h"
 #include "src/slurmd/slurmd/slurmd.h"
+#include "src/slurmd/slurmd/stepd_pool.h"
 
 #include "src/slurmd/common/fname.h"
 #include "src/slurmd/common/job_container_plugin.h"
@@ -633,11 +634,11 @@ rwfail:
 
 
 /*
- * Fork and exec the slurmstepd, then send the slurmstepd its
- * initialization data.  Then wait for slurmstepd to send an "ok"
- * message before returning.  When the "ok" message is received,
- * the slurmstepd has created and begun listening on its unix
- * domain socket.
+ * Fork and exec the slurmstepd, or take one already started from the
+ * pool, then send the slurmstepd its initialization data.  Then wait for
+ * slurmstepd to send an "ok" message before returning.  When the "ok"
+ * message is received, the slurmstepd has created and begun listening
+ * on its unix domain socket.
  *
  * Note that this code forks twice and it is the grandchild that
  * becomes the slurmstepd process, so the slurmstepd's parent process
@@ -648,240 +649,155 @@ _forkexec_slurmstepd(uint16_t type, void *req,
 		     slurm_addr_t *cli, slurm_addr_t *self,
 		     const hostset_t step_hset, uint16_t protocol_version)
 {
-	pid_t pid;
-	int to_stepd[2] = {-1, -1};
-	int to_slurmd[2] = {-1, -1};
-
-	if (pipe(to_stepd) < 0 || pipe(to_slurmd) < 0) {
-		error("%s: pipe failed: %m", __func__);
-		return SLURM_ERROR;
-	}
+	int to_stepd = -1, to_slurmd = -1;
+	int rc = SLURM_SUCCESS;
+	bool pooled = false;
+#if (SLURMSTEPD_MEMCHECK == 0)
+	int i;
+	time_t start_time = time(NULL);
+#endif
+#if (SLURMSTEPD_MEMCHECK == 1)
+	/* memcheck test of slurmstepd, option #1 */
+	char *const argv[3] = {"memcheck",
+			       (char *)conf->stepd_loc, NULL};
+#elif (SLURMSTEPD_MEMCHECK == 2)
+	/* valgrind test of slurmstepd, option #2 */
+	uint32_t job_id = 0, step_id = 0;
+	char log_file[256];
+	char *const argv[13] = {"valgrind", "--tool=memcheck",
+				"--error-limit=no",
+				"--leak-check=summary",
+				"--show-reachable=yes",
+				"--max-stackframe=16777216",
+				"--num-callers=20",
+				"--child-silent-after-fork=yes",
+				"--track-origins=yes",
+				log_file, (char *)conf->stepd_loc,
+				NULL};
+	if (type == LAUNCH_BATCH_JOB) {
+		job_id = ((batch_job_launch_msg_t *)req)->job_id;
+		step_id = SLURM_BATCH_SCRIPT;
+	} else if (type == LAUNCH_TASKS) {
+		job_id = ((launch_tasks_request_msg_t *)req)->step_id.job_id;
+		step_id = ((launch_tasks_request_msg_t *)req)->step_id.step_id;
+	}
+	snprintf(log_file, sizeof(log_file),
+		 "--log-file=/tmp/slurmstepd_valgrind_%u.%u",
+		 job_id, step_id);
+#elif (SLURMSTEPD_MEMCHECK == 3)
+	/* valgrind/drd test of slurmstepd, option #3 */
+	uint32_t job_id = 0, step_id = 0;
+	char log_file[256];
+	char *const argv[10] = {"valgrind", "--tool=drd",
+				"--error-limit=no",
+				"--max-stackframe=16777216",
+				"--num-callers=20",
+				"--child-silent-after-fork=yes",
+				log_file, (char *)conf->stepd_loc,
+				NULL};
+	if (type == LAUNCH_BATCH_JOB) {
+		job_id = ((batch_job_launch_msg_t *)req)->job_id;
+		step_id = SLURM_BATCH_SCRIPT;
+	} else if (type == LAUNCH_TASKS) {
+		job_id = ((launch_tasks_request_msg_t *)req)->step_id.job_id;
+		step_id = ((launch_tasks_request_msg_t *)req)->step_id.step_id;
+	}
+	snprintf(log_file, sizeof(log_file),
+		 "--log-file=/tmp/slurmstepd_valgrind_%u.%u",
+		 job_id, step_id);
+#elif (SLURMSTEPD_MEMCHECK == 4)
+	/* valgrind/helgrind test of slurmstepd, option #4 */
+	uint32_t job_id = 0, step_id = 0;
+	char log_file[256];
+	char *const argv[10] = {"valgrind", "--tool=helgrind",
+				"--error-limit=no",
+				"--max-stackframe=16777216",
+				"--num-callers=20",
+				"--child-silent-after-fork=yes",
+				log_file, (char *)conf->stepd_loc,
+				NULL};
+	if (type == LAUNCH_BATCH_JOB) {
+		job_id = ((batch_job_launch_msg_t *)req)->job_id;
+		step_id = SLURM_BATCH_SCRIPT;
+	} else if (type == LAUNCH_TASKS) {
+		job_id = ((launch_tasks_request_msg_t *)req)->step_id.job_id;
+		step_id = ((launch_tasks_request_msg_t *)req)->step_id.step_id;
+	}
+	snprintf(log_file, sizeof(log_file),
+		 "--log-file=/tmp/slurmstepd_valgrind_%u.%u",
+		 job_id, step_id);
+#else
+	/* no memory checking, default */
+	char *const argv[2] = { (char *)conf->stepd_loc, NULL};
+#endif
+	DEF_TIMERS;
 
 	if (_add_starting_step(type, req)) {
 		error("%s: failed in _add_starting_step: %m", __func__);
 		return SLURM_ERROR;
 	}
 
-	if ((pid = fork()) < 0) {
-		error("%s: fork: %m", __func__);
-		close(to_stepd[0]);
-		close(to_stepd[1]);
-		close(to_slurmd[0]);
-		close(to_slurmd[1]);
+	START_TIMER;
+	if (stepd_pool_get(&to_stepd, &to_slurmd) == SLURM_SUCCESS) {
+		pooled = true;
+	} else if (stepd_spawn(argv, &to_stepd, &to_slurmd) != SLURM_SUCCESS) {
 		_remove_starting_step(type, req);
 		return SLURM_ERROR;
-	} else if (pid > 0) {
-		int rc = SLURM_SUCCESS;
-#if (SLURMSTEPD_MEMCHECK == 0)
-		int i;
-		time_t start_time = time(NULL);
-#endif
-		/*
-		 * Parent sends initialization data to the slurmstepd
-		 * over the to_stepd pipe, and waits for the return code
-		 * reply on the to_slurmd pipe.
-		 */
-		if (close(to_stepd[0]) < 0)
-			error("Unable to close read to_stepd in parent: %m");
-		if (close(to_slurmd[1]) < 0)
-			error("Unable to close write to_slurmd in parent: %m");
-
-		if ((rc = _send_slurmstepd_init(to_stepd[1], type,
-						req, cli, self,
-						step_hset,
-						protocol_version)) != 0) {
-			error("Unable to init slurmstepd");
-			goto done;
-		}
+	}
+
+	/*
+	 * Send initialization data to the slurmstepd over the to_stepd pipe,
+	 * and wait for the return code reply on the to_slurmd pipe.
+	 */
+	if ((rc = _send_slurmstepd_init(to_stepd, type, req, cli, self,
+					step_hset, protocol_version)) != 0) {
+		error("Unable to init slurmstepd");
+		goto done;
+	}
 
-		/* If running under valgrind/memcheck, this pipe doesn't work
-		 * correctly so just skip it. */
+	/* If running under valgrind/memcheck, this pipe doesn't work
+	 * correctly so just skip it. */
 #if (SLURMSTEPD_MEMCHECK == 0)
-		i = read(to_slurmd[0], &rc, sizeof(int));
-		if (i < 0) {
-			error("%s: Can not read return code from slurmstepd "
-			      "got %d: %m", __func__, i);
-			rc = SLURM_ERROR;
-		} else if (i != sizeof(int)) {
-			error("%s: slurmstepd failed to send return code "
-			      "got %d: %m", __func__, i);
-			rc = SLURM_ERROR;
-		} else {
-			int delta_time = time(NULL) - start_time;
-			int cc;
-			if (delta_time > 5) {
-				info("Warning: slurmstepd startup took %d sec, "
-				     "possible file system problem or full "
-				     "memory", delta_time);
-			}
-			if (rc != SLURM_SUCCESS)
-				error("slurmstepd return code %d", rc);
-
-			cc = SLURM_SUCCESS;
-			cc = write(to_stepd[1], &cc, sizeof(int));
-			if (cc != sizeof(int)) {
-				error("%s: failed to send ack to stepd %d: %m",
-				      __func__, cc);
-			}
-		}
-#endif
-	done:
-		if (_remove_starting_step(type, req))
-			error("Error cleaning up starting_step list");
-
-		/* Reap child */
-		if (waitpid(pid, NULL, 0) < 0)
-			error("Unable to reap slurmd child process");
-		if (close(to_stepd[1]) < 0)
-			error("close write to_stepd in parent: %m");
-		if (close(to_slurmd[0]) < 0)
-			error("close read to_slurmd in parent: %m");
-		return rc;
+	i = read(to_slurmd, &rc, sizeof(int));
+	if (i < 0) {
+		error("%s: Can not read return code from slurmstepd "
+		      "got %d: %m", __func__, i);
+		rc = SLURM_ERROR;
+	} else if (i != sizeof(int)) {
+		error("%s: slurmstepd failed to send return code "
+		      "got %d: %m", __func__, i);
+		rc = SLURM_ERROR;
 	} else {
-#if (SLURMSTEPD_MEMCHECK == 1)
-		/* memcheck test of slurmstepd, option #1 */
-		char *const argv[3] = {"memcheck",
-				       (char *)conf->stepd_loc, NULL};
-#elif (SLURMSTEPD_MEMCHECK == 2)
-		/* valgrind test of slurmstepd, option #2 */
-		uint32_t job_id = 0, step_id = 0;
-		char log_file[256];
-		char *const argv[13] = {"valgrind", "--tool=memcheck",
-					"--error-limit=no",
-					"--leak-check=summary",
-					"--show-reachable=yes",
-					"--max-stackframe=16777216",
-					"--num-callers=20",
-					"--child-silent-after-fork=yes",
-					"--track-origins=yes",
-					log_file, (char *)conf->stepd_loc,
-					NULL};
-		if (type == LAUNCH_BATCH_JOB) {
-			job_id = ((batch_job_launch_msg_t *)req)->job_id;
-			step_id = SLURM_BATCH_SCRIPT;
-		} else if (type == LAUNCH_TASKS) {
-			job_id = ((launch_tasks_request_msg_t *)req)->step_id.job_id;
-			step_id = ((launch_tasks_request_msg_t *)req)->step_id.step_id;
-		}
-		snprintf(log_file, sizeof(log_file),
-			 "--log-file=/tmp/slurmstepd_valgrind_%u.%u",
-			 job_id, step_id);
-#elif (SLURMSTEPD_MEMCHECK == 3)
-		/* valgrind/drd test of slurmstepd, option #3 */
-		uint32_t job_id = 0, step_id = 0;
-		char log_file[256];
-		char *const argv[10] = {"valgrind", "--tool=drd",
-					"--error-limit=no",
-					"--max-stackframe=16777216",
-					"--num-callers=20",
-					"--child-silent-after-fork=yes",
-					log_file, (char *)conf->stepd_loc,
-					NULL};
-		if (type == LAUNCH_BATCH_JOB) {
-			job_id = ((batch_job_launch_msg_t *)req)->job_id;
-			step_id = SLURM_BATCH_SCRIPT;
-		} else if (type == LAUNCH_TASKS) {
-			job_id = ((launch_tasks_request_msg_t *)req)->step_id.job_id;
-			step_id = ((launch_tasks_request_msg_t *)req)->step_id.step_id;
-		}
-		snprintf(log_file, sizeof(log_file),
-			 "--log-file=/tmp/slurmstepd_valgrind_%u.%u",
-			 job_id, step_id);
-#elif (SLURMSTEPD_MEMCHECK == 4)
-		/* valgrind/helgrind test of slurmstepd, option #4 */
-		uint32_t job_id = 0, step_id = 0;
-		char log_file[256];
-		char *const argv[10] = {"valgrind", "--tool=helgrind",
-					"--error-limit=no",
-					"--max-stackframe=16777216",
-					"--num-callers=20",
-					"--child-silent-after-fork=yes",
-					log_file, (char *)conf->stepd_loc,
-					NULL};
-		if (type == LAUNCH_BATCH_JOB) {
-			job_id = ((batch_job_launch_msg_t *)req)->job_id;
-			step_id = SLURM_BATCH_SCRIPT;
-		} else if (type == LAUNCH_TASKS) {
-			job_id = ((launch_tasks_request_msg_t *)req)->step_id.job_id;
-			step_id = ((launch_tasks_request_msg_t *)req)->step_id.step_id;
-		}
-		snprintf(log_file, sizeof(log_file),
-			 "--log-file=/tmp/slurmstepd_valgrind_%u.%u",
-			 job_id, step_id);
-#else
-		/* no memory checking, default */
-		char *const argv[2] = { (char *)conf->stepd_loc, NULL};
-#endif
-		int i;
-		int failed = 0;
-
-		/*
-		 * Child forks and exits
-		 */
-		if (setsid() < 0) {
-			error("%s: setsid: %m", __func__);
-			failed = 1;
-		}
-		if ((pid = fork()) < 0) {
-			error("%s: Unable to fork grandchild: %m", __func__);
-			failed = 2;
-		} else if (pid > 0) { /* child */
-			_exit(0);
+		int delta_time = time(NULL) - start_time;
+		int cc;
+		if (delta_time > 5) {
+			info("Warning: slurmstepd startup took %d sec, "
+			     "possible file system problem or full "
+			     "memory", delta_time);
 		}
+		if (rc != SLURM_SUCCESS)
+			error("slurmstepd return code %d", rc);
 
-		/*
-		 * Just in case we (or someone we are linking to)
-		 * opened a file and didn't do a close on exec.  This
-		 * is needed mostly to protect us against libs we link
-		 * to that don't set the flag as we should already be
-		 * setting it for those that we open.  The number 256
-		 * is an arbitrary number based off test7.9.
-		 */
-		for (i=3; i<256; i++) {
-			(void) fcntl(i, F_SETFD, FD_CLOEXEC);
+		cc = SLURM_SUCCESS;
+		cc = write(to_stepd, &cc, sizeof(int));
+		if (cc != sizeof(int)) {
+			error("%s: failed to send ack to stepd %d: %m",
+			      __func__, cc);
 		}
-
-		/*
-		 * Grandchild exec's the slurmstepd
-		 *
-		 * If the slurmd is being shutdown/restarted before
-		 * the pipe happens the old conf->lfd could be reused
-		 * and if we close it the dup2 below will fail.
-		 */
-		if ((to_stepd[0] != conf->lfd)
-		    && (to_slurmd[1] != conf->lfd))
-			close(conf->lfd);
-
-		if (close(to_stepd[1]) < 0)
-			error("close write to_stepd in grandchild: %m");
-		if (close(to_slurmd[0]) < 0)
-			error("close read to_slurmd in parent: %m");
-
-		(void) close(STDIN_FILENO); /* ignore return */
-		if (dup2(to_stepd[0], STDIN_FILENO) == -1) {
-			error("dup2 over STDIN_FILENO: %m");
-			_exit(1);
-		}
-		fd_set_close_on_exec(to_stepd[0]);
-		(void) close(STDOUT_FILENO); /* ignore return */
-		if (dup2(to_slurmd[1], STDOUT_FILENO) == -1) {
-			error("dup2 over STDOUT_FILENO: %m");
-			_exit(1);
-		}
-		fd_set_close_on_exec(to_slurmd[1]);
-		(void) close(STDERR_FILENO); /* ignore return */
-		if (dup2(devnull, STDERR_FILENO) == -1) {
-			error("dup2 /dev/null to STDERR_FILENO: %m");
-			_exit(1);
-		}
-		fd_set_noclose_on_exec(STDERR_FILENO);
-		log_fini();
-		if (!failed) {
-			execvp(argv[0], argv);
-			error("exec of slurmstepd failed: %m");
-		}
-		_exit(2);
 	}
+#endif
+	END_TIMER;
+	debug("%s: %s slurmstepd ready after %s",
+	      __func__, pooled ? "pooled" : "new", TIME_STR);
+done:
+	if (_remove_starting_step(type, req))
+		error("Error cleaning up starting_step list");
+
+	if (close(to_stepd) < 0)
+		error("close write to_stepd in parent: %m");
+	if (close(to_slurmd) < 0)
+		error("close read to_slurmd in parent: %m");
+	return rc;
 }
 
 static void _setup_x11_display(uint32_t job_id, uint32_t step_id_in,
@@ -3090,6 +3006,45 @@ _enforce_job_mem_limit(void)
 	xfree(job_mem_info_ptr);
 }
 
+/*
+ * Send the load and free memory in response to a ping unless they are the
+ * same as in the last response sent and replies are aggregated (see
+ * SLURM_MSG_AGGREGATE), in which case a plain return code will do.
+ * A registration request is always answered in full, as a plain return code
+ * there stands for an unchanged registration.
+ */
+static void _send_ping_resp(slurm_msg_t *msg, ping_slurmd_resp_msg_t *resp)
+{
+	static pthread_mutex_t ping_mutex = PTHREAD_MUTEX_INITIALIZER;
+	static uint32_t last_cpu_load = NO_VAL;
+	static uint64_t last_free_mem = NO_VAL64;
+	slurm_msg_t resp_msg;
+
+	slurm_mutex_lock(&ping_mutex);
+	if ((msg->msg_type == REQUEST_PING) &&
+	    (msg->flags & SLURM_MSG_AGGREGATE) &&
+	    (resp->cpu_load == last_cpu_load) &&
+	    (resp->free_mem == last_free_mem)) {
+		slurm_mutex_unlock(&ping_mutex);
+		slurm_send_rc_msg(msg, SLURM_SUCCESS);
+		return;
+	}
+	last_cpu_load = NO_VAL;
+	last_free_mem = NO_VAL64;
+	slurm_mutex_unlock(&ping_mutex);
+
+	slurm_msg_t_copy(&resp_msg, msg);
+	resp_msg.msg_type = RESPONSE_PING_SLURMD;
+	resp_msg.data     = resp;
+	if (slurm_send_node_msg(msg->conn_fd, &resp_msg) < 0)
+		return;
+
+	slurm_mutex_lock(&ping_mutex);
+	last_cpu_load = resp->cpu_load;
+	last_free_mem = resp->free_mem;
+	slurm_mutex_unlock(&ping_mutex);
+}
+
 static void _rpc_ping(slurm_msg_t *msg)
 {
 	int        rc = SLURM_SUCCESS;
@@ -3120,22 +3075,31 @@ static void _rpc_ping(slurm_msg_t *msg)
 			send_registration_msg(SLURM_SUCCESS, false);
 		}
 	} else {
-		slurm_msg_t resp_msg;
 		ping_slurmd_resp_msg_t ping_resp;
-		get_cpu_load(&ping_resp.cpu_load);
-		get_free_mem(&ping_resp.free_mem);
-		slurm_msg_t_copy(&resp_msg, msg);
-		resp_msg.msg_type = RESPONSE_PING_SLURMD;
-		resp_msg.data     = &ping_resp;
+		bool reg = (msg->msg_type == REQUEST_NODE_REGISTRATION_STATUS);
 
-		slurm_send_node_msg(msg->conn_fd, &resp_msg);
+		if (reg && (msg->flags & SLURM_MSG_AGGREGATE) &&
+		    !registration_changed()) {
+			/*
+			 * slurmctld already has this registration, a bare
+			 * return code merged with those of the other unchanged
+			 * nodes on the way up the tree tells it so.
+			 */
+			debug2("%s: registration unchanged", __func__);
+			slurm_send_rc_msg(msg, SLURM_SUCCESS);
+			reg = false;
+		} else {
+			get_cpu_load(&ping_resp.cpu_load);
+			get_free_mem(&ping_resp.free_mem);
+			_send_ping_resp(msg, &ping_resp);
+		}
 
 		/* Take this opportunity to enforce any job memory limits */
 		_enforce_job_mem_limit();
 		/* Clear up any stalled file transfers as well */
 		_file_bcast_cleanup();
 
-		if (msg->msg_type == REQUEST_NODE_REGISTRATION_STATUS) {
+		if (reg) {
 			get_reg_resp = true;
 			send_registration_msg(SLURM_SUCCESS, true);
 		}
@@ -3775,8 +3739,7 @@ _rpc_timelimit(slurm_msg_t *msg)
 	 *  Indicate to slurmctld that we've received the message
 	 */
 	slurm_send_rc_msg(msg, SLURM_SUCCESS);
-	close(msg->conn_fd);
-	msg->conn_fd = -1;
+	slurmd_release_conn(msg);
 
 	if (req->step_id.step_id != NO_VAL) {
 		slurm_conf_t *cf;
@@ -4780,10 +4743,7 @@ _rpc_suspend_job(slurm_msg_t *msg)
 	 * detected with the request */
 	if (msg->conn_fd >= 0) {
 		slurm_send_rc_msg(msg, rc);
-		if (close(msg->conn_fd) < 0)
-			error("_rpc_suspend_job: close(%d): %m",
-			      msg->conn_fd);
-		msg->conn_fd = -1;
+		slurmd_release_conn(msg);
 	}
 	if (rc != SLURM_SUCCESS)
 		return;
@@ -4984,9 +4944,7 @@ _rpc_abort_job(slurm_msg_t *msg)
 	 */
 	if (msg->conn_fd >= 0) {
 		slurm_send_rc_msg(msg, SLURM_SUCCESS);
-		if (close(msg->conn_fd) < 0)
-			error ("rpc_abort_job: close(%d): %m", msg->conn_fd);
-		msg->conn_fd = -1;
+		slurmd_release_conn(msg);
 	}
 
 	if (_kill_all_active_steps(req->step_id.job_id, SIG_ABORT, 0, true,
@@ -5118,10 +5076,7 @@ _rpc_terminate_job(slurm_msg_t *msg)
 			debug("%s: sent SUCCESS for %u, waiting for prolog to finish",
 			      __func__, req->step_id.job_id);
 			slurm_send_rc_msg(msg, SLURM_SUCCESS);
-			if (close(msg->conn_fd) < 0)
-				error("%s: close(%d): %m",
-				      __func__, msg->conn_fd);
-			msg->conn_fd = -1;
+			slurmd_release_conn(msg);
 		}
 		_wait_for_job_running_prolog(req->step_id.job_id);
 	}
@@ -5140,10 +5095,7 @@ _rpc_terminate_job(slurm_msg_t *msg)
 			 */
 			debug("sent SUCCESS, waiting for step to start");
 			slurm_send_rc_msg (msg, SLURM_SUCCESS);
-			if (close(msg->conn_fd) < 0)
-				error("rpc_kill_job: close(%d): %m",
-				      msg->conn_fd);
-			msg->conn_fd = -1;
+			slurmd_release_conn(msg);
 		}
 		if (_wait_for_starting_step(&req->step_id)) {
 			/*
@@ -5227,9 +5179,7 @@ _rpc_terminate_job(slurm_msg_t *msg)
 	if (msg->conn_fd >= 0) {
 		debug4("sent SUCCESS");
 		slurm_send_rc_msg(msg, SLURM_SUCCESS);
-		if (close(msg->conn_fd) < 0)
-			error ("rpc_kill_job: close(%d): %m", msg->conn_fd);
-		msg->conn_fd = -1;
+		slurmd_release_conn(msg);
 	}
 
 	/*
@@ -53,6 +53,7 @@
 #include <dlfcn.h>
 #include <fcntl.h>
 #include <grp.h>
+#include <poll.h>
 #include <pthread.h>
 #include <sched.h>
 #include <stdlib.h>
@@ -60,6 +61,7 @@
 #include <sys/mman.h>
 #include <sys/param.h>
 #include <sys/resource.h>
+#include <sys/socket.h>
 #include <sys/stat.h>
 #include <sys/time.h>
 #include <sys/types.h>
@@ -83,6 +85,7 @@
 #include "src/common/node_features.h"
 #include "src/common/node_select.h"
 #include "src/common/pack.h"
+#include "src/common/slurm_protocol_pack.h"
 #include "src/common/parse_time.h"
 #include "src/common/plugstack.h"
 #include "src/common/prep.h"
@@ -118,6 +121,7 @@
 #include "src/slurmd/slurmd/get_mach_stat.h"
 #include "src/slurmd/slurmd/req.h"
 #include "src/slurmd/slurmd/slurmd.h"
+#include "src/slurmd/slurmd/stepd_pool.h"
 
 #ifndef MAXHOSTNAMELEN
 #  define MAXHOSTNAMELEN	64
@@ -125,6 +129,12 @@
 
 #define MAX_THREADS		256
 
+/*
+ * Seconds a SLURM_MSG_KEEP_ALIVE connection waits for its next request. Kept
+ * above the slurmctld agent_conn_pool idle time so slurmctld closes first.
+ */
+#define KEEP_ALIVE_TIMEOUT	300
+
 #define _free_and_set(__dst, __src)		\
 	do {					\
 		xfree(__dst); __dst = __src;	\
@@ -153,6 +163,7 @@ static pthread_mutex_t fork_mutex     = PTHREAD_MUTEX_INITIALIZER;
 typedef struct connection {
 	int fd;
 	slurm_addr_t *cli_addr;
+	bool keep_alive;	/* wait for a request before reading */
 } conn_t;
 
 /*
@@ -176,6 +187,9 @@ static sig_atomic_t _reconfig = 0;
 static sig_atomic_t _update_log = 0;
 static pthread_t msg_pthread = (pthread_t) 0;
 static time_t sent_reg_time = (time_t) 0;
+static pthread_mutex_t reg_mutex = PTHREAD_MUTEX_INITIALIZER;
+static buf_t *reg_config = NULL;	/* last registration accepted by
+					 * slurmctld, see _pack_reg_config() */
 
 static void      _atfork_final(void);
 static void      _atfork_prepare(void);
@@ -186,6 +200,7 @@ static void      _decrement_thd_count(void);
 static void      _destroy_conf(void);
 static int       _drain_node(char *reason);
 static void      _fill_registration_msg(slurm_node_registration_status_msg_t *);
+static buf_t *   _pack_reg_config(slurm_node_registration_status_msg_t *msg);
 static void      _handle_connection(int fd, slurm_addr_t *client);
 static void      _hup_handler(int);
 static void      _increment_thd_count(void);
@@ -388,6 +403,7 @@ main (int argc, char **argv)
 	record_launched_jobs();
 
 	run_script_health_check();
+	stepd_pool_init();
 
 	slurm_thread_create_detached(NULL, _registration_engine, NULL);
 
@@ -556,31 +572,87 @@ static void _handle_connection(int fd, slurm_addr_t *cli)
 	slurm_thread_create_detached(NULL, _service_connection, arg);
 }
 
+/*
+ * Wait for the next request on a kept alive connection. The thread is not
+ * counted as active while it waits, so idle connections neither delay
+ * reconfiguration nor use up MAX_THREADS.
+ * RET true if a request arrived, the thread is then counted as active again
+ */
+static bool _wait_keep_alive(int fd)
+{
+	struct pollfd pfd = { .fd = fd, .events = POLLIN };
+	char tmp;
+	int rc;
+
+	while (((rc = poll(&pfd, 1, KEEP_ALIVE_TIMEOUT * 1000)) < 0) &&
+	       (errno == EINTR))
+		;
+	if ((rc <= 0) || _shutdown)
+		return false;
+	/* peer closed the connection */
+	if (recv(fd, &tmp, 1, MSG_PEEK) <= 0)
+		return false;
+
+	_increment_thd_count();
+	return true;
+}
+
 static void *
 _service_connection(void *arg)
 {
 	conn_t *con = (conn_t *) arg;
-	slurm_msg_t *msg = xmalloc(sizeof(slurm_msg_t));
+	slurm_msg_t *msg = NULL;
+	int fd = con->fd;
 	int rc = SLURM_SUCCESS;
 
-	debug3("in the service_connection");
-	slurm_msg_t_init(msg);
-	if ((rc = slurm_receive_msg_and_forward(con->fd, con->cli_addr, msg))
-	   != SLURM_SUCCESS) {
-		error("service_connection: slurm_receive_msg: %m");
+	if (con->keep_alive && !_wait_keep_alive(fd)) {
+		(void) close(fd);
+		xfree(con->cli_addr);
+		xfree(con);
+		return NULL;
+	}
+
+	while (true) {
+		debug3("in the service_connection");
+		msg = xmalloc(sizeof(slurm_msg_t));
+		slurm_msg_t_init(msg);
+		if ((rc = slurm_receive_msg_and_forward(fd, con->cli_addr, msg))
+		   != SLURM_SUCCESS) {
+			error("service_connection: slurm_receive_msg: %m");
+			/*
+			 * if this fails we need to make sure the nodes we
+			 * forward to are taken care of and sent back. This way
+			 * the control also has a better idea what happened to
+			 * us
+			 */
+			slurm_send_rc_msg(msg, rc);
+			break;
+		}
+		debug2("Start processing RPC: %s",
+		       rpc_num2string(msg->msg_type));
+
+		slurmd_req(msg);
+
 		/*
-		 * if this fails we need to make sure the nodes we forward
-		 * to are taken care of and sent back. This way the control
-		 * also has a better idea what happened to us
+		 * Keep reading requests from senders which reuse their
+		 * connection, unless the handler already closed it.
 		 */
-		slurm_send_rc_msg(msg, rc);
-		goto cleanup;
-	}
-	debug2("Start processing RPC: %s", rpc_num2string(msg->msg_type));
+		if (!(msg->flags & SLURM_MSG_KEEP_ALIVE) || (msg->conn_fd < 0))
+			break;
 
-	slurmd_req(msg);
+		debug2("Finish processing RPC: %s",
+		       rpc_num2string(msg->msg_type));
+		slurm_free_msg(msg);
+		msg = NULL;
+		_decrement_thd_count();
+		if (!_wait_keep_alive(fd)) {
+			(void) close(fd);
+			xfree(con->cli_addr);
+			xfree(con);
+			return NULL;
+		}
+	}
 
-cleanup:
 	if ((msg->conn_fd >= 0) && close(msg->conn_fd) < 0)
 		error ("close(%d): %m", con->fd);
 
@@ -592,6 +664,27 @@ cleanup:
 	return NULL;
 }
 
+extern void slurmd_release_conn(slurm_msg_t *msg)
+{
+	if (msg->conn_fd < 0)
+		return;
+
+	if (msg->flags & SLURM_MSG_KEEP_ALIVE) {
+		conn_t *arg = xmalloc(sizeof(conn_t));
+
+		arg->fd = msg->conn_fd;
+		arg->cli_addr = xmalloc(sizeof(slurm_addr_t));
+		memcpy(arg->cli_addr, &msg->address, sizeof(slurm_addr_t));
+		arg->keep_alive = true;
+		/* counted as active once a request arrives */
+		slurm_thread_create_detached(NULL, _service_connection, arg);
+	} else if (close(msg->conn_fd) < 0) {
+		error("%s: close(%d): %m", __func__, msg->conn_fd);
+	}
+
+	msg->conn_fd = -1;
+}
+
 static void _handle_node_reg_resp(slurm_msg_t *resp_msg)
 {
 	int rc;
@@ -657,6 +750,7 @@ send_registration_msg(uint32_t status, bool startup)
 	slurm_msg_t req, resp_msg;
 	slurm_node_registration_status_msg_t *msg =
 		xmalloc (sizeof (slurm_node_registration_status_msg_t));
+	buf_t *config;
 
 	slurm_msg_t_init(&req);
 	slurm_msg_t_init(&resp_msg);
@@ -668,6 +762,7 @@ send_registration_msg(uint32_t status, bool startup)
 
 	_fill_registration_msg(msg);
 	msg->status  = status;
+	config = _pack_reg_config(msg);
 
 	req.msg_type = MESSAGE_NODE_REGISTRATION_STATUS;
 	req.data = msg;
@@ -693,9 +788,77 @@ send_registration_msg(uint32_t status, bool startup)
 	if (ret_val == SLURM_SUCCESS)
 		sent_reg_time = time(NULL);
 fail:
+	slurm_mutex_lock(&reg_mutex);
+	FREE_NULL_BUFFER(reg_config);
+	if (ret_val == SLURM_SUCCESS) {
+		reg_config = config;
+		config = NULL;
+	}
+	slurm_mutex_unlock(&reg_mutex);
+	FREE_NULL_BUFFER(config);
+
 	return ret_val;
 }
 
+extern bool registration_changed(void)
+{
+	slurm_node_registration_status_msg_t *msg =
+		xmalloc(sizeof(slurm_node_registration_status_msg_t));
+	buf_t *config;
+	bool changed = true;
+
+	_fill_registration_msg(msg);
+	msg->status = SLURM_SUCCESS;
+
+	if ((config = _pack_reg_config(msg))) {
+		slurm_mutex_lock(&reg_mutex);
+		if (reg_config &&
+		    (get_buf_offset(reg_config) == get_buf_offset(config)) &&
+		    !memcmp(get_buf_data(reg_config), get_buf_data(config),
+			    get_buf_offset(config)))
+			changed = false;
+		slurm_mutex_unlock(&reg_mutex);
+		FREE_NULL_BUFFER(config);
+	}
+	slurm_free_node_registration_status_msg(msg);
+
+	return changed;
+}
+
+/*
+ * Pack what a registration tells slurmctld about this node, leaving out the
+ * readings which change all the time (load, free memory, energy and uptime).
+ * RET buffer to be freed by the caller, or NULL if jobs are running, as
+ *     slurmctld then needs every registration to reconcile them
+ */
+static buf_t *_pack_reg_config(slurm_node_registration_status_msg_t *msg)
+{
+	slurm_node_registration_status_msg_t config = *msg;
+	slurm_msg_t req;
+	buf_t *buffer;
+
+	if (msg->job_count)
+		return NULL;
+
+	config.cpu_load = 0;
+	config.energy = NULL;
+	config.flags = 0;
+	config.free_mem = 0;
+	config.timestamp = 0;
+	config.up_time = 0;
+
+	slurm_msg_t_init(&req);
+	req.msg_type = MESSAGE_NODE_REGISTRATION_STATUS;
+	req.protocol_version = SLURM_PROTOCOL_VERSION;
+	req.data = &config;
+
+	buffer = init_buf(BUF_SIZE);
+	if (pack_msg(&req, buffer) != SLURM_SUCCESS)
+		FREE_NULL_BUFFER(buffer);
+
+	return buffer;
+}
+
 static void
 _fill_registration_msg(slurm_node_registration_status_msg_t *msg)
 {
@@ -1116,6 +1279,9 @@ _reconfigure(void)
 	_set_topo_info();
 	route_g_reconfigure();
 
+	/* Pooled slurmstepd processes have read the old configuration */
+	stepd_pool_init();
+
 	/*
 	 * In case the administrator changed the cpu frequency set capabilities
 	 * on this node, rebuild the cpu frequency table information
@@ -1909,6 +2075,7 @@ cleanup:
 static int
 _slurmd_fini(void)
 {
+	stepd_pool_fini();
 	assoc_mgr_fini(false);
 	node_features_g_fini();
 	core_spec_g_fini();
@@ -1939,6 +2106,9 @@ _slurmd_fini(void)
 	xfree(fini_job_id);
 	fini_job_cnt = 0;
 	slurm_mutex_unlock(&fini_job_mutex);
+	slurm_mutex_lock(&reg_mutex);
+	FREE_NULL_BUFFER(reg_config);
+	slurm_mutex_unlock(&reg_mutex);
 
 	return SLURM_SUCCESS;
 }
@@ -162,6 +162,13 @@ extern bool tres_packed;
  */
 int send_registration_msg(uint32_t status, bool startup);
 
+/*
+ * Return true unless no jobs are running and a registration would tell
+ * slurmctld nothing beyond the last one it accepted, load and free memory
+ * aside.
+ */
+extern bool registration_changed(void);
+
 /*
  * save_cred_state - save the current credential list to a file
  * IN list - list of credentials
@@ -175,4 +182,12 @@ int run_script_health_check(void);
 /* Handler for SIGTERM; can also be called to shutdown the slurmd. */
 void slurmd_shutdown(int signum);
 
+/*
+ * Called by RPC handlers which reply early and carry on working. The
+ * connection is closed, or if the sender asked to reuse it
+ * (SLURM_MSG_KEEP_ALIVE) handed to a new thread to wait for the next request.
+ * Sets msg->conn_fd to -1.
+ */
+extern void slurmd_release_conn(slurm_msg_t *msg);
+
 #endif /* !_SLURMD_H */
@@ -0,0 +1,329 @@
+/*****************************************************************************\
+ *  stepd_pool.c - pool of slurmstepd processes ready for a step launch
+ *****************************************************************************
+ *  This file is part of Slurm, a resource management program.
+ *  For details, see <https://slurm.schedmd.com/>.
+ *  Please also read the included file: DISCLAIMER.
+ *
+ *  Slurm is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 2 of the License, or (at your option)
+ *  any later version.
+ *
+ *  In addition, as a special exception, the copyright holders give permission
+ *  to link the code of portions of this program with the OpenSSL library under
+ *  certain conditions as described in each individual source file, and
+ *  distribute linked combinations including the two. You must obey the GNU
+ *  General Public License in all respects for all of the code used other than
+ *  OpenSSL. If you modify file(s) with this exception, you may extend this
+ *  exception to your version of the file(s), but you are not obligated to do
+ *  so. If you do not wish to do so, delete this exception statement from your
+ *  version.  If you delete this exception statement from all source files in
+ *  the program, then also delete it here.
+ *
+ *  Slurm is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with Slurm; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA.
+\*****************************************************************************/
+
+#define _GNU_SOURCE
+
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "src/common/fd.h"
+#include "src/common/log.h"
+#include "src/common/macros.h"
+#include "src/common/read_config.h"
+#include "src/common/xmalloc.h"
+#include "src/common/xstring.h"
+
+#include "src/slurmd/common/slurmstepd_init.h"
+#include "src/slurmd/slurmd/slurmd.h"
+#include "src/slurmd/slurmd/stepd_pool.h"
+
+#define MAX_POOL_SIZE 64
+
+typedef struct {
+	int to_stepd;
+	int to_slurmd;
+} pool_stepd_t;
+
+static pthread_mutex_t pool_lock = PTHREAD_MUTEX_INITIALIZER;
+static pool_stepd_t pool[MAX_POOL_SIZE];
+static int pool_cnt = 0;
+static int pool_size = 0;
+static uint32_t pool_gen = 0;	/* changes when pooled processes are stale */
+static bool pool_filling = false;
+
+/*
+ * Runs in the forked child. Fork again so the grandchild exec'ing the
+ * slurmstepd is reparented to init, then exec with the pipes as its stdin
+ * and stdout.
+ */
+static void _exec_stepd(char *const argv[], int to_stepd[2],
+			int to_slurmd[2])
+{
+	int i, failed = 0;
+	pid_t pid;
+
+	if (setsid() < 0) {
+		error("%s: setsid: %m", __func__);
+		failed = 1;
+	}
+	if ((pid = fork()) < 0) {
+		error("%s: Unable to fork grandchild: %m", __func__);
+		failed = 2;
+	} else if (pid > 0) { /* child */
+		_exit(0);
+	}
+
+	/*
+	 * Just in case we (or someone we are linking to)
+	 * opened a file and didn't do a close on exec.  This
+	 * is needed mostly to protect us against libs we link
+	 * to that don't set the flag as we should already be
+	 * setting it for those that we open.  The number 256
+	 * is an arbitrary number based off test7.9.
+	 */
+	for (i = 3; i < 256; i++) {
+		(void) fcntl(i, F_SETFD, FD_CLOEXEC);
+	}
+
+	/*
+	 * Grandchild exec's the slurmstepd
+	 *
+	 * If the slurmd is being shutdown/restarted before
+	 * the pipe happens the old conf->lfd could be reused
+	 * and if we close it the dup2 below will fail.
+	 */
+	if ((to_stepd[0] != conf->lfd) && (to_slurmd[1] != conf->lfd))
+		close(conf->lfd);
+
+	if (close(to_stepd[1]) < 0)
+		error("close write to_stepd in grandchild: %m");
+	if (close(to_slurmd[0]) < 0)
+		error("close read to_slurmd in parent: %m");
+
+	(void) close(STDIN_FILENO); /* ignore return */
+	if (dup2(to_stepd[0], STDIN_FILENO) == -1) {
+		error("dup2 over STDIN_FILENO: %m");
+		_exit(1);
+	}
+	fd_set_close_on_exec(to_stepd[0]);
+	(void) close(STDOUT_FILENO); /* ignore return */
+	if (dup2(to_slurmd[1], STDOUT_FILENO) == -1) {
+		error("dup2 over STDOUT_FILENO: %m");
+		_exit(1);
+	}
+	fd_set_close_on_exec(to_slurmd[1]);
+	(void) close(STDERR_FILENO); /* ignore return */
+	if (dup2(devnull, STDERR_FILENO) == -1) {
+		error("dup2 /dev/null to STDERR_FILENO: %m");
+		_exit(1);
+	}
+	fd_set_noclose_on_exec(STDERR_FILENO);
+	log_fini();
+	if (!failed) {
+		execvp(argv[0], argv);
+		error("exec of slurmstepd failed: %m");
+	}
+	_exit(2);
+}
+
+extern int stepd_spawn(char *const argv[], int *to_stepd, int *to_slurmd)
+{
+	pid_t pid;
+	int to_stepd_pipe[2] = {-1, -1};
+	int to_slurmd_pipe[2] = {-1, -1};
+
+	/*
+	 * Close on exec so that no other process forked by the slurmd keeps
+	 * these pipes open, the slurmstepd relies on seeing EOF when the
+	 * slurmd releases it.
+	 */
+	if (pipe2(to_stepd_pipe, O_CLOEXEC) < 0 ||
+	    pipe2(to_slurmd_pipe, O_CLOEXEC) < 0) {
+		error("%s: pipe failed: %m", __func__);
+		if (to_stepd_pipe[0] >= 0) {
+			close(to_stepd_pipe[0]);
+			close(to_stepd_pipe[1]);
+		}
+		return SLURM_ERROR;
+	}
+
+	if ((pid = fork()) < 0) {
+		error("%s: fork: %m", __func__);
+		close(to_stepd_pipe[0]);
+		close(to_stepd_pipe[1]);
+		close(to_slurmd_pipe[0]);
+		close(to_slurmd_pipe[1]);
+		return SLURM_ERROR;
+	} else if (pid == 0) {
+		_exec_stepd(argv, to_stepd_pipe, to_slurmd_pipe);
+	}
+
+	if (close(to_stepd_pipe[0]) < 0)
+		error("Unable to close read to_stepd in parent: %m");
+	if (close(to_slurmd_pipe[1]) < 0)
+		error("Unable to close write to_slurmd in parent: %m");
+
+	/* Reap child, it exits as soon as the grandchild is forked */
+	if (waitpid(pid, NULL, 0) < 0)
+		error("Unable to reap slurmd child process");
+
+	*to_stepd = to_stepd_pipe[1];
+	*to_slurmd = to_slurmd_pipe[0];
+
+	return SLURM_SUCCESS;
+}
+
+/*
+ * Closing the pipes makes a pooled slurmstepd see EOF before any
+ * initialization data and exit.
+ */
+static void _release_stepd(pool_stepd_t *stepd)
+{
+	(void) close(stepd->to_stepd);
+	(void) close(stepd->to_slurmd);
+}
+
+/*
+ * A pooled slurmstepd never writes before getting its initialization data,
+ * so anything readable on its stdout means it has exited.
+ */
+static bool _stepd_alive(pool_stepd_t *stepd)
+{
+	struct pollfd pfd = {
+		.fd = stepd->to_slurmd,
+		.events = POLLIN,
+	};
+
+	return (poll(&pfd, 1, 0) == 0);
+}
+
+static void *_fill_pool(void *arg)
+{
+	char *const argv[2] = { (char *) conf->stepd_loc, NULL };
+	pool_stepd_t stepd;
+	uint32_t gen;
+
+	while (true) {
+		slurm_mutex_lock(&pool_lock);
+		if (pool_cnt >= pool_size) {
+			pool_filling = false;
+			slurm_mutex_unlock(&pool_lock);
+			break;
+		}
+		gen = pool_gen;
+		slurm_mutex_unlock(&pool_lock);
+
+		if (stepd_spawn(argv, &stepd.to_stepd, &stepd.to_slurmd)) {
+			slurm_mutex_lock(&pool_lock);
+			pool_filling = false;
+			slurm_mutex_unlock(&pool_lock);
+			break;
+		}
+
+		slurm_mutex_lock(&pool_lock);
+		if ((gen == pool_gen) && (pool_cnt < pool_size)) {
+			pool[pool_cnt++] = stepd;
+			stepd.to_stepd = -1;
+		}
+		slurm_mutex_unlock(&pool_lock);
+
+		/* Started with an old configuration */
+		if (stepd.to_stepd != -1)
+			_release_stepd(&stepd);
+	}
+
+	return NULL;
+}
+
+/* Call with pool_lock held */
+static void _start_fill(void)
+{
+	if (pool_filling || (pool_cnt >= pool_size))
+		return;
+
+	pool_filling = true;
+	slurm_thread_create_detached(NULL, _fill_pool, NULL);
+}
+
+/* Call with pool_lock held */
+static void _release_pool(void)
+{
+	for (int i = 0; i < pool_cnt; i++)
+		_release_stepd(&pool[i]);
+	pool_cnt = 0;
+	pool_gen++;
+}
+
+extern int stepd_pool_get(int *to_stepd, int *to_slurmd)
+{
+	int rc = SLURM_ERROR;
+
+	slurm_mutex_lock(&pool_lock);
+	while (pool_cnt > 0) {
+		pool_stepd_t *stepd = &pool[--pool_cnt];
+
+		if (!_stepd_alive(stepd)) {
+			debug("%s: discarding exited slurmstepd", __func__);
+			_release_stepd(stepd);
+			continue;
+		}
+		*to_stepd = stepd->to_stepd;
+		*to_slurmd = stepd->to_slurmd;
+		rc = SLURM_SUCCESS;
+		break;
+	}
+	_start_fill();
+	slurm_mutex_unlock(&pool_lock);
+
+	return rc;
+}
+
+extern void stepd_pool_init(void)
+{
+	char *tmp_ptr;
+	int size = 0;
+
+#if (SLURMSTEPD_MEMCHECK == 0)
+	if ((tmp_ptr = xstrcasestr(slurm_conf.launch_params,
+				   "slurmstepd_pool="))) {
+		size = atoi(tmp_ptr + strlen("slurmstepd_pool="));
+		if ((size < 0) || (size > MAX_POOL_SIZE)) {
+			error("Invalid LaunchParameters slurmstepd_pool=%d, using %d",
+			      size, MAX_POOL_SIZE);
+			size = MAX_POOL_SIZE;
+		}
+	}
+#endif
+
+	slurm_mutex_lock(&pool_lock);
+	_release_pool();
+	pool_size = size;
+	if (pool_size)
+		debug("%s: keeping %d slurmstepd processes ready",
+		      __func__, pool_size);
+	_start_fill();
+	slurm_mutex_unlock(&pool_lock);
+}
+
+extern void stepd_pool_fini(void)
+{
+	slurm_mutex_lock(&pool_lock);
+	_release_pool();
+	pool_size = 0;
+	slurm_mutex_unlock(&pool_lock);
+}
@@ -0,0 +1,67 @@
+/*****************************************************************************\
+ *  stepd_pool.h - pool of slurmstepd processes ready for a step launch
+ *****************************************************************************
+ *  This file is part of Slurm, a resource management program.
+ *  For details, see <https://slurm.schedmd.com/>.
+ *  Please also read the included file: DISCLAIMER.
+ *
+ *  Slurm is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 2 of the License, or (at your option)
+ *  any later version.
+ *
+ *  In addition, as a special exception, the copyright holders give permission
+ *  to link the code of portions of this program with the OpenSSL library under
+ *  certain conditions as described in each individual source file, and
+ *  distribute linked combinations including the two. You must obey the GNU
+ *  General Public License in all respects for all of the code used other than
+ *  OpenSSL. If you modify file(s) with this exception, you may extend this
+ *  exception to your version of the file(s), but you are not obligated to do
+ *  so. If you do not wish to do so, delete this exception statement from your
+ *  version.  If you delete this exception statement from all source files in
+ *  the program, then also delete it here.
+ *
+ *  Slurm is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with Slurm; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA.
+\*****************************************************************************/
+
+#ifndef _SLURMD_STEPD_POOL_H
+#define _SLURMD_STEPD_POOL_H
+
+/*
+ * Fork and exec a slurmstepd with argv, connected to the slurmd through
+ * two pipes. The slurmstepd is a grandchild of the slurmd so its parent
+ * will be init.
+ * OUT to_stepd - write end of the pipe to the slurmstepd's stdin
+ * OUT to_slurmd - read end of the pipe from the slurmstepd's stdout
+ * RET SLURM_SUCCESS or SLURM_ERROR
+ */
+extern int stepd_spawn(char *const argv[], int *to_stepd, int *to_slurmd);
+
+/*
+ * Take a slurmstepd from the pool. The slurmstepd has already been exec'd
+ * and loaded its plugins and is waiting for its initialization data.
+ * A replacement is started in the background.
+ * OUT to_stepd - write end of the pipe to the slurmstepd's stdin
+ * OUT to_slurmd - read end of the pipe from the slurmstepd's stdout
+ * RET SLURM_SUCCESS or SLURM_ERROR if the pool is disabled or empty
+ */
+extern int stepd_pool_get(int *to_stepd, int *to_slurmd);
+
+/*
+ * Start LaunchParameters=slurmstepd_pool=# processes. Called at startup
+ * and on reconfigure, in which case the slurmstepd processes started with
+ * the old configuration are released first.
+ */
+extern void stepd_pool_init(void);
+
+/* Release all pooled slurmstepd processes */
+extern void stepd_pool_fini(void);
+
+#endif	/* _SLURMD_STEPD_POOL_H */
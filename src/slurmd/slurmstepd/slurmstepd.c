@@ -40,6 +40,7 @@
 
 #include "config.h"
 
+#include <poll.h>
 #include <signal.h>
 #include <stdlib.h>
 #include <sys/mman.h>
@@ -88,6 +89,7 @@ static stepd_step_rec_t *_step_setup(slurm_addr_t *cli, slurm_addr_t *self,
 static void _step_cleanup(stepd_step_rec_t *job, slurm_msg_t *msg, int rc);
 #endif
 static int _process_cmdline (int argc, char **argv);
+static bool _slurmd_closed(int fd);
 
 /*
  *  List of signals to block in this process
@@ -130,6 +132,13 @@ main (int argc, char **argv)
 	if (slurm_auth_init(NULL) != SLURM_SUCCESS)
 		fatal( "failed to initialize authentication plugin" );
 
+	/*
+	 * A slurmstepd started ahead of time for the slurmd's pool waits
+	 * here, and is released without a job by the slurmd closing stdin.
+	 */
+	if (_slurmd_closed(STDIN_FILENO))
+		return 0;
+
 	/* Receive job parameters from the slurmd */
 	_init_from_slurmd(STDIN_FILENO, argv, &cli, &self, &msg);
 
@@ -415,6 +424,25 @@ static int _handle_spank_mode (int argc, char **argv)
 	return (0);
 }
 
+/*
+ * Wait for the slurmd to send something or close the pipe.
+ * RET true if the pipe was closed without any data
+ */
+static bool _slurmd_closed(int fd)
+{
+	struct pollfd pfd = {
+		.fd = fd,
+		.events = POLLIN,
+	};
+
+	while (poll(&pfd, 1, -1) < 0) {
+		if ((errno != EINTR) && (errno != EAGAIN))
+			return false;
+	}
+
+	return ((pfd.revents & POLLHUP) && !(pfd.revents & POLLIN));
+}
+
 /*
  *  Process special "modes" of slurmstepd passed as cmdline arguments.
  */
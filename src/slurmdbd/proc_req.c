@@ -60,6 +60,7 @@
 #include "src/slurmdbd/read_config.h"
 #include "src/slurmdbd/rpc_mgr.h"
 #include "src/slurmdbd/proc_req.h"
+#include "src/slurmdbd/query_cache.h"
 #include "src/slurmdbd/slurmdbd.h"
 #include "src/slurmctld/slurmctld.h"
 
@@ -669,6 +670,8 @@ end_it:
 		xfree(slurmdbd_conn->tres_str);
 		slurmdbd_conn->tres_str = cluster_tres_msg->tres_str;
 		cluster_tres_msg->tres_str = NULL;
+		/* cached DBD_GET_CLUSTERS answers hold the old TRES */
+		query_cache_flush();
 	}
 	if (!slurmdbd_conn->conn->rem_port) {
 		debug3("DBD_CLUSTER_TRES: cluster not registered");
@@ -1353,6 +1356,13 @@ static int _fini_conn(slurmdbd_conn_t *slurmdbd_conn, persist_msg_t *msg,
 	if (locked)
 		slurm_mutex_unlock(&registered_lock);
 
+	/*
+	 * Not every change is pushed to the assoc_mgr (e.g. account
+	 * descriptions), so drop cached queries whenever changes are committed.
+	 */
+	if (fini_msg->commit)
+		query_cache_flush();
+
 	*out_buffer = slurm_persist_make_rc_msg(slurmdbd_conn->conn,
 						rc, comment, DBD_FINI);
 	return rc;
@@ -2309,6 +2319,8 @@ end_it:
 		slurmdbd_conn->conn->rem_port = register_ctld_msg->port;
 
 		_add_registered_cluster(slurmdbd_conn);
+		/* cached DBD_GET_CLUSTERS answers hold the old control host */
+		query_cache_flush();
 	}
 
 	*out_buffer = slurm_persist_make_rc_msg(slurmdbd_conn->conn,
@@ -3139,10 +3151,31 @@ extern int proc_req(void *conn, persist_msg_t *msg, buf_t **out_buffer,
 	int rc = SLURM_SUCCESS;
 	char *comment = NULL;
 	slurmdb_rpc_obj_t *rpc_obj;
+	buf_t *cache_key = NULL;
+	uint32_t cache_gen = 0;
 
 	DEF_TIMERS;
 	START_TIMER;
 
+	if ((cache_key = query_cache_key(slurmdbd_conn, msg, *uid))) {
+		bool hit = false;
+
+		if ((*out_buffer = query_cache_get(cache_key, &cache_gen))) {
+			hit = true;
+			FREE_NULL_BUFFER(cache_key);
+			debug2("%s: served from query cache",
+			       slurmdbd_msg_type_2_str(msg->msg_type, 1));
+		}
+		slurm_mutex_lock(&rpc_mutex);
+		if (hit)
+			rpc_stats.query_cache_hits++;
+		else
+			rpc_stats.query_cache_misses++;
+		slurm_mutex_unlock(&rpc_mutex);
+		if (hit)
+			goto end_it;
+	}
+
 	switch (msg->msg_type) {
 	case REQUEST_PERSIST_INIT:
 		rc = _unpack_persist_init(slurmdbd_conn, msg, out_buffer, uid);
@@ -3375,6 +3408,14 @@ extern int proc_req(void *conn, persist_msg_t *msg, buf_t **out_buffer,
 		acct_storage_g_commit(slurmdbd_conn->db_conn, 1);
 	}
 
+	if (cache_key) {
+		if ((rc == SLURM_SUCCESS) && *out_buffer)
+			query_cache_add(cache_key, cache_gen, *out_buffer);
+		else
+			FREE_NULL_BUFFER(cache_key);
+	}
+
+end_it:
 	END_TIMER;
 
 	slurm_mutex_lock(&rpc_mutex);
@@ -0,0 +1,238 @@
+/*****************************************************************************\
+ *  query_cache.c - cache of packed responses to read-only queries
+ *****************************************************************************
+ *  This file is part of Slurm, a resource management program.
+ *  For details, see <https://slurm.schedmd.com/>.
+ *  Please also read the included file: DISCLAIMER.
+ *
+ *  Slurm is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 2 of the License, or (at your option)
+ *  any later version.
+ *
+ *  In addition, as a special exception, the copyright holders give permission
+ *  to link the code of portions of this program with the OpenSSL library under
+ *  certain conditions as described in each individual source file, and
+ *  distribute linked combinations including the two. You must obey the GNU
+ *  General Public License in all respects for all of the code used other than
+ *  OpenSSL. If you modify file(s) with this exception, you may extend this
+ *  exception to your version of the file(s), but you are not obligated to do
+ *  so. If you do not wish to do so, delete this exception statement from your
+ *  version.  If you delete this exception statement from all source files in
+ *  the program, then also delete it here.
+ *
+ *  Slurm is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with Slurm; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA.
+\*****************************************************************************/
+
+#include "src/common/list.h"
+#include "src/common/slurmdbd_defs.h"
+#include "src/common/slurmdbd_pack.h"
+#include "src/common/xhash.h"
+#include "src/common/xmalloc.h"
+#include "src/common/xstring.h"
+#include "src/slurmdbd/query_cache.h"
+#include "src/slurmdbd/read_config.h"
+
+#define DEFAULT_QUERY_CACHE_SIZE 64	/* MB */
+
+typedef struct {
+	buf_t *key;
+	buf_t *response;
+} query_cache_entry_t;
+
+static pthread_mutex_t cache_mutex = PTHREAD_MUTEX_INITIALIZER;
+static xhash_t *cache_hash = NULL;
+static List cache_list = NULL;		/* entries, oldest first */
+static uint64_t cache_bytes = 0;
+static uint64_t cache_max_bytes = 0;
+static uint32_t cache_gen = 0;
+
+static void _entry_id(void *item, const char **key, uint32_t *key_len)
+{
+	query_cache_entry_t *entry = item;
+
+	*key = get_buf_data(entry->key);
+	*key_len = get_buf_offset(entry->key);
+}
+
+static void _free_entry(void *x)
+{
+	query_cache_entry_t *entry = x;
+
+	if (!entry)
+		return;
+	FREE_NULL_BUFFER(entry->key);
+	FREE_NULL_BUFFER(entry->response);
+	xfree(entry);
+}
+
+static uint32_t _entry_size(query_cache_entry_t *entry)
+{
+	return get_buf_offset(entry->key) + get_buf_offset(entry->response);
+}
+
+static buf_t *_copy_buf(buf_t *buffer)
+{
+	uint32_t size = get_buf_offset(buffer);
+	buf_t *copy = init_buf(size);
+
+	memcpy(get_buf_data(copy), get_buf_data(buffer), size);
+	set_buf_offset(copy, size);
+
+	return copy;
+}
+
+/* cache_mutex must be locked before calling this */
+static void _flush_locked(void)
+{
+	cache_gen++;
+	if (cache_hash)
+		xhash_clear(cache_hash);
+	if (cache_list)
+		list_flush(cache_list);
+	cache_bytes = 0;
+}
+
+/*
+ * Only lists which change through the update path (sacctmgr/commits) or
+ * rollups are cached. Job, step and event queries change with every message
+ * from a slurmctld and are never cached.
+ */
+static bool _cacheable(uint16_t msg_type)
+{
+	switch (msg_type) {
+	case DBD_GET_ACCOUNTS:
+	case DBD_GET_ASSOCS:
+	case DBD_GET_ASSOC_USAGE:
+	case DBD_GET_CLUSTERS:
+	case DBD_GET_CLUSTER_USAGE:
+	case DBD_GET_QOS:
+	case DBD_GET_TRES:
+	case DBD_GET_USERS:
+	case DBD_GET_WCKEYS:
+	case DBD_GET_WCKEY_USAGE:
+		return true;
+	default:
+		return false;
+	}
+}
+
+extern void query_cache_init(void)
+{
+	char *tmp_ptr;
+	uint64_t size_mb = DEFAULT_QUERY_CACHE_SIZE;
+
+	/*                                                  0123456789012345 */
+	if ((tmp_ptr = xstrcasestr(slurmdbd_conf->parameters,
+				   "QueryCacheSize=")))
+		size_mb = strtoull(tmp_ptr + 15, NULL, 10);
+
+	slurm_mutex_lock(&cache_mutex);
+	if (!cache_hash)
+		cache_hash = xhash_init(_entry_id, NULL);
+	if (!cache_list)
+		cache_list = list_create(_free_entry);
+	_flush_locked();
+	cache_max_bytes = size_mb * 1024 * 1024;
+	slurm_mutex_unlock(&cache_mutex);
+
+	debug("%s: query cache size is %"PRIu64"MB", __func__, size_mb);
+}
+
+extern void query_cache_fini(void)
+{
+	slurm_mutex_lock(&cache_mutex);
+	xhash_free(cache_hash);
+	FREE_NULL_LIST(cache_list);
+	cache_bytes = 0;
+	cache_max_bytes = 0;
+	slurm_mutex_unlock(&cache_mutex);
+}
+
+extern buf_t *query_cache_key(slurmdbd_conn_t *slurmdbd_conn,
+			      persist_msg_t *msg, uint32_t uid)
+{
+	buf_t *key, *buffer;
+
+	if (!cache_max_bytes || !_cacheable(msg->msg_type))
+		return NULL;
+
+	/* Same message packed with the same version gives the same bytes */
+	if (!(buffer = pack_slurmdbd_msg(msg, slurmdbd_conn->conn->version)))
+		return NULL;
+
+	/*
+	 * The response also depends on who asks (PrivateData, coordinators),
+	 * the protocol version it is packed with and, for DBD_GET_USERS, the
+	 * cluster of the connection.
+	 */
+	key = init_buf(get_buf_offset(buffer) + 64);
+	pack32(uid, key);
+	pack16(slurmdbd_conn->conn->version, key);
+	packstr(slurmdbd_conn->conn->cluster_name, key);
+	packmem(get_buf_data(buffer), get_buf_offset(buffer), key);
+	free_buf(buffer);
+
+	return key;
+}
+
+extern buf_t *query_cache_get(buf_t *key, uint32_t *gen)
+{
+	query_cache_entry_t *entry;
+	buf_t *response = NULL;
+
+	slurm_mutex_lock(&cache_mutex);
+	*gen = cache_gen;
+	if (cache_hash &&
+	    (entry = xhash_get(cache_hash, get_buf_data(key),
+			       get_buf_offset(key))))
+		response = _copy_buf(entry->response);
+	slurm_mutex_unlock(&cache_mutex);
+
+	return response;
+}
+
+extern void query_cache_add(buf_t *key, uint32_t gen, buf_t *response)
+{
+	query_cache_entry_t *entry = xmalloc(sizeof(*entry)), *old;
+
+	entry->key = key;
+	entry->response = _copy_buf(response);
+
+	slurm_mutex_lock(&cache_mutex);
+	if (!cache_hash || (gen != cache_gen) ||
+	    (_entry_size(entry) > cache_max_bytes) ||
+	    xhash_get(cache_hash, get_buf_data(key), get_buf_offset(key))) {
+		slurm_mutex_unlock(&cache_mutex);
+		_free_entry(entry);
+		return;
+	}
+
+	/* Make room by dropping the oldest entries */
+	while ((cache_bytes + _entry_size(entry) > cache_max_bytes) &&
+	       (old = list_pop(cache_list))) {
+		xhash_delete(cache_hash, get_buf_data(old->key),
+			     get_buf_offset(old->key));
+		cache_bytes -= _entry_size(old);
+		_free_entry(old);
+	}
+
+	xhash_add(cache_hash, entry);
+	list_append(cache_list, entry);
+	cache_bytes += _entry_size(entry);
+	slurm_mutex_unlock(&cache_mutex);
+}
+
+extern void query_cache_flush(void)
+{
+	slurm_mutex_lock(&cache_mutex);
+	_flush_locked();
+	slurm_mutex_unlock(&cache_mutex);
+}
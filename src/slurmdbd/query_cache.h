@@ -0,0 +1,77 @@
+/*****************************************************************************\
+ *  query_cache.h - cache of packed responses to read-only queries
+ *****************************************************************************
+ *  This file is part of Slurm, a resource management program.
+ *  For details, see <https://slurm.schedmd.com/>.
+ *  Please also read the included file: DISCLAIMER.
+ *
+ *  Slurm is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 2 of the License, or (at your option)
+ *  any later version.
+ *
+ *  In addition, as a special exception, the copyright holders give permission
+ *  to link the code of portions of this program with the OpenSSL library under
+ *  certain conditions as described in each individual source file, and
+ *  distribute linked combinations including the two. You must obey the GNU
+ *  General Public License in all respects for all of the code used other than
+ *  OpenSSL. If you modify file(s) with this exception, you may extend this
+ *  exception to your version of the file(s), but you are not obligated to do
+ *  so. If you do not wish to do so, delete this exception statement from your
+ *  version.  If you delete this exception statement from all source files in
+ *  the program, then also delete it here.
+ *
+ *  Slurm is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with Slurm; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA.
+\*****************************************************************************/
+
+#ifndef _QUERY_CACHE_H
+#define _QUERY_CACHE_H
+
+#include "src/common/pack.h"
+#include "src/common/slurm_persist_conn.h"
+#include "src/slurmdbd/proc_req.h"
+
+/* Set up or resize the cache from slurmdbd_conf, dropping anything cached */
+extern void query_cache_init(void);
+
+/* Free everything cached */
+extern void query_cache_fini(void);
+
+/*
+ * Build the cache key for a request.
+ * RET key to be handed to query_cache_get()/query_cache_add(), or NULL if
+ *     the request is not cacheable or the cache is disabled.
+ */
+extern buf_t *query_cache_key(slurmdbd_conn_t *slurmdbd_conn,
+			      persist_msg_t *msg, uint32_t uid);
+
+/*
+ * Look up a cached response.
+ * key IN - from query_cache_key()
+ * gen OUT - cache generation to hand to query_cache_add() on a miss
+ * RET copy of the packed response, must be freed by caller, or NULL
+ */
+extern buf_t *query_cache_get(buf_t *key, uint32_t *gen);
+
+/*
+ * Cache a packed response. Nothing is cached if the cache was flushed since
+ * gen was obtained, as the response may already be stale.
+ * key IN - consumed by this function
+ */
+extern void query_cache_add(buf_t *key, uint32_t gen, buf_t *response);
+
+/*
+ * Drop everything cached, called whenever the database changes: when a
+ * commit pushes updates to the assoc_mgr, when a client commits its
+ * changes, when a cluster record changes and after rollups.
+ */
+extern void query_cache_flush(void);
+
+#endif /* !_QUERY_CACHE_H */
@@ -37,7 +37,10 @@
  *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA.
 \*****************************************************************************/
 
+#define _GNU_SOURCE
+
 #include <arpa/inet.h>
+#include <fcntl.h>
 #include <poll.h>
 #include <pthread.h>
 #include <signal.h>
@@ -46,6 +49,7 @@
 #include <sys/types.h>
 
 #include "src/common/fd.h"
+#include "src/common/list.h"
 #include "src/common/log.h"
 #include "src/common/macros.h"
 #include "src/common/slurm_protocol_api.h"
@@ -53,24 +57,222 @@
 #include "src/common/slurmdbd_defs.h"
 #include "src/common/xmalloc.h"
 #include "src/common/xsignal.h"
+#include "src/common/xstring.h"
 #include "src/slurmdbd/proc_req.h"
+#include "src/slurmdbd/query_cache.h"
 #include "src/slurmdbd/read_config.h"
 #include "src/slurmdbd/rpc_mgr.h"
 #include "src/slurmdbd/slurmdbd.h"
 
+#define DEFAULT_RPC_WORKERS 16
+#define MAX_CONNECTIONS 100	/* as many as persist_conn had threads */
+
+/*
+ * A connection being serviced. Idle connections are polled by the rpc_mgr
+ * thread; once data arrives the connection is queued for the worker pool,
+ * which reads what has arrived, processes the message if it is now whole and
+ * hands the connection back. A message arriving in pieces is kept with the
+ * connection until the rest comes, no worker waits for it. A connection is
+ * thus never worked on by more than one worker at a time.
+ */
+typedef struct {
+	slurmdbd_conn_t *dbd_conn;
+	bool first;		/* next message is the first one */
+	uint32_t uid;		/* user ID who initiated the RPCs */
+} rpc_conn_t;
+
 /* Local functions */
 static void _connection_fini_callback(void *arg);
 
 /* Local variables */
 static pthread_t       master_thread_id = 0;
+static int             wake_fd[2] = { -1, -1 };
+
+static pthread_mutex_t work_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t  work_cond = PTHREAD_COND_INITIALIZER;
+static List            ctld_queue = NULL;	/* slurmctld traffic */
+static List            user_queue = NULL;	/* everything else */
+static List            ready_list = NULL;	/* back from the workers */
+static pthread_t      *worker_tids = NULL;
+static int             worker_cnt = 0;
+static int             conn_cnt = 0;	/* open connections */
+
+/*
+ * Messages from a slurmctld are always handled before user queries so that
+ * accounting updates keep flowing while sacct/sreport requests pile up.
+ */
+static bool _is_ctld_conn(rpc_conn_t *rpc_conn)
+{
+	slurm_persist_conn_t *conn = rpc_conn->dbd_conn->conn;
+
+	if (conn->rem_port || (conn->flags & PERSIST_FLAG_EXT_DBD))
+		return true;
+	if (!rpc_conn->first && (rpc_conn->uid == slurm_conf.slurm_user_id))
+		return true;
+	return false;
+}
+
+static void _wake_rpc_mgr(void)
+{
+	char c = 0;
+
+	if ((wake_fd[1] >= 0) && (write(wake_fd[1], &c, 1) < 0) &&
+	    (errno != EAGAIN))
+		error("%s: write: %m", __func__);
+}
+
+static rpc_conn_t *_create_rpc_conn(int newsockfd, slurm_addr_t *cli_addr)
+{
+	rpc_conn_t *rpc_conn = xmalloc(sizeof(*rpc_conn));
+	slurmdbd_conn_t *conn_arg = xmalloc(sizeof(slurmdbd_conn_t));
+
+	conn_arg->conn = xmalloc(sizeof(slurm_persist_conn_t));
+	conn_arg->conn->fd = newsockfd;
+	conn_arg->conn->flags = PERSIST_FLAG_DBD | PERSIST_FLAG_NONBLOCK;
+	conn_arg->conn->callback_proc = proc_req;
+	conn_arg->conn->callback_fini = _connection_fini_callback;
+	conn_arg->conn->shutdown = &shutdown_time;
+	conn_arg->conn->version = SLURM_MIN_PROTOCOL_VERSION;
+	conn_arg->conn->rem_host = xmalloc(INET6_ADDRSTRLEN);
+	/* Don't fill in the rem_port here.  It will be filled in
+	 * later if it is a slurmctld connection. */
+	slurm_get_ip_str(cli_addr, conn_arg->conn->rem_host,
+			 INET6_ADDRSTRLEN);
+
+	rpc_conn->dbd_conn = conn_arg;
+	rpc_conn->first = true;
+	rpc_conn->uid = NO_VAL;
+
+	slurm_mutex_lock(&work_mutex);
+	conn_cnt++;
+	slurm_mutex_unlock(&work_mutex);
+
+	log_flag(NET, "%s: Opened connection %d from %s",
+		 __func__, newsockfd, conn_arg->conn->rem_host);
+
+	return rpc_conn;
+}
+
+static void _destroy_rpc_conn(void *x)
+{
+	rpc_conn_t *rpc_conn = x;
+	slurm_persist_conn_t *conn;
+
+	if (!rpc_conn)
+		return;
+
+	conn = rpc_conn->dbd_conn->conn;
+	log_flag(NET, "%s: Closed connection host:%s fd:%d uid:%d",
+		 __func__, conn->rem_host, conn->fd, rpc_conn->uid);
+
+	/* frees dbd_conn but not the persist_conn */
+	(conn->callback_fini)(rpc_conn->dbd_conn);
+	slurm_persist_conn_destroy(conn);
+	xfree(rpc_conn);
+
+	slurm_mutex_lock(&work_mutex);
+	conn_cnt--;
+	slurm_mutex_unlock(&work_mutex);
+}
+
+/*
+ * The first worker only takes slurmctld messages, so that a slurmctld is never
+ * left waiting behind a pool full of slow user queries.
+ */
+static void *_rpc_worker(void *arg)
+{
+	bool ctld_only = (arg != NULL);
+	rpc_conn_t *rpc_conn;
+	int rc;
+
+	while (1) {
+		slurm_mutex_lock(&work_mutex);
+		while (!shutdown_time && !list_count(ctld_queue) &&
+		       (ctld_only || !list_count(user_queue)))
+			slurm_cond_wait(&work_cond, &work_mutex);
+		if (shutdown_time) {
+			slurm_mutex_unlock(&work_mutex);
+			break;
+		}
+		if (!(rpc_conn = list_dequeue(ctld_queue)))
+			rpc_conn = list_dequeue(user_queue);
+		slurm_mutex_unlock(&work_mutex);
+
+		rc = slurm_persist_conn_process_service_msg(
+			rpc_conn->dbd_conn->conn, rpc_conn->dbd_conn,
+			&rpc_conn->first, &rpc_conn->uid);
+
+		slurm_mutex_lock(&work_mutex);
+		if ((rc == SLURM_SUCCESS) && !shutdown_time) {
+			list_append(ready_list, rpc_conn);
+			rpc_conn = NULL;
+		}
+		slurm_mutex_unlock(&work_mutex);
+
+		/* Either way the rpc_mgr has something to poll or accept */
+		if (rpc_conn)
+			_destroy_rpc_conn(rpc_conn);
+		_wake_rpc_mgr();
+	}
+
+	return NULL;
+}
+
+static void _start_workers(void)
+{
+	char *tmp_ptr;
+	int i;
+
+	worker_cnt = DEFAULT_RPC_WORKERS;
+	/*                                        01234567890 */
+	if ((tmp_ptr = xstrcasestr(slurmdbd_conf->parameters, "RPCWorkers=")))
+		worker_cnt = atoi(tmp_ptr + 11);
+	if (worker_cnt < 1) {
+		error("Invalid Parameters RPCWorkers, using %d",
+		      DEFAULT_RPC_WORKERS);
+		worker_cnt = DEFAULT_RPC_WORKERS;
+	}
+	debug("%s: starting %d RPC worker threads", __func__, worker_cnt);
+
+	worker_tids = xcalloc(worker_cnt, sizeof(pthread_t));
+	for (i = 0; i < worker_cnt; i++) {
+		/* Keep one worker for slurmctld if there are several */
+		slurm_thread_create(&worker_tids[i], _rpc_worker,
+				    ((i == 0) && (worker_cnt > 1)) ?
+				    (void *) 1 : NULL);
+	}
+}
+
+static void _stop_workers(void)
+{
+	int i;
+
+	slurm_mutex_lock(&work_mutex);
+	slurm_cond_broadcast(&work_cond);
+	slurm_mutex_unlock(&work_mutex);
+
+	/* Interrupt any worker blocked on a client */
+	for (i = 0; i < worker_cnt; i++)
+		pthread_kill(worker_tids[i], SIGUSR1);
+	for (i = 0; i < worker_cnt; i++)
+		pthread_join(worker_tids[i], NULL);
+	xfree(worker_tids);
+	worker_cnt = 0;
+}
 
 /* Process incoming RPCs. Meant to execute as a pthread */
 extern void *rpc_mgr(void *no_data)
 {
 	int sockfd, newsockfd;
-	int i;
+	int i, nfds, rc;
 	slurm_addr_t cli_addr;
-	slurmdbd_conn_t *conn_arg = NULL;
+	rpc_conn_t *rpc_conn;
+	struct pollfd *ufds = NULL;
+	rpc_conn_t **poll_conns = NULL;
+	List idle_list = list_create(_destroy_rpc_conn);
+	int max_fds = 0;
+	bool queued, conn_limit = false;
+	char buf[64];
 
 	master_thread_id = pthread_self();
 
@@ -79,13 +281,86 @@ extern void *rpc_mgr(void *no_data)
 	    == SLURM_ERROR)
 		fatal("slurm_init_msg_engine_port error %m");
 
+	if (pipe2(wake_fd, O_CLOEXEC | O_NONBLOCK))
+		fatal("%s: pipe2: %m", __func__);
+
 	slurm_persist_conn_recv_server_init();
 
+	slurm_mutex_lock(&work_mutex);
+	ctld_queue = list_create(NULL);
+	user_queue = list_create(NULL);
+	ready_list = list_create(NULL);
+	slurm_mutex_unlock(&work_mutex);
+
+	_start_workers();
+
 	/*
 	 * Process incoming RPCs until told to shutdown
 	 */
-	while (!shutdown_time &&
-	       (i = slurm_persist_conn_wait_for_thread_loc()) >= 0) {
+	while (!shutdown_time) {
+		nfds = list_count(idle_list) + 2;
+		if (nfds > max_fds) {
+			max_fds = nfds * 2;
+			xrecalloc(ufds, max_fds, sizeof(*ufds));
+			xrecalloc(poll_conns, max_fds, sizeof(*poll_conns));
+		}
+		/*
+		 * Stop accepting while at the connection limit, new clients
+		 * wait in the listen backlog until a connection closes.
+		 */
+		slurm_mutex_lock(&work_mutex);
+		if ((conn_cnt >= MAX_CONNECTIONS) != conn_limit) {
+			conn_limit = !conn_limit;
+			if (conn_limit)
+				debug("%s: %d connections open, not accepting",
+				      __func__, conn_cnt);
+		}
+		slurm_mutex_unlock(&work_mutex);
+		ufds[0].fd = conn_limit ? -1 : sockfd;
+		ufds[0].events = POLLIN;
+		ufds[1].fd = wake_fd[0];
+		ufds[1].events = POLLIN;
+		nfds = 2;
+		while ((rpc_conn = list_pop(idle_list))) {
+			ufds[nfds].fd = rpc_conn->dbd_conn->conn->fd;
+			ufds[nfds].events = POLLIN;
+			poll_conns[nfds++] = rpc_conn;
+		}
+
+		if ((rc = poll(ufds, nfds, -1)) < 0) {
+			if ((errno != EINTR) && (errno != EAGAIN))
+				error("%s: poll: %m", __func__);
+		}
+
+		/* Hand connections with something to read to the workers */
+		queued = false;
+		slurm_mutex_lock(&work_mutex);
+		for (i = 2; i < nfds; i++) {
+			rpc_conn = poll_conns[i];
+			if ((rc <= 0) || !ufds[i].revents) {
+				list_append(idle_list, rpc_conn);
+				continue;
+			}
+			if (_is_ctld_conn(rpc_conn))
+				list_append(ctld_queue, rpc_conn);
+			else
+				list_append(user_queue, rpc_conn);
+			queued = true;
+		}
+		/* Not a signal, it could go to the slurmctld-only worker */
+		if (queued)
+			slurm_cond_broadcast(&work_cond);
+		list_transfer(idle_list, ready_list);
+		slurm_mutex_unlock(&work_mutex);
+
+		if ((rc > 0) && ufds[1].revents) {
+			while (read(wake_fd[0], buf, sizeof(buf)) > 0)
+				;
+		}
+
+		if ((rc <= 0) || !ufds[0].revents || shutdown_time)
+			continue;
+
 		/*
 		 * accept needed for stream implementation is a no-op in
 		 * message implementation that just passes sockfd to newsockfd
@@ -93,42 +368,44 @@ extern void *rpc_mgr(void *no_data)
 		if ((newsockfd = slurm_accept_msg_conn(sockfd,
 						       &cli_addr)) ==
 		    SLURM_ERROR) {
-			slurm_persist_conn_free_thread_loc(i);
 			if (errno != EINTR)
 				error("slurm_accept_msg_conn: %m");
 			continue;
 		}
 		fd_set_nonblocking(newsockfd);
 
-		conn_arg = xmalloc(sizeof(slurmdbd_conn_t));
-		conn_arg->conn = xmalloc(sizeof(slurm_persist_conn_t));
-		conn_arg->conn->fd = newsockfd;
-		conn_arg->conn->flags = PERSIST_FLAG_DBD;
-		conn_arg->conn->callback_proc = proc_req;
-		conn_arg->conn->callback_fini = _connection_fini_callback;
-		conn_arg->conn->shutdown = &shutdown_time;
-		conn_arg->conn->version = SLURM_MIN_PROTOCOL_VERSION;
-		conn_arg->conn->rem_host = xmalloc(INET6_ADDRSTRLEN);
-		/* Don't fill in the rem_port here.  It will be filled in
-		 * later if it is a slurmctld connection. */
-		slurm_get_ip_str(&cli_addr, conn_arg->conn->rem_host,
-				 INET6_ADDRSTRLEN);
-
-		slurm_persist_conn_recv_thread_init(
-			conn_arg->conn, i, conn_arg);
+		list_append(idle_list, _create_rpc_conn(newsockfd, &cli_addr));
 	}
 
 	debug("rpc_mgr shutting down");
+	_stop_workers();
+
+	slurm_mutex_lock(&work_mutex);
+	list_transfer(idle_list, ready_list);
+	list_transfer(idle_list, ctld_queue);
+	list_transfer(idle_list, user_queue);
+	FREE_NULL_LIST(ready_list);
+	FREE_NULL_LIST(ctld_queue);
+	FREE_NULL_LIST(user_queue);
+	slurm_mutex_unlock(&work_mutex);
+	FREE_NULL_LIST(idle_list);
+
+	xfree(ufds);
+	xfree(poll_conns);
+	close(wake_fd[0]);
+	close(wake_fd[1]);
+	wake_fd[0] = wake_fd[1] = -1;
 	close(sockfd);
 	pthread_exit((void *) 0);
 	return NULL;
 }
 
-/* Wake up the RPC manager and all spawned threads so they can exit */
+/* Wake up the RPC manager and all worker threads so they can exit */
 extern void rpc_mgr_wake(void)
 {
 	if (master_thread_id)
 		pthread_kill(master_thread_id, SIGUSR1);
+	_wake_rpc_mgr();
 	slurm_persist_conn_recv_server_fini();
 }
 
@@ -172,6 +449,8 @@ static void _connection_fini_callback(void *arg)
 		}
 		/* needs to be the last thing done */
 		acct_storage_g_commit(conn->db_conn, 1);
+		/* the cluster record no longer has a control host */
+		query_cache_flush();
 	}
 
 	acct_storage_g_close_connection(&conn->db_conn);
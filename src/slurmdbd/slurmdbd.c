@@ -70,6 +70,7 @@
 #include "src/slurmdbd/read_config.h"
 #include "src/slurmdbd/rpc_mgr.h"
 #include "src/slurmdbd/proc_req.h"
+#include "src/slurmdbd/query_cache.h"
 #include "src/slurmdbd/backup.h"
 
 /* Global variables */
@@ -185,6 +186,8 @@ int main(int argc, char **argv)
 
 	slurm_thread_create(&commit_handler_thread, _commit_handler, NULL);
 
+	query_cache_init();
+
 	memset(&assoc_init_arg, 0, sizeof(assoc_init_args_t));
 
 	/*
@@ -195,6 +198,8 @@ int main(int argc, char **argv)
 		ASSOC_MGR_CACHE_QOS | ASSOC_MGR_CACHE_TRES;
 	if (slurmdbd_conf->track_wckey)
 		assoc_init_arg.cache_level |= ASSOC_MGR_CACHE_WCKEY;
+	/* Updates pushed by a commit can change any cached query */
+	assoc_init_arg.update_notify = query_cache_flush;
 
 	db_conn = acct_storage_g_get_connection(0, NULL, true, NULL);
 	if (assoc_mgr_init(db_conn, &assoc_init_arg, errno) == SLURM_ERROR) {
@@ -316,6 +321,7 @@ end_it:
 		_restart_self(argc, argv);
 	}
 
+	query_cache_fini();
 	assoc_mgr_fini(0);
 	slurm_acct_storage_fini();
 	slurm_auth_fini();
@@ -333,6 +339,7 @@ extern void reconfig(void)
 	assoc_mgr_set_missing_uids();
 	acct_storage_g_reconfig(NULL, 0);
 	_update_logging(false);
+	query_cache_init();
 }
 
 extern void handle_rollup_stats(List rollup_stats_list,
@@ -343,6 +350,9 @@ extern void handle_rollup_stats(List rollup_stats_list,
 
 	xassert(type < DBD_ROLLUP_COUNT);
 
+	/* Usage queries cached before the rollup are now out of date */
+	query_cache_flush();
+
 	slurm_mutex_lock(&rpc_mutex);
 	rollup_stats = rpc_stats.dbd_rollup_stats;
 
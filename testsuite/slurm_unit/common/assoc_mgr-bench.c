@@ -0,0 +1,157 @@
+/*
+ * Benchmark of the association lookups done for each job submission in
+ * src/common/assoc_mgr.c, run against a synthetic association tree.
+ *
+ * Usage: assoc_mgr-bench [user_count] [lookup_count]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <src/common/assoc_mgr.h>
+#include <src/common/list.h>
+#include <src/common/read_config.h>
+#include <src/common/timers.h>
+#include <src/common/xmalloc.h>
+#include <src/common/xstring.h>
+
+#define ACCT_CNT 1000
+#define USER_UID_BASE 50000
+#define CLUSTER_NAME "cluster"
+
+static void _update(uint16_t type, List objects)
+{
+	slurmdb_update_object_t *object = xmalloc(sizeof(*object));
+	List update_list = list_create(slurmdb_destroy_update_object);
+
+	object->type = type;
+	object->objects = objects;
+	list_append(update_list, object);
+	assoc_mgr_update(update_list, false);
+	FREE_NULL_LIST(update_list);
+}
+
+static slurmdb_assoc_rec_t *_make_assoc(uint32_t id, uint32_t parent_id,
+					char *acct, char *parent_acct,
+					char *user, bool is_def)
+{
+	slurmdb_assoc_rec_t *assoc = xmalloc(sizeof(*assoc));
+
+	slurmdb_init_assoc_rec(assoc, false);
+	assoc->cluster = xstrdup(CLUSTER_NAME);
+	assoc->id = id;
+	assoc->parent_id = parent_id;
+	assoc->acct = acct;
+	assoc->parent_acct = xstrdup(parent_acct);
+	assoc->user = user;
+	assoc->is_def = is_def;
+	assoc->shares_raw = 1;
+	assoc->lft = id;
+	assoc->rgt = id;
+
+	return assoc;
+}
+
+/* Every user has an association in each of 2 accounts */
+static void _build_tree(int user_cnt)
+{
+	List objects = list_create(slurmdb_destroy_user_rec);
+	uint32_t id = 1;
+	int i;
+
+	for (i = 0; i < user_cnt; i++) {
+		slurmdb_user_rec_t *user = xmalloc(sizeof(*user));
+
+		user->admin_level = SLURMDB_ADMIN_NOTSET;
+		user->name = xstrdup_printf("%d", USER_UID_BASE + i);
+		list_append(objects, user);
+	}
+	_update(SLURMDB_ADD_USER, objects);
+
+	objects = list_create(slurmdb_destroy_assoc_rec);
+	list_append(objects, _make_assoc(id++, 0, xstrdup("root"), NULL, NULL,
+					 false));
+	for (i = 0; i < ACCT_CNT; i++)
+		list_append(objects,
+			    _make_assoc(id++, 1, xstrdup_printf("acct%d", i),
+					"root", NULL, false));
+	for (i = 0; i < user_cnt; i++) {
+		list_append(objects,
+			    _make_assoc(id++, 2 + (i % ACCT_CNT),
+					xstrdup_printf("acct%d", i % ACCT_CNT),
+					NULL,
+					xstrdup_printf("%d", USER_UID_BASE + i),
+					true));
+		list_append(objects,
+			    _make_assoc(id++, 2 + ((i + 1) % ACCT_CNT),
+					xstrdup_printf("acct%d",
+						       (i + 1) % ACCT_CNT),
+					NULL,
+					xstrdup_printf("%d", USER_UID_BASE + i),
+					false));
+	}
+	_update(SLURMDB_ADD_ASSOC, objects);
+}
+
+/* Lookups done by job_submit() and _job_create() for one job */
+static void _submit(uint32_t uid)
+{
+	slurmdb_user_rec_t user;
+	slurmdb_assoc_rec_t assoc;
+	slurmdb_assoc_rec_t *assoc_ptr = NULL;
+
+	memset(&user, 0, sizeof(user));
+	user.uid = uid;
+	assoc_mgr_fill_in_user(NULL, &user, ACCOUNTING_ENFORCE_ASSOCS, NULL,
+			       false);
+
+	memset(&assoc, 0, sizeof(assoc));
+	assoc.uid = uid;
+	assoc.acct = user.default_acct;
+	if (assoc_mgr_fill_in_assoc(NULL, &assoc, ACCOUNTING_ENFORCE_ASSOCS,
+				    &assoc_ptr, false) != SLURM_SUCCESS)
+		fprintf(stderr, "no association for uid %u\n", uid);
+
+	(void) assoc_mgr_is_user_acct_coord(NULL, uid, user.default_acct);
+}
+
+int main(int argc, char *argv[])
+{
+	DEF_TIMERS;
+	int user_cnt = 50000, lookup_cnt = 100000, i;
+	long usec;
+
+	if (argc > 1)
+		user_cnt = atoi(argv[1]);
+	if (argc > 2)
+		lookup_cnt = atoi(argv[2]);
+	if ((user_cnt <= 0) || (lookup_cnt <= 0)) {
+		fprintf(stderr, "Usage: %s [user_count] [lookup_count]\n",
+			argv[0]);
+		return 1;
+	}
+
+	slurm_conf.cluster_name = xstrdup(CLUSTER_NAME);
+	g_tres_count = 1;
+	assoc_mgr_user_list = list_create(slurmdb_destroy_user_rec);
+	assoc_mgr_assoc_list = list_create(slurmdb_destroy_assoc_rec);
+	assoc_mgr_qos_list = list_create(slurmdb_destroy_qos_rec);
+
+	START_TIMER;
+	_build_tree(user_cnt);
+	END_TIMER;
+	usec = DELTA_TIMER;
+	printf("built %d users and %d associations in %ld usec\n",
+	       user_cnt, list_count(assoc_mgr_assoc_list), usec);
+
+	START_TIMER;
+	for (i = 0; i < lookup_cnt; i++)
+		_submit(USER_UID_BASE + ((i * 7919) % user_cnt));
+	END_TIMER;
+	usec = DELTA_TIMER;
+	printf("%d submissions in %ld usec (%.3f usec per submission)\n",
+	       lookup_cnt, usec, (double) usec / lookup_cnt);
+
+	assoc_mgr_fini(false);
+	xfree(slurm_conf.cluster_name);
+
+	return 0;
+}
@@ -0,0 +1,346 @@
+/*
+ * Test of the association, user and coordinator lookups in
+ * src/common/assoc_mgr.c
+ *
+ * Avoid duplicate wait() symbol definition (in both testsuite/dejagnu.h
+ * and sys/wait.h
+ */
+#define _SYS_WAIT_H 1
+#include <stdlib.h>
+#include <src/common/assoc_mgr.h>
+#include <src/common/list.h>
+#include <src/common/read_config.h>
+#include <src/common/xmalloc.h>
+#include <src/common/xstring.h>
+#include <testsuite/dejagnu.h>
+
+/*
+ * Test for failure:
+ */
+#define TEST(_tst, _msg) do {		\
+	if (! (_tst))			\
+		fail( _msg );		\
+	else				\
+		pass( _msg );		\
+} while (0)
+
+#define ACCT_CNT 20
+#define USER_CNT 200
+#define USER_UID_BASE 50000
+#define CLUSTER_NAME "cluster"
+
+static void _update(uint16_t type, List objects)
+{
+	slurmdb_update_object_t *object = xmalloc(sizeof(*object));
+	List update_list = list_create(slurmdb_destroy_update_object);
+
+	object->type = type;
+	object->objects = objects;
+	list_append(update_list, object);
+	assoc_mgr_update(update_list, false);
+	FREE_NULL_LIST(update_list);
+}
+
+static slurmdb_assoc_rec_t *_make_assoc(uint32_t id, uint32_t parent_id,
+					char *acct, char *parent_acct,
+					char *user, bool is_def)
+{
+	slurmdb_assoc_rec_t *assoc = xmalloc(sizeof(*assoc));
+
+	slurmdb_init_assoc_rec(assoc, false);
+	assoc->cluster = xstrdup(CLUSTER_NAME);
+	assoc->id = id;
+	assoc->parent_id = parent_id;
+	assoc->acct = xstrdup(acct);
+	assoc->parent_acct = xstrdup(parent_acct);
+	assoc->user = xstrdup(user);
+	assoc->is_def = is_def;
+	assoc->priority = 0;
+	assoc->shares_raw = 1;
+	assoc->lft = id;
+	assoc->rgt = id;
+
+	return assoc;
+}
+
+static char *_acct_name(int i)
+{
+	return xstrdup_printf("acct%d", i);
+}
+
+static char *_user_name(int i)
+{
+	return xstrdup_printf("%d", USER_UID_BASE + i);
+}
+
+/* Every user has an association in each of 2 accounts */
+static void _build_tree(void)
+{
+	List objects = list_create(slurmdb_destroy_user_rec);
+	uint32_t id = 1;
+	int i;
+
+	for (i = 0; i < USER_CNT; i++) {
+		slurmdb_user_rec_t *user = xmalloc(sizeof(*user));
+
+		user->admin_level = SLURMDB_ADMIN_NOTSET;
+		user->name = _user_name(i);
+		list_append(objects, user);
+	}
+	_update(SLURMDB_ADD_USER, objects);
+
+	objects = list_create(slurmdb_destroy_assoc_rec);
+	list_append(objects, _make_assoc(id++, 0, "root", NULL, NULL, false));
+	for (i = 0; i < ACCT_CNT; i++) {
+		char *acct = _acct_name(i);
+
+		list_append(objects,
+			    _make_assoc(id++, 1, acct, "root", NULL, false));
+		xfree(acct);
+	}
+	for (i = 0; i < USER_CNT; i++) {
+		char *user = _user_name(i);
+		char *acct = _acct_name(i % ACCT_CNT);
+		char *acct2 = _acct_name((i + 1) % ACCT_CNT);
+
+		list_append(objects,
+			    _make_assoc(id++, 2 + (i % ACCT_CNT), acct, NULL,
+					user, true));
+		list_append(objects,
+			    _make_assoc(id++, 2 + ((i + 1) % ACCT_CNT), acct2,
+					NULL, user, false));
+		xfree(user);
+		xfree(acct);
+		xfree(acct2);
+	}
+	_update(SLURMDB_ADD_ASSOC, objects);
+}
+
+static void _post_tres(void)
+{
+	List tres_list = list_create(slurmdb_destroy_tres_rec);
+	slurmdb_tres_rec_t *tres = xmalloc(sizeof(*tres));
+
+	tres->id = TRES_CPU;
+	tres->type = xstrdup("cpu");
+	list_append(tres_list, tres);
+	tres = xmalloc(sizeof(*tres));
+	tres->id = TRES_MEM;
+	tres->type = xstrdup("mem");
+	list_append(tres_list, tres);
+	assoc_mgr_post_tres_list(tres_list);
+}
+
+static void _update_qos(uint16_t type, uint32_t id, char *name)
+{
+	List objects = list_create(slurmdb_destroy_qos_rec);
+	slurmdb_qos_rec_t *qos = xmalloc(sizeof(*qos));
+
+	slurmdb_init_qos_rec(qos, false, 0);
+	qos->id = id;
+	qos->name = xstrdup(name);
+	list_append(objects, qos);
+	_update(type, objects);
+}
+
+static int _user_assoc_cnt(uint32_t uid)
+{
+	assoc_mgr_lock_t locks = { .assoc = READ_LOCK };
+	slurmdb_assoc_rec_t assoc;
+	List assoc_list = list_create(NULL);
+	int cnt;
+
+	memset(&assoc, 0, sizeof(assoc));
+	assoc.uid = uid;
+	assoc_mgr_lock(&locks);
+	assoc_mgr_get_user_assocs(NULL, &assoc, 0, assoc_list);
+	assoc_mgr_unlock(&locks);
+	cnt = list_count(assoc_list);
+	FREE_NULL_LIST(assoc_list);
+
+	return cnt;
+}
+
+static int _fill_in_user(uint32_t uid, char *name, char **default_acct)
+{
+	slurmdb_user_rec_t user;
+	slurmdb_user_rec_t *user_ptr = NULL;
+
+	memset(&user, 0, sizeof(user));
+	user.uid = uid;
+	user.name = name;
+	if (assoc_mgr_fill_in_user(NULL, &user, ACCOUNTING_ENFORCE_ASSOCS,
+				   &user_ptr, false) != SLURM_SUCCESS)
+		return SLURM_ERROR;
+	if (default_acct)
+		*default_acct = user.default_acct;
+
+	return user_ptr ? SLURM_SUCCESS : SLURM_ERROR;
+}
+
+static uint32_t _fill_in_assoc(uint32_t uid, char *acct)
+{
+	slurmdb_assoc_rec_t assoc;
+
+	memset(&assoc, 0, sizeof(assoc));
+	assoc.uid = uid;
+	assoc.acct = acct;
+	if (assoc_mgr_fill_in_assoc(NULL, &assoc, ACCOUNTING_ENFORCE_ASSOCS,
+				    NULL, false) != SLURM_SUCCESS)
+		return 0;
+
+	return assoc.id;
+}
+
+int main(int argc, char *argv[])
+{
+	List objects;
+	slurmdb_user_rec_t *user;
+	slurmdb_coord_rec_t *coord;
+	char *default_acct = NULL;
+	uint32_t uid = USER_UID_BASE + 7;
+	uint32_t assoc_id;
+	assoc_mgr_lock_t locks = { .assoc = READ_LOCK, .user = READ_LOCK };
+	slurmdb_assoc_rec_t assoc, assoc_live, *assoc_ptr = NULL;
+	slurmdb_qos_rec_t qos;
+	slurmdb_tres_rec_t tres;
+	uint64_t tres_cnt[2] = { 4, 1024 };
+	char *name;
+
+	slurm_conf.cluster_name = xstrdup(CLUSTER_NAME);
+	_post_tres();
+	assoc_mgr_user_list = list_create(slurmdb_destroy_user_rec);
+	assoc_mgr_assoc_list = list_create(slurmdb_destroy_assoc_rec);
+	assoc_mgr_qos_list = list_create(slurmdb_destroy_qos_rec);
+
+	_build_tree();
+
+	note("Testing user lookups");
+	TEST(list_count(assoc_mgr_user_list) == USER_CNT, "users added");
+	TEST(_fill_in_user(uid, NULL, &default_acct) == SLURM_SUCCESS,
+	     "user found by uid");
+	TEST(!xstrcmp(default_acct, "acct7"), "default account set");
+	TEST(_fill_in_user(NO_VAL, "50007", NULL) == SLURM_SUCCESS,
+	     "user found by name");
+	TEST(_fill_in_user(USER_UID_BASE + USER_CNT, NULL, NULL) ==
+	     SLURM_ERROR, "unknown uid not found");
+	TEST(_fill_in_user(NO_VAL, "nosuchuser", NULL) == SLURM_ERROR,
+	     "unknown name not found");
+
+	note("Testing association lookups");
+	TEST(_user_assoc_cnt(uid) == 2, "user has 2 associations");
+	TEST(_user_assoc_cnt(USER_UID_BASE + USER_CNT) == 0,
+	     "unknown uid has no associations");
+	TEST(_fill_in_assoc(uid, "acct8") != 0, "association found by acct");
+	TEST(_fill_in_assoc(uid, "acct9") == 0,
+	     "no association in other account");
+	TEST(_fill_in_assoc(uid, NULL) == _fill_in_assoc(uid, "acct7"),
+	     "default account association found");
+
+	memset(&assoc, 0, sizeof(assoc));
+	assoc.uid = uid;
+	assoc.acct = "acct8";
+	assoc_live = assoc;
+	assoc_mgr_fill_in_assoc(NULL, &assoc, ACCOUNTING_ENFORCE_ASSOCS,
+				NULL, false);
+	assoc_mgr_lock(&locks);
+	assoc_mgr_fill_in_assoc(NULL, &assoc_live, ACCOUNTING_ENFORCE_ASSOCS,
+				&assoc_ptr, true);
+	TEST(assoc_ptr && (assoc.id == assoc_ptr->id) &&
+	     !xstrcmp(assoc.cluster, assoc_ptr->cluster) &&
+	     (assoc.cluster != assoc_ptr->cluster),
+	     "unlocked lookup hands out copies");
+	assoc_mgr_unlock(&locks);
+
+	note("Testing QOS and TRES lookups");
+	_update_qos(SLURMDB_ADD_QOS, 3, "high");
+	memset(&qos, 0, sizeof(qos));
+	qos.name = "high";
+	TEST((assoc_mgr_fill_in_qos(NULL, &qos, ACCOUNTING_ENFORCE_QOS, NULL,
+				    false) == SLURM_SUCCESS) && (qos.id == 3),
+	     "QOS found by name");
+	name = assoc_mgr_get_qos_name(3);
+	TEST(!xstrcmp(name, "high"), "QOS name found by id");
+	xfree(name);
+	_update_qos(SLURMDB_REMOVE_QOS, 3, NULL);
+	memset(&qos, 0, sizeof(qos));
+	qos.name = "high";
+	TEST(assoc_mgr_fill_in_qos(NULL, &qos, ACCOUNTING_ENFORCE_QOS, NULL,
+				   false) == SLURM_ERROR, "removed QOS gone");
+	TEST(!assoc_mgr_get_qos_name(3), "removed QOS name gone");
+
+	memset(&tres, 0, sizeof(tres));
+	tres.type = "mem";
+	TEST(assoc_mgr_find_tres_pos(&tres, false) == 1, "TRES found by type");
+	name = assoc_mgr_make_tres_str_from_array(tres_cnt, 0, false);
+	TEST(!xstrcmp(name, "cpu=4,mem=1024"), "TRES string made");
+	xfree(name);
+
+	note("Testing coordinator lookups");
+	TEST(!assoc_mgr_is_user_acct_coord(NULL, uid, "acct7"),
+	     "user is not a coordinator yet");
+	objects = list_create(slurmdb_destroy_user_rec);
+	user = xmalloc(sizeof(*user));
+	user->admin_level = SLURMDB_ADMIN_NOTSET;
+	user->name = xstrdup("50007");
+	user->coord_accts = list_create(slurmdb_destroy_coord_rec);
+	coord = xmalloc(sizeof(*coord));
+	coord->name = xstrdup("acct7");
+	list_append(user->coord_accts, coord);
+	list_append(objects, user);
+	_update(SLURMDB_ADD_COORD, objects);
+	TEST(assoc_mgr_is_user_acct_coord(NULL, uid, "acct7"),
+	     "user is a coordinator");
+	TEST(!assoc_mgr_is_user_acct_coord(NULL, uid, "acct8"),
+	     "user is not a coordinator of other account");
+
+	note("Testing index updates");
+	objects = list_create(slurmdb_destroy_user_rec);
+	user = xmalloc(sizeof(*user));
+	user->admin_level = SLURMDB_ADMIN_NOTSET;
+	user->old_name = xstrdup("50007");
+	user->name = xstrdup("60007");
+	list_append(objects, user);
+	_update(SLURMDB_MODIFY_USER, objects);
+	TEST(_fill_in_user(NO_VAL, "50007", NULL) == SLURM_ERROR,
+	     "old user name gone");
+	TEST(_fill_in_user(uid, NULL, NULL) == SLURM_ERROR,
+	     "old user uid gone");
+	TEST(_fill_in_user(60007, "60007", NULL) == SLURM_SUCCESS,
+	     "renamed user found");
+	TEST(_user_assoc_cnt(60007) == 2, "associations follow renamed user");
+	TEST(_user_assoc_cnt(uid) == 0, "no associations left on old uid");
+
+	assoc_id = _fill_in_assoc(60007, "acct8");
+	TEST(assoc_mgr_validate_assoc_id(NULL, assoc_id,
+					 ACCOUNTING_ENFORCE_ASSOCS) ==
+	     SLURM_SUCCESS, "association id valid");
+	objects = list_create(slurmdb_destroy_assoc_rec);
+	list_append(objects, _make_assoc(assoc_id, 0, NULL, NULL, NULL,
+					 false));
+	_update(SLURMDB_REMOVE_ASSOC, objects);
+	TEST(_user_assoc_cnt(60007) == 1, "removed association gone");
+	TEST(assoc_mgr_validate_assoc_id(NULL, assoc_id,
+					 ACCOUNTING_ENFORCE_ASSOCS) ==
+	     SLURM_ERROR, "removed association id no longer valid");
+	TEST(assoc_mgr_validate_assoc_id(NULL, _fill_in_assoc(60007, "acct7"),
+					 ACCOUNTING_ENFORCE_ASSOCS) ==
+	     SLURM_SUCCESS, "other association id still valid");
+
+	objects = list_create(slurmdb_destroy_user_rec);
+	user = xmalloc(sizeof(*user));
+	user->admin_level = SLURMDB_ADMIN_NOTSET;
+	user->name = xstrdup("60007");
+	list_append(objects, user);
+	_update(SLURMDB_REMOVE_USER, objects);
+	TEST(_fill_in_user(60007, NULL, NULL) == SLURM_ERROR,
+	     "removed user gone");
+	TEST(_fill_in_user(USER_UID_BASE + 8, NULL, NULL) == SLURM_SUCCESS,
+	     "other users still found");
+
+	assoc_mgr_fini(false);
+	xfree(slurm_conf.cluster_name);
+
+	totals();
+	return failed;
+}
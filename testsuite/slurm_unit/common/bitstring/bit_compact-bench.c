@@ -0,0 +1,123 @@
+/*
+ * Benchmark of bit_compact() in src/common/bitstring.c on a synthetic large
+ * cluster job load: one node bitmap per running job, most jobs using one or
+ * a few nodes. Reports the heap used by the dense and compressed bitmaps and
+ * the time for a scheduler style sweep testing each job against a bitmap of
+ * available nodes.
+ *
+ * Usage: bit_compact-bench [node_count] [job_count]
+ */
+#include <malloc.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/time.h>
+#include <src/common/bitstring.h>
+#include <src/common/xmalloc.h>
+
+static size_t _heap_used(void)
+{
+	struct mallinfo2 mi = mallinfo2();
+
+	return mi.uordblks + mi.hblkhd;
+}
+
+/* 70% of jobs on 1 node, 20% on 2-16 nodes and 10% on 17-512 nodes */
+static int _job_nodes(void)
+{
+	int r = rand() % 10;
+
+	if (r < 7)
+		return 1;
+	if (r < 9)
+		return 2 + rand() % 15;
+	return 17 + rand() % 496;
+}
+
+static bitstr_t **_build(int node_cnt, int job_cnt, bool compact,
+			 size_t *heap)
+{
+	bitstr_t **jobs = xcalloc(job_cnt, sizeof(bitstr_t *));
+	size_t before;
+
+	srand(1);
+	before = _heap_used();
+	for (int i = 0; i < job_cnt; i++) {
+		int cnt = _job_nodes(), first = rand() % (node_cnt - cnt + 1);
+
+		jobs[i] = bit_alloc(node_cnt);
+		bit_nset(jobs[i], first, first + cnt - 1);
+		/* an occasional fragmented allocation */
+		if (!(i % 50))
+			bit_set(jobs[i], rand() % node_cnt);
+		if (compact)
+			jobs[i] = bit_compact(jobs[i]);
+	}
+	*heap = _heap_used() - before;
+
+	return jobs;
+}
+
+static long _sweep(bitstr_t **jobs, int job_cnt, bitstr_t *avail,
+		   int *overlaps)
+{
+	struct timeval tv1, tv2;
+
+	*overlaps = 0;
+	gettimeofday(&tv1, NULL);
+	for (int i = 0; i < job_cnt; i++) {
+		if (bit_overlap_any(jobs[i], avail))
+			(*overlaps)++;
+	}
+	gettimeofday(&tv2, NULL);
+
+	return (tv2.tv_sec - tv1.tv_sec) * 1000000 +
+	       (tv2.tv_usec - tv1.tv_usec);
+}
+
+int main(int argc, char *argv[])
+{
+	int node_cnt = 100000, job_cnt = 100000, overlaps[2];
+	bitstr_t **jobs[2], *avail;
+	size_t heap[2];
+	long usec[2];
+
+	if (argc > 1)
+		node_cnt = atoi(argv[1]);
+	if (argc > 2)
+		job_cnt = atoi(argv[2]);
+	if ((argc > 3) || (node_cnt < 512) || (job_cnt < 1)) {
+		fprintf(stderr, "Usage: %s [node_count] [job_count]\n",
+			argv[0]);
+		return 1;
+	}
+
+	avail = bit_alloc(node_cnt);
+	for (int i = 0; i < node_cnt; i += 3)
+		bit_set(avail, i);
+
+	for (int c = 0; c < 2; c++) {
+		jobs[c] = _build(node_cnt, job_cnt, c, &heap[c]);
+		usec[c] = _sweep(jobs[c], job_cnt, avail, &overlaps[c]);
+		printf("%-10s %d jobs on %d nodes: %zu bytes (%.1f per job), "
+		       "overlap sweep %ld usec\n",
+		       c ? "compressed" : "dense", job_cnt, node_cnt, heap[c],
+		       (double) heap[c] / job_cnt, usec[c]);
+	}
+	if (overlaps[0] != overlaps[1]) {
+		fprintf(stderr, "overlap counts differ: %d != %d\n",
+			overlaps[0], overlaps[1]);
+		return 1;
+	}
+	printf("compressed bitmaps use %.2f%% of the dense memory\n",
+	       100.0 * heap[1] / heap[0]);
+
+	for (int c = 0; c < 2; c++) {
+		for (int i = 0; i < job_cnt; i++)
+			bit_free(jobs[c][i]);
+		xfree(jobs[c]);
+	}
+	bit_free(avail);
+
+	return 0;
+}
@@ -0,0 +1,149 @@
+/*
+ * Benchmark of the word kernels behind bit_and(), bit_and_not(), bit_or(),
+ * bit_set_count(), bit_set_count_range(), bit_overlap(), bit_overlap_any()
+ * and bit_and_count() in src/common/bitstring.c. Each operation runs over
+ * bitmaps of several sizes once for every kernel set the CPU supports,
+ * selected with SLURM_BITSTR_SIMD in a child process.
+ *
+ * Usage: bitstring-bench [bits_per_op_total]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <src/common/bitstring.h>
+
+#define DEFAULT_TOTAL_BITS (1L << 32)
+
+static bitoff_t sizes[] = { 1024, 16384, 131072, 1048576 };
+static volatile int64_t sink;
+
+typedef enum {
+	OP_AND,
+	OP_AND_NOT,
+	OP_OR,
+	OP_SET_COUNT,
+	OP_SET_COUNT_RANGE,
+	OP_OVERLAP,
+	OP_OVERLAP_ANY,
+	OP_AND_COUNT,
+	OP_CNT
+} op_t;
+
+static const char *op_names[] = {
+	"bit_and",
+	"bit_and_not",
+	"bit_or",
+	"bit_set_count",
+	"bit_set_count_range",
+	"bit_overlap",
+	"bit_overlap_any",
+	"bit_and_count",
+};
+
+static void _run_op(op_t op, bitstr_t *b1, bitstr_t *b2, bitoff_t nbits)
+{
+	switch (op) {
+	case OP_AND:
+		bit_and(b1, b2);
+		break;
+	case OP_AND_NOT:
+		bit_and_not(b1, b2);
+		break;
+	case OP_OR:
+		bit_or(b1, b2);
+		break;
+	case OP_SET_COUNT:
+		sink += bit_set_count(b1);
+		break;
+	case OP_SET_COUNT_RANGE:
+		sink += bit_set_count_range(b1, 3, nbits - 3);
+		break;
+	case OP_OVERLAP:
+		sink += bit_overlap(b1, b2);
+		break;
+	case OP_OVERLAP_ANY:
+		/* disjoint bitmaps, so every word is examined */
+		sink += bit_overlap_any(b1, b2);
+		break;
+	case OP_AND_COUNT:
+		sink += bit_and_count(b1, b2);
+		break;
+	default:
+		break;
+	}
+}
+
+static void _bench(int64_t total_bits)
+{
+	printf("%-8s %-20s %9s %10s %12s %10s\n", "kernels", "operation",
+	       "bits", "ops", "nsec/op", "Gbit/s");
+	for (int s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+		bitoff_t nbits = sizes[s];
+		int64_t iters = total_bits / nbits;
+
+		for (op_t op = 0; op < OP_CNT; op++) {
+			bitstr_t *b1 = bit_alloc(nbits), *b2 = bit_alloc(nbits);
+			struct timeval tv1, tv2;
+			double nsec;
+
+			/* even bits in b1 and odd bits in b2 */
+			for (bitoff_t i = 0; i < nbits; i += 2) {
+				bit_set(b1, i);
+				bit_set(b2, i + 1);
+			}
+
+			gettimeofday(&tv1, NULL);
+			for (int64_t i = 0; i < iters; i++)
+				_run_op(op, b1, b2, nbits);
+			gettimeofday(&tv2, NULL);
+
+			nsec = ((tv2.tv_sec - tv1.tv_sec) * 1e9 +
+				(tv2.tv_usec - tv1.tv_usec) * 1e3) / iters;
+			printf("%-8s %-20s %9"PRId64" %10"PRId64" %12.1f %10.2f\n",
+			       bit_simd_name(), op_names[op], nbits, iters,
+			       nsec, nbits / nsec);
+			bit_free(b1);
+			bit_free(b2);
+		}
+	}
+}
+
+int main(int argc, char *argv[])
+{
+	const char *kernels[] = { "generic", "avx2", "avx512" };
+	int64_t total_bits = DEFAULT_TOTAL_BITS;
+
+	if (argc > 1)
+		total_bits = strtoll(argv[1], NULL, 10);
+	if ((argc > 2) || (total_bits < sizes[0])) {
+		fprintf(stderr, "Usage: %s [bits_per_op_total]\n", argv[0]);
+		return 1;
+	}
+
+	for (int k = 0; k < sizeof(kernels) / sizeof(kernels[0]); k++) {
+		pid_t pid = fork();
+		int status = 0;
+
+		if (pid < 0) {
+			perror("fork");
+			return 1;
+		}
+		if (pid == 0) {
+			setenv("SLURM_BITSTR_SIMD", kernels[k], 1);
+			/* Skip kernels this CPU does not support */
+			if (strcmp(bit_simd_name(), kernels[k]))
+				_exit(0);
+			_bench(total_bits);
+			fflush(stdout);
+			_exit(0);
+		}
+		waitpid(pid, &status, 0);
+		if (!WIFEXITED(status) || WEXITSTATUS(status))
+			return 1;
+	}
+
+	return 0;
+}
@@ -1,7 +1,10 @@
 /* Test of src/bitstring.c 
  */
+#include <stdbool.h>
 #include <stdlib.h>
+#include <string.h>
 #include <src/common/bitstring.h>
+#include <src/common/xmalloc.h>
 #include <sys/time.h>
 #include <testsuite/dejagnu.h>
 
@@ -21,6 +24,12 @@
 } while (0)
 
 
+/* Count of bits set in b1 | b2 */
+static int _or_count(bitstr_t *b1, bitstr_t *b2)
+{
+	return bit_set_count(b1) + bit_set_count(b2) - bit_overlap(b1, b2);
+}
+
 int
 main(int argc, char *argv[])
 {
@@ -207,6 +216,240 @@ main(int argc, char *argv[])
 		TEST(bit_equal(bs, bs2), "bitstring");
 	}
 
+	note("Testing word kernels against bit by bit results");
+	{
+		int sizes[] = { 1, 63, 64, 65, 255, 256, 511, 512, 577, 1000,
+				4096, 4159 };
+		bool ok_and = true, ok_count = true, ok_overlap = true;
+		bool ok_any = true, ok_range = true, ok_or = true;
+
+		srand(42);
+		for (int s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+			int n = sizes[s], cnt1 = 0, cnt_and = 0, cnt_or = 0;
+			bitstr_t *b1 = bit_alloc(n), *b2 = bit_alloc(n);
+			bitstr_t *b3;
+
+			for (int i = 0; i < n; i++) {
+				if (rand() & 1)
+					bit_set(b1, i);
+				if (rand() & 1)
+					bit_set(b2, i);
+				if (bit_test(b1, i))
+					cnt1++;
+				if (bit_test(b1, i) && bit_test(b2, i))
+					cnt_and++;
+				if (bit_test(b1, i) || bit_test(b2, i))
+					cnt_or++;
+			}
+			if (bit_set_count(b1) != cnt1)
+				ok_count = false;
+			if (bit_set_count_range(b1, n / 3, n) !=
+			    bit_set_count(b1) - bit_set_count_range(b1, 0, n / 3))
+				ok_range = false;
+			if (bit_overlap(b1, b2) != cnt_and)
+				ok_overlap = false;
+			if (bit_overlap_any(b1, b2) != (cnt_and > 0))
+				ok_any = false;
+
+			b3 = bit_copy(b1);
+			bit_or(b3, b2);
+			if (bit_set_count(b3) != cnt_or)
+				ok_or = false;
+			bit_free(b3);
+
+			b3 = bit_copy(b1);
+			bit_and_not(b3, b2);
+			if (bit_set_count(b3) != cnt1 - cnt_and)
+				ok_and = false;
+			bit_free(b3);
+
+			if (bit_and_count(b1, b2) != cnt_and)
+				ok_and = false;
+			if (bit_set_count(b1) != cnt_and)
+				ok_and = false;
+
+			/* bits set past the end must not be counted */
+			bit_clear_all(b1);
+			bit_not(b1);
+			bit_nclear(b1, 0, n - 1);
+			bit_not(b2);
+			if (bit_set_count(b1) || bit_overlap(b1, b2) ||
+			    bit_overlap_any(b1, b2) || bit_and_count(b1, b2))
+				ok_any = false;
+
+			bit_free(b1);
+			bit_free(b2);
+		}
+		TEST(ok_count, "bit_set_count");
+		TEST(ok_range, "bit_set_count_range");
+		TEST(ok_overlap, "bit_overlap");
+		TEST(ok_any, "bit_overlap_any");
+		TEST(ok_or, "bit_or");
+		TEST(ok_and, "bit_and_not/bit_and_count");
+		note("word kernels: %s", bit_simd_name());
+	}
+
+	note("Testing compressed bitstrings against dense ones");
+	{
+		/* whole words, as dense bit_not() sets bits past the end */
+		int n = 10048, ok_ops = 1, ok_read = 1;
+		bitstr_t *dense = bit_alloc(n), *other = bit_alloc(n);
+		bitstr_t *rle, *rle2, *tmp;
+		char *s1, *s2;
+
+		bit_nset(dense, 100, 199);
+		bit_set(dense, 5000);
+		rle = bit_compact(bit_copy(dense));
+		TEST(rle != dense, "sparse bitmap compressed");
+		tmp = bit_copy(dense);
+		bit_nset(tmp, 0, n - 1);
+		rle2 = bit_compact(tmp);
+		TEST(rle2 != tmp, "full bitmap compressed");
+		bit_free(rle2);
+		tmp = bit_alloc(n);
+		for (int i = 0; i < n; i += 2)
+			bit_set(tmp, i);
+		TEST(bit_compact(tmp) == tmp, "dense bitmap left alone");
+		bit_free(tmp);
+		tmp = bit_alloc(100);
+		TEST(bit_compact(tmp) == tmp, "small bitmap left alone");
+		bit_free(tmp);
+
+		srand(7);
+		for (int iter = 0; iter < 2000; iter++) {
+			int a = rand() % n, b = rand() % n, op = rand() % 14;
+			int lo = (a < b) ? a : b, hi = (a < b) ? b : a;
+
+			bit_clear_all(other);
+			bit_nset(other, lo, hi);
+			bit_set(other, rand() % n);
+			rle2 = bit_compact(bit_copy(other));
+			switch (op) {
+			case 0:
+				bit_set(dense, a);
+				bit_set(rle, a);
+				break;
+			case 1:
+				bit_clear(dense, a);
+				bit_clear(rle, a);
+				break;
+			case 2:
+				bit_nset(dense, lo, hi);
+				bit_nset(rle, lo, hi);
+				break;
+			case 3:
+				bit_nclear(dense, lo, hi);
+				bit_nclear(rle, lo, hi);
+				break;
+			case 4:
+				bit_or(dense, other);
+				bit_or(rle, (iter & 1) ? rle2 : other);
+				break;
+			case 5:
+				bit_and_not(dense, other);
+				bit_and_not(rle, (iter & 1) ? rle2 : other);
+				break;
+			case 6:
+				bit_not(other);
+				bit_not(rle2);
+				bit_and(dense, other);
+				bit_and(rle, (iter & 1) ? rle2 : other);
+				break;
+			case 7:
+				if (bit_and_count(dense, other) !=
+				    bit_and_count(rle, rle2))
+					ok_ops = 0;
+				break;
+			case 8:
+				bit_not(dense);
+				bit_not(rle);
+				break;
+			case 9:
+				/* dense result from a compressed operand */
+				tmp = bit_copy(other);
+				bit_or(tmp, rle);
+				if (bit_set_count(tmp) != _or_count(other,
+								       dense))
+					ok_ops = 0;
+				bit_free(tmp);
+				break;
+			case 10:
+				bit_or_not(dense, other);
+				bit_or_not(rle, other);
+				break;
+			case 11:
+				bit_copybits(dense, other);
+				bit_copybits(rle, rle2);
+				break;
+			case 12:
+				bit_fill_gaps(dense);
+				bit_fill_gaps(rle);
+				break;
+			default:
+				bit_clear_all(dense);
+				bit_clear_all(rle);
+				break;
+			}
+			if (!bit_equal(dense, rle) ||
+			    (bit_set_count(dense) != bit_set_count(rle)) ||
+			    (bit_ffs(dense) != bit_ffs(rle)) ||
+			    (bit_fls(dense) != bit_fls(rle)) ||
+			    (bit_ffc(dense) != bit_ffc(rle)))
+				ok_ops = 0;
+			if ((bit_set_count_range(dense, lo, hi) !=
+			     bit_set_count_range(rle, lo, hi)) ||
+			    (bit_overlap(dense, other) !=
+			     bit_overlap(rle, rle2)) ||
+			    (bit_overlap(dense, other) !=
+			     bit_overlap(other, rle)) ||
+			    (bit_overlap_any(dense, other) !=
+			     bit_overlap_any(rle2, rle)) ||
+			    (bit_super_set(dense, other) !=
+			     bit_super_set(rle, rle2)) ||
+			    (bit_super_set(other, dense) !=
+			     bit_super_set(other, rle)) ||
+			    (bit_test(dense, a) != bit_test(rle, a)))
+				ok_read = 0;
+			bit_free(rle2);
+		}
+		TEST(ok_ops, "compressed updates match dense ones");
+		TEST(ok_read, "compressed queries match dense ones");
+
+		s1 = bit_fmt_full(dense);
+		s2 = bit_fmt_full(rle);
+		TEST(!strcmp(s1, s2), "bit_fmt_full");
+		xfree(s1);
+		xfree(s2);
+		s1 = bit_fmt_hexmask(dense);
+		s2 = bit_fmt_hexmask(rle);
+		TEST(!strcmp(s1, s2), "bit_fmt_hexmask");
+		xfree(s1);
+		xfree(s2);
+		{
+			int32_t *i1 = bitstr2inx(dense), *i2 = bitstr2inx(rle);
+			int same = 1, k;
+
+			for (k = 0; (i1[k] != -1) && (i1[k] == i2[k]); k++)
+				;
+			same = (i1[k] == i2[k]);
+			TEST(same, "bitstr2inx");
+			xfree(i1);
+			xfree(i2);
+		}
+		tmp = bit_copy(rle);
+		TEST(bit_equal(tmp, dense), "bit_copy");
+		bit_free(tmp);
+		rle = bit_realloc(rle, 3000);
+		dense = bit_realloc(dense, 3000);
+		TEST((bit_set_count(rle) == bit_set_count(dense)) &&
+		     (bit_overlap(rle, dense) == bit_set_count(dense)),
+		     "bit_realloc");
+
+		bit_free(rle);
+		bit_free(dense);
+		bit_free(other);
+	}
+
 	totals();
 	return failed;
 }
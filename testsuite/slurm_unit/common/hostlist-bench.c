@@ -0,0 +1,134 @@
+/*
+ * Benchmark of hostlist lookups on a large, fragmented hostlist: every
+ * other node of a cluster, so each host is a range of its own as after
+ * draining half of the nodes. Times hostlist_nth(), hostlist_find(),
+ * hostlist_copy() and hostlist_delete_host() and checks their results.
+ * Then copies and destroys a hostlist from several threads at once, each on
+ * its own hostlist, as all of them share the interned "node" prefix.
+ *
+ * Usage: hostlist-bench [host_count] [lookup_count] [thread_count]
+ */
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <src/common/hostlist.h>
+#include <src/common/timers.h>
+#include <src/common/xmalloc.h>
+
+#define THREAD_COPIES 10
+
+static void *_copy_thread(void *arg)
+{
+	hostlist_t hl = arg, copy;
+	int i;
+
+	for (i = 0; i < THREAD_COPIES; i++) {
+		copy = hostlist_copy(hl);
+		hostlist_destroy(copy);
+	}
+	return NULL;
+}
+
+int main(int argc, char **argv)
+{
+	int host_cnt = (argc > 1) ? atoi(argv[1]) : 100000;
+	int lookup_cnt = (argc > 2) ? atoi(argv[2]) : 20000;
+	int thread_cnt = (argc > 3) ? atoi(argv[3]) : 4;
+	DEF_TIMERS;
+	pthread_t *threads;
+	hostlist_t hl, copy, *thread_hl;
+	char name[64], *host;
+	int *order, i, j, tmp, errors = 0;
+
+	hl = hostlist_create(NULL);
+	for (i = 0; i < host_cnt; i++) {
+		snprintf(name, sizeof(name), "node%d", 2 * i);
+		hostlist_push_host(hl, name);
+	}
+	printf("%d hosts, %d lookups\n", hostlist_count(hl), lookup_cnt);
+
+	srandom(1);
+	order = xcalloc(host_cnt, sizeof(int));
+	for (i = 0; i < host_cnt; i++)
+		order[i] = i;
+	for (i = host_cnt - 1; i > 0; i--) {
+		j = random() % (i + 1);
+		tmp = order[i];
+		order[i] = order[j];
+		order[j] = tmp;
+	}
+
+	START_TIMER;
+	for (i = 0; i < lookup_cnt; i++) {
+		j = order[i % host_cnt];
+		snprintf(name, sizeof(name), "node%d", 2 * j);
+		host = hostlist_nth(hl, j);
+		if (!host || strcmp(host, name))
+			errors++;
+		free(host);
+	}
+	END_TIMER;
+	printf("%-14s %8d ops %s\n", "nth", lookup_cnt, TIME_STR);
+
+	START_TIMER;
+	for (i = 0; i < lookup_cnt; i++) {
+		j = order[i % host_cnt];
+		snprintf(name, sizeof(name), "node%d", 2 * j);
+		if (hostlist_find(hl, name) != j)
+			errors++;
+		snprintf(name, sizeof(name), "node%d", 2 * j + 1);
+		if (hostlist_find(hl, name) != -1)
+			errors++;
+	}
+	END_TIMER;
+	printf("%-14s %8d ops %s\n", "find", 2 * lookup_cnt, TIME_STR);
+
+	START_TIMER;
+	for (i = 0; i < 10; i++) {
+		copy = hostlist_copy(hl);
+		hostlist_destroy(copy);
+	}
+	END_TIMER;
+	printf("%-14s %8d ops %s\n", "copy+destroy", 10, TIME_STR);
+
+	threads = xcalloc(thread_cnt, sizeof(pthread_t));
+	thread_hl = xcalloc(thread_cnt, sizeof(hostlist_t));
+	for (i = 0; i < thread_cnt; i++)
+		thread_hl[i] = hostlist_copy(hl);
+	START_TIMER;
+	for (i = 0; i < thread_cnt; i++)
+		pthread_create(&threads[i], NULL, _copy_thread, thread_hl[i]);
+	for (i = 0; i < thread_cnt; i++)
+		pthread_join(threads[i], NULL);
+	snprintf(name, sizeof(name), "%d thr copy", thread_cnt);
+	END_TIMER;
+	printf("%-14s %8d ops %s\n",
+	       name, thread_cnt * THREAD_COPIES, TIME_STR);
+	for (i = 0; i < thread_cnt; i++) {
+		if (hostlist_count(thread_hl[i]) != host_cnt)
+			errors++;
+		hostlist_destroy(thread_hl[i]);
+	}
+	xfree(thread_hl);
+	xfree(threads);
+
+	j = (lookup_cnt < host_cnt) ? lookup_cnt : host_cnt;
+	START_TIMER;
+	for (i = 0; i < j; i++) {
+		snprintf(name, sizeof(name), "node%d", 2 * order[i]);
+		if (hostlist_delete_host(hl, name) != 1)
+			errors++;
+	}
+	END_TIMER;
+	printf("%-14s %8d ops %s\n", "delete_host", j, TIME_STR);
+	if (hostlist_count(hl) != host_cnt - j)
+		errors++;
+
+	hostlist_destroy(hl);
+	xfree(order);
+
+	if (errors)
+		printf("%d errors\n", errors);
+	return errors ? 1 : 0;
+}
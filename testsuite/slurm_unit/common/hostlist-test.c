@@ -0,0 +1,143 @@
+/*
+ * Test of hostlist_nth(), hostlist_find() and hostlist_delete_host() in
+ * src/common/hostlist.c against a plain array of the same host names,
+ * on hostlists large enough for the lookup index to be used.
+ *
+ * Avoid duplicate wait() symbol definition (in both testsuite/dejagnu.h
+ * and sys/wait.h
+ */
+#define _SYS_WAIT_H 1
+#include <stdlib.h>
+#include <string.h>
+#include <src/common/hostlist.h>
+#include <src/common/xmalloc.h>
+#include <src/common/xstring.h>
+#include <testsuite/dejagnu.h>
+
+/*
+ * Test for failure:
+ */
+#define TEST(_tst, _msg) do {		\
+	if (! (_tst))			\
+		fail( _msg );		\
+	else				\
+		pass( _msg );		\
+} while (0)
+
+static char **names;
+static int name_cnt;
+
+/* Position of the first host called name, as hostlist_find() reports */
+static int _find(const char *name)
+{
+	for (int i = 0; i < name_cnt; i++)
+		if (!xstrcmp(names[i], name))
+			return i;
+	return -1;
+}
+
+static void _delete(int n)
+{
+	xfree(names[n]);
+	memmove(&names[n], &names[n + 1], (name_cnt - n - 1) * sizeof(char *));
+	name_cnt--;
+}
+
+/* Repeat each lookup so the hostlist builds its index */
+static bool _check(hostlist_t hl)
+{
+	char *host;
+	int i, r;
+
+	if (hostlist_count(hl) != name_cnt)
+		return false;
+	for (r = 0; r < 2; r++) {
+		for (i = 0; i < name_cnt; i++) {
+			bool ok;
+
+			host = hostlist_nth(hl, i);
+			ok = !xstrcmp(host, names[i]);
+			free(host);
+			if (!ok || (hostlist_find(hl, names[i]) !=
+				    _find(names[i])))
+				return false;
+		}
+	}
+	if (hostlist_nth(hl, name_cnt) ||
+	    (hostlist_find(hl, "node99999") != -1) ||
+	    (hostlist_find(hl, "nohost") != -1))
+		return false;
+
+	return true;
+}
+
+static void _push(hostlist_t hl, const char *fmt, int num)
+{
+	char name[64];
+
+	snprintf(name, sizeof(name), fmt, num);
+	hostlist_push_host(hl, name);
+	xrealloc(names, (name_cnt + 1) * sizeof(char *));
+	names[name_cnt++] = xstrdup(name);
+}
+
+static void _test_hostlist(const char *desc, bool mixed)
+{
+	hostlist_t hl = hostlist_create(NULL);
+	hostlist_t copy;
+	bool ok = true;
+	char *name, *str;
+	int i, n;
+
+	srandom(42);
+	for (i = 0; i < 2000; i++) {
+		n = random() % 3000;
+		if (!mixed || (i % 3))
+			_push(hl, "node%d", n);
+		else if (i % 2)
+			_push(hl, "rack%d", n);
+		else
+			_push(hl, "gpu%d", n);
+		if (mixed && !(i % 97))
+			_push(hl, (i % 2) ? "login" : "admin", 0);
+	}
+
+	note("%s: %d hosts", desc, name_cnt);
+	TEST(_check(hl), "nth and find");
+
+	copy = hostlist_copy(hl);
+	name = hostlist_ranged_string_xmalloc(copy);
+	str = hostlist_ranged_string_xmalloc(hl);
+	TEST(!xstrcmp(name, str) && (hostlist_count(copy) == name_cnt),
+	     "copy");
+	xfree(name);
+	xfree(str);
+	hostlist_destroy(copy);
+
+	for (i = 0; ok && (name_cnt > 0); i++) {
+		name = xstrdup(names[random() % name_cnt]);
+		if (hostlist_delete_host(hl, name) != 1)
+			ok = false;
+		_delete(_find(name));
+		if (hostlist_find(hl, name) != _find(name))
+			ok = false;
+		xfree(name);
+		if (!(i % 100) && !_check(hl))
+			ok = false;
+	}
+	TEST(ok, "nth and find while deleting hosts");
+	TEST(hostlist_count(hl) == 0, "all hosts deleted");
+
+	hostlist_destroy(hl);
+	xfree(names);
+	name_cnt = 0;
+}
+
+int main(int argc, char *argv[])
+{
+	_test_hostlist("uniform prefix", false);
+	_test_hostlist("mixed prefixes", true);
+
+	totals();
+	return !(failed == 0);
+}
@@ -8,6 +8,7 @@
 #include <stdlib.h>
 #include <src/common/bitstring.h>
 #include <src/common/job_resources.h>
+#include <src/common/xstring.h>
 #include <sys/time.h>
 #include <testsuite/dejagnu.h>
 
@@ -48,10 +49,75 @@ static job_resources_t *_alloc_job_res(void)
 	return job;
 }
 
+/* Pack and unpack a job on 3 nodes, return the packed size or 0 on error */
+static uint32_t _pack_job_res(uint16_t protocol_version)
+{
+	job_resources_t *job, *job2 = NULL;
+	buf_t *buffer = init_buf(0);
+	uint32_t size = 0;
+	int i;
+
+	job = xmalloc(sizeof(job_resources_t));
+	job->nhosts = 3;
+	job->ncpus = 72;
+	job->nodes = xstrdup("node[1-3]");
+	job->cpu_array_cnt = 2;
+	job->cpu_array_reps = xcalloc(2, sizeof(uint32_t));
+	job->cpu_array_value = xcalloc(2, sizeof(uint16_t));
+	job->cpu_array_reps[0] = 2;
+	job->cpu_array_value[0] = 16;
+	job->cpu_array_reps[1] = 1;
+	job->cpu_array_value[1] = 40;
+	job->cpus = xcalloc(3, sizeof(uint16_t));
+	job->cpus_used = xcalloc(3, sizeof(uint16_t));
+	job->memory_allocated = xcalloc(3, sizeof(uint64_t));
+	job->memory_used = xcalloc(3, sizeof(uint64_t));
+	for (i = 0; i < 3; i++) {
+		job->cpus[i] = (i < 2) ? 16 : 40;
+		job->memory_allocated[i] = 4096 * (i + 1);
+	}
+	job->memory_used[2] = 0x123456789aULL;
+	job->sockets_per_node = xcalloc(2, sizeof(uint16_t));
+	job->cores_per_socket = xcalloc(2, sizeof(uint16_t));
+	job->sock_core_rep_count = xcalloc(2, sizeof(uint32_t));
+	job->sockets_per_node[0] = 2;
+	job->cores_per_socket[0] = 8;
+	job->sock_core_rep_count[0] = 2;
+	job->sockets_per_node[1] = 2;
+	job->cores_per_socket[1] = 20;
+	job->sock_core_rep_count[1] = 1;
+	job->core_bitmap = bit_alloc(72);
+	job->core_bitmap_used = bit_alloc(72);
+	bit_nset(job->core_bitmap, 0, 71);
+
+	pack_job_resources(job, buffer, protocol_version);
+	set_buf_offset(buffer, 0);
+	if ((unpack_job_resources(&job2, buffer, protocol_version) ==
+	     SLURM_SUCCESS) && job2 &&
+	    (job2->nhosts == 3) && (job2->ncpus == 72) &&
+	    !xstrcmp(job2->nodes, "node[1-3]") &&
+	    (job2->cpu_array_cnt == 2) &&
+	    (job2->cpu_array_reps[1] == 1) &&
+	    (job2->cpu_array_value[1] == 40) &&
+	    (job2->cpus[2] == 40) && (job2->cpus_used[2] == 0) &&
+	    (job2->memory_allocated[2] == 12288) &&
+	    (job2->memory_used[2] == 0x123456789aULL) &&
+	    (job2->cores_per_socket[1] == 20) &&
+	    (job2->sock_core_rep_count[0] == 2) &&
+	    bit_equal(job->core_bitmap, job2->core_bitmap))
+		size = get_buf_offset(buffer);
+
+	free_job_resources(&job);
+	free_job_resources(&job2);
+	free_buf(buffer);
+	return size;
+}
+
 int
 main(int argc, char *argv[])
 {
 	job_resources_t *job1, *job2;
+	uint32_t size1, size2, size3;
 
 	note("Testing job_resources_or");
 	job1 = _alloc_job_res();
@@ -157,6 +223,16 @@ main(int argc, char *argv[])
 	_free_job_res(job1);
 	_free_job_res(job2);
 
+	note("Testing pack_job_resources");
+	size1 = _pack_job_res(SLURM_20_11_PROTOCOL_VERSION);
+	size2 = _pack_job_res(SLURM_21_08_PROTOCOL_VERSION);
+	size3 = _pack_job_res(SLURM_21_08_1_PROTOCOL_VERSION);
+	TEST(size1, "un/pack_job_resources");
+	TEST(size2 == size1, "21.08 keeps the fixed width encoding");
+	TEST(size3, "un/pack_job_resources compact");
+	note("packed %u bytes, %u compact", size1, size3);
+	TEST(size3 < size1, "compact encoding is smaller");
+
 	totals();
 	return failed;
 }
@@ -0,0 +1,107 @@
+/*
+ * Benchmark of list node and iterator allocation under multithreaded
+ * churn. Each thread repeatedly appends items to a list of its own and
+ * removes them through an iterator, then all threads pass items through a
+ * shared queue so nodes are freed by other threads than the ones which
+ * allocated them. Prints the list allocation counts at the end.
+ *
+ * Usage: list-bench [thread_count] [item_count] [loop_count]
+ */
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <src/common/list.h>
+#include <src/common/timers.h>
+#include <src/common/xmalloc.h>
+
+static int item_cnt, loop_cnt;
+static List queue;
+static long errors = 0;
+
+static void *_churn(void *arg)
+{
+	List l = list_create(NULL);
+	ListIterator itr;
+	long i, j, sum;
+	void *x;
+
+	for (i = 0; i < loop_cnt; i++) {
+		for (j = 1; j <= item_cnt; j++)
+			list_append(l, (void *) j);
+		sum = 0;
+		itr = list_iterator_create(l);
+		while ((x = list_next(itr))) {
+			sum += (long) x;
+			list_remove(itr);
+		}
+		list_iterator_destroy(itr);
+		if (sum != ((long) item_cnt * (item_cnt + 1)) / 2)
+			__sync_fetch_and_add(&errors, 1);
+	}
+	FREE_NULL_LIST(l);
+
+	return NULL;
+}
+
+static void *_queue(void *arg)
+{
+	long i, got = 0;
+
+	for (i = 1; i <= (long) item_cnt * loop_cnt; i++) {
+		list_enqueue(queue, (void *) i);
+		if (list_dequeue(queue))
+			got++;
+	}
+	if (got != (long) item_cnt * loop_cnt)
+		__sync_fetch_and_add(&errors, 1);
+
+	return NULL;
+}
+
+static void _run(const char *name, void *(*func)(void *), int thread_cnt)
+{
+	pthread_t *threads = xcalloc(thread_cnt, sizeof(pthread_t));
+	DEF_TIMERS;
+	int i;
+
+	START_TIMER;
+	for (i = 0; i < thread_cnt; i++)
+		pthread_create(&threads[i], NULL, func, NULL);
+	for (i = 0; i < thread_cnt; i++)
+		pthread_join(threads[i], NULL);
+	END_TIMER;
+	printf("%-14s %10ld ops %s\n",
+	       name, 2L * thread_cnt * item_cnt * loop_cnt, TIME_STR);
+	xfree(threads);
+}
+
+int main(int argc, char **argv)
+{
+	int thread_cnt = (argc > 1) ? atoi(argv[1]) : 8;
+	list_alloc_stats_t node_stats, itr_stats;
+
+	item_cnt = (argc > 2) ? atoi(argv[2]) : 1000;
+	loop_cnt = (argc > 3) ? atoi(argv[3]) : 500;
+	printf("%d threads, %d items, %d loops\n",
+	       thread_cnt, item_cnt, loop_cnt);
+
+	_run("own list", _churn, 1);
+	_run("own lists", _churn, thread_cnt);
+	queue = list_create(NULL);
+	_run("shared queue", _queue, thread_cnt);
+	if (list_count(queue))
+		errors++;
+	FREE_NULL_LIST(queue);
+
+	list_alloc_stats(&node_stats, &itr_stats);
+	printf("nodes: %"PRIu64" allocs %"PRIu64" frees %"PRIu64" slabs "
+	       "%"PRIu64"/%"PRIu64" batches taken/given\n",
+	       node_stats.alloc_cnt, node_stats.free_cnt, node_stats.slab_cnt,
+	       node_stats.batch_get_cnt, node_stats.batch_put_cnt);
+	printf("iterators: %"PRIu64" allocs %"PRIu64" frees %"PRIu64" slabs\n",
+	       itr_stats.alloc_cnt, itr_stats.free_cnt, itr_stats.slab_cnt);
+
+	if (errors)
+		printf("%ld errors\n", errors);
+	return errors ? 1 : 0;
+}
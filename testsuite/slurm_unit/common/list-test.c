@@ -0,0 +1,124 @@
+/*
+ * Test of src/common/list.c, including list nodes and iterators allocated
+ * by one thread and freed by another.
+ *
+ * Avoid duplicate wait() symbol definition (in both testsuite/dejagnu.h
+ * and sys/wait.h
+ */
+#define _SYS_WAIT_H 1
+#include <pthread.h>
+#include <sched.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <src/common/list.h>
+#include <testsuite/dejagnu.h>
+
+/*
+ * Test for failure:
+ */
+#define TEST(_tst, _msg) do {		\
+	if (! (_tst))			\
+		fail( _msg );		\
+	else				\
+		pass( _msg );		\
+} while (0)
+
+#define THREAD_CNT 4
+#define ITEM_CNT 10000
+
+static List queue;
+
+static int _is_odd(void *x, void *key)
+{
+	return ((long) x) % 2;
+}
+
+/* Fill the queue, taking nodes from this thread's cache */
+static void *_producer(void *arg)
+{
+	long i;
+
+	for (i = 1; i <= ITEM_CNT; i++)
+		list_enqueue(queue, (void *) i);
+	return NULL;
+}
+
+/* Drain the queue, freeing nodes allocated by other threads */
+static void *_consumer(void *arg)
+{
+	long sum = 0, i;
+	void *x;
+
+	for (i = 0; i < ITEM_CNT; ) {
+		if ((x = list_dequeue(queue))) {
+			sum += (long) x;
+			i++;
+		} else {
+			sched_yield();
+		}
+	}
+	return (void *) sum;
+}
+
+int main(int argc, char *argv[])
+{
+	list_alloc_stats_t node_stats, itr_stats;
+	pthread_t threads[2 * THREAD_CNT];
+	List l = list_create(NULL);
+	ListIterator itr;
+	long i, sum;
+	void *x;
+	bool ok;
+
+	for (i = 1; i <= ITEM_CNT; i++)
+		list_append(l, (void *) i);
+	TEST(list_count(l) == ITEM_CNT, "list_append");
+
+	TEST(list_delete_all(l, _is_odd, NULL) == (ITEM_CNT / 2),
+	     "list_delete_all");
+	ok = true;
+	sum = 0;
+	itr = list_iterator_create(l);
+	while ((x = list_next(itr))) {
+		if (((long) x) % 2)
+			ok = false;
+		if (((long) x) % 4)
+			list_remove(itr);
+		else
+			sum++;
+	}
+	list_iterator_destroy(itr);
+	TEST(ok && (sum == ITEM_CNT / 4) && (list_count(l) == sum),
+	     "list_remove");
+	FREE_NULL_LIST(l);
+
+	queue = list_create(NULL);
+	for (i = 0; i < THREAD_CNT; i++) {
+		pthread_create(&threads[i], NULL, _producer, NULL);
+		pthread_create(&threads[THREAD_CNT + i], NULL, _consumer, NULL);
+	}
+	sum = 0;
+	for (i = 0; i < 2 * THREAD_CNT; i++) {
+		pthread_join(threads[i], &x);
+		if (i >= THREAD_CNT)
+			sum += (long) x;
+	}
+	TEST((sum == THREAD_CNT * ((long) ITEM_CNT * (ITEM_CNT + 1)) / 2) &&
+	     list_is_empty(queue), "list_enqueue and list_dequeue by threads");
+	FREE_NULL_LIST(queue);
+
+	list_alloc_stats(&node_stats, &itr_stats);
+	note("%"PRIu64" nodes in %"PRIu64" slabs",
+	     node_stats.alloc_cnt, node_stats.slab_cnt);
+	if (!node_stats.slab_cnt) {	/* built with MEMORY_LEAK_DEBUG */
+		note("list nodes are not allocated from slabs");
+	} else {
+		TEST((node_stats.alloc_cnt == node_stats.free_cnt) &&
+		     (node_stats.alloc_cnt >= (THREAD_CNT + 1) * ITEM_CNT) &&
+		     (itr_stats.alloc_cnt == itr_stats.free_cnt) &&
+		     (itr_stats.alloc_cnt >= 1), "list_alloc_stats");
+	}
+
+	totals();
+	return !(failed == 0);
+}
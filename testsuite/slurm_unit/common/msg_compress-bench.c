@@ -0,0 +1,129 @@
+/*
+ * Benchmark of message body compression with each codec built in, on a body
+ * packed like a RESPONSE_JOB_INFO: job records made of ids, times, user and
+ * partition names, node lists and paths, packed with the pack routines.
+ * Reports the compression ratio, the CPU time to compress and decompress
+ * each body, and the time to send it uncompressed and compressed over a
+ * 1 Gbit/s uplink.
+ *
+ * Usage: msg_compress-bench [job_count] [loop_count]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <src/common/msg_compress.h>
+#include <src/common/pack.h>
+#include <src/common/read_config.h>
+#include <src/common/slurm_protocol_common.h>
+#include <src/common/xmalloc.h>
+#include <src/common/xstring.h>
+
+#define LINK_BYTES_PER_USEC 125.0	/* 1 Gbit/s */
+
+static char *users[] = { "alice", "bob", "carol", "dave", "erin", "frank" };
+static char *parts[] = { "batch", "debug", "gpu", "long" };
+static char *states[] = { "PENDING", "RUNNING", "COMPLETING" };
+
+static uint64_t _cpu_usec(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+	return ((uint64_t) ts.tv_sec * 1000000) + (ts.tv_nsec / 1000);
+}
+
+static buf_t *_pack_jobs(int job_cnt)
+{
+	buf_t *buffer = init_buf(BUF_SIZE);
+	time_t now = 1600000000;
+	char str[256];
+	int i, node;
+
+	srandom(1);
+	pack32(job_cnt, buffer);
+	pack_time(now, buffer);
+	for (i = 0; i < job_cnt; i++) {
+		node = random() % 30000;
+		pack32(1000000 + i, buffer);
+		pack32(random() % 100000, buffer);	/* priority */
+		pack32(1000 + (i % 6), buffer);		/* user id */
+		pack_time(now - (random() % 86400), buffer);
+		pack_time(now + (random() % 86400), buffer);
+		packstr(users[i % 6], buffer);
+		packstr(parts[random() % 4], buffer);
+		packstr(states[random() % 3], buffer);
+		snprintf(str, sizeof(str), "job_%d", i % 100);
+		packstr(str, buffer);
+		snprintf(str, sizeof(str), "node[%05d-%05d]", node, node + 15);
+		packstr(str, buffer);
+		snprintf(str, sizeof(str), "/home/%s/run%d/slurm-%d.out",
+			 users[i % 6], i % 10, 1000000 + i);
+		packstr(str, buffer);
+		pack16(random() % 64, buffer);		/* cpus per node */
+		pack64(4096 * (1 + random() % 64), buffer);
+	}
+	return buffer;
+}
+
+static int _bench(char *name, uint16_t flag, buf_t *body, int loop_cnt)
+{
+	uint32_t body_len = get_buf_offset(body), len = 0;
+	uint64_t comp_usec = 0, decomp_usec = 0, start;
+	buf_t *compressed = NULL, *buffer;
+	int i, errors = 0;
+
+	xfree(slurm_conf.comm_params);
+	slurm_conf.comm_params = xstrdup_printf("compress=%s", name);
+	for (i = 0; i < loop_cnt; i++) {
+		FREE_NULL_BUFFER(compressed);
+		start = _cpu_usec();
+		compressed = msg_compress(get_buf_data(body), body_len, flag);
+		comp_usec += _cpu_usec() - start;
+		if (!compressed)
+			return 1;
+
+		len = get_buf_offset(compressed);
+		buffer = create_buf(xmalloc(len), len);
+		memcpy(get_buf_data(buffer), get_buf_data(compressed), len);
+		start = _cpu_usec();
+		if (msg_decompress(buffer, &len) ||
+		    memcmp(get_buf_data(buffer), get_buf_data(body), body_len))
+			errors++;
+		decomp_usec += _cpu_usec() - start;
+		free_buf(buffer);
+	}
+
+	len = get_buf_offset(compressed);
+	printf("%-6s %10u bytes ratio %5.2f compress %8.1f usec "
+	       "decompress %8.1f usec send %8.1f usec\n",
+	       name, len, (double) body_len / len,
+	       (double) comp_usec / loop_cnt, (double) decomp_usec / loop_cnt,
+	       len / LINK_BYTES_PER_USEC);
+	FREE_NULL_BUFFER(compressed);
+	return errors;
+}
+
+int main(int argc, char **argv)
+{
+	int job_cnt = (argc > 1) ? atoi(argv[1]) : 200000;
+	int loop_cnt = (argc > 2) ? atoi(argv[2]) : 5;
+	uint16_t accept = msg_compress_accept();
+	buf_t *body = _pack_jobs(job_cnt);
+	int errors = 0;
+
+	printf("%d jobs, %d loops\n", job_cnt, loop_cnt);
+	printf("%-6s %10u bytes %29s send %8.1f usec\n", "none",
+	       get_buf_offset(body), "",
+	       get_buf_offset(body) / LINK_BYTES_PER_USEC);
+	if (accept & SLURM_MSG_ACCEPT_LZ4)
+		errors += _bench("lz4", SLURM_MSG_ACCEPT_LZ4, body, loop_cnt);
+	if (accept & SLURM_MSG_ACCEPT_ZLIB)
+		errors += _bench("zlib", SLURM_MSG_ACCEPT_ZLIB, body, loop_cnt);
+	free_buf(body);
+	xfree(slurm_conf.comm_params);
+
+	if (errors)
+		printf("%d errors\n", errors);
+	return errors ? 1 : 0;
+}
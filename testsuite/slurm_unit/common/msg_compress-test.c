@@ -0,0 +1,198 @@
+/*
+ * Test of src/common/msg_compress.c
+ *
+ * Avoid duplicate wait() symbol definition (in both testsuite/dejagnu.h
+ * and sys/wait.h
+ */
+#define _SYS_WAIT_H 1
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <src/common/msg_compress.h>
+#include <src/common/read_config.h>
+#include <src/common/slurm_protocol_common.h>
+#include <src/common/xmalloc.h>
+#include <src/common/xstring.h>
+#include <testsuite/dejagnu.h>
+
+/*
+ * Test for failure:
+ */
+#define TEST(_tst, _msg) do {		\
+	if (! (_tst))			\
+		fail( _msg );		\
+	else				\
+		pass( _msg );		\
+} while (0)
+
+#define BODY_LEN (64 * 1024)
+#define PREFIX "header and credential"
+
+/* Node records as RESPONSE_NODE_INFO would carry them */
+static char *_node_body(void)
+{
+	char *body = xmalloc(BODY_LEN);
+	int i, len = 0;
+
+	for (i = 0; len < (BODY_LEN - 100); i++)
+		len += snprintf(body + len, BODY_LEN - len,
+				"node%05d IDLE cpus=64 mem=256000 part=batch ",
+				i);
+	return body;
+}
+
+/* Send body compressed for a peer which sent peer_flags, then receive it */
+static buf_t *_round_trip(char *body, uint32_t body_len, uint16_t peer_flags,
+			  uint32_t *len)
+{
+	buf_t *compressed = msg_compress(body, body_len, peer_flags);
+	buf_t *buffer;
+
+	if (!compressed)
+		return NULL;
+
+	buffer = init_buf(BUF_SIZE);
+	packmem_array(PREFIX, sizeof(PREFIX), buffer);
+	packmem_array(get_buf_data(compressed), get_buf_offset(compressed),
+		      buffer);
+	*len = get_buf_offset(compressed);
+	/* As received, the buffer ends with the body */
+	buffer->size = get_buf_offset(buffer);
+	set_buf_offset(buffer, sizeof(PREFIX));
+	free_buf(compressed);
+	return buffer;
+}
+
+static void _test_codec(char *body, uint16_t flag, char *name)
+{
+	msg_compress_stats_t stats;
+	buf_t *buffer;
+	uint32_t len = 0;
+	char *msg = NULL;
+
+	slurm_conf.comm_params = xstrdup_printf("compress=%s", name);
+	msg_compress_reset_stats();
+	buffer = _round_trip(body, BODY_LEN, flag, &len);
+	xstrfmtcat(msg, "%s compressed", name);
+	TEST(buffer && (len < BODY_LEN / 4), msg);
+	xfree(msg);
+	if (!buffer)
+		goto fini;
+
+	xstrfmtcat(msg, "%s decompressed", name);
+	TEST((msg_decompress(buffer, &len) == SLURM_SUCCESS) &&
+	     (len == BODY_LEN) &&
+	     (get_buf_offset(buffer) == sizeof(PREFIX)) &&
+	     (remaining_buf(buffer) == BODY_LEN) &&
+	     !memcmp(get_buf_data(buffer), PREFIX, sizeof(PREFIX)) &&
+	     !memcmp(get_buf_data(buffer) + sizeof(PREFIX), body, BODY_LEN),
+	     msg);
+	xfree(msg);
+
+	msg_compress_get_stats(&stats);
+	xstrfmtcat(msg, "%s statistics", name);
+	TEST((stats.compress_cnt == 1) && (stats.compress_in == BODY_LEN) &&
+	     (stats.compress_out > 0) && (stats.compress_out < BODY_LEN) &&
+	     (stats.decompress_cnt == 1), msg);
+	xfree(msg);
+	free_buf(buffer);
+
+	xstrfmtcat(msg, "%s not accepted by peer", name);
+	TEST(!msg_compress(body, BODY_LEN,
+			   SLURM_MSG_COMPRESS_FLAGS & ~SLURM_MSG_COMPRESSED &
+			   ~flag), msg);
+	xfree(msg);
+
+fini:
+	xfree(slurm_conf.comm_params);
+}
+
+int main(int argc, char *argv[])
+{
+	uint16_t accept = msg_compress_accept();
+	char *body = _node_body(), *random_body;
+	msg_compress_stats_t stats;
+	buf_t *buffer;
+	uint32_t len = 0;
+	int i;
+
+	if (!accept) {
+		note("built without lz4 and zlib, nothing to test");
+		xfree(body);
+		totals();
+		return 0;
+	}
+
+	if (accept & SLURM_MSG_ACCEPT_LZ4)
+		_test_codec(body, SLURM_MSG_ACCEPT_LZ4, "lz4");
+	if (accept & SLURM_MSG_ACCEPT_ZLIB)
+		_test_codec(body, SLURM_MSG_ACCEPT_ZLIB, "zlib");
+
+	buffer = msg_compress(body, BODY_LEN, accept);
+	TEST(!buffer == !(accept & SLURM_MSG_ACCEPT_LZ4), "lz4 by default");
+	FREE_NULL_BUFFER(buffer);
+
+	if (accept & SLURM_MSG_ACCEPT_LZ4)
+		slurm_conf.comm_params = xstrdup("compress=lz4");
+	else
+		slurm_conf.comm_params = xstrdup("compress=zlib");
+	TEST(!msg_compress(body, BODY_LEN, 0), "peer accepts no codec");
+	TEST(!msg_compress(body, 1024, accept), "body below compress_min");
+
+	xstrcat(slurm_conf.comm_params, ",compress_min=1000");
+	TEST((buffer = msg_compress(body, 1024, accept)), "compress_min=");
+	FREE_NULL_BUFFER(buffer);
+	xstrsubstitute(slurm_conf.comm_params, ",compress_min=1000", "");
+
+	msg_compress_reset_stats();
+	random_body = xmalloc(BODY_LEN);
+	srandom(1);
+	for (i = 0; i < BODY_LEN; i++)
+		random_body[i] = random();
+	TEST(!msg_compress(random_body, BODY_LEN, accept), "random body");
+	msg_compress_get_stats(&stats);
+	TEST((stats.compress_skip_cnt == 1) && !stats.compress_cnt,
+	     "random body counted as incompressible");
+	xfree(random_body);
+
+	/* A corrupt body is refused and leaves the buffer as it was */
+	buffer = _round_trip(body, BODY_LEN, accept, &len);
+	memset(get_buf_data(buffer) + sizeof(PREFIX) + 5, 0xff, 64);
+	TEST((msg_decompress(buffer, &len) != SLURM_SUCCESS) &&
+	     (get_buf_offset(buffer) == sizeof(PREFIX)),
+	     "corrupt body refused");
+	free_buf(buffer);
+
+	/* An original length the body could not hold is not allocated */
+	buffer = _round_trip(body, BODY_LEN, accept, &len);
+	i = get_buf_offset(buffer);
+	set_buf_offset(buffer, i + 1);
+	pack32(200 * 1024 * 1024, buffer);
+	set_buf_offset(buffer, i);
+	TEST((msg_decompress(buffer, &len) != SLURM_SUCCESS) &&
+	     (get_buf_offset(buffer) == sizeof(PREFIX)),
+	     "original length beyond codec ratio refused");
+	free_buf(buffer);
+
+	buffer = msg_compress(body, BODY_LEN, accept);
+	TEST(msg_compress_usable(buffer, accept) &&
+	     !msg_compress_usable(buffer, 0) &&
+	     !msg_compress_usable(NULL, accept),
+	     "compressed body usable by peers accepting its codec");
+	FREE_NULL_BUFFER(buffer);
+
+	buffer = _round_trip(body, BODY_LEN, accept, &len);
+	len += 1;
+	TEST(msg_decompress(buffer, &len) != SLURM_SUCCESS,
+	     "body past the end of the buffer refused");
+	free_buf(buffer);
+
+	xfree(slurm_conf.comm_params);
+	slurm_conf.comm_params = xstrdup("compress=none");
+	TEST(!msg_compress(body, BODY_LEN, accept), "compress=none");
+	xfree(slurm_conf.comm_params);
+
+	xfree(body);
+	totals();
+	return !(failed == 0);
+}
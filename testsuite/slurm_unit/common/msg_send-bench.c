@@ -0,0 +1,171 @@
+/*
+ * Benchmark of the two ways slurm_send_node_msg() in
+ * src/common/slurm_protocol_api.c sends a prepacked response such as
+ * RESPONSE_JOB_INFO: copying the body after the header into one buffer, or
+ * sending header and body from separate buffers with slurm_msg_sendv().
+ * A fixed size blob stands in for the auth credential.
+ *
+ * Usage: msg_send-bench [body_size] [message_count]
+ */
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <src/common/forward.h>
+#include <src/common/pack.h>
+#include <src/common/slurm_protocol_api.h>
+#include <src/common/slurm_protocol_interface.h>
+#include <src/common/slurm_protocol_pack.h>
+#include <src/common/timers.h>
+#include <src/common/xmalloc.h>
+
+#define AUTH_CRED_SIZE 256
+#define SEND_TIMEOUT 10000 /* msec */
+
+static char auth_cred[AUTH_CRED_SIZE];
+static uint64_t bytes_copied;
+
+static void *_reader(void *arg)
+{
+	int fd = *(int *) arg;
+	char buf[256 * 1024];
+	uint64_t *total = xmalloc(sizeof(*total));
+	ssize_t rc;
+
+	while ((rc = read(fd, buf, sizeof(buf))) > 0)
+		*total += rc;
+
+	return total;
+}
+
+static buf_t *_pack_header_auth(slurm_msg_t *msg, header_t *header)
+{
+	buf_t *buffer = init_buf(BUF_SIZE);
+
+	init_header(header, msg, msg->flags);
+	pack_header(header, buffer);
+	packmem(auth_cred, sizeof(auth_cred), buffer);
+
+	return buffer;
+}
+
+static void _repack_header(header_t *header, uint32_t body_len, buf_t *buffer)
+{
+	uint32_t tmplen = get_buf_offset(buffer);
+
+	update_header(header, body_len);
+	set_buf_offset(buffer, 0);
+	pack_header(header, buffer);
+	set_buf_offset(buffer, tmplen);
+}
+
+/* Send the way slurm_send_node_msg() does for ordinary messages */
+static int _send_copy(int fd, slurm_msg_t *msg)
+{
+	header_t header;
+	buf_t *buffer = _pack_header_auth(msg, &header);
+	uint32_t hdr_len = get_buf_offset(buffer);
+	uint32_t old_size = size_buf(buffer);
+	int rc;
+
+	pack_msg(msg, buffer);
+	/* Growing the buffer may move what was packed so far */
+	if (size_buf(buffer) != old_size)
+		bytes_copied += hdr_len;
+	_repack_header(&header, get_buf_offset(buffer) - hdr_len, buffer);
+	bytes_copied += get_buf_offset(buffer);
+
+	rc = slurm_msg_sendto_timeout(fd, get_buf_data(buffer),
+				      get_buf_offset(buffer), SEND_TIMEOUT);
+	free_buf(buffer);
+
+	return rc;
+}
+
+/* Send the way slurm_send_node_msg() does for prepacked messages */
+static int _send_iov(int fd, slurm_msg_t *msg)
+{
+	header_t header;
+	buf_t *buffer = _pack_header_auth(msg, &header);
+	struct iovec iov[2];
+	int rc;
+
+	_repack_header(&header, msg->data_size, buffer);
+	bytes_copied += get_buf_offset(buffer);
+
+	iov[0].iov_base = get_buf_data(buffer);
+	iov[0].iov_len = get_buf_offset(buffer);
+	iov[1].iov_base = msg->data;
+	iov[1].iov_len = msg->data_size;
+	rc = slurm_msg_sendv_timeout(fd, iov, 2, SEND_TIMEOUT);
+	free_buf(buffer);
+
+	return rc;
+}
+
+static int _run(const char *name, int (*send_func)(int, slurm_msg_t *),
+		slurm_msg_t *msg, int msg_cnt)
+{
+	DEF_TIMERS;
+	pthread_t tid;
+	uint64_t *received, expected = 0;
+	int fds[2], i, rc = 0;
+
+	if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds)) {
+		perror("socketpair");
+		return 1;
+	}
+	pthread_create(&tid, NULL, _reader, &fds[1]);
+
+	bytes_copied = 0;
+	START_TIMER;
+	for (i = 0; i < msg_cnt; i++) {
+		int len = send_func(fds[0], msg);
+		if (len < 0) {
+			perror("send");
+			rc = 1;
+			break;
+		}
+		expected += len + sizeof(uint32_t);
+	}
+	END_TIMER;
+	close(fds[0]);
+	pthread_join(tid, (void **) &received);
+	close(fds[1]);
+
+	printf("%-6s %8.1f usec/msg %12"PRIu64" bytes copied/msg\n",
+	       name, (double) DELTA_TIMER / msg_cnt, bytes_copied / msg_cnt);
+	if (*received != expected) {
+		printf("%s: received %"PRIu64" bytes, expected %"PRIu64"\n",
+		       name, *received, expected);
+		rc = 1;
+	}
+	xfree(received);
+
+	return rc;
+}
+
+int main(int argc, char *argv[])
+{
+	uint32_t body_size = (argc > 1) ? atoi(argv[1]) : (4 * 1024 * 1024);
+	int msg_cnt = (argc > 2) ? atoi(argv[2]) : 200;
+	slurm_msg_t msg;
+	int rc;
+
+	slurm_msg_t_init(&msg);
+	forward_init(&msg.forward);
+	msg.msg_type = RESPONSE_JOB_INFO;
+	msg.protocol_version = SLURM_PROTOCOL_VERSION;
+	msg.data_size = body_size;
+	msg.data = xmalloc(body_size);
+	memset(msg.data, 'j', body_size);
+
+	printf("%d messages with a %u byte body\n", msg_cnt, body_size);
+	rc = _run("copy", _send_copy, &msg, msg_cnt);
+	rc |= _run("iovec", _send_iov, &msg, msg_cnt);
+
+	xfree(msg.data);
+	return rc;
+}
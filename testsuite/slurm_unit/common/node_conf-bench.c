@@ -0,0 +1,127 @@
+/*
+ * Benchmark of bitmap2node_name() and node_name2bitmap() on a large node
+ * table, against building a hostlist one node name at a time and looking
+ * up each node name by itself. Uses half of the nodes, every other rack of
+ * 16 nodes, so node lists have many ranges. Checks that both give the same
+ * results.
+ *
+ * Usage: node_conf-bench [node_count] [loop_count]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <src/common/bitstring.h>
+#include <src/common/hostlist.h>
+#include <src/common/node_conf.h>
+#include <src/common/timers.h>
+#include <src/common/xmalloc.h>
+#include <src/common/xstring.h>
+
+static char *_bitmap2node_name_by_host(bitstr_t *bitmap)
+{
+	hostlist_t hl = hostlist_create(NULL);
+	char *str;
+	int i;
+
+	for (i = 0; i < node_record_count; i++) {
+		if (bit_test(bitmap, i))
+			hostlist_push_host(hl, node_record_table_ptr[i].name);
+	}
+	hostlist_sort(hl);
+	str = hostlist_ranged_string_xmalloc(hl);
+	hostlist_destroy(hl);
+	return str;
+}
+
+static bitstr_t *_node_name2bitmap_by_host(char *node_names)
+{
+	bitstr_t *bitmap = bit_alloc(node_record_count);
+	hostlist_t hl = hostlist_create(node_names);
+	node_record_t *node_ptr;
+	char *name;
+
+	while ((name = hostlist_shift(hl))) {
+		if ((node_ptr = find_node_record(name)))
+			bit_set(bitmap, node_ptr - node_record_table_ptr);
+		free(name);
+	}
+	hostlist_destroy(hl);
+	return bitmap;
+}
+
+int main(int argc, char **argv)
+{
+	int node_cnt = (argc > 1) ? atoi(argv[1]) : 50000;
+	int loop_cnt = (argc > 2) ? atoi(argv[2]) : 20;
+	bitstr_t *bitmap, *bitmap2 = NULL, *bitmap3 = NULL;
+	DEF_TIMERS;
+	char *str = NULL, *str2 = NULL;
+	int i, errors = 0;
+
+	node_record_table_ptr = xcalloc(node_cnt, sizeof(node_record_t));
+	for (i = 0; i < node_cnt; i++) {
+		node_record_table_ptr[i].name = xstrdup_printf("node%05d", i);
+		node_record_table_ptr[i].magic = NODE_MAGIC;
+	}
+	node_record_count = node_cnt;
+	rehash_node();
+
+	bitmap = bit_alloc(node_cnt);
+	for (i = 0; i < node_cnt; i++) {
+		if (!((i / 16) % 2))
+			bit_set(bitmap, i);
+	}
+	printf("%d nodes, %d in node list\n",
+	       node_cnt, bit_set_count(bitmap));
+
+	START_TIMER;
+	for (i = 0; i < loop_cnt; i++) {
+		xfree(str);
+		str = bitmap2node_name(bitmap);
+	}
+	END_TIMER;
+	printf("%-22s %6d ops %s\n", "bitmap2node_name", loop_cnt, TIME_STR);
+
+	START_TIMER;
+	for (i = 0; i < loop_cnt; i++) {
+		xfree(str2);
+		str2 = _bitmap2node_name_by_host(bitmap);
+	}
+	END_TIMER;
+	printf("%-22s %6d ops %s\n", "  by host", loop_cnt, TIME_STR);
+	if (xstrcmp(str, str2))
+		errors++;
+
+	START_TIMER;
+	for (i = 0; i < loop_cnt; i++) {
+		FREE_NULL_BITMAP(bitmap2);
+		if (node_name2bitmap(str, false, &bitmap2))
+			errors++;
+	}
+	END_TIMER;
+	printf("%-22s %6d ops %s\n", "node_name2bitmap", loop_cnt, TIME_STR);
+
+	START_TIMER;
+	for (i = 0; i < loop_cnt; i++) {
+		FREE_NULL_BITMAP(bitmap3);
+		bitmap3 = _node_name2bitmap_by_host(str);
+	}
+	END_TIMER;
+	printf("%-22s %6d ops %s\n", "  by host", loop_cnt, TIME_STR);
+	if (!bit_equal(bitmap, bitmap2) || !bit_equal(bitmap, bitmap3))
+		errors++;
+
+	xfree(str);
+	xfree(str2);
+	FREE_NULL_BITMAP(bitmap);
+	FREE_NULL_BITMAP(bitmap2);
+	FREE_NULL_BITMAP(bitmap3);
+	for (i = 0; i < node_cnt; i++)
+		xfree(node_record_table_ptr[i].name);
+	xfree(node_record_table_ptr);
+	node_record_count = 0;
+
+	if (errors)
+		printf("%d errors\n", errors);
+	return errors ? 1 : 0;
+}
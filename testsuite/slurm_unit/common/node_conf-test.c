@@ -0,0 +1,144 @@
+/*
+ * Test of bitmap2node_name() and node_name2bitmap() in
+ * src/common/node_conf.c against building a hostlist one node name at a
+ * time, for node tables mixing zero padded, unpadded, sparse and unnumbered
+ * node names.
+ *
+ * Avoid duplicate wait() symbol definition (in both testsuite/dejagnu.h
+ * and sys/wait.h
+ */
+#define _SYS_WAIT_H 1
+#include <stdlib.h>
+#include <string.h>
+#include <src/common/bitstring.h>
+#include <src/common/hostlist.h>
+#include <src/common/node_conf.h>
+#include <src/common/xmalloc.h>
+#include <src/common/xstring.h>
+#include <testsuite/dejagnu.h>
+
+/*
+ * Test for failure:
+ */
+#define TEST(_tst, _msg) do {		\
+	if (! (_tst))			\
+		fail( _msg );		\
+	else				\
+		pass( _msg );		\
+} while (0)
+
+static void _set_nodes(const char **names, int cnt)
+{
+	int i;
+
+	for (i = 0; i < node_record_count; i++)
+		xfree(node_record_table_ptr[i].name);
+	xfree(node_record_table_ptr);
+
+	node_record_table_ptr = xcalloc(cnt, sizeof(node_record_t));
+	for (i = 0; i < cnt; i++) {
+		node_record_table_ptr[i].name = xstrdup(names[i]);
+		node_record_table_ptr[i].magic = NODE_MAGIC;
+	}
+	node_record_count = cnt;
+	rehash_node();
+}
+
+/* bitmap2node_name_sortable() as done one node name at a time */
+static char *_bitmap2node_name(bitstr_t *bitmap, bool sort)
+{
+	hostlist_t hl = hostlist_create(NULL);
+	char *str;
+	int i;
+
+	for (i = 0; i < node_record_count; i++) {
+		if (bit_test(bitmap, i))
+			hostlist_push_host(hl, node_record_table_ptr[i].name);
+	}
+	if (sort)
+		hostlist_sort(hl);
+	str = hostlist_ranged_string_xmalloc(hl);
+	hostlist_destroy(hl);
+	return str;
+}
+
+/* Check every subset of nodes given by a few random bitmaps */
+static bool _check_bitmaps(void)
+{
+	bitstr_t *bitmap = bit_alloc(node_record_count), *bitmap2 = NULL;
+	char *str, *str2;
+	bool ok = true;
+	int i, r;
+
+	for (r = 0; ok && (r < 40); r++) {
+		bit_clear_all(bitmap);
+		for (i = 0; i < node_record_count; i++) {
+			if ((r == 0) || (random() % (1 + r % 4)))
+				bit_set(bitmap, i);
+		}
+		str = bitmap2node_name_sortable(bitmap, r % 2);
+		str2 = _bitmap2node_name(bitmap, r % 2);
+		if (xstrcmp(str, str2))
+			ok = false;
+		if (node_name2bitmap(str, false, &bitmap2) ||
+		    !bit_equal(bitmap, bitmap2))
+			ok = false;
+		FREE_NULL_BITMAP(bitmap2);
+		xfree(str);
+		xfree(str2);
+	}
+	bit_free(bitmap);
+	return ok;
+}
+
+static void _test_nodes(const char *desc, const char **names, int cnt)
+{
+	_set_nodes(names, cnt);
+	TEST(_check_bitmaps(), desc);
+}
+
+int main(int argc, char *argv[])
+{
+	const char *padded[] = {
+		"tux008", "tux009", "tux010", "tux011", "tux099", "tux100",
+		"tux101", "tux000", "tux001", "tux002", "tux200"
+	};
+	const char *unpadded[] = {
+		"n1", "n2", "n3", "n9", "n10", "n11", "n99", "n100", "n101",
+		"n0", "n1000", "n5"
+	};
+	const char *mixed[] = {
+		"c1", "c02", "c3", "c004", "c5", "c06", "c7", "c10", "c011",
+		"c12", "c0", "c00", "c000", "c8", "c9"
+	};
+	const char *other[] = {
+		"login", "a1", "a2", "b1", "admin", "a3", "b2", "b3", "a4",
+		"gpu1", "gpu1000000", "gpu2", "gpu999999", "gpu3", "a5"
+	};
+	bitstr_t *bitmap = NULL;
+	char *names[1000];
+	int i;
+
+	srandom(42);
+	_test_nodes("zero padded names", padded, ARRAY_SIZE(padded));
+	_test_nodes("unpadded names", unpadded, ARRAY_SIZE(unpadded));
+	_test_nodes("mixed padding", mixed, ARRAY_SIZE(mixed));
+	_test_nodes("several and sparse prefixes", other, ARRAY_SIZE(other));
+
+	for (i = 0; i < ARRAY_SIZE(names); i++)
+		names[i] = xstrdup_printf("%s%d", (i % 5) ? "node" : "gpu",
+					  (i * 7) % 1009);
+	_test_nodes("shuffled numbers", (const char **) names,
+		    ARRAY_SIZE(names));
+	for (i = 0; i < ARRAY_SIZE(names); i++)
+		xfree(names[i]);
+
+	_set_nodes(mixed, ARRAY_SIZE(mixed));
+	TEST(node_name2bitmap("c[0001,3,004],c13,d1,c", false, &bitmap) &&
+	     (bit_set_count(bitmap) == 2) && bit_test(bitmap, 2) &&
+	     bit_test(bitmap, 3), "invalid node names");
+	FREE_NULL_BITMAP(bitmap);
+
+	totals();
+	return !(failed == 0);
+}
@@ -0,0 +1,157 @@
+/*
+ * Benchmark of packing and unpacking integer arrays one value at a time, as
+ * pack*_array() used to, against the bulk array functions and the variable
+ * length encoding. Values look like per node counts in job and node info:
+ * CPU counts for 16-bit arrays, task counts for 32-bit ones and memory
+ * sizes in megabytes for 64-bit ones. Set SLURM_PACK_SIMD=generic to time
+ * the generic byte order kernels.
+ *
+ * Usage: pack-bench [value_count] [loop_count]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <slurm/slurm_errno.h>
+#include <src/common/pack.h>
+#include <src/common/timers.h>
+#include <src/common/xmalloc.h>
+
+static int value_cnt, loop_cnt, errors = 0;
+
+/* Time packing the values from in, then unpacking them into out */
+static void _run(const char *name, void *in, void *out, size_t width,
+		 void (*pack)(void *in, buf_t *buffer),
+		 int (*unpack)(void *out, buf_t *buffer))
+{
+	DEF_TIMERS;
+	long pack_usec = 0, unpack_usec = 0;
+	uint32_t bytes = 0;
+	buf_t *buffer;
+	int i;
+
+	for (i = 0; i < loop_cnt; i++) {
+		buffer = init_buf(BUF_SIZE);
+		START_TIMER;
+		pack(in, buffer);
+		END_TIMER;
+		pack_usec += DELTA_TIMER;
+		bytes = get_buf_offset(buffer);
+
+		set_buf_offset(buffer, 0);
+		memset(out, 0, value_cnt * width);
+		START_TIMER;
+		if (unpack(out, buffer))
+			errors++;
+		END_TIMER;
+		unpack_usec += DELTA_TIMER;
+		if (memcmp(in, out, value_cnt * width))
+			errors++;
+		free_buf(buffer);
+	}
+
+	printf("%-14s %10u bytes pack usec=%ld unpack usec=%ld\n",
+	       name, bytes, pack_usec, unpack_usec);
+}
+
+#define BENCH_WIDTH(bits)						\
+static void _pack##bits##_each(void *in, buf_t *buffer)		\
+{									\
+	pack32(value_cnt, buffer);					\
+	for (int i = 0; i < value_cnt; i++)				\
+		pack##bits(((uint##bits##_t *) in)[i], buffer);		\
+}									\
+static int _unpack##bits##_each(void *out, buf_t *buffer)		\
+{									\
+	uint32_t cnt;							\
+	if (unpack32(&cnt, buffer) || (cnt != value_cnt))		\
+		return SLURM_ERROR;					\
+	for (int i = 0; i < cnt; i++) {					\
+		if (unpack##bits(((uint##bits##_t *) out) + i, buffer))	\
+			return SLURM_ERROR;				\
+	}								\
+	return SLURM_SUCCESS;						\
+}									\
+static void _pack##bits##_array(void *in, buf_t *buffer)		\
+{									\
+	pack##bits##_array(in, value_cnt, buffer);			\
+}									\
+static int _unpack##bits##_array(void *out, buf_t *buffer)		\
+{									\
+	uint##bits##_t *vals = NULL;					\
+	uint32_t cnt;							\
+	if (unpack##bits##_array(&vals, &cnt, buffer) ||		\
+	    (cnt != value_cnt))						\
+		return SLURM_ERROR;					\
+	memcpy(out, vals, cnt * sizeof(*vals));				\
+	xfree(vals);							\
+	return SLURM_SUCCESS;						\
+}									\
+static void _packvar##bits##_array(void *in, buf_t *buffer)		\
+{									\
+	packvar##bits##_array(in, value_cnt, buffer);			\
+}									\
+static int _unpackvar##bits##_array(void *out, buf_t *buffer)		\
+{									\
+	uint##bits##_t *vals = NULL;					\
+	uint32_t cnt;							\
+	if (unpackvar##bits##_array(&vals, &cnt, buffer) ||		\
+	    (cnt != value_cnt))						\
+		return SLURM_ERROR;					\
+	memcpy(out, vals, cnt * sizeof(*vals));				\
+	xfree(vals);							\
+	return SLURM_SUCCESS;						\
+}									\
+static void _bench##bits(void *in, void *out)				\
+{									\
+	_run(#bits " each", in, out, sizeof(uint##bits##_t),		\
+	     _pack##bits##_each, _unpack##bits##_each);			\
+	_run(#bits " array", in, out, sizeof(uint##bits##_t),		\
+	     _pack##bits##_array, _unpack##bits##_array);		\
+	_run(#bits " var array", in, out, sizeof(uint##bits##_t),	\
+	     _packvar##bits##_array, _unpackvar##bits##_array);		\
+}
+
+BENCH_WIDTH(16)
+BENCH_WIDTH(32)
+BENCH_WIDTH(64)
+
+int main(int argc, char **argv)
+{
+	uint16_t *in16, *out16;
+	uint32_t *in32, *out32;
+	uint64_t *in64, *out64;
+	int i;
+
+	value_cnt = (argc > 1) ? atoi(argv[1]) : 100000;
+	loop_cnt = (argc > 2) ? atoi(argv[2]) : 100;
+
+	in16 = xcalloc(value_cnt, sizeof(uint16_t));
+	out16 = xcalloc(value_cnt, sizeof(uint16_t));
+	in32 = xcalloc(value_cnt, sizeof(uint32_t));
+	out32 = xcalloc(value_cnt, sizeof(uint32_t));
+	in64 = xcalloc(value_cnt, sizeof(uint64_t));
+	out64 = xcalloc(value_cnt, sizeof(uint64_t));
+	srandom(1);
+	for (i = 0; i < value_cnt; i++) {
+		in16[i] = 1 << (random() % 8);
+		in32[i] = random() % 1000;
+		in64[i] = (1 + (random() % 16)) * 16384;
+	}
+	printf("%d values, %d loops, %s kernels\n",
+	       value_cnt, loop_cnt, pack_simd_name());
+
+	_bench16(in16, out16);
+	_bench32(in32, out32);
+	_bench64(in64, out64);
+
+	xfree(in16);
+	xfree(out16);
+	xfree(in32);
+	xfree(out32);
+	xfree(in64);
+	xfree(out64);
+
+	if (errors)
+		printf("%d errors\n", errors);
+	return errors ? 1 : 0;
+}
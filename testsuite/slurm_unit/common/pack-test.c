@@ -1,8 +1,10 @@
 #include <errno.h>
 #include <inttypes.h>
+#include <stdbool.h>
 #include <stdio.h>
 #include <string.h>
 
+#include <slurm/slurm.h>
 #include <src/common/pack.h>
 #include <src/common/xmalloc.h>
 
@@ -17,6 +19,88 @@
 		pass( _msg );       \
 } while (0)
 
+/* Replace a buffer being packed with one to unpack of just its contents */
+static buf_t *_reopen(buf_t *buffer)
+{
+	uint32_t size = get_buf_offset(buffer);
+
+	return create_buf(xfer_buf_data(buffer), size);
+}
+
+/* Pack arrays of cnt values both ways, return true if they differ */
+static bool _test_arrays(uint32_t cnt)
+{
+	buf_t *buffer1 = init_buf(0), *buffer2 = init_buf(0);
+	uint16_t *in16 = xcalloc(cnt + 1, sizeof(uint16_t)), *out16 = NULL;
+	uint32_t *in32 = xcalloc(cnt + 1, sizeof(uint32_t)), *out32 = NULL;
+	uint64_t *in64 = xcalloc(cnt + 1, sizeof(uint64_t)), *out64 = NULL;
+	uint32_t i, cnt16 = 0, cnt32 = 0, cnt64 = 0;
+	bool bad = false;
+
+	for (i = 0; i < cnt; i++) {
+		in16[i] = i * 0x0123;
+		in32[i] = i * 0x01234567;
+		in64[i] = i * 0x0123456789abcdefULL;
+	}
+
+	/* Start unaligned, after a single byte */
+	pack8(1, buffer1);
+	pack8(1, buffer2);
+	pack16_array(in16, cnt, buffer1);
+	pack32_array(in32, cnt, buffer1);
+	pack64_array(in64, cnt, buffer1);
+	pack32(cnt, buffer2);
+	for (i = 0; i < cnt; i++)
+		pack16(in16[i], buffer2);
+	pack32(cnt, buffer2);
+	for (i = 0; i < cnt; i++)
+		pack32(in32[i], buffer2);
+	pack32(cnt, buffer2);
+	for (i = 0; i < cnt; i++)
+		pack64(in64[i], buffer2);
+	if ((get_buf_offset(buffer1) != get_buf_offset(buffer2)) ||
+	    memcmp(get_buf_data(buffer1), get_buf_data(buffer2),
+		   get_buf_offset(buffer1)))
+		bad = true;
+
+	set_buf_offset(buffer1, 1);
+	if (unpack16_array(&out16, &cnt16, buffer1) ||
+	    unpack32_array(&out32, &cnt32, buffer1) ||
+	    unpack64_array(&out64, &cnt64, buffer1) ||
+	    (cnt16 != cnt) || (cnt32 != cnt) || (cnt64 != cnt) ||
+	    memcmp(in16, out16, cnt * sizeof(uint16_t)) ||
+	    memcmp(in32, out32, cnt * sizeof(uint32_t)) ||
+	    memcmp(in64, out64, cnt * sizeof(uint64_t)))
+		bad = true;
+	xfree(out16);
+	xfree(out32);
+	xfree(out64);
+
+	set_buf_offset(buffer1, 0);
+	packvar16_array(in16, cnt, buffer1);
+	packvar32_array(in32, cnt, buffer1);
+	packvar64_array(in64, cnt, buffer1);
+	set_buf_offset(buffer1, 0);
+	if (unpackvar16_array(&out16, &cnt16, buffer1) ||
+	    unpackvar32_array(&out32, &cnt32, buffer1) ||
+	    unpackvar64_array(&out64, &cnt64, buffer1) ||
+	    (cnt16 != cnt) || (cnt32 != cnt) || (cnt64 != cnt) ||
+	    memcmp(in16, out16, cnt * sizeof(uint16_t)) ||
+	    memcmp(in32, out32, cnt * sizeof(uint32_t)) ||
+	    memcmp(in64, out64, cnt * sizeof(uint64_t)))
+		bad = true;
+	xfree(out16);
+	xfree(out32);
+	xfree(out64);
+
+	xfree(in16);
+	xfree(in32);
+	xfree(in64);
+	free_buf(buffer1);
+	free_buf(buffer2);
+	return bad;
+}
+
 int main (int argc, char *argv[])
 {
 	buf_t *buffer;
@@ -83,6 +167,64 @@ int main (int argc, char *argv[])
 	xfree(outstring);
 
 	free_buf(buffer);
+
+	note("pack arrays with %s kernels", pack_simd_name());
+	TEST(_test_arrays(0), "un/pack arrays of 0");
+	TEST(_test_arrays(1), "un/pack arrays of 1");
+	TEST(_test_arrays(37), "un/pack arrays of 37");
+	TEST(_test_arrays(100000), "un/pack arrays of 100000");
+
+	buffer = init_buf(0);
+	packvar32(0, buffer);
+	packvar32(127, buffer);
+	packvar32(128, buffer);
+	packvar32(NO_VAL, buffer);
+	packvar64(INFINITE64, buffer);
+	TEST(get_buf_offset(buffer) != (1 + 1 + 2 + 5 + 10),
+	     "packvar lengths");
+	buffer = _reopen(buffer);
+	TEST(unpackvar32(&out32, buffer) || (out32 != 0), "un/packvar32 0");
+	TEST(unpackvar32(&out32, buffer) || (out32 != 127),
+	     "un/packvar32 127");
+	TEST(unpackvar32(&out32, buffer) || (out32 != 128),
+	     "un/packvar32 128");
+	TEST(unpackvar32(&out32, buffer) || (out32 != NO_VAL),
+	     "un/packvar32 NO_VAL");
+	TEST(unpackvar64(&test64, buffer) || (test64 != INFINITE64),
+	     "un/packvar64 INFINITE64");
+	TEST(!unpackvar64(&test64, buffer), "unpackvar64 past end");
+	set_buf_offset(buffer, 9);
+	TEST(!unpackvar32(&out32, buffer) || (get_buf_offset(buffer) != 9),
+	     "unpackvar32 of a 64-bit value");
+	buffer->size--;
+	TEST(!unpackvar64(&test64, buffer), "unpackvar64 cut short");
+	free_buf(buffer);
+
+	/* Eleven bytes with the high bit set are not a valid value */
+	buffer = init_buf(0);
+	for (int i = 0; i < 11; i++)
+		pack8(0xff, buffer);
+	buffer = _reopen(buffer);
+	TEST(!unpackvar64(&test64, buffer), "unpackvar64 of bad data");
+	free_buf(buffer);
+
+	/* Arrays claiming more values than the buffer holds */
+	buffer = init_buf(0);
+	packvar32(1000, buffer);
+	packvar32(1, buffer);
+	buffer = _reopen(buffer);
+	outbytes = NULL;
+	TEST(!unpackvar32_array((uint32_t **) &outbytes, &out32, buffer) ||
+	     outbytes, "unpackvar32_array of a short buffer");
+	free_buf(buffer);
+	buffer = init_buf(0);
+	pack32(1000, buffer);
+	pack32(1, buffer);
+	buffer = _reopen(buffer);
+	TEST(!unpack32_array((uint32_t **) &outbytes, &out32, buffer),
+	     "unpack32_array of a short buffer");
+	free_buf(buffer);
+
 	totals();
 	return failed;
 
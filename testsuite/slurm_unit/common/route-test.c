@@ -0,0 +1,191 @@
+/*
+ * Test of the adaptive message forwarding tree in src/common/slurm_route.c
+ *
+ * Avoid duplicate wait() symbol definition (in both testsuite/dejagnu.h
+ * and sys/wait.h
+ */
+#define _SYS_WAIT_H 1
+#include <stdlib.h>
+#include <src/common/forward.h>
+#include <src/common/hostlist.h>
+#include <src/common/read_config.h>
+#include <src/common/slurm_route.h>
+#include <src/common/xmalloc.h>
+#include <src/common/xstring.h>
+#include <testsuite/dejagnu.h>
+
+/*
+ * Test for failure:
+ */
+#define TEST(_tst, _msg) do {		\
+	if (! (_tst))			\
+		fail( _msg );		\
+	else				\
+		pass( _msg );		\
+} while (0)
+
+static int _split(char *nodes, uint16_t width, hostlist_t **sp_hl)
+{
+	hostlist_t hl = hostlist_create(nodes);
+	int count = 0;
+
+	route_split_hostlist_adaptive(hl, sp_hl, &count, width);
+	hostlist_destroy(hl);
+
+	return count;
+}
+
+static void _free_split(hostlist_t *sp_hl, int count)
+{
+	for (int i = 0; i < count; i++)
+		hostlist_destroy(sp_hl[i]);
+	xfree(sp_hl);
+}
+
+static char *_head(hostlist_t hl)
+{
+	static char name[64];
+	char *host = hostlist_nth(hl, 0);
+
+	snprintf(name, sizeof(name), "%s", host);
+	free(host);
+	return name;
+}
+
+static char *_tail(hostlist_t hl)
+{
+	static char name[64];
+	char *host = hostlist_nth(hl, hostlist_count(hl) - 1);
+
+	snprintf(name, sizeof(name), "%s", host);
+	free(host);
+	return name;
+}
+
+static int _total(hostlist_t *sp_hl, int count)
+{
+	int total = 0;
+
+	for (int i = 0; i < count; i++)
+		total += hostlist_count(sp_hl[i]);
+	return total;
+}
+
+int main(int argc, char *argv[])
+{
+	hostlist_t *sp_hl = NULL, *tw_hl = NULL, hl;
+	List ret_list = NULL;
+	char *str;
+	int count, tw_count, i;
+	bool same, slow_head = false, slow_tail = false;
+
+	slurm_conf.topology_param = xstrdup("RouteAdaptive");
+	slurm_conf.tree_width = 4;
+
+	note("Testing split without history");
+	count = _split("n[1-16]", 4, &sp_hl);
+	hl = hostlist_create("n[1-16]");
+	route_split_hostlist_treewidth(hl, &tw_hl, &tw_count, 4);
+	hostlist_destroy(hl);
+	same = (count == tw_count);
+	for (i = 0; same && (i < count); i++) {
+		char *s1 = hostlist_ranged_string_xmalloc(sp_hl[i]);
+		char *s2 = hostlist_ranged_string_xmalloc(tw_hl[i]);
+		same = !xstrcmp(s1, s2);
+		xfree(s1);
+		xfree(s2);
+	}
+	TEST(same, "same branches as TreeWidth split");
+	TEST(_total(sp_hl, count) == 16, "every node in a branch");
+	_free_split(sp_hl, count);
+	_free_split(tw_hl, tw_count);
+
+	note("Testing split with slow and failed nodes");
+	for (i = 1; i <= 16; i++) {
+		char *name = xstrdup_printf("n%d", i);
+		route_stats_record(name, (i <= 4) ? 100000 : 1000, false);
+		xfree(name);
+	}
+	route_stats_record("n16", 0, true);
+	count = _split("n[1-16]", 4, &sp_hl);
+	TEST(count == 4, "4 branches");
+	TEST(_total(sp_hl, count) == 16, "every node in a branch");
+	for (i = 0; i < count; i++) {
+		char *head = _head(sp_hl[i]);
+		if (!xstrcmp(head, "n1") || !xstrcmp(head, "n2") ||
+		    !xstrcmp(head, "n3") || !xstrcmp(head, "n4"))
+			slow_head = true;
+		if (!xstrcmp(_tail(sp_hl[i]), "n4"))
+			slow_tail = true;
+	}
+	TEST(!slow_head, "slow nodes do not head branches");
+	TEST(slow_tail, "slow nodes are leaves");
+	TEST((hostlist_count(sp_hl[3]) == 1) &&
+	     !xstrcmp(_head(sp_hl[3]), "n16"),
+	     "failed node isolated in its own branch");
+	_free_split(sp_hl, count);
+
+	note("Testing branch width");
+	route_stats_record("a1", 1000, false);
+	route_stats_record("a2", 1000, false);
+	route_stats_record("a3", 4000, false);
+	for (i = 4; i <= 13; i++) {
+		char *name = xstrdup_printf("a%d", i);
+		route_stats_record(name, 8000, false);
+		xfree(name);
+	}
+	count = _split("a[1-13]", 3, &sp_hl);
+	TEST(count == 3, "3 branches");
+	TEST(!xstrcmp(_head(sp_hl[2]), "a3"), "slowest head last");
+	TEST(hostlist_count(sp_hl[2]) < hostlist_count(sp_hl[0]),
+	     "slower head relays to fewer nodes");
+	TEST(_total(sp_hl, count) == 13, "every node in a branch");
+	_free_split(sp_hl, count);
+
+	note("Testing ordering");
+	hl = hostlist_create("a13,a3,a1");
+	route_order_hostlist(hl);
+	str = hostlist_deranged_string_xmalloc(hl);
+	TEST(!xstrcmp(str, "a1,a3,a13"), "hostlist sorted by latency");
+	xfree(str);
+	hostlist_destroy(hl);
+
+	note("Testing response times of forwarding nodes");
+	ret_list = list_create(destroy_data_info);
+	list_append(ret_list, xmalloc(sizeof(ret_data_info_t)));
+	route_stats_record_list("a1", 10, 900000, ret_list);
+	hl = hostlist_create("a3,a1");
+	route_order_hostlist(hl);
+	str = hostlist_deranged_string_xmalloc(hl);
+	TEST(!xstrcmp(str, "a1,a3"), "relay response time not recorded");
+	xfree(str);
+	hostlist_destroy(hl);
+	route_stats_record_list("a1", 0, 900000, ret_list);
+	FREE_NULL_LIST(ret_list);
+	hl = hostlist_create("a3,a1");
+	route_order_hostlist(hl);
+	str = hostlist_deranged_string_xmalloc(hl);
+	TEST(!xstrcmp(str, "a3,a1"), "leaf response time recorded");
+	xfree(str);
+	hostlist_destroy(hl);
+
+	note("Testing failures reported by forwarding nodes");
+	ret_list = list_create(destroy_data_info);
+	list_append(ret_list, xmalloc(sizeof(ret_data_info_t)));
+	mark_as_failed_forward(&ret_list, "a5",
+			       SLURM_COMMUNICATIONS_CONNECTION_ERROR);
+	route_stats_record_list("a4", 9, 8000, ret_list);
+	FREE_NULL_LIST(ret_list);
+	count = _split("a[4-13]", 3, &sp_hl);
+	TEST(!xstrcmp(_head(sp_hl[count - 1]), "a5") &&
+	     (hostlist_count(sp_hl[count - 1]) == 1),
+	     "node failed behind a relay isolated");
+	TEST(_total(sp_hl, count) == 10, "every node in a branch");
+	_free_split(sp_hl, count);
+
+	route_fini();
+	xfree(slurm_conf.topology_param);
+
+	totals();
+	return failed;
+}
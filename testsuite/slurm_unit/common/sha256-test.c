@@ -0,0 +1,86 @@
+/*
+ * Test of src/common/sha256.c against the FIPS 180-2 and RFC 4231 vectors
+ *
+ * Avoid duplicate wait() symbol definition (in both testsuite/dejagnu.h
+ * and sys/wait.h
+ */
+#define _SYS_WAIT_H 1
+#include <stdio.h>
+#include <string.h>
+#include <src/common/sha256.h>
+#include <testsuite/dejagnu.h>
+
+/*
+ * Test for failure:
+ */
+#define TEST(_tst, _msg) do {		\
+	if (! (_tst))			\
+		fail( _msg );		\
+	else				\
+		pass( _msg );		\
+} while (0)
+
+static char *_hex(unsigned char *digest)
+{
+	static char str[SHA256_DIGEST_SIZE * 2 + 1];
+	int i;
+
+	for (i = 0; i < SHA256_DIGEST_SIZE; i++)
+		snprintf(str + (i * 2), 3, "%02x", digest[i]);
+	return str;
+}
+
+static char *_sha256(const char *data)
+{
+	unsigned char digest[SHA256_DIGEST_SIZE];
+	sha256_ctx_t ctx;
+
+	sha256_init(&ctx);
+	sha256_update(&ctx, data, strlen(data));
+	sha256_final(&ctx, digest);
+	return _hex(digest);
+}
+
+static char *_hmac(const void *key, size_t key_len, const char *data)
+{
+	unsigned char digest[SHA256_DIGEST_SIZE];
+
+	hmac_sha256(key, key_len, data, strlen(data), digest);
+	return _hex(digest);
+}
+
+int main(int argc, char *argv[])
+{
+	unsigned char digest[SHA256_DIGEST_SIZE];
+	unsigned char key[131];
+	char block[1000];
+	sha256_ctx_t ctx;
+	int i;
+
+	TEST(!strcmp(_sha256(""), "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855"),
+	     "sha256 of nothing");
+	TEST(!strcmp(_sha256("abc"), "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad"),
+	     "sha256 of one block");
+	TEST(!strcmp(_sha256("abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq"), "248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1"),
+	     "sha256 of two blocks");
+
+	memset(block, 'a', sizeof(block));
+	sha256_init(&ctx);
+	for (i = 0; i < 1000; i++)
+		sha256_update(&ctx, block, sizeof(block));
+	sha256_final(&ctx, digest);
+	TEST(!strcmp(_hex(digest), "cdc76e5c9914fb9281a1c7e284d73e67f1809a48a497200e046d39ccc7112cd0"),
+	     "sha256 of a million bytes");
+
+	memset(key, 0x0b, 20);
+	TEST(!strcmp(_hmac(key, 20, "Hi There"), "b0344c61d8db38535ca8afceaf0bf12b881dc200c9833da726e9376c2e32cff7"),
+	     "hmac with a short key");
+	TEST(!strcmp(_hmac("Jefe", 4, "what do ya want for nothing?"), "5bdcc146bf60754e6a042426089575c75a003f089d2739839dec58b964ec3843"),
+	     "hmac with a text key");
+	memset(key, 0xaa, sizeof(key));
+	TEST(!strcmp(_hmac(key, sizeof(key), "Test Using Larger Than Block-Size Key - Hash Key First"), "60e431591ee0b67f0d8a26aacbf5b77f8e0bc6213728c5140546040f0ee37f54"),
+	     "hmac with a key longer than a block");
+
+	totals();
+	return !(failed == 0);
+}
@@ -0,0 +1,113 @@
+/*
+ * Benchmark of job credentials for the steps of one job, as slurmctld
+ * creates them and slurmd verifies them at step launch. Runs with every
+ * credential signed by the cred plugin, as for a SLURM_21_08_PROTOCOL_VERSION
+ * peer, then with credentials signed with the key of a job signature.
+ *
+ * Usage: slurm_cred-bench [cred_type] [step_count]
+ *
+ * cred/munge needs munged, and a user able to decode the credentials it
+ * creates (SlurmdUser), so run it as root.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <src/common/bitstring.h>
+#include <src/common/read_config.h>
+#include <src/common/slurm_cred.h>
+#include <src/common/slurm_protocol_api.h>
+#include <src/common/timers.h>
+#include <src/common/xmalloc.h>
+#include <src/common/xstring.h>
+
+static int _bench(char *name, uint32_t job_id, int step_cnt,
+		  uint16_t protocol_version)
+{
+	slurm_cred_ctx_t creator, verifier;
+	slurm_cred_t **creds = xcalloc(step_cnt, sizeof(slurm_cred_t *));
+	slurm_cred_arg_t arg, verified;
+	DEF_TIMERS;
+	long create_usec, verify_usec;
+	int i, errors = 0;
+
+	creator = slurm_cred_creator_ctx_create(NULL);
+	verifier = slurm_cred_verifier_ctx_create(NULL);
+	if (!creator || !verifier) {
+		printf("%s: cred contexts not created\n", name);
+		return 1;
+	}
+
+	memset(&arg, 0, sizeof(arg));
+	arg.step_id.job_id = job_id;
+	arg.step_id.step_het_comp = NO_VAL;
+	arg.uid = getuid();
+	arg.gid = getgid();
+	arg.job_nhosts = 1;
+	arg.job_hostlist = "n1";
+	arg.step_hostlist = "n1";
+	arg.job_core_bitmap = bit_alloc(64);
+	bit_nset(arg.job_core_bitmap, 0, 63);
+	arg.step_core_bitmap = bit_copy(arg.job_core_bitmap);
+
+	START_TIMER;
+	for (i = 0; i < step_cnt; i++) {
+		arg.step_id.step_id = i;
+		if (!(creds[i] = slurm_cred_create(creator, &arg,
+						   protocol_version)))
+			errors++;
+	}
+	END_TIMER;
+	create_usec = DELTA_TIMER;
+
+	START_TIMER;
+	for (i = 0; i < step_cnt; i++) {
+		if (!creds[i] ||
+		    slurm_cred_verify(verifier, creds[i], &verified,
+				      protocol_version)) {
+			errors++;
+			continue;
+		}
+		slurm_cred_free_args(&verified);
+	}
+	END_TIMER;
+	verify_usec = DELTA_TIMER;
+
+	printf("%-14s create %8.1f usec  verify %8.1f usec per step\n",
+	       name, (double) create_usec / step_cnt,
+	       (double) verify_usec / step_cnt);
+
+	for (i = 0; i < step_cnt; i++)
+		slurm_cred_destroy(creds[i]);
+	xfree(creds);
+	FREE_NULL_BITMAP(arg.job_core_bitmap);
+	FREE_NULL_BITMAP(arg.step_core_bitmap);
+	slurm_cred_ctx_destroy(verifier);
+	slurm_cred_ctx_destroy(creator);
+
+	return errors;
+}
+
+int main(int argc, char **argv)
+{
+	char *cred_type = (argc > 1) ? argv[1] : "cred/none";
+	int step_cnt = (argc > 2) ? atoi(argv[2]) : 1000;
+	int errors;
+
+	slurm_conf.cred_type = xstrdup(cred_type);
+	slurm_conf.plugindir = xstrdup(CRED_PLUGIN_DIR);
+	slurm_conf.slurm_user_id = getuid();
+	slurm_conf.slurmd_user_id = getuid();
+	printf("%s, %d steps\n", cred_type, step_cnt);
+
+	errors = _bench("plugin signed", 1000, step_cnt,
+			SLURM_21_08_PROTOCOL_VERSION);
+	errors += _bench("job signature", 1001, step_cnt,
+			 SLURM_PROTOCOL_VERSION);
+
+	xfree(slurm_conf.cred_type);
+	xfree(slurm_conf.plugindir);
+	if (errors)
+		printf("%d errors\n", errors);
+	return errors ? 1 : 0;
+}
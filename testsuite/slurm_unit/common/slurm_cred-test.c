@@ -0,0 +1,234 @@
+/*
+ * Test of the job and credential state tables of the credential verifier
+ * and of job signatures in src/common/slurm_cred.c, using the cred/none plugin
+ *
+ * Avoid duplicate wait() symbol definition (in both testsuite/dejagnu.h
+ * and sys/wait.h
+ */
+#define _SYS_WAIT_H 1
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <slurm/slurm_errno.h>
+#include <src/common/bitstring.h>
+#include <src/common/pack.h>
+#include <src/common/read_config.h>
+#include <src/common/slurm_cred.h>
+#include <src/common/slurm_protocol_api.h>
+#include <src/common/xmalloc.h>
+#include <src/common/xstring.h>
+#include <testsuite/dejagnu.h>
+
+/*
+ * Test for failure:
+ */
+#define TEST(_tst, _msg) do {		\
+	if (! (_tst))			\
+		fail( _msg );		\
+	else				\
+		pass( _msg );		\
+} while (0)
+
+#define JOB_CNT 10000
+
+static slurm_cred_ctx_t creator;
+
+static slurm_cred_t *_create_version(uint32_t job_id, uint32_t step_id,
+				     uint16_t protocol_version)
+{
+	slurm_cred_arg_t arg;
+	slurm_cred_t *cred;
+
+	memset(&arg, 0, sizeof(arg));
+	arg.step_id.job_id = job_id;
+	arg.step_id.step_id = step_id;
+	arg.step_id.step_het_comp = NO_VAL;
+	arg.uid = getuid();
+	arg.gid = getgid();
+	arg.job_nhosts = 1;
+	arg.job_hostlist = "n1";
+	arg.step_hostlist = "n1";
+	arg.job_core_bitmap = bit_alloc(2);
+	bit_nset(arg.job_core_bitmap, 0, 1);
+	arg.step_core_bitmap = bit_copy(arg.job_core_bitmap);
+
+	cred = slurm_cred_create(creator, &arg, protocol_version);
+	FREE_NULL_BITMAP(arg.job_core_bitmap);
+	FREE_NULL_BITMAP(arg.step_core_bitmap);
+
+	return cred;
+}
+
+static slurm_cred_t *_create(uint32_t job_id, uint32_t step_id)
+{
+	return _create_version(job_id, step_id, SLURM_PROTOCOL_VERSION);
+}
+
+/* RET 0 or the errno from slurm_cred_verify() */
+static int _verify_version(slurm_cred_ctx_t ctx, slurm_cred_t *cred,
+			   uint16_t protocol_version)
+{
+	slurm_cred_arg_t arg;
+
+	if (slurm_cred_verify(ctx, cred, &arg, protocol_version))
+		return slurm_get_errno();
+	slurm_cred_free_args(&arg);
+	return 0;
+}
+
+static int _verify(slurm_cred_ctx_t ctx, slurm_cred_t *cred)
+{
+	return _verify_version(ctx, cred, SLURM_PROTOCOL_VERSION);
+}
+
+/*
+ * Pack cred, replace the first [from] string in it by [to] unless NULL, and
+ * unpack it again
+ */
+static slurm_cred_t *_repack(slurm_cred_t *cred, char *from, char *to)
+{
+	buf_t *buffer = init_buf(BUF_SIZE);
+	slurm_cred_t *new;
+	char *ptr;
+
+	slurm_cred_pack(cred, buffer, SLURM_PROTOCOL_VERSION);
+	if (from && (ptr = memmem(get_buf_data(buffer),
+				  get_buf_offset(buffer), from,
+				  strlen(from))))
+		memcpy(ptr, to, strlen(to));
+	set_buf_offset(buffer, 0);
+	new = slurm_cred_unpack(buffer, SLURM_PROTOCOL_VERSION);
+	free_buf(buffer);
+
+	return new;
+}
+
+int main(int argc, char *argv[])
+{
+	slurm_cred_ctx_t verifier, restored;
+	slurm_cred_t *cred[4], *step[4];
+	buf_t *buffer;
+	bool all_cached = true;
+	int i;
+
+	slurm_conf.cred_type = xstrdup("cred/none");
+	slurm_conf.plugindir = xstrdup(CRED_PLUGIN_DIR);
+
+	creator = slurm_cred_creator_ctx_create(NULL);
+	verifier = slurm_cred_verifier_ctx_create(NULL);
+	if (!creator || !verifier) {
+		fail("cred/none contexts created");
+		totals();
+		return failed;
+	}
+	for (i = 0; i < 4; i++)
+		cred[i] = _create(1000 + i, 0);
+
+	note("Testing job states");
+	for (i = 1; i <= JOB_CNT; i++)
+		slurm_cred_insert_jobid(verifier, i);
+	for (i = 1; all_cached && (i <= JOB_CNT); i++)
+		all_cached = slurm_cred_jobid_cached(verifier, i);
+	TEST(all_cached, "inserted jobs cached");
+	TEST(!slurm_cred_jobid_cached(verifier, JOB_CNT + 1),
+	     "other job not cached");
+	TEST(!slurm_cred_revoke(verifier, 1001, time(NULL), 0),
+	     "job revoked");
+	TEST(slurm_cred_revoke(verifier, 1001, time(NULL), 0),
+	     "job revoked twice fails");
+	TEST(slurm_cred_revoked(verifier, cred[1]),
+	     "credential of revoked job revoked");
+	TEST(!slurm_cred_revoked(verifier, cred[0]),
+	     "credential of other job not revoked");
+	TEST(_verify(verifier, cred[1]) == ESLURMD_CREDENTIAL_REVOKED,
+	     "revoked credential rejected");
+	TEST(slurm_cred_begin_expiration(verifier, JOB_CNT + 1),
+	     "expiration of unknown job fails");
+
+	note("Testing credential states");
+	TEST(!_verify(verifier, cred[0]), "credential verified");
+	TEST(_verify(verifier, cred[0]) == ESLURMD_CREDENTIAL_REPLAYED,
+	     "replayed credential rejected");
+	TEST(!slurm_cred_rewind(verifier, cred[0]), "credential rewound");
+	TEST(slurm_cred_rewind(verifier, cred[0]),
+	     "rewound credential not found");
+	TEST(!_verify(verifier, cred[0]), "rewound credential verified");
+	TEST(!_verify(verifier, cred[2]), "second credential verified");
+
+	note("Testing state save and restore");
+	buffer = init_buf(BUF_SIZE);
+	slurm_cred_ctx_pack(verifier, buffer);
+	set_buf_offset(buffer, 0);
+	restored = slurm_cred_verifier_ctx_create(NULL);
+	slurm_cred_ctx_unpack(restored, buffer);
+	free_buf(buffer);
+	all_cached = true;
+	for (i = 1; all_cached && (i <= JOB_CNT); i++)
+		all_cached = slurm_cred_jobid_cached(restored, i);
+	TEST(all_cached, "restored jobs cached");
+	TEST(slurm_cred_revoked(restored, cred[1]), "restored revoke");
+	TEST(_verify(restored, cred[0]) == ESLURMD_CREDENTIAL_REPLAYED,
+	     "restored credential state rejects replay");
+	TEST(!_verify(restored, cred[3]), "new credential verified");
+	slurm_cred_ctx_destroy(restored);
+
+	note("Testing expiration");
+	slurm_cred_ctx_set(verifier, SLURM_CRED_OPT_EXPIRY_WINDOW, 1);
+	TEST(!slurm_cred_begin_expiration(verifier, 1001),
+	     "revoked job expiration set");
+	TEST(slurm_cred_begin_expiration(verifier, 1001),
+	     "revoked job expiration set twice fails");
+	TEST(!_verify(verifier, cred[3]), "short lived credential verified");
+	sleep(3);
+	slurm_cred_destroy(cred[2]);
+	cred[2] = _create(1002, 1);
+	TEST(!_verify(verifier, cred[2]), "new credential verified");
+	TEST(slurm_cred_rewind(verifier, cred[3]),
+	     "expired credential state purged");
+	TEST(!slurm_cred_rewind(verifier, cred[0]),
+	     "unexpired credential state kept");
+	TEST(!slurm_cred_jobid_cached(verifier, 1001),
+	     "expired job state purged");
+	TEST(slurm_cred_jobid_cached(verifier, 1000),
+	     "job state without revoke kept");
+	TEST(_verify(verifier, cred[3]) == ESLURMD_CREDENTIAL_EXPIRED,
+	     "expired credential rejected");
+
+	note("Testing job signatures");
+	slurm_cred_ctx_set(verifier, SLURM_CRED_OPT_EXPIRY_WINDOW, 120);
+	slurm_cred_ctx_set(creator, SLURM_CRED_OPT_EXPIRY_WINDOW, 120);
+	for (i = 0; i < 4; i++)
+		step[i] = _create(2000, i);
+	TEST(!_verify(verifier, step[0]), "step credential verified");
+	TEST(!_verify(verifier, step[1]),
+	     "step credential verified with known job signature");
+	TEST(_verify(verifier, step[1]) == ESLURMD_CREDENTIAL_REPLAYED,
+	     "replayed step credential rejected");
+	slurm_cred_destroy(step[1]);
+	step[1] = _repack(step[2], NULL, NULL);
+	TEST(step[1] && !_verify(verifier, step[1]),
+	     "unpacked step credential verified");
+	slurm_cred_destroy(step[1]);
+	step[1] = _repack(step[3], "n1", "n2");
+	TEST(step[1] && (_verify(verifier, step[1]) ==
+			 ESLURMD_INVALID_JOB_CREDENTIAL),
+	     "changed step credential rejected");
+	TEST(!_verify(verifier, step[3]), "unchanged step credential verified");
+	slurm_cred_destroy(step[1]);
+	step[1] = _create_version(2001, 0, SLURM_21_08_PROTOCOL_VERSION);
+	TEST(!_verify_version(verifier, step[1], SLURM_21_08_PROTOCOL_VERSION),
+	     "credential signed by the plugin verified");
+	for (i = 0; i < 4; i++)
+		slurm_cred_destroy(step[i]);
+
+	for (i = 0; i < 4; i++)
+		slurm_cred_destroy(cred[i]);
+	slurm_cred_ctx_destroy(verifier);
+	slurm_cred_ctx_destroy(creator);
+	xfree(slurm_conf.cred_type);
+	xfree(slurm_conf.plugindir);
+
+	totals();
+	return failed;
+}
@@ -0,0 +1,192 @@
+/*
+ * Scheduler replay benchmark of the job queue as a List and as a vector.
+ * Each cycle does what the main and backfill schedulers do with the queue
+ * from build_job_queue(): append a record for each pending job and
+ * partition, sort the records by priority, then pop and look at them in
+ * order. Job priorities age between cycles, and some jobs start and are
+ * replaced by newly submitted ones. Both queues must pop the same jobs.
+ *
+ * Usage: vector-bench [job_count] [cycle_count]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <src/common/list.h>
+#include <src/common/timers.h>
+#include <src/common/vector.h>
+#include <src/common/xmalloc.h>
+
+/* Stands in for job_record_t, whose fields are spread over many lines */
+typedef struct {
+	uint32_t job_id;
+	uint32_t priority;
+	char pad[480];
+	uint32_t part_cnt;
+	uint32_t sched_cnt;
+} job_t;
+
+/* Same layout as job_queue_rec_t */
+typedef struct {
+	uint32_t array_task_id;
+	uint32_t job_id;
+	job_t *job_ptr;
+	void *part_ptr;
+	uint32_t priority;
+	void *resv_ptr;
+} rec_t;
+
+static job_t **jobs;
+static int job_cnt;
+static uint32_t next_job_id = 1;
+
+/* Descending priority, then ascending job id, as in sort_job_queue2() */
+static int _sort_rec(void *x, void *y)
+{
+	rec_t *rec1 = *(rec_t **) x;
+	rec_t *rec2 = *(rec_t **) y;
+
+	if (rec1->priority != rec2->priority)
+		return (rec1->priority < rec2->priority) ? 1 : -1;
+	if (rec1->job_ptr->job_id != rec2->job_ptr->job_id)
+		return (rec1->job_ptr->job_id < rec2->job_ptr->job_id) ? -1 : 1;
+	return 0;
+}
+
+static rec_t *_rec_create(job_t *job_ptr, int part)
+{
+	rec_t *rec = xmalloc(sizeof(*rec));
+
+	rec->job_id = job_ptr->job_id;
+	rec->job_ptr = job_ptr;
+	rec->part_ptr = (void *) (long) (part + 1);
+	rec->priority = job_ptr->priority - part;
+	return rec;
+}
+
+static void _submit(int i)
+{
+	jobs[i] = xmalloc(sizeof(job_t));
+	jobs[i]->job_id = next_job_id++;
+	jobs[i]->priority = 1000000 + (random() % 100000);
+	jobs[i]->part_cnt = 1 + (random() % 3);
+}
+
+/* Age pending jobs, and replace the ones that started */
+static void _update_jobs(void)
+{
+	int i;
+
+	for (i = 0; i < job_cnt; i++) {
+		if (!(random() % 20)) {
+			xfree(jobs[i]);
+			_submit(i);
+		} else {
+			jobs[i]->priority += random() % 100;
+		}
+	}
+}
+
+static uint64_t _cycle_list(void)
+{
+	List queue = list_create(xfree_ptr);
+	uint64_t sum = 0;
+	rec_t *rec;
+	int i, p;
+
+	for (i = 0; i < job_cnt; i++) {
+		for (p = 0; p < jobs[i]->part_cnt; p++)
+			list_append(queue, _rec_create(jobs[i], p));
+	}
+	list_sort(queue, _sort_rec);
+	while ((rec = list_pop(queue))) {
+		rec->job_ptr->sched_cnt++;
+		sum = (sum * 31) + rec->job_id;
+		xfree(rec);
+	}
+	FREE_NULL_LIST(queue);
+	return sum;
+}
+
+static uint64_t _cycle_vector(void)
+{
+	vector_t *queue = vector_create(xfree_ptr);
+	uint64_t sum = 0;
+	rec_t *rec;
+	int i, p;
+
+	for (i = 0; i < job_cnt; i++) {
+		for (p = 0; p < jobs[i]->part_cnt; p++)
+			vector_append(queue, _rec_create(jobs[i], p));
+	}
+	vector_sort(queue, _sort_rec);
+	while ((rec = vector_pop(queue))) {
+		rec->job_ptr->sched_cnt++;
+		sum = (sum * 31) + rec->job_id;
+		xfree(rec);
+	}
+	FREE_NULL_VECTOR(queue);
+	return sum;
+}
+
+int main(int argc, char **argv)
+{
+	int cycle_cnt, i, errors = 0;
+	long list_usec = 0, vector_usec = 0;
+	DEF_TIMERS;
+	uint64_t sum1 = 0, sum2;
+
+	job_cnt = (argc > 1) ? atoi(argv[1]) : 50000;
+	cycle_cnt = (argc > 2) ? atoi(argv[2]) : 20;
+
+	srandom(1);
+	jobs = xcalloc(job_cnt, sizeof(job_t *));
+	for (i = 0; i < job_cnt; i++)
+		_submit(i);
+	/* Interleave other allocations as a running controller would */
+	for (i = 0; i < job_cnt; i++) {
+		if (!(random() % 2)) {
+			xfree(jobs[i]);
+			_submit(i);
+		}
+	}
+	printf("%d pending jobs, %d cycles\n", job_cnt, cycle_cnt);
+
+	for (i = 0; i < cycle_cnt; i++) {
+		_update_jobs();
+
+		/* Alternate which goes first, as each reuses memory freed by
+		 * the other */
+		if (i % 2) {
+			START_TIMER;
+			sum1 = _cycle_list();
+			END_TIMER;
+			list_usec += DELTA_TIMER;
+		}
+
+		START_TIMER;
+		sum2 = _cycle_vector();
+		END_TIMER;
+		vector_usec += DELTA_TIMER;
+
+		if (!(i % 2)) {
+			START_TIMER;
+			sum1 = _cycle_list();
+			END_TIMER;
+			list_usec += DELTA_TIMER;
+		}
+
+		if (sum1 != sum2)
+			errors++;
+	}
+	printf("List     %10ld usec %10.1f usec/cycle\n",
+	       list_usec, (double) list_usec / cycle_cnt);
+	printf("vector   %10ld usec %10.1f usec/cycle\n",
+	       vector_usec, (double) vector_usec / cycle_cnt);
+
+	for (i = 0; i < job_cnt; i++)
+		xfree(jobs[i]);
+	xfree(jobs);
+
+	if (errors)
+		printf("%d errors\n", errors);
+	return errors ? 1 : 0;
+}
@@ -0,0 +1,157 @@
+/*
+ * Test of src/common/vector.c
+ *
+ * Avoid duplicate wait() symbol definition (in both testsuite/dejagnu.h
+ * and sys/wait.h
+ */
+#define _SYS_WAIT_H 1
+#include <stdbool.h>
+#include <stdlib.h>
+#include <src/common/vector.h>
+#include <src/common/xmalloc.h>
+#include <testsuite/dejagnu.h>
+
+/*
+ * Test for failure:
+ */
+#define TEST(_tst, _msg) do {		\
+	if (! (_tst))			\
+		fail( _msg );		\
+	else				\
+		pass( _msg );		\
+} while (0)
+
+#define ITEM_CNT 1000
+
+static int freed = 0;
+
+static void _free_item(void *x)
+{
+	freed++;
+	xfree(x);
+}
+
+static int _cmp_desc(void *x, void *y)
+{
+	int a = **(int **) x, b = **(int **) y;
+
+	return (b - a);
+}
+
+static int _match(void *x, void *key)
+{
+	return (*(int *) x == *(int *) key);
+}
+
+static int _is_odd(void *x, void *key)
+{
+	return (*(int *) x % 2);
+}
+
+static int _sum(void *x, void *arg)
+{
+	*(long *) arg += *(int *) x;
+	return 0;
+}
+
+static int _stop_at(void *x, void *arg)
+{
+	return (*(int *) x == *(int *) arg) ? -1 : 0;
+}
+
+static vector_t *_fill(int cnt)
+{
+	vector_t *v = vector_create(_free_item);
+	int i, *x;
+
+	for (i = 0; i < cnt; i++) {
+		x = xmalloc(sizeof(int));
+		*x = i;
+		vector_append(v, x);
+	}
+	return v;
+}
+
+int main(int argc, char *argv[])
+{
+	vector_t *v = _fill(ITEM_CNT);
+	int i, key, *x;
+	long sum = 0;
+	bool ok = true;
+
+	TEST((vector_count(v) == ITEM_CNT) && !vector_is_empty(v) &&
+	     (vector_count(NULL) == 0), "vector_count");
+	for (i = 0; i < ITEM_CNT; i++) {
+		if (*(int *) vector_get(v, i) != i)
+			ok = false;
+	}
+	TEST(ok && !vector_get(v, ITEM_CNT) && !vector_get(v, -1),
+	     "vector_get");
+
+	key = 500;
+	x = vector_find_first(v, _match, &key);
+	TEST(x && (*x == 500), "vector_find_first");
+	key = ITEM_CNT;
+	TEST(!vector_find_first(v, _match, &key), "vector_find_first missing");
+
+	TEST((vector_for_each(v, _sum, &sum) == ITEM_CNT) &&
+	     (sum == ((long) ITEM_CNT * (ITEM_CNT - 1)) / 2),
+	     "vector_for_each");
+	key = 9;
+	TEST(vector_for_each(v, _stop_at, &key) == -10,
+	     "vector_for_each stopped");
+
+	vector_sort(v, _cmp_desc);
+	ok = true;
+	for (i = 0; i < ITEM_CNT; i++) {
+		if (*(int *) vector_get(v, i) != (ITEM_CNT - 1 - i))
+			ok = false;
+	}
+	TEST(ok, "vector_sort");
+
+	/* Pop half, then append past the end to reuse the popped slots */
+	ok = true;
+	for (i = 0; i < ITEM_CNT / 2; i++) {
+		x = vector_pop(v);
+		if (*x != (ITEM_CNT - 1 - i))
+			ok = false;
+		xfree(x);
+	}
+	for (i = 0; i < ITEM_CNT; i++) {
+		x = xmalloc(sizeof(int));
+		*x = ITEM_CNT + i;
+		vector_append(v, x);
+	}
+	for (i = 0; ok && (i < ITEM_CNT / 2); i++) {
+		if (*(int *) vector_get(v, i) != (ITEM_CNT / 2 - 1 - i))
+			ok = false;
+	}
+	for (i = 0; ok && (i < ITEM_CNT); i++) {
+		if (*(int *) vector_get(v, ITEM_CNT / 2 + i) != (ITEM_CNT + i))
+			ok = false;
+	}
+	TEST(ok && (vector_count(v) == (ITEM_CNT + ITEM_CNT / 2)),
+	     "vector_pop and vector_append");
+
+	TEST((vector_delete_all(v, _is_odd, NULL) == (3 * ITEM_CNT) / 4) &&
+	     (freed == (3 * ITEM_CNT) / 4) &&
+	     (vector_count(v) == (3 * ITEM_CNT) / 4), "vector_delete_all");
+	ok = true;
+	for (i = 0; i < vector_count(v); i++) {
+		if (*(int *) vector_get(v, i) % 2)
+			ok = false;
+	}
+	TEST(ok, "vector_delete_all kept even items");
+
+	freed = 0;
+	i = vector_count(v);
+	FREE_NULL_VECTOR(v);
+	TEST(!v && (freed == i), "vector_destroy");
+
+	v = _fill(0);
+	TEST(!vector_pop(v) && vector_is_empty(v), "empty vector");
+	FREE_NULL_VECTOR(v);
+
+	totals();
+	return !(failed == 0);
+}
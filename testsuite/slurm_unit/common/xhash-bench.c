@@ -0,0 +1,128 @@
+/*
+ * Benchmark of xhash insert, lookup and delete, with string keys named as
+ * nodes are and with integer keys used as bytes as the backfill scheduler
+ * does with user ids. Lookups are done for keys both present and missing.
+ *
+ * Usage: xhash-bench [item_count] [loop_count]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <src/common/timers.h>
+#include <src/common/xhash.h>
+#include <src/common/xmalloc.h>
+#include <src/common/xstring.h>
+
+typedef struct {
+	char *name;
+	uint32_t id;
+} item_t;
+
+static void _identify_str(void *item, const char **key, uint32_t *key_len)
+{
+	*key = ((item_t *) item)->name;
+	*key_len = strlen(*key);
+}
+
+static void _identify_int(void *item, const char **key, uint32_t *key_len)
+{
+	*key = (const char *) &((item_t *) item)->id;
+	*key_len = sizeof(uint32_t);
+}
+
+static int _run(const char *name, item_t *items, char **miss, int item_cnt,
+		int loop_cnt, xhash_idfunc_t identify)
+{
+	DEF_TIMERS;
+	long add_usec = 0, hit_usec = 0, miss_usec = 0, del_usec = 0;
+	const char *key;
+	uint32_t key_len, miss_id;
+	int i, l, errors = 0;
+	xhash_t *table;
+
+	for (l = 0; l < loop_cnt; l++) {
+		table = xhash_init(identify, NULL);
+
+		START_TIMER;
+		for (i = 0; i < item_cnt; i++)
+			xhash_add(table, &items[i]);
+		END_TIMER;
+		add_usec += DELTA_TIMER;
+
+		START_TIMER;
+		for (i = 0; i < item_cnt; i++) {
+			identify(&items[i], &key, &key_len);
+			if (xhash_get(table, key, key_len) != &items[i])
+				errors++;
+		}
+		END_TIMER;
+		hit_usec += DELTA_TIMER;
+
+		START_TIMER;
+		for (i = 0; i < item_cnt; i++) {
+			if (identify == _identify_str) {
+				key = miss[i];
+				key_len = strlen(key);
+			} else {
+				miss_id = items[i].id + 1;
+				key = (const char *) &miss_id;
+				key_len = sizeof(miss_id);
+			}
+			if (xhash_get(table, key, key_len))
+				errors++;
+		}
+		END_TIMER;
+		miss_usec += DELTA_TIMER;
+
+		START_TIMER;
+		for (i = 0; i < item_cnt; i++) {
+			identify(&items[i], &key, &key_len);
+			if (xhash_pop(table, key, key_len) != &items[i])
+				errors++;
+		}
+		END_TIMER;
+		del_usec += DELTA_TIMER;
+
+		if (xhash_count(table))
+			errors++;
+		xhash_free(table);
+	}
+
+	printf("%-8s %10ld ops add usec=%ld get hit usec=%ld "
+	       "get miss usec=%ld pop usec=%ld\n", name,
+	       (long) item_cnt * loop_cnt, add_usec, hit_usec, miss_usec,
+	       del_usec);
+	return errors;
+}
+
+int main(int argc, char **argv)
+{
+	int item_cnt = (argc > 1) ? atoi(argv[1]) : 100000;
+	int loop_cnt = (argc > 2) ? atoi(argv[2]) : 10;
+	item_t *items = xcalloc(item_cnt, sizeof(item_t));
+	char **miss = xcalloc(item_cnt, sizeof(char *));
+	int i, errors = 0;
+
+	for (i = 0; i < item_cnt; i++) {
+		items[i].name = xstrdup_printf("node%05d", i);
+		items[i].id = 1000 + (2 * i);
+		miss[i] = xstrdup_printf("host%05d", i);
+	}
+	printf("%d items, %d loops\n", item_cnt, loop_cnt);
+
+	errors += _run("string", items, miss, item_cnt, loop_cnt,
+		       _identify_str);
+	errors += _run("integer", items, miss, item_cnt, loop_cnt,
+		       _identify_int);
+
+	for (i = 0; i < item_cnt; i++) {
+		xfree(items[i].name);
+		xfree(miss[i]);
+	}
+	xfree(items);
+	xfree(miss);
+
+	if (errors)
+		printf("%d errors\n", errors);
+	return errors ? 1 : 0;
+}
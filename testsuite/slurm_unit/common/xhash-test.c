@@ -200,6 +200,63 @@ START_TEST(test_delete)
 }
 END_TEST
 
+START_TEST(test_delete_many)
+{
+	xhash_t* ht = g_ht;
+	char buffer[255];
+	int i;
+
+	/* removing items shifts back others which collided with them */
+	for (i = 1; i < g_hashableslen; i += 2) {
+		snprintf(buffer, sizeof(buffer), "%d", i);
+		fail_unless(xhash_pop_str(ht, buffer) == (g_hashables + i),
+				"xhash_pop_str failed");
+	}
+	fail_unless(xhash_count(ht) == g_hashableslen / 2, "bad count");
+	fail_unless(test_delete_helper() == g_hashableslen / 2,
+			"bad number of items were deleted");
+	for (i = 0; i < g_hashableslen; i += 2) {
+		snprintf(buffer, sizeof(buffer), "%d", i);
+		fail_unless(xhash_get_str(ht, buffer) == (g_hashables + i),
+				"item lost when deleting others");
+	}
+
+	for (i = 1; i < g_hashableslen; i += 2)
+		fail_unless(xhash_add(ht, g_hashables + i) != NULL,
+				"xhash_add failed");
+	fail_unless(xhash_count(ht) == g_hashableslen, "bad count");
+	fail_unless(test_delete_helper() == 0, "item not found after re-add");
+}
+END_TEST
+
+static void uint_identify(void* voiditem, const char** key, uint32_t* key_len)
+{
+	*key = (const char *) voiditem;
+	*key_len = sizeof(uint32_t);
+}
+
+START_TEST(test_int_keys)
+{
+	xhash_t* ht = xhash_init(uint_identify, NULL);
+	uint32_t keys[5000], key;
+	int i;
+
+	for (i = 0; i < 5000; ++i) {
+		keys[i] = i * 7919;
+		fail_unless(xhash_add(ht, keys + i) != NULL, "xhash_add failed");
+	}
+	for (i = 0; i < 5000; ++i) {
+		key = i * 7919;
+		fail_unless(xhash_get(ht, (char *) &key, sizeof(key)) ==
+				(keys + i), "integer key not found");
+		key = i * 7919 + 1;
+		fail_unless(xhash_get(ht, (char *) &key, sizeof(key)) == NULL,
+				"invalid integer key found");
+	}
+	xhash_free(ht);
+}
+END_TEST
+
 START_TEST(test_count)
 {
 	xhash_t* ht = g_ht;
@@ -247,6 +304,8 @@ Suite *xhash_suite(void)
 	tcase_add_test(tc_core, test_add);
 	tcase_add_test(tc_core, test_find);
 	tcase_add_test(tc_core, test_delete);
+	tcase_add_test(tc_core, test_delete_many);
+	tcase_add_test(tc_core, test_int_keys);
 	tcase_add_test(tc_core, test_count);
 	tcase_add_test(tc_core, test_walk);
 	suite_add_tcase(s, tc_core);
@@ -0,0 +1,89 @@
+/*
+ * Benchmark of xmalloc() and xfree() from several threads at once, as RPC
+ * threads in slurmctld allocate while unpacking and packing messages. Each
+ * thread keeps a window of small allocations of varying size, freeing the
+ * oldest as it allocates. Runs first with all threads sharing one malloc
+ * arena, then with an arena per thread, each with and without allocation
+ * profiling.
+ *
+ * Usage: xmalloc-bench [thread_count] [alloc_count]
+ */
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <src/common/timers.h>
+#include <src/common/xmalloc.h>
+
+#define WINDOW 256
+
+static int alloc_cnt;
+
+static void *_alloc_thread(void *arg)
+{
+	unsigned int seed = (unsigned int) (uintptr_t) arg;
+	char *ptr[WINDOW] = { NULL };
+	int i;
+
+	for (i = 0; i < alloc_cnt; i++) {
+		xfree(ptr[i % WINDOW]);
+		ptr[i % WINDOW] = xmalloc_nz(16 + (rand_r(&seed) % 512));
+	}
+	for (i = 0; i < WINDOW; i++)
+		xfree(ptr[i]);
+	return NULL;
+}
+
+static void _bench(char *name, int thread_cnt, bool profile)
+{
+	pthread_t *threads = xcalloc(thread_cnt, sizeof(pthread_t));
+	DEF_TIMERS;
+	long usec;
+	int i;
+
+	xmalloc_profile_set(profile);
+	START_TIMER;
+	for (i = 0; i < thread_cnt; i++)
+		pthread_create(&threads[i], NULL, _alloc_thread,
+			       (void *) (uintptr_t) (i + 1));
+	for (i = 0; i < thread_cnt; i++)
+		pthread_join(threads[i], NULL);
+	END_TIMER;
+	usec = DELTA_TIMER;
+	xmalloc_profile_set(false);
+
+	printf("%-10s profile %-3s %8ld usec %6.1f nsec per xmalloc+xfree\n",
+	       name, profile ? "on" : "off", usec,
+	       (usec * 1000.0) / ((double) thread_cnt * alloc_cnt));
+	xfree(threads);
+}
+
+int main(int argc, char **argv)
+{
+	int thread_cnt = (argc > 1) ? atoi(argv[1]) : 8;
+	xmalloc_site_t *sites = NULL;
+	int site_cnt;
+
+	alloc_cnt = (argc > 2) ? atoi(argv[2]) : 2000000;
+	printf("%d threads, %d allocations each\n", thread_cnt, alloc_cnt);
+
+	/* Arenas are only added, so run with a single arena first */
+	if (xmalloc_set_arenas(1)) {
+		printf("malloc arenas can not be set\n");
+	} else {
+		_bench("1 arena", thread_cnt, false);
+		_bench("1 arena", thread_cnt, true);
+		xmalloc_set_arenas(thread_cnt);
+	}
+	_bench("arenas", thread_cnt, false);
+	_bench("arenas", thread_cnt, true);
+
+	site_cnt = xmalloc_profile_get(&sites);
+	if (site_cnt) {
+		printf("%s:%d count:%"PRIu64" bytes:%"PRIu64" live:%"PRIu64"\n",
+		       sites[0].file, sites[0].line, sites[0].alloc_cnt,
+		       sites[0].alloc_bytes, sites[0].live_bytes);
+	}
+	xfree(sites);
+	return 0;
+}
@@ -0,0 +1,124 @@
+/*
+ * Test of allocation profiling in src/common/xmalloc.c
+ *
+ * Avoid duplicate wait() symbol definition (in both testsuite/dejagnu.h
+ * and sys/wait.h
+ */
+#define _SYS_WAIT_H 1
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <src/common/xmalloc.h>
+#include <testsuite/dejagnu.h>
+
+/*
+ * Test for failure:
+ */
+#define TEST(_tst, _msg) do {		\
+	if (! (_tst))			\
+		fail( _msg );		\
+	else				\
+		pass( _msg );		\
+} while (0)
+
+static xmalloc_site_t *sites = NULL;
+static int site_cnt = 0;
+
+/* Refresh the profile, return the call site at line of this file */
+static xmalloc_site_t *_find_site(int line)
+{
+	int i;
+
+	xfree(sites);
+	site_cnt = xmalloc_profile_get(&sites);
+	for (i = 0; i < site_cnt; i++) {
+		if ((sites[i].line == line) &&
+		    strstr(sites[i].file, "xmalloc-test.c"))
+			return &sites[i];
+	}
+	return NULL;
+}
+
+int main(int argc, char *argv[])
+{
+	xmalloc_site_t *site;
+	char *ptr[3] = { NULL };
+	xmalloc_site_t *fake_sites = NULL;
+	char *untracked, *file;
+	int i, fake_cnt, alloc_line, realloc_line, untracked_line;
+
+	TEST(!_find_site(__LINE__), "nothing counted before profiling");
+
+	xmalloc_profile_set(true);
+	for (i = 0; i < 3; i++) {
+		alloc_line = __LINE__; ptr[i] = xmalloc(100);
+	}
+	site = _find_site(alloc_line);
+	TEST(site && (site->alloc_cnt == 3) && (site->alloc_bytes == 300) &&
+	     (site->live_bytes == 300), "allocations counted");
+	TEST(xsize(ptr[0]) == 100, "xsize of a counted allocation");
+
+	xfree(ptr[0]);
+	site = _find_site(alloc_line);
+	TEST(site && (site->alloc_cnt == 3) && (site->live_bytes == 200),
+	     "free counted");
+
+	realloc_line = __LINE__; xrealloc(ptr[1], 5000);
+	TEST(xsize(ptr[1]) == 5000, "xsize of a reallocation");
+	site = _find_site(alloc_line);
+	TEST(site && (site->live_bytes == 100),
+	     "reallocation taken from the allocating call site");
+	site = _find_site(realloc_line);
+	TEST(site && (site->alloc_cnt == 1) && (site->alloc_bytes == 5000) &&
+	     (site->live_bytes == 5000),
+	     "reallocation counted at its call site");
+	for (i = 1; i < site_cnt; i++) {
+		if (sites[i - 1].alloc_bytes < sites[i].alloc_bytes)
+			break;
+	}
+	TEST(site_cnt && (i == site_cnt), "call sites with most bytes first");
+
+	/* A file name from an unloaded plugin, then the same name elsewhere */
+	file = strdup("src/plugins/fake/fake.c");
+	ptr[0] = slurm_xcalloc(1, 10, true, false, file, 7, __func__);
+	free(file);
+	file = strdup("src/plugins/fake/fake.c");
+	untracked = slurm_xcalloc(1, 20, true, false, file, 7, __func__);
+	free(file);
+	fake_cnt = xmalloc_profile_get(&fake_sites);
+	for (i = 0; i < fake_cnt; i++) {
+		if ((fake_sites[i].line == 7) &&
+		    !strcmp(fake_sites[i].file, "src/plugins/fake/fake.c"))
+			break;
+	}
+	TEST((i < fake_cnt) && (fake_sites[i].alloc_cnt == 2) &&
+	     (fake_sites[i].live_bytes == 30),
+	     "call sites matched by file name");
+	xfree(fake_sites);
+	xfree(ptr[0]);
+	xfree(untracked);
+
+	xmalloc_profile_set(false);
+	untracked_line = __LINE__; untracked = xmalloc(100);
+	TEST(!_find_site(untracked_line), "nothing counted once stopped");
+	xfree(untracked);
+	xfree(ptr[1]);
+	site = _find_site(realloc_line);
+	TEST(site && (site->live_bytes == 0), "free counted once stopped");
+
+	xmalloc_profile_reset();
+	site = _find_site(alloc_line);
+	TEST(site && (site->alloc_cnt == 0) && (site->alloc_bytes == 0) &&
+	     (site->live_bytes == 100), "reset keeps live bytes");
+	xfree(ptr[2]);
+	site = _find_site(alloc_line);
+	TEST(site && (site->live_bytes == 0), "free counted after reset");
+	xfree(sites);
+
+#ifdef __GLIBC__
+	TEST(xmalloc_set_arenas(4) == 0, "malloc arenas set");
+#endif
+
+	totals();
+	return !(failed == 0);
+}